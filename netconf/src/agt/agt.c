@@ -66,6 +66,8 @@ date         init     comment
 #include "ncx_str.h"
 #include "ncxconst.h"
 #include "ncxmod.h"
+#include "ses.h"
+#include "ses_msg.h"
 #include "status.h"
 #include "agt_not_queue_notification_cb.h"
 
@@ -165,6 +167,16 @@ static void
     agt_profile.agt_accesscontrol_enum = AGT_ACMOD_ENFORCING;
     agt_profile.agt_system_sorted = AGT_DEF_SYSTEM_SORTED;
     agt_profile.agt_max_sessions = 1024;
+    agt_profile.agt_event_loop = AGT_EVLOOP_SELECT;
+    agt_profile.agt_buffer_size = SES_MSG_BUFFSIZE;
+    agt_profile.agt_bulk_buffer_size = SES_MSG_BULK_BUFFSIZE;
+    agt_profile.agt_read_buffer_size = SES_READBUFF_SIZE;
+    agt_profile.agt_max_session_buffers = SES_MAX_BUFFERS;
+    agt_profile.agt_max_queued_output = SES_MAX_QUEUED_OUTPUT;
+    agt_profile.agt_write_timeout = SES_WRITE_TIMEOUT;
+    agt_profile.agt_rpc_batch_size = AGT_DEF_RPC_BATCH_SIZE;
+    agt_profile.agt_rpc_batch_time = AGT_DEF_RPC_BATCH_TIME;
+    agt_profile.agt_full_validate = FALSE;
 
 } /* init_server_profile */
 
@@ -665,6 +677,13 @@ status_t
     /* set the 'top-level mandatory objects allowed' flag */
     ncx_set_top_mandatory_allowed(!agt_profile.agt_running_error);
 
+    /* set the session buffer sizes and limits */
+    ses_msg_set_buffsize(agt_profile.agt_buffer_size,
+                         agt_profile.agt_bulk_buffer_size);
+    ses_msg_set_max_buffers(agt_profile.agt_max_session_buffers);
+    ses_msg_set_max_queued_output(agt_profile.agt_max_queued_output);
+    ses_set_readbuff_size(agt_profile.agt_read_buffer_size);
+
     /*** All Server profile parameters should be set by now ***/
 
     /* must set the server capabilities after the profile is set */
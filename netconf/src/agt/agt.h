@@ -157,6 +157,12 @@ extern "C" {
 /* this is over-ridden by the --system-sorted CLI parameter */
 #define AGT_DEF_SYSTEM_SORTED     FALSE
 
+/* these are over-ridden by the --rpc-batch-size and
+ * --rpc-batch-time CLI parameters
+ */
+#define AGT_DEF_RPC_BATCH_SIZE    16
+#define AGT_DEF_RPC_BATCH_TIME    10000
+
 #define AGT_USER_VAR        (const xmlChar *)"user"
 
 #define AGT_URL_SCHEME_LIST (const xmlChar *)"file"
@@ -200,6 +206,14 @@ typedef enum agt_acmode_t_ {
 } agt_acmode_t;
 
 
+/* matches event-loop enumeration in netconfd.yang */
+typedef enum agt_evloop_t_ {
+    AGT_EVLOOP_NONE,
+    AGT_EVLOOP_SELECT,
+    AGT_EVLOOP_EPOLL
+} agt_evloop_t;
+
+
 /* server config state used in agt_val_root_check */
 typedef enum agt_config_state_t_ {
     AGT_CFG_STATE_NONE,
@@ -243,7 +257,7 @@ typedef struct agt_profile_t_ {
     boolean             agt_logappend;
     boolean             agt_xmlorder;
     boolean             agt_deleteall_ok;   /* TBD: not implemented */
-    boolean             agt_stream_output;   /* d:true; no CLI support yet */
+    boolean             agt_stream_output;   /* d:true */
     boolean             agt_delete_empty_npcontainers;     /* d: false */
     boolean             agt_notif_sequence_id;    /* d: false */
     const xmlChar      *agt_accesscontrol;
@@ -265,6 +279,16 @@ typedef struct agt_profile_t_ {
     agt_acmode_t        agt_accesscontrol_enum;
     uint16              agt_ports[AGT_MAX_PORTS];
     uint32              agt_max_sessions;
+    agt_evloop_t        agt_event_loop;
+    uint32              agt_buffer_size;
+    uint32              agt_bulk_buffer_size;
+    uint32              agt_read_buffer_size;
+    uint32              agt_max_session_buffers;
+    uint32              agt_max_queued_output;
+    uint32              agt_write_timeout;
+    uint32              agt_rpc_batch_size;
+    uint32              agt_rpc_batch_time;   /* usec; 0 == no limit */
+    boolean             agt_full_validate;     /* --validate-all */
 
     /****** state variables; TBD: move out of profile ******/
 
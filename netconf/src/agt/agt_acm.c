@@ -1328,7 +1328,7 @@ for ( rule_list = val_find_child( nacmroot, AGT_ACM_MODULE,
 
         /* get the XPath expression leaf */
         path = val_find_child( rule, AGT_ACM_MODULE, nacm_N_path );
-        if ( !path || !path->xpathpcb ) {
+        if ( !path || !VAL_XPATHPCB(path) ) {
             continue;
         }
 
@@ -1347,7 +1347,7 @@ for ( rule_list = val_find_child( nacmroot, AGT_ACM_MODULE,
                 continue;
             }
 
-            pcb = xpath_clone_pcb( path->xpathpcb );
+            pcb = xpath_clone_pcb( VAL_XPATHPCB(path) );
             if(!pcb) {
                 res = ERR_INTERNAL_MEM;
                 break;
@@ -847,6 +847,7 @@ agt_cfg_commit_test_t *
     agt_cfg_commit_test_t *commit_test = m__getObj(agt_cfg_commit_test_t);
     if (commit_test) {
         memset(commit_test, 0x0, sizeof(agt_cfg_commit_test_t));
+        dlq_createSQue(&commit_test->objdepQ);
     }
     return commit_test;
 
@@ -875,6 +876,7 @@ void
     if (commit_test->result) {
         xpath_free_result(commit_test->result);
     }
+    xpath_clean_objdepQ(&commit_test->objdepQ);
     m__free(commit_test);
 
 } /* agt_cfg_free_commit_test */
@@ -205,6 +205,9 @@ typedef struct agt_cfg_commit_test_t_ {
     cfg_transaction_id_t result_txid;
     ncx_btype_t        btyp;
     uint32             testflags;  /* AGT_TEST_FL_FOO bits */
+    dlq_hdr_t          objdepQ;    /* Q of xpath_objdep_t */
+    boolean            anydep;     /* objdepQ is not complete */
+    boolean            localdeps;  /* must-stmts only read obj subtree */
 } agt_cfg_commit_test_t;
 
 
@@ -323,6 +323,78 @@ static void
         agt_profile->agt_max_sessions = VAL_UINT(val);
     }
 
+    /* get event-loop param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_EVENT_LOOP);
+    if (val && val->res == NO_ERR) {
+        if (!xml_strcmp(VAL_ENUM_NAME(val), NCX_EL_EPOLL)) {
+            agt_profile->agt_event_loop = AGT_EVLOOP_EPOLL;
+        } else {
+            agt_profile->agt_event_loop = AGT_EVLOOP_SELECT;
+        }
+    }
+
+    /* get buffer-size param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_BUFFER_SIZE);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_buffer_size = VAL_UINT(val);
+    }
+
+    /* get bulk-buffer-size param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_BULK_BUFFER_SIZE);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_bulk_buffer_size = VAL_UINT(val);
+    }
+
+    /* get read-buffer-size param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_READ_BUFFER_SIZE);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_read_buffer_size = VAL_UINT(val);
+    }
+
+    /* get max-session-buffers param */
+    val = val_find_child(valset, AGT_CLI_MODULE, 
+                         NCX_EL_MAX_SESSION_BUFFERS);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_max_session_buffers = VAL_UINT(val);
+    }
+
+    /* get stream-output param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_STREAM_OUTPUT);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_stream_output = VAL_BOOL(val);
+    }
+
+    /* get max-queued-output param */
+    val = val_find_child(valset, AGT_CLI_MODULE, 
+                         NCX_EL_MAX_QUEUED_OUTPUT);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_max_queued_output = VAL_UINT(val);
+    }
+
+    /* get write-timeout param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_WRITE_TIMEOUT);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_write_timeout = VAL_UINT(val);
+    }
+
+    /* get rpc-batch-size param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_RPC_BATCH_SIZE);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_rpc_batch_size = VAL_UINT(val);
+    }
+
+    /* get rpc-batch-time param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_RPC_BATCH_TIME);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_rpc_batch_time = VAL_UINT(val);
+    }
+
+    /* get validate-all param */
+    val = val_find_child(valset, AGT_CLI_MODULE, NCX_EL_VALIDATE_ALL);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_full_validate = VAL_BOOL(val);
+    }
+
 } /* set_server_profile */
 
 
@@ -33,6 +33,7 @@ date         init     comment
 
 #include  "procdefs.h"
 #include "agt.h"
+#include "agt_acm.h"
 #include "agt_cap.h"
 #include "agt_cb.h"
 #include "agt_cfg.h"
@@ -58,6 +59,8 @@ date         init     comment
 #include  "status.h"
 #include  "tstamp.h"
 #include  "val.h"
+#include  "val_diff.h"
+#include  "xml_val.h"
 #include  "xml_wr.h"
 #include  "yangconst.h"
 #include  "uptime.h"
@@ -745,7 +748,9 @@ static status_t
 
 void val_remove_cadidate_getcb(val_value_t  *val)
 {
-    val->getcb=NULL;
+    if (val->extra) {
+        val->extra->getcb=NULL;
+    }
     val_value_t  *candidate_val;
     for (candidate_val = val_get_first_child(val);
          candidate_val != NULL;
@@ -2247,7 +2252,7 @@ void dump_node_database(val_value_t  *val)
     if(val->name)
     {
         log_debug("\nprint node [%s]",val->name);
-        if(val->getcb!=NULL)
+        if(VAL_GETCB(val)!=NULL)
         {
             log_debug(" with getcb");
         }
@@ -3230,6 +3235,157 @@ static status_t
 } /* shutdown_invoke */
 
 
+/********************************************************************
+* FUNCTION get_diff_root
+*
+* Get the root of the datastore named in a diff-config parameter
+*
+* INPUTS:
+*    msg == incoming diff-config rpc_msg_t in progress
+*    parmname == name of the input parameter
+*    defname == datastore name to use if the parameter is missing
+*    res == address of return status
+*
+* OUTPUTS:
+*    *res == return status
+*
+* RETURNS:
+*    pointer to the datastore root, or NULL if error
+*********************************************************************/
+static val_value_t *
+    get_diff_root (rpc_msg_t *msg,
+                   const xmlChar *parmname,
+                   const xmlChar *defname,
+                   status_t *res)
+{
+    val_value_t    *parmval;
+    cfg_template_t *cfg;
+    const xmlChar  *cfgname = defname;
+
+    parmval = val_find_child(msg->rpc_input, AGT_SYS_MODULE, parmname);
+    if (parmval && parmval->res == NO_ERR && VAL_ENUM_NAME(parmval)) {
+        cfgname = VAL_ENUM_NAME(parmval);
+    }
+
+    cfg = cfg_get_config(cfgname);
+    if (cfg == NULL) {
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return NULL;
+    }
+
+    if (cfg->root == NULL) {
+        *res = ERR_NCX_OPERATION_FAILED;
+        return NULL;
+    }
+
+    *res = NO_ERR;
+    return cfg->root;
+
+} /* get_diff_root */
+
+
+/********************************************************************
+* FUNCTION diff_config_invoke
+*
+* diff-config : invoke params callback
+* Return the changed nodes between two datastores
+*
+* INPUTS:
+*    see rpc/agt_rpc.h
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t 
+    diff_config_invoke (ses_cb_t *scb,
+                        rpc_msg_t *msg,
+                        xml_node_t *methnode)
+{
+    val_value_t   *srcroot, *targroot, *changeval, *leafval;
+    val_diff_t    *diff;
+    dlq_hdr_t      diffQ;
+    xmlns_id_t     nsid;
+    status_t       res;
+
+    dlq_createSQue(&diffQ);
+    nsid = val_get_nsid(msg->rpc_input);
+
+    srcroot = get_diff_root(msg, NCX_EL_SOURCE, NCX_EL_RUNNING, &res);
+    targroot = NULL;
+    if (res == NO_ERR) {
+        targroot = get_diff_root(msg, NCX_EL_TARGET, NCX_EL_CANDIDATE, &res);
+    }
+
+    if (res == NO_ERR) {
+        res = val_diff_trees(&msg->mhdr, srcroot, targroot, TRUE, &diffQ);
+    }
+
+    /* one <change> entry for each diff record the
+     * user is allowed to read
+     */
+    while (res == NO_ERR && !dlq_empty(&diffQ)) {
+        diff = (val_diff_t *)dlq_deque(&diffQ);
+
+        if (!agt_acm_val_read_allowed(&msg->mhdr,
+                                      scb->username,
+                                      (diff->newval) ?
+                                      diff->newval : diff->oldval)) {
+            val_free_diff(diff);
+            continue;
+        }
+
+        changeval = xml_val_new_struct(NCX_EL_CHANGE, nsid);
+        if (changeval == NULL) {
+            res = ERR_INTERNAL_MEM;
+        } else {
+            /* pass off the malloced path string */
+            leafval = xml_val_new_string(NCX_EL_PATH, nsid, diff->path);
+            if (leafval == NULL) {
+                res = ERR_INTERNAL_MEM;
+            } else {
+                diff->path = NULL;
+                val_add_child(leafval, changeval);
+                leafval = xml_val_new_cstring(NCX_EL_OPERATION, nsid,
+                                              val_diff_op_name(diff->op));
+                if (leafval == NULL) {
+                    res = ERR_INTERNAL_MEM;
+                } else {
+                    val_add_child(leafval, changeval);
+                }
+            }
+            if (res == NO_ERR) {
+                dlq_enque(changeval, &msg->rpc_dataQ);
+            } else {
+                val_free_value(changeval);
+            }
+        }
+        val_free_diff(diff);
+    }
+
+    val_clean_diffQ(&diffQ);
+
+    if (res != NO_ERR) {
+        while (!dlq_empty(&msg->rpc_dataQ)) {
+            changeval = (val_value_t *)dlq_deque(&msg->rpc_dataQ);
+            val_free_value(changeval);
+        }
+        agt_record_error(scb, 
+                         &msg->mhdr, 
+                         NCX_LAYER_OPERATION, 
+                         res,
+                         methnode, 
+                         NCX_NT_NONE, 
+                         NULL, 
+                         NCX_NT_NONE, 
+                         NULL);
+    } else if (!dlq_empty(&msg->rpc_dataQ)) {
+        msg->rpc_data_type = RPC_DATA_YANG;
+    }
+
+    return res;
+
+} /* diff_config_invoke */
+
+
 /********************************************************************
 * FUNCTION register_nc_callbacks
 *
@@ -3262,6 +3418,19 @@ static status_t
         return SET_ERROR(res);
     }
 
+    /* the <get> and <get-config> input only lives as long as
+     * the request, so parse it into the message arena
+     */
+    res = agt_rpc_set_input_arena(NC_MODULE, op_method_name(OP_GET));
+    if (res != NO_ERR) {
+        return SET_ERROR(res);
+    }
+    res = agt_rpc_set_input_arena(NC_MODULE, 
+                                  op_method_name(OP_GET_CONFIG));
+    if (res != NO_ERR) {
+        return SET_ERROR(res);
+    }
+
     /* edit-config */
     res = agt_rpc_register_method(NC_MODULE,
                                   op_method_name(OP_EDIT_CONFIG),
@@ -3279,6 +3448,16 @@ static status_t
         return SET_ERROR(res);
     }
 
+    /* most of the per-message allocations are the <config> nodes;
+     * the ones that end up in the target are copied out of the
+     * arena when the edit is applied
+     */
+    res = agt_rpc_set_input_arena(NC_MODULE, 
+                                  op_method_name(OP_EDIT_CONFIG));
+    if (res != NO_ERR) {
+        return SET_ERROR(res);
+    }
+
     res = agt_rpc_register_method(NC_MODULE,
                                   op_method_name(OP_TRANS_START),
                                   AGT_RPC_PH_INVOKE,
@@ -3504,6 +3683,15 @@ static status_t
         return SET_ERROR(res);
     }
 
+    /* diff-config extension */
+    res = agt_rpc_register_method(AGT_SYS_MODULE, 
+                                  NCX_EL_DIFF_CONFIG,
+                                  AGT_RPC_PH_INVOKE,  
+                                  diff_config_invoke);
+    if (res != NO_ERR) {
+        return SET_ERROR(res);
+    }
+
     /* no-op extension */
     agt_rpc_support_method(AGT_SYS_MODULE, NCX_EL_NO_OP);
 
@@ -3584,6 +3772,9 @@ static void
     /* shutdown extension */
     agt_rpc_unregister_method(AGT_SYS_MODULE, NCX_EL_SHUTDOWN);
 
+    /* diff-config extension */
+    agt_rpc_unregister_method(AGT_SYS_MODULE, NCX_EL_DIFF_CONFIG);
+
     /* no-op extension */
     agt_rpc_unregister_method(AGT_SYS_MODULE, NCX_EL_NO_OP);
 
@@ -3994,7 +4185,9 @@ void
 
 void val_reset_cache_time (val_value_t  *val)
 {
-    val->cachetime=(time_t)0;
+    if (val->extra) {
+        val->extra->cachetime=(time_t)0;
+    }
     val_value_t  *candidate_val;
     for (candidate_val = val_get_first_child(val);
          candidate_val != NULL;
@@ -43,6 +43,11 @@ date         init     comment
 #include <arpa/inet.h>
 #include <netdb.h>
 
+#if !defined(CYGWIN) && !defined(MACOSX) && !defined(FREEBSD)
+#define AGT_NCXSERVER_EPOLL 1
+#include <sys/epoll.h>
+#endif
+
 #include "procdefs.h"
 #include "agt.h"
 #include "agt_ncxserver.h"
@@ -74,11 +79,24 @@ date         init     comment
 /* number of notifications to send out in 1 timeout interval */
 #define MAX_NOTIFICATION_BURST  10
 
+/* max number of ready events returned by 1 epoll_wait call */
+#define AGT_NCXSERVER_MAX_EVENTS  64
+
 
 static fd_set active_fd_set;
 static fd_set read_fd_set;
 static fd_set write_fd_set;
 
+/* sessions waiting for the socket to take more output */
+static fd_set wait_write_fd_set;
+
+#ifdef AGT_NCXSERVER_EPOLL
+static int                 epoll_fd = -1;
+static int                 epoll_curevent;
+static int                 epoll_numevents;
+static struct epoll_event  epoll_events[AGT_NCXSERVER_MAX_EVENTS];
+#endif
+
 
 /********************************************************************
  * FUNCTION make_named_socket
@@ -216,6 +234,13 @@ static void
     uint32                sendcount, sendtotal, sendmax;
     boolean               done;
 
+    /* a session with a suspended writer is in the middle
+     * of a message, so the notifications wait until it is done
+     */
+    if (agt_ses_writer_suspended()) {
+        return;
+    }
+
     sendcount = 0;
     sendtotal = 0;
 
@@ -244,97 +269,254 @@ static void
 
 
 
-/***********     E X P O R T E D   F U N C T I O N S   *************/
-
-
 /********************************************************************
- * FUNCTION agt_ncxserver_run
+ * FUNCTION accept_new_session
  * 
- * IO server loop for the ncxserver socket
+ * Accept a connection request on the ncxserver socket
+ * and create a new session for it
  * 
+ * INPUTS:
+ *    ncxsock == listening ncxserver socket
+ *
  * RETURNS:
- *   status
+ *    pointer to the new session control block, or NULL if
+ *    the connection could not be accepted
  *********************************************************************/
-status_t
-    agt_ncxserver_run (void)
+static ses_cb_t *
+    accept_new_session (int ncxsock)
 {
     ses_cb_t              *scb;
-    agt_profile_t         *profile;
-    int                    ncxsock, maxwrnum, maxrdnum;
-    int                    i, new, ret;
     struct sockaddr_un     clientname;
-    struct timeval         timeout;
     socklen_t              size;
-    status_t               res;
-    boolean                done, done2, stream_output;
-    char*                  tcp_direct_address = NULL;
-    int                    tcp_direct_port = -1;
-    char*                  ncxserver_sockname;
-    val_value_t            *clivalset;
-    val_value_t            *val;
-
-    /* Create the socket and set it up to accept connections. */
-    clivalset = agt_cli_get_valset();
-    if (clivalset) {
+    int                    new, flags;
+
+    size = (socklen_t)sizeof(clientname);
+    new = accept(ncxsock,
+                 (struct sockaddr *)&clientname,
+                 &size);
+    if (new < 0) {
+        if (LOGINFO) {
+            log_info("\nagt_ncxserver accept "
+                     "connection failed (%d)",
+                     new);
+        }
+        return NULL;
+    }
 
-        val = val_find_child(clivalset,
-                             NCXMOD_NETCONFD,
-                             NCX_EL_TCP_DIRECT_PORT);
-        if(val != NULL) {
-            tcp_direct_port = VAL_INT(val);
+    /* get a new session control block */
+    scb = agt_ses_new_session(SES_TRANSPORT_SSH, new);
+    if (scb == NULL) {
+        close(new);
+        if (LOGINFO) {
+            log_info("\nagt_ncxserver new "
+                     "session failed (%d)", 
+                     new);
         }
+        return NULL;
+    }
 
-        val = val_find_child(clivalset,
-                             NCXMOD_NETCONFD,
-                             NCX_EL_TCP_DIRECT_ADDRESS);
-        if(val != NULL) {
-            tcp_direct_address = VAL_STR(val);
-            if(tcp_direct_port==-1) tcp_direct_port = 2023;
+    /* set non-blocking IO; the output is sent as the socket
+     * takes it, so a blocking socket would stall the server
+     */
+    flags = fcntl(new, F_GETFL);
+    if (flags < 0 || fcntl(new, F_SETFL, flags | O_NONBLOCK) < 0) {
+        log_error("\nError: fcntl failed for session %d (%s)",
+                  scb->sid,
+                  strerror(errno));
+        agt_ses_free_session(scb);
+        return NULL;
+    }
+    return scb;
+
+} /* accept_new_session */
+
+
+/********************************************************************
+ * FUNCTION write_session_output
+ * 
+ * Send as many queued buffers for a session as the socket will take
+ * A suspended writer for the session is resumed once enough
+ * of its output has been sent
+ * 
+ * INPUTS:
+ *    scb == session control block with output ready
+ *
+ * RETURNS:
+ *    scb if the session is still active;
+ *    NULL if the session was killed
+ *********************************************************************/
+static ses_cb_t *
+    write_session_output (ses_cb_t *scb)
+{
+    status_t   res;
+
+    /* check if anything to write */
+    if (!dlq_empty(&scb->outQ)) {
+        res = ses_msg_send_buffs(scb);
+        if (res != NO_ERR) {
+            if (LOGINFO) {
+                log_info("\nagt_ncxserver write failed; "
+                         "closing session %d ", 
+                         scb->sid);
+            }
+            agt_ses_kill_session(scb, 
+                                 scb->sid,
+                                 SES_TR_OTHER);
+            return NULL;
         }
 
-        val = val_find_child(clivalset,
-                             NCXMOD_NETCONFD,
-                             NCX_EL_NCXSERVER_SOCKNAME);
-        if(val != NULL) {
-            ncxserver_sockname = VAL_STR(val);
-        } else {
-            ncxserver_sockname = NCXSERVER_SOCKNAME;
+        scb = agt_ses_resume_writer(scb);
+        if (scb == NULL) {
+            return NULL;
+        } else if (scb->state == SES_ST_SHUTDOWN_REQ &&
+                   dlq_empty(&scb->outQ) &&
+                   !ses_msg_writer_suspended(scb)) {
+            /* close-session reply sent, now kill ses */
+            agt_ses_kill_session(scb, 
+                                 scb->killedbysid,
+                                 scb->termreason);
+            return NULL;
         }
+    }
 
-    } else {
-            log_error("\n*** agt_ncxserver_run:agt_cli_get_valset failed.\n");
-            return SET_ERROR(ERR_INTERNAL_VAL);
+    /* check if any buffers left over for next loop */
+    if (!dlq_empty(&scb->outQ)) {
+        ses_msg_make_outready(scb);
     }
-    if(tcp_direct_port!=-1) {
-        res = make_tcp_socket(tcp_direct_address, tcp_direct_port, &ncxsock);
-        if (res != NO_ERR) {
-            log_error("\n*** Cannot connect to ncxserver socket listen tcp port: %d\n",tcp_direct_port);
-            return res;
+    return scb;
+
+} /* write_session_output */
+
+
+/********************************************************************
+ * FUNCTION read_session_input
+ * 
+ * Data arriving on an already-connected socket.
+ * The session may be closed or killed if the input fails
+ * 
+ * INPUTS:
+ *    scb == session control block with input ready
+ *
+ * RETURNS:
+ *    status of the input operation
+ *********************************************************************/
+static status_t
+    read_session_input (ses_cb_t *scb)
+{
+    status_t   res;
+
+    res = ses_accept_input(scb);
+    if (res == NO_ERR) {
+        return NO_ERR;
+    }
+
+    if (res != ERR_NCX_SESSION_CLOSED) {
+        if (LOGINFO) {
+            log_info("\nagt_ncxserver: input failed"
+                     " for session %d (%s)",
+                     scb->sid, 
+                     get_error_string(res));
         }
+        /* send an error reply instead of
+         * killing the session right now
+         */
+        agt_rpc_send_error_reply(scb, res);
+        agt_ses_request_close(scb, 
+                              0, 
+                              SES_TR_OTHER);
     } else {
-        res = make_named_socket(ncxserver_sockname, &ncxsock);
-        if (res != NO_ERR) {
-            log_error("\n*** Cannot connect to ncxserver socket"
-                      "\n*** If no other instances of netconfd are running,"
-                      "\n*** try deleting %s\n",ncxserver_sockname);
-            return res;
-        }
+        /* connection already closed
+         * so kill session right now
+         */
+        agt_ses_kill_session(scb,
+                             scb->sid,
+                             SES_TR_DROPPED);
     }
-    profile = agt_get_profile();
-    if (profile == NULL) {
-        return SET_ERROR(ERR_INTERNAL_VAL);
+    return res;
+
+} /* read_session_input */
+
+
+/********************************************************************
+ * FUNCTION run_polling_callbacks
+ * 
+ * Run the periodic tasks when the event loop times out
+ *
+ * RETURNS:
+ *    TRUE if a suspended writer was dropped, so the requests
+ *         held back by it can be processed now
+ *    FALSE otherwise
+ *********************************************************************/
+static boolean
+    run_polling_callbacks (void)
+{
+    boolean  suspended;
+
+    /* !! put all polling callbacks here for now !! */
+    suspended = agt_ses_writer_suspended();
+    agt_ses_check_timeouts();
+
+    /* a suspended writer may be walking the datastores,
+     * so the timer callbacks wait until it is done
+     */
+    if (!agt_ses_writer_suspended()) {
+        agt_timer_handler();
     }
+    send_some_notifications();
 
-    stream_output = profile->agt_stream_output;
+    return (suspended && !agt_ses_writer_suspended()) ? TRUE : FALSE;
 
-    if (listen(ncxsock, 1) < 0) {
-        log_error("\nError: listen failed");
-        return ERR_NCX_OPERATION_FAILED;
+} /* run_polling_callbacks */
+
+
+/********************************************************************
+ * FUNCTION drain_ready_queue
+ * 
+ * Drain the ready queue before accepting new input
+ *
+ * RETURNS:
+ *    TRUE if a shutdown was requested; FALSE otherwise
+ *********************************************************************/
+static boolean
+    drain_ready_queue (void)
+{
+    while (agt_ses_process_first_ready()) {
+        if (agt_shutdown_requested()) {
+            return TRUE;
+        }
+        send_some_notifications();
     }
-     
+    return FALSE;
+
+} /* drain_ready_queue */
+
+
+/********************************************************************
+ * FUNCTION run_select_loop
+ * 
+ * select() based IO server loop for the ncxserver socket
+ * 
+ * INPUTS:
+ *    ncxsock == listening ncxserver socket
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+static status_t
+    run_select_loop (int ncxsock)
+{
+    ses_cb_t              *scb;
+    int                    maxwrnum, maxrdnum;
+    int                    i, ret;
+    struct timeval         timeout;
+    uint32                 msecs;
+    status_t               res;
+    boolean                done, done2;
+
     /* Initialize the set of active sockets. */
     FD_ZERO(&read_fd_set);
     FD_ZERO(&write_fd_set);
+    FD_ZERO(&wait_write_fd_set);
     FD_ZERO(&active_fd_set);
     FD_SET(ncxsock, &active_fd_set);
     maxwrnum = maxrdnum = ncxsock;
@@ -352,9 +534,11 @@ status_t
         done2 = FALSE;
         while (!done2) {
             read_fd_set = active_fd_set;
-            agt_ses_fill_writeset(&write_fd_set, &maxwrnum);
-            timeout.tv_sec = AGT_NCXSERVER_TIMEOUT;
-            timeout.tv_usec = 0;
+            agt_ses_fill_writeset(&wait_write_fd_set, &maxwrnum);
+            write_fd_set = wait_write_fd_set;
+            msecs = agt_timer_get_timeout(AGT_NCXSERVER_TIMEOUT * 1000);
+            timeout.tv_sec = msecs / 1000;
+            timeout.tv_usec = (msecs % 1000) * 1000;
 
             /* Block until input arrives on one or more active sockets. 
              * or the timer expires
@@ -374,11 +558,8 @@ status_t
                 /* should only happen if a timeout occurred */
                 if (agt_shutdown_requested()) {
                     done2 = TRUE; 
-                } else {
-                    /* !! put all polling callbacks here for now !! */
-                    agt_ses_check_timeouts();
-                    agt_timer_handler();
-                    send_some_notifications();
+                } else if (run_polling_callbacks()) {
+                    done2 = TRUE;
                 }
             } else {
                 /* normal return with some bytes */
@@ -394,7 +575,6 @@ status_t
 
         /* check select return status for non-recoverable error */
         if (ret < 0) {
-            res = ERR_NCX_OPERATION_FAILED;
             log_error("\nncxserver select failed (%s)", 
                       strerror(errno));
             agt_request_shutdown(NCX_SHUT_EXIT);
@@ -403,42 +583,16 @@ status_t
         }
      
         /* Service all the sockets with input and/or output pending */
-        done2 = FALSE;
-        for (i = 0; i < max(maxrdnum+1, maxwrnum+1) && !done2; i++) {
+        for (i = 0; i < max(maxrdnum+1, maxwrnum+1); i++) {
 
             /* check write output to client sessions */
-            if (!stream_output && FD_ISSET(i, &write_fd_set)) {
-                /* try to send 1 packet worth of buffers for a session */
+            if (FD_ISSET(i, &write_fd_set)) {
                 scb = def_reg_find_scb(i);
                 if (scb) {
-                    /* check if anything to write */
-                    if (!dlq_empty(&scb->outQ)) {
-                        res = ses_msg_send_buffs(scb);
-                        if (res != NO_ERR) {
-                            if (LOGINFO) {
-                                log_info("\nagt_ncxserver write failed; "
-                                         "closing session %d ", 
-                                         scb->sid);
-                            }
-                        }
-                        if (res != NO_ERR) {
-                            agt_ses_kill_session(scb, 
-                                                 scb->sid,
-                                                 SES_TR_OTHER);
-                            scb = NULL;
-                        } else if (scb->state == SES_ST_SHUTDOWN_REQ) {
-                            /* close-session reply sent, now kill ses */
-                            agt_ses_kill_session(scb, 
-                                                 scb->killedbysid,
-                                                 scb->termreason);
-                            scb = NULL;
-                        }
-                    }
-
-                    /* check if any buffers left over for next loop */
-                    if (scb && !dlq_empty(&scb->outQ)) {
-                        ses_msg_make_outready(scb);
-                    }
+                    scb = write_session_output(scb);
+                }
+                if (scb == NULL || dlq_empty(&scb->outQ)) {
+                    FD_CLR(i, &wait_write_fd_set);
                 }
             }
 
@@ -446,99 +600,369 @@ status_t
             if (FD_ISSET(i, &read_fd_set)) {
                 if (i == ncxsock) {
                     /* Connection request on original socket. */
-                    size = (socklen_t)sizeof(clientname);
-                    new = accept(ncxsock,
-                                 (struct sockaddr *)&clientname,
-                                 &size);
-                    if (new < 0) {
-                        if (LOGINFO) {
-                            log_info("\nagt_ncxserver accept "
-                                     "connection failed (%d)",
-                                     new);
-                        }
-                        continue;
-                    }
-
-                    /* get a new session control block */
-                    if (!agt_ses_new_session(SES_TRANSPORT_SSH, new)) {
-                        close(new);
-                        if (LOGINFO) {
-                            log_info("\nagt_ncxserver new "
-                                     "session failed (%d)", 
-                                     new);
-                        }
-                    } else {
-                        /* set non-blocking IO */
-                        if (fcntl(new, F_SETFD, O_NONBLOCK)) {
-                            if (LOGINFO) {
-                                log_info("\nfnctl failed");
-                            }
-                        }
-                        FD_SET(new, &active_fd_set);
-                        if (new > maxrdnum) {
-                            maxrdnum = new;
+                    scb = accept_new_session(ncxsock);
+                    if (scb != NULL) {
+                        FD_SET(scb->fd, &active_fd_set);
+                        if (scb->fd > maxrdnum) {
+                            maxrdnum = scb->fd;
                         }
                     }
                 } else {
-                    /* Data arriving on an already-connected socket.
-                     * Need to have the xmlreader for this session
-                     */
+                    /* Need to have the xmlreader for this session */
                     scb = def_reg_find_scb(i);
                     if (scb != NULL) {
-                        res = ses_accept_input(scb);
-                        if (res != NO_ERR) {
-                            if (i >= maxrdnum) {
-                                maxrdnum = i-1;
-                            }
-                            if (res != ERR_NCX_SESSION_CLOSED) {
-                                if (LOGINFO) {
-                                    log_info("\nagt_ncxserver: input failed"
-                                             " for session %d (%s)",
-                                             scb->sid, 
-                                             get_error_string(res));
-                                }
-                                /* send an error reply instead of
-                                 * killing the session right now
-                                 */
-                                agt_rpc_send_error_reply(scb, res);
-                                agt_ses_request_close(scb, 
-                                                      0, 
-                                                      SES_TR_OTHER);
-                            } else {
-                                /* connection already closed
-                                 * so kill session right now
-                                 */
-                                agt_ses_kill_session(scb,
-                                                     scb->sid,
-                                                     SES_TR_DROPPED);
-                            }
+                        res = read_session_input(scb);
+                        if (res != NO_ERR && i >= maxrdnum) {
+                            maxrdnum = i-1;
                         }
                     }
                 }
             }
         }
 
+        /* a busy loop may never time out, so check the timers
+         * and the session timeouts on every pass; this is done
+         * first so the requests held back by a writer dropped
+         * for a write timeout are not left in the ready queue
+         */
+        if (!agt_ses_writer_suspended()) {
+            agt_timer_handler();
+        }
+        agt_ses_check_timeouts();
+
         /* drain the ready queue before accepting new input */
-        if (!done) {
-            done2 = FALSE;
-            while (!done2) {
-                if (!agt_ses_process_first_ready()) {
+        if (drain_ready_queue()) {
+            done = TRUE;
+        }
+    }  /* end select loop */
+
+    return NO_ERR;
+
+}  /* run_select_loop */
+
+
+#ifdef AGT_NCXSERVER_EPOLL
+/********************************************************************
+ * FUNCTION epoll_set_session
+ * 
+ * Add or modify the epoll registration for a session
+ * The session control block is stored in the event data
+ * so no FD lookup is needed when the event is dispatched
+ * 
+ * INPUTS:
+ *    scb == session control block to register
+ *    op == EPOLL_CTL_ADD or EPOLL_CTL_MOD
+ *    outwait == TRUE if write readiness is also requested
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+static status_t
+    epoll_set_session (ses_cb_t *scb,
+                       int op,
+                       boolean outwait)
+{
+    struct epoll_event  ev;
+
+    memset(&ev, 0x0, sizeof(ev));
+    ev.events = EPOLLIN;
+    if (outwait) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.ptr = scb;
+
+    if (epoll_ctl(epoll_fd, op, scb->fd, &ev) != 0) {
+        log_error("\nError: epoll_ctl failed for session %d (%s)",
+                  scb->sid,
+                  strerror(errno));
+        return ERR_NCX_OPERATION_FAILED;
+    }
+    scb->outwait = outwait;
+    return NO_ERR;
+
+}  /* epoll_set_session */
+
+
+/********************************************************************
+ * FUNCTION epoll_fill_writeset
+ * 
+ * Drain the outreadyQ and request write readiness
+ * for each session with output pending
+ *********************************************************************/
+static void
+    epoll_fill_writeset (void)
+{
+    ses_cb_t  *scb;
+
+    for (scb = agt_ses_get_first_outready();
+         scb != NULL;
+         scb = agt_ses_get_first_outready()) {
+        if (!scb->outwait) {
+            (void)epoll_set_session(scb, EPOLL_CTL_MOD, TRUE);
+        }
+    }
+
+}  /* epoll_fill_writeset */
+
+
+/********************************************************************
+ * FUNCTION run_epoll_loop
+ * 
+ * epoll() based IO server loop for the ncxserver socket
+ * Only sessions with IO pending are visited on each pass
+ * 
+ * INPUTS:
+ *    ncxsock == listening ncxserver socket
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+static status_t
+    run_epoll_loop (int ncxsock)
+{
+    ses_cb_t              *scb;
+    struct epoll_event     ev;
+    uint32                 events;
+    int                    ret;
+    boolean                done, done2;
+
+    epoll_fd = epoll_create(AGT_NCXSERVER_MAX_EVENTS);
+    if (epoll_fd < 0) {
+        log_error("\nError: epoll_create failed (%s)",
+                  strerror(errno));
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    /* the listen socket is the only entry with no session */
+    memset(&ev, 0x0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ncxsock, &ev) != 0) {
+        log_error("\nError: epoll_ctl failed for ncxserver socket (%s)",
+                  strerror(errno));
+        close(epoll_fd);
+        epoll_fd = -1;
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    done = FALSE;
+    while (!done) {
+
+        /* check exit program */
+        if (agt_shutdown_requested()) {
+            done = TRUE;
+            continue;
+        }
+
+        ret = 0;
+        done2 = FALSE;
+        while (!done2) {
+            epoll_fill_writeset();
+
+            /* Block until IO is ready on one or more sessions
+             * or the timer expires
+             */
+            ret = epoll_wait(epoll_fd,
+                             epoll_events,
+                             AGT_NCXSERVER_MAX_EVENTS,
+                             (int)agt_timer_get_timeout
+                             (AGT_NCXSERVER_TIMEOUT * 1000));
+            if (ret > 0) {
+                done2 = TRUE;
+            } else if (ret < 0) {
+                if (!(errno == EINTR || errno==EAGAIN)) {
                     done2 = TRUE;
-                } else if (agt_shutdown_requested()) {
-                    done = done2 = TRUE;
-                } else {
-                    send_some_notifications();
                 }
+            } else if (agt_shutdown_requested()) {
+                done2 = TRUE; 
+            } else if (run_polling_callbacks()) {
+                done2 = TRUE;
             }
         }
-    }  /* end select loop */
+
+        /* check exit program */
+        if (agt_shutdown_requested()) {
+            done = TRUE;
+            continue;
+        }
+
+        /* check epoll return status for non-recoverable error */
+        if (ret < 0) {
+            log_error("\nncxserver epoll_wait failed (%s)", 
+                      strerror(errno));
+            agt_request_shutdown(NCX_SHUT_EXIT);
+            done = TRUE;
+            continue;
+        }
+
+        /* Service only the sockets with input and/or output pending;
+         * agt_ncxserver_clear_fd will cancel any events in this
+         * batch for a session that gets freed along the way
+         */
+        epoll_numevents = ret;
+        for (epoll_curevent = 0;
+             epoll_curevent < epoll_numevents;
+             epoll_curevent++) {
+
+            events = epoll_events[epoll_curevent].events;
+            scb = (ses_cb_t *)epoll_events[epoll_curevent].data.ptr;
+
+            if (events == 0) {
+                /* session was freed earlier in this batch */
+                continue;
+            }
+
+            if (scb == NULL) {
+                /* Connection request on original socket. */
+                scb = accept_new_session(ncxsock);
+                if (scb != NULL &&
+                    epoll_set_session(scb, EPOLL_CTL_ADD, FALSE) != NO_ERR) {
+                    agt_ses_kill_session(scb, scb->sid, SES_TR_OTHER);
+                }
+                continue;
+            }
+
+            /* check write output to client sessions */
+            if (events & EPOLLOUT) {
+                scb = write_session_output(scb);
+                if (scb != NULL && scb->outwait &&
+                    dlq_empty(&scb->outQ)) {
+                    (void)epoll_set_session(scb, EPOLL_CTL_MOD, FALSE);
+                }
+            }
+
+            /* check read input from client sessions */
+            if (scb != NULL && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                (void)read_session_input(scb);
+            }
+        }
+        epoll_numevents = 0;
+        epoll_curevent = 0;
+
+        /* a busy loop may never time out, so check the timers
+         * and the session timeouts on every pass; this is done
+         * first so the requests held back by a writer dropped
+         * for a write timeout are not left in the ready queue
+         */
+        if (!agt_ses_writer_suspended()) {
+            agt_timer_handler();
+        }
+        agt_ses_check_timeouts();
+
+        /* drain the ready queue before accepting new input */
+        if (drain_ready_queue()) {
+            done = TRUE;
+        }
+    }  /* end epoll loop */
+
+    close(epoll_fd);
+    epoll_fd = -1;
+    return NO_ERR;
+
+}  /* run_epoll_loop */
+#endif  /* AGT_NCXSERVER_EPOLL */
+
+
+/***********     E X P O R T E D   F U N C T I O N S   *************/
+
+
+/********************************************************************
+ * FUNCTION agt_ncxserver_run
+ * 
+ * IO server loop for the ncxserver socket
+ * 
+ * RETURNS:
+ *   status
+ *********************************************************************/
+status_t
+    agt_ncxserver_run (void)
+{
+    agt_profile_t         *profile;
+    int                    ncxsock;
+    status_t               res;
+    char*                  tcp_direct_address = NULL;
+    int                    tcp_direct_port = -1;
+    char*                  ncxserver_sockname;
+    val_value_t            *clivalset;
+    val_value_t            *val;
+
+    /* Create the socket and set it up to accept connections. */
+    clivalset = agt_cli_get_valset();
+    if (clivalset) {
+
+        val = val_find_child(clivalset,
+                             NCXMOD_NETCONFD,
+                             NCX_EL_TCP_DIRECT_PORT);
+        if(val != NULL) {
+            tcp_direct_port = VAL_INT(val);
+        }
+
+        val = val_find_child(clivalset,
+                             NCXMOD_NETCONFD,
+                             NCX_EL_TCP_DIRECT_ADDRESS);
+        if(val != NULL) {
+            tcp_direct_address = VAL_STR(val);
+            if(tcp_direct_port==-1) tcp_direct_port = 2023;
+        }
+
+        val = val_find_child(clivalset,
+                             NCXMOD_NETCONFD,
+                             NCX_EL_NCXSERVER_SOCKNAME);
+        if(val != NULL) {
+            ncxserver_sockname = VAL_STR(val);
+        } else {
+            ncxserver_sockname = NCXSERVER_SOCKNAME;
+        }
+
+    } else {
+            log_error("\n*** agt_ncxserver_run:agt_cli_get_valset failed.\n");
+            return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+    if(tcp_direct_port!=-1) {
+        res = make_tcp_socket(tcp_direct_address, tcp_direct_port, &ncxsock);
+        if (res != NO_ERR) {
+            log_error("\n*** Cannot connect to ncxserver socket listen tcp port: %d\n",tcp_direct_port);
+            return res;
+        }
+    } else {
+        res = make_named_socket(ncxserver_sockname, &ncxsock);
+        if (res != NO_ERR) {
+            log_error("\n*** Cannot connect to ncxserver socket"
+                      "\n*** If no other instances of netconfd are running,"
+                      "\n*** try deleting %s\n",ncxserver_sockname);
+            return res;
+        }
+    }
+    profile = agt_get_profile();
+    if (profile == NULL) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+
+    if (listen(ncxsock, 1) < 0) {
+        log_error("\nError: listen failed");
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    if (profile->agt_event_loop == AGT_EVLOOP_EPOLL) {
+#ifdef AGT_NCXSERVER_EPOLL
+        res = run_epoll_loop(ncxsock);
+#else
+        log_warn("\nWarning: epoll not supported; using select loop");
+        res = run_select_loop(ncxsock);
+#endif
+    } else {
+        res = run_select_loop(ncxsock);
+    }
+
+    /* finish any suspended reply while the datastores are still there */
+    agt_ses_stop_writer();
 
     /* all open client sockets will be closed as the sessions are
      * torn down, but the original ncxserver socket needs to be closed now
      */
     close(ncxsock);
     unlink(NCXSERVER_SOCKNAME);
-    return NO_ERR;
+    return res;
 
 }  /* agt_ncxserver_run */
 
@@ -546,7 +970,7 @@ status_t
 /********************************************************************
  * FUNCTION agt_ncxserver_clear_fd
  * 
- * Clear a dead session from the select loop
+ * Clear a dead session from the select or epoll loop
  * 
  * INPUTS:
  *   fd == file descriptor number for the socket to clear
@@ -554,12 +978,34 @@ status_t
 void
     agt_ncxserver_clear_fd (int fd)
 {
+#ifdef AGT_NCXSERVER_EPOLL
+    struct epoll_event  ev;
+    ses_cb_t           *scb;
+    int                 i;
+
+    if (epoll_fd >= 0) {
+        /* the ev parameter is ignored but must be non-NULL
+         * for kernels before 2.6.9
+         */
+        memset(&ev, 0x0, sizeof(ev));
+        (void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+
+        /* cancel any events still pending in the current batch */
+        for (i = epoll_curevent + 1; i < epoll_numevents; i++) {
+            scb = (ses_cb_t *)epoll_events[i].data.ptr;
+            if (epoll_events[i].events != 0 &&
+                scb != NULL && scb->fd == fd) {
+                epoll_events[i].events = 0;
+            }
+        }
+        return;
+    }
+#endif
+
     FD_CLR(fd, &active_fd_set);
+    FD_CLR(fd, &wait_write_fd_set);
 
 } /* agt_ncxserver_clear_fd */
 
 
 /* END agt_ncxserver.c */
-
-
-
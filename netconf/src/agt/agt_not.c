@@ -896,7 +896,7 @@ static status_t
                      {
                         //get path
                         memset(pathoriginal,0,MAX_PATH);
-                        strcat(pathoriginal,(char*)curchild1->xpathpcb->exprstr);
+                        strcat(pathoriginal,(char*)curchild1->extra->xpathpcb->exprstr);
                         haspath |= make_path_to_list(&useval,pathoriginal);
                      }
               }
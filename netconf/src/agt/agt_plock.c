@@ -156,7 +156,7 @@ static status_t
      */
     while (select_val != NULL) {
         result = xpath1_eval_xmlexpr(scb->reader,
-                                     select_val->xpathpcb,
+                                     VAL_XPATHPCB(select_val),
                                      running->root,
                                      running->root,
                                      FALSE,  /* logerrors */
@@ -199,9 +199,9 @@ static status_t
              * transfer the memory straight across
              */
             plock_add_select(plcb, 
-                             select_val->xpathpcb,
+                             select_val->extra->xpathpcb,
                              result);
-            select_val->xpathpcb = NULL;
+            select_val->extra->xpathpcb = NULL;
             result = NULL;
         }
 
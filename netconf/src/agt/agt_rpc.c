@@ -54,6 +54,7 @@ date         init     comment
 #include "rpc.h"
 #include "rpc_err.h"
 #include "ses.h"
+#include "ses_msg.h"
 #include "status.h"
 #include "top.h"
 #include "val.h"
@@ -81,7 +82,18 @@ date         init     comment
 *                           T Y P E S                               *
 *                                                                   *
 *********************************************************************/
-    
+
+/* RPC whose reply writer has been suspended, because the
+ * client has not read enough of the reply yet; the rest of
+ * the RPC is done by agt_rpc_finish_reply after the reply
+ */
+typedef struct agt_rpc_pending_t_ {
+    ses_cb_t            *scb;
+    rpc_msg_t           *msg;
+    agt_rpc_cbset_t     *cbset;
+    xml_node_t           method;
+} agt_rpc_pending_t;
+
 
 /********************************************************************
 *                                                                   *
@@ -90,6 +102,11 @@ date         init     comment
 *********************************************************************/
 static boolean agt_rpc_init_done = FALSE;
 
+/* ses_msg only has 1 reply writer at a time, so there
+ * is at most 1 suspended reply; msg is NULL if none
+ */
+static agt_rpc_pending_t pending_reply;
+
 
 /********************************************************************
 * FUNCTION free_msg
@@ -699,6 +716,79 @@ static void
 }  /* send_rpc_reply */
 
 
+/********************************************************************
+* FUNCTION write_rpc_reply
+*
+* Writer function for ses_msg_run_writer
+* Generate the <rpc-reply> for an RPC; this can be suspended
+* until the client reads more of the output
+* 
+* INPUTS:
+*   scb == session control block
+*   cookie == rpc_msg_t in progress
+*
+*********************************************************************/
+static void
+    write_rpc_reply (ses_cb_t *scb,
+                     void *cookie)
+{
+    send_rpc_reply(scb, (rpc_msg_t *)cookie);
+
+}  /* write_rpc_reply */
+
+
+/********************************************************************
+* FUNCTION finish_rpc
+*
+* Finish an RPC after its <rpc-reply> has been written
+* Run the post-reply callback and free the message
+* 
+* INPUTS:
+*   scb == session control block
+*   msg == rpc_msg_t in progress; freed before exit
+*   cbset == callback set for the RPC method; may be NULL
+*   method == RPC method node; cleaned before exit
+*
+*********************************************************************/
+static void
+    finish_rpc (ses_cb_t *scb,
+                rpc_msg_t *msg,
+                agt_rpc_cbset_t *cbset,
+                xml_node_t *method)
+{
+    /* check if there is a post-reply callback;
+     * call even if the RPC failed
+     */
+    if (cbset && cbset->acb[AGT_RPC_PH_POST_REPLY]) {
+        msg->rpc_agt_state = AGT_RPC_PH_POST_REPLY;
+        (void)(*cbset->acb[AGT_RPC_PH_POST_REPLY])(scb, msg, method);
+    }
+
+    /* check if there is any auditQ because changes to 
+     * the running config were made
+     */
+    if (msg->rpc_txcb && !dlq_empty(&msg->rpc_txcb->auditQ)) {
+        agt_sys_send_sysConfigChange(scb, &msg->rpc_txcb->auditQ);
+    }
+
+    /* only reset the session state to idle if was not changed
+     * to SES_ST_SHUTDOWN_REQ during this RPC call
+     */
+    if (scb->state == SES_ST_IN_MSG) {
+        scb->state = SES_ST_IDLE;
+    }
+
+    /* cleanup and exit */
+    xml_clean_node(method);
+    agt_acm_clear_msg_cache(&msg->mhdr);
+    free_msg(msg,(gTxcb==NULL));
+
+    print_errors();
+    clear_errors();
+
+}  /* finish_rpc */
+
+
 /********************************************************************
 * FUNCTION find_rpc
 *
@@ -729,6 +819,34 @@ static obj_template_t *
 }  /* find_rpc */
 
 
+/********************************************************************
+* FUNCTION input_arena
+*
+* Get the arena to use for the input parameters of an RPC
+*
+* INPUTS:
+*   msg == rpc_msg_t in progress; rpc_method must be set
+*
+* RETURNS:
+*   pointer to msg->rpc_arena if the method allows it, else NULL
+*********************************************************************/
+static ncx_arena_t *
+    input_arena (rpc_msg_t *msg)
+{
+    obj_template_t   *rpcobj = msg->rpc_method;
+    agt_rpc_cbset_t  *cbset;
+
+    if (rpcobj && rpcobj->cbset) {
+        cbset = (agt_rpc_cbset_t *)rpcobj->cbset;
+        if (cbset->input_arena) {
+            return &msg->rpc_arena;
+        }
+    }
+    return NULL;
+
+}  /* input_arena */
+
+
 /********************************************************************
 * FUNCTION parse_rpc_input
 *
@@ -758,8 +876,10 @@ static status_t
     obj = obj_find_template(obj_get_datadefQ(rpcobj), NULL, YANG_K_INPUT);
     if (obj && obj_get_child_count(obj)) {
         msg->rpc_agt_state = AGT_RPC_PH_PARSE;
+        msg->mhdr.valarena = input_arena(msg);
         res = agt_val_parse_nc(scb, &msg->mhdr, obj, method, NCX_DC_CONFIG, 
                                msg->rpc_input);
+        msg->mhdr.valarena = NULL;
 
         if (LOGDEBUG3) {
             log_debug3("\nagt_rpc: parse RPC input state");
@@ -792,7 +912,7 @@ static status_t
                     rpc_msg_t  *msg,
                     status_t  psdres)
 {
-    status_t  res;
+    status_t      res;
 
     res = NO_ERR;
 
@@ -994,8 +1114,10 @@ static status_t
     }
 
     /* call all the object validate callbacks
-     * but only if there were no parse errors so far
+     * but only if there were no parse errors so far;
+     * sibling sets are kept until the invoke phase is done
      */
+    val_begin_sibset_pass();
     boolean valdone = FALSE;
     if (res == NO_ERR && cbset->acb[AGT_RPC_PH_VALIDATE]) {
         msg->rpc_agt_state = AGT_RPC_PH_VALIDATE;
@@ -1038,6 +1160,7 @@ static status_t
             retres = res;
         }
     }
+    val_end_sibset_pass();
 
     if (LOGDEBUG) {
         if (!dlq_empty(&msg->mhdr.errQ)) {
@@ -1237,6 +1360,51 @@ void
 } /* agt_rpc_unsupport_method */
 
 
+/********************************************************************
+* FUNCTION agt_rpc_set_input_arena
+*
+* Allow the input parameters of an RPC method to be allocated
+* from the per-message arena, which is released in one step
+* when the message is freed.
+*
+* Only use for methods whose callbacks never keep any node of
+* msg->rpc_input past the end of the message; a node that has
+* to be kept must be replaced by val_clone_arena_value first.
+* The method must already be registered.
+*
+* INPUTS:
+*    module == module name of RPC method (really module name)
+*    method_name == RPC method name
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+status_t
+    agt_rpc_set_input_arena (const xmlChar *module,
+                             const xmlChar *method_name)
+{
+    obj_template_t  *rpcobj;
+    agt_rpc_cbset_t *cbset;
+
+#ifdef DEBUG
+    if (!module || !method_name) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    /* find the RPC template */
+    rpcobj = find_rpc(module, method_name);
+    if (!rpcobj || !rpcobj->cbset) {
+        return SET_ERROR(ERR_NCX_DEF_NOT_FOUND);
+    }
+
+    cbset = (agt_rpc_cbset_t *)rpcobj->cbset;
+    cbset->input_arena = TRUE;
+    return NO_ERR;
+
+} /* agt_rpc_set_input_arena */
+
+
 /********************************************************************
 * FUNCTION agt_rpc_unregister_method
 *
@@ -1601,7 +1769,10 @@ void
         }
     }
 
-    /* validate state */
+    /* validate state; sibling sets are kept
+     * until the invoke phase is done
+     */
+    val_begin_sibset_pass();
     if ((res==NO_ERR) && (cbset && cbset->acb[AGT_RPC_PH_VALIDATE])) {
         /* input passes the basic YANG schema tests at this point;
          * check if there is a validate callback for
@@ -1654,6 +1825,7 @@ void
             }
         }
     }
+    val_end_sibset_pass();
 
 
     /* make sure the prefix map is correct for report-all-tagged mode
@@ -1666,39 +1838,59 @@ void
 
     /* always send an <rpc-reply> element in response to an <rpc> */
     msg->rpc_agt_state = AGT_RPC_PH_REPLY;
-    send_rpc_reply(scb, msg);
-
-    /* check if there is a post-reply callback;
-     * call even if the RPC failed
-     */
-    if (cbset && cbset->acb[AGT_RPC_PH_POST_REPLY]) {
-        msg->rpc_agt_state = AGT_RPC_PH_POST_REPLY;
-        (void)(*cbset->acb[AGT_RPC_PH_POST_REPLY])(scb, msg, &method);
+    res = ses_msg_run_writer(scb, write_rpc_reply, msg);
+    if (res == ERR_NCX_SUSPENDED) {
+        /* the rest of the reply is written as the client reads
+         * it; keep the RPC until then, moving the method node
+         * and its attribute Q into pending_reply
+         */
+        pending_reply.scb = scb;
+        pending_reply.msg = msg;
+        pending_reply.cbset = cbset;
+        pending_reply.method = method;
+        dlq_createSQue(&pending_reply.method.attrs);
+        dlq_block_enque(&method.attrs, &pending_reply.method.attrs);
+        return;
     }
 
-    /* check if there is any auditQ because changes to 
-     * the running config were made
-     */
-    if (msg->rpc_txcb && !dlq_empty(&msg->rpc_txcb->auditQ)) {
-        agt_sys_send_sysConfigChange(scb, &msg->rpc_txcb->auditQ);
+    finish_rpc(scb, msg, cbset, &method);
+
+} /* agt_rpc_dispatch */
+
+
+/********************************************************************
+* FUNCTION agt_rpc_finish_reply
+*
+* Finish the RPC for a session after its suspended reply
+* writer is done; called by agt_ses
+*
+* INPUTS:
+*   scb == session control block
+*********************************************************************/
+void
+    agt_rpc_finish_reply (ses_cb_t *scb)
+{
+    agt_rpc_pending_t  pending;
+
+#ifdef DEBUG
+    if (!scb) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
     }
+#endif
 
-    /* only reset the session state to idle if was not changed
-     * to SES_ST_SHUTDOWN_REQ during this RPC call
-     */
-    if (scb->state == SES_ST_IN_MSG) {
-        scb->state = SES_ST_IDLE;
+    if (pending_reply.msg == NULL || pending_reply.scb != scb) {
+        return;
     }
 
-    /* cleanup and exit */
-    xml_clean_node(&method);
-    agt_acm_clear_msg_cache(&msg->mhdr);
-    free_msg(msg,(gTxcb==NULL));
+    pending = pending_reply;
+    dlq_createSQue(&pending.method.attrs);
+    dlq_block_enque(&pending_reply.method.attrs, &pending.method.attrs);
+    memset(&pending_reply, 0x0, sizeof(agt_rpc_pending_t));
 
-    print_errors();
-    clear_errors();
+    finish_rpc(scb, pending.msg, pending.cbset, &pending.method);
 
-} /* agt_rpc_dispatch */
+} /* agt_rpc_finish_reply */
 
 
 /********************************************************************
@@ -109,6 +109,7 @@ typedef status_t
 
 typedef struct agt_rpc_cbset_t_ {
     agt_rpc_method_t  acb[AGT_RPC_NUM_PHASES];
+    boolean           input_arena;  /* see agt_rpc_set_input_arena */
 } agt_rpc_cbset_t;
 
 
@@ -218,6 +219,30 @@ extern void
 			      const xmlChar *method_name);
 
 
+/********************************************************************
+* FUNCTION agt_rpc_set_input_arena
+*
+* Allow the input parameters of an RPC method to be allocated
+* from the per-message arena, which is released in one step
+* when the message is freed.
+*
+* Only use for methods whose callbacks never keep any node of
+* msg->rpc_input past the end of the message; a node that has
+* to be kept must be replaced by val_clone_arena_value first.
+* The method must already be registered.
+*
+* INPUTS:
+*    module == module name of RPC method (really module name)
+*    method_name == RPC method name
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+extern status_t
+    agt_rpc_set_input_arena (const xmlChar *module,
+			     const xmlChar *method_name);
+
+
 /********************************************************************
 * FUNCTION agt_rpc_unregister_method
 *
@@ -249,6 +274,19 @@ extern void
     agt_rpc_dispatch (ses_cb_t  *scb,
 		      xml_node_t *top);
 
+
+/********************************************************************
+* FUNCTION agt_rpc_finish_reply
+*
+* Finish the RPC for a session after its suspended reply
+* writer is done; called by agt_ses
+*
+* INPUTS:
+*   scb == session control block
+*********************************************************************/
+extern void
+    agt_rpc_finish_reply (ses_cb_t *scb);
+
 /********************************************************************
 * FUNCTION agt_rpc_load_config_file
 *
@@ -21,6 +21,7 @@
 date         init     comment
 ----------------------------------------------------------------------
 06jun06      abb      begun; cloned from ses_mgr.c
+16oct26      agt      free slot FIFO and timeout deadline heap
 
 *********************************************************************
 *                                                                   *
@@ -92,16 +93,270 @@ date         init     comment
 
 static boolean    agt_ses_init_done = FALSE;
 
-static uint32     next_sesid;
-
 static ses_cb_t  **agtses;
 
+/* FIFO ring of free session slots; a freed slot is not
+ * reused until all the other free slots have been used
+ */
+static ses_id_t  *free_slots;
+
+static uint32     free_head;
+
+static uint32     free_count;
+
+/* min-heap of session slots ordered by hello/idle deadline
+ * tmo_pos and tmo_deadline are indexed by slot
+ */
+static ses_id_t  *tmo_heap;
+
+static uint32     tmo_count;
+
+static uint32    *tmo_pos;
+
+static time_t    *tmo_deadline;
+
 static ses_total_stats_t *agttotals;
 
 static ncx_module_t *mysesmod;
 
 static time_t     last_timeout_check;
 
+/* session whose reply writer is suspended, waiting for the
+ * client to read its output; the reply may still be walking
+ * a datastore, so no other request is processed until then
+ */
+static ses_cb_t   *writer_scb;
+
+/* TRUE if writer_scb has to be freed when its writer is done */
+static boolean     writer_freed;
+
+/********************************************************************
+* FUNCTION put_free_slot
+*
+* Add a session slot to the end of the free slot FIFO
+*
+* INPUTS:
+*    slot == session slot to free
+*********************************************************************/
+static void
+    put_free_slot (ses_id_t slot)
+{
+    agt_profile_t   *agt_profile;
+    uint32           cap;
+
+    agt_profile = agt_get_profile();
+    cap = agt_profile->agt_max_sessions - 1;
+
+    if (free_count >= cap) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return;
+    }
+    free_slots[(free_head + free_count) % cap] = slot;
+    free_count++;
+
+}  /* put_free_slot */
+
+
+/********************************************************************
+* FUNCTION get_free_slot
+*
+* Remove the first session slot from the free slot FIFO
+*
+* RETURNS:
+*    free session slot, or 0 if none available
+*********************************************************************/
+static ses_id_t
+    get_free_slot (void)
+{
+    agt_profile_t   *agt_profile;
+    ses_id_t         slot;
+
+    if (free_count == 0) {
+        return 0;
+    }
+
+    agt_profile = agt_get_profile();
+    slot = free_slots[free_head];
+    free_head = (free_head + 1) % (agt_profile->agt_max_sessions - 1);
+    free_count--;
+    return slot;
+
+}  /* get_free_slot */
+
+
+/********************************************************************
+* FUNCTION tmo_swap
+*
+* Swap 2 entries in the timeout heap
+*
+* INPUTS:
+*    i == index of the 1st entry
+*    j == index of the 2nd entry
+*********************************************************************/
+static void
+    tmo_swap (uint32 i,
+              uint32 j)
+{
+    ses_id_t  slot;
+
+    slot = tmo_heap[i];
+    tmo_heap[i] = tmo_heap[j];
+    tmo_heap[j] = slot;
+    tmo_pos[tmo_heap[i]] = i;
+    tmo_pos[tmo_heap[j]] = j;
+
+}  /* tmo_swap */
+
+
+/********************************************************************
+* FUNCTION tmo_fix
+*
+* Move a timeout heap entry up or down after its deadline changed
+*
+* INPUTS:
+*    idx == index of the entry to move
+*********************************************************************/
+static void
+    tmo_fix (uint32 idx)
+{
+    uint32  parent, child;
+
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (tmo_deadline[tmo_heap[parent]] <= 
+            tmo_deadline[tmo_heap[idx]]) {
+            break;
+        }
+        tmo_swap(idx, parent);
+        idx = parent;
+    }
+
+    for (;;) {
+        child = 2 * idx + 1;
+        if (child >= tmo_count) {
+            break;
+        }
+        if (child + 1 < tmo_count &&
+            tmo_deadline[tmo_heap[child + 1]] < 
+            tmo_deadline[tmo_heap[child]]) {
+            child++;
+        }
+        if (tmo_deadline[tmo_heap[idx]] <= 
+            tmo_deadline[tmo_heap[child]]) {
+            break;
+        }
+        tmo_swap(idx, child);
+        idx = child;
+    }
+
+}  /* tmo_fix */
+
+
+/********************************************************************
+* FUNCTION tmo_add
+*
+* Add a session slot to the timeout heap
+*
+* INPUTS:
+*    slot == session slot to add
+*    deadline == first time to check the session
+*********************************************************************/
+static void
+    tmo_add (ses_id_t slot,
+             time_t deadline)
+{
+    tmo_deadline[slot] = deadline;
+    tmo_pos[slot] = tmo_count;
+    tmo_heap[tmo_count++] = slot;
+    tmo_fix(tmo_pos[slot]);
+
+}  /* tmo_add */
+
+
+/********************************************************************
+* FUNCTION tmo_remove
+*
+* Remove a session slot from the timeout heap
+*
+* INPUTS:
+*    slot == session slot to remove
+*********************************************************************/
+static void
+    tmo_remove (ses_id_t slot)
+{
+    uint32  idx;
+
+    idx = tmo_pos[slot];
+    if (idx >= tmo_count || tmo_heap[idx] != slot) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return;
+    }
+
+    tmo_count--;
+    if (idx != tmo_count) {
+        tmo_heap[idx] = tmo_heap[tmo_count];
+        tmo_pos[tmo_heap[idx]] = idx;
+        tmo_fix(idx);
+    }
+
+}  /* tmo_remove */
+
+
+/********************************************************************
+* FUNCTION get_session_deadline
+*
+* Get the time the hello or idle timeout expires for a session
+* The deadline is computed from the session state each time, 
+* so activity on the session does not need to update the heap
+*
+* A session that is not subject to either timeout right now
+* is checked again after 1 timeout interval
+*
+* INPUTS:
+*    scb == session control block to check
+*    timenow == current uptime
+*
+* RETURNS:
+*    deadline for the session
+*********************************************************************/
+static time_t
+    get_session_deadline (const ses_cb_t *scb,
+                          time_t timenow)
+{
+    agt_profile_t    *agt_profile;
+
+    agt_profile = agt_get_profile();
+
+    /* check if the the hello timer needs to be tested */
+    if (agt_profile->agt_hello_timeout > 0 &&
+        scb->state == SES_ST_HELLO_WAIT) {
+        return scb->hello_time + (time_t)agt_profile->agt_hello_timeout;
+    }
+
+    /* check if the the idle timer needs to be tested
+     * check only active sessions
+     * skip if notifications are active
+     */
+    if (agt_profile->agt_idle_timeout > 0 &&
+        scb->active &&
+        !scb->notif_active &&
+        (strcmp((const char*)scb->peeraddr,"127.0.0.1")!=0)) {
+        return scb->last_rpc_time + (time_t)agt_profile->agt_idle_timeout;
+    }
+
+    /* not subject to a timeout right now; a new session
+     * waiting for the ncx-connect message gets rechecked
+     * when its hello timeout could first expire
+     */
+    if ((agt_profile->agt_hello_timeout > 0 && !scb->active) ||
+        agt_profile->agt_idle_timeout == 0) {
+        return timenow + (time_t)agt_profile->agt_hello_timeout;
+    }
+    return timenow + (time_t)agt_profile->agt_idle_timeout;
+
+}  /* get_session_deadline */
+
+
 /********************************************************************
 * FUNCTION get_session_idval
 *
@@ -287,7 +542,25 @@ status_t
     for (i=0; i<agt_profile->agt_max_sessions; i++) {
         agtses[i] = NULL;
     }
-    next_sesid = 1;
+
+    /* slot 0 is never used for a real session */
+    free_slots = (ses_id_t *)
+        malloc((agt_profile->agt_max_sessions - 1) * sizeof(ses_id_t));
+    tmo_heap = (ses_id_t *)
+        malloc(agt_profile->agt_max_sessions * sizeof(ses_id_t));
+    tmo_pos = (uint32 *)
+        malloc(agt_profile->agt_max_sessions * sizeof(uint32));
+    tmo_deadline = (time_t *)
+        malloc(agt_profile->agt_max_sessions * sizeof(time_t));
+    assert(free_slots != NULL && tmo_heap != NULL && 
+           tmo_pos != NULL && tmo_deadline != NULL);
+
+    free_head = 0;
+    free_count = 0;
+    tmo_count = 0;
+    for (i=1; i<agt_profile->agt_max_sessions; i++) {
+        put_free_slot(i);
+    }
     mysesmod = NULL;
 
     agttotals = ses_get_total_stats();
@@ -353,8 +626,12 @@ void
         }
 
         free(agtses);
-
-        next_sesid = 0;
+        free(free_slots);
+        free(tmo_heap);
+        free(tmo_pos);
+        free(tmo_deadline);
+        free_count = 0;
+        tmo_count = 0;
 
         agt_rpc_unregister_method(AGT_SES_MODULE,
                                   AGT_SES_GET_MY_SESSION);
@@ -531,9 +808,10 @@ ses_cb_t *
                          int fd)
 {
     ses_cb_t       *scb;
-    uint32          i, slot;
+    uint32          slot;
     status_t        res;
     agt_profile_t   *agt_profile;
+    time_t          timenow;
 
     agt_profile = agt_get_profile();
 
@@ -546,19 +824,7 @@ ses_cb_t *
     scb = NULL;
 
     /* check if any sessions are available */
-    if (next_sesid == 0) {
-        /* end has already been reached, so now in brute force
-         * session reclaim mode
-         */
-        slot = 0;
-        for (i=1; i<agt_profile->agt_max_sessions && !slot; i++) {
-            if (!agtses[i]) {
-                slot = i;
-            }
-        }
-    } else {
-        slot = next_sesid;
-    }
+    slot = get_free_slot();
 
     if (slot) {
         /* make sure there is memory for a session control block */
@@ -587,7 +853,7 @@ ses_cb_t *
             scb->state = SES_ST_INIT;
             scb->fd = fd;
             scb->instate = SES_INST_IDLE;
-            scb->stream_output = TRUE;
+            scb->stream_output = agt_profile->agt_stream_output;
             res = ses_msg_new_buff(scb, TRUE, &scb->outbuff);
         } else {
             res = ERR_INTERNAL_MEM;
@@ -605,13 +871,13 @@ ses_cb_t *
     if (res == NO_ERR) {
         agtses[slot] = scb;
 
-        /* update the next slot now */
-        if (next_sesid) {
-            if (++next_sesid==agt_profile->agt_max_sessions) {
-                /* reached the end */
-                next_sesid = 0;
-            }
+        /* start checking the hello timeout */
+        if (agt_profile->agt_idle_timeout > 0 ||
+            agt_profile->agt_hello_timeout > 0) {
+            (void)uptime(&timenow);
+            tmo_add(slot, get_session_deadline(scb, timenow));
         }
+
         if (LOGINFO) {
             log_info("\nNew session %d created OK", slot);
         }
@@ -622,6 +888,9 @@ ses_cb_t *
             agt_ses_free_session(scb);
             scb = NULL;
         }
+        if (slot) {
+            put_free_slot(slot);
+        }
         if (LOGINFO) {
             log_info("\nNew session request failed (%s)",
                      get_error_string(res));
@@ -632,6 +901,53 @@ ses_cb_t *
 
 }  /* agt_ses_new_session */
 
+/********************************************************************
+* FUNCTION finish_writer
+*
+* Finish the RPC after the reply writer for writer_scb
+* has returned, unless it has only been suspended
+*
+* INPUTS:
+*   scb == session control block the writer was run for
+*   res == status from ses_msg_run_writer or ses_msg_resume_writer
+*
+* RETURNS:
+*   scb if the session is still there;
+*   NULL if the session was freed
+*********************************************************************/
+static ses_cb_t *
+    finish_writer (ses_cb_t *scb,
+                   status_t res)
+{
+    ses_msg_t  *msg;
+
+    if (res == ERR_NCX_SUSPENDED) {
+        return scb;
+    }
+
+    writer_scb = NULL;
+    agt_rpc_finish_reply(scb);
+
+    if (writer_freed) {
+        /* agt_ses_free_session was called during the writer */
+        writer_freed = FALSE;
+        agt_ses_free_session(scb);
+        return NULL;
+    }
+
+    /* input read while the writer was suspended may have
+     * been processed in the same batch already
+     */
+    ses_msg_unmake_inready(scb);
+    msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ);
+    if (msg && msg->ready && scb->state < SES_ST_SHUTDOWN_REQ) {
+        ses_msg_make_inready(scb);
+    }
+    return scb;
+
+}  /* finish_writer */
+
+
 /********************************************************************
 * FUNCTION agt_ses_free_session
 *
@@ -645,6 +961,7 @@ void
     agt_ses_free_session (ses_cb_t *scb)
 {
     ses_id_t  slot;
+    agt_profile_t *agt_profile;
 
     assert( scb && "scb is NULL!" );
     assert( agt_ses_init_done && "agt_ses_init_done is false!" );
@@ -654,6 +971,21 @@ void
         return;
     }
 
+    /* a session is not freed under its own writer; the rest
+     * of its output is thrown away and the session is freed
+     * when the writer returns
+     */
+    if (scb == writer_scb) {
+        if (!writer_freed) {
+            writer_freed = TRUE;
+            scb->state = SES_ST_SHUTDOWN;
+            if (ses_msg_writer_suspended(scb)) {
+                (void)finish_writer(scb, ses_msg_resume_writer(scb));
+            }
+        }
+        return;
+    }
+
     slot = scb->sid;
 
     if (scb->fd) {
@@ -684,11 +1016,20 @@ void
     ses_msg_unmake_inready(scb);
     ses_msg_unmake_outready(scb);
 
+    /* release the slot if the session was in the session table */
+    if (agtses[slot] == scb) {
+        agt_profile = agt_get_profile();
+        if (agt_profile->agt_idle_timeout > 0 ||
+            agt_profile->agt_hello_timeout > 0) {
+            tmo_remove(slot);
+        }
+        agtses[slot] = NULL;
+        put_free_slot(slot);
+    }
+
     /* this will close the socket if it is still open */
     ses_free_scb(scb);
 
-    agtses[slot] = NULL;
-
     if (LOGINFO) {
         log_info("\nSession %d closed", slot);
     }
@@ -798,6 +1139,17 @@ void
         return;
     }
 
+    /* a suspended writer may be in the middle of an RPC for
+     * this session, so it is run to the end first, with its
+     * output thrown away
+     */
+    if (scb == writer_scb && ses_msg_writer_suspended(scb)) {
+        scb->state = SES_ST_SHUTDOWN;
+        if (finish_writer(scb, ses_msg_resume_writer(scb)) == NULL) {
+            return;
+        }
+    }
+
     /* handle confirmed commit started by this session */
     if (agt_ncx_cc_active() && agt_ncx_cc_ses_id() == scb->sid) {
         if (agt_ncx_cc_persist_id() == NULL) {
@@ -818,70 +1170,52 @@ void
 } /* agt_ses_kill_session */
 
 /********************************************************************
-* FUNCTION agt_ses_process_first_ready
+* FUNCTION dump_ready_msg
 *
-* Check the readyQ and process the first message, if any
+* Log an incoming message for debugging
+* The ncx-connect message is never echoed
 *
-* RETURNS:
-*     TRUE if a message was processed
-*     FALSE if the readyQ was empty
+* INPUTS:
+*   scb == session control block
+*   msg == message to dump
 *********************************************************************/
-boolean
-    agt_ses_process_first_ready (void)
+static void
+    dump_ready_msg (ses_cb_t *scb,
+                    ses_msg_t *msg)
 {
-    ses_cb_t     *scb;
-    ses_ready_t  *rdy;
-    ses_msg_t    *msg;
-    status_t      res;
     uint32        cnt;
     xmlChar       buff[32];
 
-    rdy = ses_msg_get_first_inready();
-    if (!rdy) {
-        return FALSE;
-    }
-
-    /* get the session control block that rdy is embedded into */
-    scb = agtses[rdy->sid];
-
-    if (scb == NULL) {
-        log_debug("\nagt_ses: session %d gone", rdy->sid);
-        return FALSE;
-    }
-
-    log_debug2("\nagt_ses msg ready for session %d", scb->sid);
-
-    /* check the session control block state */
-    if (scb->state >= SES_ST_SHUTDOWN_REQ) {
-        /* don't process the message or even it mark it
-         * It will be cleaned up when the session is freed
-         */
-        log_debug("\nagt_ses drop input, session %d shutting down",
-                  scb->sid);
-        return TRUE;
-    }
-
-    /* make sure a message is really there */
-    msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ);
-    if (!msg || !msg->ready) {
-        SET_ERROR(ERR_INTERNAL_PTR);
-        log_error("\nagt_ses ready Q message not correct");
-        if (msg && scb->state != SES_ST_INIT) {
-            /* do not echo the ncx-connect message */
-            cnt = xml_strcpy(buff,
-                             (const xmlChar *)"Incoming msg for session ");
-            snprintf((char *)(&buff[cnt]), sizeof(buff) - cnt, "%u", scb->sid);
-            ses_msg_dump(msg, buff);
-        }
-
-        return FALSE;
-    } else if (LOGDEBUG2 && scb->state != SES_ST_INIT) {
+    if (scb->state != SES_ST_INIT) {
         cnt = xml_strcpy(buff,
                          (const xmlChar *)"Incoming msg for session ");
         snprintf((char *)(&buff[cnt]), sizeof(buff) - cnt, "%u", scb->sid);
         ses_msg_dump(msg, buff);
     }
 
+}  /* dump_ready_msg */
+
+
+/********************************************************************
+* FUNCTION process_ready_msg
+*
+* Parse and dispatch 1 complete message for a session
+* The message is freed when it has been processed
+*
+* INPUTS:
+*   scb == session control block
+*   msg == first message in the scb->msgQ, ready to parse
+*
+* RETURNS:
+*   scb if the session is still there;
+*   NULL if the session was deleted
+*********************************************************************/
+static ses_cb_t *
+    process_ready_msg (ses_cb_t *scb,
+                       ses_msg_t *msg)
+{
+    status_t      res;
+
     /* setup the XML parser */
     if (scb->reader) {
             /* reset the xmlreader */
@@ -916,18 +1250,234 @@ boolean
         /* free the message that was just processed */
         dlq_remove(msg);
         ses_msg_free_msg(scb, msg);
+    }
+
+    return scb;
+
+}  /* process_ready_msg */
+
+
+/********************************************************************
+* FUNCTION process_batch
+*
+* Process a batch of ready messages for a session
+*
+* Up to --rpc-batch-size messages are processed for the session,
+* or as many as fit in --rpc-batch-time microseconds, whichever
+* comes first.  The replies are held back and sent together
+* at the end of the batch.  If the session still has messages
+* ready, it goes to the end of the readyQ so other sessions
+* get their turn first.
+*
+* The batch also ends if a reply writer is suspended, since
+* the next reply cannot be started until that one is done
+*
+* INPUTS:
+*   scb == session control block with a message ready
+*
+* RETURNS:
+*   scb if the session is still there;
+*   NULL if the session was deleted
+*********************************************************************/
+static ses_cb_t *
+    process_batch (ses_cb_t *scb)
+{
+    ses_msg_t          *msg;
+    agt_profile_t      *agt_profile;
+    unsigned long long  starttime;
+    uint32              msgcnt;
+    boolean             done;
+
+    agt_profile = agt_get_profile();
+    starttime = (agt_profile->agt_rpc_batch_time) ? uptime_usec() : 0;
+    msgcnt = 0;
+
+    /* hold back the replies until the batch is done */
+    if (agt_profile->agt_rpc_batch_size > 1) {
+        ses_msg_cork_output(scb);
+    }
+
+    msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ);
+    done = FALSE;
+    while (!done) {
+        /* the scb pointer may get deleted !!! */
+        scb = process_ready_msg(scb, msg);
+        msgcnt++;
+        if (scb == NULL || scb->state >= SES_ST_SHUTDOWN_REQ ||
+            ses_msg_writer_suspended(scb)) {
+            done = TRUE;
+            continue;
+        }
 
         /* check if any messages left for this session */
         msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ);
-        if (msg && msg->ready) {
+        if (!msg || !msg->ready) {
+            done = TRUE;
+        } else if (msgcnt >= agt_profile->agt_rpc_batch_size ||
+                   (agt_profile->agt_rpc_batch_time &&
+                    uptime_usec() - starttime >= 
+                    agt_profile->agt_rpc_batch_time)) {
+            /* budget used up; let the other sessions go first */
             ses_msg_make_inready(scb);
+            done = TRUE;
+        } else if (LOGDEBUG2) {
+            dump_ready_msg(scb, msg);
         }
     }
 
+    if (scb) {
+        (void)ses_msg_uncork_output(scb);
+    }
+
+    if (LOGDEBUG3 && msgcnt > 1) {
+        log_debug3("\nagt_ses: processed %u msgs in 1 batch", msgcnt);
+    }
+
+    return scb;
+
+}  /* process_batch */
+
+
+/********************************************************************
+* FUNCTION agt_ses_process_first_ready
+*
+* Check the readyQ and process the messages for the first
+* session, if any
+*
+* The messages are processed as 1 batch by process_batch.
+* If a reply fills the outQ, its writer is suspended and
+* continued by agt_ses_resume_writer as the output is sent.
+* No other request is processed until the reply is done,
+* since the suspended writer may be walking a datastore
+* that the other requests could change.
+*
+* RETURNS:
+*     TRUE if a message was processed
+*     FALSE if the readyQ was empty or a writer is suspended
+*********************************************************************/
+boolean
+    agt_ses_process_first_ready (void)
+{
+    ses_cb_t           *scb;
+    ses_ready_t        *rdy;
+    ses_msg_t          *msg;
+
+    if (writer_scb) {
+        return FALSE;
+    }
+
+    rdy = ses_msg_get_first_inready();
+    if (!rdy) {
+        return FALSE;
+    }
+
+    /* get the session control block that rdy is embedded into */
+    scb = agtses[rdy->sid];
+
+    if (scb == NULL) {
+        log_debug("\nagt_ses: session %d gone", rdy->sid);
+        return FALSE;
+    }
+
+    log_debug2("\nagt_ses msg ready for session %d", scb->sid);
+
+    /* check the session control block state */
+    if (scb->state >= SES_ST_SHUTDOWN_REQ) {
+        /* don't process the message or even it mark it
+         * It will be cleaned up when the session is freed
+         */
+        log_debug("\nagt_ses drop input, session %d shutting down",
+                  scb->sid);
+        return TRUE;
+    }
+
+    /* make sure a message is really there */
+    msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ);
+    if (!msg || !msg->ready) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        log_error("\nagt_ses ready Q message not correct");
+        if (msg) {
+            dump_ready_msg(scb, msg);
+        }
+        return FALSE;
+    } else if (LOGDEBUG2) {
+        dump_ready_msg(scb, msg);
+    }
+
+    /* the scb pointer may get deleted !!! */
+    scb = process_batch(scb);
+    if (scb && ses_msg_writer_suspended(scb)) {
+        writer_scb = scb;
+        writer_freed = FALSE;
+    }
+
     return TRUE;
 
 }  /* agt_ses_process_first_ready */
 
+
+/********************************************************************
+* FUNCTION agt_ses_writer_suspended
+*
+* Check if a session has its writer suspended
+* Requests, timer callbacks and notifications have to wait
+* until it is done
+*
+* RETURNS:
+*     TRUE if a writer is suspended
+*     FALSE otherwise
+*********************************************************************/
+boolean
+    agt_ses_writer_suspended (void)
+{
+    return (writer_scb && ses_msg_writer_suspended(writer_scb)) ?
+        TRUE : FALSE;
+
+}  /* agt_ses_writer_suspended */
+
+
+/********************************************************************
+* FUNCTION agt_ses_resume_writer
+*
+* Continue the suspended writer for a session, if enough
+* of its output has been sent
+* Used by agt_ncxserver when the session socket is writable
+*
+* INPUTS:
+*    scb == session control block
+*
+* RETURNS:
+*    scb if the session is still there;
+*    NULL if the session was freed
+*********************************************************************/
+ses_cb_t *
+    agt_ses_resume_writer (ses_cb_t *scb)
+{
+    if (scb != writer_scb || !ses_msg_writer_suspended(scb)) {
+        return scb;
+    }
+    return finish_writer(scb, ses_msg_resume_writer(scb));
+
+}  /* agt_ses_resume_writer */
+
+
+/********************************************************************
+* FUNCTION agt_ses_stop_writer
+*
+* Drop the session with a suspended writer, if any
+* Used when the server shuts down, so the writer is done
+* while the datastores it uses are still there
+*********************************************************************/
+void
+    agt_ses_stop_writer (void)
+{
+    if (agt_ses_writer_suspended()) {
+        agt_ses_kill_session(writer_scb, 0, SES_TR_OTHER);
+    }
+
+}  /* agt_ses_stop_writer */
+
+
 /********************************************************************
 * FUNCTION agt_ses_check_timeouts
 *
@@ -940,12 +1490,28 @@ void
 {
     ses_cb_t         *scb;
     agt_profile_t    *agt_profile;
-    uint32            i, last;
-    time_t            timenow;
+    ses_id_t          slot;
+    time_t            timenow, deadline;
     double            timediff;
 
     agt_profile = agt_get_profile();
 
+    /* drop a session whose writer has been suspended for
+     * --write-timeout seconds without the client reading
+     * any of its output
+     */
+    if (agt_profile->agt_write_timeout > 0 && agt_ses_writer_suspended()) {
+        (void)uptime(&timenow);
+        timediff = difftime(timenow, writer_scb->out_time);
+        if (timediff >= (double)agt_profile->agt_write_timeout) {
+            if (LOGDEBUG) {
+                log_debug("\nWrite timeout for session %u", 
+                          writer_scb->sid);
+            }
+            agt_ses_kill_session(writer_scb, 0, SES_TR_TIMEOUT);
+        }
+    }
+
     /* check if both timeouts are disabled and the
      * confirmed-commit is not active -- quick exit
      */
@@ -969,61 +1535,42 @@ void
     /* reset the timeout interval for next time */
     last_timeout_check = timenow;
 
-    /* check all the sessions only if idle or hello
-     * timeout checking is enabled
+    /* check only the sessions whose deadline has passed;
+     * the deadline is recomputed first, since an RPC or 
+     * a state change may have moved it later
      */
-    if (agt_profile->agt_idle_timeout == 0 &&
-        agt_profile->agt_hello_timeout == 0) {
-        last = 0;
-    } else if (next_sesid == 0) {
-        last = agt_profile->agt_max_sessions;
-    } else {
-        last = next_sesid;
-    }
-
-    for (i=1; i < last; i++) {
-
-        scb = agtses[i];
+    while (tmo_count > 0 && tmo_deadline[tmo_heap[0]] <= timenow) {
+        slot = tmo_heap[0];
+        scb = agtses[slot];
         if (scb == NULL) {
+            SET_ERROR(ERR_INTERNAL_VAL);
+            tmo_remove(slot);
             continue;
         }
 
-        /* check if the the hello timer needs to be tested */
-        if (agt_profile->agt_hello_timeout > 0 &&
-            scb->state == SES_ST_HELLO_WAIT) {
-
-            timediff = difftime(timenow, scb->hello_time);
-            if (timediff >= (double)agt_profile->agt_hello_timeout) {
-                if (LOGDEBUG) {
-                    log_debug("\nHello timeout for session %u", i);
-                }
-                agt_ses_kill_session(scb, 0, SES_TR_TIMEOUT);
-                continue;
-            }
+        deadline = get_session_deadline(scb, timenow);
+        if (deadline > timenow) {
+            tmo_deadline[slot] = deadline;
+            tmo_fix(0);
+            continue;
         }
 
-        /* check if the the idle timer needs to be tested
-         * check only active sessions
-         * skip if notifications are active
-         */
-        if (agt_profile->agt_idle_timeout > 0 &&
-            scb->active &&
-            !scb->notif_active &&
-            (strcmp((const char*)scb->peeraddr,"127.0.0.1")!=0)) {
-
-            timediff = difftime(timenow, scb->last_rpc_time);
-            if (timediff >= (double)agt_profile->agt_idle_timeout) {
-                if (LOGDEBUG) {
-                    log_debug("\nIdle timeout for session %u", i);
-                }
-                agt_ses_kill_session(scb, 0, SES_TR_TIMEOUT);
-                continue;
-            }
+        if (LOGDEBUG) {
+            log_debug("\n%s timeout for session %u", 
+                      (scb->state == SES_ST_HELLO_WAIT) ? "Hello" : "Idle",
+                      slot);
         }
+
+        /* this removes the slot from the timeout heap */
+        agt_ses_kill_session(scb, 0, SES_TR_TIMEOUT);
     }
 
-    /* check the confirmed-commit timeout */
-    agt_ncx_check_cc_timeout();
+    /* check the confirmed-commit timeout; a rollback has
+     * to wait for a suspended writer to finish
+     */
+    if (!agt_ses_writer_suspended()) {
+        agt_ncx_check_cc_timeout();
+    }
 
 }  /* agt_ses_check_timeouts */
 
@@ -1075,7 +1622,9 @@ boolean
 /********************************************************************
 * FUNCTION agt_ses_fill_writeset
 *
-* Drain the ses_msg outreadyQ and set the specified fdset
+* Drain the ses_msg outreadyQ and add the sessions to the
+* specified fdset; the caller clears a session from the fdset
+* once all its output has been sent
 * Used by agt_ncxserver write_fd_set
 *
 * INPUTS:
@@ -1090,29 +1639,48 @@ void
     agt_ses_fill_writeset (fd_set *fdset,
                            int *maxfdnum)
 {
-    ses_ready_t *rdy;
     ses_cb_t *scb;
-    boolean done;
 
-    FD_ZERO(fdset);
-    done = FALSE;
-    while (!done) {
-        rdy = ses_msg_get_first_outready();
-        if (!rdy) {
-            done = TRUE;
-        } else {
-            scb = agtses[rdy->sid];
-            if (scb && scb->state <= SES_ST_SHUTDOWN_REQ) {
-                FD_SET(scb->fd, fdset);
-                if (scb->fd > *maxfdnum) {
-                    *maxfdnum = scb->fd;
-                }
-            }
+    for (scb = agt_ses_get_first_outready();
+         scb != NULL;
+         scb = agt_ses_get_first_outready()) {
+        FD_SET(scb->fd, fdset);
+        if (scb->fd > *maxfdnum) {
+            *maxfdnum = scb->fd;
         }
     }
 
 }  /* agt_ses_fill_writeset */
 
+
+/********************************************************************
+* FUNCTION agt_ses_get_first_outready
+*
+* Drain one entry from the ses_msg outreadyQ
+* Used by the agt_ncxserver epoll loop
+*
+* RETURNS:
+*    pointer to the next session with output pending,
+*    or NULL if the outreadyQ is empty
+*********************************************************************/
+ses_cb_t *
+    agt_ses_get_first_outready (void)
+{
+    ses_ready_t *rdy;
+    ses_cb_t    *scb;
+
+    for (rdy = ses_msg_get_first_outready();
+         rdy != NULL;
+         rdy = ses_msg_get_first_outready()) {
+        scb = agtses[rdy->sid];
+        if (scb && scb->state <= SES_ST_SHUTDOWN_REQ) {
+            return scb;
+        }
+    }
+    return NULL;
+
+}  /* agt_ses_get_first_outready */
+
 /********************************************************************
 * FUNCTION agt_ses_get_inSessions
 *
@@ -251,16 +251,72 @@ extern void
 /********************************************************************
 * FUNCTION agt_ses_process_first_ready
 *
-* Check the readyQ and process the first message, if any
+* Check the readyQ and process the messages for the first
+* session, if any
+*
+* Up to --rpc-batch-size messages are processed for the session,
+* or as many as fit in --rpc-batch-time microseconds, whichever
+* comes first.  The replies are held back and sent together
+* at the end of the batch.  If the session still has messages
+* ready, it goes to the end of the readyQ so other sessions
+* get their turn first.
+*
+* If a reply fills the outQ, its writer is suspended and
+* continued by agt_ses_resume_writer as the output is sent.
+* No other request is processed until the reply is done.
 *
 * RETURNS:
 *     TRUE if a message was processed
-*     FALSE if the readyQ was empty
+*     FALSE if the readyQ was empty or a writer is suspended
 *********************************************************************/
 extern boolean
     agt_ses_process_first_ready (void);
 
 
+/********************************************************************
+* FUNCTION agt_ses_writer_suspended
+*
+* Check if a session has its writer suspended
+* Requests, timer callbacks and notifications have to wait
+* until it is done
+*
+* RETURNS:
+*     TRUE if a writer is suspended
+*     FALSE otherwise
+*********************************************************************/
+extern boolean
+    agt_ses_writer_suspended (void);
+
+
+/********************************************************************
+* FUNCTION agt_ses_resume_writer
+*
+* Continue the suspended writer for a session, if enough
+* of its output has been sent
+* Used by agt_ncxserver when the session socket is writable
+*
+* INPUTS:
+*    scb == session control block
+*
+* RETURNS:
+*    scb if the session is still there;
+*    NULL if the session was freed
+*********************************************************************/
+extern ses_cb_t *
+    agt_ses_resume_writer (ses_cb_t *scb);
+
+
+/********************************************************************
+* FUNCTION agt_ses_stop_writer
+*
+* Drop the session with a suspended writer, if any
+* Used when the server shuts down, so the writer is done
+* while the datastores it uses are still there
+*********************************************************************/
+extern void
+    agt_ses_stop_writer (void);
+
+
 /********************************************************************
 * FUNCTION agt_ses_check_timeouts
 *
@@ -288,7 +344,9 @@ extern boolean
 /********************************************************************
 * FUNCTION agt_ses_fill_writeset
 *
-* Drain the ses_msg outreadyQ and set the specified fdset
+* Drain the ses_msg outreadyQ and add the sessions to the
+* specified fdset; the caller clears a session from the fdset
+* once all its output has been sent
 * Used by agt_ncxserver write_fd_set
 *
 * INPUTS:
@@ -304,6 +362,20 @@ extern void
 			   int *maxfdnum);
 
 
+/********************************************************************
+* FUNCTION agt_ses_get_first_outready
+*
+* Drain one entry from the ses_msg outreadyQ
+* Used by the agt_ncxserver epoll loop
+*
+* RETURNS:
+*    pointer to the next session with output pending,
+*    or NULL if the outreadyQ is empty
+*********************************************************************/
+extern ses_cb_t *
+    agt_ses_get_first_outready (void);
+
+
 /********************************************************************
 * FUNCTION agt_ses_get_inSessions
 *
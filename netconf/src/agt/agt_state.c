@@ -357,8 +357,8 @@ static val_value_t *
             *res = ERR_INTERNAL_MEM;
             return NULL;
         }
-        leafval->xpathpcb = xpath_clone_pcb(xpathpcb);
-        if (leafval->xpathpcb == NULL) {
+        if (val_set_xpathpcb(leafval, xpath_clone_pcb(xpathpcb)) != NO_ERR ||
+            VAL_XPATHPCB(leafval) == NULL) {
             val_free_value(plockval);
             *res = ERR_INTERNAL_MEM;
             return NULL;
@@ -1589,7 +1589,7 @@ void
         if (!idval) {
             SET_ERROR(ERR_INTERNAL_VAL);
         } else if (VAL_UINT(idval) == sid) {
-            dlq_remove(sessionval);
+            val_remove_child(sessionval);
             val_free_value(sessionval);
             return;
         }
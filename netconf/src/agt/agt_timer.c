@@ -21,6 +21,8 @@
 date         init     comment
 ----------------------------------------------------------------------
 23jan07      abb      begun
+16oct26      agt      keep timers in a min-heap of deadlines
+                      with millisecond resolution
 
 *********************************************************************
 *                                                                   *
@@ -51,7 +53,12 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 
-#define AGT_TIMER_SKIP_COUNT 1
+/* initial number of slots in the deadline heap */
+#define AGT_TIMER_HEAP_SIZE  32
+
+/* convert seconds to milliseconds without overflow */
+#define AGT_TIMER_SEC_TO_MSEC(S) \
+    (((S) > NCX_MAX_UINT / 1000) ? NCX_MAX_UINT : (S) * 1000)
 
 /********************************************************************
 *                                                                   *
@@ -65,17 +72,182 @@ static dlq_hdr_t   timer_cbQ;
 
 static uint32      next_id;
 
-static uint32      skip_count;
+/* min-heap of timer control blocks, ordered by deadline */
+static agt_timer_cb_t **timer_heap;
+
+static uint32      heap_count;
+
+static uint32      heap_size;
+
+/* timer whose callback is running right now */
+static agt_timer_cb_t *cur_timer;
+
 
 /********************************************************************
-* FUNCTION get_timer_id
+* FUNCTION get_msecs
 *
-* Allocate a timer ID
+* Get the current uptime in milliseconds
+*
+* RETURNS:
+*   number of milliseconds on the monotonic clock
+*********************************************************************/
+static uint64
+    get_msecs (void)
+{
+    return (uint64)(uptime_usec() / 1000);
+
+}  /* get_msecs */
+
+
+/********************************************************************
+* FUNCTION heap_swap
+*
+* Swap 2 entries in the deadline heap
 *
 * INPUTS:
-*   none
+*   i == index of the 1st entry
+*   j == index of the 2nd entry
+*********************************************************************/
+static void
+    heap_swap (uint32 i,
+               uint32 j)
+{
+    agt_timer_cb_t *timer_cb;
+
+    timer_cb = timer_heap[i];
+    timer_heap[i] = timer_heap[j];
+    timer_heap[j] = timer_cb;
+    timer_heap[i]->timer_heap_index = i;
+    timer_heap[j]->timer_heap_index = j;
+
+}  /* heap_swap */
+
+
+/********************************************************************
+* FUNCTION heap_fix
+*
+* Move a heap entry up or down after its deadline changed
+*
+* INPUTS:
+*   idx == index of the entry to move
+*********************************************************************/
+static void
+    heap_fix (uint32 idx)
+{
+    uint32  parent, child;
+
+    /* sift up */
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (timer_heap[parent]->timer_deadline <= 
+            timer_heap[idx]->timer_deadline) {
+            break;
+        }
+        heap_swap(idx, parent);
+        idx = parent;
+    }
+
+    /* sift down */
+    for (;;) {
+        child = 2 * idx + 1;
+        if (child >= heap_count) {
+            break;
+        }
+        if (child + 1 < heap_count &&
+            timer_heap[child + 1]->timer_deadline < 
+            timer_heap[child]->timer_deadline) {
+            child++;
+        }
+        if (timer_heap[idx]->timer_deadline <= 
+            timer_heap[child]->timer_deadline) {
+            break;
+        }
+        heap_swap(idx, child);
+        idx = child;
+    }
+
+}  /* heap_fix */
+
+
+/********************************************************************
+* FUNCTION heap_add
+*
+* Add a timer to the deadline heap
+*
+* INPUTS:
+*   timer_cb == timer control block to add
+*
 * RETURNS:
-*   timer_id or zero if none available
+*   status
+*********************************************************************/
+static status_t
+    heap_add (agt_timer_cb_t *timer_cb)
+{
+    agt_timer_cb_t **newheap;
+    uint32           newsize;
+
+    if (heap_count == heap_size) {
+        newsize = (heap_size) ? heap_size * 2 : AGT_TIMER_HEAP_SIZE;
+        newheap = (agt_timer_cb_t **)
+            m__getMem(newsize * sizeof(agt_timer_cb_t *));
+        if (newheap == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        if (heap_count) {
+            memcpy(newheap, timer_heap, 
+                   heap_count * sizeof(agt_timer_cb_t *));
+        }
+        m__free(timer_heap);
+        timer_heap = newheap;
+        heap_size = newsize;
+    }
+
+    timer_cb->timer_heap_index = heap_count;
+    timer_heap[heap_count++] = timer_cb;
+    heap_fix(timer_cb->timer_heap_index);
+    return NO_ERR;
+
+}  /* heap_add */
+
+
+/********************************************************************
+* FUNCTION heap_remove
+*
+* Remove a timer from the deadline heap
+*
+* INPUTS:
+*   timer_cb == timer control block to remove
+*********************************************************************/
+static void
+    heap_remove (agt_timer_cb_t *timer_cb)
+{
+    uint32  idx;
+
+    idx = timer_cb->timer_heap_index;
+    if (idx >= heap_count || timer_heap[idx] != timer_cb) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return;
+    }
+
+    heap_count--;
+    if (idx != heap_count) {
+        timer_heap[idx] = timer_heap[heap_count];
+        timer_heap[idx]->timer_heap_index = idx;
+        heap_fix(idx);
+    }
+
+}  /* heap_remove */
+
+
+/********************************************************************
+* FUNCTION find_timer_cb
+*
+* Find a timer control block
+*
+* INPUTS:
+*   timer_id == timer ID to find
+* RETURNS:
+*   pointer to the timer control block or NULL if not found
 *********************************************************************/
 static agt_timer_cb_t *
     find_timer_cb (uint32 timer_id)
@@ -87,7 +259,7 @@ static agt_timer_cb_t *
          timer_cb != NULL;
          timer_cb = (agt_timer_cb_t *)
              dlq_nextEntry(timer_cb)) {
-        if (timer_cb->timer_id == timer_id) {
+        if (timer_cb->timer_id == timer_id && !timer_cb->timer_deleted) {
             return timer_cb;
         }
     }
@@ -177,6 +349,25 @@ static void
 } /* free_timer_cb */
 
 
+/********************************************************************
+* FUNCTION destroy_timer_cb
+*
+* Remove a timer from the heap and the timer Q and free it
+*
+* INPUTS:
+*   timer_cb == control block to destroy
+*
+*********************************************************************/
+static void
+    destroy_timer_cb (agt_timer_cb_t *timer_cb)
+{
+    heap_remove(timer_cb);
+    dlq_remove(timer_cb);
+    free_timer_cb(timer_cb);
+
+} /* destroy_timer_cb */
+
+
 /********************************************************************
 * FUNCTION agt_timer_init
 *
@@ -193,7 +384,10 @@ void
     if (!agt_timer_init_done) {
         dlq_createSQue(&timer_cbQ);
         next_id = 1;
-        skip_count = 0;
+        timer_heap = NULL;
+        heap_count = 0;
+        heap_size = 0;
+        cur_timer = NULL;
         agt_timer_init_done = TRUE;
     }
 
@@ -216,6 +410,10 @@ void
             timer_cb = (agt_timer_cb_t *)dlq_deque(&timer_cbQ);
             free_timer_cb(timer_cb);
         }
+        m__free(timer_heap);
+        timer_heap = NULL;
+        heap_count = 0;
+        heap_size = 0;
         agt_timer_init_done = FALSE;
     }
 
@@ -226,49 +424,58 @@ void
 * FUNCTION agt_timer_handler
 *
 * Handle an incoming agent timer polling interval
-* main routine called by agt_signal_handler
+* Invoke the callback for every timer that has expired
+* Called by the server IO loop on every pass
+*
+* Only the expired timers at the top of the heap are visited
+* A periodic timer is rescheduled from its last deadline,
+* so a late callback does not shift the following ones
 *
 *********************************************************************/
 void 
     agt_timer_handler (void)
 {
-    agt_timer_cb_t  *timer_cb, *next_timer_cb;
-    time_t           timenow;
-    double           timediff;
+    agt_timer_cb_t  *timer_cb;
+    uint64           timenow, deadline;
     int              retval;
 
-    if (skip_count < AGT_TIMER_SKIP_COUNT) {
-        skip_count++;
+    if (!agt_timer_init_done || heap_count == 0) {
         return;
-    } else {
-        skip_count = 0;
     }
 
-    (void)uptime(&timenow);
+    timenow = get_msecs();
 
-    for (timer_cb = (agt_timer_cb_t *)dlq_firstEntry(&timer_cbQ);
-         timer_cb != NULL;
-         timer_cb = next_timer_cb) {
+    while (heap_count > 0 && timer_heap[0]->timer_deadline <= timenow) {
+        timer_cb = timer_heap[0];
+        deadline = timer_cb->timer_deadline;
 
-        next_timer_cb = (agt_timer_cb_t *)dlq_nextEntry(timer_cb);
-
-        timediff = difftime(timenow, timer_cb->timer_start_time);
-        if (timediff >= (double)timer_cb->timer_duration) {
-            if (LOGDEBUG3) {
-                log_debug3("\nagt_timer: timer %u popped",
-                           timer_cb->timer_id);
-            }
+        if (LOGDEBUG3) {
+            log_debug3("\nagt_timer: timer %u popped",
+                       timer_cb->timer_id);
+        }
 
-            retval = (*timer_cb->timer_cbfn)(timer_cb->timer_id,
-                                             timer_cb->timer_cookie);
-            if (retval != 0 || !timer_cb->timer_periodic) {
-                /* destroy this timer */
-                dlq_remove(timer_cb);
-                free_timer_cb(timer_cb);
-            } else {
-                /* reset this periodic timer */
-                (void)uptime(&timer_cb->timer_start_time);
+        /* the callback may create, restart, or delete timers,
+         * including this one
+         */
+        cur_timer = timer_cb;
+        retval = (*timer_cb->timer_cbfn)(timer_cb->timer_id,
+                                         timer_cb->timer_cookie);
+        cur_timer = NULL;
+
+        if (retval != 0 || !timer_cb->timer_periodic ||
+            timer_cb->timer_deleted) {
+            /* destroy this timer */
+            destroy_timer_cb(timer_cb);
+        } else if (timer_cb->timer_deadline == deadline) {
+            /* reset this periodic timer, unless the callback
+             * restarted it already; skip any missed intervals
+             */
+            timer_cb->timer_deadline += timer_cb->timer_duration;
+            if (timer_cb->timer_deadline <= timenow) {
+                timer_cb->timer_deadline = 
+                    timenow + timer_cb->timer_duration;
             }
+            heap_fix(timer_cb->timer_heap_index);
         }
     }
 
@@ -302,15 +509,54 @@ status_t
                       agt_timer_fn_t  timer_fn,
                       void *cookie,
                       uint32 *ret_timer_id)
+{
+    return agt_timer_create_ms(AGT_TIMER_SEC_TO_MSEC(seconds),
+                               is_periodic,
+                               timer_fn,
+                               cookie,
+                               ret_timer_id);
+
+} /* agt_timer_create */
+
+
+/********************************************************************
+* FUNCTION agt_timer_create_ms
+*
+* Malloc and start a new timer control block
+* Same as agt_timer_create, except the interval is in milliseconds
+*
+* INPUTS:
+*   msecs == number of milliseconds to wait between polls
+*   is_periodic == TRUE if periodic timer
+*                  FALSE if a 1-event timer
+*   timer_fn == address of callback function to invoke when
+*               the timer poll event occurs
+*   cookie == address of user cookie to pass to the timer_fn
+*   ret_timer_id == address of return timer ID
+*
+* OUTPUTS:
+*  *ret_timer_id == timer ID for the allocated timer, 
+*    if the return value is NO_ERR
+*
+* RETURNS:
+*   NO_ERR if all okay, the minimum spare requests will be malloced
+*********************************************************************/
+status_t
+    agt_timer_create_ms (uint32 msecs,
+                         boolean is_periodic,
+                         agt_timer_fn_t  timer_fn,
+                         void *cookie,
+                         uint32 *ret_timer_id)
 {
     agt_timer_cb_t *timer_cb;
     uint32          timer_id;
+    status_t        res;
 
 #ifdef DEBUG
     if (timer_fn == NULL || ret_timer_id == NULL) {
         return SET_ERROR(ERR_INTERNAL_PTR);
     }
-    if (seconds == 0) {
+    if (msecs == 0) {
         return SET_ERROR(ERR_INTERNAL_VAL);
     }
 #endif
@@ -326,18 +572,24 @@ status_t
         return ERR_INTERNAL_MEM;
     }
 
-    *ret_timer_id = timer_id;
     timer_cb->timer_id = timer_id;
     timer_cb->timer_periodic = is_periodic;
     timer_cb->timer_cbfn = timer_fn;
-    (void)uptime(&timer_cb->timer_start_time);
-    timer_cb->timer_duration = seconds;
+    timer_cb->timer_duration = msecs;
+    timer_cb->timer_deadline = get_msecs() + msecs;
     timer_cb->timer_cookie = cookie;
 
+    res = heap_add(timer_cb);
+    if (res != NO_ERR) {
+        free_timer_cb(timer_cb);
+        return res;
+    }
+
+    *ret_timer_id = timer_id;
     dlq_enque(timer_cb, &timer_cbQ);
     return NO_ERR;
 
-} /* agt_timer_create */
+} /* agt_timer_create_ms */
 
 
 /********************************************************************
@@ -358,11 +610,33 @@ status_t
 status_t
     agt_timer_restart (uint32 timer_id,
                        uint32 seconds)
+{
+    return agt_timer_restart_ms(timer_id, AGT_TIMER_SEC_TO_MSEC(seconds));
+
+} /* agt_timer_restart */
+
+
+/********************************************************************
+* FUNCTION agt_timer_restart_ms
+*
+* Restart a timer with a new timeout value in milliseconds
+* Same as agt_timer_restart, except the value is in milliseconds
+*
+* INPUTS:
+*   timer_id == timer ID to reset
+*   msecs == new timeout value
+*
+* RETURNS:
+*   status, NO_ERR if all okay,
+*********************************************************************/
+status_t
+    agt_timer_restart_ms (uint32 timer_id,
+                          uint32 msecs)
 {
     agt_timer_cb_t *timer_cb;
 
 #ifdef DEBUG
-    if (seconds == 0) {
+    if (msecs == 0) {
         return SET_ERROR(ERR_INTERNAL_VAL);
     }
 #endif
@@ -372,11 +646,47 @@ status_t
         return ERR_NCX_NOT_FOUND;
     }
 
-    (void)uptime(&timer_cb->timer_start_time);
-    timer_cb->timer_duration = seconds;
+    timer_cb->timer_duration = msecs;
+    timer_cb->timer_deadline = get_msecs() + msecs;
+    heap_fix(timer_cb->timer_heap_index);
     return NO_ERR;
 
-} /* agt_timer_restart */
+} /* agt_timer_restart_ms */
+
+
+/********************************************************************
+* FUNCTION agt_timer_get_timeout
+*
+* Get the time left until the next timer expires
+* Used by the server IO loop to set its wait timeout
+*
+* INPUTS:
+*   maxmsecs == max number of milliseconds to return
+*
+* RETURNS:
+*   number of milliseconds until the next timer expires,
+*   0 if a timer has already expired, 
+*   or maxmsecs if no timer expires sooner
+*********************************************************************/
+uint32
+    agt_timer_get_timeout (uint32 maxmsecs)
+{
+    uint64  timenow, deadline;
+
+    if (!agt_timer_init_done || heap_count == 0) {
+        return maxmsecs;
+    }
+
+    timenow = get_msecs();
+    deadline = timer_heap[0]->timer_deadline;
+    if (deadline <= timenow) {
+        return 0;
+    } else if (deadline - timenow < (uint64)maxmsecs) {
+        return (uint32)(deadline - timenow);
+    }
+    return maxmsecs;
+
+} /* agt_timer_get_timeout */
 
 
 /********************************************************************
@@ -403,12 +713,15 @@ void
         return;
     }
 
-    dlq_remove(timer_cb);
-    free_timer_cb(timer_cb);
+    if (timer_cb == cur_timer) {
+        /* agt_timer_handler will free it when the callback returns */
+        timer_cb->timer_deleted = TRUE;
+        return;
+    }
+
+    destroy_timer_cb(timer_cb);
 
 } /* agt_timer_delete */
 
 
 /* END file agt_timer.c */
-
-
@@ -30,6 +30,7 @@
 date	     init     comment
 ----------------------------------------------------------------------
 23-jan-07    abb      Begun
+16-oct-26    agt      Min-heap of deadlines with msec resolution
 
 */
 
@@ -74,10 +75,12 @@ typedef int (*agt_timer_fn_t) (uint32  timer_id,
 typedef struct agt_timer_cb_t_ {
     dlq_hdr_t       qhdr;
     boolean         timer_periodic;
+    boolean         timer_deleted;    /* deleted in its own callback */
     uint32          timer_id;
     agt_timer_fn_t  timer_cbfn;
-    time_t          timer_start_time;
-    uint32          timer_duration;   /* seconds */
+    uint64          timer_deadline;   /* uptime in milliseconds */
+    uint32          timer_duration;   /* milliseconds */
+    uint32          timer_heap_index;   /* position in deadline heap */
     void           *timer_cookie;
 } agt_timer_cb_t;
 
@@ -117,7 +120,8 @@ extern void
 * FUNCTION agt_timer_handler
 *
 * Handle an incoming server timer polling interval
-* main routine called by agt_signal_handler
+* Invoke the callback for every timer that has expired
+* Called by the server IO loop on every pass
 *
 *********************************************************************/
 extern void
@@ -153,6 +157,36 @@ extern status_t
                       uint32 *ret_timer_id);
 
 
+/********************************************************************
+* FUNCTION agt_timer_create_ms
+*
+* Malloc and start a new timer control block
+* Same as agt_timer_create, except the interval is in milliseconds
+*
+* INPUTS:
+*   msecs == number of milliseconds to wait between polls
+*   is_periodic == TRUE if periodic timer
+*                  FALSE if a 1-event timer
+*   timer_fn == address of callback function to invoke when
+*               the timer poll event occurs
+*   cookie == address of user cookie to pass to the timer_fn
+*   ret_timer_id == address of return timer ID
+*
+* OUTPUTS:
+*  *ret_timer_id == timer ID for the allocated timer, 
+*    if the return value is NO_ERR
+*
+* RETURNS:
+*   NO_ERR if all okay, the minimum spare requests will be malloced
+*********************************************************************/
+extern status_t
+    agt_timer_create_ms (uint32   msecs,
+                         boolean is_periodic,
+                         agt_timer_fn_t  timer_fn,
+                         void *cookie,
+                         uint32 *ret_timer_id);
+
+
 /********************************************************************
 * FUNCTION agt_timer_restart
 *
@@ -173,6 +207,42 @@ extern status_t
                        uint32 seconds);
 
 
+/********************************************************************
+* FUNCTION agt_timer_restart_ms
+*
+* Restart a timer with a new timeout value in milliseconds
+* Same as agt_timer_restart, except the value is in milliseconds
+*
+* INPUTS:
+*   timer_id == timer ID to reset
+*   msecs == new timeout value
+*
+* RETURNS:
+*   status, NO_ERR if all okay,
+*********************************************************************/
+extern status_t
+    agt_timer_restart_ms (uint32 timer_id,
+                          uint32 msecs);
+
+
+/********************************************************************
+* FUNCTION agt_timer_get_timeout
+*
+* Get the time left until the next timer expires
+* Used by the server IO loop to set its wait timeout
+*
+* INPUTS:
+*   maxmsecs == max number of milliseconds to return
+*
+* RETURNS:
+*   number of milliseconds until the next timer expires,
+*   0 if a timer has already expired, 
+*   or maxmsecs if no timer expires sooner
+*********************************************************************/
+extern uint32
+    agt_timer_get_timeout (uint32 maxmsecs);
+
+
 /********************************************************************
 * FUNCTION agt_timer_delete
 *
@@ -50,6 +50,7 @@ date         init     comment
 #include "log.h"
 #include "ncxconst.h"
 #include "ncx.h"
+#include "ses_msg.h"
 #include "status.h"
 #include "top.h"
 #include "xmlns.h"
@@ -179,13 +180,20 @@ void
 
     } else if (profile->agt_stream_output &&
                scb->state == SES_ST_SHUTDOWN_REQ) {
-        /* session was closed */
-        agt_ses_kill_session(scb,
-                             scb->killedbysid,
-                             scb->termreason);
-        /* set the supplied ptr to ptr to scb to NULL so that the 
-         * caller of this function knows that it was deallotcated */
-        *ppscb=NULL;
+        /* session was closed; send any replies held back
+         * for an RPC batch before the session goes away
+         * If the socket did not take all of it, the main
+         * loop kills the session when the output is sent
+         */
+        (void)ses_msg_uncork_output(scb);
+        if (dlq_empty(&scb->outQ)) {
+            agt_ses_kill_session(scb,
+                                 scb->killedbysid,
+                                 scb->termreason);
+            /* set the supplied ptr to ptr to scb to NULL so that the 
+             * caller of this function knows that it was deallotcated */
+            *ppscb=NULL;
+        }
     }
 
     xml_clean_node(&top);
@@ -834,7 +834,7 @@ static void
                                      parentnsid,
                                      valnsid,
                                      val->name, 
-                                     &val->metaQ, 
+                                     VAL_METAQ(val), 
                                      FALSE, 
                                      indent, 
                                      FALSE);
@@ -278,10 +278,10 @@ static status_t validate_xpath_filter( ses_cb_t* scb, rpc_msg_t* msg,
     val_value_t *sel = val_find_meta(filter, 0, NCX_EL_SELECT);
     status_t res = NO_ERR;
 
-    if (!sel || !sel->xpathpcb) {
+    if (!sel || !VAL_XPATHPCB(sel)) {
         res = ERR_NCX_MISSING_ATTRIBUTE;
-    } else if (sel->xpathpcb->parseres != NO_ERR) {
-        res = sel->xpathpcb->parseres;
+    } else if (sel->extra->xpathpcb->parseres != NO_ERR) {
+        res = sel->extra->xpathpcb->parseres;
     }
 
     if ( NO_ERR == res ) {
@@ -31,6 +31,7 @@ date         init     comment
 *********************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <memory.h>
 #include <assert.h>
 
@@ -45,6 +46,7 @@ date         init     comment
 #include "agt_util.h"
 #include "agt_val.h"
 #include "agt_val_parse.h"
+#include "bobhash.h"
 #include "cap.h"
 #include "cfg.h"
 #include "dlq.h"
@@ -74,6 +76,16 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 
+/* seed for hashing the unique-stmt tuples */
+#define UNIQUE_HASH_INIT   0x2f51c7a3
+
+/* changed_ptr_t flags */
+#define CHG_FL_SELF        bit0      /* edited, or instances edited */
+#define CHG_FL_DESC        bit1      /* a descendant was edited */
+
+/* initial size of a changed node table; power of 2 */
+#define CHG_TAB_MIN_SIZE   64
+
 /* recursive callback function forward decls */
 static status_t
     invoke_btype_cb (agt_cbtyp_t cbtyp,
@@ -101,7 +113,8 @@ static status_t
                           rpc_msg_t  *msg,
                           cfg_template_t *target,
                           val_value_t *candval,
-                          val_value_t *runval);
+                          val_value_t *runval,
+                          boolean dirtyonly);
 
 
 
@@ -114,15 +127,52 @@ typedef struct unique_set_t_ {
     dlq_hdr_t  qhdr;
     dlq_hdr_t  uniqueQ;   /* Q of val_unique_t */
     val_value_t *valnode;  /* value tree back-ptr */
+    uint32     ordinal;           /* position in the list instances */
+    xmlChar   *key;     /* malloced tuple encoding; NULL if not hashed */
+    uint32     keylen;
+    uint32     hash;
+    uint32     dupcnt;      /* later sets with the same hashed tuple */
+    struct unique_set_t_ *hashnext;            /* hash bucket chain */
+    struct unique_set_t_ *dupnext;   /* next set with the same tuple */
+    struct unique_set_t_ *duplast;   /* last set with the same tuple */
+    struct unique_set_t_ *fallnext; /* next set that was not hashed */
 } unique_set_t;
 
 
+/* one object or data node in a changed node table */
+typedef struct changed_ptr_t_ {
+    const void     *ptr;             /* NULL if the slot is empty */
+    uint32          flags;           /* CHG_FL_FOO bits */
+} changed_ptr_t;
+
+
+/* open addressing hash table of changed_ptr_t */
+typedef struct changed_tab_t_ {
+    changed_ptr_t  *slots;
+    uint32          size;
+    uint32          count;
+} changed_tab_t;
+
+
 /********************************************************************
 *                                                                   *
 *                       V A R I A B L E S                           *
 *                                                                   *
 *********************************************************************/
 
+/* the changes made by the transaction being checked;
+ * filled in by build_changed_objs and only valid during
+ * one agt_val_root_check or delete_dead_nodes call
+ */
+static changed_tab_t   chg_objtab;     /* obj_template_t ptrs */
+static changed_tab_t   chg_valtab;     /* val_value_t ptrs not dirty yet */
+
+/* TRUE if the tables and dirty flags show every change */
+static boolean         chg_valid;
+
+/* TRUE if the dirty flags in the config root are used */
+static boolean         chg_usedirty;
+
 
 /********************************************************************
  * FUNCTION cvt_editop
@@ -802,17 +852,19 @@ static status_t
 {
     val_value_t  *testval, *nextval;
     agt_cfg_nodeptr_t *nodeptr;
+    obj_template_t *casobj, *testcase;
 
-    if (child->casobj) {
+    casobj = val_get_casobj(child);
+    if (casobj) {
         for (testval = val_get_first_child(parent);
              testval != NULL;
              testval = nextval) {
 
             nextval = val_get_next_child(testval);
-            if (testval->casobj && 
-                (testval->casobj->parent == child->casobj->parent)) {
+            testcase = val_get_casobj(testval);
+            if (testcase && testcase->parent == casobj->parent) {
 
-                if (testval->casobj != child->casobj) {
+                if (testcase != casobj) {
                     log_debug3("\nagt_val: clean old case member '%s'"
                                " from parent '%s'",
                                testval->name, parent->name);
@@ -847,7 +899,7 @@ static status_t
             testval = val_find_child(parent, val_get_mod_name(child),
                                      child->name);
             if (testval) {
-                dlq_insertAhead(child, testval);
+                val_insert_child_before(child, testval, parent);
             } else {
                 val_add_child_sorted(child, parent);
             }
@@ -868,9 +920,9 @@ static status_t
                 if (editvars && editvars->insertval) {
                     testval = editvars->insertval;
                     if (editvars->insertop == OP_INSOP_BEFORE) {
-                        dlq_insertAhead(child, testval);
+                        val_insert_child_before(child, testval, parent);
                     } else {
-                        dlq_insertAfter(child, testval);
+                        val_insert_child(child, testval, parent);
                     }
                 } else {
                     SET_ERROR(ERR_NCX_INSERT_MISSING_INSTANCE);
@@ -1188,6 +1240,7 @@ static void
                 val_clear_dirty_flag(nodeptr->node);
             } else {
                 val_set_dirty_flag(nodeptr->node);
+                val_set_child_deleted_flag(nodeptr->node->parent);
             }
             val_remove_child(nodeptr->node);
             val_free_value(nodeptr->node);
@@ -1451,6 +1504,39 @@ static status_t
 }   /* commit_delete_allowed */
 
 
+/********************************************************************
+* FUNCTION commit_deletes_needed
+* 
+* Check if a node needs to be searched for child nodes
+* that are in the running config but not the source config
+*
+* A <commit> only has to look where the candidate edits
+* deleted a child node, or replaced a node as a whole;
+* the top-level nodes are always checked
+*
+* INPUTS:
+*   editop == edit operation in progress
+*   newval == value struct from the source config
+*
+* RETURNS:
+*   TRUE if the child nodes need to be checked
+*********************************************************************/
+static boolean
+    commit_deletes_needed (op_editop_t editop,
+                           const val_value_t *newval)
+{
+    if (editop != OP_EDITOP_COMMIT || newval == NULL) {
+        return TRUE;
+    }
+    if (obj_is_root(newval->obj)) {
+        return TRUE;
+    }
+    return (val_get_dirty_flag(newval) ||
+            val_get_child_deleted_flag(newval)) ? TRUE : FALSE;
+
+}  /* commit_deletes_needed */
+
+
 /********************************************************************
 * FUNCTION check_commit_deletes
 * 
@@ -1685,6 +1771,21 @@ static status_t
                 } else {
                     return ERR_INTERNAL_MEM;
                 }
+
+                /* a PDU node parsed into the message arena cannot
+                 * be linked into the target; edit a heap copy and
+                 * keep the arena node until the message is freed,
+                 * since the caller still holds a pointer to it  */
+                if (VAL_IS_ARENA(newval)) {
+                    val_value_t *copy = val_clone_arena_value(newval);
+
+                    if (copy == NULL) {
+                        restore_newnode2(newval, newval_marker);
+                        return ERR_INTERNAL_MEM;
+                    }
+                    dlq_enque(newval, &msg->rpc_arenaQ);
+                    newval = copy;
+                }
             } // else keep source leaf or leaf-list node in place
         }
 
@@ -1861,7 +1962,8 @@ static status_t
          if (topreplace ||
              (editop == OP_EDITOP_COMMIT && !typ_is_simple(newval->btyp) &&
               val_get_subtree_dirty_flag(newval))) {
-             res = apply_commit_deletes(scb, msg, target, newval, curval);
+             res = apply_commit_deletes(scb, msg, target, newval, curval,
+                                        (editop == OP_EDITOP_COMMIT));
          }
      }
 
@@ -2395,16 +2497,24 @@ static status_t
 
             nextch = val_get_next_child(chval);
 
+            cur_editop = chval->editop;
+            if (cur_editop == OP_EDITOP_NONE) {
+                cur_editop = editop;
+            }
+
+            /* skip the unchanged candidate nodes before looking
+             * for the running node; invoke_btype_cb skips them anyway
+             */
+            if (cur_editop == OP_EDITOP_COMMIT && !val_dirty_subtree(chval)) {
+                continue;
+            }
+
             if (curval) {
                 curch = val_first_child_match(curval, chval);
             } else {
                 curch = NULL;
             }
 
-            cur_editop = chval->editop;
-            if (cur_editop == OP_EDITOP_NONE) {
-                cur_editop = editop;
-            }
             res = invoke_btype_cb(cbtyp, cur_editop, scb, msg, target, 
                                   chval, curch, curval);
             //if (chval->res == NO_ERR) {
@@ -2516,7 +2626,8 @@ static status_t invoke_btype_cb( agt_cbtyp_t cbtyp,
 
         /* check if there are commit deletes to validate */
         if (has_children && 
-            msg->rpc_txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL) {
+            msg->rpc_txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL &&
+            commit_deletes_needed(editop, newval)) {
             res = check_commit_deletes(scb, msg, newval, 
                                        v_val ? v_val : curval);
             if (res != NO_ERR) {
@@ -2584,14 +2695,14 @@ static void
 
     /* check if the newval marker was placed in the source tree */
     if (undo->newnode_marker) {
-        dlq_remove(undo->newnode_marker);
+        val_remove_child(undo->newnode_marker);
         val_free_value(undo->newnode_marker);
         undo->newnode_marker = NULL;
     }
 
     /* check if the curval marker was placed in the target tree */
     if (undo->curnode_marker) {
-        dlq_remove(undo->curnode_marker);
+        val_remove_child(undo->curnode_marker);
         val_free_value(undo->curnode_marker);
         undo->curnode_marker = NULL;
     }
@@ -2629,6 +2740,11 @@ static void
         }
         if (undo->free_curnode) {
             if (VAL_IS_DELETED(undo->curnode)) {
+                if (msg->rpc_txcb->cfg_id != NCX_CFGID_RUNNING &&
+                    undo->edit_action == AGT_CFG_EDIT_ACTION_DELETE) {
+                    /* the <commit> looks for deletes under this node */
+                    val_set_child_deleted_flag(undo->curnode->parent);
+                }
                 val_remove_child(undo->curnode);
             }
             if (undo->curnode_clone) {
@@ -3017,6 +3133,10 @@ static status_t
             dlq_deque(&txcb->deadnodeQ);
         if (nodeptr && nodeptr->node) {
             /* mark ancestor nodes dirty before deleting this node */
+            if (target->cfg_id != NCX_CFGID_RUNNING) {
+                val_set_dirty_flag(nodeptr->node);
+                val_set_child_deleted_flag(nodeptr->node->parent);
+            }
             val_remove_child(nodeptr->node);
             val_free_value(nodeptr->node);
         } else {
@@ -3241,6 +3361,11 @@ static status_t
 *   target == target database (NCX_CFGID_RUNNING)
 *   candval == value struct from the candidate config
 *   runval == value struct from the running config
+*   dirtyonly == TRUE if this is a <commit> and the candidate
+*                dirty flags are set; only this level is checked,
+*                and only if a child node was deleted, because
+*                apply_write_val is called for each dirty subtree
+*                == FALSE to check all the descendant nodes
 *
 * OUTPUTS:
 *   rpc_err_rec_t structs may be malloced and added 
@@ -3254,7 +3379,8 @@ static status_t
                           rpc_msg_t  *msg,
                           cfg_template_t *target,
                           val_value_t *candval,
-                          val_value_t *runval)
+                          val_value_t *runval,
+                          boolean dirtyonly)
 {
     val_value_t      *curval, *nextval;
     status_t          res = NO_ERR;
@@ -3263,6 +3389,10 @@ static status_t
         return NO_ERR;
     }
 
+    if (dirtyonly && !commit_deletes_needed(OP_EDITOP_COMMIT, candval)) {
+        return NO_ERR;
+    }
+
     /* go through running config
      * if the matching node is not in the candidate,
      * then delete that node in the running config as well
@@ -3287,8 +3417,9 @@ static status_t
                 res = handle_callback(AGT_CB_APPLY, OP_EDITOP_DELETE, 
                                       scb, msg, target, NULL, curval, runval);
                 assert(res==NO_ERR);
-            } else {
-                res = apply_commit_deletes(scb, msg, target, matchval, curval);
+            } else if (!dirtyonly) {
+                res = apply_commit_deletes(scb, msg, target, matchval, curval,
+                                           FALSE);
                 assert(res==NO_ERR);
             }
         }  /* else skip non-config database node */
@@ -3377,6 +3508,9 @@ static void free_unique_set (unique_set_t *uset)
         unival = (val_unique_t *)dlq_deque(&uset->uniqueQ);
         val_free_unique(unival);
     }
+    if (uset->key) {
+        m__free(uset->key);
+    }
     m__free(uset);
 
 }   /* free_unique_set */
@@ -3474,6 +3608,219 @@ static status_t
 } /* make_unique_testset */
 
 
+/********************************************************************
+* FUNCTION get_unique_string
+* 
+* Get the string that compare_unique_testsets would use
+* for one unique-stmt component
+*
+* Only a single leaf that is not virtual or a password
+* is used; any other node-set is left to the brute force compare
+*
+* INPUTS:
+*   unival == unique component with the node-set to check
+*   buff == buffer to use, or NULL to get the length
+*   len == address of return length
+*
+* OUTPUTS:
+*   *len == number of bytes in the string
+*
+* RETURNS:
+*   status, ERR_NCX_SKIPPED if the component cannot be hashed
+*********************************************************************/
+static status_t
+    get_unique_string (val_unique_t *unival,
+                       xmlChar *buff,
+                       uint32 *len)
+{
+    xpath_pcb_t     *pcb = unival->pcb;
+    xpath_resnode_t *resnode;
+    val_value_t     *val;
+
+    if (pcb->val == NULL || pcb->result == NULL ||
+        pcb->result->restype != XP_RT_NODESET) {
+        return ERR_NCX_SKIPPED;
+    }
+
+    resnode = xpath_get_first_resnode(pcb->result);
+    if (resnode == NULL || xpath_get_next_resnode(resnode) != NULL) {
+        return ERR_NCX_SKIPPED;
+    }
+
+    val = xpath_get_resnode_valptr(resnode);
+    if (val == NULL || !typ_is_simple(val->btyp) || val_is_virtual(val) ||
+        obj_is_password(val->obj)) {
+        return ERR_NCX_SKIPPED;
+    }
+    if ((pcb->flags & XP_FL_CONFIGONLY) && !obj_is_config(val->obj)) {
+        return ERR_NCX_SKIPPED;
+    }
+
+    if (typ_is_string(val->btyp)) {
+        if (VAL_STR(val) == NULL) {
+            return ERR_NCX_SKIPPED;
+        }
+        *len = xml_strlen(VAL_STR(val));
+        if (buff) {
+            memcpy(buff, VAL_STR(val), *len);
+        }
+        return NO_ERR;
+    }
+
+    if (buff == NULL) {
+        return val_sprintf_simval_nc(NULL, val, len);
+    }
+
+    /* val_sprintf_simval_nc adds a zero byte after the string */
+    return val_sprintf_simval_nc(buff, val, len);
+
+}  /* get_unique_string */
+
+
+/********************************************************************
+* FUNCTION make_unique_key
+* 
+* Encode the tuple of a unique test set and hash it
+* Each component string is stored with its length, so two
+* sets have the same key only if compare_unique_testsets
+* would find them equal
+*
+* INPUTS:
+*   uset == unique test set to encode
+*
+* OUTPUTS:
+*   uset->key, keylen and hash are set if the tuple can be hashed;
+*   otherwise uset->key is left NULL
+*
+* RETURNS:
+*   status, only fails if a malloc failed
+*********************************************************************/
+static status_t
+    make_unique_key (unique_set_t *uset)
+{
+    val_unique_t *unival;
+    xmlChar      *p;
+    uint32        keylen = 0, len;
+    status_t      res;
+
+    for (unival = (val_unique_t *)dlq_firstEntry(&uset->uniqueQ);
+         unival != NULL;
+         unival = (val_unique_t *)dlq_nextEntry(unival)) {
+        len = 0;
+        res = get_unique_string(unival, NULL, &len);
+        if (res != NO_ERR) {
+            return (res == ERR_INTERNAL_MEM) ? res : NO_ERR;
+        }
+        keylen += sizeof(uint32) + len;
+    }
+
+    /* room for the zero byte after the last sprintf */
+    uset->key = m__getMem(keylen + 1);
+    if (uset->key == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    p = uset->key;
+    for (unival = (val_unique_t *)dlq_firstEntry(&uset->uniqueQ);
+         unival != NULL;
+         unival = (val_unique_t *)dlq_nextEntry(unival)) {
+        len = 0;
+        res = get_unique_string(unival, p + sizeof(uint32), &len);
+        if (res != NO_ERR) {
+            m__free(uset->key);
+            uset->key = NULL;
+            return (res == ERR_INTERNAL_MEM) ? res : NO_ERR;
+        }
+        memcpy(p, &len, sizeof(uint32));
+        p += sizeof(uint32) + len;
+    }
+
+    uset->keylen = keylen;
+    uset->hash = bobhash(uset->key, keylen, UNIQUE_HASH_INIT);
+    return NO_ERR;
+
+}  /* make_unique_key */
+
+
+/********************************************************************
+* FUNCTION hash_unique_sets
+* 
+* Group the hashed unique test sets by tuple and count
+* the later sets with the same tuple for each set
+*
+* INPUTS:
+*   usetQ == Q of unique_set_t to check, in list instance order
+*   setcnt == number of sets in the usetQ
+*
+* OUTPUTS:
+*   uset->dupcnt set for each hashed set in usetQ
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    hash_unique_sets (dlq_hdr_t *usetQ,
+                      uint32 setcnt)
+{
+    unique_set_t **buckets, *uset, *match, *dup;
+    uint32         numbuckets = 16, slot, cnt;
+
+    while (numbuckets < setcnt * 2) {
+        numbuckets *= 2;
+    }
+    buckets = m__getMem(numbuckets * sizeof(unique_set_t *));
+    if (buckets == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(buckets, 0x0, numbuckets * sizeof(unique_set_t *));
+
+    for (uset = (unique_set_t *)dlq_firstEntry(usetQ);
+         uset != NULL;
+         uset = (unique_set_t *)dlq_nextEntry(uset)) {
+
+        if (uset->key == NULL) {
+            continue;
+        }
+
+        slot = uset->hash & (numbuckets - 1);
+        for (match = buckets[slot]; match != NULL; match = match->hashnext) {
+            if (match->hash == uset->hash &&
+                match->keylen == uset->keylen &&
+                !memcmp(match->key, uset->key, uset->keylen)) {
+                break;
+            }
+        }
+
+        if (match == NULL) {
+            uset->hashnext = buckets[slot];
+            buckets[slot] = uset;
+            uset->duplast = uset;
+        } else {
+            /* keep the sets with this tuple in instance order */
+            match->duplast->dupnext = uset;
+            match->duplast = uset;
+        }
+    }
+
+    /* each set in a group matches all the sets after it */
+    for (slot = 0; slot < numbuckets; slot++) {
+        for (match = buckets[slot]; match != NULL; match = match->hashnext) {
+            cnt = 0;
+            for (dup = match; dup != NULL; dup = dup->dupnext) {
+                cnt++;
+            }
+            for (dup = match; dup != NULL; dup = dup->dupnext) {
+                dup->dupcnt = --cnt;
+            }
+        }
+    }
+
+    m__free(buckets);
+    return NO_ERR;
+
+}  /* hash_unique_sets */
+
+
 /********************************************************************
 * FUNCTION one_unique_stmt_check
 * 
@@ -3507,7 +3854,8 @@ static status_t
 {
     dlq_hdr_t        uniQ, freeQ, usetQ;
     val_unique_t    *unival;
-    unique_set_t    *uset;
+    unique_set_t    *uset, *set1, *set2, *fallfirst = NULL, *falllast = NULL;
+    uint32           setcnt = 0, errcnt;
 
     assert( ct && "ct is NULL!" );
     assert( ct->result && "result is NULL!" );
@@ -3545,7 +3893,21 @@ static status_t
             }
             dlq_block_enque(&uniQ, &uset->uniqueQ);
             uset->valnode = valnode;
+            uset->ordinal = setcnt++;
             dlq_enque(uset, &usetQ);
+
+            /* entries that already failed a unique test are skipped */
+            if (valnode->res != ERR_NCX_UNIQUE_TEST_FAILED) {
+                retres = make_unique_key(uset);
+                if (retres == NO_ERR && uset->key == NULL) {
+                    if (falllast) {
+                        falllast->fallnext = uset;
+                    } else {
+                        fallfirst = uset;
+                    }
+                    falllast = uset;
+                }
+            }
         } else if (res == ERR_NCX_CANCELED) {
             dlq_block_enque(&uniQ, &freeQ);
         } else {
@@ -3564,31 +3926,56 @@ static status_t
     }
 
     if (retres == NO_ERR) {
-        /* go through all the test sets and compare them to each other
-         * this is a brute force compare N to N+1 .. last moving N
-         * through the list until all entries have been compared to
-         * each other and all unique violations recorded;
+        retres = hash_unique_sets(&usetQ, setcnt);
+    }
+
+    if (retres == NO_ERR) {
+        /* each set is reported once for every later set with the
+         * same tuple; sets with the same hashed tuple are counted
+         * by hash_unique_sets, and the few sets that could not be
+         * hashed are compared the brute force way, N to N+1 .. last;
          * As compare is done, delete old set1 since no longer needed */
         while (!dlq_empty(&usetQ)) {
-            unique_set_t *set1 = (unique_set_t *)dlq_deque(&usetQ);
-            if (set1 && set1->valnode->res != ERR_NCX_UNIQUE_TEST_FAILED) {
-                unique_set_t *set2 = (unique_set_t *)dlq_firstEntry(&usetQ);
-                for (; set2; set2 = (unique_set_t *)dlq_nextEntry(set2)) {
-                    if (set2->valnode->res == ERR_NCX_UNIQUE_TEST_FAILED) {
-                        // already compared this to rest of list instances
-                        // if it is flagged with a unique-test failed error
-                        continue;
-                    }
-                    if (compare_unique_testsets(&set1->uniqueQ, 
-                                                &set2->uniqueQ)) {
-                        /* 2 lists have the same values so generate an error */
-                        agt_record_unique_error(scb, msg, set1->valnode,
-                                                &set1->uniqueQ);
-                        set1->valnode->res = ERR_NCX_UNIQUE_TEST_FAILED;
-                        retres = ERR_NCX_UNIQUE_TEST_FAILED;
-                    }
+            set1 = (unique_set_t *)dlq_deque(&usetQ);
+            if (set1 == fallfirst) {
+                fallfirst = set1->fallnext;
+            }
+            if (set1->valnode->res == ERR_NCX_UNIQUE_TEST_FAILED) {
+                /* already compared this to rest of list instances
+                 * if it is flagged with a unique-test failed error */
+                free_unique_set(set1);
+                continue;
+            }
+
+            errcnt = set1->dupcnt;
+            if (set1->key) {
+                set2 = fallfirst;
+            } else {
+                set2 = (unique_set_t *)dlq_firstEntry(&usetQ);
+            }
+            while (set2) {
+                if (set2->ordinal > set1->ordinal &&
+                    set2->valnode->res != ERR_NCX_UNIQUE_TEST_FAILED &&
+                    (set1->key == NULL || set2->key == NULL) &&
+                    compare_unique_testsets(&set1->uniqueQ,
+                                            &set2->uniqueQ)) {
+                    errcnt++;
                 }
+                if (set1->key) {
+                    set2 = set2->fallnext;
+                } else {
+                    set2 = (unique_set_t *)dlq_nextEntry(set2);
+                }
+            }
+
+            for (; errcnt > 0; errcnt--) {
+                /* 2 lists have the same values so generate an error */
+                agt_record_unique_error(scb, msg, set1->valnode,
+                                        &set1->uniqueQ);
+                set1->valnode->res = ERR_NCX_UNIQUE_TEST_FAILED;
+                retres = ERR_NCX_UNIQUE_TEST_FAILED;
             }
+
             free_unique_set(set1);
         }
     }
@@ -3704,16 +4091,16 @@ static status_t
          * to 1 of the instances that exists at commit-time
          */
         xpcb = typ_get_leafref_pcb(typdef);
-        if (!val->xpathpcb) {
-            val->xpathpcb = xpath_clone_pcb(xpcb);
-            if (!val->xpathpcb) {
+        if (!VAL_XPATHPCB(val)) {
+            res = val_set_xpathpcb(val, xpath_clone_shared_pcb(xpcb));
+            if (res == NO_ERR && !VAL_XPATHPCB(val)) {
                 res = ERR_INTERNAL_MEM;
             }
         }
 
         if (res == NO_ERR) {
             assert( scb && "scb is NULL!" );
-            result = xpath1_eval_xmlexpr(scb->reader, val->xpathpcb, 
+            result = xpath1_eval_xmlexpr(scb->reader, val->extra->xpathpcb, 
                                          val, root, FALSE, TRUE, &res);
             if (result && res == NO_ERR) {
                 /* check result: the string value in 'val'
@@ -3721,7 +4108,7 @@ static status_t
                  * result set
                  */
                 fnresult = 
-                    xpath1_compare_result_to_string(val->xpathpcb, result, 
+                    xpath1_compare_result_to_string(val->extra->xpathpcb, result, 
                                                     VAL_STR(val), &res);
 
                 if (res == NO_ERR && !fnresult) {
@@ -3748,10 +4135,11 @@ static status_t
         result = NULL;
         constrained = typ_get_constrained(typdef);
 
-        validateres = val->xpathpcb->validateres;
+        validateres = VAL_XPATHPCB(val) ?
+            val->extra->xpathpcb->validateres : ERR_INTERNAL_VAL;
         if (validateres == NO_ERR) {
             assert( scb && "scb is NULL!" );
-            result = xpath1_eval_xmlexpr(scb->reader, val->xpathpcb,
+            result = xpath1_eval_xmlexpr(scb->reader, val->extra->xpathpcb,
                                          val, root, FALSE, FALSE, &res);
             if (result) {
                 xpath_free_result(result);
@@ -4177,7 +4565,7 @@ static status_t
      * first make sure all the mandatory case 
      * objects are present
      */
-    obj_template_t *testobj = obj_first_child(chval->casobj);
+    obj_template_t *testobj = obj_first_child(val_get_casobj(chval));
     for (; testobj != NULL; testobj = obj_next_child(testobj)) {
         res = instance_check(scb, msg, testobj, val, valroot, layer);
         CHK_EXIT(res, retres);
@@ -4187,7 +4575,7 @@ static status_t
     /* check if any objects from other cases are present */
     val_value_t *testval = val_get_choice_next_set(choicobj, chval);
     while (testval) {
-        if (testval->casobj != chval->casobj) {
+        if (val_get_casobj(testval) != val_get_casobj(chval)) {
             /* error: extra case object in this choice */
             retres = res = ERR_NCX_EXTRA_CHOICE;
             agt_record_error(scb, msg, layer, res, NULL, 
@@ -4572,93 +4960,870 @@ static status_t rpc_must_stmt_check ( ses_cb_t *scb,
 
 
 /********************************************************************
- * FUNCTION prep_commit_test_node
- *
- * Update the commit test instances
- *
- * \param scb session control block
- * \param msghdr XML message header in progress
- * \param txcb transaction control block to use
- * \param ct commit test to use
- * \param root <config> node to check
- *
- * \return status
- *********************************************************************/
-static status_t 
-    prep_commit_test_node ( ses_cb_t  *scb,
-                            xml_msg_hdr_t *msghdr,
-                            agt_cfg_transaction_t *txcb,
-                            agt_cfg_commit_test_t *ct,
-                            val_value_t *root )
+* FUNCTION find_changed
+* 
+* Find the slot for a pointer in a changed node table
+*
+* INPUTS:
+*    tab == table to search
+*    ptr == object or data node to find
+*
+* RETURNS:
+*    pointer to the slot with this pointer, or the empty slot
+*    where it would go; NULL if the table is empty
+*********************************************************************/
+static changed_ptr_t *
+    find_changed (changed_tab_t *tab,
+                  const void *ptr)
 {
-    status_t res = NO_ERR;
+    uint32  slot;
 
-   /* first get all the instances of this object if needed */
-    if (ct->result) {
-        if (ct->result_txid == txcb->txid) {
-            log_debug3("\nReusing XPath result for %s", ct->objpcb->exprstr);
-        } else {
-            /* TBD: figure out if older TXIDs are still valid
-             * for this XPath expression  */
-            log_debug3("\nGet all instances of %s", ct->objpcb->exprstr);
-            xpath_free_result(ct->result);
-            ct->result = NULL;
-        }
+    if (tab->slots == NULL) {
+        return NULL;
     }
 
-    if (ct->result == NULL) {
-        ct->result_txid = 0;
-        ct->result = xpath1_eval_expr(ct->objpcb, root, root, FALSE, 
-                                      TRUE, &res);
-        if (res != NO_ERR || ct->result->restype != XP_RT_NODESET) {
-            if (res == NO_ERR) {
-                res = ERR_NCX_WRONG_NODETYP;
-            }
-            agt_record_error(scb, msghdr, NCX_LAYER_CONTENT, res, NULL,
-                             NCX_NT_NONE, NULL, NCX_NT_OBJ, ct->obj);
-        } else {
-            ct->result_txid = txcb->txid;
-        }
+    slot = (uint32)(((size_t)ptr >> 4) * 0x9e3779b1) & (tab->size - 1);
+    while (tab->slots[slot].ptr != NULL && tab->slots[slot].ptr != ptr) {
+        slot = (slot + 1) & (tab->size - 1);
     }
+    return &tab->slots[slot];
 
-    return res;
-
-} /* prep_commit_test_node */
+}  /* find_changed */
 
 
 /********************************************************************
- * 
- * Delete all the nodes that have false when-stmt exprs
- * Also delete empty NP-containers
- *
- * \param scb session control block (may be NULL)
- * \param msghdr XML message header in progress
- * \param txcb transaction control block to use
- * \param root root from the target database to use
- * \param retcount address of return deletecount
- * \return status
- *********************************************************************/
-static status_t delete_dead_nodes ( ses_cb_t  *scb,
-                                    xml_msg_hdr_t *msghdr,
-                                    agt_cfg_transaction_t *txcb,
-                                    val_value_t *root,
-                                    uint32 *retcount )
+* FUNCTION is_changed
+* 
+* Get the flags for a pointer in a changed node table
+*
+* INPUTS:
+*    tab == table to search
+*    ptr == object or data node to find
+*
+* RETURNS:
+*    CHG_FL_FOO bits; 0 if not found
+*********************************************************************/
+static uint32
+    is_changed (changed_tab_t *tab,
+                const void *ptr)
 {
-    *retcount = 0;
+    changed_ptr_t *chg = find_changed(tab, ptr);
 
-    agt_profile_t *profile = agt_get_profile();
-    agt_cfg_commit_test_t *ct = (agt_cfg_commit_test_t *)
-        dlq_firstEntry(&profile->agt_commit_testQ);
+    return (chg && chg->ptr) ? chg->flags : 0;
 
-    for (; ct != NULL; ct = (agt_cfg_commit_test_t *)dlq_nextEntry(ct)) {
-        uint32  tests = ct->testflags & AGT_TEST_FL_WHEN;
-        if (tests == 0) {
+}  /* is_changed */
+
+
+/********************************************************************
+* FUNCTION set_changed
+* 
+* Set flags for a pointer in a changed node table,
+* adding it if needed
+*
+* INPUTS:
+*    tab == table to use
+*    ptr == object or data node to add
+*    flags == CHG_FL_FOO bits to set
+*    oldflags == address of return previous flags
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    set_changed (changed_tab_t *tab,
+                 const void *ptr,
+                 uint32 flags,
+                 uint32 *oldflags)
+{
+    changed_tab_t  newtab;
+    changed_ptr_t *chg;
+    uint32         i;
+
+    /* keep the table at most half full */
+    if (tab->slots == NULL || (tab->count + 1) * 2 > tab->size) {
+        newtab.size = (tab->slots) ? tab->size * 2 : CHG_TAB_MIN_SIZE;
+        newtab.count = tab->count;
+        newtab.slots = m__getMem(newtab.size * sizeof(changed_ptr_t));
+        if (newtab.slots == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        memset(newtab.slots, 0x0, newtab.size * sizeof(changed_ptr_t));
+
+        for (i = 0; i < tab->size; i++) {
+            if (tab->slots[i].ptr) {
+                *find_changed(&newtab, tab->slots[i].ptr) = tab->slots[i];
+            }
+        }
+        if (tab->slots) {
+            m__free(tab->slots);
+        }
+        *tab = newtab;
+    }
+
+    chg = find_changed(tab, ptr);
+    if (chg->ptr == NULL) {
+        chg->ptr = ptr;
+        chg->flags = 0;
+        tab->count++;
+    }
+    *oldflags = chg->flags;
+    chg->flags |= flags;
+    return NO_ERR;
+
+}  /* set_changed */
+
+
+/********************************************************************
+* FUNCTION clean_changed
+* 
+* Free the slots in a changed node table
+*
+* INPUTS:
+*    tab == table to clean
+*********************************************************************/
+static void
+    clean_changed (changed_tab_t *tab)
+{
+    if (tab->slots) {
+        m__free(tab->slots);
+    }
+    memset(tab, 0x0, sizeof(changed_tab_t));
+
+}  /* clean_changed */
+
+
+/********************************************************************
+* FUNCTION add_changed_obj
+* 
+* Record that some instances of an object were created,
+* deleted or edited, and that its ancestors have changed
+* descendants
+*
+* INPUTS:
+*    obj == object to add
+*
+* RETURNS:
+*    status; ERR_NCX_SKIPPED if the config root was edited
+*********************************************************************/
+static status_t
+    add_changed_obj (obj_template_t *obj)
+{
+    uint32    oldflags;
+    status_t  res;
+
+    if (obj_is_root(obj)) {
+        return ERR_NCX_SKIPPED;
+    }
+
+    res = set_changed(&chg_objtab, obj, CHG_FL_SELF, &oldflags);
+
+    for (obj = obj->parent;
+         obj != NULL && !obj_is_root(obj) && res == NO_ERR;
+         obj = obj->parent) {
+        res = set_changed(&chg_objtab, obj, CHG_FL_DESC, &oldflags);
+        if (oldflags & CHG_FL_DESC) {
+            /* the rest of the ancestors are already marked */
+            break;
+        }
+    }
+    return res;
+
+}  /* add_changed_obj */
+
+
+/********************************************************************
+* FUNCTION add_changed_val
+* 
+* Record a data node that was edited but is not marked dirty,
+* so the commit tests can find the instances it changed
+*
+* INPUTS:
+*    val == edited node
+*
+* RETURNS:
+*    status; ERR_NCX_SKIPPED if the config root was edited
+*********************************************************************/
+static status_t
+    add_changed_val (val_value_t *val)
+{
+    uint32    oldflags;
+    status_t  res;
+
+    res = add_changed_obj(val->obj);
+    if (res == NO_ERR) {
+        res = set_changed(&chg_valtab, val, CHG_FL_SELF, &oldflags);
+    }
+
+    for (val = val->parent;
+         val != NULL && !obj_is_root(val->obj) && res == NO_ERR;
+         val = val->parent) {
+        res = set_changed(&chg_valtab, val, CHG_FL_DESC, &oldflags);
+        if (oldflags & CHG_FL_DESC) {
+            break;
+        }
+    }
+    return res;
+
+}  /* add_changed_val */
+
+
+/********************************************************************
+* FUNCTION obj_changed
+* 
+* Check if any instance of an object, or any node in
+* the subtree of an instance, could have changed
+*
+* INPUTS:
+*    obj == object to check
+*
+* RETURNS:
+*    TRUE if the object might have changed; FALSE if not
+*********************************************************************/
+static boolean
+    obj_changed (obj_template_t *obj)
+{
+    uint32  flags;
+
+    if (is_changed(&chg_objtab, obj)) {
+        return TRUE;
+    }
+
+    /* an edited or deleted ancestor covers the whole subtree */
+    for (obj = obj->parent;
+         obj != NULL && !obj_is_root(obj);
+         obj = obj->parent) {
+        flags = is_changed(&chg_objtab, obj);
+        if (flags) {
+            return (flags & CHG_FL_SELF) ? TRUE : FALSE;
+        }
+    }
+    return FALSE;
+
+}  /* obj_changed */
+
+
+/********************************************************************
+* FUNCTION obj_instances_changed
+* 
+* Check if any instance of an object could have been
+* created or deleted
+*
+* INPUTS:
+*    obj == object to check
+*
+* RETURNS:
+*    TRUE if the object instances might have changed; FALSE if not
+*********************************************************************/
+static boolean
+    obj_instances_changed (obj_template_t *obj)
+{
+    for (; obj != NULL && !obj_is_root(obj); obj = obj->parent) {
+        if (is_changed(&chg_objtab, obj) & CHG_FL_SELF) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+
+}  /* obj_instances_changed */
+
+
+/********************************************************************
+* FUNCTION add_dirty_objs
+* 
+* Add the objects of the dirty nodes in a subtree of the
+* candidate config to the changed object table
+* Only the subtrees with changes are visited
+*
+* INPUTS:
+*    val == parent node to check
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    add_dirty_objs (val_value_t *val)
+{
+    val_value_t *chval;
+    status_t     res = NO_ERR;
+
+    for (chval = val_get_first_child(val);
+         chval != NULL && res == NO_ERR;
+         chval = val_get_next_child(chval)) {
+
+        if (val_get_dirty_flag(chval) ||
+            val_get_child_deleted_flag(chval)) {
+            res = add_changed_obj(chval->obj);
+        } else if (val_get_subtree_dirty_flag(chval)) {
+            res = add_dirty_objs(chval);
+        }
+    }
+    return res;
+
+}  /* add_dirty_objs */
+
+
+/********************************************************************
+* FUNCTION add_root_deletes
+* 
+* Add the objects of the top-level nodes that are in the
+* running config but not in the candidate config
+*
+* INPUTS:
+*    root == candidate config root
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    add_root_deletes (val_value_t *root)
+{
+    cfg_template_t *running;
+    val_value_t    *runval;
+    status_t        res = NO_ERR;
+
+    running = cfg_get_config_id(NCX_CFGID_RUNNING);
+    if (running == NULL || running->root == NULL || running->root == root) {
+        return NO_ERR;
+    }
+
+    for (runval = val_get_first_child(running->root);
+         runval != NULL && res == NO_ERR;
+         runval = val_get_next_child(runval)) {
+
+        if (is_changed(&chg_objtab, runval->obj) & CHG_FL_SELF) {
+            continue;
+        }
+        if (val_first_child_match(root, runval) == NULL) {
+            res = add_changed_obj(runval->obj);
+        }
+    }
+    return res;
+
+}  /* add_root_deletes */
+
+
+/********************************************************************
+* FUNCTION add_undo_vals
+* 
+* Add the nodes edited by each undo record in the
+* transaction to the changed node tables
+*
+* INPUTS:
+*    txcb == transaction control block to use
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    add_undo_vals (agt_cfg_transaction_t *txcb)
+{
+    agt_cfg_undo_rec_t *undo;
+    agt_cfg_nodeptr_t  *nodeptr;
+    status_t            res = NO_ERR;
+
+    for (undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
+         undo != NULL && res == NO_ERR;
+         undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+
+        if (undo->newnode) {
+            res = add_changed_val(undo->newnode);
+        }
+        if (res == NO_ERR && undo->curnode) {
+            res = add_changed_val(undo->curnode);
+        }
+
+        for (nodeptr = (agt_cfg_nodeptr_t *)
+                 dlq_firstEntry(&undo->extra_deleteQ);
+             nodeptr != NULL && res == NO_ERR;
+             nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+            if (nodeptr->node) {
+                res = add_changed_val(nodeptr->node);
+            }
+        }
+    }
+    return res;
+
+}  /* add_undo_vals */
+
+
+/********************************************************************
+* FUNCTION clear_changed_objs
+* 
+* Free the changed node tables
+*********************************************************************/
+static void
+    clear_changed_objs (void)
+{
+    clean_changed(&chg_objtab);
+    clean_changed(&chg_valtab);
+    chg_valid = FALSE;
+    chg_usedirty = FALSE;
+
+}  /* clear_changed_objs */
+
+
+/********************************************************************
+* FUNCTION build_changed_objs
+* 
+* Fill in the changed node tables for a transaction
+* The tables are left invalid (and every commit test is run)
+* unless the running config has been validated and the
+* edits can be found from the undo records or the dirty flags
+*
+* <commit> and <validate> on the candidate use the dirty flags
+* in the candidate.  An <edit-config> uses the undo records,
+* since the dirty flags are only set when the edit is committed.
+* A <validate> on the running config or on inline <config>
+* contents has no edit list and always runs all the tests.
+*
+* INPUTS:
+*    txcb == transaction control block to use
+*    root == config root being checked
+*********************************************************************/
+static void
+    build_changed_objs (agt_cfg_transaction_t *txcb,
+                        val_value_t *root)
+{
+    agt_profile_t     *profile = agt_get_profile();
+    agt_cfg_nodeptr_t *nodeptr;
+    status_t           res = NO_ERR;
+    boolean            useundo = FALSE, usedirty = FALSE;
+
+    clear_changed_objs();
+
+    if (profile->agt_config_state != AGT_CFG_STATE_OK ||
+        profile->agt_full_validate) {
+        return;
+    }
+
+    if (txcb->cfg_id == NCX_CFGID_RUNNING) {
+        if (txcb->commitcheck) {
+            /* called from <commit>; the root is candidate->root */
+            usedirty = TRUE;
+        } else if (txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL) {
+            /* called from <edit-config> on the running config */
+            useundo = TRUE;
+        }
+    } else if (txcb->cfg_id == NCX_CFGID_CANDIDATE) {
+        if (txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL) {
+            /* called from <validate> on the candidate */
+            usedirty = TRUE;
+        } else if (txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL) {
+            /* called from <edit-config>; the edits in this
+             * request are not marked dirty yet   */
+            useundo = TRUE;
+            usedirty = TRUE;
+        }
+    }
+
+    if (!useundo && !usedirty) {
+        return;
+    }
+
+    if (useundo) {
+        res = add_undo_vals(txcb);
+    }
+
+    if (res == NO_ERR && usedirty) {
+        res = add_dirty_objs(root);
+        if (res == NO_ERR && val_get_child_deleted_flag(root)) {
+            res = add_root_deletes(root);
+        }
+    }
+
+    /* nodes removed because of a false when-stmt are not dirty */
+    for (nodeptr = (agt_cfg_nodeptr_t *)dlq_firstEntry(&txcb->deadnodeQ);
+         nodeptr != NULL && res == NO_ERR;
+         nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+        if (nodeptr->node) {
+            res = add_changed_val(nodeptr->node);
+        }
+    }
+
+    if (res != NO_ERR) {
+        clear_changed_objs();
+        return;
+    }
+
+    chg_valid = TRUE;
+    chg_usedirty = usedirty;
+
+}  /* build_changed_objs */
+
+
+/********************************************************************
+* FUNCTION commit_test_deps_changed
+* 
+* Check if any object read by the must, when or leafref
+* tests of a commit test could have changed
+*
+* INPUTS:
+*    ct == commit test to check
+*
+* RETURNS:
+*    TRUE if a dependency might have changed; FALSE if not
+*********************************************************************/
+static boolean
+    commit_test_deps_changed (agt_cfg_commit_test_t *ct)
+{
+    xpath_objdep_t *dep;
+
+    if (!chg_valid || ct->anydep) {
+        return TRUE;
+    }
+
+    for (dep = (xpath_objdep_t *)dlq_firstEntry(&ct->objdepQ);
+         dep != NULL;
+         dep = (xpath_objdep_t *)dlq_nextEntry(dep)) {
+        if (dep->pathonly) {
+            if (obj_instances_changed(dep->obj)) {
+                return TRUE;
+            }
+        } else if (obj_changed(dep->obj)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+
+}  /* commit_test_deps_changed */
+
+
+/********************************************************************
+* FUNCTION commit_test_needed
+* 
+* Check if a commit test could have a different result
+* than it had for the running config, based on the objects
+* changed by the transaction
+*
+* INPUTS:
+*    ct == commit test to check
+*
+* RETURNS:
+*    TRUE if the test needs to be run; FALSE if it can be skipped
+*********************************************************************/
+static boolean
+    commit_test_needed (agt_cfg_commit_test_t *ct)
+{
+    if (!chg_valid || obj_changed(ct->obj)) {
+        return TRUE;
+    }
+    return commit_test_deps_changed(ct);
+
+}  /* commit_test_needed */
+
+
+/********************************************************************
+* FUNCTION add_changed_instances
+* 
+* Get the instances of a commit test object that are new,
+* or have a changed node in their subtree, by following the
+* dirty flags and the edited nodes down from the config root
+*
+* INPUTS:
+*    ct == commit test to use
+*    val == parent node to check
+*    replaced == TRUE if val is a new or replaced node
+*    nodeQ == Q of agt_cfg_nodeptr_t to add the instances to
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    add_changed_instances (agt_cfg_commit_test_t *ct,
+                           val_value_t *val,
+                           boolean replaced,
+                           dlq_hdr_t *nodeQ)
+{
+    val_value_t       *chval;
+    obj_template_t    *testobj;
+    agt_cfg_nodeptr_t *nodeptr;
+    uint32             flags;
+    boolean            chreplaced;
+    status_t           res = NO_ERR;
+
+    for (chval = val_get_first_child(val);
+         chval != NULL && res == NO_ERR;
+         chval = val_get_next_child(chval)) {
+
+        if (VAL_IS_DELETED(chval)) {
+            continue;
+        }
+
+        flags = (replaced) ? 0 : is_changed(&chg_valtab, chval);
+        chreplaced = (replaced || (flags & CHG_FL_SELF) ||
+                      (chg_usedirty && val_get_dirty_flag(chval)));
+        if (!chreplaced && !flags &&
+            !(chg_usedirty && (val_dirty_subtree(chval) ||
+                               val_get_child_deleted_flag(chval)))) {
+            continue;
+        }
+
+        if (chval->obj == ct->obj) {
+            nodeptr = agt_cfg_new_nodeptr(chval);
+            if (nodeptr == NULL) {
+                return ERR_INTERNAL_MEM;
+            }
+            dlq_enque(nodeptr, nodeQ);
+            continue;
+        }
+
+        /* only go down the path to the commit test object */
+        for (testobj = ct->obj->parent;
+             testobj != NULL && testobj != chval->obj;
+             testobj = testobj->parent) {
+            ;
+        }
+        if (testobj != NULL) {
+            res = add_changed_instances(ct, chval, chreplaced, nodeQ);
+        }
+    }
+    return res;
+
+}  /* add_changed_instances */
+
+
+/********************************************************************
+* FUNCTION add_commit_test_deps
+* 
+* Add the objects read by one XPath expression to
+* the dependency list of a commit test
+*
+* INPUTS:
+*    ct == commit test to use
+*    pcb == must or when expression from the schema
+*    islocal == address of return local flag
+*
+* OUTPUTS:
+*    ct->objdepQ has the objects added to it
+*    ct->anydep is set if the objects cannot be found
+*    *islocal is set to TRUE if the expression only reads
+*       the subtree of its context node
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    add_commit_test_deps (agt_cfg_commit_test_t *ct,
+                          xpath_pcb_t *pcb,
+                          boolean *islocal)
+{
+    status_t res;
+
+    res = xpath1_get_obj_deps(pcb, &ct->objdepQ, islocal);
+    if (res == ERR_NCX_SKIPPED) {
+        ct->anydep = TRUE;
+        *islocal = FALSE;
+        res = NO_ERR;
+    }
+    return res;
+
+}  /* add_commit_test_deps */
+
+
+/********************************************************************
+* FUNCTION get_commit_test_deps
+* 
+* Find the objects that the must, when and leafref tests
+* of a commit test read, so the test can be skipped if
+* none of them have changed
+*
+* The when-stmts are found the same way as val_check_obj_when,
+* including the ones inherited from uses, augment, choice
+* and case statements.
+*
+* INPUTS:
+*    ct == commit test to fill in
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    get_commit_test_deps (agt_cfg_commit_test_t *ct)
+{
+    obj_template_t  *obj = ct->obj, *testobj, *targobj;
+    xpath_pcb_t     *pcb;
+    obj_xpath_ptr_t *xptr;
+    xpath_objdep_t  *dep;
+    dlq_hdr_t       *mustQ;
+    boolean          islocal;
+    status_t         res = NO_ERR;
+
+    ct->localdeps = TRUE;
+
+    if (ct->testflags & AGT_TEST_FL_MUST) {
+        mustQ = obj_get_mustQ(obj);
+        for (pcb = (mustQ) ? (xpath_pcb_t *)dlq_firstEntry(mustQ) : NULL;
+             pcb != NULL && res == NO_ERR;
+             pcb = (xpath_pcb_t *)dlq_nextEntry(pcb)) {
+            res = add_commit_test_deps(ct, pcb, &islocal);
+            if (!islocal) {
+                ct->localdeps = FALSE;
+            }
+        }
+    }
+
+    if (res == NO_ERR && (ct->testflags & AGT_TEST_FL_WHEN)) {
+        if (obj->when) {
+            res = add_commit_test_deps(ct, obj->when, &islocal);
+        }
+        for (xptr = obj_first_xpath_ptr(obj);
+             xptr != NULL && res == NO_ERR;
+             xptr = obj_next_xpath_ptr(xptr)) {
+            res = add_commit_test_deps(ct, xptr->xpath, &islocal);
+        }
+        for (testobj = obj->parent;
+             testobj != NULL && res == NO_ERR &&
+                 (testobj->objtype == OBJ_TYP_CHOICE ||
+                  testobj->objtype == OBJ_TYP_CASE);
+             testobj = testobj->parent) {
+            if (testobj->when) {
+                res = add_commit_test_deps(ct, testobj->when, &islocal);
+            }
+            for (xptr = obj_first_xpath_ptr(testobj);
+                 xptr != NULL && res == NO_ERR;
+                 xptr = obj_next_xpath_ptr(xptr)) {
+                res = add_commit_test_deps(ct, xptr->xpath, &islocal);
+            }
+        }
+    }
+
+    if (res == NO_ERR && (ct->testflags & AGT_TEST_FL_XPATH_TYPE)) {
+        /* a leafref path without predicates only reads the
+         * target leaf; anything else is always checked  */
+        pcb = (ct->btyp == NCX_BT_LEAFREF) ?
+            typ_get_leafref_pcb(obj_get_typdef(obj)) : NULL;
+        targobj = (pcb) ? obj_get_leafref_targobj(obj) : NULL;
+        if (targobj == NULL || pcb->exprstr == NULL ||
+            strchr((const char *)pcb->exprstr, '[') != NULL) {
+            ct->anydep = TRUE;
+        } else {
+            for (dep = (xpath_objdep_t *)dlq_firstEntry(&ct->objdepQ);
+                 dep != NULL && dep->obj != targobj;
+                 dep = (xpath_objdep_t *)dlq_nextEntry(dep)) {
+                ;
+            }
+            if (dep == NULL) {
+                dep = m__getObj(xpath_objdep_t);
+                if (dep == NULL) {
+                    return ERR_INTERNAL_MEM;
+                }
+                memset(dep, 0x0, sizeof(xpath_objdep_t));
+                dep->obj = targobj;
+                dlq_enque(dep, &ct->objdepQ);
+            }
+        }
+    }
+
+    return res;
+
+}  /* get_commit_test_deps */
+
+
+/********************************************************************
+ * FUNCTION prep_commit_test_node
+ *
+ * Update the commit test instances
+ *
+ * \param scb session control block
+ * \param msghdr XML message header in progress
+ * \param txcb transaction control block to use
+ * \param ct commit test to use
+ * \param root <config> node to check
+ *
+ * \return status
+ *********************************************************************/
+static status_t 
+    prep_commit_test_node ( ses_cb_t  *scb,
+                            xml_msg_hdr_t *msghdr,
+                            agt_cfg_transaction_t *txcb,
+                            agt_cfg_commit_test_t *ct,
+                            val_value_t *root )
+{
+    status_t res = NO_ERR;
+
+   /* first get all the instances of this object if needed */
+    if (ct->result) {
+        if (ct->result_txid == txcb->txid) {
+            log_debug3("\nReusing XPath result for %s", ct->objpcb->exprstr);
+        } else {
+            /* TBD: figure out if older TXIDs are still valid
+             * for this XPath expression  */
+            log_debug3("\nGet all instances of %s", ct->objpcb->exprstr);
+            xpath_free_result(ct->result);
+            ct->result = NULL;
+        }
+    }
+
+    if (ct->result == NULL) {
+        ct->result_txid = 0;
+        ct->result = xpath1_eval_expr(ct->objpcb, root, root, FALSE, 
+                                      TRUE, &res);
+        if (res != NO_ERR || ct->result->restype != XP_RT_NODESET) {
+            if (res == NO_ERR) {
+                res = ERR_NCX_WRONG_NODETYP;
+            }
+            agt_record_error(scb, msghdr, NCX_LAYER_CONTENT, res, NULL,
+                             NCX_NT_NONE, NULL, NCX_NT_OBJ, ct->obj);
+        } else {
+            ct->result_txid = txcb->txid;
+        }
+    }
+
+    return res;
+
+} /* prep_commit_test_node */
+
+
+/********************************************************************
+ * 
+ * Delete all the nodes that have false when-stmt exprs
+ * Also delete empty NP-containers
+ *
+ * \param scb session control block (may be NULL)
+ * \param msghdr XML message header in progress
+ * \param txcb transaction control block to use
+ * \param root root from the target database to use
+ * \param prune TRUE to skip the when-stmts that do not read
+ *              any object changed by the transaction
+ * \param retcount address of return deletecount
+ * \return status
+ *********************************************************************/
+static status_t delete_dead_nodes ( ses_cb_t  *scb,
+                                    xml_msg_hdr_t *msghdr,
+                                    agt_cfg_transaction_t *txcb,
+                                    val_value_t *root,
+                                    boolean prune,
+                                    uint32 *retcount )
+{
+    *retcount = 0;
+
+    if (prune) {
+        build_changed_objs(txcb, root);
+    }
+
+    agt_profile_t *profile = agt_get_profile();
+    agt_cfg_commit_test_t *ct = (agt_cfg_commit_test_t *)
+        dlq_firstEntry(&profile->agt_commit_testQ);
+
+    for (; ct != NULL; ct = (agt_cfg_commit_test_t *)dlq_nextEntry(ct)) {
+        uint32  tests = ct->testflags & AGT_TEST_FL_WHEN;
+        if (tests == 0) {
             /* no when-stmt tests needed for this node */
             continue;
         }
 
+        if (prune && !commit_test_needed(ct)) {
+            if (LOGDEBUG3) {
+                log_debug3("\ndelete_dead_nodes: skip when test %s:%s",
+                           obj_get_mod_name(ct->obj),
+                           obj_get_name(ct->obj));
+            }
+            continue;
+        }
+
         status_t res = prep_commit_test_node(scb, msghdr, txcb, ct, root);
         if (res != NO_ERR) {
+            clear_changed_objs();
             return res;
         }
 
@@ -4672,6 +5837,7 @@ static status_t delete_dead_nodes ( ses_cb_t  *scb,
             res = run_when_stmt_check(scb, msghdr, txcb, root, valnode);
             if (res != NO_ERR) {
                 /* treat any when delete error as terminate transaction */
+                clear_changed_objs();
                 return res;
             } else if (VAL_IS_DELETED(valnode)) {
                 /* this node has just been flagged when=FALSE so
@@ -4683,6 +5849,7 @@ static status_t delete_dead_nodes ( ses_cb_t  *scb,
         }
     }
 
+    clear_changed_objs();
     return NO_ERR;
 
 }  /* delete_dead_nodes */
@@ -4868,10 +6035,21 @@ static status_t
         ct->obj = obj;
         ct->btyp = btyp;
         ct->testflags = testflags;
+
+        res = get_commit_test_deps(ct);
+        if (res != NO_ERR) {
+            agt_cfg_free_commit_test(ct);
+            return res;
+        }
+
         dlq_enque(ct, commit_testQ);
         if (LOGDEBUG4) {
-            log_debug4("\nAdded commit_test record for %s testflags=0x%08X",
-                       ct->objpcb->exprstr, testflags);
+            log_debug4("\nAdded commit_test record for %s testflags=0x%08X "
+                       "deps=%u%s%s",
+                       ct->objpcb->exprstr, testflags,
+                       dlq_count(&ct->objdepQ),
+                       (ct->anydep) ? " any" : "",
+                       (ct->localdeps) ? " local" : "");
         }
     }
 
@@ -4889,221 +6067,6 @@ static status_t
 } /* add_obj_commit_tests */
 
 
-/********************************************************************
-* FUNCTION check_prune_obj
-* 
-* Check if the specified object test can be reduced or eliminated
-* from the current commit test
-*
-* INPUTS:
-*    obj == commit test object to check; must not be root!
-*    rootval == config root to check
-*    curflags == current test flags
-* RETURNS:
-*  new testflags or unchanged test flags
-*********************************************************************/
-static uint32
-    check_prune_obj (obj_template_t *obj,
-                     val_value_t *rootval,
-                     uint32 curflags)
-{
-    /* for now just check the top level object to see if
-     * this subtree could have possibly changed;
-     * TBD: come up with fast way to check more, that does
-     * take as much time as just using XPath to get these objects  */
-    boolean done = FALSE;
-    obj_template_t *testobj = obj;
-    while (!done) {
-        if (testobj->parent && !obj_is_root(testobj->parent)) {
-            testobj = testobj->parent;
-        } else {
-            done = TRUE;
-        }
-    }
-
-    /* find this object in the rootval */
-    val_value_t *testval = val_find_child(rootval, obj_get_mod_name(testobj),
-                                          obj_get_name(testobj));
-    if (testval) {
-        switch (testobj->objtype) {
-        case OBJ_TYP_LEAF:
-        case OBJ_TYP_ANYXML:
-        case OBJ_TYP_CONTAINER:
-            if (val_dirty_subtree(testval)) {
-                /* do not skip this node */
-                return curflags;
-            }
-            break;
-        default:
-            done = FALSE;
-            while (!done) {
-                if (val_dirty_subtree(testval)) {
-                    /* do not skip this node */
-                    return curflags;
-                } else {
-                    testval = 
-                        val_find_next_child(rootval, obj_get_mod_name(testobj),
-                                            obj_get_name(testobj), testval);
-                    if (testval == NULL) {
-                        done = TRUE;
-                    }
-                }
-            }
-        }
-    }
-
-    /* skip this node for all tests, since no instances of
-     * the top-level object exist which might have been changed
-     * Relying on the fact that the root-check is always done for
-     * the root node (on the top-level YANG data nodes, so
-     * any instance or mandatory tests on the top-node will
-     * always be done     */
-    //return 0;
-
-    /* xpath tests can depend on any top level container */
-    return (curflags & AGT_TEST_FL_XPATH_TYPE);
-
-} /* check_prune_obj */
-
-
-/********************************************************************
-* FUNCTION check_no_prune_curedit
-* 
-* Check if the specified object test is needed from the current 
-* commit test, based on the current edit in the undo record
-*
-* INPUTS:
-*   undo == edit operation to check
-*   obj == commit test object to check; must not be root!
-* RETURNS:
-*  TRUE if found and test needed; FALSE if not found
-*********************************************************************/
-static boolean
-    check_no_prune_curedit (agt_cfg_undo_rec_t *undo,
-                            obj_template_t *obj)
-{
-    obj_template_t *editobj = (undo->newnode) ? undo->newnode->obj :
-        ((undo->curnode) ? undo->curnode->obj : NULL);
-    if (editobj == NULL) {
-        return FALSE;
-    }
-
-    /* see if the commit test object is a descendant of
-     * the edit object, but only if not deleting the edit
-     * object; do not trigger descendant test on a delete  */
-    boolean done = (undo->editop == OP_EDITOP_DELETE);
-    obj_template_t *testobj = obj;
-    while (!done) {
-        if (editobj == testobj) {
-            return TRUE;   // do not prune this object test
-        }
-
-        if (testobj->parent && !obj_is_root(testobj->parent)) {
-            testobj = testobj->parent;
-        } else {
-            done = TRUE;
-        }
-    }
-
-    /* see if the edit object is a descendant of the commit test object */
-    done = FALSE;
-    while (!done) {
-        if (editobj == obj) {
-            return TRUE;   // do not prune this object test
-        }
-
-        if (editobj->parent && !obj_is_root(editobj->parent)) {
-            editobj = editobj->parent;
-        } else {
-            done = TRUE;
-        }
-    }
-
-    return FALSE;
-
-} /* check_no_prune_curedit */
-
-
-/********************************************************************
-* FUNCTION prune_obj_commit_tests
-* 
-* Check if the specified object test can be reduced or elimated
-* from the current commit test
-*
-* INPUTS:
-*
-* OUTPUTS:
-*  *testflags will be altered
-* RETURNS:
-*  new (or unchanged) test flags
-*********************************************************************/
-static uint32
-    prune_obj_commit_tests (agt_cfg_transaction_t *txcb,
-                            agt_cfg_commit_test_t *ct,
-                            val_value_t *rootval,
-                            uint32 curflags)
-{
-    if (curflags & AGT_TEST_FL_MUST) {
-        /* do not prune a must-stmt test since the XPath expression
-         * may reference any arbitrary data node    */
-        return curflags;
-    }
-
-    agt_cfg_undo_rec_t *undo = NULL;
-    if (txcb->cfg_id == NCX_CFGID_RUNNING) {
-        if (txcb->commitcheck) {
-            /* called from <commit> 
-             * look for dirty or subtree dirty flags in the rootval
-             * this rootval is reallt candidate->root, so it is
-             * OK to check the dirty flags    */
-            curflags = check_prune_obj(ct->obj, rootval, curflags);
-        } else {
-            if (txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL) {
-                /* called from <validate> on external <config> element;
-                 * <copy-config> is not supported on the running config
-                 * so there is nothing to do for now; do not prune;
-                 * force a full test for <validate>   */
-            } else if (txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL) {
-                /* called from <edit-config> on running config;
-                 * check the edit list; only nodes that have been
-                 * edited need to run a commit test   */
-                undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
-                while (undo) {
-                    if (check_no_prune_curedit(undo, ct->obj)) {
-                        return curflags;
-                    }
-                    undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo);
-                }
-                curflags = 0;
-            } // else unknown edit-type! do not prune
-        }
-    } else if (txcb->cfg_id == NCX_CFGID_CANDIDATE) {
-        if (txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL) {
-            /* called from <validate> operation on the <candidate> config */
-            curflags = check_prune_obj(ct->obj, rootval, curflags);
-        } else if (txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL) {
-            /* called from <edit-config> with test-option=set-then-test
-             * first check all the current edits; because the dirty flags
-             * for any edits from this <rpc> have not been set yet */
-            undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
-            while (undo) {
-                if (check_no_prune_curedit(undo, ct->obj)) {
-                    return curflags;
-                }
-                undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo);
-            }
-
-            /* did not find the object in the current edits so check
-             * pending edits (dirty flags) on the candidate->root target */
-            curflags = check_prune_obj(ct->obj, rootval, curflags);
-        } // else unknown edit-type! do not prune!
-    } // else unknown config target! do not prune!
-
-    return curflags;
-
-} /* prune_obj_commit_tests */
-
-
 /********************************************************************
 * FUNCTION run_instance_check
 * 
@@ -5308,6 +6271,77 @@ static status_t
 }  /* run_obj_commit_tests */
 
 
+/********************************************************************
+* FUNCTION run_changed_commit_tests
+* 
+* Run the commit tests for one object on the instances
+* that are new or have changes in their subtree
+* Only used if the dirty flags in the root show all the
+* changes in the transaction
+*
+* INPUTS:
+*   profile == agt_profile pointer
+*   scb == session control block (may be NULL; no session stats)
+*   msghdr == XML message header in progress 
+*          == NULL MEANS NO RPC-ERRORS ARE RECORDED
+*   ct == commit test record to use
+*   root == root of the data tree to use
+*   testmask == bitmask of the tests that are requested
+*
+* OUTPUTS:
+*   if msghdr not NULL:
+*      msghdr->msg_errQ may have rpc_err_rec_t 
+*      structs added to it which must be freed by the 
+*      caller with the rpc_err_free_record function
+*
+* RETURNS:
+*   status of the operation, NO_ERR if no validation errors found
+*********************************************************************/
+static status_t 
+    run_changed_commit_tests (agt_profile_t *profile,
+                              ses_cb_t *scb,
+                              xml_msg_hdr_t *msghdr,
+                              agt_cfg_commit_test_t *ct,
+                              val_value_t *root,
+                              uint32 testmask)
+{
+    dlq_hdr_t          nodeQ;
+    agt_cfg_nodeptr_t *nodeptr;
+    status_t           res, retres;
+    boolean            done;
+
+    dlq_createSQue(&nodeQ);
+
+    retres = add_changed_instances(ct, root, FALSE, &nodeQ);
+
+    if (LOGDEBUG3) {
+        log_debug3("\nrun_root_check: %u changed instances of %s",
+                   dlq_count(&nodeQ), ct->objpcb->exprstr);
+    }
+
+    /* keep going after a test fails to report all the errors,
+     * but the nodeQ still needs to be freed if this is fatal */
+    done = terminate_parse(retres);
+    while (!dlq_empty(&nodeQ)) {
+        nodeptr = (agt_cfg_nodeptr_t *)dlq_deque(&nodeQ);
+        if (!done) {
+            nodeptr->node->res = NO_ERR;
+            res = run_obj_commit_tests(profile, scb, msghdr, ct, 
+                                       nodeptr->node, root, testmask);
+            if (res != NO_ERR) {
+                nodeptr->node->res = res;
+                retres = res;
+                done = terminate_parse(res);
+            }
+        }
+        agt_cfg_free_nodeptr(nodeptr);
+    }
+
+    return retres;
+    
+}  /* run_changed_commit_tests */
+
+
 /********************************************************************
 * FUNCTION run_obj_unique_tests
 * 
@@ -5557,6 +6591,11 @@ status_t
         CHK_EXIT(res, retres);
     }
 
+    /* find the objects changed by this transaction, so the
+     * tests that only read unchanged objects can be skipped
+     * in a config that was already valid   */
+    build_changed_objs(txcb, root);
+
     /* go through all the commit test objects that might need
      * to be checked for this commit    */
     agt_cfg_commit_test_t *ct = (agt_cfg_commit_test_t *)
@@ -5565,13 +6604,8 @@ status_t
 
         uint32  tests = ct->testflags & AGT_TEST_ALL_COMMIT_MASK;
 
-        /* prune entry that has not changed in a valid config
-         * this will only work for <commit> and <edit-config>
-         * on the running config, because otherwise there will
-         * not be any edits recorded in the txcb->undoQ or any
-         * nodes marked dirty in val->flags     */
-        if (profile->agt_config_state == AGT_CFG_STATE_OK) {
-            tests = prune_obj_commit_tests(txcb, ct, root, tests);
+        if (!commit_test_needed(ct)) {
+            tests = 0;
         }
 
         if (tests == 0) {
@@ -5584,25 +6618,50 @@ status_t
             continue;
         }
 
-        res = prep_commit_test_node(scb, msghdr, txcb, ct, root);
-        if (res != NO_ERR) {
-            CHK_EXIT(res, retres);
-            continue;
-        }
-
-        /* run all relevant tests on each node in the result set */
-        xpath_resnode_t *resnode = xpath_get_first_resnode(ct->result);
-        for (; resnode != NULL; resnode = xpath_get_next_resnode(resnode)) {
-
-            val_value_t *valnode = xpath_get_resnode_valptr(resnode);
-            valnode->res = NO_ERR;
-            res = run_obj_commit_tests(profile, scb, msghdr, ct, valnode, 
-                                       root, tests);
+        if (chg_valid && (tests & ~AGT_TEST_FL_UNIQUE) &&
+            ((ct->localdeps && !(tests & AGT_TEST_FL_XPATH_TYPE)) ||
+             !commit_test_deps_changed(ct))) {
+            /* the tests only read the subtree of each instance,
+             * or nothing they read outside of it has changed, so
+             * the instances with no changes in their subtree
+             * still pass; the unique-stmt still needs all of them */
+            res = run_changed_commit_tests(profile, scb, msghdr, ct, 
+                                           root, tests);
             if (res != NO_ERR) {
-                valnode->res = res;
                 profile->agt_load_rootcheck_errors = TRUE;
                 CHK_EXIT(res, retres);
             }
+            if (!(tests & AGT_TEST_FL_UNIQUE)) {
+                continue;
+            }
+
+            res = prep_commit_test_node(scb, msghdr, txcb, ct, root);
+            if (res != NO_ERR) {
+                CHK_EXIT(res, retres);
+                continue;
+            }
+        } else {
+            res = prep_commit_test_node(scb, msghdr, txcb, ct, root);
+            if (res != NO_ERR) {
+                CHK_EXIT(res, retres);
+                continue;
+            }
+
+            /* run all relevant tests on each node in the result set */
+            xpath_resnode_t *resnode = xpath_get_first_resnode(ct->result);
+            for (; resnode != NULL; 
+                 resnode = xpath_get_next_resnode(resnode)) {
+
+                val_value_t *valnode = xpath_get_resnode_valptr(resnode);
+                valnode->res = NO_ERR;
+                res = run_obj_commit_tests(profile, scb, msghdr, ct, valnode,
+                                           root, tests);
+                if (res != NO_ERR) {
+                    valnode->res = res;
+                    profile->agt_load_rootcheck_errors = TRUE;
+                    CHK_EXIT(res, retres);
+                }
+            }
         }
 
         /* check if any unique tests, which are handled all at once
@@ -5614,6 +6673,8 @@ status_t
         }
     }
 
+    clear_changed_objs();
+
     log_debug3("\nagt_val_root_check: end");
 
     return retres;
@@ -5744,18 +6805,21 @@ status_t
                                    pducfg, target->root, target->root);
 
     if (res == NO_ERR) {
-        boolean done = FALSE;
+        boolean done = FALSE, prune = TRUE;
         while (!done) {
             /* need to delete all the false when-stmt config objects 
              * and then see if the config is valid.  This is done in
              * candidate or running in apply phase; not evaluated at commit
-             * time like must-stmt or unique-stmt    */
+             * time like must-stmt or unique-stmt
+             * Only the first pass can skip the unchanged when-stmts;
+             * a deleted node can make any other when-stmt false  */
             uint32 delcount = 0;
             res = delete_dead_nodes(scb, &msg->mhdr, msg->rpc_txcb, 
-                                    target->root, &delcount);
+                                    target->root, prune, &delcount);
             if (res != NO_ERR || delcount == 0) {
                 done = TRUE;
             }
+            prune = FALSE;
         }
     }
 
@@ -5872,7 +6936,8 @@ status_t
 #endif
 
     /* check any top-level deletes */
-    //res = apply_commit_deletes(scb, msg, target, source->root, target->root);
+    //res = apply_commit_deletes(scb, msg, target, source->root, target->root,
+    //                           TRUE);
     if (res == NO_ERR) {
         /* apply all the new and modified nodes */
         res = handle_callback(AGT_CB_APPLY, OP_EDITOP_COMMIT, scb, msg, 
@@ -6002,7 +7067,7 @@ status_t
     assert( root && "root is NULL!" );
 
     status_t res = NO_ERR;
-    boolean done = FALSE;
+    boolean done = FALSE, prune = TRUE;
     while (!done) {
         /* need to delete all the false when-stmt config objects 
          * and then see if the config is valid.  This is done in
@@ -6010,10 +7075,11 @@ status_t
          * time like must-stmt or unique-stmt    */
         uint32 delcount = 0;
         res = delete_dead_nodes(scb, &msg->mhdr, msg->rpc_txcb, root, 
-                                &delcount);
+                                prune, &delcount);
         if (res != NO_ERR || delcount == 0) {
             done = TRUE;
         }
+        prune = FALSE;
     }
 
     return res;
@@ -468,8 +468,9 @@ static status_t
          *  Allocate a new val_value_t for the child value node 
          */
         val_value_t *chval;
-        chval = val_new_child_val(nextnode.nsid, nextnode.elname, TRUE, retval, 
-                                  get_editop(&nextnode), ncx_get_gen_anyxml());
+        chval = val_new_arena_child_val(nextnode.nsid, nextnode.elname,
+                                        TRUE, retval, get_editop(&nextnode),
+                                        ncx_get_gen_anyxml(), msg->valarena);
         if (!chval) {
             res = ERR_INTERNAL_MEM;
             /* add rpc-error to msg->errQ */
@@ -1216,6 +1217,7 @@ static status_t
     ncx_errinfo_t        *errinfo;
     obj_template_t       *targobj;
     xpath_result_t       *result; 
+    xpath_pcb_t          *xpathpcb;
     xml_node_t            valnode, endnode;
     status_t              res, res2, res3;
     boolean               errdone, empty;
@@ -1377,10 +1379,13 @@ static status_t
             }  /* else fall through and parse XPath string */
         case NCX_BT_INSTANCE_ID:
             res = NO_ERR;
-            retval->xpathpcb = agt_new_xpath_pcb(scb,
-                                                 valnode.simval,
-                                                 &res);
-            if (!retval->xpathpcb) {
+            xpathpcb = agt_new_xpath_pcb(scb,
+                                         valnode.simval,
+                                         &res);
+            if (xpathpcb) {
+                res = val_set_xpathpcb(retval, xpathpcb);
+            }
+            if (!VAL_XPATHPCB(retval)) {
                 ; /* res already set */
             } else if (btyp == NCX_BT_INSTANCE_ID ||
                        obj_is_schema_instance_string(obj)) {
@@ -1388,14 +1393,14 @@ static status_t
                  * the prefixes and check well-formed XPath
                  */
                 res = xpath_yang_validate_xmlpath(scb->reader,
-                                                  retval->xpathpcb,
+                                                  retval->extra->xpathpcb,
                                                   obj,
                                                   FALSE,
                                                   &targobj);
             } else {
                 result = 
                     xpath1_eval_xmlexpr(scb->reader,
-                                        retval->xpathpcb,
+                                        retval->extra->xpathpcb,
                                         NULL,
                                         NULL,
                                         FALSE,
@@ -2075,12 +2080,13 @@ static status_t
              * 'chnode' namespace and name;
              * Allocate a new val_value_t for the child value node
              */
-            chval = val_new_child_val(obj_get_nsid(curchild),
-                                      obj_get_name(curchild), 
-                                      FALSE, 
-                                      retval, 
-                                      get_editop(&chnode),
-                                      curchild);
+            chval = val_new_arena_child_val(obj_get_nsid(curchild),
+                                            obj_get_name(curchild), 
+                                            FALSE, 
+                                            retval, 
+                                            get_editop(&chnode),
+                                            curchild,
+                                            msg->valarena);
             if (!chval) {
                 res = ERR_INTERNAL_MEM;
             }
@@ -2328,14 +2334,14 @@ static status_t
              * value attributes from NETCONF and YANG
              * these must not persist in the database contents
              */
-            metaval = val_new_value();
+            metaval = val_new_arena_value(msg->valarena);
             if (!metaval) {
                 res = ERR_INTERNAL_MEM;
             } else {
                 /* parse the attribute string against the typdef */
                 res = val_parse_meta(metadef, attr, metaval);
                 if (res == NO_ERR) {
-                    dlq_enque(metaval, &retval->metaQ);
+                    val_add_meta(metaval, retval);
                 } else {
                     val_free_value(metaval);
                 }
@@ -125,6 +125,9 @@ static xpath_resnode_t *
 *    curval == current resnode value to output w/ path to root
 *    ceilingval == current root of the tree
 *    getop == TRUE for <get>; FALSE for <get-config>
+*    docorder == TRUE if resultQ is in document order, so the
+*                nodes in the same subtree as curval come
+*                right after it; FALSE to check every node
 *    indent == start indent amount
 *
 *********************************************************************/
@@ -136,6 +139,7 @@ static void
                     val_value_t *curval,
                     val_value_t *ceilingval,
                     boolean getop,
+                    boolean docorder,
                     int32 indent)
 {
     val_value_t       *topval;
@@ -207,6 +211,9 @@ static void
                                      testnode->node.valptr)) {
             dlq_remove(testnode);
             dlq_enque(testnode, &descendantQ);
+        } else if (docorder) {
+            /* the rest of the nodes are in later subtrees */
+            break;
         }
     }
 
@@ -231,7 +238,7 @@ static void
                              ceilingval->nsid,
                              topval->nsid,
                              topval->name, 
-                             &topval->metaQ, 
+                             VAL_METAQ(topval), 
                              FALSE, 
                              indent, 
                              FALSE);
@@ -267,6 +274,23 @@ static void
         }
     }
 
+    if (dowrite) {
+        /* move the ceiling closer to the curval and try again
+         * with the current value; the result nodes are in
+         * document order, so curval comes before the
+         * remaining nodes in the descendantQ
+         */
+        output_resnode(scb, 
+                       msg, 
+                       pcb, 
+                       &descendantQ, 
+                       curval, 
+                       topval, 
+                       getop, 
+                       docorder,
+                       indent);
+    }
+
     /* clear any nodes from the descendantQ which are child
      * nodes of 'topval'
      */
@@ -301,20 +325,6 @@ static void
         }
     }
 
-    if (dowrite) {
-        /* move the ceiling closer to the curval and try again
-         * with the current value
-         */
-        output_resnode(scb, 
-                       msg, 
-                       pcb, 
-                       &descendantQ, 
-                       curval, 
-                       topval, 
-                       getop, 
-                       indent);
-    }
-
     /* need to clear the descendant nodes before 
      * generating the topval end tag
      */
@@ -328,6 +338,7 @@ static void
                            testnode->node.valptr, 
                            topval, 
                            getop, 
+                           docorder,
                            indent);
         }
         xpath_free_resnode(testnode);
@@ -363,6 +374,7 @@ static void
 *    pcb == XPath parser control block to use
 *    result == XPath result to use
 *    getop == TRUE for <get>; FALSE for <get-config>
+*    docorder == TRUE if the result is in document order
 *    indent == start indent amount
 *
 *********************************************************************/
@@ -372,6 +384,7 @@ static void
                    xpath_pcb_t *pcb,
                    xpath_result_t *result,
                    boolean getop,
+                   boolean docorder,
                    int32 indent)
 {
     val_value_t       *curval;
@@ -403,6 +416,7 @@ static void
                        curval, 
                        pcb->val_docroot,
                        getop, 
+                       docorder,
                        indent);
 
         xpath_free_resnode(resnode);
@@ -448,6 +462,7 @@ status_t
     val_value_t       *selectval;
     xpath_result_t    *result;
     status_t           res;
+    boolean            docorder;
 
 #ifdef DEBUG
     if (!scb || !msg || !cfg || !msg->rpc_filter.op_filter) {
@@ -466,7 +481,7 @@ status_t
     selectval = msg->rpc_filter.op_filter;
     
     result = xpath1_eval_xmlexpr(scb->reader,
-                                 selectval->xpathpcb,
+                                 VAL_XPATHPCB(selectval),
                                  cfg->root,
                                  cfg->root,
                                  FALSE,
@@ -477,14 +492,21 @@ status_t
         (result->restype == XP_RT_NODESET)) {
 
         /* prune result of redundant nodes */
-        xpath1_prune_nodeset(selectval->xpathpcb, result);
+        xpath1_prune_nodeset(VAL_XPATHPCB(selectval), result);
+
+        /* output the nodes in document order; each subtree
+         * is then gathered without checking the whole result
+         */
+        docorder = (xpath1_sort_nodeset(result) == NO_ERR) ? 
+            TRUE : FALSE;
 
         /* output filter */
         output_result(scb, 
                       msg, 
-                      selectval->xpathpcb,
+                      VAL_XPATHPCB(selectval),
                       result, 
                       getop,
+                      docorder,
                       indent);
     }
 
@@ -549,7 +571,7 @@ boolean
      * will pass the filter test
      */
     result = xpath1_eval_xmlexpr(scb->reader,
-                                 selectval->xpathpcb,
+                                 VAL_XPATHPCB(selectval),
                                  val,
                                  val,
                                  FALSE,
@@ -124,6 +124,37 @@ static cfg_template_t *
 } /* get_template */
 
 
+/********************************************************************
+* FUNCTION set_candidate_dirty
+*
+* Mark a candidate that was filled from another source
+* as changed; the <commit> only visits the dirty subtrees,
+* so each top-level node is flagged to be applied as a whole
+*
+* INPUTS:
+*    candidate == candidate config with the new root
+* RETURNS:
+*    none
+*********************************************************************/
+static void
+    set_candidate_dirty (cfg_template_t *candidate)
+{
+    val_value_t  *chval;
+
+    if (!candidate->root) {
+        return;
+    }
+
+    for (chval = val_get_first_child(candidate->root);
+         chval != NULL;
+         chval = val_get_next_child(chval)) {
+        val_set_dirty_flag(chval);
+    }
+    candidate->flags |= CFG_FL_DIRTY;
+
+}  /* set_candidate_dirty */
+
+
 /********************************************************************
 * FUNCTION free_template
 *
@@ -671,6 +702,7 @@ status_t
         res = ERR_INTERNAL_MEM;
     }
     candidate->flags &= ~CFG_FL_DIRTY;
+    set_candidate_dirty(candidate);
     candidate->last_txid = startup->last_txid;
     candidate->cur_txid = 0;
 
@@ -716,6 +748,7 @@ status_t
     res = NO_ERR;
     candidate->root = val_clone_config_data(newroot, &res);
     candidate->flags &= ~CFG_FL_DIRTY;
+    set_candidate_dirty(candidate);
 
     return res;
 
@@ -1183,8 +1183,10 @@ val_value_t *
 
     if (script) {
         /* set the parmset name to the application pathname */
-        val->dname = xml_strdup((const xmlChar *)argv[0]);
-        val->name = val->dname;
+        val->name = NULL;
+        val_set_name(val, 
+                     (const xmlChar *)argv[0],
+                     xml_strlen((const xmlChar *)argv[0]));
     } else {
         /* set the parmset name to the PSD static name */
         val->name = obj_get_name(obj);
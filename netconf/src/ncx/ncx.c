@@ -61,6 +61,7 @@ date         init     comment
 #include "log.h"
 #include "ncx.h"
 #include "ncx_appinfo.h"
+#include "ncx_arena.h"
 #include "ncx_feature.h"
 #include "ncx_list.h"
 #include "ncx_num.h"
@@ -77,6 +78,7 @@ date         init     comment
 #include "version.h"
 #include "xml_util.h"
 #include "xmlns.h"
+#include "xpath.h"
 #include "yang.h"
 #include "yangconst.h"
 
@@ -1197,6 +1199,7 @@ void
     gen_root = NULL;
     gen_binary = NULL;
 
+    ncx_arena_cleanup();
     ncx_feature_cleanup();
     typ_unload_basetypes();
     xmlns_cleanup();
@@ -1206,6 +1209,7 @@ void
     top_cleanup();
     runstack_cleanup();
     ncxmod_cleanup();
+    xpath_resnode_cleanup();
     xmlCleanupParser();
     status_cleanup();
 
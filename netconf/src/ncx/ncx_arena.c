@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2008 - 2012, Andy Bierman, All Rights Reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*  FILE: ncx_arena.c
+
+
+*********************************************************************
+*                                                                   *
+*                  C H A N G E   H I S T O R Y                      *
+*                                                                   *
+*********************************************************************
+
+date         init     comment
+----------------------------------------------------------------------
+16oct26      agt      begun
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory.h>
+
+#ifndef _H_procdefs
+#include  "procdefs.h"
+#endif
+
+#ifndef _H_dlq
+#include "dlq.h"
+#endif
+
+#ifndef _H_log
+#include "log.h"
+#endif
+
+#ifndef _H_ncx_arena
+#include "ncx_arena.h"
+#endif
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+
+/********************************************************************
+*                                                                   *
+*                       C O N S T A N T S                           *
+*                                                                   *
+*********************************************************************/
+
+/* alignment of every chunk handed out */
+#define ARENA_ALIGN      16
+
+#define ARENA_ROUND(S) \
+    (((S) + (ARENA_ALIGN - 1)) & ~((size_t)(ARENA_ALIGN - 1)))
+
+#define ARENA_HDR_SIZE   ARENA_ROUND(sizeof(ncx_arena_block_t))
+
+/* usable bytes in a default-size block */
+#define ARENA_BLOCK_DATA_SIZE  (NCX_ARENA_BLOCK_SIZE - ARENA_HDR_SIZE)
+
+/* requests bigger than this get a block of their own */
+#define ARENA_BIG_CHUNK  (ARENA_BLOCK_DATA_SIZE / 4)
+
+#define ARENA_BLOCK_DATA(B) ((unsigned char *)(B) + ARENA_HDR_SIZE)
+
+
+/********************************************************************
+*                                                                   *
+*                            T Y P E S                              *
+*                                                                   *
+*********************************************************************/
+
+/* header at the start of each malloced arena block;
+ * in debug mode each chunk is a block by itself
+ */
+typedef struct ncx_arena_block_t_ {
+    dlq_hdr_t      qhdr;
+    size_t         size;                 /* usable bytes */
+    size_t         used;                 /* bytes handed out */
+#ifdef NCX_ARENA_DEBUG
+    boolean        released;
+#endif
+} ncx_arena_block_t;
+
+
+/********************************************************************
+*                                                                   *
+*                       V A R I A B L E S                           *
+*                                                                   *
+*********************************************************************/
+
+/* default-size blocks waiting to be reused */
+static dlq_hdr_t   freeblockQ;
+
+static uint32      freeblock_cnt;
+
+static boolean     freeblockQ_init = FALSE;
+
+
+/********************************************************************
+* FUNCTION new_block
+*
+* Get a block with at least the requested usable size
+*
+* INPUTS:
+*    size == usable bytes needed
+*
+* RETURNS:
+*   malloced or reused block, or NULL if malloc failed
+*********************************************************************/
+static ncx_arena_block_t *
+    new_block (size_t size)
+{
+    ncx_arena_block_t *blk;
+
+    if (size == ARENA_BLOCK_DATA_SIZE && freeblock_cnt) {
+        blk = (ncx_arena_block_t *)dlq_deque(&freeblockQ);
+        freeblock_cnt--;
+    } else {
+        blk = (ncx_arena_block_t *)m__getMem(ARENA_HDR_SIZE + size);
+        if (!blk) {
+            return NULL;
+        }
+        blk->size = size;
+    }
+
+    blk->used = 0;
+#ifdef NCX_ARENA_DEBUG
+    blk->released = FALSE;
+#endif
+    return blk;
+
+}  /* new_block */
+
+
+/********************************************************************
+* FUNCTION free_block
+*
+* Give a block back to the free pool or to the heap
+*
+* INPUTS:
+*    blk == block to free; already removed from its queue
+*********************************************************************/
+static void
+    free_block (ncx_arena_block_t *blk)
+{
+#ifdef NCX_ARENA_DEBUG
+    size_t  i;
+
+    if (blk->released) {
+        for (i = 0; i < blk->used; i++) {
+            if (ARENA_BLOCK_DATA(blk)[i] != NCX_ARENA_POISON) {
+                log_error("\nError: ncx_arena: released chunk %p "
+                          "(%u bytes) written at offset %u",
+                          ARENA_BLOCK_DATA(blk),
+                          (uint32)blk->used,
+                          (uint32)i);
+                break;
+            }
+        }
+    }
+    memset(ARENA_BLOCK_DATA(blk), NCX_ARENA_POISON, blk->used);
+    m__free(blk);
+#else
+    if (blk->size == ARENA_BLOCK_DATA_SIZE &&
+        freeblock_cnt < NCX_ARENA_MAX_FREE_BLOCKS) {
+        if (!freeblockQ_init) {
+            dlq_createSQue(&freeblockQ);
+            freeblockQ_init = TRUE;
+        }
+        dlq_enque(blk, &freeblockQ);
+        freeblock_cnt++;
+    } else {
+        m__free(blk);
+    }
+#endif
+
+}  /* free_block */
+
+
+/**************    E X T E R N A L   F U N C T I O N S   **********/
+
+
+/********************************************************************
+* FUNCTION ncx_init_arena
+*
+* Initialize an arena struct; no memory is allocated
+* until the first call to ncx_arena_alloc
+*
+* INPUTS:
+*    arena == arena struct to initialize
+*********************************************************************/
+void
+    ncx_init_arena (ncx_arena_t *arena)
+{
+#ifdef DEBUG
+    if (!arena) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    dlq_createSQue(&arena->blockQ);
+    arena->alloc_cnt = 0;
+
+}  /* ncx_init_arena */
+
+
+/********************************************************************
+* FUNCTION ncx_clean_arena
+*
+* Release all the memory handed out by the arena
+* The arena can be used again after this call
+*
+* INPUTS:
+*    arena == arena struct to clean
+*********************************************************************/
+void
+    ncx_clean_arena (ncx_arena_t *arena)
+{
+    ncx_arena_block_t *blk;
+
+#ifdef DEBUG
+    if (!arena) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    while (!dlq_empty(&arena->blockQ)) {
+        blk = (ncx_arena_block_t *)dlq_deque(&arena->blockQ);
+        free_block(blk);
+    }
+    arena->alloc_cnt = 0;
+
+}  /* ncx_clean_arena */
+
+
+/********************************************************************
+* FUNCTION ncx_arena_alloc
+*
+* Get a chunk of memory from the arena
+* The memory is not zeroed
+*
+* INPUTS:
+*    arena == arena to allocate from
+*    size == number of bytes requested
+*
+* RETURNS:
+*   pointer to the chunk, or NULL if malloc failed
+*********************************************************************/
+void *
+    ncx_arena_alloc (ncx_arena_t *arena,
+                     size_t size)
+{
+    ncx_arena_block_t *blk;
+    unsigned char     *chunk;
+
+#ifdef DEBUG
+    if (!arena) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return NULL;
+    }
+#endif
+
+    size = ARENA_ROUND(size ? size : 1);
+
+#ifdef NCX_ARENA_DEBUG
+    blk = new_block(size);
+    if (!blk) {
+        return NULL;
+    }
+    dlq_enque(blk, &arena->blockQ);
+#else
+    /* the first block in the Q is the one being filled */
+    blk = (ncx_arena_block_t *)dlq_firstEntry(&arena->blockQ);
+    if (!blk || blk->size - blk->used < size) {
+        if (size > ARENA_BIG_CHUNK) {
+            blk = new_block(size);
+            if (!blk) {
+                return NULL;
+            }
+            dlq_enque(blk, &arena->blockQ);
+        } else {
+            blk = new_block(ARENA_BLOCK_DATA_SIZE);
+            if (!blk) {
+                return NULL;
+            }
+            dlq_insertAfter(blk, &arena->blockQ);
+        }
+    }
+#endif
+
+    chunk = ARENA_BLOCK_DATA(blk) + blk->used;
+    blk->used += size;
+    arena->alloc_cnt++;
+    return chunk;
+
+}  /* ncx_arena_alloc */
+
+
+/********************************************************************
+* FUNCTION ncx_arena_release
+*
+* Give back a chunk before the arena is cleaned
+* This is a no-op unless NCX_ARENA_DEBUG is defined,
+* in which case the chunk is poisoned and checked later
+*
+* INPUTS:
+*    ptr == chunk from ncx_arena_alloc
+*********************************************************************/
+void
+    ncx_arena_release (void *ptr)
+{
+#ifdef NCX_ARENA_DEBUG
+    ncx_arena_block_t *blk;
+
+    if (!ptr) {
+        return;
+    }
+
+    blk = (ncx_arena_block_t *)
+        ((unsigned char *)ptr - ARENA_HDR_SIZE);
+    if (blk->released) {
+        log_error("\nError: ncx_arena: chunk %p released twice", ptr);
+        return;
+    }
+    memset(ptr, NCX_ARENA_POISON, blk->used);
+    blk->released = TRUE;
+#else
+    (void)ptr;
+#endif
+
+}  /* ncx_arena_release */
+
+
+/********************************************************************
+* FUNCTION ncx_arena_cleanup
+*
+* Free the blocks cached for reuse by all arenas
+* Called from ncx_cleanup
+*********************************************************************/
+void
+    ncx_arena_cleanup (void)
+{
+    ncx_arena_block_t *blk;
+
+    if (!freeblockQ_init) {
+        return;
+    }
+
+    while (!dlq_empty(&freeblockQ)) {
+        blk = (ncx_arena_block_t *)dlq_deque(&freeblockQ);
+        m__free(blk);
+    }
+    freeblock_cnt = 0;
+
+}  /* ncx_arena_cleanup */
+
+
+/* END file ncx_arena.c */
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2008 - 2012, Andy Bierman, All Rights Reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef _H_ncx_arena
+#define _H_ncx_arena
+
+/*  FILE: ncx_arena.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Region allocator for short-lived data structures
+
+    An arena hands out memory from large blocks and releases
+    all of it at once when the owner is cleaned.  It is used
+    for transient value trees that live exactly as long as
+    one RPC request.
+
+    If NCX_ARENA_DEBUG is defined, every allocation gets its own
+    block, released memory is poisoned, and any write to a
+    released chunk is reported when the arena is cleaned.
+
+*********************************************************************
+*								    *
+*		   C H A N G E	 H I S T O R Y			    *
+*								    *
+*********************************************************************
+
+date	     init     comment
+----------------------------------------------------------------------
+16-oct-26    agt      Begun
+*/
+
+#include <stddef.h>
+
+#ifndef _H_dlq
+#include "dlq.h"
+#endif
+
+#ifndef _H_ncxtypes
+#include "ncxtypes.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			 C O N S T A N T S			    *
+*								    *
+*********************************************************************/
+
+/* default size of one arena block, including the block header */
+#define NCX_ARENA_BLOCK_SIZE   8192
+
+/* max number of default-size blocks kept for reuse after
+ * an arena is cleaned
+ */
+#define NCX_ARENA_MAX_FREE_BLOCKS  16
+
+/* byte written over released chunks in debug mode */
+#define NCX_ARENA_POISON       0xa5
+
+
+/********************************************************************
+*								    *
+*			     T Y P E S				    *
+*								    *
+*********************************************************************/
+
+/* one region allocator; usually embedded in its owner */
+typedef struct ncx_arena_t_ {
+    dlq_hdr_t      blockQ;             /* Q of ncx_arena_block_t */
+    uint32         alloc_cnt;          /* chunks handed out */
+} ncx_arena_t;
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION ncx_init_arena
+*
+* Initialize an arena struct; no memory is allocated
+* until the first call to ncx_arena_alloc
+*
+* INPUTS:
+*    arena == arena struct to initialize
+*********************************************************************/
+extern void
+    ncx_init_arena (ncx_arena_t *arena);
+
+
+/********************************************************************
+* FUNCTION ncx_clean_arena
+*
+* Release all the memory handed out by the arena
+* The arena can be used again after this call
+*
+* INPUTS:
+*    arena == arena struct to clean
+*********************************************************************/
+extern void
+    ncx_clean_arena (ncx_arena_t *arena);
+
+
+/********************************************************************
+* FUNCTION ncx_arena_alloc
+*
+* Get a chunk of memory from the arena
+* The memory is not zeroed
+*
+* INPUTS:
+*    arena == arena to allocate from
+*    size == number of bytes requested
+*
+* RETURNS:
+*   pointer to the chunk, or NULL if malloc failed
+*********************************************************************/
+extern void *
+    ncx_arena_alloc (ncx_arena_t *arena,
+                     size_t size);
+
+
+/********************************************************************
+* FUNCTION ncx_arena_release
+*
+* Give back a chunk before the arena is cleaned
+* This is a no-op unless NCX_ARENA_DEBUG is defined,
+* in which case the chunk is poisoned and checked later
+*
+* INPUTS:
+*    ptr == chunk from ncx_arena_alloc
+*********************************************************************/
+extern void
+    ncx_arena_release (void *ptr);
+
+
+/********************************************************************
+* FUNCTION ncx_arena_cleanup
+*
+* Free the blocks cached for reuse by all arenas
+* Called from ncx_cleanup
+*********************************************************************/
+extern void
+    ncx_arena_cleanup (void);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_ncx_arena */
@@ -419,6 +419,7 @@ extern "C" {
 #define NCX_EL_CAPABILITY      (const xmlChar *)"capability"
 #define NCX_EL_CASE            (const xmlChar *)"case"
 #define NCX_EL_CASE_NAME       (const xmlChar *)"case-name"
+#define NCX_EL_CHANGE          (const xmlChar *)"change"
 #define NCX_EL_CHOICE          (const xmlChar *)"choice"
 #define NCX_EL_CHOICE_NAME     (const xmlChar *)"choice-name"
 #define NCX_EL_CLASS           (const xmlChar *)"class"
@@ -457,6 +458,7 @@ extern "C" {
 #define NCX_EL_DEPRECATED      (const xmlChar *)"deprecated"
 #define NCX_EL_DESCRIPTION     (const xmlChar *)"description"
 #define NCX_EL_DEVIATION       (const xmlChar *)"deviation"
+#define NCX_EL_DIFF_CONFIG     (const xmlChar *)"diff-config"
 #define NCX_EL_DISABLED        (const xmlChar *)"disabled"
 #define NCX_EL_DISCARD_CHANGES (const xmlChar *)"discard-changes"
 #define NCX_EL_DOUBLE          (const xmlChar *)"double"
@@ -592,6 +594,7 @@ extern "C" {
 #define NCX_EL_OK_ELEMENT      (const xmlChar *)"ok-element"
 #define NCX_EL_ONE             (const xmlChar *)"one"
 #define NCX_EL_ONE_NOCASE      (const xmlChar *)"one-nocase"
+#define NCX_EL_OPERATION       (const xmlChar *)"operation"
 #define NCX_EL_ORDER           (const xmlChar *)"order"
 #define NCX_EL_ORDER_L         (const xmlChar *)"loose"
 #define NCX_EL_ORDER_S         (const xmlChar *)"strict"
@@ -731,6 +734,18 @@ extern "C" {
 #define NCX_EL_YIN             (const xmlChar *)"yin"
 #define NCX_EL_YUMA_HOME       (const xmlChar *)"yuma-home"
 #define NCX_EL_MAX_SESSIONS    (const xmlChar *)"max-sessions"
+#define NCX_EL_EVENT_LOOP      (const xmlChar *)"event-loop"
+#define NCX_EL_EPOLL           (const xmlChar *)"epoll"
+#define NCX_EL_BUFFER_SIZE     (const xmlChar *)"buffer-size"
+#define NCX_EL_BULK_BUFFER_SIZE (const xmlChar *)"bulk-buffer-size"
+#define NCX_EL_READ_BUFFER_SIZE (const xmlChar *)"read-buffer-size"
+#define NCX_EL_MAX_SESSION_BUFFERS (const xmlChar *)"max-session-buffers"
+#define NCX_EL_STREAM_OUTPUT   (const xmlChar *)"stream-output"
+#define NCX_EL_MAX_QUEUED_OUTPUT (const xmlChar *)"max-queued-output"
+#define NCX_EL_WRITE_TIMEOUT   (const xmlChar *)"write-timeout"
+#define NCX_EL_RPC_BATCH_SIZE  (const xmlChar *)"rpc-batch-size"
+#define NCX_EL_RPC_BATCH_TIME  (const xmlChar *)"rpc-batch-time"
+#define NCX_EL_VALIDATE_ALL    (const xmlChar *)"validate-all"
 
 /* bit definitions for ncx_lstr_t flags field */
 #define NCX_FL_RANGE_ERR   bit0
@@ -67,6 +67,12 @@ date         init     comment
 *                         V A R I A B L E S                         *
 *                                                                   *
 *********************************************************************/
+
+/* generation of the obj_descsum_t filters; a filter built
+ * in an older generation is rebuilt the next time it is used
+ */
+static uint32 descsum_gen = 1;
+
 static obj_case_t * new_case (boolean isreal); 
 static void free_case (obj_case_t *cas);
 static obj_template_t* find_template( dlq_hdr_t*que, const xmlChar *modname, 
@@ -2738,6 +2744,211 @@ static boolean
 }  /* test_one_ancestor */
 
 
+/********************************************************************
+* FUNCTION descsum_hash
+* 
+* Get the hash value of a node name for an obj_descsum_t
+*
+* INPUTS:
+*    name == node name to hash
+*
+* RETURNS:
+*    hash value
+*********************************************************************/
+static uint32
+    descsum_hash (const xmlChar *name)
+{
+    uint32 hash = 2166136261U;
+
+    while (*name) {
+        hash ^= (uint32)*name++;
+        hash *= 16777619U;
+    }
+    return hash;
+
+}  /* descsum_hash */
+
+
+/********************************************************************
+* FUNCTION descsum_add_name
+* 
+* Add a node name to a descendant name filter
+* 2 bits are set for each name
+*
+* INPUTS:
+*    descsum == filter to add to
+*    name == node name to add
+*********************************************************************/
+static void
+    descsum_add_name (obj_descsum_t *descsum,
+                      const xmlChar *name)
+{
+    uint32  hash, bit;
+
+    hash = descsum_hash(name);
+    bit = hash % OBJ_DESCSUM_BITS;
+    descsum->bits[bit / 32] |= (uint32)1 << (bit % 32);
+    bit = (hash >> 16) % OBJ_DESCSUM_BITS;
+    descsum->bits[bit / 32] |= (uint32)1 << (bit % 32);
+
+}  /* descsum_add_name */
+
+
+/********************************************************************
+* FUNCTION descsum_has_name
+* 
+* Check if a node name may be in a descendant name filter
+*
+* INPUTS:
+*    descsum == filter to check
+*    name == node name to find
+*
+* RETURNS:
+*    TRUE if the name may be in the filter
+*    FALSE if it is not
+*********************************************************************/
+static boolean
+    descsum_has_name (const obj_descsum_t *descsum,
+                      const xmlChar *name)
+{
+    uint32  hash, bit;
+
+    if (descsum->anyname) {
+        return TRUE;
+    }
+    hash = descsum_hash(name);
+    bit = hash % OBJ_DESCSUM_BITS;
+    if (!(descsum->bits[bit / 32] & ((uint32)1 << (bit % 32)))) {
+        return FALSE;
+    }
+    bit = (hash >> 16) % OBJ_DESCSUM_BITS;
+    return (descsum->bits[bit / 32] & ((uint32)1 << (bit % 32))) ?
+        TRUE : FALSE;
+
+}  /* descsum_has_name */
+
+
+/* forward decl needed for recursion */
+static obj_descsum_t *
+    get_descsum (obj_template_t *obj);
+
+
+/********************************************************************
+* FUNCTION descsum_add_datadefQ
+* 
+* Add the names of the nodes in a datadefQ and
+* all their descendants to a descendant name filter
+* Choice and case names are added too, since a schema
+* descendant walk can match them
+*
+* INPUTS:
+*    descsum == filter to add to
+*    datadefQ == Q of obj_template_t to add
+*
+* RETURNS:
+*    FALSE if a malloc failed and the filter is not complete
+*********************************************************************/
+static boolean
+    descsum_add_datadefQ (obj_descsum_t *descsum,
+                          dlq_hdr_t *datadefQ)
+{
+    obj_template_t  *obj;
+    obj_descsum_t   *childsum;
+    uint32           i;
+
+    for (obj = (obj_template_t *)dlq_firstEntry(datadefQ);
+         obj != NULL && !descsum->anyname;
+         obj = (obj_template_t *)dlq_nextEntry(obj)) {
+
+        switch (obj->objtype) {
+        case OBJ_TYP_USES:
+        case OBJ_TYP_REFINE:
+        case OBJ_TYP_AUGMENT:
+            /* the expanded nodes are in the Q as well */
+            continue;
+        default:
+            ;
+        }
+
+        if (obj_has_name(obj)) {
+            descsum_add_name(descsum, obj_get_name(obj));
+        }
+
+        if (obj_is_choice_or_case(obj)) {
+            if (!descsum_add_datadefQ(descsum, obj_get_datadefQ(obj))) {
+                return FALSE;
+            }
+        } else if (obj_get_datadefQ(obj) || 
+                   obj->objtype == OBJ_TYP_ANYXML) {
+            childsum = get_descsum(obj);
+            if (!childsum) {
+                return FALSE;
+            }
+            if (childsum->anyname) {
+                descsum->anyname = TRUE;
+            } else {
+                for (i = 0; i < OBJ_DESCSUM_BITS / 32; i++) {
+                    descsum->bits[i] |= childsum->bits[i];
+                }
+            }
+        }
+    }
+    return TRUE;
+
+}  /* descsum_add_datadefQ */
+
+
+/********************************************************************
+* FUNCTION get_descsum
+* 
+* Get the descendant name filter of an object,
+* building it if it is missing or stale
+*
+* INPUTS:
+*    obj == object to get the filter for
+*
+* RETURNS:
+*    pointer to the filter or NULL if malloc failed
+*********************************************************************/
+static obj_descsum_t *
+    get_descsum (obj_template_t *obj)
+{
+    dlq_hdr_t  *datadefQ;
+
+    if (obj->descsum && obj->descsum->gen == descsum_gen) {
+        return obj->descsum;
+    }
+
+    if (!obj->descsum) {
+        obj->descsum = m__getObj(obj_descsum_t);
+        if (!obj->descsum) {
+            return NULL;
+        }
+    }
+    memset(obj->descsum, 0x0, sizeof(obj_descsum_t));
+
+    /* the child nodes of anyxml and generic nodes
+     * do not come from the schema
+     */
+    if (obj->objtype == OBJ_TYP_ANYXML || 
+        obj_is_root(obj) || 
+        obj_is_abstract(obj)) {
+        obj->descsum->anyname = TRUE;
+    } else {
+        datadefQ = obj_get_datadefQ(obj);
+        if (datadefQ && !descsum_add_datadefQ(obj->descsum, datadefQ)) {
+            m__free(obj->descsum);
+            obj->descsum = NULL;
+            return NULL;
+        }
+    }
+
+    obj->descsum->gen = descsum_gen;
+    return obj->descsum;
+
+}  /* get_descsum */
+
+
 /********************************************************************
 * FUNCTION test_one_descendant
 * 
@@ -2816,6 +3027,11 @@ static boolean
         return TRUE;
     }
 
+    /* skip the subtree if no node below can match */
+    if (name && !textmode && !obj_may_have_descendant(startobj, name)) {
+        return TRUE;
+    }
+
     for (obj = (obj_template_t *)dlq_firstEntry(datadefQ);
          obj != NULL;
          obj = (obj_template_t *)dlq_nextEntry(obj)) {
@@ -3958,6 +4174,10 @@ void obj_free_template( obj_template_t *obj )
     }
 #endif
 
+    if (obj->descsum) {
+        m__free(obj->descsum);
+    }
+
     clean_metadataQ(&obj->metadataQ);
     ncx_clean_appinfoQ(&obj->appinfoQ);
     ncx_clean_iffeatureQ(&obj->iffeatureQ);
@@ -5642,6 +5862,55 @@ boolean
 }  /* obj_find_all_descendants */
 
 
+/********************************************************************
+* FUNCTION obj_may_have_descendant
+* 
+* Check if a node with the specified name can be
+* a descendant of an object, so a descendant walk
+* can skip the subtree if not
+*
+* The answer comes from a filter built the first time the
+* object is checked, so a TRUE answer can be wrong
+*
+* INPUTS:
+*    obj == object to check
+*    name == name of the descendant node to find
+*
+* RETURNS:
+*   TRUE if a descendant named 'name' may exist
+*   FALSE if it cannot exist
+*********************************************************************/
+boolean
+    obj_may_have_descendant (obj_template_t *obj,
+                             const xmlChar *name)
+{
+    obj_descsum_t  *descsum;
+
+    assert(obj && "obj is NULL" );
+    assert(name && "name is NULL" );
+
+    descsum = get_descsum(obj);
+    return (descsum) ? descsum_has_name(descsum, name) : TRUE;
+
+}  /* obj_may_have_descendant */
+
+
+/********************************************************************
+* FUNCTION obj_reset_descendant_names
+* 
+* Mark the descendant name filters of all objects as stale
+* Must be called when a data node is added to the
+* datadefQ of an existing object
+*
+*********************************************************************/
+void
+    obj_reset_descendant_names (void)
+{
+    descsum_gen++;
+
+}  /* obj_reset_descendant_names */
+
+
 /********************************************************************
 * FUNCTION obj_find_all_pfaxis
 * 
@@ -165,6 +165,9 @@ extern "C" {
 /* object is tagged as ncx:user-write with no delete access */
 #define OBJ_FL_BLOCK_DELETE bit30
 
+/* number of bits in the descendant name filter of an object */
+#define OBJ_DESCSUM_BITS    512
+
 
 /********************************************************************
 *								    *
@@ -439,6 +442,17 @@ typedef struct obj_xpath_ptr_t_ {
 } obj_xpath_ptr_t;
 
 
+/* bloom filter of the names of all the nodes below an object,
+ * used to skip subtrees in a descendant axis walk;
+ * built on demand by obj_may_have_descendant
+ */
+typedef struct obj_descsum_t_ {
+    uint32         gen;         /* schema generation when built */
+    boolean        anyname;     /* T: anyxml or other open content */
+    uint32         bits[OBJ_DESCSUM_BITS / 32];
+} obj_descsum_t;
+
+
 /* One YANG data-def-stmt */
 typedef struct obj_template_t_ {
     dlq_hdr_t      qhdr;
@@ -473,6 +487,9 @@ typedef struct obj_template_t_ {
     struct ncx_module_t_ *mod;
     xmlns_id_t            nsid;
 
+    /* names of the descendant nodes; NULL until needed */
+    obj_descsum_t        *descsum;
+
     union def_ {
 	obj_container_t   *container;
 	obj_leaf_t        *leaf;
@@ -1179,6 +1196,41 @@ extern boolean
 			      boolean *fncalled);
 
 
+/********************************************************************
+* FUNCTION obj_may_have_descendant
+* 
+* Check if a node with the specified name can be
+* a descendant of an object, so a descendant walk
+* can skip the subtree if not
+*
+* The answer comes from a filter built the first time the
+* object is checked, so a TRUE answer can be wrong
+*
+* INPUTS:
+*    obj == object to check
+*    name == name of the descendant node to find
+*
+* RETURNS:
+*   TRUE if a descendant named 'name' may exist
+*   FALSE if it cannot exist
+*********************************************************************/
+extern boolean
+    obj_may_have_descendant (obj_template_t *obj,
+			     const xmlChar *name);
+
+
+/********************************************************************
+* FUNCTION obj_reset_descendant_names
+* 
+* Mark the descendant name filters of all objects as stale
+* Must be called when a data node is added to the
+* datadefQ of an existing object
+*
+*********************************************************************/
+extern void
+    obj_reset_descendant_names (void);
+
+
 /********************************************************************
 * FUNCTION obj_find_all_pfaxis
 * 
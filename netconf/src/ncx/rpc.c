@@ -36,6 +36,7 @@ date         init     comment
 #include  "procdefs.h"
 #include  "cfg.h"
 #include  "ncx.h"
+#include  "ncx_arena.h"
 #include  "obj.h"
 #include  "op.h"
 #include  "rpc.h"
@@ -92,6 +93,8 @@ rpc_msg_t *
     memset(msg, 0x0, sizeof(rpc_msg_t));
     xml_msg_init_hdr(&msg->mhdr);
     dlq_createSQue(&msg->rpc_dataQ);
+    ncx_init_arena(&msg->rpc_arena);
+    dlq_createSQue(&msg->rpc_arenaQ);
 
     msg->rpc_input = val_new_value();
     if (!msg->rpc_input) {
@@ -173,6 +176,15 @@ void rpc_free_msg (rpc_msg_t *msg)
         val_free_value(val);
     }
 
+    /* clean the arena nodes that were replaced by copies */
+    while (!dlq_empty(&msg->rpc_arenaQ)) {
+        val_value_t *val = (val_value_t *)dlq_deque(&msg->rpc_arenaQ);
+        val_free_value(val);
+    }
+
+    /* all arena nodes are unreachable now */
+    ncx_clean_arena(&msg->rpc_arena);
+
     m__free(msg);
 
 } /* rpc_free_msg */
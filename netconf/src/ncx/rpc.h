@@ -38,6 +38,10 @@ date             init     comment
 #include "dlq.h"
 #endif
 
+#ifndef _H_ncx_arena
+#include "ncx_arena.h"
+#endif
+
 #ifndef _H_ncxtypes
 #include "ncxtypes.h"
 #endif
@@ -151,6 +155,19 @@ typedef struct rpc_msg_t_ {
      */
     boolean         rpc_parse_errors;
 
+    /* incoming: region for transient value nodes that are
+     * only referenced from this message; see xml_msg_hdr_t.valarena
+     * cleaned after rpc_input and rpc_dataQ are freed
+     */
+    ncx_arena_t     rpc_arena;
+
+    /* incoming: rpc_arena nodes taken out of rpc_input and
+     * replaced by a heap copy (see val_clone_arena_value);
+     * kept until the message is freed, since the callers that
+     * moved them may still look at them
+     */
+    dlq_hdr_t       rpc_arenaQ;              /* Q of val_value_t */
+
 } rpc_msg_t;
 
 
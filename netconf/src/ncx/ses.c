@@ -66,6 +66,9 @@ date         init     comment
 #define AMPSTR    (const xmlChar *)"&amp;"
 #define QSTR      (const xmlChar *)"&quot;"
 
+/* max number of spaces written in one run by ses_indent */
+#define SES_INDENT_RUN   64
+
 /* used by yangcli to read in between stdin polling */
 #define MAX_READ_TRIES   500
 
@@ -84,6 +87,105 @@ date         init     comment
 *********************************************************************/
 static ses_total_stats_t totals;
 
+/* size of the read buffer for new sessions */
+static uint32 readbuff_size = SES_READBUFF_SIZE;
+
+/* newline followed by SES_INDENT_RUN spaces */
+static const xmlChar indentstr[] = "\n"
+    "                                "
+    "                                ";
+
+
+/********************************************************************
+* FUNCTION next_input_buff
+*
+* Finish the full input buffer of the current message
+* and start a new one.  A message that fills more than
+* 1 buffer continues in bulk size buffers
+*
+* INPUTS:
+*   scb == session control block to accept input for
+*   msg == current input message
+*   buff == address of current (full) input buffer for 'msg'
+*
+* OUTPUTS:
+*   *buff set to the new buffer queued on 'msg'
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    next_input_buff (ses_cb_t *scb,
+                     ses_msg_t *msg,
+                     ses_msg_buff_t **buff)
+{
+    status_t  res;
+
+    (*buff)->buffpos = 0;
+    (*buff)->bufflen = (*buff)->buffsize;
+    res = ses_msg_new_bulk_buff(scb,
+                                FALSE,  /* outbuff */
+                                buff);
+    if (res == NO_ERR) {
+        dlq_enque(*buff, &msg->buffQ);
+    }
+    return res;
+
+}  /* next_input_buff */
+
+
+/********************************************************************
+* FUNCTION copy_input_span
+*
+* Copy a span of bytes from the session read buffer
+* into the input buffers of the current message
+* Gets a new buffer each time the current one fills up
+*
+* INPUTS:
+*   scb == session control block to accept input for
+*   msg == current input message
+*   buff == address of current input buffer for 'msg'
+*   src == first byte to copy
+*   len == number of bytes to copy
+*
+* OUTPUTS:
+*   *buff may be changed to a new buffer queued on 'msg'
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    copy_input_span (ses_cb_t *scb,
+                     ses_msg_t *msg,
+                     ses_msg_buff_t **buff,
+                     const xmlChar *src,
+                     size_t len)
+{
+    ses_msg_buff_t *curbuff;
+    size_t          copylen;
+    status_t        res;
+
+    curbuff = *buff;
+    while (len > 0) {
+        if (curbuff->buffpos == curbuff->buffsize) {
+            /* current buffer is full; get a new one */
+            res = next_input_buff(scb, msg, buff);
+            if (res != NO_ERR) {
+                return res;
+            }
+            curbuff = *buff;
+        }
+
+        copylen = min(len, curbuff->buffsize - curbuff->buffpos);
+        memcpy(&curbuff->buff[curbuff->buffpos], src, copylen);
+        curbuff->buffpos += copylen;
+        src += copylen;
+        len -= copylen;
+    }
+    return NO_ERR;
+
+}  /* copy_input_span */
+
 
 /********************************************************************
 * FUNCTION accept_buffer_ssh_v10
@@ -99,6 +201,10 @@ static ses_total_stats_t totals;
 * This function breaks the byte stream into ses_msg_t structs
 * that get queued on the session's msgQ
 *
+* The input is scanned with memchr for the first EOM char;
+* the bytes before it are copied in one span and the EOM
+* state machine is only run on the candidate chars
+*
 * INPUTS:
 *   scb == session control block to accept input for
 *   len  == number of bytes in scb->readbuff just read
@@ -113,10 +219,12 @@ static status_t
     ses_msg_t      *msg;
     ses_msg_buff_t *buff;
     const char     *endmatch;
+    const xmlChar  *candidate;
     status_t        res;
     boolean         done;
     xmlChar         ch;
     uint32          count;
+    size_t          spanlen;
 
 #ifdef SES_DEBUG
     if (LOGDEBUG3 && scb->state != SES_ST_INIT) {
@@ -149,7 +257,7 @@ static status_t
 
     /* make sure there is a current buffer to use */
     buff = (ses_msg_buff_t *)dlq_lastEntry(&msg->buffQ);
-    if (buff == NULL || buff->bufflen == SES_MSG_BUFFSIZE) {
+    if (buff == NULL) {
         /* need a new buffer */
         res = ses_msg_new_buff(scb,
                                FALSE,  /* outbuff */
@@ -158,6 +266,15 @@ static status_t
             return res;
         }
         dlq_enque(buff, &msg->buffQ);
+    } else if (buff->bufflen == buff->buffsize) {
+        /* last buffer already filled; continue in a bulk buffer */
+        res = ses_msg_new_bulk_buff(scb,
+                                    FALSE,  /* outbuff */
+                                    &buff);
+        if (res != NO_ERR) {
+            return res;
+        }
+        dlq_enque(buff, &msg->buffQ);
     }
 
     /* check the chars in the buffer for the 
@@ -196,17 +313,40 @@ static status_t
                 return res;
             }
             dlq_enque(buff, &msg->buffQ);
-        } else if (buff->buffpos == SES_MSG_BUFFSIZE) {
+        } else if (buff->buffpos == buff->buffsize) {
             /* current buffer is full; get a new one */
-            buff->buffpos = 0;
-            buff->bufflen = SES_MSG_BUFFSIZE;
-            res = ses_msg_new_buff(scb,
-                                   FALSE,  /* outbuff */
-                                   &buff);
+            res = next_input_buff(scb, msg, &buff);
             if (res != NO_ERR) {
                 return res;
             }
-            dlq_enque(buff, &msg->buffQ);
+        }
+
+        /* if not in the middle of matching the EOM string, 
+         * find the next char that could start it and copy
+         * all the bytes before that char at once
+         */
+        if (scb->instate != SES_INST_INEND) {
+            candidate = memchr(&scb->readbuff[count], 
+                               *endmatch, 
+                               len - count);
+            if (candidate) {
+                spanlen = (size_t)(candidate - &scb->readbuff[count]);
+            } else {
+                spanlen = len - count;
+            }
+            if (spanlen) {
+                res = copy_input_span(scb, 
+                                      msg, 
+                                      &buff,
+                                      &scb->readbuff[count], 
+                                      spanlen);
+                if (res != NO_ERR) {
+                    return res;
+                }
+                count += (uint32)spanlen;
+                scb->instate = SES_INST_INMSG;
+                continue;
+            }
         }
 
         /* get the next char in the input buffer and advance the pointer */
@@ -254,7 +394,7 @@ static status_t
                      * save the buffer and make the message ready to parse 
                      * don't let the xmlreader see the EOM string
                      */
-                    if(buff->buffpos > NC_SSH_END_LEN) {
+                    if (buff->buffpos >= NC_SSH_END_LEN) {
                         buff->bufflen = buff->buffpos - NC_SSH_END_LEN;
                     } else {
                         /* the SSH EOM string is split accross 2 buffers */
@@ -380,7 +520,7 @@ static status_t
     uint32          count;
     boolean         done;
     xmlChar         ch;
-    size_t          chunkleft, inbuffleft, outbuffleft, copylen;
+    size_t          chunkleft, inbuffleft, copylen;
     ncx_num_t       num;
 
 #ifdef SES_DEBUG
@@ -414,7 +554,7 @@ static status_t
 
     /* make sure there is a current buffer to use */
     buff = (ses_msg_buff_t *)dlq_lastEntry(&msg->buffQ);
-    if (buff == NULL || buff->bufflen == SES_MSG_BUFFSIZE) {
+    if (buff == NULL) {
         /* need a new buffer */
         res = ses_msg_new_buff(scb,
                                FALSE,  /* outbuff */
@@ -423,6 +563,15 @@ static status_t
             return res;
         }
         dlq_enque(buff, &msg->buffQ);
+    } else if (buff->bufflen == buff->buffsize) {
+        /* last buffer already filled; continue in a bulk buffer */
+        res = ses_msg_new_bulk_buff(scb,
+                                    FALSE,  /* outbuff */
+                                    &buff);
+        if (res != NO_ERR) {
+            return res;
+        }
+        dlq_enque(buff, &msg->buffQ);
     }
 
     /* check the chars in the buffer for the 
@@ -446,17 +595,12 @@ static status_t
                 return res;
             }
             dlq_enque(buff, &msg->buffQ);
-        } else if (buff->buffpos == SES_MSG_BUFFSIZE) {
+        } else if (buff->buffpos == buff->buffsize) {
             /* current buffer is full; get a new one */
-            buff->buffpos = 0;
-            buff->bufflen = SES_MSG_BUFFSIZE;
-            res = ses_msg_new_buff(scb,
-                                   FALSE,  /* outbuff */
-                                   &buff);
+            res = next_input_buff(scb, msg, &buff);
             if (res != NO_ERR) {
                 return res;
             }
-            dlq_enque(buff, &msg->buffQ);
         }
 
         /* get the next char in the input buffer and advance the pointer */
@@ -567,7 +711,6 @@ static status_t
             count--;   /* back up count */
             chunkleft = msg->expchunksize - msg->curchunksize;
             inbuffleft = len - count;
-            outbuffleft = SES_MSG_BUFFSIZE - buff->buffpos;
             copylen = min(inbuffleft, chunkleft);
 
             /* account for the amount copied above */
@@ -579,51 +722,15 @@ static status_t
             } /* else finished the input buffer */
 
             /* copy the required input bytes to 1 or more buffers */
-            if (outbuffleft >= copylen) {
-                /* rest of chunk or input fits in rest of current buffer */
-                xml_strncpy(&buff->buff[buff->buffpos],
-                            &scb->readbuff[count],
-                            copylen);
-                buff->buffpos += copylen;
-                count += copylen;
-            } else {
-                /* rest of the current buffer not big enough;
-                 * split input across N buffers;
-                 * first finish current buffer
-                 */
-                xml_strncpy(&buff->buff[buff->buffpos],
-                            &scb->readbuff[count],
-                            outbuffleft);
-                buff->buffpos = 0;
-                buff->bufflen = SES_MSG_BUFFSIZE;
-                copylen -= outbuffleft;
-                count += outbuffleft;
-
-                /* fill N-2 full buffers and possibly
-                 * 1 final partial buffer
-                 */
-                while (copylen > 0) {
-                    size_t copy2len;
-
-                    /* get new buffer */
-                    res = ses_msg_new_buff(scb,
-                                           FALSE,  /* outbuff */
-                                           &buff);
-                    if (res != NO_ERR) {
-                        return res;
-                    }
-                    dlq_enque(buff, &msg->buffQ);
-
-                    copy2len = min(SES_MSG_BUFFSIZE, copylen);
-                    xml_strncpy(&buff->buff[buff->buffpos],
-                                &scb->readbuff[count],
-                                copy2len);
-                    buff->buffpos += copy2len;
-                    buff->bufflen = copy2len;
-                    copylen -= copy2len;
-                    count += copy2len;
-                }
+            res = copy_input_span(scb,
+                                  msg,
+                                  &buff,
+                                  &scb->readbuff[count],
+                                  copylen);
+            if (res != NO_ERR) {
+                return res;
             }
+            count += copylen;
             break;
         case SES_INST_INBETWEEN:
             if (scb->inendpos == 0) {
@@ -763,13 +870,12 @@ static void
                      xmlChar ch)
 {
     xmlChar     numbuff[NCX_MAX_NUMLEN];
+    int         len;
 
-    snprintf((char *)numbuff, NCX_MAX_NUMLEN, "%u", (uint32)ch);
-
-    ses_putchar(scb, '&');
-    ses_putchar(scb, '#');
-    ses_putstr(scb, numbuff);
-    ses_putchar(scb, ';');
+    len = snprintf((char *)numbuff, NCX_MAX_NUMLEN, "&#%u;", (uint32)ch);
+    if (len > 0) {
+        ses_putnstr(scb, numbuff, (uint32)len);
+    }
 
 }  /* put_char_entity */
 
@@ -945,8 +1051,7 @@ ses_cb_t *
     }
     memset(scb, 0x0, sizeof(ses_cb_t));
 
-    /* TBD: make session read buff size configurable */
-    scb->readbuffsize = SES_READBUFF_SIZE;
+    scb->readbuffsize = readbuff_size;
 
     /* make sure the debug log trace code never writes a zero byte
      * past the end of a full read buffer by adding 2 pad bytes
@@ -960,7 +1065,6 @@ ses_cb_t *
 
     scb->start_time = now;
     dlq_createSQue(&scb->msgQ);
-    dlq_createSQue(&scb->freeQ);
     dlq_createSQue(&scb->outQ);
     scb->linesize = SES_DEF_LINESIZE;
     scb->withdef = NCX_DEF_WITHDEF;
@@ -1057,15 +1161,6 @@ void ses_free_scb (ses_cb_t *scb)
         ses_msg_free_buff(scb, buff);
     }
 
-    /* the freeQ must be cleared after the outQ because
-     * the normal free buffer action is to move it to
-     * the scb->freeQ
-     */
-    while (!dlq_empty(&scb->freeQ)) {
-        buff = (ses_msg_buff_t *)dlq_deque(&scb->freeQ);
-        ses_msg_free_buff(scb, buff);
-    }
-
     if (scb->readbuff != NULL) {
         m__free(scb->readbuff);
     }
@@ -1147,6 +1242,79 @@ void
 }  /* ses_putchar */
 
 
+/********************************************************************
+* FUNCTION ses_putnstr
+*
+* Write a counted string to the session, without any translation
+*
+* The string is copied into the output buffers in runs,
+* so the per-char overflow check and stats update done
+* in ses_putchar are only done once per buffer
+*
+* THIS FUNCTION DOES NOT CHECK ANY PARAMETERS TO SAVE TIME
+*
+* INPUTS:
+*   scb == session control block to start msg 
+*   str == string to write (does not need to be zero-terminated)
+*   len == number of bytes to write from str
+*
+*********************************************************************/
+void
+    ses_putnstr (ses_cb_t *scb,
+                 const xmlChar *str,
+                 uint32 len)
+{
+    status_t res;
+    uint32   done, cnt;
+
+    if (len == 0) {
+        return;
+    }
+
+    if (scb->fd) {
+        /* Normal NETCONF session mode: */
+        res = NO_ERR;
+        done = 0;
+        while (done < len && res == NO_ERR) {
+            if (scb->outbuff == NULL) {
+                res = ses_msg_new_buff(scb, TRUE, &scb->outbuff);
+                if (res == NO_ERR && scb->outbuff == NULL) {
+                    res = ERR_NCX_OPERATION_FAILED;
+                }
+                continue;
+            }
+            cnt = ses_msg_write_nbuff(scb, scb->outbuff, 
+                                      &str[done], len - done);
+            if (cnt == 0) {
+                res = ses_msg_new_output_buff(scb);
+            } else {
+                done += cnt;
+            }
+        }
+
+        scb->stats.out_bytes += done;
+        totals.stats.out_bytes += done;
+    } else if (scb->fp) {
+        /* debug session, sending output to a file */
+        fwrite(str, 1, len, scb->fp);
+    } else {
+        /* debug session, sending output to the screen */
+        fwrite(str, 1, len, stdout);
+    }
+
+    /* out_line is the number of chars after the last newline */
+    for (cnt = len; cnt > 0 && str[cnt-1] != '\n'; cnt--) {
+        ;
+    }
+    if (cnt) {
+        scb->stats.out_line = len - cnt;
+    } else {
+        scb->stats.out_line += len;
+    }
+
+}  /* ses_putnstr */
+
+
 /********************************************************************
 * FUNCTION ses_putstr
 *
@@ -1163,9 +1331,7 @@ void
     ses_putstr (ses_cb_t *scb,
                 const xmlChar *str)
 {
-    while (*str) {
-        ses_putchar(scb, *str++);
-    }
+    ses_putnstr(scb, str, xml_strlen(str));
 
 }  /* ses_putstr */
 
@@ -1190,19 +1356,27 @@ void
                        const xmlChar *str,
                        int32 indent)
 {
+    const xmlChar *run;
+
     ses_indent(scb, indent);
+
+    if (indent < 0) {
+        ses_putstr(scb, str);
+        return;
+    }
+
+    run = str;
     while (*str) {
         if (*str == '\n') {
-            if (indent < 0) {
-                ses_putchar(scb, *str++);
-            } else {
-                ses_indent(scb, indent);
-                str++;
-            }
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_indent(scb, indent);
+            run = ++str;
         } else {
-            ses_putchar(scb, *str++);
+            str++;
         }
     }
+    ses_putnstr(scb, run, (uint32)(str - run));
+
 }  /* ses_putstr_indent */
 
 
@@ -1226,28 +1400,44 @@ void
                  const xmlChar *str,
                  int32 indent)
 {
+    const xmlChar *run;
+    boolean        donl;
+
+    /* only translate newlines if they are going to be indented */
+    donl = ((scb->mode == SES_MODE_XMLDOC || scb->mode == SES_MODE_TEXT)
+            && indent >= 0) ? TRUE : FALSE;
+
+    run = str;
     while (*str) {
-        if (*str == '<') {
-            ses_putstr(scb, LTSTR);
-            str++;
-        } else if (*str == '>') {
-            ses_putstr(scb, GTSTR);
-            str++;
-        } else if (*str == '&') {
-            ses_putstr(scb, AMPSTR);
-            str++;
-        } else if ((scb->mode == SES_MODE_XMLDOC
-                    || scb->mode == SES_MODE_TEXT) && *str == '\n') {
-            if (indent < 0) {
-                ses_putchar(scb, *str++);
-            } else {
-                ses_indent(scb, indent);
+        switch (*str) {
+        case '<':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, LTSTR, 4);
+            break;
+        case '>':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, GTSTR, 4);
+            break;
+        case '&':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, AMPSTR, 5);
+            break;
+        case '\n':
+            if (!donl) {
                 str++;
+                continue;
             }
-        } else {
-            ses_putchar(scb, *str++);
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_indent(scb, indent);
+            break;
+        default:
+            str++;
+            continue;
         }
+        run = ++str;
     }
+    ses_putnstr(scb, run, (uint32)(str - run));
+
 }  /* ses_putcstr */
 
 
@@ -1269,20 +1459,8 @@ void
     ses_puthstr (ses_cb_t *scb,
                  const xmlChar *str)
 {
-    while (*str) {
-        if (*str == '<') {
-            ses_putstr(scb, LTSTR);
-            str++;
-        } else if (*str == '>') {
-            ses_putstr(scb, GTSTR);
-            str++;
-        } else if (*str == '&') {
-            ses_putstr(scb, AMPSTR);
-            str++;
-        } else {
-            ses_putchar(scb, *str++);
-        }
-    }
+    ses_putcstr(scb, str, -1);
+
 }  /* ses_puthstr */
 
 
@@ -1350,37 +1528,55 @@ void
                  const xmlChar *str,
                  int32 indent)
 {
+    const xmlChar *run;
+    boolean        textmode;
+
+    textmode = (scb->mode == SES_MODE_XMLDOC || 
+                scb->mode == SES_MODE_TEXT) ? TRUE : FALSE;
+
+    run = str;
     while (*str) {
-        if (*str == '<') {
-            ses_putstr(scb, LTSTR);
-            str++;
-        } else if (*str == '>') {
-            ses_putstr(scb, GTSTR);
-            str++;
-        } else if (*str == '&') {
-            ses_putstr(scb, AMPSTR);
-            str++;
-        } else if (*str == '"') {
-            ses_putstr(scb, QSTR);
-            str++;
-        } else if (*str == '\n') {
-            if (scb->mode == SES_MODE_XMLDOC || 
-                scb->mode == SES_MODE_TEXT) {
-                if (indent < 0) {
-                    ses_putchar(scb, *str++);
-                } else {
-                    ses_indent(scb, indent);
-                    str++;
-                }
+        switch (*str) {
+        case '<':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, LTSTR, 4);
+            break;
+        case '>':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, GTSTR, 4);
+            break;
+        case '&':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, AMPSTR, 5);
+            break;
+        case '"':
+            ses_putnstr(scb, run, (uint32)(str - run));
+            ses_putnstr(scb, QSTR, 6);
+            break;
+        case '\n':
+            if (textmode && indent < 0) {
+                str++;
+                continue;
+            }
+            ses_putnstr(scb, run, (uint32)(str - run));
+            if (textmode) {
+                ses_indent(scb, indent);
             } else {
-                put_char_entity(scb, *str++);
+                put_char_entity(scb, *str);
             }
-        } else if (isspace(*str)) {
-            put_char_entity(scb, *str++);
-        } else {
-            ses_putchar(scb, *str++);
+            break;
+        default:
+            if (!isspace(*str)) {
+                str++;
+                continue;
+            }
+            ses_putnstr(scb, run, (uint32)(str - run));
+            put_char_entity(scb, *str);
         }
+        run = ++str;
     }
+    ses_putnstr(scb, run, (uint32)(str - run));
+
 }  /* ses_putastr */
 
 
@@ -1404,46 +1600,45 @@ void
                  const xmlChar *str,
                  int32 indent)
 {
+    const xmlChar *run;
+    xmlChar        esc[2];
+
     ses_indent(scb, indent);
+
+    esc[0] = '\\';
+    run = str;
     while (*str) {
         switch (*str) {
         case '"':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, '"');
-            break;
         case '\\':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, '\\');
-            break;
         case '/':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, '/');
+            esc[1] = *str;
             break;
         case '\b':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, 'b');
+            esc[1] = 'b';
             break;
         case '\f':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, 'f');
+            esc[1] = 'f';
             break;
         case '\n':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, 'n');
+            esc[1] = 'n';
             break;
         case '\r':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, 'r');
+            esc[1] = 'r';
             break;
         case '\t':
-            ses_putchar(scb, '\\');
-            ses_putchar(scb, 't');
+            esc[1] = 't';
             break;
         default:
-            ses_putchar(scb, *str);
+            str++;
+            continue;
         }
-        ++str;
+        ses_putnstr(scb, run, (uint32)(str - run));
+        ses_putnstr(scb, esc, 2);
+        run = ++str;
     }
+    ses_putnstr(scb, run, (uint32)(str - run));
+
 }  /* ses_putjstr */
 
 
@@ -1467,7 +1662,7 @@ void
     ses_indent (ses_cb_t *scb,
                 int32 indent)
 {
-    int32 i;
+    uint32 cnt;
 
     if (indent < 0) {
         return;
@@ -1475,9 +1670,16 @@ void
 
     /* set limit on indentation in case of bug */
     indent = min(indent, 255);
-    ses_putchar(scb, '\n');
-    for (i=0; i<indent; i++) {
-        ses_putchar(scb, ' ');
+
+    /* newline + first run of spaces */
+    cnt = (uint32)min(indent, SES_INDENT_RUN);
+    ses_putnstr(scb, indentstr, cnt + 1);
+    indent -= (int32)cnt;
+
+    while (indent > 0) {
+        cnt = (uint32)min(indent, SES_INDENT_RUN);
+        ses_putnstr(scb, &indentstr[1], cnt);
+        indent -= (int32)cnt;
     }
 
 }  /* ses_indent */
@@ -1618,6 +1820,10 @@ void ses_finish_msg (ses_cb_t *scb)
     if (scb->transport==SES_TRANSPORT_SSH ||
         scb->transport==SES_TRANSPORT_TCP) {
         if (scb->framing11) {
+            if (scb->outbuff == NULL &&
+                ses_msg_new_buff(scb, TRUE, &scb->outbuff) != NO_ERR) {
+                return;
+            }
             scb->outbuff->islast = TRUE;
         } else {
             ses_putstr(scb, (const xmlChar *)NC_SSH_END);
@@ -2068,6 +2274,7 @@ void
 * FUNCTION ses_get_total_stats
 * 
 *  Get a r/w pointer to the the session totals stats
+*  The shared buffer pool stats are refreshed first
 *
 * RETURNS:
 *  pointer to the global session stats struct 
@@ -2075,10 +2282,29 @@ void
 ses_total_stats_t *
     ses_get_total_stats (void)
 {
+    ses_msg_get_pool_stats(totals.pool);
     return &totals;
 } /* ses_get_total_stats */
 
 
+/********************************************************************
+* FUNCTION ses_set_readbuff_size
+* 
+*  Set the size of the read buffer allocated for each
+*  new session; existing sessions are not changed
+*
+* INPUTS:
+*   readsize == number of bytes to read from the session
+*               in one call
+*********************************************************************/
+void
+    ses_set_readbuff_size (uint32 readsize)
+{
+    readbuff_size = readsize;
+
+} /* ses_set_readbuff_size */
+
+
 /********************************************************************
 * FUNCTION ses_get_transport_name
 * 
@@ -81,20 +81,60 @@ extern "C" {
 
 #define SES_NULL_SID  0
 
-/* controls the size of each buffer chuck */
+/* default size of each buffer chuck */
 #define SES_MSG_BUFFSIZE  2000   // 1024
 
-/* max number of buffer chunks a session can have allocated at once  */
+/* default size of the buffer chunks used after the first
+ * buffer of a large message has been filled; 0 == disabled
+ */
+#define SES_MSG_BULK_BUFFSIZE  65536
+
+/* min and max configurable buffer chunk size;
+ * max is limited by the 7 digit chunk size in SES_STARTCHUNK_PAD
+ */
+#define SES_MSG_MIN_BUFFSIZE  512
+#define SES_MSG_MAX_BUFFSIZE  1048576
+
+/* default max number of buffer chunks a session can 
+ * have allocated at once 
+ */
 #define SES_MAX_BUFFERS  4096
 
-/* max number of buffers a session is allowed to cache in its freeQ */
-#define SES_MAX_FREE_BUFFERS  32
+/* default number of queued output bytes at which a session
+ * that is generating a reply has its writer suspended,
+ * until the outQ has been sent down to half of this amount;
+ * 0 == no limit
+ */
+#define SES_MAX_QUEUED_OUTPUT  0x40000
+
+/* default number of seconds a suspended writer can wait
+ * for the client to read any of its queued output before
+ * the session is dropped; 0 == no timeout
+ */
+#define SES_WRITE_TIMEOUT      60
+
+/* size of the stack a reply writer runs on, so it can be
+ * suspended; pages are only used as the stack grows into them,
+ * and a PROT_NONE guard page is mapped below the stack
+ */
+#define SES_WRITER_STACKSIZE   (8 * 1024 * 1024)
+
+/* the shared buffer pool trims a size class back down to
+ * the low watermark when the number of cached free items
+ * goes above the high watermark; marks are in bytes and
+ * converted to an item count for each size class
+ */
+#define SES_POOL_HIWAT_BYTES  0x400000
+#define SES_POOL_LOWAT_BYTES  0x100000
+
+/* minimum high watermark item count for a size class */
+#define SES_POOL_MIN_HIWAT  32
 
 /* max number of buffers to try to send in one call to the write fn */
-#define SES_MAX_BUFFSEND   32
+#define SES_MAX_BUFFSEND   256
 
 /* max number of bytes to try to send in one call to the write_fn */
-#define SES_MAX_BYTESEND   0xffff
+#define SES_MAX_BYTESEND   0x40000
 
 /* max desired lines size; not a hard limit */
 #define SES_DEF_LINESIZE   72
@@ -225,6 +265,27 @@ typedef struct ses_stats_t_ {
 } ses_stats_t;
 
 
+/* shared pool size classes for session messages and buffers */
+typedef enum ses_pool_id_t_ {
+    SES_POOL_MSG,          /* ses_msg_t headers */
+    SES_POOL_BUFF,         /* first buffer of a message */
+    SES_POOL_BULK,         /* 2nd - Nth buffer of a large message */
+    SES_NUM_POOLS
+} ses_pool_id_t;
+
+
+/* Shared Pool Statistics, 1 per size class */
+typedef struct ses_pool_stats_t_ {
+    uint32            itemsize;            /* bytes per item */
+    uint32            inuse;          /* items handed out now */
+    uint32            peak_inuse;       /* max inuse reached */
+    uint32            cached;     /* items on the free list */
+    uint32            allocs;         /* total get requests */
+    uint32            hits;       /* gets from the free list */
+    uint32            trims;   /* items freed at high water */
+} ses_pool_stats_t;
+
+
 /* Session Total Statistics */
 typedef struct ses_total_stats_t_ {
     uint32            active_sessions;
@@ -234,6 +295,7 @@ typedef struct ses_total_stats_t_ {
     uint32            inSessions;
     uint32            droppedSessions;
     ses_stats_t       stats;
+    ses_pool_stats_t  pool[SES_NUM_POOLS];
     xmlChar           startTime[TSTAMP_MIN_SIZE];
 } ses_total_stats_t;
 
@@ -245,7 +307,10 @@ typedef struct ses_msg_buff_t_ {
     size_t           bufflen;        /* buff actual size */
     size_t           buffpos;       /* buff cur position */
     boolean          islast;      /* T: last buff in msg */
-    xmlChar          buff[SES_MSG_BUFFSIZE];   
+    boolean          framed;     /* T: chunk framing added */
+    ses_pool_id_t    poolid;      /* pool size class used */
+    size_t           buffsize;      /* bytes allocated buff */
+    xmlChar         *buff;      /* buffsize bytes after hdr */
 } ses_msg_buff_t;
 
 
@@ -298,6 +363,8 @@ typedef struct ses_cb_t_ {
     boolean          active;            /* <hello> completed ok */
     boolean          notif_active;       /* subscription active */
     boolean          stream_output;        /* buffer/stream svr */
+    boolean          outcork;     /* T: hold back finished msgs */
+    boolean          outwait;      /* T: event loop write armed */
     boolean          noxmlns;          /* xml-nons display-mode */
     boolean          framing11;     /* T: base:1.1, F: base:1.0 */
     xmlTextReaderPtr reader;             /* input stream reader */
@@ -308,11 +375,12 @@ typedef struct ses_cb_t_ {
     uint32           inendpos;      /* inside framing directive */
     ses_instate_t    instate;               /* input state enum */
     uint32           buffcnt;           /* current buffer count */
-    uint32           freecnt;            /* current freeQ count */
     dlq_hdr_t        msgQ;              /* Q of ses_msg_t input */
-    dlq_hdr_t        freeQ;              /* Q of ses_msg_buff_t */
     dlq_hdr_t        outQ;               /* Q of ses_msg_buff_t */
+    uint32           outbytes;         /* bytes left in the outQ */
     ses_msg_buff_t  *outbuff;          /* current output buffer */
+    struct ses_writer_t_ *writer;    /* set if msg gen suspended */
+    time_t           out_time;  /* last output sent, if suspended */
     ses_ready_t      inready;            /* header for inreadyQ */
     ses_ready_t      outready;          /* header for outreadyQ */
     ses_stats_t      stats;           /* per-session statistics */
@@ -417,6 +485,25 @@ extern void
 		 uint32    ch);
 
 
+/********************************************************************
+* FUNCTION ses_putnstr
+*
+* Write a counted string to the session, without any translation
+*
+* THIS FUNCTION DOES NOT CHECK ANY PARAMETERS TO SAVE TIME
+*
+* INPUTS:
+*   scb == session control block to start msg 
+*   str == string to write (does not need to be zero-terminated)
+*   len == number of bytes to write from str
+*
+*********************************************************************/
+extern void
+    ses_putnstr (ses_cb_t *scb,
+		 const xmlChar *str,
+		 uint32 len);
+
+
 /********************************************************************
 * FUNCTION ses_putstr
 *
@@ -791,6 +878,7 @@ extern void
 * FUNCTION ses_get_total_stats
 * 
 *  Get a r/w pointer to the the session totals stats
+*  The shared buffer pool stats are refreshed first
 *
 * RETURNS:
 *  pointer to the global session stats struct 
@@ -799,6 +887,20 @@ extern ses_total_stats_t *
     ses_get_total_stats (void);
 
 
+/********************************************************************
+* FUNCTION ses_set_readbuff_size
+* 
+*  Set the size of the read buffer allocated for each
+*  new session; existing sessions are not changed
+*
+* INPUTS:
+*   readsize == number of bytes to read from the session
+*               in one call
+*********************************************************************/
+extern void
+    ses_set_readbuff_size (uint32 readsize);
+
+
 /********************************************************************
 * FUNCTION ses_get_transport_name
 * 
@@ -23,6 +23,8 @@ date         init     comment
 06jun06      abb      begun;
 29apr11      abb      add support for NETCONF:base:1.1 
                       message framing
+16oct26               shared buffer pool with size classes
+17oct26               suspend the message writer on its own stack
 
 *********************************************************************
 *                                                                   *
@@ -36,15 +38,16 @@ date         init     comment
 #include  <unistd.h>
 #include  <errno.h>
 #include  <assert.h>
+#include  <limits.h>
 #include  <sys/uio.h>
 
 #include  "procdefs.h"
 #include  "log.h"
-#include  "send_buff.h"
 #include  "ses.h"
 #include  "ses_msg.h"
 #include  "status.h"
 #include  "tstamp.h"
+#include  "uptime.h"
 #include  "val.h"
 
 /********************************************************************
@@ -57,8 +60,33 @@ date         init     comment
 /* #define SES_MSG_CLEAR_INIT_BUFFERS 1 */
 /* #define SES_MSG_DEBUG_CACHE 1 */
 
-/* max number of buffers a session is allowed to cache in its freeQ */
-#define MAX_FREE_MSGS  32
+/* reply writers run on their own stack, switched with the
+ * ucontext functions; these are gone from POSIX.1-2008 and
+ * only used where glibc still has them, and not under
+ * AddressSanitizer, which does not support them.  Without
+ * a writer stack, a writer just runs to the end
+ */
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define SES_MSG_WRITER_STACK 1
+#endif
+
+#if defined(SES_MSG_WRITER_STACK) && defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#undef SES_MSG_WRITER_STACK
+#endif
+#endif
+
+#ifdef SES_MSG_WRITER_STACK
+#include  <ucontext.h>
+#include  <sys/mman.h>
+#endif
+
+/* max number of iovecs gathered into 1 writev call */
+#if defined(IOV_MAX) && (IOV_MAX < SES_MAX_BUFFSEND)
+#define SES_MSG_MAX_IOV  IOV_MAX
+#else
+#define SES_MSG_MAX_IOV  SES_MAX_BUFFSEND
+#endif
 
 
 /********************************************************************
@@ -66,7 +94,39 @@ date         init     comment
 *                           T Y P E S                               *
 *                                                                   *
 *********************************************************************/
-    
+
+/* one size class in the shared pool
+ * every item starts with a dlq_hdr_t so it can be
+ * kept in the freeQ while it is not in use
+ */
+typedef struct ses_msg_pool_t_ {
+    dlq_hdr_t         freeQ;            /* Q of cached free items */
+    uint32            hiwat;          /* trim freeQ above this */
+    uint32            lowat;         /* trim freeQ down to this */
+    ses_pool_stats_t  stats;
+} ses_msg_pool_t;
+
+
+#ifdef SES_MSG_WRITER_STACK
+/* message writer for 1 session
+ * The writer function runs on its own stack, so message
+ * generation can give control back to the event loop when
+ * too much output is queued, and continue later from the
+ * same point when the outQ has been sent
+ */
+typedef struct ses_writer_t_ {
+    ucontext_t        ctx;              /* writer context */
+    ucontext_t        caller;    /* context that ran writer */
+    void             *map;     /* guard page + stack mapping */
+    size_t            maplen;         /* length of the map */
+    ses_cb_t         *scb;          /* session being written */
+    ses_writer_fn_t   fn;             /* function to run */
+    void             *cookie;    /* parameter for the fn */
+    boolean           suspended;      /* T: waiting for outQ */
+    boolean           done;         /* T: writer fn returned */
+} ses_writer_t;
+#endif
+
 
 /********************************************************************
 *                                                                   *
@@ -74,11 +134,35 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 static boolean   ses_msg_init_done = FALSE;
-static uint32    freecnt;
-static dlq_hdr_t freeQ;
 static dlq_hdr_t inreadyQ;
 static dlq_hdr_t outreadyQ;
 
+/* shared pool of free messages and buffers for all sessions */
+static ses_msg_pool_t pools[SES_NUM_POOLS];
+
+/* max number of buffers 1 session can have allocated */
+static uint32    max_buffers = SES_MAX_BUFFERS;
+
+/* max number of output bytes 1 session can have queued 
+ * while a message is being generated; 0 == no limit
+ */
+static uint32    max_queued_output = 0;
+
+#ifdef SES_MSG_WRITER_STACK
+/* writer kept for reuse, so its stack does not need to be
+ * mapped again for every reply
+ */
+static ses_writer_t *freewriter;
+
+/* writer running right now, if any */
+static ses_writer_t *curwriter;
+
+/* writer running or suspended, if any; only 1 reply at
+ * a time is generated by a writer
+ */
+static ses_writer_t *activewriter;
+#endif
+
 
 /********************************************************************
 * FUNCTION trace_buff
@@ -107,65 +191,481 @@ static void
 } /* trace_buff */
 
 /********************************************************************
-* FUNCTION do_send_buff
+* FUNCTION prep_send_buff
 *
-* Send the specified buffer.
-* Add framing chars if needed for base:1.1 over SSH
+* Get an outQ buffer ready to be sent with writev
+* Adds the base:1.1 chunk framing the first time the
+* buffer is seen, and sets buffpos to the first byte to send
 *
 * INPUTS:
 *   scb == session control block to use
-*   buff == buffer to send
+*   buff == buffer to check
+*
+* RETURNS:
+*   number of bytes left to send from this buffer
+*********************************************************************/
+static size_t
+    prep_send_buff (ses_cb_t *scb,
+                    ses_msg_buff_t *buff)
+{
+    if (scb->framing11) {
+        if (!buff->framed) {
+            ses_msg_add_framing(scb, buff);
+            buff->buffpos = buff->buffstart;
+        }
+
+        /* bufflen has been adjusted for buffstart */
+        return buff->buffstart + buff->bufflen - buff->buffpos;
+    }
+
+    return buff->bufflen - buff->buffpos;
+
+}  /* prep_send_buff */
+
+
+/********************************************************************
+* FUNCTION queue_output_buff
+*
+* Add a finished output buffer to the outQ
+* The base:1.1 chunk framing is added now, so scb->outbytes
+* counts the exact number of bytes left to send
+*
+* INPUTS:
+*   scb == session control block to use
+*   buff == buffer to queue
+*********************************************************************/
+static void
+    queue_output_buff (ses_cb_t *scb,
+                       ses_msg_buff_t *buff)
+{
+    scb->outbytes += (uint32)prep_send_buff(scb, buff);
+    dlq_enque(buff, &scb->outQ);
+
+}  /* queue_output_buff */
+
+
+#ifdef SES_MSG_WRITER_STACK
+/********************************************************************
+* FUNCTION new_writer
+*
+* Get a writer with a stack, either the cached one
+* or a new one
+*
+* The stack is mapped with a PROT_NONE guard page below it,
+* so a writer that runs off the end of its stack faults
+* instead of writing over the next mapping
+*
+* RETURNS:
+*   pointer to writer or NULL if malloc or mmap failed
+*********************************************************************/
+static ses_writer_t *
+    new_writer (void)
+{
+    ses_writer_t  *writer;
+    long           pagesize;
+
+    if (freewriter) {
+        writer = freewriter;
+        freewriter = NULL;
+        return writer;
+    }
+
+    pagesize = sysconf(_SC_PAGESIZE);
+    if (pagesize <= 0) {
+        return NULL;
+    }
+
+    writer = m__getObj(ses_writer_t);
+    if (writer == NULL) {
+        return NULL;
+    }
+    memset(writer, 0x0, sizeof(ses_writer_t));
+
+    writer->maplen = SES_WRITER_STACKSIZE + (size_t)pagesize;
+    writer->map = mmap(NULL, 
+                       writer->maplen,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                       -1, 
+                       0);
+    if (writer->map == MAP_FAILED) {
+        m__free(writer);
+        return NULL;
+    }
+
+    /* the stack grows down towards the guard page */
+    if (mprotect(writer->map, (size_t)pagesize, PROT_NONE) != 0) {
+        (void)munmap(writer->map, writer->maplen);
+        m__free(writer);
+        return NULL;
+    }
+    return writer;
+
+}  /* new_writer */
+
+
+/********************************************************************
+* FUNCTION free_writer
+*
+* Cache or free a writer that is done
+*
+* INPUTS:
+*   writer == writer to free
+*********************************************************************/
+static void
+    free_writer (ses_writer_t *writer)
+{
+    if (freewriter == NULL) {
+        writer->scb = NULL;
+        writer->fn = NULL;
+        writer->cookie = NULL;
+        freewriter = writer;
+        return;
+    }
+
+    (void)munmap(writer->map, writer->maplen);
+    m__free(writer);
+
+}  /* free_writer */
+
+
+/********************************************************************
+* FUNCTION writer_main
+*
+* Entry point of the writer stack
+* Returning from here switches back to writer->caller
+*********************************************************************/
+static void
+    writer_main (void)
+{
+    ses_writer_t  *writer;
+
+    writer = curwriter;
+    (*writer->fn)(writer->scb, writer->cookie);
+    writer->done = TRUE;
+
+}  /* writer_main */
+
+
+/********************************************************************
+* FUNCTION init_writer_context
+*
+* Setup the writer context to start writer_main on the
+* writer stack, above the guard page
+*
+* INPUTS:
+*   writer == writer to setup
 *
 * RETURNS:
 *   status
 *********************************************************************/
 static status_t
-    do_send_buff (ses_cb_t *scb,
-                  ses_msg_buff_t *buff)
+    init_writer_context (ses_writer_t *writer)
 {
-    status_t   res = NO_ERR;
+    if (getcontext(&writer->ctx) != 0) {
+        return ERR_NCX_OPERATION_FAILED;
+    }
 
-    if (scb->framing11) {
-        ses_msg_add_framing(scb, buff);
-        /* bufflen has been adjusted for buffstart */
-        if (LOGDEBUG2) {
-            log_debug2("\nses_msg send 1.1 buff:%u\n",
-                      buff->bufflen - buff->buffpos);
-            if (LOGDEBUG3) {
-                trace_buff(buff);
-            }
-        }
+    writer->ctx.uc_stack.ss_sp = 
+        (char *)writer->map + (writer->maplen - SES_WRITER_STACKSIZE);
+    writer->ctx.uc_stack.ss_size = SES_WRITER_STACKSIZE;
+    writer->ctx.uc_link = &writer->caller;
+    makecontext(&writer->ctx, writer_main, 0);
+    return NO_ERR;
 
-        if (buff->bufflen > 0) {
-            res = send_buff(scb->fd, 
-                            (const char *)&buff->buff[buff->buffstart], 
-                            buff->bufflen);
-        } else if (LOGDEBUG2) {
-            log_debug2("\nses: skip sending empty 1.1 buffer on sesion '%d'",
-                       scb->sid);
+}  /* init_writer_context */
+
+
+/********************************************************************
+* FUNCTION switch_to_writer
+*
+* Run a writer until it is done or suspended
+*
+* INPUTS:
+*   writer == writer to run
+*
+* RETURNS:
+*   NO_ERR if the writer is done and has been freed
+*   ERR_NCX_SUSPENDED if the writer is waiting for the outQ
+*********************************************************************/
+static status_t
+    switch_to_writer (ses_writer_t *writer)
+{
+    curwriter = writer;
+    writer->suspended = FALSE;
+    if (swapcontext(&writer->caller, &writer->ctx) != 0) {
+        /* nothing saved, so the writer never ran */
+        curwriter = NULL;
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+    curwriter = NULL;
+
+    if (writer->done) {
+        writer->scb->writer = NULL;
+        activewriter = NULL;
+        free_writer(writer);
+        return NO_ERR;
+    }
+    return ERR_NCX_SUSPENDED;
+
+}  /* switch_to_writer */
+#endif  /* SES_MSG_WRITER_STACK */
+
+
+/********************************************************************
+* FUNCTION flush_queued_output
+*
+* Start sending the outQ of a stream output session, and
+* suspend the writer of a session with too much output queued
+*
+* The writer gives control back to the event loop, which
+* sends the outQ as the socket takes it and resumes the
+* writer with ses_msg_resume_writer when the outQ is down
+* to half of the limit.  This keeps the memory used by a
+* large reply bounded.  The agent does not start any other
+* request, timer callback or notification while the writer
+* is suspended, since the reply may still be walking a
+* datastore; --write-timeout limits how long that can take
+*
+* Output that is not generated by a writer (such as a
+* notification) cannot be suspended and is just queued
+*
+* INPUTS:
+*   scb == session control block to use
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    flush_queued_output (ses_cb_t *scb)
+{
+#ifdef SES_MSG_WRITER_STACK
+    ses_writer_t  *writer;
+#endif
+    status_t       res;
+
+    res = NO_ERR;
+    if (scb->stream_output && !scb->outcork) {
+        res = ses_msg_send_buffs(scb);
+    }
+    if (!dlq_empty(&scb->outQ)) {
+        ses_msg_make_outready(scb);
+    }
+
+#ifdef SES_MSG_WRITER_STACK
+    writer = scb->writer;
+    if (res != NO_ERR || max_queued_output == 0 ||
+        scb->outbytes < max_queued_output ||
+        writer == NULL || writer != curwriter) {
+        return res;
+    }
+
+    if (LOGDEBUG3) {
+        log_debug3("\nses_msg: suspend writer on session %d (%u bytes)",
+                   scb->sid,
+                   scb->outbytes);
+    }
+
+    (void)uptime(&scb->out_time);
+    writer->suspended = TRUE;
+    if (swapcontext(&writer->ctx, &writer->caller) != 0) {
+        writer->suspended = FALSE;
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+#endif
+
+    /* resumed by ses_msg_resume_writer */
+    return res;
+
+}  /* flush_queued_output */
+
+
+/********************************************************************
+* FUNCTION pool_setup
+*
+* Set the item size and watermarks for 1 pool size class
+* Any cached items of a different size are freed
+*
+* INPUTS:
+*   pool == pool size class to setup
+*   itemsize == number of bytes in each item; 0 if not used
+*********************************************************************/
+static void
+    pool_setup (ses_msg_pool_t *pool,
+                uint32 itemsize)
+{
+    dlq_hdr_t  *item;
+
+    if (pool->stats.itemsize != itemsize) {
+        while (!dlq_empty(&pool->freeQ)) {
+            item = (dlq_hdr_t *)dlq_deque(&pool->freeQ);
+            m__free(item);
         }
+        pool->stats.cached = 0;
+    }
+
+    pool->stats.itemsize = itemsize;
+    if (itemsize == 0) {
+        /* size class not used */
+        pool->hiwat = 0;
+        pool->lowat = 0;
     } else {
-        if (buff->bufflen > buff->buffstart) {
-            /* send with base:1.0 framing; EOM markers in the buffer */
-            if (LOGDEBUG2) {
-                log_debug("\nses_msg send 1.0 buff:%u\n",
-                          buff->bufflen - buff->buffpos);
-                if (LOGDEBUG3) {
-                    trace_buff(buff);
-                }
-            }
-            res = send_buff(scb->fd, 
-                            (const char *)buff->buff, 
-                            buff->bufflen);
-        } else if (LOGDEBUG2) {
-            log_debug2("\nses: skip sending empty 1.0 buffer on sesion '%d'",
-                       scb->sid);
+        pool->hiwat = max(SES_POOL_HIWAT_BYTES / itemsize, 
+                          SES_POOL_MIN_HIWAT);
+        pool->lowat = max(SES_POOL_LOWAT_BYTES / itemsize, 
+                          SES_POOL_MIN_HIWAT / 4);
+    }
+
+}  /* pool_setup */
+
+
+/********************************************************************
+* FUNCTION pool_get
+*
+* Get an item from a pool size class
+* The item is taken from the freeQ if possible or malloced
+*
+* INPUTS:
+*   pool == pool size class to use
+*
+* RETURNS:
+*   pointer to item (pool->stats.itemsize bytes) or NULL
+*   if malloc failed
+*********************************************************************/
+static void *
+    pool_get (ses_msg_pool_t *pool)
+{
+    void  *item;
+
+    pool->stats.allocs++;
+
+    item = dlq_deque(&pool->freeQ);
+    if (item) {
+        pool->stats.cached--;
+        pool->stats.hits++;
+    } else {
+        item = m__getMem(pool->stats.itemsize);
+        if (item == NULL) {
+            return NULL;
         }
     }
 
-    return res;
+    if (++pool->stats.inuse > pool->stats.peak_inuse) {
+        pool->stats.peak_inuse = pool->stats.inuse;
+    }
+    return item;
+
+}  /* pool_get */
+
+
+/********************************************************************
+* FUNCTION pool_put
+*
+* Return an item to a pool size class
+* The freeQ is trimmed to the low watermark if it
+* has reached the high watermark
+*
+* INPUTS:
+*   pool == pool size class the item was taken from
+*   item == item to free
+*   itemsize == number of bytes in the item
+*********************************************************************/
+static void
+    pool_put (ses_msg_pool_t *pool,
+              void *item,
+              uint32 itemsize)
+{
+    dlq_hdr_t  *freeitem;
+
+    if (pool->stats.inuse) {
+        pool->stats.inuse--;
+    }
+
+    if (itemsize != pool->stats.itemsize) {
+        /* pool has been resized since this item was made */
+        m__free(item);
+        return;
+    }
+
+    dlq_enque(item, &pool->freeQ);
+    pool->stats.cached++;
+
+    if (pool->stats.cached > pool->hiwat) {
+        while (pool->stats.cached > pool->lowat) {
+            freeitem = (dlq_hdr_t *)dlq_deque(&pool->freeQ);
+            m__free(freeitem);
+            pool->stats.cached--;
+            pool->stats.trims++;
+        }
+    }
+
+}  /* pool_put */
+
+
+/********************************************************************
+* FUNCTION new_buff
+*
+* Get a new session buffer chunk from a pool size class
+*
+* INPUTS:
+*   scb == session control block to get a new buffer for
+*   outbuff == TRUE if this is for outgoing message
+*              FALSE if this is for incoming message
+*   poolid == pool size class to use
+*   buff == address of ses_msg_buff_t pointer that will be set
+*
+* OUTPUTS:
+*   *buff == session buffer chunk (if NO_ERR return)
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    new_buff (ses_cb_t *scb, 
+              boolean outbuff,
+              ses_pool_id_t poolid,
+              ses_msg_buff_t **buff)
+{
+    ses_msg_pool_t *pool;
+    ses_msg_buff_t *newbuff;
+
+    /* check buffers exceeded error */
+    if (scb->buffcnt+1 >= max_buffers) {
+        return ERR_NCX_RESOURCE_DENIED;
+    }
+
+    pool = &pools[poolid];
+    newbuff = (ses_msg_buff_t *)pool_get(pool);
+    if (newbuff == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    /* the data area follows the buffer header */
+    newbuff->poolid = poolid;
+    newbuff->buffsize = pool->stats.itemsize - sizeof(ses_msg_buff_t);
+    newbuff->buff = (xmlChar *)&newbuff[1];
+
+    /* set the fields and exit */
+    ses_msg_init_buff(scb, outbuff, newbuff);
+
+#ifdef SES_MSG_CLEAR_INIT_BUFFERS
+    memset(newbuff->buff, 0x0, newbuff->buffsize);
+#endif
+
+    *buff = newbuff;
+    scb->buffcnt++;
+
+    if (LOGDEBUG4) {
+        log_debug4("\nses_msg: new %s buff %p (%u) for s %u", 
+                   (outbuff) ? "out" : "in",
+                   newbuff,
+                   (uint32)newbuff->buffsize,
+                   scb->sid);
+    }
 
-}  /* do_send_buff */
+    return NO_ERR;
+
+} /* new_buff */
 
 
 /********************************************************************
@@ -181,9 +681,15 @@ static status_t
 void 
     ses_msg_init (void)
 {
+    ses_pool_id_t  id;
+
     if (!ses_msg_init_done) {
-        freecnt = 0;
-        dlq_createSQue(&freeQ);
+        memset(pools, 0x0, sizeof(pools));
+        for (id = SES_POOL_MSG; id < SES_NUM_POOLS; id++) {
+            dlq_createSQue(&pools[id].freeQ);
+        }
+        pool_setup(&pools[SES_POOL_MSG], sizeof(ses_msg_t));
+        ses_msg_set_buffsize(SES_MSG_BUFFSIZE, SES_MSG_BULK_BUFFSIZE);
         dlq_createSQue(&inreadyQ);
         dlq_createSQue(&outreadyQ);
         ses_msg_init_done = TRUE;
@@ -205,23 +711,32 @@ void
 void 
     ses_msg_cleanup (void)
 {
-    ses_msg_t *msg;
+    dlq_hdr_t     *item;
+    ses_pool_id_t  id;
 
     if (ses_msg_init_done) {
-        while (!dlq_empty(&freeQ)) {
-            msg = (ses_msg_t *)dlq_deque(&freeQ);
+        for (id = SES_POOL_MSG; id < SES_NUM_POOLS; id++) {
             /* these do not belong to any session and do not have
-             * any buffers, so just toss the memory instead of
-             * using ses_msg_free_msg
+             * any buffers, so just toss the memory 
              */
-            m__free(msg);
+            while (!dlq_empty(&pools[id].freeQ)) {
+                item = (dlq_hdr_t *)dlq_deque(&pools[id].freeQ);
+                m__free(item);
+            }
         }
 
         /* nothing malloced in these Qs now */
-        memset(&freeQ, 0x0, sizeof(dlq_hdr_t));
+        memset(pools, 0x0, sizeof(pools));
         memset(&inreadyQ, 0x0, sizeof(dlq_hdr_t));
         memset(&outreadyQ, 0x0, sizeof(dlq_hdr_t));
-        freecnt = 0;
+
+#ifdef SES_MSG_WRITER_STACK
+        if (freewriter) {
+            (void)munmap(freewriter->map, freewriter->maplen);
+            m__free(freewriter);
+            freewriter = NULL;
+        }
+#endif
         ses_msg_init_done = FALSE;
     }
 
@@ -248,16 +763,9 @@ status_t ses_msg_new_msg (ses_msg_t **msg)
 
     assert( msg && "msg == NULL" );
 
-    /* try the freeQ first */
-    newmsg = (ses_msg_t *)dlq_deque(&freeQ);
-    if (newmsg) {
-        freecnt--;
-    } else {
-        /* freeQ is empty, malloc a msg */
-        newmsg = m__getObj(ses_msg_t);
-        if (!newmsg) {
-            return ERR_INTERNAL_MEM;
-        }
+    newmsg = (ses_msg_t *)pool_get(&pools[SES_POOL_MSG]);
+    if (!newmsg) {
+        return ERR_INTERNAL_MEM;
     }
 
     /* set the fields and exit */
@@ -291,12 +799,7 @@ void ses_msg_free_msg (ses_cb_t *scb, ses_msg_t *msg)
         ses_msg_free_buff(scb, buff);
     }
 
-    if (freecnt < MAX_FREE_MSGS) {
-        dlq_enque(msg, &freeQ);
-        freecnt++;
-    } else {
-        m__free(msg);
-    }
+    pool_put(&pools[SES_POOL_MSG], msg, sizeof(ses_msg_t));
         
 } /* ses_msg_free_msg */
 
@@ -304,7 +807,9 @@ void ses_msg_free_msg (ses_cb_t *scb, ses_msg_t *msg)
 /********************************************************************
 * FUNCTION ses_msg_new_buff
 *
-* Malloc a new session buffer chuck
+* Get a new session buffer chuck from the shared pool
+* This is the normal size buffer used for the first
+* buffer in a message
 *
 * Note that the buffer memory is not cleared after each use
 * since this is not needed for byte stream IO
@@ -325,76 +830,55 @@ status_t ses_msg_new_buff( ses_cb_t *scb,
                            boolean outbuff,
                            ses_msg_buff_t **buff)
 {
-    ses_msg_buff_t *newbuff;
-
     assert( scb && "scb == NULL" );
     assert( buff && "buff == NULL" );
 
-    /* handle the session freeQ separately */
-    if (scb->freecnt) {
-        newbuff = (ses_msg_buff_t *)dlq_deque(&scb->freeQ);
-        if (newbuff) {
-            /* use buffer from freeQ */
-            ses_msg_init_buff(scb, outbuff, newbuff);
-
-#ifdef SES_MSG_CLEAR_INIT_BUFFERS
-            memset(newbuff->buff, 0x0, SES_MSG_BUFFSIZE);
-#endif
-
-            *buff = newbuff;
-            scb->freecnt--;
-
-            if (LOGDEBUG4) {
-                log_debug4("\nses_msg: reused %s buff %p for s %u", 
-                           (outbuff) ? "out" : "in",
-                           newbuff,
-                           scb->sid);
-            }
-
-            return NO_ERR;
-        } else {
-            SET_ERROR(ERR_INTERNAL_VAL);
-            scb->freecnt = 0;
-        }
-    }
-
-    /* check buffers exceeded error */
-    if (scb->buffcnt+1 >= SES_MAX_BUFFERS) {
-        return ERR_NCX_RESOURCE_DENIED;
-    }
-
-    /* malloc the buffer */
-    newbuff = m__getObj(ses_msg_buff_t);
-    if (newbuff == NULL) {
-        return ERR_INTERNAL_MEM;
-    }
-
-    /* set the fields and exit */
-    ses_msg_init_buff(scb, outbuff, newbuff);
+    return new_buff(scb, outbuff, SES_POOL_BUFF, buff);
 
-#ifdef DEBUG
-    memset(newbuff->buff, 0x0, SES_MSG_BUFFSIZE);
-#endif
+} /* ses_msg_new_buff */
 
-    *buff = newbuff;
-    scb->buffcnt++;
 
-    if (LOGDEBUG4) {
-        log_debug4("\nses_msg: new %s buff %p for s %u", 
-                   (outbuff) ? "out" : "in",
-                   newbuff,
-                   scb->sid);
-    }
+/********************************************************************
+* FUNCTION ses_msg_new_bulk_buff
+*
+* Get a new bulk session buffer chuck from the shared pool
+* This is used for the 2nd - Nth buffers of a large message
+* If no bulk buffer size is configured then a normal size 
+* buffer is used instead
+*
+* INPUTS:
+*   scb == session control block to malloc a new message for
+*   outbuff == TRUE if this is for outgoing message
+*              FALSE if this is for incoming message
+*   buff == address of ses_msg_buff_t pointer that will be set
+*
+* OUTPUTS:
+*   *buff == malloced session buffer chunk (if NO_ERR return)
+*
+* RETURNS:
+*   status
+*********************************************************************/
+status_t ses_msg_new_bulk_buff( ses_cb_t *scb, 
+                                boolean outbuff,
+                                ses_msg_buff_t **buff)
+{
+    assert( scb && "scb == NULL" );
+    assert( buff && "buff == NULL" );
 
-    return NO_ERR;
+    return new_buff(scb, 
+                    outbuff, 
+                    (pools[SES_POOL_BULK].stats.itemsize) ? 
+                    SES_POOL_BULK : SES_POOL_BUFF,
+                    buff);
 
-} /* ses_msg_new_buff */
+} /* ses_msg_new_bulk_buff */
 
 
 /********************************************************************
 * FUNCTION ses_msg_free_buff
 *
 * Free the session buffer chunk
+* The buffer is returned to the shared pool
 *
 * INPUTS:
 *   scb == session control block owning the message
@@ -409,27 +893,18 @@ void
 {
     assert( scb && "scb == NULL" );
 
-    if (scb->state < SES_ST_SHUTDOWN_REQ &&
-        scb->freecnt < SES_MAX_FREE_BUFFERS) {
-        dlq_enque(buff, &scb->freeQ);
-        scb->freecnt++;
-
-#ifdef SES_MSG_DEBUG_CACHE
-        if (LOGDEBUG4) {
-            log_debug4("\nses_msg: cache buff %p for s %u", 
-                       buff,
-                       scb->sid);
-        }
-#endif
-    } else {
 #ifdef SES_MSG_DEBUG_CACHE
-        if (LOGDEBUG4) {
-            log_debug4("\nses_msg: free buff %p for s %u", 
-                       buff,
-                       scb->sid);
-        }
+    if (LOGDEBUG4) {
+        log_debug4("\nses_msg: free buff %p for s %u", 
+                   buff,
+                   scb->sid);
+    }
 #endif
-        m__free(buff);
+
+    pool_put(&pools[buff->poolid], 
+             buff, 
+             (uint32)(buff->buffsize + sizeof(ses_msg_buff_t)));
+    if (scb->buffcnt) {
         scb->buffcnt--;
     }
 
@@ -466,13 +941,13 @@ status_t
 
     res = NO_ERR;
     if (scb->framing11) {
-        if (buff->bufflen < (SES_MSG_BUFFSIZE - SES_ENDCHUNK_PAD)) {
+        if (buff->bufflen < (buff->buffsize - SES_ENDCHUNK_PAD)) {
             buff->buff[buff->bufflen++] = (xmlChar)ch;
         } else {
             res = ERR_BUFF_OVFL;
         }
     } else {
-        if (buff->bufflen < SES_MSG_BUFFSIZE) {
+        if (buff->bufflen < buff->buffsize) {
             buff->buff[buff->bufflen++] = (xmlChar)ch;
         } else {
             res = ERR_BUFF_OVFL;
@@ -483,11 +958,59 @@ status_t
 } /* ses_msg_write_buff */
 
 
+/********************************************************************
+* FUNCTION ses_msg_write_nbuff
+*
+* Add a run of text to the message buffer
+* Copies as many bytes as will fit in the buffer
+*
+* Upper layer code should never write framing chars to the
+* output buff -- that is always done in this module.
+*
+* INPUTS:
+*   scb == session control block to use
+*   buff == buffer to write to
+*   str == text to write
+*   len == number of bytes in str to write
+*
+* RETURNS:
+*   number of bytes copied into the buffer;
+*   less than len if the buffer is full
+*********************************************************************/
+uint32
+    ses_msg_write_nbuff (ses_cb_t *scb,
+                         ses_msg_buff_t *buff,
+                         const xmlChar *str,
+                         uint32 len)
+{
+    size_t   limit, room;
+
+    assert( scb && "scb == NULL" );
+    assert( buff && "buff == NULL" );
+
+    /* leave room for the chunk trailer if base:1.1 framing */
+    limit = (scb->framing11) ? 
+        (buff->buffsize - SES_ENDCHUNK_PAD) : buff->buffsize;
+    room = (buff->bufflen < limit) ? (limit - buff->bufflen) : 0;
+    if (len > room) {
+        len = (uint32)room;
+    }
+    if (len) {
+        memcpy(&buff->buff[buff->bufflen], str, len);
+        buff->bufflen += len;
+    }
+    return len;
+
+} /* ses_msg_write_nbuff */
+
+
 /********************************************************************
 * FUNCTION ses_msg_send_buffs
 *
 * Send multiple buffers to the session client socket
-* Tries to send one packet at maximum MTU
+* Gathers the queued buffers (and base:1.1 chunk headers)
+* into one writev call; a partial write is resumed at the
+* same byte offset on the next call
 *
 * INPUTS:
 *   scb == session control block
@@ -499,12 +1022,11 @@ status_t
     ses_msg_send_buffs (ses_cb_t *scb)
 {
     ses_msg_buff_t  *buff;
-    uint32           buffleft, total;
+    size_t           buffleft, total;
     ssize_t          retcnt;
-    int              i, cnt;
-    boolean          done;
+    int              cnt;
     status_t         res;
-    struct iovec     iovs[SES_MAX_BUFFSEND];
+    struct iovec     iovs[SES_MSG_MAX_IOV];
 
     assert( scb && "scb == NULL" );
 
@@ -534,100 +1056,86 @@ status_t
 
     /* check if an external write function is used */
     if (scb->wrfn) {
-        return (*scb->wrfn)(scb);
+        res = (*scb->wrfn)(scb);
+        if (dlq_empty(&scb->outQ)) {
+            scb->outbytes = 0;
+        }
+        return res;
     }
 
-    memset(iovs, 0x0, sizeof(iovs));
+    /* setup the writev call; gather as many queued buffers
+     * as allowed, including the base:1.1 chunk headers and
+     * continuing from the offset where the last write stopped
+     */
     total = 0;
     cnt = 0;
-    done = FALSE;
-    buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
+    for (buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
+         buff != NULL && cnt < SES_MSG_MAX_IOV && total < SES_MAX_BYTESEND;
+         buff = (ses_msg_buff_t *)dlq_nextEntry(buff)) {
 
-    /* setup the writev call */
-    for (i=0; i<SES_MAX_BUFFSEND && !done && buff; i++) {
-        buffleft = buff->bufflen - buff->buffpos;
-        if ((total+buffleft) > SES_MAX_BYTESEND) {
-            done = TRUE;
-        } else {
-            total += buffleft;
-            iovs[i].iov_base = &buff->buff[buff->buffpos];
-            iovs[i].iov_len = buffleft;
-            buff = (ses_msg_buff_t *)dlq_nextEntry(buff);
+        buffleft = prep_send_buff(scb, buff);
+        if (buffleft == 0) {
+            continue;
+        }
+
+        iovs[cnt].iov_base = &buff->buff[buff->buffpos];
+        iovs[cnt].iov_len = buffleft;
+        total += buffleft;
 
 #ifdef SES_MSG_FULL_TRACE
-            if (LOGDEBUG3) {
-                log_debug3("\nses_msg: setup send buff %d\n%s\n", 
-                           i,
-                           iovs[i].iov_base);
-            }
-#endif
-            cnt++;
+        if (LOGDEBUG3) {
+            log_debug3("\nses_msg: setup send buff %d (%u bytes)\n", 
+                       cnt,
+                       (uint32)buffleft);
         }
+#endif
+        cnt++;
     }
 
-    /* make sure there is at least one buffer set */
-    if (iovs[0].iov_base == NULL) {
-        return SET_ERROR(ERR_NCX_OPERATION_FAILED);
-    }
-
-    if (scb->framing11) {
-        /* send the 'cnt' number of buffs identified above
-         * do not use the iovs array because this function
-         * may not write the entire amount requested
-         * and that would not match the huge chunksize;
-         * so just send each buffer as a chunk
-         */
-        for (i=0; i < cnt; i++) {
-            buff = (ses_msg_buff_t *)dlq_deque(&scb->outQ);
-            if (buff == NULL) {
-                return SET_ERROR(ERR_INTERNAL_VAL);
-            }
-            res = do_send_buff(scb, buff);
-            ses_msg_free_buff(scb, buff);            
-            if (res != NO_ERR) {
-                return res;
+    retcnt = 0;
+    if (cnt > 0) {
+        /* write as much as the socket will take in 1 call */
+        retcnt = writev(scb->fd, iovs, cnt);
+        if (retcnt < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                /* try again next time the socket is writable */
+                return NO_ERR;
             }
+            log_info("\nses msg write failed for session %d", scb->sid);
+            return errno_to_status();
+        } else if (LOGDEBUG2) {
+            log_debug2("\nses wrote %d of %u bytes in %d buffs "
+                       "on session %d\n", 
+                       (int)retcnt, 
+                       (uint32)total, 
+                       cnt,
+                       scb->sid);
         }
-        return NO_ERR;
     }
 
-    /* else base:1.0 framing
-     * write a packet to the session socket 
-     */
-    retcnt = writev(scb->fd, iovs, cnt);
-    if (retcnt < 0) {
-        /* should not need retries because the select loop
-         * indicated this session was ready for output
-         */
-        log_info("\nses msg write failed for session %d", scb->sid);
-        return errno_to_status();
-    } else {
-        if (LOGDEBUG2) {
-            log_debug2("\nses wrote %d of %d bytes on session %d\n", 
-                       retcnt, 
-                       total, 
-                       scb->sid);
+    if (retcnt > 0) {
+        scb->outbytes -= min(scb->outbytes, (uint32)retcnt);
+        if (ses_msg_writer_suspended(scb)) {
+            /* the client is still reading the output */
+            (void)uptime(&scb->out_time);
         }
     }
 
-    /* clean up the buffers that were written */
+    /* clean up the buffers that were written; 
+     * a partially written buffer keeps its byte offset 
+     * in buffpos so the next call resumes from there
+     */
     buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
-
-    while (retcnt && buff) {
-        /* get the number of bytes written from this buffer */
-        buffleft = buff->bufflen - buff->buffpos;
-
-        /* free the buffer if all of it was written or just
-         * bump the buffer pointer if not
-         */
-        if ((uint32)retcnt >= buffleft) {
+    while (buff) {
+        buffleft = prep_send_buff(scb, buff);
+        if ((size_t)retcnt >= buffleft) {
             dlq_remove(buff);
             ses_msg_free_buff(scb, buff);
             retcnt -= (ssize_t)buffleft;
-            buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);            
+            buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
         } else {
-            buff->buffpos += (uint32)retcnt;
-            retcnt = 0;
+            buff->buffpos += (size_t)retcnt;
+            buff = NULL;
         }
     }
 
@@ -648,7 +1156,9 @@ status_t
 *
 * OUTPUTS:
 *   scb->outbuff, scb->outready, and scb->outQ will be changed
-*   !!! buffer will be sent if stream output mode, then buffer reused
+*   !!! sending is started now if stream output mode
+*   !!! the writer may be suspended if the outQ is full
+*   The new buffer is a bulk buffer if one is configured
 *   
 * RETURNS:
 *   status, could return malloc or buffers exceeded error
@@ -663,30 +1173,21 @@ status_t ses_msg_new_output_buff (ses_cb_t *scb)
     buff = scb->outbuff;
     buff->buffpos = 0;
 
-    if (scb->stream_output) {
-        /* send this buffer right now 
-         * this works because the agt_ncxserver loop and mgr_io
-         * loop are single threaded and a notification cannot
-         * be in the middle of being sent right now
-         * If that code is changed, then make sure a notification
-         * is not being streamed right now
-         */
-        if (buff->bufflen) {
-            res = do_send_buff(scb, buff);
-            ses_msg_init_buff(scb, TRUE, buff);
-        } else {
-            res = SET_ERROR(ERR_INTERNAL_VAL);
-        }
+    if (scb->state == SES_ST_SHUTDOWN) {
+        /* session is being dropped; throw the output away */
+        ses_msg_init_buff(scb, TRUE, buff);
+        return NO_ERR;
+    }
 
-        /* reuse the same outbuff again */
-    } else {
-        /* save the buffer in the message loop do be sent when
-         * the main loop checks if any output pending
-         */
-        dlq_enque(scb->outbuff, &scb->outQ);
-        ses_msg_make_outready(scb);
-        scb->outbuff = NULL;
-        res = ses_msg_new_buff(scb, TRUE, &scb->outbuff);
+    /* save the buffer in the outQ; a stream output session
+     * sends it right away, otherwise the main loop sends it
+     * when the socket is ready
+     */
+    queue_output_buff(scb, buff);
+    scb->outbuff = NULL;
+    res = flush_queued_output(scb);
+    if (res == NO_ERR) {
+        res = ses_msg_new_bulk_buff(scb, TRUE, &scb->outbuff);
     }
     return res;
 
@@ -720,7 +1221,7 @@ void ses_msg_unmake_inready (ses_cb_t *scb)
     assert( scb && "scb is NULL" );
 
     if (scb->inready.inq) {
-        dlq_deque(&scb->inready);
+        dlq_remove(&scb->inready);
         scb->inready.inq = FALSE;
     }
 
@@ -753,7 +1254,7 @@ void ses_msg_unmake_outready (ses_cb_t *scb)
     assert( scb && "scb is NULL" );
 
     if (scb->outready.inq) {
-        dlq_deque(&scb->outready);
+        dlq_remove(&scb->outready);
         scb->outready.inq = FALSE;
     }
 
@@ -764,6 +1265,7 @@ void ses_msg_unmake_outready (ses_cb_t *scb)
 *
 * Put the outbuff in the outQ if non-empty
 * Put the session on the outreadyQ if it is not already there
+* A stream output session sends the outbuff now, unless corked
 *
 * INPUTS:
 *   scb == session control block
@@ -776,28 +1278,110 @@ void ses_msg_finish_outmsg (ses_cb_t *scb)
     status_t   res;
 
     assert( scb && "scb is NULL" );
-    assert( scb->outbuff && "scb->outbuff is NULL" );
 
-    if (scb->stream_output) {
-        res = do_send_buff(scb, scb->outbuff);
-        ses_msg_init_buff(scb, TRUE, scb->outbuff);
+    if (scb->outbuff == NULL) {
+        /* nothing written since the last message */
+        return;
+    }
+
+    if (scb->state == SES_ST_SHUTDOWN) {
+        /* session is being dropped; throw the output away */
+        ses_msg_free_buff(scb, scb->outbuff);
+        scb->outbuff = NULL;
+        return;
+    }
+
+    scb->outbuff->buffpos = scb->outbuff->buffstart;
+    queue_output_buff(scb, scb->outbuff);
+    scb->outbuff = NULL;
+
+    /* a corked stream output session starts sending in
+     * ses_msg_uncork_output; anything the socket does not
+     * take right away is sent by the main loop
+     */
+    if (scb->stream_output && !scb->outcork) {
+        res = ses_msg_send_buffs(scb);
         if (res != NO_ERR) {
             log_error("\nError: IO failed on session '%d' (%s)", 
                       scb->sid,
                       get_error_string(res));
         }
-    } else {
-        scb->outbuff->buffpos = scb->outbuff->buffstart;
-        dlq_enque(scb->outbuff, &scb->outQ);
-        scb->outbuff = NULL;
-        (void)ses_msg_new_buff(scb, TRUE, &scb->outbuff);
-
+    }
+    if (!dlq_empty(&scb->outQ)) {
         ses_msg_make_outready(scb);
     }
 
 } /* ses_msg_finish_outmsg */
 
 
+/********************************************************************
+* FUNCTION ses_msg_cork_output
+*
+* Hold back the messages finished by a stream output session
+* in the outQ, so several replies can be sent in 1 write
+* Has no effect on a buffered output session, since its
+* output is always queued
+*
+* INPUTS:
+*   scb == session control block
+*
+* OUTPUTS:
+*   scb->outcork is set
+*********************************************************************/
+void
+    ses_msg_cork_output (ses_cb_t *scb)
+{
+    assert( scb && "scb is NULL" );
+
+    scb->outcork = TRUE;
+
+} /* ses_msg_cork_output */
+
+
+/********************************************************************
+* FUNCTION ses_msg_uncork_output
+*
+* Stop holding back finished messages for a session
+* A stream output session starts sending the messages held
+* back now, and the main loop sends whatever the socket
+* does not take; a buffered output session is left on the
+* outreadyQ
+*
+* INPUTS:
+*   scb == session control block
+*
+* OUTPUTS:
+*   scb->outcork is cleared
+*
+* RETURNS:
+*   status
+*********************************************************************/
+status_t
+    ses_msg_uncork_output (ses_cb_t *scb)
+{
+    status_t  res;
+
+    assert( scb && "scb is NULL" );
+
+    res = NO_ERR;
+    if (scb->outcork) {
+        scb->outcork = FALSE;
+        if (scb->stream_output && !dlq_empty(&scb->outQ)) {
+            res = ses_msg_send_buffs(scb);
+            if (res != NO_ERR) {
+                log_error("\nError: IO failed on session '%d' (%s)", 
+                          scb->sid,
+                          get_error_string(res));
+            } else if (!dlq_empty(&scb->outQ)) {
+                ses_msg_make_outready(scb);
+            }
+        }
+    }
+    return res;
+
+} /* ses_msg_uncork_output */
+
+
 /********************************************************************
 * FUNCTION ses_msg_get_first_inready
 *
@@ -902,28 +1486,37 @@ void ses_msg_add_framing( ses_cb_t *scb, ses_msg_buff_t *buff )
     assert( scb && "scb == NULL" );
     assert( buff && "buff == NULL" );
 
-    if (!scb->framing11) {
+    if (!scb->framing11 || buff->framed) {
         return;
     }
+    buff->framed = TRUE;
 
     /* get the chunk size */
     char numbuff[SES_MAX_CHUNKNUM_SIZE];
     size_t buffsize = buff->bufflen - SES_STARTCHUNK_PAD;
-    int32 numlen = snprintf(numbuff, sizeof(numbuff), "%zu", buffsize);
 
-    /* figure out where to put the start chunks within
-     * the beginning pad area; total size is numlen+3
-     *     \n#numlen\n
-     */
-    buff->buffstart = SES_STARTCHUNK_PAD - (numlen + 3);
+    if (buffsize == 0) {
+        /* a zero-length chunk is not allowed; 
+         * only the end-of-chunks marker (if any) is sent
+         */
+        buff->buffstart = SES_STARTCHUNK_PAD;
+    } else {
+        int32 numlen = snprintf(numbuff, sizeof(numbuff), "%zu", buffsize);
+
+        /* figure out where to put the start chunks within
+         * the beginning pad area; total size is numlen+3
+         *     \n#numlen\n
+         */
+        buff->buffstart = SES_STARTCHUNK_PAD - (numlen + 3);
 
-    char *p = (char *)&buff->buff[buff->buffstart];
+        char *p = (char *)&buff->buff[buff->buffstart];
 
-    *p++ = '\n';
-    *p++ = '#';
-    memcpy(p, numbuff, numlen);
-    p += numlen;
-    *p = '\n';
+        *p++ = '\n';
+        *p++ = '#';
+        memcpy(p, numbuff, numlen);
+        p += numlen;
+        *p = '\n';
+    }
 
     if (buff->islast) {
         memcpy(&buff->buff[buff->bufflen], 
@@ -955,6 +1548,7 @@ void
 
     buff->buffpos = 0;
     buff->islast = FALSE;
+    buff->framed = FALSE;
     if (outbuff && scb->framing11) {
         buff->buffstart = SES_STARTCHUNK_PAD;
     } else {
@@ -967,4 +1561,245 @@ void
 }  /* ses_msg_init_buff */
 
 
+/********************************************************************
+* FUNCTION ses_msg_set_buffsize
+*
+* Set the buffer chunk sizes used for all sessions
+* Cached free buffers of the old size are released
+*
+* INPUTS:
+*   buffsize == size of the first buffer in each message
+*   bulksize == size of the 2nd - Nth buffer in a large message
+*               0 to use 'buffsize' for all buffers
+*********************************************************************/
+void
+    ses_msg_set_buffsize (uint32 buffsize,
+                          uint32 bulksize)
+{
+    buffsize = min(max(buffsize, SES_MSG_MIN_BUFFSIZE), 
+                   SES_MSG_MAX_BUFFSIZE);
+    pool_setup(&pools[SES_POOL_BUFF], 
+               (uint32)(sizeof(ses_msg_buff_t) + buffsize));
+
+    if (bulksize > buffsize) {
+        bulksize = min(bulksize, SES_MSG_MAX_BUFFSIZE);
+        pool_setup(&pools[SES_POOL_BULK], 
+                   (uint32)(sizeof(ses_msg_buff_t) + bulksize));
+    } else {
+        /* bulk buffers disabled */
+        pool_setup(&pools[SES_POOL_BULK], 0);
+    }
+
+}  /* ses_msg_set_buffsize */
+
+
+/********************************************************************
+* FUNCTION ses_msg_set_max_buffers
+*
+* Set the max number of buffer chunks 1 session 
+* can have allocated at once
+*
+* INPUTS:
+*   maxbuffs == max number of buffers per session
+*********************************************************************/
+void
+    ses_msg_set_max_buffers (uint32 maxbuffs)
+{
+    max_buffers = maxbuffs;
+
+}  /* ses_msg_set_max_buffers */
+
+
+/********************************************************************
+* FUNCTION ses_msg_run_writer
+*
+* Generate a reply for a session with a writer function
+* that can be suspended if the outQ gets too full
+*
+* The function runs on a separate stack.  If it queues
+* --max-queued-output bytes or more, control comes back
+* here with ERR_NCX_SUSPENDED, and the event loop has to
+* call ses_msg_resume_writer as the outQ is sent.
+* The session must not be freed until the writer is done.
+* The writer function should only generate output; any
+* other work for the message is done by the caller when
+* the writer is done
+*
+* Only 1 writer is used at a time.  If another writer is
+* still suspended, or no writer stack can be used, or
+* this is a dummy session, the function is just called
+* and runs to the end
+*
+* INPUTS:
+*   scb == session control block
+*   fn == writer function to run for this session
+*   cookie == parameter to pass to the writer function
+*
+* RETURNS:
+*   NO_ERR if the writer function returned
+*   ERR_NCX_SUSPENDED if the writer is suspended
+*********************************************************************/
+status_t
+    ses_msg_run_writer (ses_cb_t *scb,
+                        ses_writer_fn_t fn,
+                        void *cookie)
+{
+#ifdef SES_MSG_WRITER_STACK
+    ses_writer_t  *writer;
+    status_t       res;
+#endif
+
+    assert( scb && "scb is NULL" );
+    assert( fn && "fn is NULL" );
+
+#ifdef SES_MSG_WRITER_STACK
+    writer = NULL;
+    if (max_queued_output && activewriter == NULL &&
+        scb->type != SES_TYP_DUMMY) {
+        writer = new_writer();
+    }
+
+    if (writer && init_writer_context(writer) == NO_ERR) {
+        writer->scb = scb;
+        writer->fn = fn;
+        writer->cookie = cookie;
+        writer->done = FALSE;
+        scb->writer = writer;
+        activewriter = writer;
+
+        res = switch_to_writer(writer);
+        if (res == NO_ERR || res == ERR_NCX_SUSPENDED) {
+            return res;
+        }
+        /* the writer never ran */
+        scb->writer = NULL;
+        activewriter = NULL;
+    }
+
+    if (writer) {
+        free_writer(writer);
+    }
+#endif
+
+    (*fn)(scb, cookie);
+    return NO_ERR;
+
+}  /* ses_msg_run_writer */
+
+
+/********************************************************************
+* FUNCTION ses_msg_resume_writer
+*
+* Continue a suspended writer, once its outQ has been sent
+* down to half of --max-queued-output
+*
+* A session that is being dropped (SES_ST_SHUTDOWN) has
+* its writer resumed right away; the rest of its output
+* is thrown away, so the writer will not suspend again
+*
+* INPUTS:
+*   scb == session control block
+*
+* RETURNS:
+*   NO_ERR if the writer is done or was not suspended
+*   ERR_NCX_SUSPENDED if the writer is still suspended
+*********************************************************************/
+status_t
+    ses_msg_resume_writer (ses_cb_t *scb)
+{
+    assert( scb && "scb is NULL" );
+
+    if (!ses_msg_writer_suspended(scb)) {
+        return NO_ERR;
+    }
+
+#ifdef SES_MSG_WRITER_STACK
+    if (curwriter != NULL ||
+        (scb->state != SES_ST_SHUTDOWN &&
+         scb->outbytes > max_queued_output / 2)) {
+        return ERR_NCX_SUSPENDED;
+    }
+
+    if (LOGDEBUG3) {
+        log_debug3("\nses_msg: resume writer on session %d", scb->sid);
+    }
+
+    return switch_to_writer(scb->writer);
+#else
+    return NO_ERR;
+#endif
+
+}  /* ses_msg_resume_writer */
+
+
+/********************************************************************
+* FUNCTION ses_msg_writer_suspended
+*
+* Check if the writer for a session is suspended
+*
+* INPUTS:
+*   scb == session control block
+*
+* RETURNS:
+*   TRUE if ses_msg_resume_writer has to be called;
+*   FALSE otherwise
+*********************************************************************/
+boolean
+    ses_msg_writer_suspended (const ses_cb_t *scb)
+{
+    assert( scb && "scb is NULL" );
+
+#ifdef SES_MSG_WRITER_STACK
+    return (scb->writer && scb->writer->suspended) ? TRUE : FALSE;
+#else
+    (void)scb;
+    return FALSE;
+#endif
+
+}  /* ses_msg_writer_suspended */
+
+
+/********************************************************************
+* FUNCTION ses_msg_set_max_queued_output
+*
+* Set the max number of output bytes 1 session can have
+* queued while a message is being generated
+* Only used for sessions that are not in stream output mode
+*
+* INPUTS:
+*   maxbytes == max queued output bytes per session; 0 for no limit
+*********************************************************************/
+void
+    ses_msg_set_max_queued_output (uint32 maxbytes)
+{
+    max_queued_output = maxbytes;
+
+}  /* ses_msg_set_max_queued_output */
+
+
+/********************************************************************
+* FUNCTION ses_msg_get_pool_stats
+*
+* Get a snapshot of the shared pool statistics
+*
+* INPUTS:
+*   poolstats == array of SES_NUM_POOLS entries to fill in
+*
+* OUTPUTS:
+*   poolstats[] filled in, indexed by ses_pool_id_t
+*********************************************************************/
+void
+    ses_msg_get_pool_stats (ses_pool_stats_t *poolstats)
+{
+    ses_pool_id_t  id;
+
+    assert( poolstats && "poolstats == NULL" );
+
+    for (id = SES_POOL_MSG; id < SES_NUM_POOLS; id++) {
+        poolstats[id] = pools[id].stats;
+    }
+
+}  /* ses_msg_get_pool_stats */
+
+
 /* END file ses_msg.c */
@@ -59,6 +59,12 @@ extern "C" {
 *                                                                   *
 *********************************************************************/
 
+/* function that generates a reply for a session,
+ * run by ses_msg_run_writer
+ */
+typedef void (*ses_writer_fn_t) (ses_cb_t *scb,
+                                 void *cookie);
+
 
 /********************************************************************
 *                                                                   *
@@ -132,7 +138,9 @@ extern void
 /********************************************************************
 * FUNCTION ses_msg_new_buff
 *
-* Malloc a new session buffer chuck
+* Get a new session buffer chuck from the shared pool
+* This is the normal size buffer used for the first
+* buffer in a message
 *
 * Note that the buffer memory is not cleared after each use
 * since this is not needed for byte stream IO
@@ -155,6 +163,32 @@ extern status_t
                       ses_msg_buff_t **buff);
 
 
+/********************************************************************
+* FUNCTION ses_msg_new_bulk_buff
+*
+* Get a new bulk session buffer chuck from the shared pool
+* This is used for the 2nd - Nth buffers of a large message
+* If no bulk buffer size is configured then a normal size 
+* buffer is used instead
+*
+* INPUTS:
+*   scb == session control block to malloc a new message for
+*   outbuff == TRUE if this is for outgoing message
+*              FALSE if this is for incoming message
+*   buff == address of ses_msg_buff_t pointer that will be set
+*
+* OUTPUTS:
+*   *buff == malloced session buffer chunk (if NO_ERR return)
+*
+* RETURNS:
+*   status
+*********************************************************************/
+extern status_t
+    ses_msg_new_bulk_buff (ses_cb_t *scb, 
+                           boolean outbuff,
+                           ses_msg_buff_t **buff);
+
+
 /********************************************************************
 * FUNCTION ses_msg_free_buff
 *
@@ -192,11 +226,36 @@ extern status_t
                         uint32 ch);
 
 
+/********************************************************************
+* FUNCTION ses_msg_write_nbuff
+*
+* Add a run of text to the message buffer
+* Copies as many bytes as will fit in the buffer
+*
+* INPUTS:
+*   scb == session control block to use
+*   buff == buffer to write to
+*   str == text to write
+*   len == number of bytes in str to write
+*
+* RETURNS:
+*   number of bytes copied into the buffer;
+*   less than len if the buffer is full
+*********************************************************************/
+extern uint32
+    ses_msg_write_nbuff (ses_cb_t *scb,
+                         ses_msg_buff_t *buff,
+                         const xmlChar *str,
+                         uint32 len);
+
+
 /********************************************************************
 * FUNCTION ses_msg_send_buffs
 *
 * Send multiple buffers to the session client socket
-* Tries to send one packet at maximum MTU
+* Gathers the queued buffers (and base:1.1 chunk headers)
+* into one writev call; a partial write is resumed at the
+* same byte offset on the next call
 *
 * INPUTS:
 *   scb == session control block
@@ -268,6 +327,7 @@ extern void
 *
 * Put the outbuff in the outQ if non-empty
 * Put the session on the outreadyQ if it is not already there
+* A stream output session sends the outbuff now, unless corked
 *
 * INPUTS:
 *   scb == session control block
@@ -279,6 +339,44 @@ extern void
     ses_msg_finish_outmsg (ses_cb_t *scb);
 
 
+/********************************************************************
+* FUNCTION ses_msg_cork_output
+*
+* Hold back the messages finished by a stream output session
+* in the outQ, so several replies can be sent in 1 write
+* Has no effect on a buffered output session, since its
+* output is always queued
+*
+* INPUTS:
+*   scb == session control block
+*
+* OUTPUTS:
+*   scb->outcork is set
+*********************************************************************/
+extern void
+    ses_msg_cork_output (ses_cb_t *scb);
+
+
+/********************************************************************
+* FUNCTION ses_msg_uncork_output
+*
+* Stop holding back finished messages for a session
+* Any messages held back by a stream output session are
+* sent now; a buffered output session is left on the outreadyQ
+*
+* INPUTS:
+*   scb == session control block
+*
+* OUTPUTS:
+*   scb->outcork is cleared
+*
+* RETURNS:
+*   status
+*********************************************************************/
+extern status_t
+    ses_msg_uncork_output (ses_cb_t *scb);
+
+
 /********************************************************************
 * FUNCTION ses_msg_get_first_inready
 *
@@ -353,6 +451,136 @@ extern void
                        ses_msg_buff_t *buff);
 
 
+/********************************************************************
+* FUNCTION ses_msg_set_buffsize
+*
+* Set the buffer chunk sizes used for all sessions
+* Cached free buffers of the old size are released
+*
+* INPUTS:
+*   buffsize == size of the first buffer in each message
+*   bulksize == size of the 2nd - Nth buffer in a large message
+*               0 to use 'buffsize' for all buffers
+*********************************************************************/
+extern void
+    ses_msg_set_buffsize (uint32 buffsize,
+                          uint32 bulksize);
+
+
+/********************************************************************
+* FUNCTION ses_msg_set_max_buffers
+*
+* Set the max number of buffer chunks 1 session 
+* can have allocated at once
+*
+* INPUTS:
+*   maxbuffs == max number of buffers per session
+*********************************************************************/
+extern void
+    ses_msg_set_max_buffers (uint32 maxbuffs);
+
+
+/********************************************************************
+* FUNCTION ses_msg_run_writer
+*
+* Generate a reply for a session with a writer function
+* that can be suspended if the outQ gets too full
+*
+* The function runs on a separate stack.  If it queues
+* --max-queued-output bytes or more, control comes back
+* here with ERR_NCX_SUSPENDED, and the event loop has to
+* call ses_msg_resume_writer as the outQ is sent.
+* The session must not be freed until the writer is done.
+* The writer function should only generate output; any
+* other work for the message is done by the caller when
+* the writer is done
+*
+* Only 1 writer is used at a time.  If another writer is
+* still suspended, or no writer stack can be used, or
+* this is a dummy session, the function is just called
+* and runs to the end
+*
+* INPUTS:
+*   scb == session control block
+*   fn == writer function to run for this session
+*   cookie == parameter to pass to the writer function
+*
+* RETURNS:
+*   NO_ERR if the writer function returned
+*   ERR_NCX_SUSPENDED if the writer is suspended
+*********************************************************************/
+extern status_t
+    ses_msg_run_writer (ses_cb_t *scb,
+                        ses_writer_fn_t fn,
+                        void *cookie);
+
+
+/********************************************************************
+* FUNCTION ses_msg_resume_writer
+*
+* Continue a suspended writer, once its outQ has been sent
+* down to half of --max-queued-output
+*
+* A session that is being dropped (SES_ST_SHUTDOWN) has
+* its writer resumed right away; the rest of its output
+* is thrown away, so the writer will not suspend again
+*
+* INPUTS:
+*   scb == session control block
+*
+* RETURNS:
+*   NO_ERR if the writer is done or was not suspended
+*   ERR_NCX_SUSPENDED if the writer is still suspended
+*********************************************************************/
+extern status_t
+    ses_msg_resume_writer (ses_cb_t *scb);
+
+
+/********************************************************************
+* FUNCTION ses_msg_writer_suspended
+*
+* Check if the writer for a session is suspended
+*
+* INPUTS:
+*   scb == session control block
+*
+* RETURNS:
+*   TRUE if ses_msg_resume_writer has to be called;
+*   FALSE otherwise
+*********************************************************************/
+extern boolean
+    ses_msg_writer_suspended (const ses_cb_t *scb);
+
+
+/********************************************************************
+* FUNCTION ses_msg_set_max_queued_output
+*
+* Set the max number of output bytes 1 session can have
+* queued while a message is being generated
+* Only used for sessions that are not in stream output mode
+*
+* INPUTS:
+*   maxbytes == max queued output bytes per session; 0 for no limit
+*********************************************************************/
+extern void
+    ses_msg_set_max_queued_output (uint32 maxbytes);
+
+
+/********************************************************************
+* FUNCTION ses_msg_get_pool_stats
+*
+* Get a snapshot of the shared pool statistics
+*
+* INPUTS:
+*   poolstats == array of SES_NUM_POOLS entries to fill in
+*
+* OUTPUTS:
+*   poolstats[] filled in, indexed by ses_pool_id_t
+*********************************************************************/
+extern void
+    ses_msg_get_pool_stats (ses_pool_stats_t *poolstats);
+
+
 #ifdef __cplusplus
 }  /* end extern 'C' */
 #endif
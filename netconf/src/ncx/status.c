@@ -788,6 +788,8 @@ const char *
         return "operation skipped"; 
     case ERR_NCX_CANCELED:
         return "operation canceled"; 
+    case ERR_NCX_SUSPENDED:
+        return "operation suspended"; 
 
     default:
         return "--";
@@ -392,7 +392,8 @@ typedef enum status_t_
     ERR_NCX_LOOP_ENDED,                 /* 903 */
     ERR_NCX_FOUND_INLINE,               /* 904 */
     ERR_NCX_FOUND_URL,                  /* 905 */
-    ERR_LAST_INFO                       /* 906 -- not really used */
+    ERR_NCX_SUSPENDED,                  /* 906 */
+    ERR_LAST_INFO                       /* 907 -- not really used */
 
 } status_t;
 
@@ -1,5 +1,6 @@
 #include <time.h>
 #include <assert.h>
+#include "uptime.h"
 
 time_t uptime(time_t *t)
 {
@@ -12,6 +13,17 @@ time_t uptime(time_t *t)
 }
 
 
+unsigned long long uptime_usec(void)
+{
+    int ret;
+    struct timespec tp;
+    ret = clock_gettime(CLOCK_MONOTONIC, &tp);
+    assert(ret==0);
+    return (unsigned long long)tp.tv_sec * 1000000ULL +
+        (unsigned long long)(tp.tv_nsec / 1000);
+}
+
+
 time_t reset_time(time_t *t)
 {
     int ret;
@@ -1,4 +1,5 @@
 #include <time.h>
 
 time_t uptime(time_t *t);
+unsigned long long uptime_usec(void);
 time_t reset_time(time_t *t);
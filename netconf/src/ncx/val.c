@@ -28,6 +28,9 @@ date         init     comment
 19dec05      abb      begun
 21jul08      abb      start obj-based rewrite
 28dec11      abb      add editvars only if XML attrs present
+16oct26      agt      add hashed child index for large childQs
+16oct26      agt      add key tree for list entries in the child index
+16oct26      agt      allow value nodes to come from an arena
 
 *********************************************************************
 *                                                                   *
@@ -50,6 +53,7 @@ date         init     comment
 #include "json_wr.h"
 #include "log.h"
 #include "ncx.h"
+#include "ncx_arena.h"
 #include "ncx_list.h"
 #include "ncx_num.h"
 #include "ncx_str.h"
@@ -79,6 +83,16 @@ date         init     comment
 /* #define VAL_EDITVARS_DEBUG */
 /* #define VAL_FREE_DEBUG 1 */
 
+/* initial number of hash buckets in a child index */
+#define VAL_CHINDEX_BUCKETS  64
+
+/* child index of a complex node, or NULL if none */
+#define VAL_CHINDEX(V) ((V)->extra ? (V)->extra->chindex : NULL)
+
+/* 64-bit FNV-1a parameters used for the subtree digests */
+#define VAL_DIGEST_SEED   0xcbf29ce484222325ULL
+#define VAL_DIGEST_PRIME  0x00000100000001b3ULL
+
 /********************************************************************
 *                                                                   *
 *                          T Y P E S                                *
@@ -92,12 +106,98 @@ typedef struct finderparms_t_ {
     int64         foundpos;
 } finderparms_t;
 
+/* one list entry in the key tree of a child index record */
+typedef struct val_keynode_t_ {
+    struct val_keynode_t_ *left;
+    struct val_keynode_t_ *right;
+    struct val_keynode_t_ *up;
+    val_value_t           *val;                  /* list entry */
+    int32                  height;                /* AVL height */
+} val_keynode_t;
+
+/* one QName entry in the child index of a complex node;
+ * the child name is taken from the first instance
+ */
+typedef struct val_chrec_t_ {
+    struct val_chrec_t_ *next;                    /* hash chain */
+    val_value_t         *first;   /* first instance in the childQ */
+    uint32               hash;               /* hash of the name */
+    uint32               count;     /* number of instances in Q */
+    xmlns_id_t           nsid;                 /* child namespace */
+
+    /* list entries: AVL tree of all the instances ordered
+     * by val_index_compare, with equal keys in childQ order;
+     * built on demand and dropped if an entry cannot be keyed
+     * leaf-list entries: same, ordered by value, but only
+     * during a sibling set pass, and freed with the sibling set
+     */
+    val_keynode_t       *keyroot;
+    boolean              keysorted;  /* instances contiguous and
+                                      * in key order in childQ */
+    boolean              keyfail;      /* do not rebuild keyroot */
+
+    /* transient sibling set, see val_begin_sibset_pass */
+    struct val_sibset_t_ *sibset;
+} val_chrec_t;
+
+/* one leaf-list instance in the value hash of a sibling set */
+typedef struct val_sibnode_t_ {
+    struct val_sibnode_t_ *next;                    /* hash chain */
+    val_value_t           *val;
+    uint64                 hash;          /* digest_simval of val */
+} val_sibnode_t;
+
+/* lookup set for all the instances of one child index record;
+ * only built while a sibling set pass is active and freed
+ * when the pass ends
+ */
+typedef struct val_sibset_t_ {
+    dlq_hdr_t        qhdr;                      /* in sibsetQ */
+    val_chrec_t     *rec;                         /* back-ptr */
+    val_value_t     *last;        /* last instance in the childQ */
+    boolean          contig;  /* instances contiguous in childQ */
+    boolean          leaflist;       /* instances are leaf-lists */
+
+    /* leaf-list values only; NULL if an instance cannot be
+     * hashed, so the instances are searched in order instead
+     */
+    val_sibnode_t  **buckets;
+    uint32           numbuckets;           /* always a power of 2 */
+    uint32           numnodes;
+    ncx_btype_t      btyp;                /* btyp of every instance */
+} val_sibset_t;
+
+/* hashed child index for val->v.childQ */
+typedef struct val_chindex_t_ {
+    val_chrec_t  **buckets;
+    uint32         numbuckets;              /* always a power of 2 */
+    uint32         numrecs;
+} val_chindex_t;
+
+/* namespace matching used by a child index search */
+typedef enum chindex_nsmode_t_ {
+    CHINDEX_NS_ANY,                          /* any namespace */
+    CHINDEX_NS_EXACT,                /* nsid must be the same */
+    CHINDEX_NS_EQUAL,             /* xmlns_ids_equal semantics */
+    CHINDEX_NS_MODNAME               /* module name must match */
+} chindex_nsmode_t;
+
 /* pick a log output function for dump_value */
 typedef void (*dumpfn_t) (const char *fstr, ...);
 
 /* pick a log indent function for dump_value */
 typedef void (*indentfn_t) (int32 indentcnt);
 
+/* sibling sets are only built while a pass is active;
+ * see val_begin_sibset_pass
+ */
+static uint32 sibset_passcnt = 0;
+
+/* Q of val_sibset_t built during the current pass */
+static dlq_hdr_t sibsetQ;
+
+static boolean sibsetQ_init = FALSE;
+
 #ifdef VAL_EDITVARS_DEBUG
 static uint32 editvars_malloc = 0;
 static uint32 editvars_free = 0;
@@ -453,6 +553,70 @@ static void
 }  /* free_editvars */
 
 
+/********************************************************************
+* FUNCTION free_extra
+* 
+* Free the block of rarely used fields in a value node
+* The virtualval, xpathpcb and chindex fields
+* must already be cleared
+*
+* INPUTS:
+*    val == val_value_t data structure to use
+*********************************************************************/
+static void 
+    free_extra (val_value_t *val)
+{
+    val_extra_t   *extra = val->extra;
+    val_value_t   *cur;
+
+    if (extra->dname) {
+        m__free(extra->dname);
+    }
+    while (!dlq_empty(&extra->metaQ)) {
+        cur = (val_value_t *)dlq_deque(&extra->metaQ);
+        val_free_value(cur);
+    }
+    m__free(extra);
+    val->extra = NULL;
+
+}  /* free_extra */
+
+
+/********************************************************************
+* FUNCTION set_dname
+* 
+* Replace the malloced name of a value node
+*
+* INPUTS:
+*    val == val_value_t data structure to change
+*    name == name string to set
+*    namelen == length of name string
+*********************************************************************/
+static void 
+    set_dname (val_value_t *val,
+               const xmlChar *name,
+               uint32 namelen)
+{
+    val_extra_t   *extra;
+
+    extra = val_get_extra(val);
+    if (!extra) {
+        SET_ERROR(ERR_INTERNAL_MEM);
+        return;
+    }
+
+    if (extra->dname) {
+        m__free(extra->dname);
+    }
+    extra->dname = xml_strndup(name, namelen);
+    if (!extra->dname) {
+        SET_ERROR(ERR_INTERNAL_MEM);
+    } 
+    val->name = extra->dname;
+
+}  /* set_dname */
+
+
 /********************************************************************
 * FUNCTION clean_value
 * 
@@ -474,10 +638,10 @@ static void
     val_index_t   *in;
     ncx_btype_t    btyp;
 
-    if (full && val->virtualval) {
+    if (full && val->extra && val->extra->virtualval) {
         /* check if any cached entry of self needs to be cleared */
-        val_free_value(val->virtualval);
-        val->virtualval = NULL;
+        val_free_value(val->extra->virtualval);
+        val->extra->virtualval = NULL;
     }
 
     btyp = val->btyp;
@@ -486,6 +650,10 @@ static void
         free_editvars(val);
     }
 
+    if (VAL_CHINDEX(val)) {
+        val_clear_child_index(val);
+    }
+
     /* clean the val->v union, depending on base type */
     switch (btyp) {
     case NCX_BT_INT8:
@@ -553,15 +721,7 @@ static void
     }
 
     if (full) {
-        if (val->dname) {
-            m__free(val->dname);
-            val->dname = NULL;
-        }
         val->nsid = 0;
-        while (!dlq_empty(&val->metaQ)) {
-            cur = (val_value_t *)dlq_deque(&val->metaQ);
-            val_free_value(cur);
-        }
     }
 
     while (!dlq_empty(&val->indexQ)) {
@@ -569,9 +729,14 @@ static void
         m__free(in);
     }
 
-    if (val->xpathpcb) {
-        xpath_free_pcb(val->xpathpcb);
-        val->xpathpcb = NULL;
+    if (val->extra) {
+        if (val->extra->xpathpcb) {
+            xpath_free_pcb(val->extra->xpathpcb);
+            val->extra->xpathpcb = NULL;
+        }
+        if (full) {
+            free_extra(val);
+        }
     }
 
 }  /* clean_value */
@@ -811,16 +976,11 @@ static void
         val->name = obj_get_name(obj);
     }
 
-    /* set the case object field if this is a node from a
-     * choice.  This will be used to validate and manipulate
-     * the choice that is not actually taking up a node
-     * in the value tree
+    /* the case object of a node from a choice is taken from
+     * the object template by val_get_casobj
      */
     val->dataclass = obj_get_config_flag(obj) ?
         NCX_DC_CONFIG : NCX_DC_STATE;
-    if (obj->parent && obj->parent->objtype==OBJ_TYP_CASE) {
-        val->casobj = obj->parent;
-    }
     if (!typ_is_simple(val->btyp)) {
         val_init_complex(val, btyp);
     } else if (val->btyp == NCX_BT_SLIST) {
@@ -1067,7 +1227,8 @@ static void
     realval->nsid = virval->nsid;
     realval->obj = virval->obj;
     realval->typdef = virval->typdef;
-    realval->flags = virval->flags;
+    realval->flags = (virval->flags & ~VAL_FL_ARENA) |
+        (realval->flags & VAL_FL_ARENA);
     realval->btyp = virval->btyp;
     realval->dataclass = virval->dataclass;
     realval->parent = virval->parent;
@@ -1193,19 +1354,21 @@ static val_value_t *
     time_t       timediff, timerval;
     uint32       deftimeout;
     boolean      disable_cache;
+    val_extra_t *extra;
 
-    if (!val->getcb) {
+    if (!VAL_GETCB(val)) {
         *res = ERR_NCX_OPERATION_FAILED;
         return NULL;
     }
 
-    getcb = (getcb_fn_t)val->getcb;
+    extra = val->extra;
+    getcb = (getcb_fn_t)extra->getcb;
 
-    if (val->virtualval != NULL) {
+    if (extra->virtualval != NULL) {
         log_debug4("\n Debug : virtual_val is not null");
         /* already have a value; check if it is fresh enough */
         (void)uptime(&timenow);
-        timediff = difftime(timenow, val->cachetime);
+        timediff = difftime(timenow, extra->cachetime);
 
         disable_cache = FALSE;
         if (scb != NULL) {
@@ -1227,10 +1390,10 @@ static val_value_t *
                 log_debug4("\nval: refresh virtual val %s",
                            val->name);
             }
-            val_free_value(val->virtualval);
-            val->virtualval = NULL;
+            val_free_value(extra->virtualval);
+            extra->virtualval = NULL;
         } else {
-            return val->virtualval;
+            return extra->virtualval;
         }
     }
 
@@ -1241,7 +1404,7 @@ static val_value_t *
         return NULL;
     }
     setup_virtual_retval(val, retval);
-    (void)uptime(&val->cachetime);
+    (void)uptime(&extra->cachetime);
 
     log_info("\n Debug : call getcb ... ");
     *res = (*getcb)(NULL, GETCB_GET_VALUE, val, retval);
@@ -1250,8 +1413,8 @@ static val_value_t *
         retval = NULL;
     } else {
         log_info("\n Debug : set virtual_val ... ");
-        val->virtualval = retval;
-        val->virtualval->parent = val->parent;
+        extra->virtualval = retval;
+        extra->virtualval->parent = val->parent;
     }
     return retval;
 
@@ -1286,6 +1449,7 @@ static val_value_t *
 {
     const val_value_t *ch, *use_val, *v_val;
     val_value_t       *copy, *copych;
+    val_extra_t       *extra;
     boolean            testres;
     uint32             i;
 
@@ -1320,23 +1484,33 @@ static val_value_t *
     copy->obj = val->obj;
     copy->typdef = val->typdef;
 
-    if (val->dname) {
-        copy->dname = xml_strdup(val->dname);
-        if (!copy->dname) {
+    extra = NULL;
+    if (val->extra) {
+        extra = val_get_extra(copy);
+        if (!extra) {
+            *res = ERR_INTERNAL_MEM;
+            val_free_value(copy);
+            return NULL;
+        }
+    }
+
+    if (VAL_DNAME(val)) {
+        extra->dname = xml_strdup(val->extra->dname);
+        if (!extra->dname) {
             *res = ERR_INTERNAL_MEM;
             val_free_value(copy);
             return NULL;
         }
-        copy->name = copy->dname;
+        copy->name = extra->dname;
     } else {
-        copy->dname = NULL;
         copy->name = val->name;
     }
 
     copy->parent = val->parent;
     copy->nsid = val->nsid;
     copy->btyp = val->btyp;
-    copy->flags = val->flags;
+    copy->flags = (val->flags & ~VAL_FL_ARENA) |
+        (copy->flags & VAL_FL_ARENA);
     copy->dataclass = val->dataclass;
 
     /* copy any active partial locks;
@@ -1344,24 +1518,26 @@ static val_value_t *
      * vals, but in case a copy of running is made, this
      * array of partial locks needs to be transferred
      */
-    for (i=0; i<VAL_MAX_PLOCKS; i++) {
-        copy->plock[i] = val->plock[i];
-    }
+    if (extra) {
+        for (i=0; i<VAL_MAX_PLOCKS; i++) {
+            extra->plock[i] = val->extra->plock[i];
+        }
 
-    /* copy meta-data */
-    for (ch = (const val_value_t *)dlq_firstEntry(&val->metaQ);
-         ch != NULL;
-         ch = (const val_value_t *)dlq_nextEntry(ch)) {
-        copych = clone_test(ch, testfn, with_editvars, res);
-        if (!copych) {
-            if (*res == ERR_NCX_SKIPPED) {
-                *res = NO_ERR;
+        /* copy meta-data */
+        for (ch = (const val_value_t *)dlq_firstEntry(&val->extra->metaQ);
+             ch != NULL;
+             ch = (const val_value_t *)dlq_nextEntry(ch)) {
+            copych = clone_test(ch, testfn, with_editvars, res);
+            if (!copych) {
+                if (*res == ERR_NCX_SKIPPED) {
+                    *res = NO_ERR;
+                } else {
+                    val_free_value(copy);
+                    return NULL;
+                }
             } else {
-                val_free_value(copy);
-                return NULL;
+                dlq_enque(copych, &extra->metaQ);
             }
-        } else {
-            dlq_enque(copych, &copy->metaQ);
         }
     }
 
@@ -1375,12 +1551,14 @@ static val_value_t *
     }
 
     copy->res = val->res;
-    copy->getcb = val->getcb;
+    if (extra) {
+        extra->getcb = val->extra->getcb;
+    }
 
     /* clone the XPath control block if there is one */
-    if (val->xpathpcb) {
-        copy->xpathpcb = xpath_clone_pcb(val->xpathpcb);
-        if (copy->xpathpcb == NULL) {
+    if (VAL_XPATHPCB(val)) {
+        extra->xpathpcb = xpath_clone_pcb(val->extra->xpathpcb);
+        if (extra->xpathpcb == NULL) {
             *res = ERR_INTERNAL_MEM;
             val_free_value(copy);
             return NULL;
@@ -1390,8 +1568,6 @@ static val_value_t *
     /* DO NOT COPY copy->index = val->index; */
     /* set copy->indexQ after cloning child nodes is done */
 
-    copy->casobj = val->casobj;
-
     /* assume OK return for now */
     *res = NO_ERR;
     /*Fix issue get/commit in cadidate mode*/
@@ -1516,47 +1692,2162 @@ static val_value_t *
         *res = SET_ERROR(ERR_INTERNAL_VAL);
     }
 
-    /* reconstruct index records if needed */
-    if (*res==NO_ERR && !dlq_empty(&val->indexQ)) {
-        *res = val_gen_index_chain(val->obj, copy);
+    /* reconstruct index records if needed */
+    if (*res==NO_ERR && !dlq_empty(&val->indexQ)) {
+        *res = val_gen_index_chain(val->obj, copy);
+    }
+
+    if (*res != NO_ERR) {
+        val_free_value(copy);
+        copy = NULL;
+    }
+
+    return copy;
+
+}  /* clone_test */
+
+
+/********************************************************************
+* FUNCTION copy_editops
+* 
+* Copy the edit operation of each node in a subtree to its clone
+* clone_test only copies it along with the editvars, and most
+* nodes in an edit do not have any
+*
+* INPUTS:
+*    val == value that was cloned
+*    copy == clone_test result for val
+*********************************************************************/
+static void
+    copy_editops (const val_value_t *val,
+                  val_value_t *copy)
+{
+    const val_value_t *ch;
+    val_value_t       *copych;
+
+    copy->editop = val->editop;
+    if (!typ_has_children(val->btyp)) {
+        return;
+    }
+
+    /* clone_test skips the same children, so the queues line up */
+    copych = (val_value_t *)dlq_firstEntry(&copy->v.childQ);
+    for (ch = (const val_value_t *)dlq_firstEntry(&val->v.childQ);
+         ch != NULL && copych != NULL;
+         ch = (const val_value_t *)dlq_nextEntry(ch)) {
+        if (ch->res != NO_ERR) {
+            continue;
+        }
+        copy_editops(ch, copych);
+        copych = (val_value_t *)dlq_nextEntry(copych);
+    }
+
+}  /* copy_editops */
+
+
+/********************************************************************
+* FUNCTION chindex_hash
+* 
+* Get the hash value for a child node name
+*
+* INPUTS:
+*    name == child name to hash
+*
+* RETURNS:
+*    hash value
+*********************************************************************/
+static uint32
+    chindex_hash (const xmlChar *name)
+{
+    uint32 hash = 2166136261U;
+
+    while (*name) {
+        hash ^= (uint32)*name++;
+        hash *= 16777619U;
+    }
+    return hash;
+
+}  /* chindex_hash */
+
+
+/********************************************************************
+* FUNCTION chrec_match
+* 
+* Check if a child node is an instance of an index record
+*
+* INPUTS:
+*    rec == child index record
+*    val == child node to check
+*
+* RETURNS:
+*    TRUE if val has the QName of the record; FALSE otherwise
+*********************************************************************/
+static boolean
+    chrec_match (const val_chrec_t *rec,
+                 const val_value_t *val)
+{
+    if (val == rec->first) {
+        return TRUE;
+    }
+    return (val->name != NULL && val->nsid == rec->nsid &&
+            !xml_strcmp(val->name, rec->first->name)) ? TRUE : FALSE;
+
+}  /* chrec_match */
+
+
+/********************************************************************
+* FUNCTION chindex_find_rec
+* 
+* Find the index record for an exact child QName
+*
+* INPUTS:
+*    chindex == child index to search
+*    nsid == child namespace ID
+*    name == child name
+*    hash == hash of the child name
+*
+* RETURNS:
+*    pointer to the record or NULL if not found
+*********************************************************************/
+static val_chrec_t *
+    chindex_find_rec (const val_chindex_t *chindex,
+                      xmlns_id_t nsid,
+                      const xmlChar *name,
+                      uint32 hash)
+{
+    val_chrec_t *rec = chindex->buckets[hash & (chindex->numbuckets - 1)];
+
+    for (; rec != NULL; rec = rec->next) {
+        if (rec->hash == hash && rec->nsid == nsid &&
+            !xml_strcmp(rec->first->name, name)) {
+            return rec;
+        }
+    }
+    return NULL;
+
+}  /* chindex_find_rec */
+
+
+/********************************************************************
+* FUNCTION chindex_grow
+* 
+* Double the number of hash buckets in a child index
+*
+* INPUTS:
+*    chindex == child index to resize
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    chindex_grow (val_chindex_t *chindex)
+{
+    val_chrec_t **newbuckets, *rec, *nextrec;
+    uint32        newnum, i, slot;
+
+    newnum = chindex->numbuckets * 2;
+    newbuckets = m__getMem(newnum * sizeof(val_chrec_t *));
+    if (newbuckets == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(newbuckets, 0x0, newnum * sizeof(val_chrec_t *));
+
+    for (i = 0; i < chindex->numbuckets; i++) {
+        for (rec = chindex->buckets[i]; rec != NULL; rec = nextrec) {
+            nextrec = rec->next;
+            slot = rec->hash & (newnum - 1);
+            rec->next = newbuckets[slot];
+            newbuckets[slot] = rec;
+        }
+    }
+
+    m__free(chindex->buckets);
+    chindex->buckets = newbuckets;
+    chindex->numbuckets = newnum;
+    return NO_ERR;
+
+}  /* chindex_grow */
+
+
+/********************************************************************
+* FUNCTION chindex_new_rec
+* 
+* Add a record for the first instance of a child QName
+*
+* INPUTS:
+*    chindex == child index to add to
+*    child == first instance of the QName
+*    hash == hash of the child name
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    chindex_new_rec (val_chindex_t *chindex,
+                     val_value_t *child,
+                     uint32 hash)
+{
+    val_chrec_t *rec;
+    uint32       slot;
+
+    if (chindex->numrecs >= chindex->numbuckets) {
+        status_t res = chindex_grow(chindex);
+        if (res != NO_ERR) {
+            return res;
+        }
+    }
+
+    rec = m__getObj(val_chrec_t);
+    if (rec == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    rec->first = child;
+    rec->hash = hash;
+    rec->count = 1;
+    rec->nsid = child->nsid;
+    rec->keyroot = NULL;
+    rec->keysorted = FALSE;
+    rec->keyfail = FALSE;
+    rec->sibset = NULL;
+
+    slot = hash & (chindex->numbuckets - 1);
+    rec->next = chindex->buckets[slot];
+    chindex->buckets[slot] = rec;
+    chindex->numrecs++;
+    return NO_ERR;
+
+}  /* chindex_new_rec */
+
+
+/********************************************************************
+* FUNCTION chindex_build
+* 
+* Build the child index for a complex value node
+* The index is only a search accelerator; if it cannot
+* be built the childQ is still searched linearly
+*
+* INPUTS:
+*    parent == complex value node to index
+*
+*********************************************************************/
+static void
+    chindex_build (val_value_t *parent)
+{
+    val_chindex_t *chindex;
+    val_extra_t   *extra;
+    val_value_t   *val;
+    val_chrec_t   *rec;
+    uint32         hash;
+
+    extra = val_get_extra(parent);
+    if (extra == NULL) {
+        return;
+    }
+
+    chindex = m__getObj(val_chindex_t);
+    if (chindex == NULL) {
+        return;
+    }
+    chindex->buckets = 
+        m__getMem(VAL_CHINDEX_BUCKETS * sizeof(val_chrec_t *));
+    if (chindex->buckets == NULL) {
+        m__free(chindex);
+        return;
+    }
+    memset(chindex->buckets, 0x0, 
+           VAL_CHINDEX_BUCKETS * sizeof(val_chrec_t *));
+    chindex->numbuckets = VAL_CHINDEX_BUCKETS;
+    chindex->numrecs = 0;
+    extra->chindex = chindex;
+
+    for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
+         val != NULL;
+         val = (val_value_t *)dlq_nextEntry(val)) {
+
+        if (val->name == NULL) {
+            /* deleted node marker */
+            continue;
+        }
+
+        hash = chindex_hash(val->name);
+        rec = chindex_find_rec(chindex, val->nsid, val->name, hash);
+        if (rec) {
+            rec->count++;
+        } else if (chindex_new_rec(chindex, val, hash) != NO_ERR) {
+            val_clear_child_index(parent);
+            return;
+        }
+    }
+
+}  /* chindex_build */
+
+
+/********************************************************************
+* FUNCTION chindex_check_build
+* 
+* Build the child index after a linear child search
+* if the search had to pass over too many siblings
+*
+* INPUTS:
+*    parent == parent node that was searched
+*    scancnt == number of child nodes checked by the search
+*
+*********************************************************************/
+static void
+    chindex_check_build (const val_value_t *parent,
+                         uint32 scancnt)
+{
+    val_value_t *child;
+
+    if (scancnt < VAL_CHILD_INDEX_MIN || VAL_CHINDEX(parent) != NULL) {
+        return;
+    }
+
+    /* the index is a cache, not part of the value, so a const
+     * parent is still updated, through the child back-pointer
+     */
+    child = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
+    if (child != NULL && child->parent == parent) {
+        chindex_build(child->parent);
+    }
+
+}  /* chindex_check_build */
+
+
+/********************************************************************
+* FUNCTION key_entry_ok
+* 
+* Check if a list entry has a complete index chain,
+* or a leaf-list entry has a simple value,
+* so it can be stored in a key tree
+*
+* INPUTS:
+*    val == list or leaf-list entry to check
+*
+* RETURNS:
+*    TRUE if the entry can be ordered by keytree_compare
+*********************************************************************/
+static boolean
+    key_entry_ok (const val_value_t *val)
+{
+    const val_index_t *valin;
+    uint32             cnt = 0;
+
+    if (val->obj && val->obj->objtype == OBJ_TYP_LEAF_LIST) {
+        /* leaf-list values are only kept in a key tree
+         * during a sibling set pass
+         */
+        return (sibset_passcnt && typ_is_simple(val->btyp)) ? TRUE : FALSE;
+    }
+
+    if (val->btyp != NCX_BT_LIST || val->obj == NULL ||
+        val->obj->objtype != OBJ_TYP_LIST) {
+        return FALSE;
+    }
+
+    for (valin = (const val_index_t *)dlq_firstEntry(&val->indexQ);
+         valin != NULL;
+         valin = (const val_index_t *)dlq_nextEntry(valin)) {
+        if (valin->val == NULL) {
+            return FALSE;
+        }
+        cnt++;
+    }
+
+    return (cnt > 0 && cnt == obj_key_count(val->obj)) ? TRUE : FALSE;
+
+}  /* key_entry_ok */
+
+
+/********************************************************************
+* FUNCTION keynode_height
+* 
+* Get the height of a key tree node; 0 for an empty subtree
+*
+* INPUTS:
+*    node == node to check (may be NULL)
+*
+* RETURNS:
+*    height of the subtree
+*********************************************************************/
+static int32
+    keynode_height (const val_keynode_t *node)
+{
+    return (node) ? node->height : 0;
+
+}  /* keynode_height */
+
+
+/********************************************************************
+* FUNCTION keynode_set_height
+* 
+* Recalculate the height of a key tree node from its subtrees
+*
+* INPUTS:
+*    node == node to update
+*
+*********************************************************************/
+static void
+    keynode_set_height (val_keynode_t *node)
+{
+    int32 lh = keynode_height(node->left);
+    int32 rh = keynode_height(node->right);
+
+    node->height = ((lh > rh) ? lh : rh) + 1;
+
+}  /* keynode_set_height */
+
+
+/********************************************************************
+* FUNCTION keynode_replace
+* 
+* Replace a subtree in the parent of oldnode (or the root)
+*
+* INPUTS:
+*    rec == child index record that owns the tree
+*    oldnode == node being replaced
+*    newnode == node taking its place (may be NULL)
+*
+*********************************************************************/
+static void
+    keynode_replace (val_chrec_t *rec,
+                     val_keynode_t *oldnode,
+                     val_keynode_t *newnode)
+{
+    val_keynode_t *up = oldnode->up;
+
+    if (newnode) {
+        newnode->up = up;
+    }
+    if (up == NULL) {
+        rec->keyroot = newnode;
+    } else if (up->left == oldnode) {
+        up->left = newnode;
+    } else {
+        up->right = newnode;
+    }
+
+}  /* keynode_replace */
+
+
+/********************************************************************
+* FUNCTION keynode_rotate
+* 
+* Rotate a key tree node down to the left or the right
+*
+* INPUTS:
+*    rec == child index record that owns the tree
+*    node == node to rotate down
+*    left == TRUE to rotate left (right child moves up)
+*            FALSE to rotate right (left child moves up)
+*
+* RETURNS:
+*    the node that took the place of node
+*********************************************************************/
+static val_keynode_t *
+    keynode_rotate (val_chrec_t *rec,
+                    val_keynode_t *node,
+                    boolean left)
+{
+    val_keynode_t *pivot, *inner;
+
+    if (left) {
+        pivot = node->right;
+        inner = pivot->left;
+        node->right = inner;
+        pivot->left = node;
+    } else {
+        pivot = node->left;
+        inner = pivot->right;
+        node->left = inner;
+        pivot->right = node;
+    }
+    if (inner) {
+        inner->up = node;
+    }
+    keynode_replace(rec, node, pivot);
+    node->up = pivot;
+
+    keynode_set_height(node);
+    keynode_set_height(pivot);
+    return pivot;
+
+}  /* keynode_rotate */
+
+
+/********************************************************************
+* FUNCTION keytree_rebalance
+* 
+* Restore the AVL balance from a node up to the root
+*
+* INPUTS:
+*    rec == child index record that owns the tree
+*    node == lowest node that may be out of balance
+*
+*********************************************************************/
+static void
+    keytree_rebalance (val_chrec_t *rec,
+                       val_keynode_t *node)
+{
+    int32 balance;
+
+    while (node) {
+        keynode_set_height(node);
+        balance = keynode_height(node->left) - keynode_height(node->right);
+        if (balance > 1) {
+            if (keynode_height(node->left->left) <
+                keynode_height(node->left->right)) {
+                (void)keynode_rotate(rec, node->left, TRUE);
+            }
+            node = keynode_rotate(rec, node, FALSE);
+        } else if (balance < -1) {
+            if (keynode_height(node->right->right) <
+                keynode_height(node->right->left)) {
+                (void)keynode_rotate(rec, node->right, FALSE);
+            }
+            node = keynode_rotate(rec, node, TRUE);
+        }
+        node = node->up;
+    }
+
+}  /* keytree_rebalance */
+
+
+/********************************************************************
+* FUNCTION keynode_next
+* 
+* Get the next node in key order
+*
+* INPUTS:
+*    node == current node
+*
+* RETURNS:
+*    next node or NULL if none
+*********************************************************************/
+static val_keynode_t *
+    keynode_next (val_keynode_t *node)
+{
+    if (node->right) {
+        node = node->right;
+        while (node->left) {
+            node = node->left;
+        }
+        return node;
+    }
+    while (node->up && node->up->right == node) {
+        node = node->up;
+    }
+    return node->up;
+
+}  /* keynode_next */
+
+
+/********************************************************************
+* FUNCTION keynode_prev
+* 
+* Get the previous node in key order
+*
+* INPUTS:
+*    node == current node
+*
+* RETURNS:
+*    previous node or NULL if none
+*********************************************************************/
+static val_keynode_t *
+    keynode_prev (val_keynode_t *node)
+{
+    if (node->left) {
+        node = node->left;
+        while (node->right) {
+            node = node->right;
+        }
+        return node;
+    }
+    while (node->up && node->up->left == node) {
+        node = node->up;
+    }
+    return node->up;
+
+}  /* keynode_prev */
+
+
+/********************************************************************
+* FUNCTION keytree_free
+* 
+* Free all the nodes in the key tree of a child index record
+*
+* INPUTS:
+*    rec == child index record to clear
+*
+*********************************************************************/
+static void
+    keytree_free (val_chrec_t *rec)
+{
+    val_keynode_t *node = rec->keyroot, *up;
+
+    /* post-order walk without recursion */
+    while (node) {
+        if (node->left) {
+            node = node->left;
+        } else if (node->right) {
+            node = node->right;
+        } else {
+            up = node->up;
+            if (up) {
+                if (up->left == node) {
+                    up->left = NULL;
+                } else {
+                    up->right = NULL;
+                }
+            }
+            m__free(node);
+            node = up;
+        }
+    }
+    rec->keyroot = NULL;
+    rec->keysorted = FALSE;
+
+}  /* keytree_free */
+
+
+/********************************************************************
+* FUNCTION keytree_compare
+* 
+* Compare two instances in key tree order:
+* list entries by their keys, leaf-list entries by value
+*
+* INPUTS:
+*    val1 == first entry to compare
+*    val2 == second entry to compare
+*
+* RETURNS:
+*    -1, 0 or 1 as for val_index_compare
+*    -2 if the entries cannot be compared
+*********************************************************************/
+static int32
+    keytree_compare (const val_value_t *val1,
+                     const val_value_t *val2)
+{
+    int32  ret;
+
+    if (val1->btyp == NCX_BT_LIST) {
+        return index_match(val1, val2);
+    }
+
+    if (val1->btyp != val2->btyp) {
+        return -2;
+    }
+    ret = val_compare(val1, val2);
+    if (ret < 0) {
+        return -1;
+    }
+    return (ret > 0) ? 1 : 0;
+
+}  /* keytree_compare */
+
+
+/********************************************************************
+* FUNCTION keytree_bound
+* 
+* Find the first node in key order that is not less than
+* (or with upper == TRUE, greater than) an entry
+*
+* INPUTS:
+*    rec == child index record with a key tree
+*    val == list entry with the keys, or leaf-list value, to find
+*    upper == FALSE for the first node with key >= val
+*             TRUE for the first node with key > val
+*    res == address of return status
+*
+* OUTPUTS:
+*    *res == ERR_INTERNAL_VAL if the keys could not be compared
+*
+* RETURNS:
+*    pointer to the node or NULL if none
+*********************************************************************/
+static val_keynode_t *
+    keytree_bound (const val_chrec_t *rec,
+                   const val_value_t *val,
+                   boolean upper,
+                   status_t *res)
+{
+    val_keynode_t *node = rec->keyroot, *found = NULL;
+    int32          cmp;
+
+    *res = NO_ERR;
+    while (node) {
+        cmp = keytree_compare(val, node->val);
+        if (cmp == -2) {
+            *res = ERR_INTERNAL_VAL;
+            return NULL;
+        }
+        if (cmp < 0 || (cmp == 0 && !upper)) {
+            found = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    return found;
+
+}  /* keytree_bound */
+
+
+/********************************************************************
+* FUNCTION keytree_insert
+* 
+* Add a list entry to the key tree after any equal entries
+*
+* INPUTS:
+*    rec == child index record with a key tree
+*    val == list entry to add
+*
+* RETURNS:
+*    new node or NULL if a malloc or key compare failed
+*********************************************************************/
+static val_keynode_t *
+    keytree_insert (val_chrec_t *rec,
+                    val_value_t *val)
+{
+    val_keynode_t *node, *up = NULL, *newnode;
+    int32          cmp = 0;
+
+    for (node = rec->keyroot; node != NULL; ) {
+        cmp = keytree_compare(val, node->val);
+        if (cmp == -2) {
+            return NULL;
+        }
+        up = node;
+        node = (cmp < 0) ? node->left : node->right;
+    }
+
+    newnode = m__getObj(val_keynode_t);
+    if (newnode == NULL) {
+        return NULL;
+    }
+    newnode->left = NULL;
+    newnode->right = NULL;
+    newnode->up = up;
+    newnode->val = val;
+    newnode->height = 1;
+
+    if (up == NULL) {
+        rec->keyroot = newnode;
+    } else if (cmp < 0) {
+        up->left = newnode;
+    } else {
+        up->right = newnode;
+    }
+    keytree_rebalance(rec, up);
+    return newnode;
+
+}  /* keytree_insert */
+
+
+/********************************************************************
+* FUNCTION keytree_remove
+* 
+* Remove a list entry from the key tree
+*
+* INPUTS:
+*    rec == child index record with a key tree
+*    val == list entry to remove
+*
+* RETURNS:
+*    TRUE if the entry was found and removed
+*********************************************************************/
+static boolean
+    keytree_remove (val_chrec_t *rec,
+                    val_value_t *val)
+{
+    val_keynode_t *node, *child, *up;
+    status_t       res;
+
+    if (!key_entry_ok(val)) {
+        return FALSE;
+    }
+
+    node = keytree_bound(rec, val, FALSE, &res);
+    while (node && node->val != val) {
+        if (keytree_compare(val, node->val) != 0) {
+            return FALSE;
+        }
+        node = keynode_next(node);
+    }
+    if (node == NULL) {
+        return FALSE;
+    }
+
+    if (node->left && node->right) {
+        /* move the successor entry into this node
+         * and remove the successor node instead
+         */
+        child = node->right;
+        while (child->left) {
+            child = child->left;
+        }
+        node->val = child->val;
+        node = child;
+    }
+
+    child = (node->left) ? node->left : node->right;
+    up = node->up;
+    keynode_replace(rec, node, child);
+    m__free(node);
+    keytree_rebalance(rec, up);
+    return TRUE;
+
+}  /* keytree_remove */
+
+
+/********************************************************************
+* FUNCTION keytree_check_sorted
+* 
+* Check that a new key tree node has the same neighbors
+* in the key tree and in the childQ, so the instances stay
+* contiguous and in key order in the childQ
+*
+* INPUTS:
+*    rec == child index record with a key tree
+*    node == node just added for a linked child node
+*
+*********************************************************************/
+static void
+    keytree_check_sorted (val_chrec_t *rec,
+                          val_keynode_t *node)
+{
+    val_keynode_t *prevnode = keynode_prev(node);
+    val_keynode_t *nextnode = keynode_next(node);
+    val_value_t   *qprev = (val_value_t *)dlq_prevEntry(node->val);
+    val_value_t   *qnext = (val_value_t *)dlq_nextEntry(node->val);
+
+    if (qprev && !chrec_match(rec, qprev)) {
+        qprev = NULL;
+    }
+    if (qnext && !chrec_match(rec, qnext)) {
+        qnext = NULL;
+    }
+    if (((prevnode) ? prevnode->val : NULL) != qprev ||
+        ((nextnode) ? nextnode->val : NULL) != qnext) {
+        rec->keysorted = FALSE;
+    }
+
+}  /* keytree_check_sorted */
+
+
+/********************************************************************
+* FUNCTION keytree_build
+* 
+* Build the key tree for the list entries of a child index record
+*
+* INPUTS:
+*    rec == child index record for list entries
+*
+* RETURNS:
+*    TRUE if the key tree is available
+*********************************************************************/
+static boolean
+    keytree_build (val_chrec_t *rec)
+{
+    val_value_t   *val, *lastval = NULL;
+    val_keynode_t *node;
+    uint32         seen;
+
+    if (rec->keyroot) {
+        return TRUE;
+    }
+    if (rec->keyfail || rec->count < VAL_CHILD_INDEX_MIN) {
+        return FALSE;
+    }
+
+    rec->keysorted = TRUE;
+    for (val = rec->first, seen = 0;
+         val != NULL && seen < rec->count;
+         val = (val_value_t *)dlq_nextEntry(val)) {
+
+        if (!chrec_match(rec, val)) {
+            if (lastval) {
+                /* instances are not contiguous */
+                rec->keysorted = FALSE;
+            }
+            continue;
+        }
+        seen++;
+
+        node = (key_entry_ok(val)) ? keytree_insert(rec, val) : NULL;
+        if (node == NULL) {
+            keytree_free(rec);
+            rec->keyfail = TRUE;
+            return FALSE;
+        }
+        if (keynode_next(node) != NULL) {
+            /* not the highest key so far */
+            rec->keysorted = FALSE;
+        }
+        lastval = val;
+    }
+    return TRUE;
+
+}  /* keytree_build */
+
+
+/* forward decl; defined with the subtree digest functions */
+static boolean
+    digest_simval (const val_value_t *val,
+                   uint64 *hash);
+
+
+/********************************************************************
+* FUNCTION sibset_hashable
+* 
+* Get the value hash of a leaf-list instance for a sibling set
+* Only types where val_compare equality means an equal
+* digest_simval are hashed
+*
+* INPUTS:
+*    val == leaf-list instance to hash
+*    hash == address of return hash
+*
+* OUTPUTS:
+*    *hash set if TRUE is returned
+*
+* RETURNS:
+*    TRUE if the value can be hashed
+*********************************************************************/
+static boolean
+    sibset_hashable (const val_value_t *val,
+                     uint64 *hash)
+{
+    /* -0 and 0 compare equal but do not hash the same */
+    if (val->btyp == NCX_BT_FLOAT64 || val->btyp == NCX_BT_SLIST) {
+        return FALSE;
+    }
+
+    *hash = VAL_DIGEST_SEED;
+    return digest_simval(val, hash);
+
+}  /* sibset_hashable */
+
+
+/********************************************************************
+* FUNCTION sibset_free_buckets
+* 
+* Free the value hash of a sibling set
+* The instances are searched in order after this
+*
+* INPUTS:
+*    set == sibling set to clear
+*
+*********************************************************************/
+static void
+    sibset_free_buckets (val_sibset_t *set)
+{
+    val_sibnode_t *node, *nextnode;
+    uint32         i;
+
+    if (set->buckets == NULL) {
+        return;
+    }
+    for (i = 0; i < set->numbuckets; i++) {
+        for (node = set->buckets[i]; node != NULL; node = nextnode) {
+            nextnode = node->next;
+            m__free(node);
+        }
+    }
+    m__free(set->buckets);
+    set->buckets = NULL;
+    set->numbuckets = 0;
+    set->numnodes = 0;
+
+}  /* sibset_free_buckets */
+
+
+/********************************************************************
+* FUNCTION sibset_free
+* 
+* Free the sibling set of a child index record, if any
+*
+* INPUTS:
+*    rec == child index record
+*
+*********************************************************************/
+static void
+    sibset_free (val_chrec_t *rec)
+{
+    val_sibset_t *set = rec->sibset;
+
+    if (set == NULL) {
+        return;
+    }
+    rec->sibset = NULL;
+    sibset_free_buckets(set);
+    dlq_remove(set);
+
+    if (set->leaflist) {
+        /* the value order tree only lives as long as the set */
+        keytree_free(rec);
+        rec->keyfail = FALSE;
+    }
+    m__free(set);
+
+}  /* sibset_free */
+
+
+/********************************************************************
+* FUNCTION sibset_grow
+* 
+* Double the number of hash buckets in a sibling set
+*
+* INPUTS:
+*    set == sibling set with a value hash
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    sibset_grow (val_sibset_t *set)
+{
+    val_sibnode_t **newbuckets, *node, *nextnode;
+    uint32          newnum, i, slot;
+
+    newnum = set->numbuckets * 2;
+    newbuckets = m__getMem(newnum * sizeof(val_sibnode_t *));
+    if (newbuckets == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(newbuckets, 0x0, newnum * sizeof(val_sibnode_t *));
+
+    for (i = 0; i < set->numbuckets; i++) {
+        for (node = set->buckets[i]; node != NULL; node = nextnode) {
+            nextnode = node->next;
+            slot = (uint32)node->hash & (newnum - 1);
+            node->next = newbuckets[slot];
+            newbuckets[slot] = node;
+        }
+    }
+    m__free(set->buckets);
+    set->buckets = newbuckets;
+    set->numbuckets = newnum;
+    return NO_ERR;
+
+}  /* sibset_grow */
+
+
+/********************************************************************
+* FUNCTION sibset_add_value
+* 
+* Add a leaf-list instance to the value hash of a sibling set
+*
+* INPUTS:
+*    set == sibling set with a value hash
+*    val == leaf-list instance to add
+*
+* RETURNS:
+*    TRUE if added; FALSE if the value hash cannot be used
+*********************************************************************/
+static boolean
+    sibset_add_value (val_sibset_t *set,
+                      val_value_t *val)
+{
+    val_sibnode_t *node;
+    uint64         hash;
+    uint32         slot;
+
+    if (val->btyp != set->btyp || !sibset_hashable(val, &hash)) {
+        return FALSE;
+    }
+    if (set->numnodes >= set->numbuckets && sibset_grow(set) != NO_ERR) {
+        return FALSE;
+    }
+
+    node = m__getObj(val_sibnode_t);
+    if (node == NULL) {
+        return FALSE;
+    }
+    node->val = val;
+    node->hash = hash;
+
+    slot = (uint32)hash & (set->numbuckets - 1);
+    node->next = set->buckets[slot];
+    set->buckets[slot] = node;
+    set->numnodes++;
+    return TRUE;
+
+}  /* sibset_add_value */
+
+
+/********************************************************************
+* FUNCTION sibset_remove_value
+* 
+* Remove a leaf-list instance from the value hash of a sibling set
+*
+* INPUTS:
+*    set == sibling set with a value hash
+*    val == leaf-list instance to remove
+*
+*********************************************************************/
+static void
+    sibset_remove_value (val_sibset_t *set,
+                         val_value_t *val)
+{
+    val_sibnode_t **prevptr, *node;
+    uint64          hash;
+
+    if (sibset_hashable(val, &hash)) {
+        prevptr = &set->buckets[(uint32)hash & (set->numbuckets - 1)];
+        for (node = *prevptr; node != NULL; node = node->next) {
+            if (node->val == val) {
+                *prevptr = node->next;
+                set->numnodes--;
+                m__free(node);
+                return;
+            }
+            prevptr = &node->next;
+        }
+    }
+
+    /* the value was changed in place; stop using the hash */
+    sibset_free_buckets(set);
+
+}  /* sibset_remove_value */
+
+
+/********************************************************************
+* FUNCTION sibset_get
+* 
+* Get the sibling set of a child index record,
+* and build it if a sibling set pass is active
+*
+* INPUTS:
+*    rec == child index record
+*
+* RETURNS:
+*    pointer to the sibling set or NULL if none
+*********************************************************************/
+static val_sibset_t *
+    sibset_get (val_chrec_t *rec)
+{
+    val_sibset_t *set;
+    val_value_t  *val;
+    uint32        seen, size;
+    boolean       gap;
+
+    if (rec->sibset) {
+        return rec->sibset;
+    }
+    if (sibset_passcnt == 0 || rec->count < VAL_CHILD_INDEX_MIN) {
+        return NULL;
+    }
+
+    set = m__getObj(val_sibset_t);
+    if (set == NULL) {
+        return NULL;
+    }
+    memset(set, 0x0, sizeof(val_sibset_t));
+    set->rec = rec;
+    set->contig = TRUE;
+    set->btyp = rec->first->btyp;
+
+    set->leaflist = (rec->first->obj &&
+                     rec->first->obj->objtype == OBJ_TYP_LEAF_LIST)
+        ? TRUE : FALSE;
+    if (set->leaflist) {
+        for (size = VAL_CHINDEX_BUCKETS; size < rec->count; size *= 2) {
+            ;
+        }
+        set->buckets = m__getMem(size * sizeof(val_sibnode_t *));
+        if (set->buckets) {
+            memset(set->buckets, 0x0, size * sizeof(val_sibnode_t *));
+            set->numbuckets = size;
+        }
+    }
+
+    gap = FALSE;
+    for (val = rec->first, seen = 0;
+         val != NULL && seen < rec->count;
+         val = (val_value_t *)dlq_nextEntry(val)) {
+
+        if (!chrec_match(rec, val)) {
+            gap = TRUE;
+            continue;
+        }
+        if (gap) {
+            set->contig = FALSE;
+        }
+        seen++;
+        set->last = val;
+
+        if (set->buckets && !sibset_add_value(set, val)) {
+            sibset_free_buckets(set);
+        }
+    }
+
+    if (seen != rec->count) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        sibset_free_buckets(set);
+        m__free(set);
+        return NULL;
+    }
+
+    dlq_enque(set, &sibsetQ);
+    rec->sibset = set;
+    return set;
+
+}  /* sibset_get */
+
+
+/********************************************************************
+* FUNCTION sibset_find
+* 
+* Search the value hash of a sibling set for a leaf-list
+* instance, with the same result as child_match_ok
+*
+* INPUTS:
+*    rec == child index record for the leaf-list instances
+*    child == leaf-list value to find
+*    retval == address of return instance
+*
+* OUTPUTS:
+*    *retval == matching instance, or NULL if there is none
+*
+* RETURNS:
+*    TRUE if the sibling set answered the search
+*    FALSE if the caller has to search the instances in order
+*********************************************************************/
+static boolean
+    sibset_find (val_chrec_t *rec,
+                 val_value_t *child,
+                 val_value_t **retval)
+{
+    val_sibset_t  *set;
+    val_sibnode_t *node;
+    val_value_t   *found = NULL;
+    uint64         hash;
+
+    if (rec->first->obj == NULL ||
+        rec->first->obj->objtype != OBJ_TYP_LEAF_LIST) {
+        return FALSE;
+    }
+
+    set = sibset_get(rec);
+    if (set == NULL || set->buckets == NULL ||
+        child->btyp != set->btyp || !sibset_hashable(child, &hash)) {
+        return FALSE;
+    }
+
+    for (node = set->buckets[(uint32)hash & (set->numbuckets - 1)];
+         node != NULL;
+         node = node->next) {
+        if (node->hash != hash || VAL_IS_DELETED(node->val) ||
+            val_compare(node->val, child)) {
+            continue;
+        }
+        if (found) {
+            /* duplicate values; the first one in the childQ wins */
+            return FALSE;
+        }
+        found = node->val;
+    }
+
+    *retval = found;
+    return TRUE;
+
+}  /* sibset_find */
+
+
+/********************************************************************
+* FUNCTION sibset_check_split
+* 
+* Check if a new child node went in between two instances
+* of another child, which has a sibling set
+*
+* INPUTS:
+*    parent == parent node with a child index
+*    child == child node just added
+*
+*********************************************************************/
+static void
+    sibset_check_split (val_value_t *parent,
+                        val_value_t *child)
+{
+    val_value_t *prev, *next;
+    val_chrec_t *rec;
+
+    prev = (val_value_t *)dlq_prevEntry(child);
+    next = (val_value_t *)dlq_nextEntry(child);
+    if (prev == NULL || next == NULL || prev->name == NULL ||
+        next->name == NULL || prev->nsid != next->nsid ||
+        xml_strcmp(prev->name, next->name)) {
+        return;
+    }
+    if (child->name && child->nsid == prev->nsid &&
+        !xml_strcmp(child->name, prev->name)) {
+        return;
+    }
+
+    rec = chindex_find_rec(VAL_CHINDEX(parent), prev->nsid, prev->name,
+                           chindex_hash(prev->name));
+    if (rec && rec->sibset) {
+        rec->sibset->contig = FALSE;
+    }
+
+}  /* sibset_check_split */
+
+
+/********************************************************************
+* FUNCTION sibset_added
+* 
+* Update a sibling set after an instance
+* has been linked into the parent childQ
+*
+* INPUTS:
+*    rec == child index record with a sibling set
+*    child == instance just added
+*
+*********************************************************************/
+static void
+    sibset_added (val_chrec_t *rec,
+                  val_value_t *child)
+{
+    val_sibset_t *set = rec->sibset;
+
+    if ((val_value_t *)dlq_prevEntry(child) == set->last) {
+        set->last = child;
+    }
+    if (set->buckets && !sibset_add_value(set, child)) {
+        sibset_free_buckets(set);
+    }
+
+}  /* sibset_added */
+
+
+/********************************************************************
+* FUNCTION sibset_removed
+* 
+* Update a sibling set before an instance
+* is unlinked from the parent childQ
+*
+* INPUTS:
+*    rec == child index record with a sibling set
+*    child == instance about to be removed
+*
+*********************************************************************/
+static void
+    sibset_removed (val_chrec_t *rec,
+                    val_value_t *child)
+{
+    val_sibset_t *set = rec->sibset;
+    val_value_t  *prev;
+
+    if (set->buckets) {
+        sibset_remove_value(set, child);
+    }
+    if (set->last == child) {
+        prev = (val_value_t *)dlq_prevEntry(child);
+        if (prev != NULL && chrec_match(rec, prev)) {
+            set->last = prev;
+        } else {
+            /* rebuilt on demand */
+            sibset_free(rec);
+        }
+    }
+
+}  /* sibset_removed */
+
+
+/********************************************************************
+* FUNCTION chindex_add
+* 
+* Update the child index of the parent after
+* a child node has been linked into the parent childQ
+*
+* INPUTS:
+*    parent == parent node with a child index
+*    child == child node just added
+*
+*********************************************************************/
+static void
+    chindex_add (val_value_t *parent,
+                 val_value_t *child)
+{
+    val_value_t   *prev, *next;
+    val_chrec_t   *rec;
+    val_keynode_t *node;
+    uint32         hash;
+
+    if (sibset_passcnt) {
+        sibset_check_split(parent, child);
+    }
+
+    if (child->name == NULL) {
+        return;
+    }
+
+    hash = chindex_hash(child->name);
+    rec = chindex_find_rec(VAL_CHINDEX(parent), child->nsid, child->name, hash);
+    if (rec == NULL) {
+        if (chindex_new_rec(VAL_CHINDEX(parent), child, hash) != NO_ERR) {
+            val_clear_child_index(parent);
+        }
+        return;
+    }
+
+    rec->count++;
+
+    if (rec->sibset) {
+        sibset_added(rec, child);
+    }
+
+    if (rec->keyroot) {
+        node = (key_entry_ok(child)) ? keytree_insert(rec, child) : NULL;
+        if (node == NULL) {
+            /* rebuilt on demand once the entry has its keys */
+            keytree_free(rec);
+        } else if (rec->keysorted) {
+            keytree_check_sorted(rec, node);
+        }
+    }
+
+    /* the first-instance pointer only changes if the new node
+     * went in ahead of all the other instances
+     */
+    prev = (val_value_t *)dlq_prevEntry(child);
+    if (prev != NULL && chrec_match(rec, prev)) {
+        return;
+    }
+    next = (val_value_t *)dlq_nextEntry(child);
+    if (next == NULL) {
+        return;
+    }
+    if (next == rec->first) {
+        rec->first = child;
+        return;
+    }
+    if (chrec_match(rec, next)) {
+        return;
+    }
+
+    /* inserted somewhere away from the other instances;
+     * not worth a search here, so rebuild when needed
+     */
+    val_clear_child_index(parent);
+
+}  /* chindex_add */
+
+
+/********************************************************************
+* FUNCTION chindex_remove
+* 
+* Update the child index of the parent before
+* a child node is unlinked from the parent childQ
+*
+* INPUTS:
+*    parent == parent node with a child index
+*    child == child node about to be removed
+*
+*********************************************************************/
+static void
+    chindex_remove (val_value_t *parent,
+                    val_value_t *child)
+{
+    val_chindex_t *chindex = VAL_CHINDEX(parent);
+    val_chrec_t  **prevptr, *rec;
+    val_value_t   *next;
+    uint32         hash;
+
+    if (child->name == NULL) {
+        return;
+    }
+
+    hash = chindex_hash(child->name);
+    prevptr = &chindex->buckets[hash & (chindex->numbuckets - 1)];
+    for (rec = *prevptr; rec != NULL; rec = rec->next) {
+        if (rec->hash == hash && chrec_match(rec, child)) {
+            break;
+        }
+        prevptr = &rec->next;
+    }
+    if (rec == NULL) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        val_clear_child_index(parent);
+        return;
+    }
+
+    if (rec->keyroot && !keytree_remove(rec, child)) {
+        keytree_free(rec);
+    }
+    /* the entry that could not be keyed may be this one */
+    rec->keyfail = FALSE;
+
+    if (rec->sibset) {
+        sibset_removed(rec, child);
+    }
+
+    if (--rec->count == 0) {
+        *prevptr = rec->next;
+        chindex->numrecs--;
+        keytree_free(rec);
+        sibset_free(rec);
+        m__free(rec);
+        return;
+    }
+
+    if (rec->first == child) {
+        for (next = (val_value_t *)dlq_nextEntry(child);
+             next != NULL;
+             next = (val_value_t *)dlq_nextEntry(next)) {
+            if (chrec_match(rec, next)) {
+                rec->first = next;
+                return;
+            }
+        }
+        SET_ERROR(ERR_INTERNAL_VAL);
+        val_clear_child_index(parent);
+    }
+
+}  /* chindex_remove */
+
+
+/********************************************************************
+* FUNCTION chindex_lookup
+* 
+* Search the child index for the instances of a child node
+*
+* INPUTS:
+*    chindex == child index to search
+*    nsmode == namespace matching to use
+*    modname == module name to match for CHINDEX_NS_MODNAME
+*    nsid == namespace ID to match for CHINDEX_NS_EXACT
+*            and CHINDEX_NS_EQUAL
+*    name == child name to find
+*    retrec == address of return record
+*
+* OUTPUTS:
+*    *retrec == record for the matching child nodes, or NULL
+*               if there are none
+*
+* RETURNS:
+*    TRUE if the index answered the search
+*    FALSE if the name matches more than one record,
+*      so the caller has to search the childQ in order
+*********************************************************************/
+static boolean
+    chindex_lookup (const val_chindex_t *chindex,
+                    chindex_nsmode_t nsmode,
+                    const xmlChar *modname,
+                    xmlns_id_t nsid,
+                    const xmlChar *name,
+                    val_chrec_t **retrec)
+{
+    val_chrec_t *rec, *found = NULL;
+    uint32       hash = chindex_hash(name);
+
+    for (rec = chindex->buckets[hash & (chindex->numbuckets - 1)];
+         rec != NULL;
+         rec = rec->next) {
+
+        if (rec->hash != hash || xml_strcmp(rec->first->name, name)) {
+            continue;
+        }
+
+        switch (nsmode) {
+        case CHINDEX_NS_ANY:
+            break;
+        case CHINDEX_NS_EXACT:
+            if (rec->nsid != nsid) {
+                continue;
+            }
+            break;
+        case CHINDEX_NS_EQUAL:
+            if (!xmlns_ids_equal(nsid, rec->nsid)) {
+                continue;
+            }
+            break;
+        case CHINDEX_NS_MODNAME:
+            if (rec->nsid == 0) {
+                /* module comes from each node's object */
+                return FALSE;
+            }
+            if (xml_strcmp(modname, val_get_mod_name(rec->first))) {
+                continue;
+            }
+            break;
+        default:
+            SET_ERROR(ERR_INTERNAL_VAL);
+            return FALSE;
+        }
+
+        if (found) {
+            return FALSE;
+        }
+        found = rec;
+    }
+
+    *retrec = found;
+    return TRUE;
+
+}  /* chindex_lookup */
+
+
+/********************************************************************
+* FUNCTION keytree_find
+* 
+* Find the first live list entry with the same keys
+* as a search entry, using the key tree
+*
+* INPUTS:
+*    rec == child index record for the list entries
+*    child == list entry with the keys to find
+*    retval == address of return list entry
+*
+* OUTPUTS:
+*    *retval == matching list entry or NULL if none
+*
+* RETURNS:
+*    TRUE if the key tree answered the search
+*    FALSE if the caller has to check the instances in order
+*********************************************************************/
+static boolean
+    keytree_find (val_chrec_t *rec,
+                  val_value_t *child,
+                  val_value_t **retval)
+{
+    val_keynode_t *node;
+    val_value_t   *found = NULL;
+    status_t       res;
+
+    if (child->obj != rec->first->obj || !key_entry_ok(child) ||
+        !keytree_build(rec)) {
+        return FALSE;
+    }
+
+    node = keytree_bound(rec, child, FALSE, &res);
+    if (res != NO_ERR) {
+        return FALSE;
+    }
+
+    /* equal keys are only in childQ order if keysorted is set */
+    for (; node != NULL && index_match(child, node->val) == 0;
+         node = keynode_next(node)) {
+        if (VAL_IS_DELETED(node->val)) {
+            continue;
+        }
+        if (found) {
+            return FALSE;
+        }
+        found = node->val;
+        if (rec->keysorted) {
+            break;
+        }
+    }
+
+    *retval = found;
+    return TRUE;
+
+}  /* keytree_find */
+
+
+/********************************************************************
+* FUNCTION child_match_ok
+* 
+* Check if a child node with the right QName is a match
+* for the search node in val_first_child_match
+*
+* INPUTS:
+*    val == child node to check
+*    child == child value to find (e.g., from a NETCONF PDU) 
+*
+* RETURNS:
+*    TRUE if val is a match
+*********************************************************************/
+static boolean
+    child_match_ok (val_value_t *val,
+                    val_value_t *child)
+{
+    if (val->btyp == NCX_BT_LIST) {
+        /* match the instance identifiers, if any */
+        return val_index_match(child, val);
+    } else if (val->obj->objtype == OBJ_TYP_LEAF_LIST) {
+        if (val->btyp == child->btyp) {
+            /* find the leaf-list with the same value */
+            return (val_compare(val, child)) ? FALSE : TRUE;
+        } else {
+            /* match any value; if this is a subtree
+             * filter test, it is not for a content match
+             * node
+             */
+            return TRUE;
+        }
+    }
+
+    /* can only be this one instance */
+    return TRUE;
+
+}  /* child_match_ok */
+
+
+/********************************************************************
+* FUNCTION digest_bytes
+* 
+* Add a byte buffer to a running subtree digest
+*
+* INPUTS:
+*    hash == digest so far
+*    buf == bytes to add
+*    len == number of bytes to add
+*
+* RETURNS:
+*    new digest value
+*********************************************************************/
+static uint64
+    digest_bytes (uint64 hash,
+                  const void *buf,
+                  size_t len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+
+    while (len--) {
+        hash ^= (uint64)*p++;
+        hash *= VAL_DIGEST_PRIME;
+    }
+    return hash;
+
+}  /* digest_bytes */
+
+
+/********************************************************************
+* FUNCTION digest_uint64
+* 
+* Add a number to a running subtree digest
+*
+* INPUTS:
+*    hash == digest so far
+*    num == number to add
+*
+* RETURNS:
+*    new digest value
+*********************************************************************/
+static uint64
+    digest_uint64 (uint64 hash,
+                   uint64 num)
+{
+    return digest_bytes(hash, &num, sizeof(num));
+
+}  /* digest_uint64 */
+
+
+/********************************************************************
+* FUNCTION digest_string
+* 
+* Add a string and a terminator to a running subtree digest,
+* so adjacent strings cannot run together
+*
+* INPUTS:
+*    hash == digest so far
+*    str == string to add
+*
+* RETURNS:
+*    new digest value
+*********************************************************************/
+static uint64
+    digest_string (uint64 hash,
+                   const xmlChar *str)
+{
+    hash = digest_bytes(hash, str, xml_strlen(str));
+    hash ^= 0xff;
+    hash *= VAL_DIGEST_PRIME;
+    return hash;
+
+}  /* digest_string */
+
+
+/********************************************************************
+* FUNCTION digest_num
+* 
+* Add a number value to a running subtree digest
+*
+* INPUTS:
+*    hash == digest so far
+*    num == number to add
+*    btyp == base type of the number
+*
+* RETURNS:
+*    new digest value
+*********************************************************************/
+static uint64
+    digest_num (uint64 hash,
+                const ncx_num_t *num,
+                ncx_btype_t btyp)
+{
+    switch (btyp) {
+    case NCX_BT_INT8:
+    case NCX_BT_INT16:
+    case NCX_BT_INT32:
+        return digest_uint64(hash, (uint64)(int64)num->i);
+    case NCX_BT_INT64:
+        return digest_uint64(hash, (uint64)num->l);
+    case NCX_BT_UINT8:
+    case NCX_BT_UINT16:
+    case NCX_BT_UINT32:
+        return digest_uint64(hash, (uint64)num->u);
+    case NCX_BT_UINT64:
+        return digest_uint64(hash, num->ul);
+    case NCX_BT_DECIMAL64:
+        hash = digest_uint64(hash, (uint64)num->dec.val);
+        return digest_uint64(hash, (uint64)num->dec.digits);
+    case NCX_BT_FLOAT64:
+        return digest_bytes(hash, &num->d, sizeof(num->d));
+    default:
+        return digest_uint64(hash, num->ul);
+    }
+
+}  /* digest_num */
+
+
+/********************************************************************
+* FUNCTION digest_simval
+* 
+* Add the value of a simple node to a running subtree digest
+* Only the fields that val_compare checks are used
+*
+* INPUTS:
+*    val == simple value node
+*    hash == address of digest so far
+*
+* OUTPUTS:
+*    *hash is updated if TRUE is returned
+*
+* RETURNS:
+*    TRUE if done; FALSE if the value cannot be hashed
+*********************************************************************/
+static boolean
+    digest_simval (const val_value_t *val,
+                   uint64 *hash)
+{
+    const ncx_lmem_t *lmem;
+    uint64            h = digest_uint64(*hash, (uint64)val->btyp);
+
+    switch (val->btyp) {
+    case NCX_BT_EMPTY:
+    case NCX_BT_BOOLEAN:
+        h = digest_uint64(h, val->v.boo ? 1 : 0);
+        break;
+    case NCX_BT_ENUM:
+        h = digest_uint64(h, (uint64)(int64)VAL_ENUM(val));
+        break;
+    case NCX_BT_INT8:
+    case NCX_BT_INT16:
+    case NCX_BT_INT32:
+    case NCX_BT_INT64:
+    case NCX_BT_UINT8:
+    case NCX_BT_UINT16:
+    case NCX_BT_UINT32:
+    case NCX_BT_UINT64:
+    case NCX_BT_DECIMAL64:
+    case NCX_BT_FLOAT64:
+        h = digest_num(h, &val->v.num, val->btyp);
+        break;
+    case NCX_BT_BINARY:
+        /* val_compare never treats an empty binary as equal */
+        if (val->v.binary.ustr == NULL) {
+            return FALSE;
+        }
+        h = digest_uint64(h, val->v.binary.ustrlen);
+        h = digest_bytes(h, val->v.binary.ustr, val->v.binary.ustrlen);
+        break;
+    case NCX_BT_STRING:
+    case NCX_BT_INSTANCE_ID:
+    case NCX_BT_LEAFREF:
+        if (val->v.str == NULL) {
+            return FALSE;
+        }
+        h = digest_string(h, val->v.str);
+        break;
+    case NCX_BT_SLIST:
+    case NCX_BT_BITS:
+        for (lmem = (const ncx_lmem_t *)dlq_firstEntry(&val->v.list.memQ);
+             lmem != NULL;
+             lmem = (const ncx_lmem_t *)dlq_nextEntry(lmem)) {
+            if (typ_is_string(val->v.list.btyp)) {
+                if (lmem->val.str == NULL) {
+                    return FALSE;
+                }
+                h = digest_string(h, lmem->val.str);
+            } else if (typ_is_number(val->v.list.btyp)) {
+                h = digest_num(h, &lmem->val.num, val->v.list.btyp);
+            } else if (val->v.list.btyp == NCX_BT_BITS) {
+                h = digest_uint64(h, lmem->val.bit.pos);
+            } else if (val->v.list.btyp == NCX_BT_ENUM &&
+                       lmem->val.enu.name) {
+                h = digest_string(h, lmem->val.enu.name);
+            } else {
+                return FALSE;
+            }
+        }
+        break;
+    case NCX_BT_IDREF:
+        if (val->v.idref.name == NULL) {
+            return FALSE;
+        }
+        h = digest_uint64(h, val->v.idref.nsid);
+        h = digest_string(h, val->v.idref.name);
+        break;
+    default:
+        return FALSE;
+    }
+
+    *hash = h;
+    return TRUE;
+
+}  /* digest_simval */
+
+
+/********************************************************************
+* FUNCTION digest_ok
+* 
+* Check if a value node can have a subtree digest;
+* val_compare does not treat nodes as equal just by content
+* if they are virtual or have an explicit nc:operation
+*
+* INPUTS:
+*    val == value node to check
+*
+* RETURNS:
+*    TRUE if the node can be hashed
+*********************************************************************/
+static boolean
+    digest_ok (const val_value_t *val)
+{
+    if (VAL_GETCB(val)) {
+        return FALSE;
+    }
+    if (val->editvars && val->editvars->operset) {
+        return FALSE;
+    }
+    return TRUE;
+
+}  /* digest_ok */
+
+
+/*************** E X T E R N A L    F U N C T I O N S  *************/
+
+
+/********************************************************************
+* FUNCTION val_new_value
+* 
+* Malloc and initialize the fields in a val_value_t
+*
+* RETURNS:
+*   pointer to the malloced and initialized struct or NULL if an error
+*********************************************************************/
+val_value_t * 
+    val_new_value (void)
+{
+    return val_new_arena_value(NULL);
+
+}  /* val_new_value */
+
+
+/********************************************************************
+* FUNCTION val_new_arena_value
+* 
+* Get a val_value_t from an arena and initialize the fields
+* The struct is only reclaimed when the arena is cleaned,
+* so the node must not be linked into any tree that outlives
+* the arena; see val_clone_arena_value
+*
+* INPUTS:
+*   arena == arena to allocate from, or NULL to use malloc
+*
+* RETURNS:
+*   pointer to the initialized struct or NULL if an error
+*********************************************************************/
+val_value_t * 
+    val_new_arena_value (ncx_arena_t *arena)
+{
+    val_value_t *val;
+
+    if (arena) {
+        val = (val_value_t *)ncx_arena_alloc(arena, sizeof(val_value_t));
+    } else {
+        val = m__getObj(val_value_t);
+    }
+    if (!val) {
+        return NULL;
+    }
+
+    (void)memset(val, 0x0, sizeof(val_value_t));
+    dlq_createSQue(&val->indexQ);
+    if (arena) {
+        val->flags |= VAL_FL_ARENA;
+    }
+
+    return val;
+
+}  /* val_new_arena_value */
+
+
+/********************************************************************
+* FUNCTION val_begin_sibset_pass
+* 
+* Start an edit or validation pass that uses sibling sets
+* While a pass is active, each record in a child index keeps
+* a transient set of its instances: a hash of the leaf-list
+* values, for val_first_child_match, and the last instance,
+* so val_add_child_sorted can append a list or leaf-list
+* entry without checking every sibling.
+*
+* Passes can be nested; the sets are freed when
+* the outermost pass ends
+*********************************************************************/
+void
+    val_begin_sibset_pass (void)
+{
+    if (!sibsetQ_init) {
+        dlq_createSQue(&sibsetQ);
+        sibsetQ_init = TRUE;
+    }
+    sibset_passcnt++;
+
+}  /* val_begin_sibset_pass */
+
+
+/********************************************************************
+* FUNCTION val_end_sibset_pass
+* 
+* End a pass started with val_begin_sibset_pass
+* The sibling sets built during the pass are freed
+* when the outermost pass ends
+*********************************************************************/
+void
+    val_end_sibset_pass (void)
+{
+    val_sibset_t *set;
+
+    if (sibset_passcnt == 0) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return;
+    }
+    if (--sibset_passcnt) {
+        return;
+    }
+
+    while (!dlq_empty(&sibsetQ)) {
+        set = (val_sibset_t *)dlq_firstEntry(&sibsetQ);
+        sibset_free(set->rec);
+    }
+
+}  /* val_end_sibset_pass */
+
+
+/********************************************************************
+* FUNCTION val_get_extra
+* 
+* Get the block of rarely used fields for a value node,
+* and malloc it if it is not there yet
+*
+* INPUTS:
+*   val == value node to use
+*
+* RETURNS:
+*   pointer to val->extra, or NULL if a malloc error
+*********************************************************************/
+val_extra_t *
+    val_get_extra (val_value_t *val)
+{
+    val_extra_t *extra;
+
+#ifdef DEBUG
+    if (!val) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return NULL;
+    }
+#endif
+
+    if (val->extra) {
+        return val->extra;
     }
 
-    if (*res != NO_ERR) {
-        val_free_value(copy);
-        copy = NULL;
+    extra = m__getObj(val_extra_t);
+    if (!extra) {
+        return NULL;
     }
+    (void)memset(extra, 0x0, sizeof(val_extra_t));
+    dlq_createSQue(&extra->metaQ);
+    val->extra = extra;
+    return extra;
 
-    return copy;
+}  /* val_get_extra */
 
-}  /* clone_test */
 
+/********************************************************************
+* FUNCTION val_get_casobj
+* 
+* Get the case object for a value node that is part of a choice
+* If set, the object path for this node is really:
+*    $this --> casobj --> casobj.parent --> $this.parent
+* the OBJ_TYP_CASE and OBJ_TYP_CHOICE nodes are skipped
+* inside an XML instance document
+*
+* INPUTS:
+*   val == value node to check
+*
+* RETURNS:
+*   case object template, or NULL if val is not in a choice
+*********************************************************************/
+obj_template_t *
+    val_get_casobj (const val_value_t *val)
+{
+    if (val->obj && val->obj->parent &&
+        val->obj->parent->objtype == OBJ_TYP_CASE) {
+        return val->obj->parent;
+    }
+    return NULL;
 
-/*************** E X T E R N A L    F U N C T I O N S  *************/
+}  /* val_get_casobj */
 
 
 /********************************************************************
-* FUNCTION val_new_value
+* FUNCTION val_set_xpathpcb
 * 
-* Malloc and initialize the fields in a val_value_t
+* Replace the XPath control block of a value node
+* Any old control block is freed
+*
+* INPUTS:
+*   val == value node to change
+*   pcb == malloced XPath control block to store in val;
+*          freed here if an error is returned
 *
 * RETURNS:
-*   pointer to the malloced and initialized struct or NULL if an error
+*   status
 *********************************************************************/
-val_value_t * 
-    val_new_value (void)
+status_t
+    val_set_xpathpcb (val_value_t *val,
+                      struct xpath_pcb_t_ *pcb)
 {
-    val_value_t *val = m__getObj(val_value_t);
+    val_extra_t *extra;
+
+#ifdef DEBUG
     if (!val) {
-        return NULL;
+        return SET_ERROR(ERR_INTERNAL_PTR);
     }
+#endif
 
-    (void)memset(val, 0x0, sizeof(val_value_t));
-    dlq_createSQue(&val->metaQ);
-    dlq_createSQue(&val->indexQ);
+    extra = val_get_extra(val);
+    if (!extra) {
+        if (pcb) {
+            xpath_free_pcb(pcb);
+        }
+        return ERR_INTERNAL_MEM;
+    }
 
-    return val;
+    if (extra->xpathpcb) {
+        xpath_free_pcb(extra->xpathpcb);
+    }
+    extra->xpathpcb = pcb;
+    return NO_ERR;
 
-}  /* val_new_value */
+}  /* val_set_xpathpcb */
 
 
 /********************************************************************
@@ -1584,6 +3875,7 @@ void
 
     val->btyp = btyp;
     dlq_createSQue(&val->v.childQ);
+    val->v.digest = 0;
 
 }  /* val_init_complex */
 
@@ -1613,7 +3905,11 @@ void
 #endif
 
     val_init_from_template(val, obj);
-    val->getcb = cbfn;
+    if (val_get_extra(val) == NULL) {
+        SET_ERROR(ERR_INTERNAL_MEM);
+        return;
+    }
+    val->extra->getcb = cbfn;
 
 }  /* val_init_virtual */
 
@@ -1665,12 +3961,16 @@ void val_free_value (val_value_t *val)
 #ifdef VAL_FREE_DEBUG
     if (LOGDEBUG4) {
         log_debug4("\nval_free_value '%s' %p", 
-                   val->dname ? val->dname : NCX_EL_NONE, val);
+                   VAL_DNAME(val) ? VAL_DNAME(val) : NCX_EL_NONE, val);
     }
 #endif
 
     clean_value(val, TRUE);
-    if(val->dname)
+    if (val->flags & VAL_FL_ARENA) {
+        ncx_arena_release(val);
+        return;
+    }
+    if(VAL_DNAME(val))
     {
 	m__free(val);
 	val = NULL;
@@ -1706,15 +4006,14 @@ void
         return;
     }
 
-    /* replace the name field */
-    if (val->dname) {
-        m__free(val->dname);
+    /* the parent child index is keyed by the old name */
+    if (val->parent && VAL_CHINDEX(val->parent)) {
+        val_clear_child_index(val->parent);
     }
-    val->dname = xml_strndup(name, namelen);
-    if (!val->dname) {
-        SET_ERROR(ERR_INTERNAL_MEM);
-    } 
-    val->name = val->dname;
+    val_clear_digest(val->parent);
+
+    /* replace the name field */
+    set_dname(val, name, namelen);
 
 }  /* val_set_name */
 
@@ -1746,12 +4045,15 @@ status_t
     }
 #endif
 
-    if (val->dname == NULL) {
-        val->dname = xml_strdup(val->name);
-        if (val->dname == NULL) {
+    if (VAL_DNAME(val) == NULL) {
+        if (val_get_extra(val) == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        val->extra->dname = xml_strdup(val->name);
+        if (val->extra->dname == NULL) {
             return ERR_INTERNAL_MEM;
         }
-        val->name = val->dname;
+        val->name = val->extra->dname;
     }
 
     for (chval = val_get_first_child(val);
@@ -1791,6 +4093,12 @@ void
     }
 #endif
 
+    /* the parent child index is keyed by the old QName */
+    if (val->parent && VAL_CHINDEX(val->parent)) {
+        val_clear_child_index(val->parent);
+    }
+    val_clear_digest(val->parent);
+
     val->nsid = nsid;
 
     /* check no change to name */
@@ -1800,14 +4108,7 @@ void
     }
 
     /* replace the name field */
-    if (val->dname) {
-        m__free(val->dname);
-    }
-    val->dname = xml_strndup(name, namelen);
-    if (!val->dname) {
-        SET_ERROR(ERR_INTERNAL_MEM);
-    } 
-    val->name = val->dname;
+    set_dname(val, name, namelen);
 
 }  /* val_set_qname */
 
@@ -3260,14 +5561,14 @@ dlq_hdr_t *
     }
 #endif
 
-    if (val->getcb) {
+    if (val->extra == NULL || val->extra->getcb) {
         /* the virtual value will not have any attributes
          * present; only the PDU value nodes will have
          * any XML attributes present
          */
         return NULL;
     } else {
-        return &val->metaQ;
+        return &val->extra->metaQ;
     }
 
 }  /* val_get_metaQ */
@@ -3322,7 +5623,10 @@ val_value_t *
     }
 #endif
 
-    return (val_value_t *)dlq_firstEntry(&val->metaQ);
+    if (val->extra == NULL) {
+        return NULL;
+    }
+    return (val_value_t *)dlq_firstEntry(&val->extra->metaQ);
 
 }  /* val_get_first_meta_val */
 
@@ -3377,13 +5681,13 @@ boolean
     }
 #endif
 
-    if (val->getcb) {
+    if (val->extra == NULL || val->extra->getcb) {
         /* only the real values (not virtual values) will
          * have any XML attributes present
          */
         return TRUE;
     } else {
-        return dlq_empty(&val->metaQ);
+        return dlq_empty(&val->extra->metaQ);
     }
 
 }  /* val_meta_empty */
@@ -3416,7 +5720,7 @@ val_value_t *
     }
 #endif
         
-    for (metaval = (val_value_t *)dlq_firstEntry(&val->metaQ);
+    for (metaval = val_get_first_meta_val(val);
          metaval != NULL;
          metaval = (val_value_t *)dlq_nextEntry(metaval)) {
 
@@ -3526,7 +5830,7 @@ uint32
 
     cnt = 0;
 
-    for (metaval = (val_value_t *)dlq_firstEntry(&val->metaQ);
+    for (metaval = val_get_first_meta_val(val);
          metaval != NULL;
          metaval = (val_value_t *)dlq_nextEntry(metaval)) {
         if (xml_strcmp(metaval->name, name)) {
@@ -4243,6 +6547,8 @@ status_t
     }
 #endif
 
+    val_clear_digest(val);
+
     if (typdef) {
         val->typdef = typdef;
         val->btyp = typ_get_basetype(typdef);
@@ -4256,15 +6562,13 @@ status_t
     case NCX_BT_STRING:
     case NCX_BT_INSTANCE_ID:
         if (valname && !val->name) {
-            if (val->dname) {
+            if (VAL_DNAME(val)) {
                 SET_ERROR(ERR_INTERNAL_VAL);
-                m__free(val->dname);
             }
-            val->dname = xml_strdup(valname);
-            if (!val->dname) {
+            set_dname(val, valname, xml_strlen(valname));
+            if (!val->name) {
                 return ERR_INTERNAL_MEM;
             }
-            val->name = val->dname;
         }
 
         if (valstr) {
@@ -4457,6 +6761,8 @@ status_t
         startsimple = TRUE;
     }
 
+    val_clear_digest(val);
+
     /* clean the old value even if it was ANY */
     clean_value(val, FALSE);
 
@@ -4482,11 +6788,10 @@ status_t
 
     /* only set name if it is not already set */
     if (!val->name && valname) {
-        val->dname = xml_strndup(valname, valnamelen);
-        if (!val->dname) {
+        set_dname(val, valname, valnamelen);
+        if (!val->name) {
             return ERR_INTERNAL_MEM;
         }
-        val->name = val->dname;
     }
 
     /* set the object to the generic string if not set */
@@ -4613,10 +6918,9 @@ status_t
                                                    objroot, 
                                                    xpathpcb);
                     }
-                    if (val->xpathpcb) {
-                        xpath_free_pcb(val->xpathpcb);
+                    if (val_set_xpathpcb(val, xpathpcb) != NO_ERR) {
+                        res = ERR_INTERNAL_MEM;
                     }
-                    val->xpathpcb = xpathpcb;
                 }
             }
             break;
@@ -4649,10 +6953,9 @@ status_t
                                                    ? FALSE : TRUE,
                                                    &leafobj);
                 }
-                if (val->xpathpcb) {
-                    xpath_free_pcb(val->xpathpcb);
+                if (val_set_xpathpcb(val, xpathpcb) != NO_ERR) {
+                    res = ERR_INTERNAL_MEM;
                 }
-                val->xpathpcb = xpathpcb;
             }
         }
         break;
@@ -4858,6 +7161,8 @@ status_t
     ncx_btype_t btyp = dest->btyp;
     ncx_iqual_t iqual = typ_get_iqualval_def(dest->typdef);
 
+    val_clear_digest(dest);
+
     /* the mergetype is only set to NCX_MERGE_SORT for type bits
      * it is NCX_MERGE_NONE for all other data types
      * the value NCX_MERGE_FIRST is never used
@@ -5016,6 +7321,43 @@ val_value_t *
 }  /* val_clone2 */
 
 
+/********************************************************************
+* FUNCTION val_clone_arena_value
+* 
+* Clone a val_value_t struct and sub-trees that were parsed
+* into an arena, so the clone can be linked into a tree
+* that outlives the arena.  The editvars and the edit operation
+* of every node are kept, so the clone can take the place of
+* val in an edit in progress
+*
+* INPUTS:
+*    val == value to clone
+*
+* RETURNS:
+*   malloced clone of val, or NULL if a malloc failure
+*********************************************************************/
+val_value_t *
+    val_clone_arena_value (const val_value_t *val)
+{
+    val_value_t *copy;
+    status_t     res;
+
+#ifdef DEBUG
+    if (!val) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return NULL;
+    }
+#endif
+
+    copy = clone_test(val, NULL, TRUE, &res);
+    if (copy) {
+        copy_editops(val, copy);
+    }
+    return copy;
+
+}  /* val_clone_arena_value */
+
+
 /********************************************************************
 * FUNCTION val_clone_config_data
 * 
@@ -5084,6 +7426,7 @@ status_t
 #endif
 
     res = NO_ERR;
+    val_clear_digest(copy);
 
     if (val->btyp == NCX_BT_EXTERN) {
         clean_value(copy, TRUE);
@@ -5208,6 +7551,8 @@ status_t
 *
 *   Add a meta value node to a parent value node
 *   Simply makes a new last meta!!!
+*   The meta node is freed if the parent val->extra
+*   cannot be malloced
 *
 * INPUTS:
 *    child == node to store in the parent
@@ -5224,7 +7569,12 @@ void
         return;
     }
 #endif
-    dlq_enque(meta, &parent->metaQ);
+    if (val_get_extra(parent) == NULL) {
+        SET_ERROR(ERR_INTERNAL_MEM);
+        val_free_value(meta);
+        return;
+    }
+    dlq_enque(meta, &parent->extra->metaQ);
 
 }   /* val_add_meta */
 
@@ -5256,35 +7606,43 @@ void
 
     child->parent = parent;
     dlq_enque(child, &parent->v.childQ);
+    if (VAL_CHINDEX(parent)) {
+        chindex_add(parent, child);
+    }
+    val_clear_digest(parent);
 
 }   /* val_add_child */
 
 
 /********************************************************************
-* FUNCTION val_add_child_sorted
+* FUNCTION insert_child_sorted
 * 
-*   Add a child value node to a parent value node
-*   in the proper place
+*   Link a child value node into the parent childQ
+*   in the proper place; the child index is not updated
 *
 * INPUTS:
 *    child == node to store in the parent
 *    parent == complex value node with a childQ
 *
+* RETURNS:
+*    number of sibling nodes checked
 *********************************************************************/
-void
-    val_add_child_sorted (val_value_t *child,
-                          val_value_t *parent)
+static uint32
+    insert_child_sorted (val_value_t *child,
+                         val_value_t *parent)
 {
     assert( child && "child is NULL!" );
     assert( parent && "parent is NULL!" );
 
+    uint32 scancnt = 0;
+
     child->parent = parent;
     dlq_hdr_t *childQ = &parent->v.childQ;
 
     /* check new first entry */
     if (dlq_empty(childQ)) {
         dlq_enque(child, childQ);
-        return;
+        return scancnt;
     }
 
     val_value_t *curval = NULL;
@@ -5307,6 +7665,8 @@ void
              curval != NULL;
              curval = val_get_next_child(curval)) {
 
+            scancnt++;
+
             /* check same type of sibling cornercase
              * should only happen if the child is
              * type list or leaf-list
@@ -5317,6 +7677,7 @@ void
                 boolean done = FALSE;
 
                 while (!done) {
+                    scancnt++;
                     if (sysorder && syssorted) {
                         if (newobj->objtype == OBJ_TYP_LIST) {
                             ret = val_index_compare(child, curval);
@@ -5325,7 +7686,7 @@ void
                         }
                         if (ret < 0) {
                             dlq_insertAhead(child, curval);
-                            return;
+                            return scancnt;
                         }
                     }
                     val_value_t *nextchild = val_get_next_child(curval);
@@ -5336,19 +7697,19 @@ void
                     }
                 }
                 dlq_insertAfter(child, curval);
-                return;
+                return scancnt;
             }
 
             ret = xml_strcmp(child->name, curval->name);
             if (ret < 0) {
                 dlq_insertAhead(child, curval);
-                return;
+                return scancnt;
             } else if (ret == 0) {
                 ret = xml_strcmp(val_get_mod_name(child),
                                  val_get_mod_name(curval));
                 if (ret < 0) {
                     dlq_insertAhead(child, curval);
-                    return;
+                    return scancnt;
                     /* same name, insert in module alphabetical order */
                 }
             }
@@ -5380,6 +7741,8 @@ void
              curval != NULL;
              curval = val_get_next_child(curval)) {
 
+            scancnt++;
+
             /* check same type of sibling cornercase
              * should only happen if the child is
              * type list or leaf-list
@@ -5390,6 +7753,7 @@ void
                 boolean done = FALSE;
 
                 while (!done) {
+                    scancnt++;
                     if (sysorder && syssorted) {
                         if (newobj->objtype == OBJ_TYP_LIST) {
                             ret = val_index_compare(child, curval);
@@ -5398,7 +7762,7 @@ void
                         }
                         if (ret < 0) {
                             dlq_insertAhead(child, curval);
-                            return;
+                            return scancnt;
                         }
                     }
 
@@ -5412,7 +7776,7 @@ void
 
                 /* make a new last instance of this node type */
                 dlq_insertAfter(child, curval);
-                return;
+                return scancnt;
             }
 
             /* simple test; since native children
@@ -5422,7 +7786,7 @@ void
              */
             if (val_get_nsid(curval) != parentid && childid == parentid) {
                 dlq_insertAhead(child, curval);
-                return;
+                return scancnt;
             }
 
             /* new node and current node are different so
@@ -5440,7 +7804,7 @@ void
                      * which occurs after it in schema order
                      */
                     dlq_insertAhead(child, curval);
-                    return;
+                    return scancnt;
                 }
             }
         }
@@ -5449,6 +7813,168 @@ void
         dlq_enque(child, childQ);
     }
 
+    return scancnt;
+
+}   /* insert_child_sorted */
+
+
+/********************************************************************
+* FUNCTION add_list_entry_sorted
+* 
+*   Add a system-ordered list entry, or leaf-list entry during
+*   a sibling set pass, to a parent value node with a binary
+*   search of the child index key tree, instead of checking
+*   every sibling entry
+*
+* INPUTS:
+*    child == list or leaf-list entry to store in the parent
+*    parent == complex value node with a childQ
+*
+* RETURNS:
+*    TRUE if the entry was added
+*    FALSE if the key tree cannot be used; nothing done
+*********************************************************************/
+static boolean
+    add_list_entry_sorted (val_value_t *child,
+                           val_value_t *parent)
+{
+    val_chrec_t   *rec;
+    val_keynode_t *node;
+    status_t       res;
+
+    if (VAL_CHINDEX(parent) == NULL || child->name == NULL ||
+        child->obj == NULL || parent->obj == NULL ||
+        parent->obj->objtype == OBJ_TYP_ANYXML ||
+        !obj_is_system_ordered(child->obj) || !ncx_get_system_sorted()) {
+        return FALSE;
+    }
+    if (child->btyp != NCX_BT_LIST &&
+        child->obj->objtype != OBJ_TYP_LEAF_LIST) {
+        return FALSE;
+    }
+
+    rec = chindex_find_rec(VAL_CHINDEX(parent), child->nsid, child->name,
+                           chindex_hash(child->name));
+    if (rec == NULL || rec->first->obj != child->obj ||
+        !key_entry_ok(child)) {
+        return FALSE;
+    }
+    if (child->btyp != NCX_BT_LIST && sibset_get(rec) == NULL) {
+        /* a leaf-list key tree is freed with the sibling set */
+        return FALSE;
+    }
+    if (!keytree_build(rec) || !rec->keysorted) {
+        return FALSE;
+    }
+
+    /* insert ahead of the first entry with a higher key */
+    node = keytree_bound(rec, child, TRUE, &res);
+    if (res != NO_ERR) {
+        return FALSE;
+    }
+
+    child->parent = parent;
+    if (node) {
+        dlq_insertAhead(child, node->val);
+    } else {
+        for (node = rec->keyroot; node->right != NULL; node = node->right) {
+            ;
+        }
+        dlq_insertAfter(child, node->val);
+    }
+    chindex_add(parent, child);
+    return TRUE;
+
+}   /* add_list_entry_sorted */
+
+
+/********************************************************************
+* FUNCTION add_entry_last
+* 
+*   Add a list or leaf-list entry after the last instance
+*   of the same child node, found in the sibling set of the
+*   child index, instead of checking every sibling entry
+*
+* INPUTS:
+*    child == list or leaf-list entry to store in the parent
+*    parent == complex value node with a childQ
+*
+* RETURNS:
+*    TRUE if the entry was added
+*    FALSE if the sibling set cannot be used; nothing done
+*********************************************************************/
+static boolean
+    add_entry_last (val_value_t *child,
+                    val_value_t *parent)
+{
+    val_chrec_t  *rec;
+    val_sibset_t *set;
+
+    if (sibset_passcnt == 0 || VAL_CHINDEX(parent) == NULL ||
+        child->name == NULL || child->obj == NULL ||
+        parent->obj == NULL || parent->obj->objtype == OBJ_TYP_ANYXML) {
+        return FALSE;
+    }
+    if (child->obj->objtype != OBJ_TYP_LIST &&
+        child->obj->objtype != OBJ_TYP_LEAF_LIST) {
+        return FALSE;
+    }
+    if (obj_is_system_ordered(child->obj) && ncx_get_system_sorted()) {
+        /* goes in sorted order, not last */
+        return FALSE;
+    }
+
+    rec = chindex_find_rec(VAL_CHINDEX(parent), child->nsid, child->name,
+                           chindex_hash(child->name));
+    if (rec == NULL || rec->first->obj != child->obj) {
+        return FALSE;
+    }
+    set = sibset_get(rec);
+    if (set == NULL || !set->contig) {
+        return FALSE;
+    }
+
+    child->parent = parent;
+    dlq_insertAfter(child, set->last);
+    chindex_add(parent, child);
+    return TRUE;
+
+}   /* add_entry_last */
+
+
+/********************************************************************
+* FUNCTION val_add_child_sorted
+* 
+*   Add a child value node to a parent value node
+*   in the proper place
+*
+* INPUTS:
+*    child == node to store in the parent
+*    parent == complex value node with a childQ
+*
+*********************************************************************/
+void
+    val_add_child_sorted (val_value_t *child,
+                          val_value_t *parent)
+{
+    assert( child && "child is NULL!" );
+    assert( parent && "parent is NULL!" );
+
+    uint32 scancnt;
+
+    val_clear_digest(parent);
+    if (add_list_entry_sorted(child, parent) ||
+        add_entry_last(child, parent)) {
+        return;
+    }
+
+    scancnt = insert_child_sorted(child, parent);
+    if (VAL_CHINDEX(parent)) {
+        chindex_add(parent, child);
+    } else {
+        chindex_check_build(parent, scancnt);
+    }
+
 }   /* val_add_child_sorted */
 
 
@@ -5479,6 +8005,10 @@ void
     child->parent = parent;
     if (current) {
         dlq_insertAfter(child, current);
+        if (VAL_CHINDEX(parent)) {
+            chindex_add(parent, child);
+        }
+        val_clear_digest(parent);
     } else {
         val_add_child_sorted(child, parent);
     }
@@ -5486,6 +8016,36 @@ void
 }   /* val_insert_child */
 
 
+/********************************************************************
+* FUNCTION val_insert_child_before
+* 
+*   Insert a child value node ahead of a current child node
+*
+* INPUTS:
+*    child == node to store in the parent
+*    current == current child node to insert ahead of
+*    parent == complex value node with a childQ
+*
+*********************************************************************/
+void
+    val_insert_child_before (val_value_t *child,
+                             val_value_t *current,
+                             val_value_t *parent)
+{
+    assert( child && "child is NULL!" );
+    assert( current && "current is NULL!" );
+    assert( parent && "parent is NULL!" );
+
+    child->parent = parent;
+    dlq_insertAhead(child, current);
+    if (VAL_CHINDEX(parent)) {
+        chindex_add(parent, child);
+    }
+    val_clear_digest(parent);
+
+}   /* val_insert_child_before */
+
+
 /********************************************************************
 * FUNCTION val_remove_child
 * 
@@ -5505,6 +8065,10 @@ void
     }
 #endif
 
+    if (child->parent && VAL_CHINDEX(child->parent)) {
+        chindex_remove(child->parent, child);
+    }
+    val_clear_digest(child->parent);
     dlq_remove(child);
     child->parent = NULL;
 
@@ -5532,14 +8096,74 @@ void
     }
 #endif
 
-    newchild->parent = curchild->parent;
-    newchild->getcb = curchild->getcb;
+    val_value_t *parent = curchild->parent;
+
+    newchild->parent = parent;
+    if (VAL_GETCB(curchild)) {
+        if (val_get_extra(newchild) == NULL) {
+            SET_ERROR(ERR_INTERNAL_MEM);
+        } else {
+            newchild->extra->getcb = curchild->extra->getcb;
+        }
+    } else if (newchild->extra) {
+        newchild->extra->getcb = NULL;
+    }
+
+    if (parent && VAL_CHINDEX(parent)) {
+        chindex_remove(parent, curchild);
+    }
+
+    dlq_swap(newchild, curchild);
+
+    if (parent && VAL_CHINDEX(parent)) {
+        chindex_add(parent, newchild);
+    }
+    val_clear_digest(parent);
+
+    curchild->parent = NULL;
+
+}   /* val_swap_child */
+
+
+/********************************************************************
+* FUNCTION val_clear_child_index
+* 
+*   Discard the hashed child index of a complex value node
+*   Must be called before the childQ is changed directly
+*   with dlq functions instead of the val_add_child family;
+*   the index is rebuilt on demand by the next child search
+*
+* INPUTS:
+*    val == value node to clear the child index from
+*
+*********************************************************************/
+void
+    val_clear_child_index (val_value_t *val)
+{
+    val_chindex_t *chindex;
+    val_chrec_t   *rec, *nextrec;
+    uint32         i;
+
+    assert( val && "val is NULL!" );
 
-    dlq_swap(newchild, curchild);
+    chindex = VAL_CHINDEX(val);
+    if (chindex == NULL) {
+        return;
+    }
+    val->extra->chindex = NULL;
 
-    curchild->parent = NULL;
+    for (i = 0; i < chindex->numbuckets; i++) {
+        for (rec = chindex->buckets[i]; rec != NULL; rec = nextrec) {
+            nextrec = rec->next;
+            keytree_free(rec);
+            sibset_free(rec);
+            m__free(rec);
+        }
+    }
+    m__free(chindex->buckets);
+    m__free(chindex);
 
-}   /* val_swap_child */
+}   /* val_clear_child_index */
 
 
 /********************************************************************
@@ -5558,7 +8182,9 @@ val_value_t *
     val_first_child_match (val_value_t  *parent,
                            val_value_t *child)
 {
-    val_value_t *val;
+    val_value_t *val, *retval;
+    val_chrec_t *rec;
+    uint32       seen, scancnt;
 
 #ifdef DEBUG
     if (!parent || !child) {
@@ -5571,44 +8197,55 @@ val_value_t *
         return NULL;
     }
 
+    if (VAL_CHINDEX(parent) &&
+        chindex_lookup(VAL_CHINDEX(parent), CHINDEX_NS_EXACT, NULL,
+                       child->nsid, child->name, &rec)) {
+        if (rec == NULL) {
+            return NULL;
+        }
+        if (child->btyp == NCX_BT_LIST &&
+            keytree_find(rec, child, &retval)) {
+            return retval;
+        }
+        if (sibset_find(rec, child, &retval)) {
+            return retval;
+        }
+        for (val = rec->first, seen = 0;
+             val != NULL && seen < rec->count;
+             val = (val_value_t *)dlq_nextEntry(val)) {
+            if (!chrec_match(rec, val)) {
+                continue;
+            }
+            seen++;
+            if (!VAL_IS_DELETED(val) && child_match_ok(val, child)) {
+                return val;
+            }
+        }
+        return NULL;
+    }
+
+    retval = NULL;
+    scancnt = 0;
     for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
 
+        scancnt++;
         if (VAL_IS_DELETED(val)) {
             continue;
         }
 
         /* check the node if the QName matches */
         if (val->nsid == child->nsid &&
-            !xml_strcmp(val->name, child->name)) {
-
-            if (val->btyp == NCX_BT_LIST) {
-                /* match the instance identifiers, if any */
-                if (val_index_match(child, val)) {
-                    return val;
-                }
-            } else if (val->obj->objtype == OBJ_TYP_LEAF_LIST) {
-                if (val->btyp == child->btyp) {
-                    /* find the leaf-list with the same value */
-                    if (!val_compare(val, child)) {
-                        return val;
-                    }
-                } else {
-                    /* match any value; if this is a subtree
-                     * filter test, it is not for a content match
-                     * node
-                     */
-                    return val;
-                }
-            } else {
-                /* can only be this one instance */
-                return val;
-            }
+            !xml_strcmp(val->name, child->name) &&
+            child_match_ok(val, child)) {
+            retval = val;
+            break;
         }
     }
 
-    return NULL;
+    chindex_check_build(parent, scancnt);
+    return retval;
 
 }  /* val_first_child_match */
 
@@ -5686,6 +8323,109 @@ val_value_t *
 }  /* val_next_child_match */
 
 
+/********************************************************************
+* FUNCTION val_find_list_entry
+*
+* Find the list entry with the same keys as a search entry,
+* using the key tree in the child index of the parent
+*
+* INPUTS:
+*    parent == parent value to check
+*    modname == module name of the list entries to find
+*            == NULL to match any module; the list name
+*               then has to be unique within the parent
+*    child == list entry with a complete index chain,
+*             holding the key values to find
+*    retval == address of return list entry
+*
+* OUTPUTS:
+*    *retval == the only live list entry with the same keys,
+*               or NULL if there is none
+*
+* RETURNS:
+*    TRUE if the key tree answered the search
+*    FALSE if the caller has to check the instances in order
+*      (parent too small to index, incomplete or duplicate keys)
+*********************************************************************/
+boolean
+    val_find_list_entry (val_value_t *parent,
+                         const xmlChar *modname,
+                         val_value_t *child,
+                         val_value_t **retval)
+{
+    val_value_t   *val, *found;
+    val_chrec_t   *rec;
+    val_keynode_t *node;
+    status_t       res;
+    uint32         scancnt;
+
+#ifdef DEBUG
+    if (!parent || !child || !retval) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return FALSE;
+    }
+#endif
+
+    if (!typ_has_children(parent->btyp) || val_is_virtual(parent) ||
+        child->btyp != NCX_BT_LIST) {
+        return FALSE;
+    }
+
+    if (VAL_CHINDEX(parent) == NULL) {
+        /* a parent with few children is cheaper to scan */
+        scancnt = 0;
+        for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
+             val != NULL && scancnt < VAL_CHILD_INDEX_MIN;
+             val = (val_value_t *)dlq_nextEntry(val)) {
+            scancnt++;
+        }
+        chindex_check_build(parent, scancnt);
+        if (VAL_CHINDEX(parent) == NULL) {
+            return FALSE;
+        }
+    }
+
+    if (!chindex_lookup(VAL_CHINDEX(parent),
+                        (modname) ? CHINDEX_NS_MODNAME : CHINDEX_NS_ANY,
+                        modname, 0, child->name, &rec)) {
+        return FALSE;
+    }
+    if (rec == NULL) {
+        *retval = NULL;
+        return TRUE;
+    }
+
+    if (child->obj != rec->first->obj || !key_entry_ok(child) ||
+        !keytree_build(rec)) {
+        return FALSE;
+    }
+
+    node = keytree_bound(rec, child, FALSE, &res);
+    if (res != NO_ERR) {
+        return FALSE;
+    }
+
+    /* unlike keytree_find, every entry with equal keys is checked
+     * even if the instances are key-sorted
+     */
+    found = NULL;
+    for (; node != NULL && index_match(child, node->val) == 0;
+         node = keynode_next(node)) {
+        if (VAL_IS_DELETED(node->val)) {
+            continue;
+        }
+        if (found) {
+            return FALSE;
+        }
+        found = node->val;
+    }
+
+    *retval = found;
+    return TRUE;
+
+}  /* val_find_list_entry */
+
+
 /********************************************************************
 * FUNCTION val_get_first_child
 * 
@@ -5781,7 +8521,9 @@ val_value_t *
                     const xmlChar *modname,
                     const xmlChar *childname)
 {
-    val_value_t *val;
+    val_value_t *val, *retval;
+    val_chrec_t *rec;
+    uint32       seen, scancnt;
 
 #ifdef DEBUG
     if (!parent || !childname) {
@@ -5795,9 +8537,33 @@ val_value_t *
         return NULL;
     }
 
+    if (VAL_CHINDEX(parent) &&
+        chindex_lookup(VAL_CHINDEX(parent), 
+                       (modname) ? CHINDEX_NS_MODNAME : CHINDEX_NS_ANY,
+                       modname, 0, childname, &rec)) {
+        if (rec == NULL) {
+            return NULL;
+        }
+        for (val = rec->first, seen = 0;
+             val != NULL && seen < rec->count;
+             val = (val_value_t *)dlq_nextEntry(val)) {
+            if (!chrec_match(rec, val)) {
+                continue;
+            }
+            seen++;
+            if (!VAL_IS_DELETED(val)) {
+                return val;
+            }
+        }
+        return NULL;
+    }
+
+    retval = NULL;
+    scancnt = 0;
     for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
+        scancnt++;
         if (VAL_IS_DELETED(val)) {
             continue;
         }
@@ -5807,10 +8573,13 @@ val_value_t *
             continue;
         }
         if (!xml_strcmp(val->name, childname)) {
-            return val;
+            retval = val;
+            break;
         }
     }
-    return NULL;
+
+    chindex_check_build(parent, scancnt);
+    return retval;
 
 }  /* val_find_child */
 
@@ -6049,7 +8818,9 @@ val_value_t *
                            xmlns_id_t   nsid,
                            const xmlChar *name)
 {
-    val_value_t *val;
+    val_value_t *val, *retval;
+    val_chrec_t *rec;
+    uint32       seen, scancnt;
 
 #ifdef DEBUG
     if (!parent || !name) {
@@ -6061,11 +8832,35 @@ val_value_t *
     if (!typ_has_children(parent->btyp)) {
         return NULL;
     }
-        
+
+    if (VAL_CHINDEX(parent) &&
+        chindex_lookup(VAL_CHINDEX(parent),
+                       (nsid) ? CHINDEX_NS_EQUAL : CHINDEX_NS_ANY,
+                       NULL, nsid, name, &rec)) {
+        if (rec == NULL) {
+            return NULL;
+        }
+        for (val = rec->first, seen = 0;
+             val != NULL && seen < rec->count;
+             val = (val_value_t *)dlq_nextEntry(val)) {
+            if (!chrec_match(rec, val)) {
+                continue;
+            }
+            seen++;
+            if (!VAL_IS_DELETED(val)) {
+                return val;
+            }
+        }
+        return NULL;
+    }
+
+    retval = NULL;
+    scancnt = 0;
     for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
 
+        scancnt++;
         if (VAL_IS_DELETED(val)) {
             continue;
         }
@@ -6076,11 +8871,13 @@ val_value_t *
 
         /* check the node if the name matches */
         if (!xml_strcmp(val->name, name)) {
-            return val;
+            retval = val;
+            break;
         }
     }
 
-    return NULL;
+    chindex_check_build(parent, scancnt);
+    return retval;
 
 }  /* val_first_child_qname */
 
@@ -6268,7 +9065,8 @@ uint32
                         const xmlChar *name)
 {
     const val_value_t *val;
-    uint32       cnt;
+    val_chrec_t *rec;
+    uint32       cnt, seen;
 
 #ifdef DEBUG
     if (!parent || !name) {
@@ -6280,8 +9078,34 @@ uint32
     if (!typ_has_children(parent->btyp)) {
         return 0;
     }
-        
+
+    if (VAL_CHINDEX(parent) == NULL) {
+        /* every child is visited, so always worth indexing */
+        chindex_check_build(parent, dlq_count(&parent->v.childQ));
+    }
+
     cnt = 0;
+    if (VAL_CHINDEX(parent) &&
+        chindex_lookup(VAL_CHINDEX(parent),
+                       (modname) ? CHINDEX_NS_MODNAME : CHINDEX_NS_ANY,
+                       modname, 0, name, &rec)) {
+        if (rec == NULL) {
+            return 0;
+        }
+        for (val = rec->first, seen = 0;
+             val != NULL && seen < rec->count;
+             val = (const val_value_t *)dlq_nextEntry(val)) {
+            if (!chrec_match(rec, val)) {
+                continue;
+            }
+            seen++;
+            if (!VAL_IS_DELETED(val)) {
+                cnt++;
+            }
+        }
+        return cnt;
+    }
+
     for (val = (const val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (const val_value_t *)dlq_nextEntry(val)) {
@@ -6573,6 +9397,14 @@ boolean
         return TRUE;
     }
 
+    /* skip the subtree if the schema has no node below
+     * with the name to match
+     */
+    if (name && !textmode && useval->obj &&
+        !obj_may_have_descendant(useval->obj, name)) {
+        return TRUE;
+    }
+
     for (val = (val_value_t *)dlq_firstEntry(&useval->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
@@ -8441,14 +11273,18 @@ status_t
     retval->flags |= VAL_FL_META;  /* obj field is NULL in meta */
     retval->btyp = btyp;
     retval->typdef = typdef;
-    retval->dname = xml_strdup(attr->attr_name);
-    if (!retval->dname) {
+    set_dname(retval, attr->attr_name, xml_strlen(attr->attr_name));
+    if (!retval->name) {
         return ERR_INTERNAL_MEM;
     }
-    retval->name = retval->dname;
     retval->nsid = attr->attr_ns;
-    retval->xpathpcb = attr->attr_xpcb;
-    attr->attr_xpcb = NULL;
+    if (attr->attr_xpcb) {
+        res = val_set_xpathpcb(retval, attr->attr_xpcb);
+        attr->attr_xpcb = NULL;
+        if (res != NO_ERR) {
+            return res;
+        }
+    }
 
     /* handle the attr string according to its base type */
     switch (btyp) {
@@ -8832,7 +11668,7 @@ boolean
     }
 #endif
 
-    return (val->getcb) ? TRUE : FALSE;
+    return (VAL_GETCB(val)) ? TRUE : FALSE;
 
 }  /* val_is_virtual */
 
@@ -8885,7 +11721,7 @@ val_value_t *
         SET_ERROR(ERR_INTERNAL_PTR);
         return NULL;
     }
-    if (!val->getcb) {
+    if (!VAL_GETCB(val)) {
         *res = SET_ERROR(ERR_INTERNAL_VAL);
         return NULL;
     }
@@ -8974,7 +11810,7 @@ boolean
     /* check if this is a virtual value, return FALSE instead
      * of retrieving the value!!! Used for monitoring only!!!
      */
-    if (val->getcb != NULL) {
+    if (VAL_GETCB(val) != NULL) {
         val->flags |= VAL_FL_DEFVALSET;
         val->flags &= ~VAL_FL_DEFVAL;
         return FALSE;
@@ -9119,7 +11955,7 @@ boolean
     }
 #endif
 
-    return (val->getcb || val->btyp==NCX_BT_EXTERN ||
+    return (VAL_GETCB(val) || val->btyp==NCX_BT_EXTERN ||
             val->btyp==NCX_BT_INTERN) ? FALSE : TRUE;
 
 }  /* val_is_real */
@@ -9448,6 +12284,7 @@ void
     }
 
     val->flags |= VAL_FL_DIRTY;
+    val_clear_digest(val);
 
     val_value_t *parent = val->parent;
     while (parent && !obj_is_root(parent->obj)) {
@@ -9513,6 +12350,168 @@ boolean
 } /* val_dirty_subtree */
 
 
+/********************************************************************
+* FUNCTION val_set_child_deleted_flag
+* 
+* Set the child deleted flag for this value node
+* Called for the parent of a node that is being removed
+* from the candidate config
+*
+* INPUTS:
+*     val == value node to set
+*********************************************************************/
+void
+    val_set_child_deleted_flag (val_value_t *val)
+{
+    if (!val) {
+        return;
+    }
+
+    val->flags |= VAL_FL_CHILD_DELETED;
+
+} /* val_set_child_deleted_flag */
+
+
+/********************************************************************
+* FUNCTION val_get_child_deleted_flag
+* 
+* Get the child deleted flag for this value node
+*
+* INPUTS:
+*     val == value node to check
+*
+* RETURNS:
+*     TRUE if a child node may have been deleted, false otherwise
+*********************************************************************/
+boolean
+    val_get_child_deleted_flag (const val_value_t *val)
+{
+#ifdef DEBUG
+    if (!val) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return FALSE;
+    }
+#endif
+
+    return (val->flags & VAL_FL_CHILD_DELETED) ? TRUE : FALSE;
+
+} /* val_get_child_deleted_flag */
+
+
+/********************************************************************
+* FUNCTION val_get_digest
+* 
+* Get the subtree digest for a value node
+*
+* The digest is a 64-bit hash of the node contents that
+* val_compare would check: for a complex node this is the
+* name, namespace and digest or value of each child node,
+* in childQ order, except deleted nodes.
+* Complex nodes cache the result until the next edit
+* (see val_clear_digest), so unchanged subtrees are only
+* hashed once.
+*
+* Nodes that val_compare would not treat as equal even if the
+* contents match (virtual nodes, nodes with an explicit
+* nc:operation) have no digest, and neither do their ancestors.
+*
+* INPUTS:
+*     val == value node to check
+*
+* RETURNS:
+*     subtree digest, or 0 if the node cannot be hashed
+*********************************************************************/
+uint64
+    val_get_digest (val_value_t *val)
+{
+    val_value_t *chval;
+    uint64       hash, chhash;
+
+    assert( val && "val is NULL!" );
+
+    if (!digest_ok(val)) {
+        return 0;
+    }
+
+    hash = VAL_DIGEST_SEED;
+
+    if (!typ_has_children(val->btyp)) {
+        if (!digest_simval(val, &hash)) {
+            return 0;
+        }
+        return (hash) ? hash : 1;
+    }
+
+    if (val->v.digest) {
+        return val->v.digest;
+    }
+
+    for (chval = (val_value_t *)dlq_firstEntry(&val->v.childQ);
+         chval != NULL;
+         chval = (val_value_t *)dlq_nextEntry(chval)) {
+
+        if (VAL_IS_DELETED(chval)) {
+            continue;
+        }
+        if (!digest_ok(chval) || chval->name == NULL) {
+            return 0;
+        }
+
+        hash = digest_uint64(hash, val_get_nsid(chval));
+        hash = digest_string(hash, chval->name);
+        hash = digest_uint64(hash, val_set_by_default(chval) ? 1 : 0);
+
+        if (typ_has_children(chval->btyp)) {
+            /* caches the child digest as well */
+            chhash = val_get_digest(chval);
+            if (chhash == 0) {
+                return 0;
+            }
+            hash = digest_uint64(hash, (uint64)chval->btyp);
+            hash = digest_uint64(hash, chhash);
+        } else if (!digest_simval(chval, &hash)) {
+            return 0;
+        }
+    }
+
+    if (hash == 0) {
+        hash = 1;
+    }
+    val->v.digest = hash;
+    return hash;
+
+}  /* val_get_digest */
+
+
+/********************************************************************
+* FUNCTION val_clear_digest
+* 
+* Discard the cached subtree digest of a value node and
+* all its ancestors.  Called by the val_add_child family,
+* val_set_simval, val_merge and the other val.c mutators;
+* code that changes a value or childQ directly must call it
+*
+* INPUTS:
+*     val == value node that was changed
+*********************************************************************/
+void
+    val_clear_digest (val_value_t *val)
+{
+    if (val && !typ_has_children(val->btyp)) {
+        val = val->parent;
+    }
+
+    /* a node is only cached if all its complex descendants
+     * are cached, so stop at the first node with no digest
+     */
+    while (val && typ_has_children(val->btyp) && val->v.digest) {
+        val->v.digest = 0;
+        val = val->parent;
+    }
+
+}  /* val_clear_digest */
+
+
 
 /********************************************************************
  * FUNCTION val_clean_tree
@@ -9547,7 +12546,8 @@ void
              chval = val_get_next_child(chval)) {
             val_clean_tree(chval);
         }
-        val->flags &= ~ (VAL_FL_DIRTY | VAL_FL_SUBTREE_DIRTY);
+        val->flags &= 
+            ~(VAL_FL_DIRTY | VAL_FL_SUBTREE_DIRTY | VAL_FL_CHILD_DELETED);
         val->editop = OP_EDITOP_NONE;
         free_editvars(val);
     }
@@ -9753,6 +12753,11 @@ void
     }
 #endif
 
+    if (val->parent && VAL_CHINDEX(val->parent)) {
+        val_clear_child_index(val->parent);
+    }
+    val_clear_digest(val->parent);
+
     val->nsid = nsid;
 
     for (child = val_get_first_child(val);
@@ -10052,6 +13057,7 @@ void
 #endif
 
     val->flags |= VAL_FL_WITHDEF;
+    val_clear_digest(val);
 
 }  /* val_set_withdef_default */
 
@@ -10120,6 +13126,14 @@ void
     }
 
     /* move all the entries at once */
+    if (VAL_CHINDEX(srcval)) {
+        val_clear_child_index(srcval);
+    }
+    if (VAL_CHINDEX(destval)) {
+        val_clear_child_index(destval);
+    }
+    val_clear_digest(srcval);
+    val_clear_digest(destval);
     dlq_block_enque(&srcval->v.childQ, &destval->v.childQ);
 
 }  /* val_move_children */
@@ -10171,9 +13185,9 @@ status_t
 
     if (typ_is_string(val->btyp)) {
         val->obj = ncx_get_gen_string();
-        if (val->xpathpcb) {
-            xpath_free_pcb(val->xpathpcb);
-            val->xpathpcb = NULL;
+        if (VAL_XPATHPCB(val)) {
+            xpath_free_pcb(val->extra->xpathpcb);
+            val->extra->xpathpcb = NULL;
         }
     } else if (val->btyp == NCX_BT_ANY) {
         /* !!! this should not happen if agt/mgr_val_parse used
@@ -10403,6 +13417,7 @@ status_t
                                       xml_strlen(val->name), defval);
 
     val->flags |= VAL_FL_DEFSET;
+    val_clear_digest(val);
 
     return res;
 
@@ -10436,6 +13451,7 @@ void
     clean_value(val, FALSE);
     val->btyp = NCX_BT_EMPTY;
     val->v.boo = TRUE;
+    val_clear_digest(val);
 
 } /* val_force_empty */
 
@@ -10465,8 +13481,13 @@ void
 
     destval->parent = srcval->parent;
     destval->dataclass = srcval->dataclass;
-    if (movemeta) {
-        dlq_block_enque(&srcval->metaQ, &destval->metaQ);
+    if (movemeta && !val_meta_empty(srcval)) {
+        if (val_get_extra(destval) == NULL) {
+            SET_ERROR(ERR_INTERNAL_MEM);
+        } else {
+            dlq_block_enque(&srcval->extra->metaQ,
+                            &destval->extra->metaQ);
+        }
     }
 
 } /* val_move_fields_for_xml */
@@ -10573,7 +13594,6 @@ val_value_t *
     }
 
     (void)memset(val, 0x0, sizeof(val_value_t));
-    dlq_createSQue(&val->metaQ);
     dlq_createSQue(&val->indexQ);
     val->flags |= VAL_FL_DELETED;
     return val;
@@ -92,6 +92,7 @@ date	     init     comment
 #include <time.h>
 
 #include "dlq.h"
+#include "ncx_arena.h"
 #include "ncxconst.h"
 #include "ncxtypes.h"
 #include "op.h"
@@ -114,6 +115,11 @@ extern "C" {
 /* max number of concurrent partial locks by the same session */
 #define VAL_MAX_PLOCKS  4
 
+/* number of siblings a linear child search has to pass over
+ * before a hashed child index is built for the parent node
+ */
+#define VAL_CHILD_INDEX_MIN  32
+
 /* maximum number of bytes in a number string */
 #define VAL_MAX_NUMLEN  NCX_MAX_NUMLEN
 
@@ -178,6 +184,19 @@ extern "C" {
  */
 #define VAL_FL_SUBTREE_DIRTY bit10
 
+/* if set, the val_value_t struct came from an arena
+ * (see val_new_arena_value) and is not freed by val_free_value;
+ * never copied by val_clone or val_get_virtual_value
+ */
+#define VAL_FL_ARENA     bit11
+
+/* if set, a child node of this complex node was deleted;
+ * used with VAL_FL_SUBTREE_DIRTY by the <commit> operation
+ * so only these nodes are checked for child nodes that are
+ * in the running config but not in the candidate
+ */
+#define VAL_FL_CHILD_DELETED bit12
+
 /* set the virtualval lifetime to 3 seconds */
 #define VAL_VIRTUAL_CACHE_TIME   3
 
@@ -245,9 +264,33 @@ extern "C" {
 
 #define VAL_IS_DELETED(V) ((V)->flags & VAL_FL_DELETED)
 
-#define VAL_MARK_DELETED(V) (V)->flags |= VAL_FL_DELETED
+#define VAL_IS_ARENA(V) ((V)->flags & VAL_FL_ARENA)
+
+/* deleted nodes are left out of the subtree digest,
+ * so the cached digests above the node are discarded
+ */
+#define VAL_MARK_DELETED(V) \
+    ((V)->flags |= VAL_FL_DELETED, val_clear_digest(V))
+
+#define VAL_UNMARK_DELETED(V) \
+    ((V)->flags &= ~VAL_FL_DELETED, val_clear_digest(V))
+
+/* cached subtree digest of a complex node, or 0 if not cached */
+#define VAL_DIGEST(V) \
+    (typ_has_children((V)->btyp) ? (V)->v.digest : (uint64)0)
+
+/* NULL-safe read access to the fields in val->extra */
+#define VAL_DNAME(V)   ((V)->extra ? (V)->extra->dname : NULL)
+
+#define VAL_GETCB(V)   ((V)->extra ? (V)->extra->getcb : NULL)
+
+#define VAL_VIRTUALVAL(V) ((V)->extra ? (V)->extra->virtualval : NULL)
 
-#define VAL_UNMARK_DELETED(V) (V)->flags &= ~VAL_FL_DELETED
+#define VAL_XPATHPCB(V) ((V)->extra ? (V)->extra->xpathpcb : NULL)
+
+#define VAL_PLOCK(V,I) ((V)->extra ? (V)->extra->plock[I] : NULL)
+
+#define VAL_METAQ(V)   ((V)->extra ? &(V)->extra->metaQ : NULL)
 
 #define MAX_PATH 512 //define maximum length of the path
 
@@ -285,21 +328,12 @@ typedef struct val_editvars_t_ {
 } val_editvars_t;
 
 
-/* one value to match one type */
-typedef struct val_value_t_ {
-    dlq_hdr_t      qhdr;
-
-    /* common fields */
-    struct obj_template_t_ *obj;        /* bptr to object def */
-    typ_def_t *typdef;              /* bptr to typdef if leaf */
-    const xmlChar   *name;                /* back pointer to elname */
-    xmlChar         *dname;          /* AND malloced name if needed */
-    struct val_value_t_ *parent;       /* back-ptr to parent if any */
-    xmlns_id_t     nsid;              /* namespace ID for this node */
-    ncx_btype_t    btyp;                 /* base type of this value */
-
-    uint32         flags;                  /* internal status flags */
-    ncx_data_class_t dataclass;             /* config or state data */
+/* rarely used fields of a value node; only malloced when one of
+ * them is set (see val_get_extra) and freed with the value node
+ * Read access must go through the NULL-safe VAL_* macros above
+ */
+typedef struct val_extra_t_ {
+    xmlChar         *dname;              /* malloced name if needed */
 
     /* YANG does not support user-defined meta-data but NCX does.
      * The <edit-config>, <get> and <get-config> operations 
@@ -316,11 +350,6 @@ typedef struct val_value_t_ {
      */
     dlq_hdr_t        metaQ;                      /* Q of val_value_t */
 
-    /* value editing variables */
-    val_editvars_t  *editvars;               /* edit-vars from attrs */
-    op_editop_t      editop;                 /* needed for all edits */ 
-    status_t         res;                       /* validation result */
-
     /* Used by Agent only:
      * if this field is non-NULL, then the entire value node
      * is actually a placeholder for a dynamic read-only object
@@ -336,18 +365,6 @@ typedef struct val_value_t_ {
     struct val_value_t_ *virtualval;
     time_t               cachetime;
 
-    /* these fields are used for NCX_BT_LIST */
-    struct val_index_t_ *index;   /* back-ptr/flag in use as index */
-    dlq_hdr_t       indexQ;    /* Q of val_index_t or ncx_filptr_t */
-
-    /* this field is used for NCX_BT_CHOICE 
-     * If set, the object path for this node is really:
-     *    $this --> casobj --> casobj.parent --> $this.parent
-     * the OBJ_TYP_CASE and OBJ_TYP_CHOICE nodes are skipped
-     * inside an XML instance document
-     */
-    struct obj_template_t_   *casobj;
-
     /* these fields are for NCX_BT_LEAFREF
      * NCX_BT_INSTANCE_ID, or tagged ncx:xpath 
      * value stored in v union as a string
@@ -359,6 +376,42 @@ typedef struct val_value_t_ {
      */
     plock_cb_t  *plock[VAL_MAX_PLOCKS];
 
+    /* complex types only: lazily built hash index of the childQ
+     * by child QName; maintained by the val_add_child and
+     * val_remove_child family of functions and discarded
+     * (to be rebuilt on demand) if the childQ is edited directly
+     */
+    struct val_chindex_t_  *chindex;
+} val_extra_t;
+
+
+/* one value to match one type */
+typedef struct val_value_t_ {
+    dlq_hdr_t      qhdr;
+
+    /* common fields */
+    struct obj_template_t_ *obj;        /* bptr to object def */
+    typ_def_t *typdef;              /* bptr to typdef if leaf */
+    const xmlChar   *name;                /* back pointer to elname */
+    struct val_value_t_ *parent;       /* back-ptr to parent if any */
+    xmlns_id_t     nsid;              /* namespace ID for this node */
+    ncx_btype_t    btyp;                 /* base type of this value */
+
+    uint32         flags;                  /* internal status flags */
+    ncx_data_class_t dataclass;             /* config or state data */
+
+    /* value editing variables */
+    val_editvars_t  *editvars;               /* edit-vars from attrs */
+    op_editop_t      editop;                 /* needed for all edits */ 
+    status_t         res;                       /* validation result */
+
+    /* these fields are used for NCX_BT_LIST */
+    struct val_index_t_ *index;   /* back-ptr/flag in use as index */
+    dlq_hdr_t       indexQ;    /* Q of val_index_t or ncx_filptr_t */
+
+    /* rarely used fields, or NULL if none of them is set */
+    val_extra_t     *extra;
+
     /* union of all the NCX-specific sub-types
      * note that the following invisible constructs should
      * never show up in this struct:
@@ -371,8 +424,15 @@ typedef struct val_value_t_ {
 	 * the child nodes with values
 	 *   NCX_BT_CONTAINER
 	 *   NCX_BT_LIST
+	 *
+	 * digest is the cached content hash of the subtree,
+	 * or 0 if it has not been computed since the last edit;
+	 * see val_get_digest and val_clear_digest
 	 */
-        dlq_hdr_t   childQ;         
+        struct {
+            dlq_hdr_t   childQ;
+            uint64      digest;
+        };
 
         /* Numeric data types:
 	 *   NCX_BT_INT8, NCX_BT_INT16,
@@ -482,6 +542,106 @@ extern val_value_t *
     val_new_value (void);
 
 
+/********************************************************************
+* FUNCTION val_new_arena_value
+* 
+* Get a val_value_t from an arena and initialize the fields
+* The struct is only reclaimed when the arena is cleaned,
+* so the node must not be linked into any tree that outlives
+* the arena; see val_clone_arena_value
+*
+* INPUTS:
+*   arena == arena to allocate from, or NULL to use malloc
+*
+* RETURNS:
+*   pointer to the initialized struct or NULL if an error
+*********************************************************************/
+extern val_value_t *
+    val_new_arena_value (ncx_arena_t *arena);
+
+
+/********************************************************************
+* FUNCTION val_begin_sibset_pass
+* 
+* Start an edit or validation pass that uses sibling sets
+* While a pass is active, each record in a child index keeps
+* a transient set of its instances: a hash of the leaf-list
+* values, for val_first_child_match, and the last instance,
+* so val_add_child_sorted can append a list or leaf-list
+* entry without checking every sibling.
+*
+* Passes can be nested; the sets are freed when
+* the outermost pass ends
+*********************************************************************/
+extern void
+    val_begin_sibset_pass (void);
+
+
+/********************************************************************
+* FUNCTION val_end_sibset_pass
+* 
+* End a pass started with val_begin_sibset_pass
+* The sibling sets built during the pass are freed
+* when the outermost pass ends
+*********************************************************************/
+extern void
+    val_end_sibset_pass (void);
+
+
+/********************************************************************
+* FUNCTION val_get_extra
+* 
+* Get the block of rarely used fields for a value node,
+* and malloc it if it is not there yet
+*
+* INPUTS:
+*   val == value node to use
+*
+* RETURNS:
+*   pointer to val->extra, or NULL if a malloc error
+*********************************************************************/
+extern val_extra_t *
+    val_get_extra (val_value_t *val);
+
+
+/********************************************************************
+* FUNCTION val_get_casobj
+* 
+* Get the case object for a value node that is part of a choice
+* If set, the object path for this node is really:
+*    $this --> casobj --> casobj.parent --> $this.parent
+* the OBJ_TYP_CASE and OBJ_TYP_CHOICE nodes are skipped
+* inside an XML instance document
+*
+* INPUTS:
+*   val == value node to check
+*
+* RETURNS:
+*   case object template, or NULL if val is not in a choice
+*********************************************************************/
+extern struct obj_template_t_ *
+    val_get_casobj (const val_value_t *val);
+
+
+/********************************************************************
+* FUNCTION val_set_xpathpcb
+* 
+* Replace the XPath control block of a value node
+* Any old control block is freed
+*
+* INPUTS:
+*   val == value node to change
+*   pcb == malloced XPath control block to store in val;
+*          freed here if an error is returned
+*
+* RETURNS:
+*   status
+*********************************************************************/
+extern status_t
+    val_set_xpathpcb (val_value_t *val,
+                      struct xpath_pcb_t_ *pcb);
+
+
 /********************************************************************
 * FUNCTION val_init_complex
 * 
@@ -1629,6 +1789,25 @@ extern val_value_t *
     val_clone2 (const val_value_t *val);
 
 
+/********************************************************************
+* FUNCTION val_clone_arena_value
+* 
+* Clone a val_value_t struct and sub-trees that were parsed
+* into an arena, so the clone can be linked into a tree
+* that outlives the arena.  The editvars and the edit operation
+* of every node are kept, so the clone can take the place of
+* val in an edit in progress
+*
+* INPUTS:
+*    val == value to clone
+*
+* RETURNS:
+*   malloced clone of val, or NULL if a malloc failure
+*********************************************************************/
+extern val_value_t *
+    val_clone_arena_value (const val_value_t *val);
+
+
 /********************************************************************
 * FUNCTION val_clone_config_data
 * 
@@ -1701,6 +1880,8 @@ extern status_t
 *
 *   Add a meta value node to a parent value node
 *   Simply makes a new last meta!!!
+*   The meta node is freed if the parent val->extra
+*   cannot be malloced
 *
 * INPUTS:
 *    child == node to store in the parent
@@ -1778,6 +1959,39 @@ extern void
     val_remove_child (val_value_t *child);
 
 
+/********************************************************************
+* FUNCTION val_insert_child_before
+* 
+*   Insert a child value node ahead of a current child node
+*
+* INPUTS:
+*    child == node to store in the parent
+*    current == current child node to insert ahead of
+*    parent == complex value node with a childQ
+*
+*********************************************************************/
+extern void
+    val_insert_child_before (val_value_t *child,
+                             val_value_t *current,
+                             val_value_t *parent);
+
+
+/********************************************************************
+* FUNCTION val_clear_child_index
+* 
+*   Discard the hashed child index of a complex value node
+*   Must be called before the childQ is changed directly
+*   with dlq functions instead of the val_add_child family;
+*   the index is rebuilt on demand by the next child search
+*
+* INPUTS:
+*    val == value node to clear the child index from
+*
+*********************************************************************/
+extern void
+    val_clear_child_index (val_value_t *val);
+
+
 /********************************************************************
 * FUNCTION val_swap_child
 * 
@@ -1829,6 +2043,37 @@ extern val_value_t *
 			  val_value_t *curmatch);
 
 
+/********************************************************************
+* FUNCTION val_find_list_entry
+*
+* Find the list entry with the same keys as a search entry,
+* using the key tree in the child index of the parent
+*
+* INPUTS:
+*    parent == parent value to check
+*    modname == module name of the list entries to find
+*            == NULL to match any module; the list name
+*               then has to be unique within the parent
+*    child == list entry with a complete index chain,
+*             holding the key values to find
+*    retval == address of return list entry
+*
+* OUTPUTS:
+*    *retval == the only live list entry with the same keys,
+*               or NULL if there is none
+*
+* RETURNS:
+*    TRUE if the key tree answered the search
+*    FALSE if the caller has to check the instances in order
+*      (parent too small to index, incomplete or duplicate keys)
+*********************************************************************/
+extern boolean
+    val_find_list_entry (val_value_t *parent,
+			 const xmlChar *modname,
+			 val_value_t *child,
+			 val_value_t **retval);
+
+
 /********************************************************************
 * FUNCTION val_get_first_child
 * 
@@ -3211,6 +3456,77 @@ extern boolean
     val_dirty_subtree (const val_value_t *val);
 
 
+/********************************************************************
+* FUNCTION val_set_child_deleted_flag
+* 
+* Set the child deleted flag for this value node
+* Called for the parent of a node that is being removed
+* from the candidate config
+*
+* INPUTS:
+*     val == value node to set
+*********************************************************************/
+extern void
+    val_set_child_deleted_flag (val_value_t *val);
+
+
+/********************************************************************
+* FUNCTION val_get_child_deleted_flag
+* 
+* Get the child deleted flag for this value node
+*
+* INPUTS:
+*     val == value node to check
+*
+* RETURNS:
+*     TRUE if a child node may have been deleted, false otherwise
+*********************************************************************/
+extern boolean
+    val_get_child_deleted_flag (const val_value_t *val);
+
+
+/********************************************************************
+* FUNCTION val_get_digest
+* 
+* Get the subtree digest for a value node
+*
+* The digest is a 64-bit hash of the node contents that
+* val_compare would check: for a complex node this is the
+* name, namespace and digest or value of each child node,
+* in childQ order, except deleted nodes.
+* Complex nodes cache the result until the next edit
+* (see val_clear_digest), so unchanged subtrees are only
+* hashed once.
+*
+* Nodes that val_compare would not treat as equal even if the
+* contents match (virtual nodes, nodes with an explicit
+* nc:operation) have no digest, and neither do their ancestors.
+*
+* INPUTS:
+*     val == value node to check
+*
+* RETURNS:
+*     subtree digest, or 0 if the node cannot be hashed
+*********************************************************************/
+extern uint64
+    val_get_digest (val_value_t *val);
+
+
+/********************************************************************
+* FUNCTION val_clear_digest
+* 
+* Discard the cached subtree digest of a value node and
+* all its ancestors.  Called by the val_add_child family,
+* val_set_simval, val_merge and the other val.c mutators;
+* code that changes a value or childQ directly must call it
+*
+* INPUTS:
+*     val == value node that was changed
+*********************************************************************/
+extern void
+    val_clear_digest (val_value_t *val);
+
+
 /********************************************************************
  * FUNCTION val_clean_tree
  * 
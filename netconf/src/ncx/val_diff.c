@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2008 - 2012, Andy Bierman, All Rights Reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/*  FILE: val_diff.c
+
+
+*********************************************************************
+*                                                                   *
+*                  C H A N G E   H I S T O R Y                      *
+*                                                                   *
+*********************************************************************
+
+date         init     comment
+----------------------------------------------------------------------
+16oct26      agt      begun
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory.h>
+
+#ifndef _H_procdefs
+#include  "procdefs.h"
+#endif
+
+#ifndef _H_dlq
+#include "dlq.h"
+#endif
+
+#ifndef _H_ncxconst
+#include "ncxconst.h"
+#endif
+
+#ifndef _H_obj
+#include "obj.h"
+#endif
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+#ifndef _H_typ
+#include "typ.h"
+#endif
+
+#ifndef _H_val
+#include "val.h"
+#endif
+
+#ifndef _H_val_diff
+#include "val_diff.h"
+#endif
+
+#ifndef _H_val_util
+#include "val_util.h"
+#endif
+
+
+/********************************************************************
+*                                                                   *
+*                       C O N S T A N T S                           *
+*                                                                   *
+*********************************************************************/
+
+#define VAL_DIFF_CREATE_STR  (const xmlChar *)"create"
+#define VAL_DIFF_DELETE_STR  (const xmlChar *)"delete"
+#define VAL_DIFF_MODIFY_STR  (const xmlChar *)"modify"
+
+
+/********************************************************************
+* FUNCTION diff_skip
+*
+* Check if a child node is left out of the diff
+*
+* INPUTS:
+*    val == child node to check
+*    configonly == TRUE to skip config=false nodes
+*
+* RETURNS:
+*    TRUE if the node is skipped
+*********************************************************************/
+static boolean
+    diff_skip (const val_value_t *val,
+               boolean configonly)
+{
+    if (VAL_IS_DELETED(val)) {
+        return TRUE;
+    }
+    if (configonly && val->obj && !obj_get_config_flag(val->obj)) {
+        return TRUE;
+    }
+    return FALSE;
+
+}  /* diff_skip */
+
+
+/********************************************************************
+* FUNCTION add_diff
+*
+* Add one change record to the diffQ
+*
+* INPUTS:
+*    mhdr == message header for the path prefixes, or NULL
+*    op == kind of change
+*    oldval == node in the old tree, or NULL
+*    newval == node in the new tree, or NULL
+*    diffQ == Q of val_diff_t to add the record to
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    add_diff (xml_msg_hdr_t *mhdr,
+              val_diff_op_t op,
+              val_value_t *oldval,
+              val_value_t *newval,
+              dlq_hdr_t *diffQ)
+{
+    val_diff_t *diff;
+    status_t    res;
+
+    diff = m__getObj(val_diff_t);
+    if (!diff) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(diff, 0x0, sizeof(val_diff_t));
+    diff->op = op;
+    diff->oldval = oldval;
+    diff->newval = newval;
+
+    res = val_gen_instance_id(mhdr,
+                              (newval) ? newval : oldval,
+                              NCX_IFMT_XPATH1,
+                              &diff->path);
+    if (res != NO_ERR) {
+        val_free_diff(diff);
+        return res;
+    }
+
+    dlq_enque(diff, diffQ);
+    return NO_ERR;
+
+}  /* add_diff */
+
+
+/* forward decl needed for recursion */
+static status_t
+    diff_node (xml_msg_hdr_t *mhdr,
+               val_value_t *oldval,
+               val_value_t *newval,
+               boolean configonly,
+               dlq_hdr_t *diffQ);
+
+
+/********************************************************************
+* FUNCTION diff_children
+*
+* Find the changed child nodes of two complex nodes
+* that are known to be the same instance
+*
+* INPUTS:
+*    mhdr == message header for the path prefixes, or NULL
+*    oldval == complex node in the old tree
+*    newval == complex node in the new tree
+*    configonly == TRUE to skip config=false nodes
+*    diffQ == Q of val_diff_t to add the changes to
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    diff_children (xml_msg_hdr_t *mhdr,
+                   val_value_t *oldval,
+                   val_value_t *newval,
+                   boolean configonly,
+                   dlq_hdr_t *diffQ)
+{
+    val_value_t *oldch, *newch;
+    uint64       olddigest;
+    status_t     res = NO_ERR;
+
+    /* the digests are cached, so an unchanged subtree is
+     * only hashed by the first diff that reaches it; unlike
+     * val_compare, equal digests are trusted without checking
+     * the nodes, which is good enough for a diff report
+     */
+    olddigest = val_get_digest(oldval);
+    if (olddigest != 0 && olddigest == val_get_digest(newval)) {
+        return NO_ERR;
+    }
+
+    for (newch = val_get_first_child(newval);
+         newch != NULL && res == NO_ERR;
+         newch = val_get_next_child(newch)) {
+
+        if (diff_skip(newch, configonly)) {
+            continue;
+        }
+
+        oldch = val_first_child_match(oldval, newch);
+        if (oldch == NULL) {
+            res = add_diff(mhdr, VAL_DIFF_CREATE, NULL, newch, diffQ);
+        } else {
+            res = diff_node(mhdr, oldch, newch, configonly, diffQ);
+        }
+    }
+
+    for (oldch = val_get_first_child(oldval);
+         oldch != NULL && res == NO_ERR;
+         oldch = val_get_next_child(oldch)) {
+
+        if (diff_skip(oldch, configonly)) {
+            continue;
+        }
+
+        if (val_first_child_match(newval, oldch) == NULL) {
+            res = add_diff(mhdr, VAL_DIFF_DELETE, oldch, NULL, diffQ);
+        }
+    }
+
+    return res;
+
+}  /* diff_children */
+
+
+/********************************************************************
+* FUNCTION diff_node
+*
+* Find the changes between two instances of the same node
+*
+* INPUTS:
+*    mhdr == message header for the path prefixes, or NULL
+*    oldval == node in the old tree
+*    newval == node in the new tree
+*    configonly == TRUE to skip config=false nodes
+*    diffQ == Q of val_diff_t to add the changes to
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    diff_node (xml_msg_hdr_t *mhdr,
+               val_value_t *oldval,
+               val_value_t *newval,
+               boolean configonly,
+               dlq_hdr_t *diffQ)
+{
+    /* virtual nodes have no stored contents to compare */
+    if (VAL_GETCB(oldval) || VAL_GETCB(newval)) {
+        return NO_ERR;
+    }
+
+    if (typ_has_children(oldval->btyp) &&
+        typ_has_children(newval->btyp)) {
+        return diff_children(mhdr, oldval, newval, configonly, diffQ);
+    }
+
+    if (oldval->btyp != newval->btyp ||
+        val_compare(oldval, newval) != 0) {
+        return add_diff(mhdr, VAL_DIFF_MODIFY, oldval, newval, diffQ);
+    }
+
+    return NO_ERR;
+
+}  /* diff_node */
+
+
+/**************    E X T E R N A L   F U N C T I O N S   **********/
+
+
+/********************************************************************
+* FUNCTION val_diff_trees
+*
+* Find the nodes that differ between two value trees,
+* usually the roots of two configuration datastores
+*
+* A created or deleted subtree is reported once, at its top node.
+* A changed leaf is reported as VAL_DIFF_MODIFY.  Leaf-list
+* entries are matched by value and list entries by key, so
+* they are only ever created or deleted.
+*
+* The old and new trees are not changed except for the
+* subtree digests cached along the way
+*
+* INPUTS:
+*    mhdr == message header for the instance-identifier prefixes;
+*            NULL to use the module prefixes
+*    oldval == old value tree
+*    newval == new value tree
+*    configonly == TRUE to skip config=false nodes
+*    diffQ == Q of val_diff_t to add the changes to
+*
+* OUTPUTS:
+*    val_diff_t records added to diffQ, in new tree order,
+*    with the deleted nodes after their surviving siblings
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    val_diff_trees (xml_msg_hdr_t *mhdr,
+                    val_value_t *oldval,
+                    val_value_t *newval,
+                    boolean configonly,
+                    dlq_hdr_t *diffQ)
+{
+#ifdef DEBUG
+    if (!oldval || !newval || !diffQ) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    if (oldval == newval) {
+        return NO_ERR;
+    }
+
+    return diff_node(mhdr, oldval, newval, configonly, diffQ);
+
+}  /* val_diff_trees */
+
+
+/********************************************************************
+* FUNCTION val_diff_op_name
+*
+* Get the name of a diff operation
+*
+* INPUTS:
+*    op == diff operation
+*
+* RETURNS:
+*    const string for the operation
+*********************************************************************/
+const xmlChar *
+    val_diff_op_name (val_diff_op_t op)
+{
+    switch (op) {
+    case VAL_DIFF_CREATE:
+        return VAL_DIFF_CREATE_STR;
+    case VAL_DIFF_DELETE:
+        return VAL_DIFF_DELETE_STR;
+    case VAL_DIFF_MODIFY:
+        return VAL_DIFF_MODIFY_STR;
+    case VAL_DIFF_NONE:
+    default:
+        return NCX_EL_NONE;
+    }
+
+}  /* val_diff_op_name */
+
+
+/********************************************************************
+* FUNCTION val_free_diff
+*
+* Free a val_diff_t struct
+*
+* INPUTS:
+*    diff == struct to free
+*********************************************************************/
+void
+    val_free_diff (val_diff_t *diff)
+{
+    if (!diff) {
+        return;
+    }
+    if (diff->path) {
+        m__free(diff->path);
+    }
+    m__free(diff);
+
+}  /* val_free_diff */
+
+
+/********************************************************************
+* FUNCTION val_clean_diffQ
+*
+* Free all the val_diff_t structs in a Q
+*
+* INPUTS:
+*    diffQ == Q of val_diff_t to clean
+*********************************************************************/
+void
+    val_clean_diffQ (dlq_hdr_t *diffQ)
+{
+    val_diff_t *diff;
+
+    if (!diffQ) {
+        return;
+    }
+    while (!dlq_empty(diffQ)) {
+        diff = (val_diff_t *)dlq_deque(diffQ);
+        val_free_diff(diff);
+    }
+
+}  /* val_clean_diffQ */
+
+
+/* END file val_diff.c */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2008 - 2012, Andy Bierman, All Rights Reserved.
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef _H_val_diff
+#define _H_val_diff
+
+/*  FILE: val_diff.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Find the changed nodes between two value trees
+
+    Subtrees with equal digests (see val_get_digest) are skipped,
+    so comparing two datastores that share most of their contents
+    only visits the siblings of the changed nodes and their
+    ancestors.  The digests stay cached in both trees, so the
+    next diff only rehashes the parts edited since.
+
+*********************************************************************
+*								    *
+*		   C H A N G E	 H I S T O R Y			    *
+*								    *
+*********************************************************************
+
+date	     init     comment
+----------------------------------------------------------------------
+16-oct-26    agt      Begun
+*/
+
+#include <xmlstring.h>
+
+#ifndef _H_dlq
+#include "dlq.h"
+#endif
+
+#ifndef _H_ncxtypes
+#include "ncxtypes.h"
+#endif
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+#ifndef _H_val
+#include "val.h"
+#endif
+
+#ifndef _H_xml_msg
+#include "xml_msg.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			     T Y P E S				    *
+*								    *
+*********************************************************************/
+
+/* kind of change found for one node */
+typedef enum val_diff_op_t_ {
+    VAL_DIFF_NONE,
+    VAL_DIFF_CREATE,                 /* only in the new tree */
+    VAL_DIFF_DELETE,                 /* only in the old tree */
+    VAL_DIFF_MODIFY                  /* leaf value changed */
+} val_diff_op_t;
+
+
+/* one changed node found by val_diff_trees */
+typedef struct val_diff_t_ {
+    dlq_hdr_t      qhdr;
+    val_diff_op_t  op;
+    xmlChar       *path;         /* malloced instance-identifier */
+    val_value_t   *oldval;    /* back-ptr, NULL for VAL_DIFF_CREATE */
+    val_value_t   *newval;    /* back-ptr, NULL for VAL_DIFF_DELETE */
+} val_diff_t;
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION val_diff_trees
+*
+* Find the nodes that differ between two value trees,
+* usually the roots of two configuration datastores
+*
+* A created or deleted subtree is reported once, at its top node.
+* A changed leaf is reported as VAL_DIFF_MODIFY.  Leaf-list
+* entries are matched by value and list entries by key, so
+* they are only ever created or deleted.
+*
+* The old and new trees are not changed except for the
+* subtree digests cached along the way
+*
+* INPUTS:
+*    mhdr == message header for the instance-identifier prefixes;
+*            NULL to use the module prefixes
+*    oldval == old value tree
+*    newval == new value tree
+*    configonly == TRUE to skip config=false nodes
+*    diffQ == Q of val_diff_t to add the changes to
+*
+* OUTPUTS:
+*    val_diff_t records added to diffQ, in new tree order,
+*    with the deleted nodes after their surviving siblings
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    val_diff_trees (xml_msg_hdr_t *mhdr,
+                    val_value_t *oldval,
+                    val_value_t *newval,
+                    boolean configonly,
+                    dlq_hdr_t *diffQ);
+
+
+/********************************************************************
+* FUNCTION val_diff_op_name
+*
+* Get the name of a diff operation
+*
+* INPUTS:
+*    op == diff operation
+*
+* RETURNS:
+*    const string for the operation
+*********************************************************************/
+extern const xmlChar *
+    val_diff_op_name (val_diff_op_t op);
+
+
+/********************************************************************
+* FUNCTION val_free_diff
+*
+* Free a val_diff_t struct
+*
+* INPUTS:
+*    diff == struct to free
+*********************************************************************/
+extern void
+    val_free_diff (val_diff_t *diff);
+
+
+/********************************************************************
+* FUNCTION val_clean_diffQ
+*
+* Free all the val_diff_t structs in a Q
+*
+* INPUTS:
+*    diffQ == Q of val_diff_t to clean
+*********************************************************************/
+extern void
+    val_clean_diffQ (dlq_hdr_t *diffQ);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_val_diff */
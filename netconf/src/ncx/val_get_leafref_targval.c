@@ -31,7 +31,7 @@ val_value_t* val_get_leafref_targval(val_value_t *leafref_val, val_value_t *root
 
     xpath_resnode_t *resnode;
     xpath_result_t *result =
-            xpath1_eval_expr(leafref_val->xpathpcb, leafref_val, root_val, FALSE /* logerrors */, FALSE /* non-configonly */, &res);
+            xpath1_eval_expr(VAL_XPATHPCB(leafref_val), leafref_val, root_val, FALSE /* logerrors */, FALSE /* non-configonly */, &res);
     assert(result);
     for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
          resnode != NULL;
@@ -966,23 +966,27 @@ static status_t
                 break;
             }  /* else fall through and parse XPath string */
         case NCX_BT_INSTANCE_ID:
-            retval->xpathpcb = xpath_new_pcb(valnode.simval, NULL);
-            if (!retval->xpathpcb) {
+            res = val_set_xpathpcb(retval, 
+                                   xpath_new_pcb(valnode.simval, NULL));
+            if (res == NO_ERR && !VAL_XPATHPCB(retval)) {
                 res = ERR_INTERNAL_MEM;
+            }
+            if (res != NO_ERR) {
+                ;
             } else if (btyp == NCX_BT_INSTANCE_ID ||
                        obj_is_schema_instance_string(obj)) {
                 /* do a first pass parsing to resolve all
                  * the prefixes and check well-formed XPath
                  */
                 res = xpath_yang_validate_xmlpath(scb->reader,
-                                                  retval->xpathpcb,
+                                                  retval->extra->xpathpcb,
                                                   obj,
                                                   FALSE,
                                                   &targobj);
             } else {
                 result = 
                     xpath1_eval_xmlexpr(scb->reader,
-                                        retval->xpathpcb,
+                                        retval->extra->xpathpcb,
                                         NULL,
                                         NULL,
                                         FALSE,
@@ -1801,7 +1805,7 @@ static status_t
                 /* parse the attribute string against the typdef */
                 res = val_parse_meta(metadef, attr, metaval);
                 if (res == NO_ERR) {
-                    dlq_enque(metaval, &retval->metaQ);
+                    val_add_meta(metaval, retval);
                 } else {
                     val_free_value(metaval);
                 }
@@ -300,7 +300,7 @@ static status_t
      * first make sure all the mandatory case 
      * objects are present
      */
-    res = val_instance_check(val, chval->casobj);
+    res = val_instance_check(val, val_get_casobj(chval));
     if (res != NO_ERR) {
         retres = res;
     }
@@ -308,15 +308,16 @@ static status_t
     /* check if any objects from other cases are present */
     testval = val_get_choice_next_set(choicobj, chval);
     while (testval) {
-        if ((testval->casobj != chval->casobj) &&
-            (testval->casobj->parent == chval->casobj->parent)) {
+        if ((val_get_casobj(testval) != val_get_casobj(chval)) &&
+            (val_get_casobj(testval)->parent == 
+             val_get_casobj(chval)->parent)) {
             /* error: extra case object in this choice */
             retres = ERR_NCX_EXTRA_CHOICE;
             log_error("\nError: Extra object '%s' "
                       "in choice '%s'; Case '%s' already selected", 
                       testval->name,
                       obj_get_name(choicobj),
-                      obj_get_name(chval->casobj));
+                      obj_get_name(val_get_casobj(chval)));
             ncx_print_errormsg(NULL, NULL, retres);
         }
         testval = val_get_choice_next_set(choicobj, testval);
@@ -488,7 +489,7 @@ static status_t
             testval = val_get_choice_first_set(val, chobj);
             if (testval) {
                 /* use the selected case instead of the default case */
-                casobj = testval->casobj;
+                casobj = val_get_casobj(testval);
                 if (!casobj) {
                     res = SET_ERROR(ERR_INTERNAL_VAL);
                 }
@@ -1109,6 +1110,7 @@ void
 #endif
 
     /* transfer all the val->childQ nodes to the tempQ */
+    val_clear_child_index(val);
     dlq_createSQue(&tempQ);
     dlq_block_enque(&val->v.childQ, &tempQ);
 
@@ -1192,6 +1194,7 @@ void
             log_debug("\nset_canonical: %d leftover nodes added "
                       " to end of childQ for val %s",
                       dlq_count(&tempQ), val->name);
+            val_clear_child_index(val);
             dlq_block_enque(&tempQ, &val->v.childQ);
         }
 
@@ -1591,10 +1594,10 @@ val_value_t *
          chval != NULL;
          chval = val_get_next_child(chval)) {
 
-        if (chval->casobj != NULL) {
+        if (val_get_casobj(chval) != NULL) {
             boolean done2 = FALSE;
             const obj_template_t
-                *testobj = chval->casobj->parent;
+                *testobj = val_get_casobj(chval)->parent;
 
             while (!done2) {
                 if (testobj == obj) {
@@ -1635,7 +1638,8 @@ val_value_t *
     val_get_choice_next_set (const obj_template_t *obj,
                              val_value_t *curchild)
 {
-    val_value_t  *chval;
+    val_value_t     *chval;
+    obj_template_t  *casobj;
 
 #ifdef DEBUG
     if (!obj || !curchild) {
@@ -1648,7 +1652,8 @@ val_value_t *
          chval != NULL;
          chval = val_get_next_child(chval)) {
 
-        if (chval->casobj && chval->casobj->parent==obj) {
+        casobj = val_get_casobj(chval);
+        if (casobj && casobj->parent==obj) {
             return chval;
         }
     }
@@ -1693,10 +1698,10 @@ boolean
          testval != NULL && !done;
          testval = val_get_next_child(testval)) {
 
-        if (testval->casobj != NULL) {
+        if (val_get_casobj(testval) != NULL) {
             boolean done2 = FALSE;
             const obj_template_t
-                *testobj = testval->casobj->parent;
+                *testobj = val_get_casobj(testval)->parent;
 
             while (!done2) {
                 if (testobj == obj) {
@@ -1720,7 +1725,7 @@ boolean
         return FALSE;
     }
 
-    cas = chval->casobj;
+    cas = val_get_casobj(chval);
 
     /* check if all the mandatory parms are present in this case */
     for (child = obj_first_child(cas);
@@ -1786,20 +1791,50 @@ val_value_t *
                        val_value_t *parent,
                        op_editop_t editop,
                        obj_template_t *obj)
+{
+    return val_new_arena_child_val(nsid, name, copyname, parent,
+                                   editop, obj, NULL);
+
+} /* val_new_child_val */
+
+
+/********************************************************************
+ * FUNCTION val_new_arena_child_val
+ *
+ * Same as val_new_child_val, but the node is taken from an arena
+ *
+ * INPUTS:
+ *   nsid == namespace ID of name
+ *   name == name string (direct or strdup, based on copyname)
+ *   copyname == TRUE is dname strdup should be used
+ *   parent == parent node
+ *   editop == requested edit operation
+ *   obj == object template to use
+ *   arena == arena to allocate from, or NULL to use malloc
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+val_value_t *
+    val_new_arena_child_val (xmlns_id_t   nsid,
+                             const xmlChar *name,
+                             boolean copyname,
+                             val_value_t *parent,
+                             op_editop_t editop,
+                             obj_template_t *obj,
+                             ncx_arena_t *arena)
 {
     val_value_t *chval;
 
-    chval = val_new_value();
+    chval = val_new_arena_value(arena);
     if (!chval) {
         return NULL;
     }
 
     /* save a const pointer to the name of this field */
     if (copyname) {
-        chval->dname = xml_strdup(name);
-        if (chval->dname) {
-            chval->name = chval->dname;
-        } else {
+        val_set_name(chval, name, xml_strlen(name));
+        if (chval->name == NULL) {
             val_free_value(chval);
             return NULL;
         }
@@ -1814,7 +1849,7 @@ val_value_t *
 
     return chval;
 
-} /* val_new_child_val */
+} /* val_new_arena_child_val */
 
 
 /********************************************************************
@@ -2338,7 +2373,7 @@ xpath_pcb_t *
     }
 #endif
 
-    return val->xpathpcb;
+    return VAL_XPATHPCB(val);
 
 }  /* val_get_xpathpcb */
 
@@ -2365,7 +2400,7 @@ const xpath_pcb_t *
     }
 #endif
 
-    return val->xpathpcb;
+    return VAL_XPATHPCB(val);
 
 }  /* val_get_const_xpathpcb */
 
@@ -3029,10 +3064,10 @@ status_t
     /* check for an empty slot and locked-by-another session */
     anyavail = FALSE;
     for (i = 0; i < VAL_MAX_PLOCKS; i++) {
-        if (val->plock[i] == NULL) {
+        if (VAL_PLOCK(val, i) == NULL) {
             anyavail = TRUE;
         } else {
-            owner = plock_get_sid(val->plock[i]);
+            owner = plock_get_sid(VAL_PLOCK(val, i));
             if (owner != sesid) {
                 *lockowner = owner;
                 return ERR_NCX_LOCK_DENIED;
@@ -3103,9 +3138,9 @@ status_t
     /* check for an empty slot and locked-by-another session */
     anyavail = FALSE;
     for (i = 0; i < VAL_MAX_PLOCKS; i++) {
-        if (val->plock[i] == NULL) {
+        if (VAL_PLOCK(val, i) == NULL) {
             anyavail = TRUE;
-        } else if (plock_get_sid(val->plock[i]) != newsid) {
+        } else if (plock_get_sid(VAL_PLOCK(val, i)) != newsid) {
             return ERR_NCX_LOCK_DENIED;
         }
     }
@@ -3114,10 +3149,14 @@ status_t
         return ERR_NCX_RESOURCE_DENIED;
     }
 
+    if (val_get_extra(val) == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
     done = FALSE;
     for (i = 0; i < VAL_MAX_PLOCKS && !done; i++) {
-        if (val->plock[i] == NULL) {
-            val->plock[i] = plcb;
+        if (val->extra->plock[i] == NULL) {
+            val->extra->plock[i] = plcb;
             done = TRUE;
         }
     }
@@ -3157,8 +3196,8 @@ void
 
     /* check for the specified plcb */
     for (i = 0; i < VAL_MAX_PLOCKS; i++) {
-        if (val->plock[i] == plcb) {
-            val->plock[i] = NULL;
+        if (VAL_PLOCK(val, i) == plcb) {
+            val->extra->plock[i] = NULL;
             return;
         }
     }
@@ -3239,12 +3278,12 @@ status_t
      * in order for the createoperation to be valid
      */
     for (i = 0; i < VAL_MAX_PLOCKS; i++) {
-        if (val->plock[i] == NULL) {
+        if (VAL_PLOCK(val, i) == NULL) {
             continue;
         }
-        if (plock_get_sid(val->plock[i]) != sesid) {
+        if (plock_get_sid(VAL_PLOCK(val, i)) != sesid) {
             /* this node locked by another session */
-            *lockid = plock_get_id(val->plock[i]);
+            *lockid = plock_get_id(VAL_PLOCK(val, i));
             return ERR_NCX_IN_USE_LOCKED;
         }
     }
@@ -3257,12 +3296,12 @@ status_t
         upval = val->parent;
         while (upval != NULL && !obj_is_root(upval->obj)) {
             for (i = 0; i < VAL_MAX_PLOCKS; i++) {
-                if (upval->plock[i] == NULL) {
+                if (VAL_PLOCK(upval, i) == NULL) {
                     continue;
                 }
-                if (plock_get_sid(upval->plock[i]) != sesid) {
+                if (plock_get_sid(VAL_PLOCK(upval, i)) != sesid) {
                     /* this node locked by another session */
-                    *lockid = plock_get_id(upval->plock[i]);
+                    *lockid = plock_get_id(VAL_PLOCK(upval, i));
                     return ERR_NCX_IN_USE_LOCKED;
                 }
             }
@@ -3321,11 +3360,25 @@ void
         return;
     }
 
+    if (curval->extra == NULL) {
+        if (newval->extra != NULL) {
+            memset(newval->extra->plock, 0x0, 
+                   sizeof(newval->extra->plock));
+        }
+        return;
+    }
+
+    if (val_get_extra(newval) == NULL) {
+        SET_ERROR(ERR_INTERNAL_MEM);
+        return;
+    }
+
     uint32 i = 0;
     for (; i < VAL_MAX_PLOCKS; i++) {
-        newval->plock[i] = curval->plock[i];
-        if (curval->plock[i] != NULL) {
-            xpath_result_t *result = plock_get_final_result(curval->plock[i]);
+        newval->extra->plock[i] = curval->extra->plock[i];
+        if (curval->extra->plock[i] != NULL) {
+            xpath_result_t *result = 
+                plock_get_final_result(curval->extra->plock[i]);
             xpath_nodeset_swap_valptr(result, curval, newval);
         }
     }
@@ -3352,8 +3405,9 @@ void
 
     uint32 i = 0;
     for (; i < VAL_MAX_PLOCKS; i++) {
-        if (curval->plock[i] != NULL) {
-            xpath_result_t *result = plock_get_final_result((curval->plock[i]));
+        if (VAL_PLOCK(curval, i) != NULL) {
+            xpath_result_t *result = 
+                plock_get_final_result(VAL_PLOCK(curval, i));
             xpath_nodeset_delete_valptr(result, curval);
         }
     }
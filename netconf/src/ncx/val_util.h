@@ -405,6 +405,33 @@ extern val_value_t *
                        obj_template_t *obj);
 
 
+/********************************************************************
+ * FUNCTION val_new_arena_child_val
+ * 
+ * Same as val_new_child_val, but the node is taken from an arena
+ *
+ * INPUTS:
+ *   nsid == namespace ID of name
+ *   name == name string (direct or strdup, based on copyname)
+ *   copyname == TRUE is dname strdup should be used
+ *   parent == parent node
+ *   editop == requested edit operation
+ *   obj == object template to use
+ *   arena == arena to allocate from, or NULL to use malloc
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+extern val_value_t *
+    val_new_arena_child_val (xmlns_id_t   nsid,
+                             const xmlChar *name,
+                             boolean copyname,
+                             val_value_t *parent,
+                             op_editop_t editop,
+                             obj_template_t *obj,
+                             ncx_arena_t *arena);
+
+
 /********************************************************************
 * FUNCTION val_gen_instance_id
 * 
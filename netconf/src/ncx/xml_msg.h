@@ -105,6 +105,12 @@ typedef struct xml_msg_hdr_t_ {
     void                    *acm_cbfn;
     boolean                 is_candidate;
 
+    /* incoming: arena for the value nodes parsed with this
+     * header, or NULL to malloc them;
+     * !!! shadow pointer, the arena belongs to the message
+     */
+    ncx_arena_t             *valarena;
+
 } xml_msg_hdr_t;
 
 
@@ -319,7 +319,11 @@ status_t
         return ERR_INTERNAL_MEM;
     }
 
-    dlq_enque(newval, &val->metaQ);
+    if (val_get_extra(val) == NULL) {
+        val_free_value(newval);
+        return ERR_INTERNAL_MEM;
+    }
+    dlq_enque(newval, &val->extra->metaQ);
     return NO_ERR;
 }   /* xml_val_add_attr */
 
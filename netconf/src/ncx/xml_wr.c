@@ -147,8 +147,7 @@ static void
         ses_putchar(scb, ':');
         ses_putstr(scb, pfix);
     }
-    ses_putchar(scb, '=');
-    ses_putchar(scb, '\"');
+    ses_putnstr(scb, (const xmlChar *)"=\"", 2);
     ses_putstr(scb, val);      /* write the namespace URI value */
     ses_putchar(scb, '\"');
     
@@ -343,12 +342,12 @@ static void
             }
         } else if (val) {
             /* check if XPath or identityref content */
-            if (val->xpathpcb) {
+            if (VAL_XPATHPCB(val)) {
                 /* generate all the default xmlns directives needed
                  * for the content following this start tag to be valid
                  */
                 retcount = 0;
-                res = handle_xpath_start_tag(scb, val->xpathpcb, indent,
+                res = handle_xpath_start_tag(scb, val->extra->xpathpcb, indent,
                                              &retcount);
                 if (res != NO_ERR) {
                     /* not expecting anything except a buffer overflow
@@ -370,8 +369,7 @@ static void
         }
 
         ses_putstr(scb, attr_name);
-        ses_putchar(scb, '=');
-        ses_putchar(scb, '\"');
+        ses_putnstr(scb, (const xmlChar *)"=\"", 2);
         if (isattrq) {
             ses_putastr(scb, attr->attr_val, -1);
         } else if (typ_is_string(val->btyp)) {
@@ -435,7 +433,7 @@ static void
     empty = !val_has_content(val);
     elname = val->name;
     nsid = val->nsid;
-    attrQ = &val->metaQ;
+    attrQ = VAL_METAQ(val);
     xpathpcb = NULL;
     isdefault = FALSE;
     if (typ_is_simple(val->btyp)) {
@@ -533,9 +531,10 @@ static void
 
     /* finish up the element */
     if (empty) {
-        ses_putchar(scb, '/');
+        ses_putnstr(scb, (const xmlChar *)"/>", 2);
+    } else {
+        ses_putchar(scb, '>');
     }
-    ses_putchar(scb, '>');
 
     /* hack in XMLDOC mode to get more readable XSD output */
     if (empty && scb->mode==SES_MODE_XMLDOC && indent < 
@@ -1057,9 +1056,10 @@ static void
 
     /* finish up the element */
     if (empty) {
-        ses_putchar(scb, '/');
+        ses_putnstr(scb, (const xmlChar *)"/>", 2);
+    } else {
+        ses_putchar(scb, '>');
     }
-    ses_putchar(scb, '>');
 
     /* hack in XMLDOC mode to get more readable XSD output */
     if (empty && scb->mode==SES_MODE_XMLDOC && indent < 
@@ -1091,15 +1091,10 @@ void
                  const xmlChar *buff,
                  uint32 bufflen)
 {
-
-    uint32  i;
-
     assert( scb && "scb is NULL!" );
     assert( buff && "buff is NULL!" );
 
-    for (i=0; i<bufflen; i++) {
-        ses_putchar(scb, *buff++);
-    }
+    ses_putnstr(scb, buff, bufflen);
 
 }  /* xml_wr_buff */
 
@@ -1258,8 +1253,7 @@ void
     ses_indent(scb, indent);
 
     /* start the element and write the prefix, if any */
-    ses_putchar(scb, '<');
-    ses_putchar(scb, '/');
+    ses_putnstr(scb, (const xmlChar *)"</", 2);
     pfix = NULL;
     if (nsid && msg->useprefix) {
         pfix = xml_msg_get_prefix(msg, 0, nsid, NULL, &xneeded);
@@ -1532,7 +1526,7 @@ void
         /* write a complete QName element */
         xml_wr_qname_elem(scb, msg, out->v.idref.nsid, out->v.idref.name,
                           (out->parent) ? out->parent->nsid : 0, out->nsid, 
-                           out->name, &out->metaQ, FALSE, indent, isdefault);
+                           out->name, VAL_METAQ(out), FALSE, indent, isdefault);
     } else if (val_has_content(out)) {
         /* write the top-level start node */
         begin_elem_val(scb, msg, out, indent);
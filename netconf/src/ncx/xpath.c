@@ -56,6 +56,18 @@ date         init     comment
 #define MAX_FILL  255
 
 
+/********************************************************************
+*                                                                   *
+*                       V A R I A B L E S                           *
+*                                                                   *
+*********************************************************************/
+
+/* free xpath_resnode_t structs shared by all the pcbs */
+static dlq_hdr_t resnode_poolQ;
+static uint32    resnode_poolcnt = 0;
+static boolean   resnode_pool_init = FALSE;
+
+
 /********************************************************************
 * FUNCTION do_errmsg
 * 
@@ -2362,7 +2374,6 @@ xpath_pcb_t *
     pcb->missing_errors = TRUE;
 
     dlq_createSQue(&pcb->result_cacheQ);
-    dlq_createSQue(&pcb->resnode_cacheQ);
     dlq_createSQue(&pcb->varbindQ);
 
     return pcb;
@@ -2438,14 +2449,15 @@ xpath_pcb_t *
     /*** ??? context ??? ***/
     newpcb->functions = srcpcb->functions;
     /* result_cacheQ not copied */
-    /* resnode_cacheQ not copied */
     /* result_count not copied */
-    /* resnode_count not copied */
     newpcb->parseres = srcpcb->parseres;
     newpcb->validateres = srcpcb->validateres;
     newpcb->valueres = srcpcb->valueres;
     newpcb->seen = srcpcb->seen;
 
+    /* a clone of a leafref clone shares the same tree */
+    newpcb->comppcb = srcpcb->comppcb;
+
     /*** does the varbindQ need to be cloned?  ***/
 
     return newpcb;
@@ -2453,6 +2465,34 @@ xpath_pcb_t *
 }  /* xpath_clone_pcb */
 
 
+/********************************************************************
+* FUNCTION xpath_clone_shared_pcb
+* 
+* Clone a leafref XPath PCB from a typdef into a value
+* The clone uses the expression compiled for srcpcb instead
+* of compiling its own, so srcpcb must not be freed before
+* the clone; a typdef lives as long as the values of its type
+*
+* INPUTS:
+*    srcpcb == typdef pcb to clone
+*
+* RETURNS:
+*   new xpath_pcb_t clone of srcpcb, NULL if malloc error
+*********************************************************************/
+xpath_pcb_t *
+    xpath_clone_shared_pcb (xpath_pcb_t *srcpcb)
+{
+    xpath_pcb_t *newpcb;
+
+    newpcb = xpath_clone_pcb(srcpcb);
+    if (newpcb) {
+        newpcb->comppcb = (srcpcb->comppcb) ? srcpcb->comppcb : srcpcb;
+    }
+    return newpcb;
+
+}  /* xpath_clone_shared_pcb */
+
+
 /********************************************************************
 * FUNCTION xpath_find_pcb
 * 
@@ -2501,12 +2541,15 @@ xpath_pcb_t *
 void xpath_free_pcb (xpath_pcb_t *pcb)
 {
     xpath_result_t   *result;
-    xpath_resnode_t  *resnode;
 
     if (!pcb) {
         return;
     }
 
+    if (pcb->comp && !pcb->comppcb) {
+        xpath_free_comp(pcb->comp);
+    }
+
     if (pcb->tkc) {
         tk_free_chain(pcb->tkc);
     }
@@ -2527,12 +2570,6 @@ void xpath_free_pcb (xpath_pcb_t *pcb)
         xpath_free_result(result);
     }
 
-    while (!dlq_empty(&pcb->resnode_cacheQ)) {
-        resnode = (xpath_resnode_t *)
-            dlq_deque(&pcb->resnode_cacheQ);
-        xpath_free_resnode(resnode);
-    }
-
     var_clean_varQ(&pcb->varbindQ);
 
     m__free(pcb);
@@ -2686,21 +2723,25 @@ void
 * FUNCTION xpath_new_resnode
 * 
 * Create and initialize an XPath result node struct
-*
-* INPUTS:
-*   restype == the desired result type
+* The struct is taken from the shared resnode pool
+* if possible, and malloced otherwise
 *
 * RETURNS:
-*   pointer to malloced struct, NULL if malloc error
+*   pointer to initialized struct, NULL if malloc error
 *********************************************************************/
 xpath_resnode_t *
     xpath_new_resnode (void)
 {
     xpath_resnode_t *resnode;
 
-    resnode = m__getObj(xpath_resnode_t);
-    if (!resnode) {
-        return NULL;
+    if (resnode_poolcnt) {
+        resnode = (xpath_resnode_t *)dlq_deque(&resnode_poolQ);
+        resnode_poolcnt--;
+    } else {
+        resnode = m__getObj(xpath_resnode_t);
+        if (!resnode) {
+            return NULL;
+        }
     }
     
     xpath_init_resnode(resnode);
@@ -2736,6 +2777,8 @@ void
 * FUNCTION xpath_free_resnode
 * 
 * Free a malloced XPath result node struct
+* The struct is put back in the shared resnode pool
+* unless the pool already has XPATH_RESNODE_POOL_MAX entries
 *
 * INPUTS:
 *   resnode == pointer to result node struct to free
@@ -2751,11 +2794,43 @@ void
 #endif
 
     xpath_clean_resnode(resnode);
-    m__free(resnode);
+
+    if (resnode_poolcnt < XPATH_RESNODE_POOL_MAX) {
+        if (!resnode_pool_init) {
+            dlq_createSQue(&resnode_poolQ);
+            resnode_pool_init = TRUE;
+        }
+        dlq_enque(resnode, &resnode_poolQ);
+        resnode_poolcnt++;
+    } else {
+        m__free(resnode);
+    }
 
 }  /* xpath_free_resnode */
 
 
+/********************************************************************
+* FUNCTION xpath_free_comp
+* 
+* Free a compiled XPath expression
+*
+* INPUTS:
+*   comp == pointer to compiled expression to free
+*********************************************************************/
+void
+    xpath_free_comp (xpath_comp_t *comp)
+{
+    if (!comp) {
+        return;
+    }
+    if (comp->nodes) {
+        m__free(comp->nodes);
+    }
+    m__free(comp);
+
+}  /* xpath_free_comp */
+
+
 /********************************************************************
 * FUNCTION xpath_delete_resnode
 * 
@@ -2774,8 +2849,7 @@ void
     }
 #endif
     dlq_remove(resnode);
-    xpath_clean_resnode(resnode);
-    m__free(resnode);
+    xpath_free_resnode(resnode);
 
 }  /* xpath_delete_resnode */
 
@@ -2804,6 +2878,58 @@ void
 }  /* xpath_clean_resnode */
 
 
+/********************************************************************
+* FUNCTION xpath_resnode_cleanup
+* 
+* Free all the structs in the shared resnode pool
+* Called from ncx_cleanup
+*********************************************************************/
+void
+    xpath_resnode_cleanup (void)
+{
+    xpath_resnode_t *resnode;
+
+    if (!resnode_pool_init) {
+        return;
+    }
+
+    while (!dlq_empty(&resnode_poolQ)) {
+        resnode = (xpath_resnode_t *)dlq_deque(&resnode_poolQ);
+        m__free(resnode);
+    }
+    resnode_poolcnt = 0;
+
+}  /* xpath_resnode_cleanup */
+
+
+/********************************************************************
+* FUNCTION xpath_clean_objdepQ
+* 
+* Free all the xpath_objdep_t structs in a Q
+*
+* INPUTS:
+*   depQ == Q of xpath_objdep_t to clean
+*********************************************************************/
+void
+    xpath_clean_objdepQ (dlq_hdr_t *depQ)
+{
+    xpath_objdep_t *dep;
+
+#ifdef DEBUG
+    if (!depQ) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    while (!dlq_empty(depQ)) {
+        dep = (xpath_objdep_t *)dlq_deque(depQ);
+        m__free(dep);
+    }
+
+}  /* xpath_clean_objdepQ */
+
+
 /********************************************************************
 * FUNCTION xpath_get_curmod_from_prefix
 * 
@@ -3087,7 +3213,7 @@ void
                     }
                 } else if (val && val->btyp == NCX_BT_STRING) {
                     ncx_init_num(&testnum);
-                    res = ncx_convert_num(result->r.str,
+                    res = ncx_convert_num(VAL_STR(val),
                                           NCX_NF_NONE,
                                           NCX_BT_FLOAT64,
                                           &testnum);
@@ -82,8 +82,33 @@ extern "C" {
 /* max size of the pcb->result_cacheQ */
 #define XPATH_RESULT_CACHE_MAX     16
 
-/* max size of the pcb->resnode_cacheQ */
-#define XPATH_RESNODE_CACHE_MAX     64
+/* max number of free xpath_resnode_t structs kept in the
+ * resnode pool shared by all the parser control blocks
+ */
+#define XPATH_RESNODE_POOL_MAX      8192
+
+/* number of nodes a nodeset needs before duplicate checks
+ * use an xpath_nodeidx_t hash instead of a Q scan
+ */
+#define XPATH_NODEIDX_MIN           16
+
+/* number of node pairs a '=' comparison of 2 nodesets
+ * needs before the string values of 1 side are hashed
+ * into an xpath_strset_t instead of compared pairwise
+ */
+#define XPATH_STRSET_MIN            16
+
+/* number of evaluations of an expression before xpath1
+ * compiles it into pcb->comp; one-shot expressions such
+ * as <get> filters are only interpreted.
+ * leafref clones use the tree compiled on the typdef pcb
+ */
+#define XPATH_COMPILE_MIN_EVALS     2
+
+/* number of cached operands of a compiled expression that
+ * are kept on the stack during an evaluation; more are malloced
+ */
+#define XPATH_COMPCACHE_LOCAL       8
 
 
 /* XPath 1.0 sec 2.2 AxisName */
@@ -204,6 +229,13 @@ extern "C" {
 #define XP_FL_SCHEMA_INSTANCEID          bit7
 
 
+/* the expression uses a step or node test that the compiled
+ * form does not support, so the token chain is always
+ * interpreted instead
+ */
+#define XP_FL_NOCOMPILE          bit8
+
+
 /********************************************************************
 *								    *
 *			     T Y P E S				    *
@@ -282,6 +314,90 @@ typedef enum xpath_nodetype_t_ {
 } xpath_nodetype_t;
 
 
+/* kind of node in a compiled XPath expression */
+typedef enum xpath_exkind_t_ {
+    XP_EXK_NONE,
+    XP_EXK_BINARY,       /* exop applied to 2 operands */
+    XP_EXK_NEGATE,       /* odd number of unary '-' */
+    XP_EXK_UNION,        /* vert. bar '|' */
+    XP_EXK_PATH,         /* location path, maybe after a filter */
+    XP_EXK_FILTER,       /* primary expr with predicates */
+    XP_EXK_STEP,         /* one location step */
+    XP_EXK_NUMBER,       /* Number or folded constant expr */
+    XP_EXK_LITERAL,      /* quoted string */
+    XP_EXK_VARBIND,      /* variable reference */
+    XP_EXK_FNCALL        /* function call */
+} xpath_exkind_t;
+
+
+/* one node in a compiled XPath expression
+ * The nodes are kept in one array and linked by index;
+ * index 0 is not used and means 'none'
+ */
+typedef struct xpath_exnode_t_ {
+    xpath_exkind_t       kind;
+    xpath_exop_t         exop;   /* BINARY: operator; STEP: '/' '//' */
+    uint32               left;  /* 1st operand, filter, or 1st arg */
+    uint32               right;     /* 2nd operand or 1st step */
+    uint32               next;  /* next step, predicate or arg */
+    uint32               preds;       /* 1st predicate expr */
+    tk_token_t          *tk;       /* current token for errors */
+    tk_type_t            steptyp;   /* STEP: '.' '..' '/' or none */
+    ncx_xpath_axis_t     axis;                /* STEP node test */
+    boolean              textmode;            /* STEP node test */
+    boolean              keypreds;  /* STEP: preds only test keys */
+    uint32               cache;     /* PATH: comp->cache slot + 1 */
+    xmlns_id_t           nsid;                /* STEP node test */
+    const xmlChar       *name;    /* STEP node test or LITERAL */
+    const struct xpath_fncb_t_ *fncb;                /* FNCALL */
+    ncx_num_t            num;                        /* NUMBER */
+} xpath_exnode_t;
+
+
+/* one string value in an xpath_strset_t */
+typedef struct xpath_strslot_t_ {
+    const xmlChar       *str;          /* NULL if slot not used */
+    xmlChar             *buff;     /* malloced copy of str or NULL */
+    uint32               hash;
+} xpath_strslot_t;
+
+
+/* string values of the simple nodes in a nodeset, hashed
+ * so a '=' comparison to another nodeset is 1 lookup per node
+ */
+typedef struct xpath_strset_t_ {
+    xpath_strslot_t     *slots;
+    uint32               numslots;         /* always a power of 2 */
+    uint32               numused;
+} xpath_strset_t;
+
+
+/* result of a context-free operand of a compiled comparison;
+ * it has the same value for every context node, so it is
+ * evaluated once and kept until the end of the evaluation
+ */
+typedef struct xpath_compcache_t_ {
+    struct xpath_result_t_ *result;      /* NULL if not evaluated */
+    xpath_strset_t      *strset;      /* NULL if not hashed yet */
+    boolean              nostrset;      /* T: hashing failed */
+} xpath_compcache_t;
+
+
+/* XPath expression compiled from the token chain, with the
+ * prefixes, axis names, and function names already resolved
+ * It is not changed by an evaluation, so the leafref clones
+ * of a typdef pcb all use the one tree built for it; the
+ * cached operands are kept in pcb->compcache instead
+ */
+typedef struct xpath_comp_t_ {
+    xpath_exnode_t      *nodes;
+    uint32               nodecnt;
+    uint32               maxnodes;
+    uint32               top;                /* index of Expr */
+    uint32               cachecnt;   /* number of cached operands */
+} xpath_comp_t;
+
+
 /* xpath_getvar_fn_t
  *
  * Callback function for retrieval of a variable binding
@@ -307,6 +423,7 @@ typedef ncx_var_t *
 /* XPath result node struct */
 typedef struct xpath_resnode_t_ {
     dlq_hdr_t             qhdr;
+    struct xpath_resnode_t_ *hashnext;       /* nodeidx chain */
     boolean               dblslash;
     int64                 position;
     int64                 last;   /* only set in context node */
@@ -334,6 +451,16 @@ typedef struct xpath_result_t_ {
 } xpath_result_t;
 
 
+/* one schema node read by an XPath expression;
+ * filled in by xpath1_get_obj_deps
+ */
+typedef struct xpath_objdep_t_ {
+    dlq_hdr_t            qhdr;
+    obj_template_t      *obj;                  /* back-ptr */
+    boolean              pathonly;  /* T: only used as a path step */
+} xpath_objdep_t;
+
+
 /* XPath parser control block */
 typedef struct xpath_pcb_t_ {
     dlq_hdr_t            qhdr;           /* in case saved in a Q */
@@ -378,6 +505,13 @@ typedef struct xpath_pcb_t_ {
     uint32              flags;
     xpath_result_t     *result;
 
+    /* set only while xpath1_get_obj_deps is walking the
+     * expression against the object tree; every object found
+     * by a location step is added as an xpath_objdep_t
+     */
+    dlq_hdr_t          *depQ;
+    boolean             depnonlocal;  /* a step left the context subtree */
+
     /* additive XPath1 context back- pointer to current 
      * step results; initially NULL and modified until
      * the expression is done
@@ -403,21 +537,20 @@ typedef struct xpath_pcb_t_ {
      */
     const struct xpath_fncb_t_ *functions; 
 
-    /* Performance Caches
-     * The xpath_result_t and xpath_resnode_t structs
-     * are used in many intermediate operations
+    /* Performance Cache
+     * The xpath_result_t structs are used in many
+     * intermediate operations
      *
-     * These Qs are used to cache these structs
+     * This Q is used to cache these structs
      * instead of calling malloc and free constantly
      *
-     * The XPATH_RESULT_CACHE_MAX and XPATH_RESNODE_CACHE_MAX
-     * constants are used to control the max cache sizes
-     * This is not user-configurable (TBD).
+     * The XPATH_RESULT_CACHE_MAX constant is used to
+     * control the max cache size.  The xpath_resnode_t
+     * structs come from a pool shared by all pcbs instead;
+     * see xpath_new_resnode
      */
     dlq_hdr_t           result_cacheQ;  /* Q of xpath_result_t */
-    dlq_hdr_t           resnode_cacheQ;  /* Q of xpath_resnode_t */
     uint32              result_count;
-    uint32              resnode_count;
 
 
     /* first and second pass parsing results
@@ -428,6 +561,23 @@ typedef struct xpath_pcb_t_ {
     status_t             validateres;
     status_t             valueres;
 
+    /* compiled form of the expression, built by xpath1 after
+     * XPATH_COMPILE_MIN_EVALS evaluations against a value tree
+     * NULL if not built yet
+     */
+    xpath_comp_t        *comp;
+    uint32               evalcount;
+
+    /* typdef pcb that owns the comp of a leafref clone;
+     * set by xpath_clone_shared_pcb, NULL if pcb owns its comp
+     */
+    struct xpath_pcb_t_ *comppcb;
+
+    /* cached operands of the compiled evaluation in progress,
+     * 1 entry per comp->cachecnt; NULL outside an evaluation
+     */
+    xpath_compcache_t   *compcache;
+
     /* saved error info for the agent to process */
     ncx_error_t          tkerr;
     boolean              seen;      /* yangdiff support */
@@ -450,11 +600,26 @@ typedef struct xpath_fncb_t_ {
 } xpath_fncb_t;
 
 
+/* pointer hash index of the nodes in a Q of xpath_resnode_t;
+ * used to find duplicates while a nodeset is built.
+ * The buckets are only malloced once the Q has
+ * XPATH_NODEIDX_MIN nodes; smaller Qs are scanned.
+ */
+typedef struct xpath_nodeidx_t_ {
+    dlq_hdr_t         *nodeQ;         /* Q of xpath_resnode_t */
+    xpath_resnode_t  **buckets;
+    uint32             numbuckets;      /* always a power of 2 */
+    uint32             numnodes;
+} xpath_nodeidx_t;
+
+
 /* Value or object node walker fn callback parameters */
 typedef struct xpath_walkerparms_t_ {
-    dlq_hdr_t         *resnodeQ;
+    xpath_nodeidx_t   *nodeidx;
     int64              callcount;
     status_t           res;
+    val_value_t       *lastval;    /* last value node added */
+    int64              lastpos;    /* sibling position of lastval */
 } xpath_walkerparms_t;
 
 
@@ -745,6 +910,24 @@ extern xpath_pcb_t *
     xpath_clone_pcb (const xpath_pcb_t *srcpcb);
 
 
+/********************************************************************
+* FUNCTION xpath_clone_shared_pcb
+* 
+* Clone a leafref XPath PCB from a typdef into a value
+* The clone uses the expression compiled for srcpcb instead
+* of compiling its own, so srcpcb must not be freed before
+* the clone; a typdef lives as long as the values of its type
+*
+* INPUTS:
+*    srcpcb == typdef pcb to clone
+*
+* RETURNS:
+*   new xpath_pcb_t clone of srcpcb, NULL if malloc error
+*********************************************************************/
+extern xpath_pcb_t *
+    xpath_clone_shared_pcb (xpath_pcb_t *srcpcb);
+
+
 /********************************************************************
 * FUNCTION xpath_find_pcb
 * 
@@ -834,12 +1017,11 @@ extern void
 * FUNCTION xpath_new_resnode
 * 
 * Create and initialize an XPath result node struct
-*
-* INPUTS:
-*   restype == the desired result type
+* The struct is taken from the shared resnode pool
+* if possible, and malloced otherwise
 *
 * RETURNS:
-*   pointer to malloced struct, NULL if malloc error
+*   pointer to initialized struct, NULL if malloc error
 *********************************************************************/
 extern xpath_resnode_t *
     xpath_new_resnode (void);
@@ -861,6 +1043,8 @@ extern void
 * FUNCTION xpath_free_resnode
 * 
 * Free a malloced XPath result node struct
+* The struct is put back in the shared resnode pool
+* unless the pool already has XPATH_RESNODE_POOL_MAX entries
 *
 * INPUTS:
 *   resnode == pointer to result node struct to free
@@ -869,6 +1053,18 @@ extern void
     xpath_free_resnode (xpath_resnode_t *resnode);
 
 
+/********************************************************************
+* FUNCTION xpath_free_comp
+* 
+* Free a compiled XPath expression
+*
+* INPUTS:
+*   comp == pointer to compiled expression to free
+*********************************************************************/
+extern void
+    xpath_free_comp (xpath_comp_t *comp);
+
+
 /********************************************************************
 * FUNCTION xpath_delete_resnode
 * 
@@ -893,6 +1089,28 @@ extern void
     xpath_clean_resnode (xpath_resnode_t *resnode);
 
 
+/********************************************************************
+* FUNCTION xpath_resnode_cleanup
+* 
+* Free all the structs in the shared resnode pool
+* Called from ncx_cleanup
+*********************************************************************/
+extern void
+    xpath_resnode_cleanup (void);
+
+
+/********************************************************************
+* FUNCTION xpath_clean_objdepQ
+* 
+* Free all the xpath_objdep_t structs in a Q
+*
+* INPUTS:
+*   depQ == Q of xpath_objdep_t to clean
+*********************************************************************/
+extern void
+    xpath_clean_objdepQ (dlq_hdr_t *depQ);
+
+
 /********************************************************************
 * FUNCTION xpath_get_curmod_from_prefix
 * 
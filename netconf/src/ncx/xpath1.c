@@ -35,6 +35,7 @@ date         init     comment
 #include <xmlstring.h>
 
 #include  "procdefs.h"
+#include "bobhash.h"
 #include "def_reg.h"
 #include "dlq.h"
 #include "grp.h"
@@ -45,6 +46,7 @@ date         init     comment
 #include "obj.h"
 #include "tk.h"
 #include "typ.h"
+#include "val_util.h"
 #include "xpath.h"
 #include "xpath1.h"
 #include "yangconst.h"
@@ -61,6 +63,65 @@ date         init     comment
 
 #define TEMP_BUFFSIZE  1024
 
+/* initial number of slots in a docposmap_t */
+#define DOCPOS_MIN_SLOTS  64
+
+/* max number of key tests in the predicates of 1 step */
+#define KEYTEST_MAX  16
+
+/* initial number of slots in an xpath_strset_t */
+#define STRSET_MIN_SLOTS  32
+
+/* bobhash init value for xpath_strset_t strings */
+#define STRSET_HASH_INIT  0x5a17c0de
+
+
+/********************************************************************
+*                                                                   *
+*                             T Y P E S                             *
+*                                                                   *
+*********************************************************************/
+
+/* sibling position of one value node */
+typedef struct docpos_t_ {
+    const val_value_t  *val;
+    uint32              position;
+} docpos_t;
+
+/* open addressing map of value node sibling positions,
+ * used by sort_nodeset_docorder
+ */
+typedef struct docposmap_t_ {
+    docpos_t   *slots;
+    uint32      numslots;                 /* always a power of 2 */
+    uint32      numused;
+} docposmap_t;
+
+/* one node of a nodeset being sorted into document order */
+typedef struct docnode_t_ {
+    xpath_resnode_t  *resnode;
+    uint32           *key;    /* sibling positions, root first */
+    uint32            keylen;
+} docnode_t;
+
+/* one 'key = value' test in the predicates of a compiled step */
+typedef struct keytest_t_ {
+    uint32            lhs;     /* STEP node naming the key leaf */
+    uint32            rhs;         /* expr for the value to find */
+    xmlChar          *valstr;   /* malloced string value of rhs */
+} keytest_t;
+
+/* strset_walker_fn parameters */
+typedef struct strsetparms_t_ {
+    xpath_strset_t   *strset;
+    xmlChar          *buffer;
+    uint32            buffsize;
+    boolean           skippw;     /* T: password leaves never match */
+    boolean           probe;      /* T: find, F: add to strset */
+    boolean           found;
+    status_t          res;
+} strsetparms_t;
+
 /********************************************************************
 *                                                                   *
 *           F O R W A R D   D E C L A R A T I O N S                 *
@@ -577,19 +638,6 @@ static xpath_result_t *
 *********************************************************************/
 static void free_result (xpath_pcb_t *pcb, xpath_result_t *result)
 {
-    xpath_resnode_t *resnode;
-
-    if (result->restype == XP_RT_NODESET) {
-        while (!dlq_empty(&result->r.nodeQ) &&
-               pcb->resnode_count < XPATH_RESNODE_CACHE_MAX) {
-
-            resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
-            xpath_clean_resnode(resnode);
-            dlq_enque(resnode, &pcb->resnode_cacheQ);
-            pcb->resnode_count++;
-        }
-    }
-
     if (pcb->result_count < XPATH_RESULT_CACHE_MAX) {
         xpath_clean_result(result);
         dlq_enque(result, &pcb->result_cacheQ);
@@ -604,7 +652,7 @@ static void free_result (xpath_pcb_t *pcb, xpath_result_t *result)
 /********************************************************************
 * FUNCTION new_obj_resnode
 * 
-* Get a new result node from the cache or malloc if none available
+* Get a new result node from the resnode pool
 *
 * INPUTS:
 *    pcb == parser control block to use
@@ -619,7 +667,7 @@ static void free_result (xpath_pcb_t *pcb, xpath_result_t *result)
 *    objptr == object pointer value to use
 *
 * RETURNS:
-*    result from the cache or malloced; NULL if malloc fails
+*    result node from the pool; NULL if malloc fails
 *********************************************************************/
 static xpath_resnode_t *
     new_obj_resnode (xpath_pcb_t *pcb,
@@ -629,13 +677,7 @@ static xpath_resnode_t *
 {
     xpath_resnode_t  *resnode;
 
-    resnode = (xpath_resnode_t *)dlq_deque(&pcb->resnode_cacheQ);
-    if (resnode) {
-        pcb->resnode_count--;
-    } else {
-        resnode = xpath_new_resnode();
-    }
-
+    resnode = xpath_new_resnode();
     if (!resnode) {
         malloc_failed_error(pcb);
     } else  {
@@ -652,7 +694,7 @@ static xpath_resnode_t *
 /********************************************************************
 * FUNCTION new_val_resnode
 * 
-* Get a new result node from the cache or malloc if none available
+* Get a new result node from the resnode pool
 *
 * INPUTS:
 *    pcb == parser control block to use
@@ -667,7 +709,7 @@ static xpath_resnode_t *
 *    valptr == variable pointer value to use
 *
 * RETURNS:
-*    result from the cache or malloced; NULL if malloc fails
+*    result node from the pool; NULL if malloc fails
 *********************************************************************/
 static xpath_resnode_t *
     new_val_resnode (xpath_pcb_t *pcb,
@@ -677,13 +719,7 @@ static xpath_resnode_t *
 {
     xpath_resnode_t  *resnode;
 
-    resnode = (xpath_resnode_t *)dlq_deque(&pcb->resnode_cacheQ);
-    if (resnode) {
-        pcb->resnode_count--;
-    } else {
-        resnode = xpath_new_resnode();
-    }
-
+    resnode = xpath_new_resnode();
     if (!resnode) {
         malloc_failed_error(pcb);
     } else {
@@ -700,7 +736,7 @@ static xpath_resnode_t *
 /********************************************************************
 * FUNCTION free_resnode
 * 
-* Free a result node struct: put in cache or free if cache maxed out
+* Free a result node struct: put it back in the resnode pool
 *
 * INPUTS:
 *    pcb == parser control block to use
@@ -711,13 +747,8 @@ static void
     free_resnode (xpath_pcb_t *pcb,
                   xpath_resnode_t *resnode)
 {
-    if (pcb->resnode_count < XPATH_RESNODE_CACHE_MAX) {
-        xpath_clean_resnode(resnode);
-        dlq_enque(resnode, &pcb->resnode_cacheQ);
-        pcb->resnode_count++;
-    } else {
-        xpath_free_resnode(resnode);
-    }
+    (void)pcb;
+    xpath_free_resnode(resnode);
 
 } /* free_resnode */
 
@@ -1433,6 +1464,457 @@ static boolean
 } /* compare_nodeset_to_other */
 
 
+/********************************************************************
+* FUNCTION get_compare_string
+* 
+* Get the string value of a simple node, the same way
+* compare_walker_fn and top_compare_walker_fn get it
+*
+* INPUTS:
+*    val == simple value node
+*    buffer == scratch buffer to use
+*    buffsize == size of buffer
+*    str == address of return string
+*    malloced == address of return malloced buffer
+*    instr == address of return in-value flag
+*
+* OUTPUTS:
+*   *str == string value; only valid until the next call
+*           if it is in buffer or *malloced
+*   *malloced == buffer to free if the string did not fit
+*                in buffer; NULL if none
+*   *instr == TRUE if *str is the string in val itself
+*   
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    get_compare_string (val_value_t *val,
+                        xmlChar *buffer,
+                        uint32 buffsize,
+                        const xmlChar **str,
+                        xmlChar **malloced,
+                        boolean *instr)
+{
+    val_value_t  *useval;
+    status_t      res;
+    uint32        cnt;
+
+    *str = NULL;
+    *malloced = NULL;
+    *instr = FALSE;
+    res = NO_ERR;
+
+    if (val_is_virtual(val)) {
+        useval = val_get_virtual_value(NULL, val, &res);
+        if (useval == NULL) {
+            return res;
+        }
+    } else {
+        useval = val;
+    }
+
+    if (typ_is_string(val->btyp)) {
+        if (VAL_STR(useval)) {
+            *str = VAL_STR(useval);
+            *instr = (useval == val) ? TRUE : FALSE;
+        } else {
+            *str = EMPTY_STRING;
+        }
+        return NO_ERR;
+    }
+
+    res = val_sprintf_simval_nc(NULL, useval, &cnt);
+    if (res != NO_ERR) {
+        return res;
+    }
+    if (cnt >= buffsize) {
+        *malloced = m__getMem(cnt+1);
+        if (!*malloced) {
+            return ERR_INTERNAL_MEM;
+        }
+        buffer = *malloced;
+    }
+
+    res = val_sprintf_simval_nc(buffer, useval, &cnt);
+    if (res == NO_ERR) {
+        *str = buffer;
+    }
+    return res;
+
+}  /* get_compare_string */
+
+
+/********************************************************************
+* FUNCTION free_strset
+* 
+* Free a string set and the strings it copied
+*
+* INPUTS:
+*    strset == string set to free
+*********************************************************************/
+static void
+    free_strset (xpath_strset_t *strset)
+{
+    uint32  i;
+
+    if (strset->slots) {
+        for (i = 0; i < strset->numslots; i++) {
+            if (strset->slots[i].buff) {
+                m__free(strset->slots[i].buff);
+            }
+        }
+        m__free(strset->slots);
+    }
+    m__free(strset);
+
+}  /* free_strset */
+
+
+/********************************************************************
+* FUNCTION new_strset
+* 
+* Malloc an empty string set
+*
+* RETURNS:
+*   malloced string set or NULL if malloc failed
+*********************************************************************/
+static xpath_strset_t *
+    new_strset (void)
+{
+    xpath_strset_t  *strset;
+
+    strset = m__getObj(xpath_strset_t);
+    if (!strset) {
+        return NULL;
+    }
+    strset->slots = (xpath_strslot_t *)
+        m__getMem(STRSET_MIN_SLOTS * sizeof(xpath_strslot_t));
+    if (!strset->slots) {
+        m__free(strset);
+        return NULL;
+    }
+    memset(strset->slots, 0x0, STRSET_MIN_SLOTS * sizeof(xpath_strslot_t));
+    strset->numslots = STRSET_MIN_SLOTS;
+    strset->numused = 0;
+    return strset;
+
+}  /* new_strset */
+
+
+/********************************************************************
+* FUNCTION find_strset_slot
+* 
+* Find the slot for a string in a string set
+*
+* INPUTS:
+*    strset == string set to search
+*    str == string to find
+*    hash == bobhash of str
+*
+* RETURNS:
+*   the slot holding str, or the empty slot where it goes
+*********************************************************************/
+static xpath_strslot_t *
+    find_strset_slot (xpath_strset_t *strset,
+                      const xmlChar *str,
+                      uint32 hash)
+{
+    xpath_strslot_t  *slot;
+    uint32            i;
+
+    for (i = hash & (strset->numslots - 1);
+         ;
+         i = (i + 1) & (strset->numslots - 1)) {
+        slot = &strset->slots[i];
+        if (slot->str == NULL ||
+            (slot->hash == hash && !xml_strcmp(slot->str, str))) {
+            return slot;
+        }
+    }
+    /*NOTREACHED*/
+
+}  /* find_strset_slot */
+
+
+/********************************************************************
+* FUNCTION add_strset
+* 
+* Add a string to a string set if it is not already there
+* The slots are doubled when the set gets half full
+*
+* INPUTS:
+*    strset == string set to add to
+*    str == string to add
+*    copy == TRUE if str has to be copied;
+*            FALSE if it stays valid as long as the set
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    add_strset (xpath_strset_t *strset,
+                const xmlChar *str,
+                boolean copy)
+{
+    xpath_strslot_t  *slot, *oldslots;
+    uint32            hash, oldnum, i;
+
+    hash = bobhash(str, xml_strlen(str), STRSET_HASH_INIT);
+    slot = find_strset_slot(strset, str, hash);
+    if (slot->str) {
+        return NO_ERR;
+    }
+
+    if (2 * (strset->numused + 1) > strset->numslots) {
+        oldslots = strset->slots;
+        oldnum = strset->numslots;
+        strset->slots = (xpath_strslot_t *)
+            m__getMem(2 * oldnum * sizeof(xpath_strslot_t));
+        if (!strset->slots) {
+            strset->slots = oldslots;
+            return ERR_INTERNAL_MEM;
+        }
+        memset(strset->slots, 0x0, 2 * oldnum * sizeof(xpath_strslot_t));
+        strset->numslots = 2 * oldnum;
+        for (i = 0; i < oldnum; i++) {
+            if (oldslots[i].str) {
+                *find_strset_slot(strset, oldslots[i].str, 
+                                  oldslots[i].hash) = oldslots[i];
+            }
+        }
+        m__free(oldslots);
+        slot = find_strset_slot(strset, str, hash);
+    }
+
+    if (copy) {
+        slot->buff = xml_strdup(str);
+        if (!slot->buff) {
+            return ERR_INTERNAL_MEM;
+        }
+        slot->str = slot->buff;
+    } else {
+        slot->str = str;
+    }
+    slot->hash = hash;
+    strset->numused++;
+    return NO_ERR;
+
+}  /* add_strset */
+
+
+/********************************************************************
+* FUNCTION strset_walker_fn
+* 
+* Add the string value of a simple node to a string set,
+* or check if it is in the set
+*
+* Matches val_walker_fn_t template in val.h
+*
+* INPUTS:
+*    val == value node found in the search
+*    cookie1 == xpath_pcb_t * : parser control block to use
+*               currently not used!!!
+*    cookie2 == strsetparms_t *: walker parms to use
+* OUTPUTS:
+*    *cookie2 contents adjusted  (parms.found and parms.res)
+*
+* RETURNS:
+*    TRUE to keep walk going
+*    FALSE to terminate walk
+*********************************************************************/
+static boolean
+    strset_walker_fn (val_value_t *val,
+                      void *cookie1,
+                      void *cookie2)
+{
+    strsetparms_t    *parms;
+    xpath_strslot_t  *slot;
+    const xmlChar    *str;
+    xmlChar          *malloced;
+    boolean           instr;
+
+    (void)cookie1;
+    parms = (strsetparms_t *)cookie2;
+
+    /* skip all complex nodes */
+    if (!typ_is_simple(val->btyp)) {
+        return TRUE;
+    }
+
+    /* a password in the 2nd nodeset never compares equal */
+    if (parms->skippw && obj_is_password(val->obj)) {
+        return TRUE;
+    }
+
+    parms->res = get_compare_string(val, 
+                                    parms->buffer, 
+                                    parms->buffsize,
+                                    &str, 
+                                    &malloced,
+                                    &instr);
+    if (parms->res == NO_ERR) {
+        if (parms->probe) {
+            slot = find_strset_slot(parms->strset, str, 
+                                    bobhash(str, xml_strlen(str),
+                                            STRSET_HASH_INIT));
+            parms->found = (slot->str) ? TRUE : FALSE;
+        } else {
+            parms->res = add_strset(parms->strset, str, !instr);
+        }
+    }
+
+    if (malloced) {
+        m__free(malloced);
+    }
+    return (parms->res == NO_ERR && !parms->found) ? TRUE : FALSE;
+
+}  /* strset_walker_fn */
+
+
+/********************************************************************
+* FUNCTION walk_strset
+* 
+* Add the string values of all the simple nodes in a nodeset
+* to a string set, or check if any of them is in the set
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    result == nodeset to walk
+*    strset == string set to use
+*    skippw == TRUE if result is the 2nd nodeset of the
+*              comparison, where password leaves never match
+*    probe == TRUE to check the nodes against the set,
+*             FALSE to add them to the set
+*    res == address of return status
+*
+* OUTPUTS:
+*   *res == return status
+*
+* RETURNS:
+*    TRUE if probe and some node string is in the set
+*    FALSE if not found or some error
+*********************************************************************/
+static boolean
+    walk_strset (xpath_pcb_t *pcb,
+                 xpath_result_t *result,
+                 xpath_strset_t *strset,
+                 boolean skippw,
+                 boolean probe,
+                 status_t *res)
+{
+    xpath_resnode_t  *resnode;
+    strsetparms_t     parms;
+    xmlChar           buffer[TEMP_BUFFSIZE];
+    boolean           cfgonly;
+
+    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
+
+    parms.strset = strset;
+    parms.buffer = buffer;
+    parms.buffsize = TEMP_BUFFSIZE;
+    parms.skippw = skippw;
+    parms.probe = probe;
+    parms.found = FALSE;
+    parms.res = NO_ERR;
+
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL && parms.res == NO_ERR && !parms.found;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+        (void)val_find_all_descendants(strset_walker_fn,
+                                       pcb,
+                                       &parms,
+                                       resnode->node.valptr,
+                                       NULL,
+                                       NULL,
+                                       cfgonly,
+                                       FALSE,
+                                       TRUE,
+                                       TRUE);
+    }
+
+    *res = parms.res;
+    return (parms.res == NO_ERR) ? parms.found : FALSE;
+
+}  /* walk_strset */
+
+
+/********************************************************************
+* FUNCTION hash_compare_nodesets
+* 
+* Check if 2 nodesets have a pair of equal node string values,
+* by hashing the strings of 1 nodeset and looking up
+* the strings of the other one
+*
+* A node in val2 (the RHS) that is a password never matches,
+* like in compare_walker_fn
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    val1 == first nodeset to compare
+*    val2 == second nodeset to compare
+*    strset == strings of the hashed nodeset
+*           == NULL to build a temp set from the smaller one
+*    hashval2 == TRUE if strset has the val2 strings,
+*                FALSE if it has the val1 strings
+*    res == address of resturn status
+*
+* OUTPUTS:
+*   *res == return status; the caller does the pairwise
+*           compare instead if this is not NO_ERR
+*
+* RETURNS:
+*    TRUE if a pair of equal strings was found
+*    FALSE if not or some error (check *res)
+*********************************************************************/
+static boolean
+    hash_compare_nodesets (xpath_pcb_t *pcb,
+                           xpath_result_t *val1,
+                           xpath_result_t *val2,
+                           xpath_strset_t *strset,
+                           boolean hashval2,
+                           status_t *res)
+{
+    xpath_strset_t  *tempset;
+    boolean          fnresult;
+
+    tempset = NULL;
+    if (!strset) {
+        hashval2 = (dlq_count(&val2->r.nodeQ) <= 
+                    dlq_count(&val1->r.nodeQ)) ? TRUE : FALSE;
+        tempset = new_strset();
+        if (!tempset) {
+            *res = ERR_INTERNAL_MEM;
+            return FALSE;
+        }
+        (void)walk_strset(pcb, 
+                          (hashval2) ? val2 : val1, 
+                          tempset,
+                          hashval2, 
+                          FALSE, 
+                          res);
+        if (*res != NO_ERR) {
+            free_strset(tempset);
+            return FALSE;
+        }
+        strset = tempset;
+    }
+
+    fnresult = walk_strset(pcb,
+                           (hashval2) ? val1 : val2,
+                           strset,
+                           !hashval2,
+                           TRUE,
+                           res);
+
+    if (tempset) {
+        free_strset(tempset);
+    }
+    return fnresult;
+
+}  /* hash_compare_nodesets */
+
+
 /********************************************************************
 * FUNCTION compare_nodesets
 * 
@@ -1483,6 +1965,22 @@ static boolean
         return FALSE;
     }
 
+    /* match the node strings through a hash once there
+     * are enough node pairs to make it worth building;
+     * on any error the pairwise compare below is done
+     * instead, so the same error is reported
+     */
+    if (exop == XP_EXOP_EQUAL &&
+        (uint64)dlq_count(&val1->r.nodeQ) * 
+        (uint64)dlq_count(&val2->r.nodeQ) >= XPATH_STRSET_MIN) {
+        fnresult = hash_compare_nodesets(pcb, val1, val2, NULL, 
+                                         FALSE, res);
+        if (*res == NO_ERR) {
+            return fnresult;
+        }
+        *res = NO_ERR;
+    }
+
     /* both node-sets have at least 1 node */
     cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
 
@@ -4107,7 +4605,7 @@ static xpath_result_t *
                   status_t  *res)
 {
     xpath_result_t  *parm1, *parm2, *parm3, *result;
-    xmlChar         *p1str, *p2str, *p3str, *writestr;
+    xmlChar         *p1str, *p2str, *p3str, *readstr, *writestr;
     uint32           parmcnt, p1len, p2len, p3len, curpos;
     boolean          done, malloc1, malloc2, malloc3;
 
@@ -4185,16 +4683,17 @@ static xpath_result_t *
             free_result(pcb, result);
             result = NULL;
         } else {
+            readstr = p1str;
             writestr = result->r.str;
 
             /* translate p1str into the result string */
-            while (*p1str) {
+            while (*readstr) {
                 curpos = 0;
                 done = FALSE;
 
                 /* look for a match char in p2str */
                 while (!done && curpos < p2len) {
-                    if (p2str[curpos] == *p1str) {
+                    if (p2str[curpos] == *readstr) {
                         done = TRUE;
                     } else {
                         curpos++;
@@ -4208,10 +4707,10 @@ static xpath_result_t *
                     } /* else drop p1char from result */
                 } else {
                     /* copy p1char to result */
-                    *writestr++ = *p1str;
+                    *writestr++ = *readstr;
                 }
 
-                p1str++;
+                readstr++;
             }
 
             *writestr = 0;
@@ -4858,1125 +5357,872 @@ static xpath_resnode_t *
 
 
 /********************************************************************
-* FUNCTION merge_nodeset
+* FUNCTION resnode_ptr
 * 
-* Add the nodes from val1 into val2
-* that are not already there
+* Get the value or object node pointer of a result node,
+* depending on the current parsing mode
 *
 * INPUTS:
 *    pcb == parser control block to use
-*    result == address of return XPath result nodeset
-*
-* OUTPUTS:
-*    result->nodeQ contents adjusted
+*    resnode == result node to check
 *
+* RETURNS:
+*    node pointer stored in the resnode
 *********************************************************************/
-static void
-    merge_nodeset (xpath_pcb_t *pcb,
-                   xpath_result_t *val1,
-                   xpath_result_t *val2)
+static const void *
+    resnode_ptr (const xpath_pcb_t *pcb,
+                 const xpath_resnode_t *resnode)
 {
-    xpath_resnode_t        *resnode, *findnode;
-
-    if (!pcb->val && !pcb->obj) {
-        return;
+    if (pcb->val) {
+        return resnode->node.valptr;
+    } else {
+        return resnode->node.objptr;
     }
 
-    if (val1->restype != XP_RT_NODESET ||
-        val2->restype != XP_RT_NODESET) {
-        SET_ERROR(ERR_INTERNAL_VAL);
-        return;
-    }
+}  /* resnode_ptr */
 
-    while (!dlq_empty(&val1->r.nodeQ)) {
-        resnode = (xpath_resnode_t *)
-            dlq_deque(&val1->r.nodeQ);
 
-        if (pcb->val) {
-            findnode = find_resnode(pcb, 
-                                    &val2->r.nodeQ,
-                                    resnode->node.valptr);
-        } else {
-            findnode = find_resnode(pcb, 
-                                    &val2->r.nodeQ,
-                                    resnode->node.objptr);
-        }
-        if (findnode) {
-            if (resnode->dblslash) {
-                findnode->dblslash = TRUE;
-            }
-            findnode->position = resnode->position;
-            free_resnode(pcb, resnode);
-        } else {
-            dlq_enque(resnode, &val2->r.nodeQ);
-        }
-    }
+/********************************************************************
+* FUNCTION nodeptr_hash
+* 
+* Get the hash value of a value or object node pointer
+*
+* INPUTS:
+*    ptr == node pointer to hash
+*
+* RETURNS:
+*    hash value
+*********************************************************************/
+static uint32
+    nodeptr_hash (const void *ptr)
+{
+    uint64  h;
 
-}  /* merge_nodeset */
+    /* the low bits of a malloced pointer are always the same */
+    h = (uint64)(size_t)ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32)h;
+
+}  /* nodeptr_hash */
 
 
 /********************************************************************
-* FUNCTION set_nodeset_dblslash
+* FUNCTION init_nodeidx
 * 
-* Set the current nodes dblslash flag
-* to indicate that all unchecked descendants
-* are also represented by this node, for
-* further node-test or predicate testing
+* Initialize a nodeset index for a Q of result nodes
+* Nothing is malloced until the Q has XPATH_NODEIDX_MIN nodes
 *
 * INPUTS:
-*    pcb == parser control block to use
-*    result == address of return XPath result nodeset
-*
-* OUTPUTS:
-*    result->nodeQ contents adjusted
-*
+*    nodeidx == index struct to initialize
+*    nodeQ == Q of xpath_resnode_t to index
+*    numnodes == number of nodes already in the Q
 *********************************************************************/
 static void
-    set_nodeset_dblslash (xpath_pcb_t *pcb,
-                          xpath_result_t *result)
+    init_nodeidx (xpath_nodeidx_t *nodeidx,
+                  dlq_hdr_t *nodeQ,
+                  uint32 numnodes)
 {
-    xpath_resnode_t        *resnode;
+    nodeidx->nodeQ = nodeQ;
+    nodeidx->buckets = NULL;
+    nodeidx->numbuckets = 0;
+    nodeidx->numnodes = numnodes;
 
-    if (!pcb->val && !pcb->obj) {
-        return;
-    }
+}  /* init_nodeidx */
 
-    for (resnode = (xpath_resnode_t *)
-             dlq_firstEntry(&result->r.nodeQ);
-         resnode != NULL;
-         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
 
-        resnode->dblslash = TRUE;
+/********************************************************************
+* FUNCTION clean_nodeidx
+* 
+* Free the buckets in a nodeset index
+* The indexed Q is not changed
+*
+* INPUTS:
+*    nodeidx == index struct to clean
+*********************************************************************/
+static void
+    clean_nodeidx (xpath_nodeidx_t *nodeidx)
+{
+    if (nodeidx->buckets) {
+        m__free(nodeidx->buckets);
+        nodeidx->buckets = NULL;
     }
+    nodeidx->numbuckets = 0;
 
-}  /* set_nodeset_dblslash */
+}  /* clean_nodeidx */
 
 
 /********************************************************************
-* FUNCTION value_walker_fn
+* FUNCTION insert_nodeidx
 * 
-* Check the current found value node, based on the
-* criteria passed to the search function
-*
-* Matches val_walker_fn_t template in val.h
+* Add a result node to the end of its hash chain
+* The node must already be in the indexed Q
 *
 * INPUTS:
-*    val == value node found in the search
-*    cookie1 == xpath_pcb_t * : parser control block to use
-*    cookie2 == xpath_walkerparms_t *: walker parms to use
-*
-* OUTPUTS:
-*    result->nodeQ contents adjusted or replaced
-*
-* RETURNS:
-*    TRUE to keep walk going
-*    FALSE to terminate walk
+*    pcb == parser control block to use
+*    nodeidx == index with the buckets malloced
+*    resnode == result node to add
 *********************************************************************/
-static boolean
-    value_walker_fn (val_value_t *val,
-                     void *cookie1,
-                     void *cookie2)
+static void
+    insert_nodeidx (xpath_pcb_t *pcb,
+                    xpath_nodeidx_t *nodeidx,
+                    xpath_resnode_t *resnode)
 {
-    xpath_pcb_t          *pcb;
-    xpath_walkerparms_t  *parms;
-    xpath_resnode_t      *newresnode;
-    val_value_t          *child;
-    int64                 position;
-    boolean               done;
+    xpath_resnode_t  **link;
+    uint32             slot;
 
-    pcb = (xpath_pcb_t *)cookie1;
-    parms = (xpath_walkerparms_t *)cookie2;
+    slot = nodeptr_hash(resnode_ptr(pcb, resnode)) &
+        (nodeidx->numbuckets - 1);
 
-    /* check if this node is already in the result */
-    if (find_resnode(pcb, parms->resnodeQ, val)) {
-        return TRUE;
+    /* keep each chain in Q order, so the first
+     * duplicate found is the same as a Q scan
+     */
+    link = &nodeidx->buckets[slot];
+    while (*link) {
+        link = &(*link)->hashnext;
     }
+    *link = resnode;
+    resnode->hashnext = NULL;
 
-    if (obj_is_root(val->obj) || val->parent==NULL) {
-        position = 1;
-    } else {
-        position = 0;
-        done = FALSE;
-        for (child = val_get_first_child(val->parent);
-             child != NULL && !done;
-             child = val_get_next_child(child)) {
-            position++;
-            if (child == val) {
-                done = TRUE;
-            }
-        }
-    }
+}  /* insert_nodeidx */
 
-    ++parms->callcount;
 
-    /* need to add this node */
-    newresnode = new_val_resnode(pcb, 
-                                 position,
-                                 FALSE,
-                                 val);
-    if (!newresnode) {
-        parms->res = ERR_INTERNAL_MEM;
-        return FALSE;
-    }
+/********************************************************************
+* FUNCTION remove_nodeidx
+* 
+* Remove a result node from its hash chain
+* The indexed Q is not changed
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == index with the buckets malloced
+*    resnode == result node to remove
+*********************************************************************/
+static void
+    remove_nodeidx (xpath_pcb_t *pcb,
+                    xpath_nodeidx_t *nodeidx,
+                    xpath_resnode_t *resnode)
+{
+    xpath_resnode_t  **link;
+    uint32             slot;
 
-    dlq_enque(newresnode, parms->resnodeQ);
-    return TRUE;
+    slot = nodeptr_hash(resnode_ptr(pcb, resnode)) &
+        (nodeidx->numbuckets - 1);
 
-}  /* value_walker_fn */
+    for (link = &nodeidx->buckets[slot];
+         *link != NULL;
+         link = &(*link)->hashnext) {
+        if (*link == resnode) {
+            *link = resnode->hashnext;
+            resnode->hashnext = NULL;
+            return;
+        }
+    }
+
+}  /* remove_nodeidx */
 
 
 /********************************************************************
-* FUNCTION object_walker_fn
+* FUNCTION build_nodeidx
 * 
-* Check the current found object node, based on the
-* criteria passed to the search function
-*
-* Matches obj_walker_fn_t template in obj.h
+* Malloc the buckets for a nodeset index and add
+* all the nodes in the indexed Q
+* Any old buckets are replaced
 *
 * INPUTS:
-*    val == value node found in the search
-*    cookie1 == xpath_pcb_t * : parser control block to use
-*    cookie2 == xpath_walkerparms_t *: walker parms to use
-*
-* OUTPUTS:
-*    result->nodeQ contents adjusted or replaced
+*    pcb == parser control block to use
+*    nodeidx == index to build
 *
 * RETURNS:
-*    TRUE to keep walk going
-*    FALSE to terminate walk
+*    status; the index is left without buckets if malloc fails
 *********************************************************************/
-static boolean
-    object_walker_fn (obj_template_t *obj,
-                      void *cookie1,
-                      void *cookie2)
+static status_t
+    build_nodeidx (xpath_pcb_t *pcb,
+                   xpath_nodeidx_t *nodeidx)
 {
-    xpath_pcb_t          *pcb;
-    xpath_walkerparms_t  *parms;
-    xpath_resnode_t      *newresnode;
+    xpath_resnode_t  *resnode;
+    uint32            numbuckets;
 
-    pcb = (xpath_pcb_t *)cookie1;
-    parms = (xpath_walkerparms_t *)cookie2;
+    numbuckets = 2 * XPATH_NODEIDX_MIN;
+    while (numbuckets < nodeidx->numnodes) {
+        numbuckets *= 2;
+    }
 
-    /* check if this node is already in the result */
-    if (find_resnode(pcb, parms->resnodeQ, obj)) {
-        return TRUE;
+    clean_nodeidx(nodeidx);
+    nodeidx->buckets = (xpath_resnode_t **)
+        m__getMem(numbuckets * sizeof(xpath_resnode_t *));
+    if (!nodeidx->buckets) {
+        return ERR_INTERNAL_MEM;
     }
+    memset(nodeidx->buckets, 0x0, 
+           numbuckets * sizeof(xpath_resnode_t *));
+    nodeidx->numbuckets = numbuckets;
 
-    /* need to add this child node 
-     * the position is wrong but it will not really matter
-     */
-    newresnode = new_obj_resnode(pcb, 
-                                 ++parms->callcount, 
-                                 FALSE,
-                                 obj);
-    if (!newresnode) {
-        parms->res = ERR_INTERNAL_MEM;
-        return FALSE;
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(nodeidx->nodeQ);
+         resnode != NULL;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+        insert_nodeidx(pcb, nodeidx, resnode);
     }
 
-    dlq_enque(newresnode, parms->resnodeQ);
-    return TRUE;
+    return NO_ERR;
 
-}  /* object_walker_fn */
+}  /* build_nodeidx */
 
 
 /********************************************************************
-* FUNCTION set_nodeset_self
+* FUNCTION find_nodeidx
 * 
-* Check the current result nodeset and keep each
-* node, or remove it if filter tests fail
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* Check if the specified resnode ptr is already in an indexed Q
+* The Q is scanned with find_resnode until it is big enough
+* to be worth hashing
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    result == address of return XPath result nodeset
-*    nsid == 0 if any namespace is OK
-*              else only this namespace will be checked
-*    name == name of parent to find
-*         == NULL to find any parent name
-*    textmode == TRUE if just selecting text() nodes
-*                FALSE if ignored
-*
-* OUTPUTS:
-*    result->nodeQ contents adjusted or removed
+*    pcb == parser control block to use
+*    nodeidx == index of the Q of xpath_resnode_t structs to check
+*    ptr   == pointer value to find
 *
 * RETURNS:
-*    status
+*    found resnode or NULL if not found
 *********************************************************************/
-static status_t
-    set_nodeset_self (xpath_pcb_t *pcb,
-                      xpath_result_t *result,
-                      xmlns_id_t nsid,
-                      const xmlChar *name,
-                      boolean textmode)
+static xpath_resnode_t *
+    find_nodeidx (xpath_pcb_t *pcb,
+                  xpath_nodeidx_t *nodeidx,
+                  const void *ptr)
 {
-    xpath_resnode_t        *resnode, *findnode;
-    obj_template_t         *testobj;
-    const xmlChar           *modname;
-    val_value_t            *testval;
-    boolean                 keep, cfgonly, fnresult, fncalled, useroot;
-    dlq_hdr_t               resnodeQ;
-    status_t                res;
-    xpath_walkerparms_t     walkerparms;
+    xpath_resnode_t  *resnode;
 
-    if (!pcb->val && !pcb->obj) {
-        return NO_ERR;
+    if (!nodeidx->buckets) {
+        if (nodeidx->numnodes < XPATH_NODEIDX_MIN ||
+            build_nodeidx(pcb, nodeidx) != NO_ERR) {
+            return find_resnode(pcb, nodeidx->nodeQ, ptr);
+        }
     }
 
-    if (dlq_empty(&result->r.nodeQ)) {
-        return NO_ERR;
+    for (resnode = nodeidx->buckets[nodeptr_hash(ptr) & 
+                                    (nodeidx->numbuckets - 1)];
+         resnode != NULL;
+         resnode = resnode->hashnext) {
+        if (resnode_ptr(pcb, resnode) == ptr) {
+            return resnode;
+        }
     }
+    return NULL;
 
-    dlq_createSQue(&resnodeQ);
+}  /* find_nodeidx */
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
 
-    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
-    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+/********************************************************************
+* FUNCTION add_nodeidx
+* 
+* Add a result node to the end of an indexed Q
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == index of the Q to add the node to
+*    resnode == result node to add
+*********************************************************************/
+static void
+    add_nodeidx (xpath_pcb_t *pcb,
+                 xpath_nodeidx_t *nodeidx,
+                 xpath_resnode_t *resnode)
+{
+    dlq_enque(resnode, nodeidx->nodeQ);
+    nodeidx->numnodes++;
 
-    res = NO_ERR;
+    if (!nodeidx->buckets) {
+        return;
+    }
 
-    /* the resnodes need to be deleted or moved to a tempQ
-     * to correctly track duplicates and remove them
-     */
-    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
+    if (nodeidx->numnodes > nodeidx->numbuckets) {
+        /* falls back to a Q scan if the malloc fails */
+        (void)build_nodeidx(pcb, nodeidx);
+    } else {
+        insert_nodeidx(pcb, nodeidx, resnode);
+    }
 
-        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
+}  /* add_nodeidx */
 
-        if (resnode->dblslash) {
-            if (pcb->val) {
-                testval = resnode->node.valptr;
-                cfgonly = obj_is_config(testval->obj);
 
-                fnresult = 
-                    val_find_all_descendants(value_walker_fn,
-                                             pcb, 
-                                             &walkerparms,
-                                             testval, 
-                                             modname,
-                                             name,
-                                             cfgonly,
-                                             textmode,
-                                             TRUE,
-                                             FALSE);
-            } else {
-                testobj = resnode->node.objptr;
-                cfgonly = obj_is_config(testobj);
-
-                fnresult = 
-                    obj_find_all_descendants(pcb->objmod,
-                                             object_walker_fn,
-                                             pcb, 
-                                             &walkerparms,
-                                             testobj,
-                                             modname,
-                                             name,
-                                             cfgonly,
-                                             textmode,
-                                             useroot,
-                                             TRUE,
-                                             &fncalled);
-            }
-
-            if (!fnresult || walkerparms.res != NO_ERR) {
-                res = walkerparms.res;
-            }
-            free_resnode(pcb, resnode);
-        } else {
-            keep = FALSE;
+/********************************************************************
+* FUNCTION docpos_slot
+* 
+* Find the slot for a value node in a sibling position map
+*
+* INPUTS:
+*    posmap == position map to search
+*    val == value node to find
+*
+* RETURNS:
+*    pointer to the slot for val; slot->val is NULL
+*    if the node is not in the map yet
+*********************************************************************/
+static docpos_t *
+    docpos_slot (docposmap_t *posmap,
+                 const val_value_t *val)
+{
+    uint32  slot, mask;
 
-            if (pcb->val) {
-                testval = resnode->node.valptr;
-            
-                if (textmode) {
-                    if (obj_has_text_content(testval->obj)) {
-                        keep = TRUE;
-                    }
-                } else if (modname && name) {
-                    if (!xml_strcmp(modname,
-                                    val_get_mod_name(testval)) &&
-                        !xml_strcmp(name, testval->name)) {
-                        keep = TRUE;
-                    }
+    mask = posmap->numslots - 1;
+    slot = nodeptr_hash(val) & mask;
+    while (posmap->slots[slot].val != NULL &&
+           posmap->slots[slot].val != val) {
+        slot = (slot + 1) & mask;
+    }
+    return &posmap->slots[slot];
 
-                } else if (modname) {
-                    if (!xml_strcmp(modname,
-                                    val_get_mod_name(testval))) {
-                        keep = TRUE;
-                    }
-                } else if (name) {
-                    if (!xml_strcmp(name, testval->name)) {
-                        keep = TRUE;
-                    }
-                } else {
-                    keep = TRUE;
-                }
+}  /* docpos_slot */
 
-                if (keep) {
-                    findnode = find_resnode(pcb, 
-                                            &resnodeQ, 
-                                            testval);
-                    if (findnode) {
-                        if (resnode->dblslash) {
-                            findnode->dblslash = TRUE;
-                            findnode->position = 
-                                ++walkerparms.callcount;
-                        }
-                        free_resnode(pcb, resnode);
-                    } else {
-                        /* set the resnode to its parent */
-                        resnode->node.valptr = testval;
-                        resnode->position = 
-                            ++walkerparms.callcount;
-                        dlq_enque(resnode, &resnodeQ);
-                    }
-                } else {
-                    free_resnode(pcb, resnode);
-                }
-            } else {
-                testobj = resnode->node.objptr;
 
-                if (textmode) {
-                    if (obj_has_text_content(testobj)) {
-                        keep = TRUE;
-                    }
-                } else if (modname && name) {
-                    if (!xml_strcmp(modname,
-                                    obj_get_mod_name(testobj)) &&
-                        !xml_strcmp(name, obj_get_name(testobj))) {
-                        keep = TRUE;
-                    }
-                } else if (modname) {
-                    if (!xml_strcmp(modname,
-                                    obj_get_mod_name(testobj))) {
-                        keep = TRUE;
-                    }
-                } else if (name) {
-                    if (!xml_strcmp(name, obj_get_name(testobj))) {
-                        keep = TRUE;
-                    }
-                } else {
-                    keep = TRUE;
-                }
+/********************************************************************
+* FUNCTION docpos_add_children
+* 
+* Add the sibling position of every child of a value node
+* to a sibling position map
+*
+* INPUTS:
+*    posmap == position map to fill in
+*    parent == value node with the children to add
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    docpos_add_children (docposmap_t *posmap,
+                         const val_value_t *parent)
+{
+    docposmap_t   newmap;
+    docpos_t     *slot;
+    val_value_t  *child;
+    uint32        i, position;
 
-                if (keep) {
-                    findnode = find_resnode(pcb, 
-                                            &resnodeQ, 
-                                            testobj);
-                    if (findnode) {
-                        if (resnode->dblslash) {
-                            findnode->dblslash = TRUE;
-                            findnode->position = 
-                                ++walkerparms.callcount;
-                        }
-                        free_resnode(pcb, resnode);
-                    } else {
-                        /* set the resnode to its parent */
-                        resnode->node.objptr = testobj;
-                        resnode->position =
-                            ++walkerparms.callcount;
-                        dlq_enque(resnode, &resnodeQ);
-                    }
-                } else {
-                    if (pcb->logerrors && 
-                        ncx_warning_enabled(ERR_NCX_NO_XPATH_NODES)) {
-                        log_warn("\nWarning: no self node found "
-                                 "in XPath expr '%s'", 
-                                 pcb->exprstr);
-                        ncx_print_errormsg(pcb->tkc, 
-                                           pcb->objmod, 
-                                           ERR_NCX_NO_XPATH_NODES);
-                    } else if (pcb->objmod != NULL) {
-                        ncx_inc_warnings(pcb->objmod);
-                    }
-                    free_resnode(pcb, resnode);
+    position = 0;
+    for (child = val_get_first_child(parent);
+         child != NULL;
+         child = val_get_next_child(child)) {
+
+        /* keep the map at most half full */
+        if (2 * (posmap->numused + 1) > posmap->numslots) {
+            newmap.numslots = 2 * posmap->numslots;
+            newmap.numused = posmap->numused;
+            newmap.slots = (docpos_t *)
+                m__getMem(newmap.numslots * sizeof(docpos_t));
+            if (!newmap.slots) {
+                return ERR_INTERNAL_MEM;
+            }
+            memset(newmap.slots, 0x0, 
+                   newmap.numslots * sizeof(docpos_t));
+            for (i = 0; i < posmap->numslots; i++) {
+                if (posmap->slots[i].val) {
+                    *docpos_slot(&newmap, posmap->slots[i].val) =
+                        posmap->slots[i];
                 }
             }
+            m__free(posmap->slots);
+            *posmap = newmap;
+        }
+
+        position++;
+        slot = docpos_slot(posmap, child);
+        if (slot->val == NULL) {
+            slot->val = child;
+            slot->position = position;
+            posmap->numused++;
         }
     }
 
-    /* put the resnode entries back where they belong */
-    if (!dlq_empty(&resnodeQ)) {
-        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
+    return NO_ERR;
+
+}  /* docpos_add_children */
+
+
+/********************************************************************
+* FUNCTION docpos_get
+* 
+* Get the position of a value node among its siblings
+* All the siblings are numbered the first time
+* one of them is needed
+*
+* INPUTS:
+*    posmap == position map to use
+*    val == value node with a parent
+*    res == address of return status
+*
+* OUTPUTS:
+*   *res == status
+*
+* RETURNS:
+*    sibling position, starting from 1
+*********************************************************************/
+static uint32
+    docpos_get (docposmap_t *posmap,
+                const val_value_t *val,
+                status_t *res)
+{
+    docpos_t  *slot;
+
+    slot = docpos_slot(posmap, val);
+    if (slot->val == NULL) {
+        *res = docpos_add_children(posmap, val->parent);
+        if (*res != NO_ERR) {
+            return 0;
+        }
+        slot = docpos_slot(posmap, val);
     }
+    return slot->position;
 
-    result->last = walkerparms.callcount;
+}  /* docpos_get */
 
-    return res;
 
-}  /* set_nodeset_self */
+/********************************************************************
+* FUNCTION compare_docnodes
+* 
+* Compare 2 nodes by document order; qsort callback
+*
+* INPUTS:
+*    p1 == docnode_t for node 1
+*    p2 == docnode_t for node 2
+*
+* RETURNS:
+*    -1, 0 or 1 as node 1 comes before, with or after node 2
+*********************************************************************/
+static int
+    compare_docnodes (const void *p1,
+                      const void *p2)
+{
+    const docnode_t  *d1, *d2;
+    uint32            i;
+
+    d1 = (const docnode_t *)p1;
+    d2 = (const docnode_t *)p2;
+
+    for (i = 0; i < d1->keylen && i < d2->keylen; i++) {
+        if (d1->key[i] != d2->key[i]) {
+            return (d1->key[i] < d2->key[i]) ? -1 : 1;
+        }
+    }
+
+    /* an ancestor comes before its descendants */
+    if (d1->keylen != d2->keylen) {
+        return (d1->keylen < d2->keylen) ? -1 : 1;
+    }
+    return 0;
+
+}  /* compare_docnodes */
 
 
 /********************************************************************
-* FUNCTION set_nodeset_parent
+* FUNCTION sort_nodeset_docorder
 * 
-* Check the current result nodeset and move each
-* node to its parent, or remove it if no parent
+* Sort the value nodes in a nodeset into document order
 *
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* Each node gets a key with the sibling positions of
+* all its ancestors, so each set of siblings is only
+* walked once, not once per comparison.
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    result == address of return XPath result nodeset
-*    nsid == 0 if any namespace is OK
-*              else only this namespace will be checked
-*    name == name of parent to find
-*         == NULL to find any parent name
+*    result == value nodeset to sort
 *
 * OUTPUTS:
-*    result->nodeQ contents adjusted or removed
+*    result->nodeQ contents reordered
 *
 * RETURNS:
-*    status
+*    status; the nodes are left in Q order if a malloc fails
 *********************************************************************/
 static status_t
-    set_nodeset_parent (xpath_pcb_t *pcb,
-                        xpath_result_t *result,
-                        xmlns_id_t nsid,
-                        const xmlChar *name)
+    sort_nodeset_docorder (xpath_result_t *result)
 {
-    xpath_resnode_t        *resnode, *findnode;
-    obj_template_t         *testobj, *useobj;
-    const xmlChar           *modname;
-    val_value_t            *testval;
-    boolean                 keep, cfgonly, fnresult, fncalled, useroot;
-    dlq_hdr_t               resnodeQ;
-    status_t                res;
-    xpath_walkerparms_t     walkerparms;
-    int64                   position;
-
-
-    if (!pcb->val && !pcb->obj) {
+    xpath_resnode_t    *resnode;
+    const val_value_t  *val;
+    docnode_t          *docnodes;
+    uint32             *keys, *key;
+    docposmap_t         posmap;
+    uint32              numnodes, keytotal, depth, i;
+    status_t            res;
+
+    numnodes = 0;
+    keytotal = 0;
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+        numnodes++;
+        for (val = resnode->node.valptr; val->parent; val = val->parent) {
+            keytotal++;
+        }
+    }
+    if (numnodes < 2) {
         return NO_ERR;
     }
 
-    if (dlq_empty(&result->r.nodeQ)) {
-        return NO_ERR;
+    docnodes = (docnode_t *)
+        m__getMem(numnodes * sizeof(docnode_t) + 
+                  (keytotal + 1) * sizeof(uint32));
+    if (!docnodes) {
+        return ERR_INTERNAL_MEM;
     }
+    keys = (uint32 *)&docnodes[numnodes];
 
-    dlq_createSQue(&resnodeQ);
+    posmap.numslots = DOCPOS_MIN_SLOTS;
+    posmap.numused = 0;
+    posmap.slots = (docpos_t *)
+        m__getMem(posmap.numslots * sizeof(docpos_t));
+    if (!posmap.slots) {
+        m__free(docnodes);
+        return ERR_INTERNAL_MEM;
+    }
+    memset(posmap.slots, 0x0, posmap.numslots * sizeof(docpos_t));
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
+    res = NO_ERR;
+    key = keys;
+    i = 0;
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL && res == NO_ERR;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
 
-    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
-    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+        depth = 0;
+        for (val = resnode->node.valptr; val->parent; val = val->parent) {
+            depth++;
+        }
 
-    res = NO_ERR;
-    position = 0;
+        docnodes[i].resnode = resnode;
+        docnodes[i].key = key;
+        docnodes[i].keylen = depth;
 
-    /* the resnodes need to be deleted or moved to a tempQ
-     * to correctly track duplicates and remove them
-     */
-    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
+        /* fill in the key from the node up to the root */
+        for (val = resnode->node.valptr; 
+             val->parent && res == NO_ERR; 
+             val = val->parent) {
+            key[--depth] = docpos_get(&posmap, val, &res);
+        }
+        key += docnodes[i].keylen;
+        i++;
+    }
 
-        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
+    m__free(posmap.slots);
 
-        if (resnode->dblslash) {
-            if (pcb->val) {
-                testval = resnode->node.valptr;
-                cfgonly = obj_is_config(testval->obj);
+    if (res == NO_ERR) {
+        qsort(docnodes, numnodes, sizeof(docnode_t), compare_docnodes);
 
-                fnresult = 
-                    val_find_all_descendants(value_walker_fn,
-                                             pcb, 
-                                             &walkerparms,
-                                             testval, 
-                                             modname,
-                                             name,
-                                             cfgonly,
-                                             FALSE,
-                                             TRUE,
-                                             FALSE);
-            } else {
-                testobj = resnode->node.objptr;
-                cfgonly = obj_is_config(testobj);
-
-                fnresult = 
-                    obj_find_all_descendants(pcb->objmod,
-                                             object_walker_fn,
-                                             pcb, 
-                                             &walkerparms,
-                                             testobj,
-                                             modname,
-                                             name,
-                                             cfgonly,
-                                             FALSE,
-                                             useroot,
-                                             TRUE,
-                                             &fncalled);
-            }
-
-            if (!fnresult || walkerparms.res != NO_ERR) {
-                res = walkerparms.res;
-            }
-            free_resnode(pcb, resnode);
-        } else {
-            keep = FALSE;
-
-            if (pcb->val) {
-                testval = resnode->node.valptr;
-            
-                if (testval == pcb->val_docroot) {
-                    if (resnode->dblslash) {
-                        /* just move this node to the result */
-                        resnode->position = ++position;
-                        dlq_enque(resnode, &resnodeQ);
-                    } else {
-                        /* no parent available error
-                         * remove node from result 
-                         */
-                        no_parent_warning(pcb);
-                        free_resnode(pcb, resnode);
-                    }
-                } else {
-                    testval = testval->parent;
-                    
-                    if (modname && name) {
-                        if (!xml_strcmp(modname,
-                                        val_get_mod_name(testval)) &&
-                            !xml_strcmp(name, testval->name)) {
-                            keep = TRUE;
-                        }
-                    } else if (modname) {
-                        if (!xml_strcmp(modname,
-                                        val_get_mod_name(testval))) {
-                            keep = TRUE;
-                        }
-                    } else if (name) {
-                        if (!xml_strcmp(name, testval->name)) {
-                            keep = TRUE;
-                        }
-                    } else {
-                        keep = TRUE;
-                    }
-
-                    if (keep) {
-                        findnode = find_resnode(pcb, 
-                                                &resnodeQ, 
-                                                testval);
-                        if (findnode) {
-                            /* parent already in the Q
-                             * remove node from result 
-                             */
-                            if (resnode->dblslash) {
-                                findnode->position = ++position;
-                                findnode->dblslash = TRUE;
-                            }
-                            free_resnode(pcb, resnode);
-                        } else {
-                            /* set the resnode to its parent */
-                            resnode->position = ++position;
-                            resnode->node.valptr = testval;
-                            dlq_enque(resnode, &resnodeQ);
-                        }
-                    } else {
-                        /* no parent available error
-                         * remove node from result 
-                         */
-                        no_parent_warning(pcb);
-                        free_resnode(pcb, resnode);
-                    }
-                }
-            } else {
-                testobj = resnode->node.objptr;
-                if (testobj == pcb->docroot) {
-                    resnode->position = ++position;
-                    dlq_enque(resnode, &resnodeQ);
-                } else if (!testobj->parent) {
-                    if (!resnode->dblslash && (modname || name)) {
-                        no_parent_warning(pcb);
-                        free_resnode(pcb, resnode);
-                    } else {
-                        /* this is a databd node */
-                        findnode = find_resnode(pcb, 
-                                                &resnodeQ, 
-                                                pcb->docroot);
-                        if (findnode) {
-                            if (resnode->dblslash) {
-                                findnode->position = ++position;
-                                findnode->dblslash = TRUE;
-                            }
-                            free_resnode(pcb, resnode);
-                        } else {
-                            resnode->position = ++position;
-                            resnode->node.objptr = pcb->docroot;
-                            dlq_enque(resnode, &resnodeQ);
-                        }
-                    }
-                } else {
-                    /* find a parent but not a case or choice */
-                    testobj = testobj->parent;
-                    while (testobj && testobj->parent && 
-                           !obj_is_root(testobj->parent) &&
-                           (testobj->objtype==OBJ_TYP_CHOICE ||
-                            testobj->objtype==OBJ_TYP_CASE)) {
-                        testobj = testobj->parent;
-                    }
-
-                    /* check if stopped on top-level choice
-                     * a top-level case should not happen
-                     * but check it anyway
-                     */
-                    if (testobj->objtype==OBJ_TYP_CHOICE ||
-                        testobj->objtype==OBJ_TYP_CASE) {
-                        useobj = pcb->docroot;
-                    } else {
-                        useobj = testobj;
-                    }
-
-                    if (modname && name) {
-                        if (!xml_strcmp(modname,
-                                        obj_get_mod_name(useobj)) &&
-                            !xml_strcmp(name, obj_get_name(useobj))) {
-                            keep = TRUE;
-                        }
-                    } else if (modname) {
-                        if (!xml_strcmp(modname,
-                                        obj_get_mod_name(useobj))) {
-                            keep = TRUE;
-                        }
-                    } else if (name) {
-                        if (!xml_strcmp(name, obj_get_name(useobj))) {
-                            keep = TRUE;
-                        }
-                    } else {
-                        keep = TRUE;
-                    }
-
-                    if (keep) {
-                        /* replace this node with the useobj */
-                        findnode = find_resnode(pcb, &resnodeQ, useobj);
-                        if (findnode) {
-                            if (resnode->dblslash) {
-                                findnode->position = ++position;
-                                findnode->dblslash = TRUE;
-                            }
-                            free_resnode(pcb, resnode);
-                        } else {
-                            resnode->node.objptr = useobj;
-                            resnode->position = ++position;
-                            dlq_enque(resnode, &resnodeQ);
-                        }
-                    } else {
-                        no_parent_warning(pcb);
-                        free_resnode(pcb, resnode);
-                    }
-                }
-            }
+        for (i = 0; i < numnodes; i++) {
+            dlq_remove(docnodes[i].resnode);
+            dlq_enque(docnodes[i].resnode, &result->r.nodeQ);
         }
     }
 
-    /* put the resnode entries back where they belong */
-    if (!dlq_empty(&resnodeQ)) {
-        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
-    }
-
-    result->last = (position) ? position : walkerparms.callcount;
-
+    m__free(docnodes);
     return res;
 
-}  /* set_nodeset_parent */
+}  /* sort_nodeset_docorder */
 
 
 /********************************************************************
-* FUNCTION set_nodeset_child
+* FUNCTION merge_nodeset
 * 
-* Check the current result nodeset and replace
-* each node with a node for every child instead
-*
-* Handles child and descendant nodes
-*
-* If a child is specified then any node not
-* containing this child will be removed
+* Add the nodes from val1 into val2
+* that are not already there
 *
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* Value nodes are put in document order if both
+* nodesets had nodes; object nodes are appended
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    result == address of return XPath result nodeset
-*    childnsid == 0 if any namespace is OK
-*                 else only this namespace will be checked
-*    childname == name of child to find
-*              == NULL to find all child nodes
-*                 In this mode, if the context object
-*                 is config=true, then config=false
-*                 children will be skipped
-*    textmode == TRUE if just selecting text() nodes
-*                FALSE if ignored
-*     axis == actual axis used
+*    pcb == parser control block to use
+*    val1 == nodeset to merge; emptied
+*    val2 == nodeset to merge into
 *
 * OUTPUTS:
-*    result->nodeQ contents adjusted or replaced
+*    val2->nodeQ contents adjusted
 *
-* RETURNS:
-*    status
 *********************************************************************/
-static status_t
-    set_nodeset_child (xpath_pcb_t *pcb,
-                       xpath_result_t *result,
-                       xmlns_id_t  childnsid,
-                       const xmlChar *childname,
-                       boolean textmode,
-                       ncx_xpath_axis_t axis)
+static void
+    merge_nodeset (xpath_pcb_t *pcb,
+                   xpath_result_t *val1,
+                   xpath_result_t *val2)
 {
-    xpath_resnode_t      *resnode;
-    obj_template_t       *testobj;
-    val_value_t          *testval;
-    const xmlChar        *modname;
-    status_t              res;
-    boolean               fnresult, fncalled, cfgonly;
-    boolean               orself, myorself, useroot;
-    dlq_hdr_t             resnodeQ;
-    xpath_walkerparms_t   walkerparms;
+    xpath_resnode_t        *resnode, *findnode;
+    xpath_nodeidx_t         nodeidx;
+    boolean                 wasempty, added;
 
     if (!pcb->val && !pcb->obj) {
-        return NO_ERR;
+        return;
     }
 
-    if (dlq_empty(&result->r.nodeQ)) {
-        return NO_ERR;
+    if (val1->restype != XP_RT_NODESET ||
+        val2->restype != XP_RT_NODESET) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return;
     }
 
-    dlq_createSQue(&resnodeQ);
-    res = NO_ERR;
-    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
-    orself = (axis == XP_AX_DESCENDANT_OR_SELF) ? TRUE : FALSE;
-    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+    init_nodeidx(&nodeidx, 
+                 &val2->r.nodeQ, 
+                 (uint32)dlq_count(&val2->r.nodeQ));
+    wasempty = (nodeidx.numnodes == 0) ? TRUE : FALSE;
+    added = FALSE;
 
-    if (childnsid) {
-        modname = xmlns_get_module(childnsid);
-    } else {
-        modname = NULL;
+    while (!dlq_empty(&val1->r.nodeQ)) {
+        resnode = (xpath_resnode_t *)
+            dlq_deque(&val1->r.nodeQ);
+
+        findnode = find_nodeidx(pcb, 
+                                &nodeidx, 
+                                resnode_ptr(pcb, resnode));
+        if (findnode) {
+            if (resnode->dblslash) {
+                findnode->dblslash = TRUE;
+            }
+            findnode->position = resnode->position;
+            free_resnode(pcb, resnode);
+        } else {
+            add_nodeidx(pcb, &nodeidx, resnode);
+            added = TRUE;
+        }
     }
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
-
-    /* the resnodes need to be deleted or moved to a tempQ
-     * to correctly track duplicates and remove them
-     */
-    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
-
-        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
-        myorself = (orself || resnode->dblslash) ? TRUE : FALSE;
+    clean_nodeidx(&nodeidx);
 
-        /* select 1 or all children of the resnode 
-         * special YANG support; skip over nodes that
-         * are not config nodes if they were selected
-         * by the wildcard '*' operator
-         */
-        if (pcb->val) {
+    /* the union is still a valid nodeset if the sort fails */
+    if (pcb->val && added && !wasempty) {
+        (void)sort_nodeset_docorder(val2);
+    }
 
-            testval = resnode->node.valptr;
+}  /* merge_nodeset */
 
-            if (axis != XP_AX_CHILD || resnode->dblslash) {
-                fnresult = 
-                    val_find_all_descendants(value_walker_fn,
-                                             pcb, 
-                                             &walkerparms,
-                                             testval, 
-                                             modname,
-                                             childname,
-                                             cfgonly,
-                                             textmode,
-                                             myorself,
-                                             resnode->dblslash);
-                if (!fnresult || walkerparms.res != NO_ERR) {
-                    res = walkerparms.res;
-                }
-            } else {
-                fnresult = 
-                    val_find_all_children(value_walker_fn,
-                                          pcb, 
-                                          &walkerparms,
-                                          testval, 
-                                          modname,
-                                          childname,
-                                          cfgonly,
-                                          textmode);
-                if (!fnresult || walkerparms.res != NO_ERR) {
-                    res = walkerparms.res;
-                }
-            }
-        } else {
-            testobj = resnode->node.objptr;
 
-            if (axis != XP_AX_CHILD || resnode->dblslash) {
-                fnresult = 
-                    obj_find_all_descendants(pcb->objmod,
-                                             object_walker_fn,
-                                             pcb, 
-                                             &walkerparms,
-                                             testobj,
-                                             modname,
-                                             childname,
-                                             cfgonly,
-                                             textmode,
-                                             useroot,
-                                             myorself,
-                                             &fncalled);
-                if (!fnresult || walkerparms.res != NO_ERR) {
-                    res = walkerparms.res;
-                }
-            } else {
-                fnresult = 
-                    obj_find_all_children(pcb->objmod,
-                                          object_walker_fn,
-                                          pcb,
-                                          &walkerparms,
-                                          testobj,
-                                          modname,
-                                          childname,
-                                          cfgonly,
-                                          textmode,
-                                          useroot);
-                if (!fnresult || walkerparms.res != NO_ERR) {
-                    res = walkerparms.res;
-                }
-            }
-        }
+/********************************************************************
+* FUNCTION check_node_exists
+* 
+* Check if any ancestor-or-self node is already in an indexed Q
+* ONLY FOR VALUE NODES IN THE RESULT
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == index of the Q of xpath_resnode_t structs to check
+*    val   == value node pointer value to find
+*
+* RETURNS:
+*    TRUE if found, FALSE otherwise
+*********************************************************************/
+static boolean
+    check_node_exists (xpath_pcb_t *pcb,
+                       xpath_nodeidx_t *nodeidx,
+                       const val_value_t *val)
+{
+    /* quick test -- see if docroot is already in the Q
+     * which means nothing else is needed
+     */
+    if (find_nodeidx(pcb, nodeidx, pcb->val_docroot)) {
+        return TRUE;
+    }
 
-        free_resnode(pcb, resnode);
+    /* no docroot in the Q so check the node itself */
+    if (val == pcb->val_docroot) {
+        return FALSE;
     }
+        
+    while (val) {
+        if (find_nodeidx(pcb, nodeidx, val)) {
+            return TRUE;
+        }
 
-    /* put the resnode entries back where they belong */
-    if (!dlq_empty(&resnodeQ)) {
-        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
-    } else if (!pcb->val && pcb->obj) {
-        if (pcb->logerrors) {
-            /* hack: the val_gen_instance_id code will generate
-             * instance IDs that start with /nc:rpc QName.
-             * The <rpc> node is currently unsupported in
-             * node searches since all YANG content starts
-             * from the RPC operation node;
-             * check for the <nc:rpc> node and suppress the warning
-             * if this is the node that is not found  */
-            if ((childnsid == 0 || childnsid == xmlns_nc_id()) && 
-                !xml_strcmp(childname, NCX_EL_RPC)) {
-                ;  // assume this is an error-path XPath string
-            } else if (axis != XP_AX_CHILD) {
-                res = ERR_NCX_NO_XPATH_DESCENDANT;
-                if (ncx_warning_enabled(res)) {
-                    log_warn("\nWarning: no descendant nodes found "
-                             "in XPath expr '%s'", 
-                             pcb->exprstr);
-                    ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
-                } else if (pcb->objmod) {
-                    ncx_inc_warnings(pcb->objmod);
-                }
-            } else {
-                res = ERR_NCX_NO_XPATH_CHILD;
-                if (ncx_warning_enabled(res)) {
-                    log_warn("\nWarning: no child nodes found "
-                             "in XPath expr '%s'", 
-                             pcb->exprstr);
-                    ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
-                } else if (pcb->objmod) {
-                    ncx_inc_warnings(pcb->objmod);
-                }
-            }
-            res = NO_ERR;
+        if (val->parent && !obj_is_root(val->parent->obj)) {
+            val = val->parent;
+        } else {
+            return FALSE;
         }
     }
+    return FALSE;
 
-    result->last = walkerparms.callcount;
-
-    return res;
-
-}  /* set_nodeset_child */
+}  /* check_node_exists */
 
 
 /********************************************************************
-* FUNCTION set_nodeset_pfaxis
-*
-* Handles these axis node tests
-*
-*   preceding::*
-*   preceding-sibling::*
-*   following::*
-*   following-sibling::*
-*
-* Combinations with '//' are handled as well
-*
-* Check the current result nodeset and replace
-* each node with all the requested nodes instead,
-* based on the axis used
-*
-* The result set is changed to the selected axis
-* Since the current node is no longer going to
-* be part of the result set
-*
-* After this initial step, the desired filtering
-* is performed on each of the result nodes (if any)
-*
-* At this point, if a 'nsid' and/or 'name' is 
-* specified then any selected node not
-* containing this namespace and/or node name
-* will be removed
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* FUNCTION set_nodeset_dblslash
+* 
+* Set the current nodes dblslash flag
+* to indicate that all unchecked descendants
+* are also represented by this node, for
+* further node-test or predicate testing
 *
 * INPUTS:
-*    pcb == parser control block in progress
+*    pcb == parser control block to use
 *    result == address of return XPath result nodeset
-*    nsid == 0 if any namespace is OK
-*            else only this namespace will be checked
-*    name == name of preceding node to find
-*            == NULL to find all child nodes
-*               In this mode, if the context object
-*               is config=true, then config=false
-*               preceding nodes will be skipped
-*    textmode == TRUE if just selecting text() nodes
-*                FALSE if ignored
-*    axis == axis in use for this current step
 *
 * OUTPUTS:
-*    result->nodeQ contents adjusted or replaced
+*    result->nodeQ contents adjusted
 *
-* RETURNS:
-*    status
 *********************************************************************/
-static status_t
-    set_nodeset_pfaxis (xpath_pcb_t *pcb,
-                        xpath_result_t *result,
-                        xmlns_id_t  nsid,
-                        const xmlChar *name,
-                        boolean textmode,
-                        ncx_xpath_axis_t axis)
+static void
+    set_nodeset_dblslash (xpath_pcb_t *pcb,
+                          xpath_result_t *result)
 {
-    xpath_resnode_t      *resnode;
-    obj_template_t       *testobj;
-    val_value_t          *testval;
-    const xmlChar        *modname;
-    status_t              res;
-    boolean               fnresult, fncalled, cfgonly, useroot;
-    dlq_hdr_t             resnodeQ;
-    xpath_walkerparms_t   walkerparms;
-    
-    if (!pcb->val && !pcb->obj) {
-        return NO_ERR;
-    }
+    xpath_resnode_t        *resnode;
 
-    if (dlq_empty(&result->r.nodeQ)) {
-        return NO_ERR;
+    if (!pcb->val && !pcb->obj) {
+        return;
     }
 
-    dlq_createSQue(&resnodeQ);
-    res = NO_ERR;
-    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
-
-    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
-    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+    for (resnode = (xpath_resnode_t *)
+             dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
+        resnode->dblslash = TRUE;
+    }
 
-    /* the resnodes need to be deleted or moved to a tempQ
-     * to correctly track duplicates and remove them
-     */
-    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
+}  /* set_nodeset_dblslash */
 
-        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
 
-        /* select 1 or all children of the resnode 
-         * special YANG support; skip over nodes that
-         * are not config nodes if they were selected
-         * by the wildcard '*' operator
-         */
-        if (pcb->val) {
-            testval = resnode->node.valptr;
+/********************************************************************
+* FUNCTION value_walker_fn
+* 
+* Check the current found value node, based on the
+* criteria passed to the search function
+*
+* Matches val_walker_fn_t template in val.h
+*
+* INPUTS:
+*    val == value node found in the search
+*    cookie1 == xpath_pcb_t * : parser control block to use
+*    cookie2 == xpath_walkerparms_t *: walker parms to use
+*
+* OUTPUTS:
+*    result->nodeQ contents adjusted or replaced
+*
+* RETURNS:
+*    TRUE to keep walk going
+*    FALSE to terminate walk
+*********************************************************************/
+static boolean
+    value_walker_fn (val_value_t *val,
+                     void *cookie1,
+                     void *cookie2)
+{
+    xpath_pcb_t          *pcb;
+    xpath_walkerparms_t  *parms;
+    xpath_resnode_t      *newresnode;
+    val_value_t          *child;
+    int64                 position;
+    boolean               done;
 
-            if (axis==XP_AX_PRECEDING || axis==XP_AX_FOLLOWING) {
-                fnresult = 
-                    val_find_all_pfaxis(value_walker_fn,
-                                        pcb, 
-                                        &walkerparms,
-                                        testval, 
-                                        modname,
-                                        name, 
-                                        cfgonly, 
-                                        resnode->dblslash, 
-                                        textmode,
-                                        axis);
-            } else {
-                fnresult = 
-                    val_find_all_pfsibling_axis(value_walker_fn,
-                                                pcb, 
-                                                &walkerparms,
-                                                testval, 
-                                                modname,
-                                                name, 
-                                                cfgonly, 
-                                                resnode->dblslash, 
-                                                textmode,
-                                                axis);
+    pcb = (xpath_pcb_t *)cookie1;
+    parms = (xpath_walkerparms_t *)cookie2;
 
-            }
-            if (!fnresult || walkerparms.res != NO_ERR) {
-                res = walkerparms.res;
-            }
-        } else {
-            testobj = resnode->node.objptr;
-            fnresult = obj_find_all_pfaxis(pcb->objmod,
-                                           object_walker_fn,
-                                           pcb, 
-                                           &walkerparms,
-                                           testobj, 
-                                           modname,
-                                           name, 
-                                           cfgonly,
-                                           resnode->dblslash,
-                                           textmode,
-                                           useroot,
-                                           axis, 
-                                           &fncalled);
-            if (!fnresult || walkerparms.res != NO_ERR) {
-                res = walkerparms.res;
+    /* check if this node is already in the result */
+    if (find_nodeidx(pcb, parms->nodeidx, val)) {
+        return TRUE;
+    }
+
+    if (obj_is_root(val->obj) || val->parent==NULL) {
+        position = 1;
+    } else {
+        /* the walkers usually find siblings in order,
+         * so count on from the last node found
+         */
+        child = NULL;
+        position = 0;
+        if (parms->lastval && parms->lastval->parent == val->parent) {
+            position = parms->lastpos;
+            for (child = parms->lastval;
+                 child != NULL && child != val;
+                 child = val_get_next_child(child)) {
+                position++;
+            }
+        }
+
+        if (child == NULL) {
+            position = 0;
+            done = FALSE;
+            for (child = val_get_first_child(val->parent);
+                 child != NULL && !done;
+                 child = val_get_next_child(child)) {
+                position++;
+                if (child == val) {
+                    done = TRUE;
+                }
             }
         }
-        free_resnode(pcb, resnode);
+
+        parms->lastval = val;
+        parms->lastpos = position;
     }
 
-    /* put the resnode entries back where they belong */
-    if (!dlq_empty(&resnodeQ)) {
-        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
-    } else if (!pcb->val && pcb->obj) {
-        res = ERR_NCX_NO_XPATH_NODES;
-        if (pcb->logerrors && ncx_warning_enabled(res)) {
-            log_warn("\nWarning: no axis nodes found "
-                     "in XPath expr '%s'", 
-                     pcb->exprstr);
-            ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
-        } else if (pcb->objmod != NULL) {
-            ncx_inc_warnings(pcb->objmod);
-        }
-        res = NO_ERR;
+    ++parms->callcount;
+
+    /* need to add this node */
+    newresnode = new_val_resnode(pcb, 
+                                 position,
+                                 FALSE,
+                                 val);
+    if (!newresnode) {
+        parms->res = ERR_INTERNAL_MEM;
+        return FALSE;
     }
 
-    result->last = walkerparms.callcount;
+    add_nodeidx(pcb, parms->nodeidx, newresnode);
+    return TRUE;
 
-    return res;
+}  /* value_walker_fn */
 
-}  /* set_nodeset_pfaxis */
+
+/********************************************************************
+* FUNCTION object_walker_fn
+* 
+* Check the current found object node, based on the
+* criteria passed to the search function
+*
+* Matches obj_walker_fn_t template in obj.h
+*
+* INPUTS:
+*    val == value node found in the search
+*    cookie1 == xpath_pcb_t * : parser control block to use
+*    cookie2 == xpath_walkerparms_t *: walker parms to use
+*
+* OUTPUTS:
+*    result->nodeQ contents adjusted or replaced
+*
+* RETURNS:
+*    TRUE to keep walk going
+*    FALSE to terminate walk
+*********************************************************************/
+static boolean
+    object_walker_fn (obj_template_t *obj,
+                      void *cookie1,
+                      void *cookie2)
+{
+    xpath_pcb_t          *pcb;
+    xpath_walkerparms_t  *parms;
+    xpath_resnode_t      *newresnode;
+
+    pcb = (xpath_pcb_t *)cookie1;
+    parms = (xpath_walkerparms_t *)cookie2;
+
+    /* check if this node is already in the result */
+    if (find_nodeidx(pcb, parms->nodeidx, obj)) {
+        return TRUE;
+    }
+
+    /* need to add this child node 
+     * the position is wrong but it will not really matter
+     */
+    newresnode = new_obj_resnode(pcb, 
+                                 ++parms->callcount, 
+                                 FALSE,
+                                 obj);
+    if (!newresnode) {
+        parms->res = ERR_INTERNAL_MEM;
+        return FALSE;
+    }
+
+    add_nodeidx(pcb, parms->nodeidx, newresnode);
+    return TRUE;
+
+}  /* object_walker_fn */
 
 
 /********************************************************************
-* FUNCTION set_nodeset_ancestor
+* FUNCTION set_nodeset_self
 * 
-* Check the current result nodeset and move each
-* node to the specified ancestor, or remove it 
-* if none found that matches the filter criteria
+* Check the current result nodeset and keep each
+* node, or remove it if filter tests fail
 *
 * Error messages are printed by this function!!
 * Do not duplicate error messages upon error return
@@ -5985,16 +6231,11 @@ static status_t
 *    pcb == parser control block in progress
 *    result == address of return XPath result nodeset
 *    nsid == 0 if any namespace is OK
-*                 else only this namespace will be checked
-*    name == name of ancestor to find
-*              == NULL to find any ancestor nodes
-*                 In this mode, if the context object
-*                 is config=true, then config=false
-*                 children will be skipped
+*              else only this namespace will be checked
+*    name == name of parent to find
+*         == NULL to find any parent name
 *    textmode == TRUE if just selecting text() nodes
 *                FALSE if ignored
-*     axis == axis in use for this current step
-*             XP_AX_ANCESTOR or XP_AX_ANCESTOR_OR_SELF
 *
 * OUTPUTS:
 *    result->nodeQ contents adjusted or removed
@@ -6003,21 +6244,20 @@ static status_t
 *    status
 *********************************************************************/
 static status_t
-    set_nodeset_ancestor (xpath_pcb_t *pcb,
-                          xpath_result_t *result,
-                          xmlns_id_t  nsid,
-                          const xmlChar *name,
-                          boolean textmode,
-                          ncx_xpath_axis_t axis)
+    set_nodeset_self (xpath_pcb_t *pcb,
+                      xpath_result_t *result,
+                      xmlns_id_t nsid,
+                      const xmlChar *name,
+                      boolean textmode)
 {
-    xpath_resnode_t        *resnode, *testnode;
+    xpath_resnode_t        *resnode, *findnode;
     obj_template_t         *testobj;
+    const xmlChar           *modname;
     val_value_t            *testval;
-    const xmlChar          *modname;
-    xpath_result_t         *dummy;
-    status_t                res;
-    boolean                 cfgonly, fnresult, fncalled, orself, useroot;
+    boolean                 keep, cfgonly, fnresult, fncalled, useroot;
     dlq_hdr_t               resnodeQ;
+    xpath_nodeidx_t         nodeidx;
+    status_t                res;
     xpath_walkerparms_t     walkerparms;
 
     if (!pcb->val && !pcb->obj) {
@@ -6030,18 +6270,18 @@ static status_t
 
     dlq_createSQue(&resnodeQ);
 
-    res = NO_ERR;
-    testval = NULL;
-    testobj = NULL;
+    init_nodeidx(&nodeidx, &resnodeQ, 0);
 
-    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
+    walkerparms.nodeidx = &nodeidx;
+    walkerparms.res = NO_ERR;
+    walkerparms.lastval = NULL;
+    walkerparms.lastpos = 0;
+    walkerparms.callcount = 0;
 
-    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
+    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
     useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
-    orself = (axis == XP_AX_ANCESTOR_OR_SELF) ? TRUE : FALSE;
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
+    res = NO_ERR;
 
     /* the resnodes need to be deleted or moved to a tempQ
      * to correctly track duplicates and remove them
@@ -6050,2581 +6290,6249 @@ static status_t
 
         resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
 
-        walkerparms.callcount = 0;
+        if (resnode->dblslash) {
+            if (pcb->val) {
+                testval = resnode->node.valptr;
+                cfgonly = obj_is_config(testval->obj);
 
-        if (pcb->val) {
-            testval = resnode->node.valptr;
-            fnresult = val_find_all_ancestors(value_walker_fn,
-                                              pcb,
-                                              &walkerparms,
-                                              testval,
-                                              modname, 
-                                              name, 
-                                              cfgonly,
-                                              orself,
-                                              textmode);
-        } else {
-            testobj = resnode->node.objptr;
-            fnresult = obj_find_all_ancestors(pcb->objmod,
-                                              object_walker_fn,
-                                              pcb,
-                                              &walkerparms,
-                                              testobj,
-                                              modname, 
-                                              name, 
-                                              cfgonly,
-                                              textmode,
-                                              useroot,
-                                              orself,
-                                              &fncalled);
+                fnresult = 
+                    val_find_all_descendants(value_walker_fn,
+                                             pcb, 
+                                             &walkerparms,
+                                             testval, 
+                                             modname,
+                                             name,
+                                             cfgonly,
+                                             textmode,
+                                             TRUE,
+                                             FALSE);
+            } else {
+                testobj = resnode->node.objptr;
+                cfgonly = obj_is_config(testobj);
 
-        }
-        if (walkerparms.res != NO_ERR) {
-            res = walkerparms.res;
-        } else if (!fnresult) {
-            res = ERR_NCX_OPERATION_FAILED;
-        } else if (!walkerparms.callcount && resnode->dblslash) {
-            dummy = new_result(pcb, XP_RT_NODESET);
-            if (!dummy) {
-                res = ERR_INTERNAL_MEM;
-                continue;
+                fnresult = 
+                    obj_find_all_descendants(pcb->objmod,
+                                             object_walker_fn,
+                                             pcb, 
+                                             &walkerparms,
+                                             testobj,
+                                             modname,
+                                             name,
+                                             cfgonly,
+                                             textmode,
+                                             useroot,
+                                             TRUE,
+                                             &fncalled);
+            }
+
+            if (!fnresult || walkerparms.res != NO_ERR) {
+                res = walkerparms.res;
             }
+            free_resnode(pcb, resnode);
+        } else {
+            keep = FALSE;
 
-            walkerparms.resnodeQ = &dummy->r.nodeQ;
             if (pcb->val) {
-                fnresult = val_find_all_descendants(value_walker_fn,
-                                                    pcb,
-                                                    &walkerparms,
-                                                    testval,
-                                                    modname, 
-                                                    name, 
-                                                    cfgonly,
-                                                    textmode,
-                                                    TRUE,
-                                                    FALSE);
+                testval = resnode->node.valptr;
+            
+                if (textmode) {
+                    if (obj_has_text_content(testval->obj)) {
+                        keep = TRUE;
+                    }
+                } else if (modname && name) {
+                    if (!xml_strcmp(modname,
+                                    val_get_mod_name(testval)) &&
+                        !xml_strcmp(name, testval->name)) {
+                        keep = TRUE;
+                    }
 
-            } else {
-                fnresult = obj_find_all_descendants(pcb->objmod,
-                                                    object_walker_fn,
-                                                    pcb,
-                                                    &walkerparms,
-                                                    testobj,
-                                                    modname, 
-                                                    name, 
-                                                    cfgonly,
-                                                    textmode,
-                                                    useroot,
-                                                    TRUE,
-                                                    &fncalled);
-            }
-            walkerparms.resnodeQ = &resnodeQ;
+                } else if (modname) {
+                    if (!xml_strcmp(modname,
+                                    val_get_mod_name(testval))) {
+                        keep = TRUE;
+                    }
+                } else if (name) {
+                    if (!xml_strcmp(name, testval->name)) {
+                        keep = TRUE;
+                    }
+                } else {
+                    keep = TRUE;
+                }
 
-            if (walkerparms.res != NO_ERR) {
-                res = walkerparms.res;
-            } else if (!fnresult) {
-                res = ERR_NCX_OPERATION_FAILED;
+                if (keep) {
+                    findnode = find_nodeidx(pcb, &nodeidx, 
+                                            testval);
+                    if (findnode) {
+                        if (resnode->dblslash) {
+                            findnode->dblslash = TRUE;
+                            findnode->position = 
+                                ++walkerparms.callcount;
+                        }
+                        free_resnode(pcb, resnode);
+                    } else {
+                        /* set the resnode to its parent */
+                        resnode->node.valptr = testval;
+                        resnode->position = 
+                            ++walkerparms.callcount;
+                        add_nodeidx(pcb, &nodeidx, resnode);
+                    }
+                } else {
+                    free_resnode(pcb, resnode);
+                }
             } else {
-                res = set_nodeset_ancestor(pcb, 
-                                           dummy,
-                                           nsid, 
-                                           name, 
-                                           textmode,
-                                           axis);
-                while (!dlq_empty(&dummy->r.nodeQ)) {
-                    testnode = (xpath_resnode_t *)
-                        dlq_deque(&dummy->r.nodeQ);
+                testobj = resnode->node.objptr;
 
-                    /* It is assumed that testnode cannot NULL because the call 
-                     * to dlq_empty returned false. */
-                    if (find_resnode(pcb, &resnodeQ,
-                                     (const void *)testnode->node.valptr)) {
-                        free_resnode(pcb, testnode);
+                if (textmode) {
+                    if (obj_has_text_content(testobj)) {
+                        keep = TRUE;
+                    }
+                } else if (modname && name) {
+                    if (!xml_strcmp(modname,
+                                    obj_get_mod_name(testobj)) &&
+                        !xml_strcmp(name, obj_get_name(testobj))) {
+                        keep = TRUE;
+                    }
+                } else if (modname) {
+                    if (!xml_strcmp(modname,
+                                    obj_get_mod_name(testobj))) {
+                        keep = TRUE;
+                    }
+                } else if (name) {
+                    if (!xml_strcmp(name, obj_get_name(testobj))) {
+                        keep = TRUE;
+                    }
+                } else {
+                    keep = TRUE;
+                }
+
+                if (keep) {
+                    findnode = find_nodeidx(pcb, &nodeidx, 
+                                            testobj);
+                    if (findnode) {
+                        if (resnode->dblslash) {
+                            findnode->dblslash = TRUE;
+                            findnode->position = 
+                                ++walkerparms.callcount;
+                        }
+                        free_resnode(pcb, resnode);
                     } else {
-                        dlq_enque(testnode, &resnodeQ);
+                        /* set the resnode to its parent */
+                        resnode->node.objptr = testobj;
+                        resnode->position =
+                            ++walkerparms.callcount;
+                        add_nodeidx(pcb, &nodeidx, resnode);
+                    }
+                } else {
+                    if (pcb->logerrors && 
+                        ncx_warning_enabled(ERR_NCX_NO_XPATH_NODES)) {
+                        log_warn("\nWarning: no self node found "
+                                 "in XPath expr '%s'", 
+                                 pcb->exprstr);
+                        ncx_print_errormsg(pcb->tkc, 
+                                           pcb->objmod, 
+                                           ERR_NCX_NO_XPATH_NODES);
+                    } else if (pcb->objmod != NULL) {
+                        ncx_inc_warnings(pcb->objmod);
                     }
+                    free_resnode(pcb, resnode);
                 }
-                free_result(pcb, dummy);
             }
         }
-
-        free_resnode(pcb, resnode);
     }
 
+    clean_nodeidx(&nodeidx);
+
     /* put the resnode entries back where they belong */
     if (!dlq_empty(&resnodeQ)) {
         dlq_block_enque(&resnodeQ, &result->r.nodeQ);
-    } else {
-        res = ERR_NCX_NO_XPATH_ANCESTOR;
-        if (pcb->logerrors && ncx_warning_enabled(res)) {
-            if (orself) {
-                log_warn("\nWarning: no ancestor-or-self nodes found "
-                         "in XPath expr '%s'", pcb->exprstr);
-            } else {
-                log_warn("\nWarning: no ancestor nodes found "
-                         "in XPath expr '%s'", pcb->exprstr);
-            }
-            ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
-        } else if (pcb->objmod != NULL) {
-            ncx_inc_warnings(pcb->objmod);
-        }
-        res = NO_ERR;
     }
 
     result->last = walkerparms.callcount;
 
     return res;
 
-}  /* set_nodeset_ancestor */
-
-
-/***********   B E G I N    E B N F    F U N C T I O N S *************/
+}  /* set_nodeset_self */
 
 
 /********************************************************************
-* FUNCTION parse_node_test
+* FUNCTION set_nodeset_parent
 * 
-* Parse the XPath NodeTest sequence
-* It has already been tokenized
+* Check the current result nodeset and move each
+* node to its parent, or remove it if no parent
 *
 * Error messages are printed by this function!!
 * Do not duplicate error messages upon error return
 *
-* [7] NodeTest ::= NameTest
-*                  | NodeType '(' ')'
-*                  | 'processing-instruction' '(' Literal ')'
-*
-* [37] NameTest ::= '*'
-*                  | NCName ':' '*'
-*                  | QName
-*
-* [38] NodeType ::= 'comment'
-*                    | 'text'   
-*                    | 'processing-instruction'
-*                    | 'node'
-*
 * INPUTS:
 *    pcb == parser control block in progress
-*    axis  == current axis from first part of Step
-*    result == address of pointer to result struct in progress
+*    result == address of return XPath result nodeset
+*    nsid == 0 if any namespace is OK
+*              else only this namespace will be checked
+*    name == name of parent to find
+*         == NULL to find any parent name
 *
 * OUTPUTS:
-*   *result is modified
+*    result->nodeQ contents adjusted or removed
 *
 * RETURNS:
-*   status
+*    status
 *********************************************************************/
 static status_t
-    parse_node_test (xpath_pcb_t *pcb,
-                     ncx_xpath_axis_t axis,
-                     xpath_result_t **result)
+    set_nodeset_parent (xpath_pcb_t *pcb,
+                        xpath_result_t *result,
+                        xmlns_id_t nsid,
+                        const xmlChar *name)
 {
-    const xmlChar     *name;
-    tk_type_t          nexttyp;
-    xpath_nodetype_t   nodetyp;
-    status_t           res;
-    xmlns_id_t         nsid;
-    boolean            emptyresult, textmode;
+    xpath_resnode_t        *resnode, *findnode;
+    obj_template_t         *testobj, *useobj;
+    const xmlChar           *modname;
+    val_value_t            *testval;
+    boolean                 keep, cfgonly, fnresult, fncalled, useroot;
+    dlq_hdr_t               resnodeQ;
+    xpath_nodeidx_t         nodeidx;
+    status_t                res;
+    xpath_walkerparms_t     walkerparms;
+    int64                   position;
 
-    nsid = 0;
-    name = NULL;
-    textmode = FALSE;
 
-    res = TK_ADV(pcb->tkc);
-    if (res != NO_ERR) {
-        res = ERR_NCX_INVALID_XPATH_EXPR;
-        if (pcb->logerrors) {
-            log_error("\nError: token expected in XPath "
-                      "expression '%s'", pcb->exprstr);
-            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, res);
-        } else {
-            /*** handle agent error ***/
-        }
-        return res;
+    if (!pcb->val && !pcb->obj) {
+        return NO_ERR;
     }
 
-    /* process the tokens but not the result yet */
-    switch (TK_CUR_TYP(pcb->tkc)) {
-    case TK_TT_STAR:
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
-        }
-        break;
-    case TK_TT_NCNAME_STAR:
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
-        }
-        /* match all nodes in the namespace w/ specified prefix */
-        if (!pcb->tkc->cur->nsid) {
-            res = check_qname_prefix(pcb,
-                                     TK_CUR_VAL(pcb->tkc),
-                                     xml_strlen(TK_CUR_VAL(pcb->tkc)),
-                                     &pcb->tkc->cur->nsid);
-        }
-        if (res == NO_ERR) {
-            nsid = pcb->tkc->cur->nsid;
-        }
-        break;
-    case TK_TT_MSTRING:
-        /* match all nodes in the namespace w/ specified prefix */
-        if (!pcb->tkc->cur->nsid) {
-            res = check_qname_prefix(pcb, 
-                                     TK_CUR_MOD(pcb->tkc),
-                                     TK_CUR_MODLEN(pcb->tkc),
-                                     &pcb->tkc->cur->nsid);
-        }
-        if (res == NO_ERR) {
-            nsid = pcb->tkc->cur->nsid;
-            name = TK_CUR_VAL(pcb->tkc);
-        }
-        break;
-    case TK_TT_TSTRING:
-        /* check the ID token for a NodeType name */
-        nodetyp = get_nodetype_id(TK_CUR_VAL(pcb->tkc));
-        if (nodetyp == XP_EXNT_NONE ||
-            (tk_next_typ(pcb->tkc) != TK_TT_LPAREN)) {
-            name = TK_CUR_VAL(pcb->tkc);
-            break;
-        }
+    if (dlq_empty(&result->r.nodeQ)) {
+        return NO_ERR;
+    }
 
-        /* get the node test left paren */
-        res = xpath_parse_token(pcb, TK_TT_LPAREN);
-        if (res != NO_ERR) {
-            return res;
-        }
+    dlq_createSQue(&resnodeQ);
 
-        /* check if a literal param can be present */
-        if (nodetyp == XP_EXNT_PROC_INST) {
-            /* check if a literal param is present */
-            nexttyp = tk_next_typ(pcb->tkc);
-            if (nexttyp==TK_TT_QSTRING ||
-                nexttyp==TK_TT_SQSTRING) {
-                /* temp save the literal string */
-                res = xpath_parse_token(pcb, nexttyp);
-                if (res != NO_ERR) {
-                    return res;
-                }
-            }
-        }
+    init_nodeidx(&nodeidx, &resnodeQ, 0);
 
-        /* get the node test right paren */
-        res = xpath_parse_token(pcb, TK_TT_RPAREN);
-        if (res != NO_ERR) {
-            return res;
-        }
+    walkerparms.nodeidx = &nodeidx;
+    walkerparms.res = NO_ERR;
+    walkerparms.lastval = NULL;
+    walkerparms.lastpos = 0;
+    walkerparms.callcount = 0;
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
-        }
+    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
+    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
 
-        /* process the result based on the node type test */
-        switch (nodetyp) {
-        case XP_EXNT_COMMENT:
-            /* no comments to match */
-            emptyresult = TRUE;
-            if (pcb->obj && 
-                pcb->logerrors && 
-                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-                log_warn("\nWarning: no comment nodes available in "
-                         "XPath expr '%s'", 
-                         pcb->exprstr);
-                ncx_print_errormsg(pcb->tkc, 
-                                   pcb->tkerr.mod,
-                                   ERR_NCX_EMPTY_XPATH_RESULT);
-            } else if (pcb->objmod != NULL) {
-                ncx_inc_warnings(pcb->objmod);
-            }
+    res = NO_ERR;
+    position = 0;
 
-            break;
-        case XP_EXNT_TEXT:
-            /* match all leaf of leaf-list content */
-            emptyresult = FALSE;
-            textmode = TRUE;
-            break;
-        case XP_EXNT_PROC_INST:
-            /* no processing instructions to match */
-            emptyresult = TRUE;
-            if (pcb->obj && 
-                pcb->logerrors &&
-                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-                log_warn("\nWarning: no processing instruction "
-                         "nodes available in "
-                         "XPath expr '%s'", 
-                         pcb->exprstr);
-                ncx_print_errormsg(pcb->tkc, 
-                                   pcb->tkerr.mod,
-                                   ERR_NCX_EMPTY_XPATH_RESULT);
-            } else if (pcb->objmod != NULL) {
-                ncx_inc_warnings(pcb->objmod);
-            }
-            break;
-        case XP_EXNT_NODE:
-            /* match any node */
-            emptyresult = FALSE;
-            break;
-        default:
-            emptyresult = TRUE;
-            res = SET_ERROR(ERR_INTERNAL_VAL);
-        }
+    /* the resnodes need to be deleted or moved to a tempQ
+     * to correctly track duplicates and remove them
+     */
+    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
 
-        if (emptyresult) {
-            if (*result) {
-                free_result(pcb, *result);
-            }
-            *result = new_result(pcb, XP_RT_NODESET);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
-            }
-            return res;
-        }  /* else go on to the text() or node() test */
-        break;
-    default:
-        /* wrong token type found */
-        res = ERR_NCX_WRONG_TKTYPE;
-        unexpected_error(pcb);
-    }
+        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
 
-    /* do not care about result if fatal error occurred */
-    if (res != NO_ERR) {
-        return res;
-    } else if (!pcb->val && !pcb->obj) {
-        /* nothing to do in first pass except create
-         * dummy result to flag that a location step
-         * has already started
-         */
-        if (!*result) {
-            *result = new_result(pcb, XP_RT_NODESET);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
-            }
-        }
-        return res;
-    }
+        if (resnode->dblslash) {
+            if (pcb->val) {
+                testval = resnode->node.valptr;
+                cfgonly = obj_is_config(testval->obj);
 
+                fnresult = 
+                    val_find_all_descendants(value_walker_fn,
+                                             pcb, 
+                                             &walkerparms,
+                                             testval, 
+                                             modname,
+                                             name,
+                                             cfgonly,
+                                             FALSE,
+                                             TRUE,
+                                             FALSE);
+            } else {
+                testobj = resnode->node.objptr;
+                cfgonly = obj_is_config(testobj);
 
-    /* if we get here, then the axis and name fields are set
-     * or a texttest is needed
-     */
-    switch (axis) {
-    case XP_AX_ANCESTOR:
-    case XP_AX_ANCESTOR_OR_SELF:
-        if (!*result) {
-            *result = new_nodeset(pcb,
-                                  pcb->context.node.objptr,
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+                fnresult = 
+                    obj_find_all_descendants(pcb->objmod,
+                                             object_walker_fn,
+                                             pcb, 
+                                             &walkerparms,
+                                             testobj,
+                                             modname,
+                                             name,
+                                             cfgonly,
+                                             FALSE,
+                                             useroot,
+                                             TRUE,
+                                             &fncalled);
             }
-        }
-        if (res == NO_ERR) {
-            res = set_nodeset_ancestor(pcb, 
-                                       *result,
-                                       nsid, 
-                                       name,
-                                       textmode,
-                                       axis);
-        } 
-        break;
-    case XP_AX_ATTRIBUTE:
-        /* Attribute support in XPath is TBD
-         * YANG does not define them and the ncx:metadata
-         * extension is not fully supported within the 
-         * the edit-config code yet anyway
-         *
-         * just set the result to the empty nodeset
-         */
-        if (pcb->obj && 
-            pcb->logerrors &&
-            ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-            log_warn("\nWarning: attribute axis is empty in "
-                     "XPath expr '%s'", pcb->exprstr);
-            ncx_print_errormsg(pcb->tkc, 
-                               pcb->tkerr.mod,
-                               ERR_NCX_EMPTY_XPATH_RESULT);
-        } else if (pcb->objmod != NULL) {
-            ncx_inc_warnings(pcb->objmod);
-        }
 
-        if (*result) {
-            free_result(pcb, *result);
+            if (!fnresult || walkerparms.res != NO_ERR) {
+                res = walkerparms.res;
+            }
+            free_resnode(pcb, resnode);
+        } else {
+            keep = FALSE;
+
+            if (pcb->val) {
+                testval = resnode->node.valptr;
+            
+                if (testval == pcb->val_docroot) {
+                    if (resnode->dblslash) {
+                        /* just move this node to the result */
+                        resnode->position = ++position;
+                        add_nodeidx(pcb, &nodeidx, resnode);
+                    } else {
+                        /* no parent available error
+                         * remove node from result 
+                         */
+                        no_parent_warning(pcb);
+                        free_resnode(pcb, resnode);
+                    }
+                } else {
+                    testval = testval->parent;
+                    
+                    if (modname && name) {
+                        if (!xml_strcmp(modname,
+                                        val_get_mod_name(testval)) &&
+                            !xml_strcmp(name, testval->name)) {
+                            keep = TRUE;
+                        }
+                    } else if (modname) {
+                        if (!xml_strcmp(modname,
+                                        val_get_mod_name(testval))) {
+                            keep = TRUE;
+                        }
+                    } else if (name) {
+                        if (!xml_strcmp(name, testval->name)) {
+                            keep = TRUE;
+                        }
+                    } else {
+                        keep = TRUE;
+                    }
+
+                    if (keep) {
+                        findnode = find_nodeidx(pcb, &nodeidx, 
+                                                testval);
+                        if (findnode) {
+                            /* parent already in the Q
+                             * remove node from result 
+                             */
+                            if (resnode->dblslash) {
+                                findnode->position = ++position;
+                                findnode->dblslash = TRUE;
+                            }
+                            free_resnode(pcb, resnode);
+                        } else {
+                            /* set the resnode to its parent */
+                            resnode->position = ++position;
+                            resnode->node.valptr = testval;
+                            add_nodeidx(pcb, &nodeidx, resnode);
+                        }
+                    } else {
+                        /* no parent available error
+                         * remove node from result 
+                         */
+                        no_parent_warning(pcb);
+                        free_resnode(pcb, resnode);
+                    }
+                }
+            } else {
+                testobj = resnode->node.objptr;
+                if (testobj == pcb->docroot) {
+                    resnode->position = ++position;
+                    add_nodeidx(pcb, &nodeidx, resnode);
+                } else if (!testobj->parent) {
+                    if (!resnode->dblslash && (modname || name)) {
+                        no_parent_warning(pcb);
+                        free_resnode(pcb, resnode);
+                    } else {
+                        /* this is a databd node */
+                        findnode = find_nodeidx(pcb, &nodeidx, 
+                                                pcb->docroot);
+                        if (findnode) {
+                            if (resnode->dblslash) {
+                                findnode->position = ++position;
+                                findnode->dblslash = TRUE;
+                            }
+                            free_resnode(pcb, resnode);
+                        } else {
+                            resnode->position = ++position;
+                            resnode->node.objptr = pcb->docroot;
+                            add_nodeidx(pcb, &nodeidx, resnode);
+                        }
+                    }
+                } else {
+                    /* find a parent but not a case or choice */
+                    testobj = testobj->parent;
+                    while (testobj && testobj->parent && 
+                           !obj_is_root(testobj->parent) &&
+                           (testobj->objtype==OBJ_TYP_CHOICE ||
+                            testobj->objtype==OBJ_TYP_CASE)) {
+                        testobj = testobj->parent;
+                    }
+
+                    /* check if stopped on top-level choice
+                     * a top-level case should not happen
+                     * but check it anyway
+                     */
+                    if (testobj->objtype==OBJ_TYP_CHOICE ||
+                        testobj->objtype==OBJ_TYP_CASE) {
+                        useobj = pcb->docroot;
+                    } else {
+                        useobj = testobj;
+                    }
+
+                    if (modname && name) {
+                        if (!xml_strcmp(modname,
+                                        obj_get_mod_name(useobj)) &&
+                            !xml_strcmp(name, obj_get_name(useobj))) {
+                            keep = TRUE;
+                        }
+                    } else if (modname) {
+                        if (!xml_strcmp(modname,
+                                        obj_get_mod_name(useobj))) {
+                            keep = TRUE;
+                        }
+                    } else if (name) {
+                        if (!xml_strcmp(name, obj_get_name(useobj))) {
+                            keep = TRUE;
+                        }
+                    } else {
+                        keep = TRUE;
+                    }
+
+                    if (keep) {
+                        /* replace this node with the useobj */
+                        findnode = find_nodeidx(pcb, &nodeidx, useobj);
+                        if (findnode) {
+                            if (resnode->dblslash) {
+                                findnode->position = ++position;
+                                findnode->dblslash = TRUE;
+                            }
+                            free_resnode(pcb, resnode);
+                        } else {
+                            resnode->node.objptr = useobj;
+                            resnode->position = ++position;
+                            add_nodeidx(pcb, &nodeidx, resnode);
+                        }
+                    } else {
+                        no_parent_warning(pcb);
+                        free_resnode(pcb, resnode);
+                    }
+                }
+            }
+        }
+    }
+
+    clean_nodeidx(&nodeidx);
+
+    /* put the resnode entries back where they belong */
+    if (!dlq_empty(&resnodeQ)) {
+        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
+    }
+
+    result->last = (position) ? position : walkerparms.callcount;
+
+    return res;
+
+}  /* set_nodeset_parent */
+
+
+/********************************************************************
+* FUNCTION set_nodeset_child
+* 
+* Check the current result nodeset and replace
+* each node with a node for every child instead
+*
+* Handles child and descendant nodes
+*
+* If a child is specified then any node not
+* containing this child will be removed
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == address of return XPath result nodeset
+*    childnsid == 0 if any namespace is OK
+*                 else only this namespace will be checked
+*    childname == name of child to find
+*              == NULL to find all child nodes
+*                 In this mode, if the context object
+*                 is config=true, then config=false
+*                 children will be skipped
+*    textmode == TRUE if just selecting text() nodes
+*                FALSE if ignored
+*     axis == actual axis used
+*
+* OUTPUTS:
+*    result->nodeQ contents adjusted or replaced
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    set_nodeset_child (xpath_pcb_t *pcb,
+                       xpath_result_t *result,
+                       xmlns_id_t  childnsid,
+                       const xmlChar *childname,
+                       boolean textmode,
+                       ncx_xpath_axis_t axis)
+{
+    xpath_resnode_t      *resnode;
+    obj_template_t       *testobj;
+    val_value_t          *testval;
+    const xmlChar        *modname;
+    status_t              res;
+    boolean               fnresult, fncalled, cfgonly;
+    boolean               orself, myorself, useroot;
+    dlq_hdr_t             resnodeQ;
+    xpath_nodeidx_t       nodeidx;
+    xpath_walkerparms_t   walkerparms;
+
+    if (!pcb->val && !pcb->obj) {
+        return NO_ERR;
+    }
+
+    if (dlq_empty(&result->r.nodeQ)) {
+        return NO_ERR;
+    }
+
+    dlq_createSQue(&resnodeQ);
+    res = NO_ERR;
+    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
+    orself = (axis == XP_AX_DESCENDANT_OR_SELF) ? TRUE : FALSE;
+    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+
+    if (childnsid) {
+        modname = xmlns_get_module(childnsid);
+    } else {
+        modname = NULL;
+    }
+
+    init_nodeidx(&nodeidx, &resnodeQ, 0);
+
+    walkerparms.nodeidx = &nodeidx;
+    walkerparms.res = NO_ERR;
+    walkerparms.lastval = NULL;
+    walkerparms.lastpos = 0;
+    walkerparms.callcount = 0;
+
+    /* the resnodes need to be deleted or moved to a tempQ
+     * to correctly track duplicates and remove them
+     */
+    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
+
+        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
+        myorself = (orself || resnode->dblslash) ? TRUE : FALSE;
+
+        /* select 1 or all children of the resnode 
+         * special YANG support; skip over nodes that
+         * are not config nodes if they were selected
+         * by the wildcard '*' operator
+         */
+        if (pcb->val) {
+
+            testval = resnode->node.valptr;
+
+            if (axis != XP_AX_CHILD || resnode->dblslash) {
+                fnresult = 
+                    val_find_all_descendants(value_walker_fn,
+                                             pcb, 
+                                             &walkerparms,
+                                             testval, 
+                                             modname,
+                                             childname,
+                                             cfgonly,
+                                             textmode,
+                                             myorself,
+                                             resnode->dblslash);
+                if (!fnresult || walkerparms.res != NO_ERR) {
+                    res = walkerparms.res;
+                }
+            } else {
+                fnresult = 
+                    val_find_all_children(value_walker_fn,
+                                          pcb, 
+                                          &walkerparms,
+                                          testval, 
+                                          modname,
+                                          childname,
+                                          cfgonly,
+                                          textmode);
+                if (!fnresult || walkerparms.res != NO_ERR) {
+                    res = walkerparms.res;
+                }
+            }
+        } else {
+            testobj = resnode->node.objptr;
+
+            if (axis != XP_AX_CHILD || resnode->dblslash) {
+                fnresult = 
+                    obj_find_all_descendants(pcb->objmod,
+                                             object_walker_fn,
+                                             pcb, 
+                                             &walkerparms,
+                                             testobj,
+                                             modname,
+                                             childname,
+                                             cfgonly,
+                                             textmode,
+                                             useroot,
+                                             myorself,
+                                             &fncalled);
+                if (!fnresult || walkerparms.res != NO_ERR) {
+                    res = walkerparms.res;
+                }
+            } else {
+                fnresult = 
+                    obj_find_all_children(pcb->objmod,
+                                          object_walker_fn,
+                                          pcb,
+                                          &walkerparms,
+                                          testobj,
+                                          modname,
+                                          childname,
+                                          cfgonly,
+                                          textmode,
+                                          useroot);
+                if (!fnresult || walkerparms.res != NO_ERR) {
+                    res = walkerparms.res;
+                }
+            }
+        }
+
+        free_resnode(pcb, resnode);
+    }
+
+    clean_nodeidx(&nodeidx);
+
+    /* put the resnode entries back where they belong */
+    if (!dlq_empty(&resnodeQ)) {
+        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
+    } else if (!pcb->val && pcb->obj) {
+        if (pcb->logerrors) {
+            /* hack: the val_gen_instance_id code will generate
+             * instance IDs that start with /nc:rpc QName.
+             * The <rpc> node is currently unsupported in
+             * node searches since all YANG content starts
+             * from the RPC operation node;
+             * check for the <nc:rpc> node and suppress the warning
+             * if this is the node that is not found  */
+            if ((childnsid == 0 || childnsid == xmlns_nc_id()) && 
+                !xml_strcmp(childname, NCX_EL_RPC)) {
+                ;  // assume this is an error-path XPath string
+            } else if (axis != XP_AX_CHILD) {
+                res = ERR_NCX_NO_XPATH_DESCENDANT;
+                if (ncx_warning_enabled(res)) {
+                    log_warn("\nWarning: no descendant nodes found "
+                             "in XPath expr '%s'", 
+                             pcb->exprstr);
+                    ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
+                } else if (pcb->objmod) {
+                    ncx_inc_warnings(pcb->objmod);
+                }
+            } else {
+                res = ERR_NCX_NO_XPATH_CHILD;
+                if (ncx_warning_enabled(res)) {
+                    log_warn("\nWarning: no child nodes found "
+                             "in XPath expr '%s'", 
+                             pcb->exprstr);
+                    ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
+                } else if (pcb->objmod) {
+                    ncx_inc_warnings(pcb->objmod);
+                }
+            }
+            res = NO_ERR;
+        }
+    }
+
+    result->last = walkerparms.callcount;
+
+    return res;
+
+}  /* set_nodeset_child */
+
+
+/********************************************************************
+* FUNCTION set_nodeset_pfaxis
+*
+* Handles these axis node tests
+*
+*   preceding::*
+*   preceding-sibling::*
+*   following::*
+*   following-sibling::*
+*
+* Combinations with '//' are handled as well
+*
+* Check the current result nodeset and replace
+* each node with all the requested nodes instead,
+* based on the axis used
+*
+* The result set is changed to the selected axis
+* Since the current node is no longer going to
+* be part of the result set
+*
+* After this initial step, the desired filtering
+* is performed on each of the result nodes (if any)
+*
+* At this point, if a 'nsid' and/or 'name' is 
+* specified then any selected node not
+* containing this namespace and/or node name
+* will be removed
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == address of return XPath result nodeset
+*    nsid == 0 if any namespace is OK
+*            else only this namespace will be checked
+*    name == name of preceding node to find
+*            == NULL to find all child nodes
+*               In this mode, if the context object
+*               is config=true, then config=false
+*               preceding nodes will be skipped
+*    textmode == TRUE if just selecting text() nodes
+*                FALSE if ignored
+*    axis == axis in use for this current step
+*
+* OUTPUTS:
+*    result->nodeQ contents adjusted or replaced
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    set_nodeset_pfaxis (xpath_pcb_t *pcb,
+                        xpath_result_t *result,
+                        xmlns_id_t  nsid,
+                        const xmlChar *name,
+                        boolean textmode,
+                        ncx_xpath_axis_t axis)
+{
+    xpath_resnode_t      *resnode;
+    obj_template_t       *testobj;
+    val_value_t          *testval;
+    const xmlChar        *modname;
+    status_t              res;
+    boolean               fnresult, fncalled, cfgonly, useroot;
+    dlq_hdr_t             resnodeQ;
+    xpath_nodeidx_t       nodeidx;
+    xpath_walkerparms_t   walkerparms;
+    
+    if (!pcb->val && !pcb->obj) {
+        return NO_ERR;
+    }
+
+    if (dlq_empty(&result->r.nodeQ)) {
+        return NO_ERR;
+    }
+
+    dlq_createSQue(&resnodeQ);
+    res = NO_ERR;
+    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
+
+    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
+    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+
+    init_nodeidx(&nodeidx, &resnodeQ, 0);
+
+    walkerparms.nodeidx = &nodeidx;
+    walkerparms.res = NO_ERR;
+    walkerparms.lastval = NULL;
+    walkerparms.lastpos = 0;
+    walkerparms.callcount = 0;
+
+    /* the resnodes need to be deleted or moved to a tempQ
+     * to correctly track duplicates and remove them
+     */
+    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
+
+        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
+
+        /* select 1 or all children of the resnode 
+         * special YANG support; skip over nodes that
+         * are not config nodes if they were selected
+         * by the wildcard '*' operator
+         */
+        if (pcb->val) {
+            testval = resnode->node.valptr;
+
+            if (axis==XP_AX_PRECEDING || axis==XP_AX_FOLLOWING) {
+                fnresult = 
+                    val_find_all_pfaxis(value_walker_fn,
+                                        pcb, 
+                                        &walkerparms,
+                                        testval, 
+                                        modname,
+                                        name, 
+                                        cfgonly, 
+                                        resnode->dblslash, 
+                                        textmode,
+                                        axis);
+            } else {
+                fnresult = 
+                    val_find_all_pfsibling_axis(value_walker_fn,
+                                                pcb, 
+                                                &walkerparms,
+                                                testval, 
+                                                modname,
+                                                name, 
+                                                cfgonly, 
+                                                resnode->dblslash, 
+                                                textmode,
+                                                axis);
+
+            }
+            if (!fnresult || walkerparms.res != NO_ERR) {
+                res = walkerparms.res;
+            }
+        } else {
+            testobj = resnode->node.objptr;
+            fnresult = obj_find_all_pfaxis(pcb->objmod,
+                                           object_walker_fn,
+                                           pcb, 
+                                           &walkerparms,
+                                           testobj, 
+                                           modname,
+                                           name, 
+                                           cfgonly,
+                                           resnode->dblslash,
+                                           textmode,
+                                           useroot,
+                                           axis, 
+                                           &fncalled);
+            if (!fnresult || walkerparms.res != NO_ERR) {
+                res = walkerparms.res;
+            }
+        }
+        free_resnode(pcb, resnode);
+    }
+
+    clean_nodeidx(&nodeidx);
+
+    /* put the resnode entries back where they belong */
+    if (!dlq_empty(&resnodeQ)) {
+        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
+    } else if (!pcb->val && pcb->obj) {
+        res = ERR_NCX_NO_XPATH_NODES;
+        if (pcb->logerrors && ncx_warning_enabled(res)) {
+            log_warn("\nWarning: no axis nodes found "
+                     "in XPath expr '%s'", 
+                     pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
+        } else if (pcb->objmod != NULL) {
+            ncx_inc_warnings(pcb->objmod);
+        }
+        res = NO_ERR;
+    }
+
+    result->last = walkerparms.callcount;
+
+    return res;
+
+}  /* set_nodeset_pfaxis */
+
+
+/********************************************************************
+* FUNCTION set_nodeset_ancestor
+* 
+* Check the current result nodeset and move each
+* node to the specified ancestor, or remove it 
+* if none found that matches the filter criteria
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == address of return XPath result nodeset
+*    nsid == 0 if any namespace is OK
+*                 else only this namespace will be checked
+*    name == name of ancestor to find
+*              == NULL to find any ancestor nodes
+*                 In this mode, if the context object
+*                 is config=true, then config=false
+*                 children will be skipped
+*    textmode == TRUE if just selecting text() nodes
+*                FALSE if ignored
+*     axis == axis in use for this current step
+*             XP_AX_ANCESTOR or XP_AX_ANCESTOR_OR_SELF
+*
+* OUTPUTS:
+*    result->nodeQ contents adjusted or removed
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    set_nodeset_ancestor (xpath_pcb_t *pcb,
+                          xpath_result_t *result,
+                          xmlns_id_t  nsid,
+                          const xmlChar *name,
+                          boolean textmode,
+                          ncx_xpath_axis_t axis)
+{
+    xpath_resnode_t        *resnode, *testnode;
+    obj_template_t         *testobj;
+    val_value_t            *testval;
+    const xmlChar          *modname;
+    xpath_result_t         *dummy;
+    status_t                res;
+    boolean                 cfgonly, fnresult, fncalled, orself, useroot;
+    dlq_hdr_t               resnodeQ;
+    xpath_nodeidx_t         nodeidx, dummyidx;
+    xpath_walkerparms_t     walkerparms;
+
+    if (!pcb->val && !pcb->obj) {
+        return NO_ERR;
+    }
+
+    if (dlq_empty(&result->r.nodeQ)) {
+        return NO_ERR;
+    }
+
+    dlq_createSQue(&resnodeQ);
+
+    res = NO_ERR;
+    testval = NULL;
+    testobj = NULL;
+
+    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
+
+    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
+    useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
+    orself = (axis == XP_AX_ANCESTOR_OR_SELF) ? TRUE : FALSE;
+
+    init_nodeidx(&nodeidx, &resnodeQ, 0);
+
+    walkerparms.nodeidx = &nodeidx;
+    walkerparms.res = NO_ERR;
+    walkerparms.lastval = NULL;
+    walkerparms.lastpos = 0;
+
+    /* the resnodes need to be deleted or moved to a tempQ
+     * to correctly track duplicates and remove them
+     */
+    while (!dlq_empty(&result->r.nodeQ) && res == NO_ERR) {
+
+        resnode = (xpath_resnode_t *)dlq_deque(&result->r.nodeQ);
+
+        walkerparms.callcount = 0;
+
+        if (pcb->val) {
+            testval = resnode->node.valptr;
+            fnresult = val_find_all_ancestors(value_walker_fn,
+                                              pcb,
+                                              &walkerparms,
+                                              testval,
+                                              modname, 
+                                              name, 
+                                              cfgonly,
+                                              orself,
+                                              textmode);
+        } else {
+            testobj = resnode->node.objptr;
+            fnresult = obj_find_all_ancestors(pcb->objmod,
+                                              object_walker_fn,
+                                              pcb,
+                                              &walkerparms,
+                                              testobj,
+                                              modname, 
+                                              name, 
+                                              cfgonly,
+                                              textmode,
+                                              useroot,
+                                              orself,
+                                              &fncalled);
+
+        }
+        if (walkerparms.res != NO_ERR) {
+            res = walkerparms.res;
+        } else if (!fnresult) {
+            res = ERR_NCX_OPERATION_FAILED;
+        } else if (!walkerparms.callcount && resnode->dblslash) {
+            dummy = new_result(pcb, XP_RT_NODESET);
+            if (!dummy) {
+                res = ERR_INTERNAL_MEM;
+                continue;
+            }
+
+            init_nodeidx(&dummyidx, &dummy->r.nodeQ, 0);
+            walkerparms.nodeidx = &dummyidx;
+            walkerparms.lastval = NULL;
+            if (pcb->val) {
+                fnresult = val_find_all_descendants(value_walker_fn,
+                                                    pcb,
+                                                    &walkerparms,
+                                                    testval,
+                                                    modname, 
+                                                    name, 
+                                                    cfgonly,
+                                                    textmode,
+                                                    TRUE,
+                                                    FALSE);
+
+            } else {
+                fnresult = obj_find_all_descendants(pcb->objmod,
+                                                    object_walker_fn,
+                                                    pcb,
+                                                    &walkerparms,
+                                                    testobj,
+                                                    modname, 
+                                                    name, 
+                                                    cfgonly,
+                                                    textmode,
+                                                    useroot,
+                                                    TRUE,
+                                                    &fncalled);
+            }
+            walkerparms.nodeidx = &nodeidx;
+            walkerparms.lastval = NULL;
+            clean_nodeidx(&dummyidx);
+
+            if (walkerparms.res != NO_ERR) {
+                res = walkerparms.res;
+            } else if (!fnresult) {
+                res = ERR_NCX_OPERATION_FAILED;
+            } else {
+                res = set_nodeset_ancestor(pcb, 
+                                           dummy,
+                                           nsid, 
+                                           name, 
+                                           textmode,
+                                           axis);
+                while (!dlq_empty(&dummy->r.nodeQ)) {
+                    testnode = (xpath_resnode_t *)
+                        dlq_deque(&dummy->r.nodeQ);
+
+                    /* It is assumed that testnode cannot NULL because the call 
+                     * to dlq_empty returned false. */
+                    if (find_nodeidx(pcb, &nodeidx,
+                                     (const void *)testnode->node.valptr)) {
+                        free_resnode(pcb, testnode);
+                    } else {
+                        add_nodeidx(pcb, &nodeidx, testnode);
+                    }
+                }
+                free_result(pcb, dummy);
+            }
+        }
+
+        free_resnode(pcb, resnode);
+    }
+
+    clean_nodeidx(&nodeidx);
+
+    /* put the resnode entries back where they belong */
+    if (!dlq_empty(&resnodeQ)) {
+        dlq_block_enque(&resnodeQ, &result->r.nodeQ);
+    } else {
+        res = ERR_NCX_NO_XPATH_ANCESTOR;
+        if (pcb->logerrors && ncx_warning_enabled(res)) {
+            if (orself) {
+                log_warn("\nWarning: no ancestor-or-self nodes found "
+                         "in XPath expr '%s'", pcb->exprstr);
+            } else {
+                log_warn("\nWarning: no ancestor nodes found "
+                         "in XPath expr '%s'", pcb->exprstr);
+            }
+            ncx_print_errormsg(pcb->tkc, pcb->objmod, res);
+        } else if (pcb->objmod != NULL) {
+            ncx_inc_warnings(pcb->objmod);
+        }
+        res = NO_ERR;
+    }
+
+    result->last = walkerparms.callcount;
+
+    return res;
+
+}  /* set_nodeset_ancestor */
+
+
+/***********   B E G I N    E B N F    F U N C T I O N S *************/
+
+
+/********************************************************************
+* FUNCTION parse_node_test
+* 
+* Parse the XPath NodeTest sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [7] NodeTest ::= NameTest
+*                  | NodeType '(' ')'
+*                  | 'processing-instruction' '(' Literal ')'
+*
+* [37] NameTest ::= '*'
+*                  | NCName ':' '*'
+*                  | QName
+*
+* [38] NodeType ::= 'comment'
+*                    | 'text'   
+*                    | 'processing-instruction'
+*                    | 'node'
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    axis  == current axis from first part of Step
+*    result == address of pointer to result struct in progress
+*
+* OUTPUTS:
+*   *result is modified
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    parse_node_test (xpath_pcb_t *pcb,
+                     ncx_xpath_axis_t axis,
+                     xpath_result_t **result)
+{
+    const xmlChar     *name;
+    tk_type_t          nexttyp;
+    xpath_nodetype_t   nodetyp;
+    status_t           res;
+    xmlns_id_t         nsid;
+    boolean            emptyresult, textmode;
+
+    nsid = 0;
+    name = NULL;
+    textmode = FALSE;
+
+    res = TK_ADV(pcb->tkc);
+    if (res != NO_ERR) {
+        res = ERR_NCX_INVALID_XPATH_EXPR;
+        if (pcb->logerrors) {
+            log_error("\nError: token expected in XPath "
+                      "expression '%s'", pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, res);
+        } else {
+            /*** handle agent error ***/
+        }
+        return res;
+    }
+
+    /* process the tokens but not the result yet */
+    switch (TK_CUR_TYP(pcb->tkc)) {
+    case TK_TT_STAR:
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+        break;
+    case TK_TT_NCNAME_STAR:
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+        /* match all nodes in the namespace w/ specified prefix */
+        if (!pcb->tkc->cur->nsid) {
+            res = check_qname_prefix(pcb,
+                                     TK_CUR_VAL(pcb->tkc),
+                                     xml_strlen(TK_CUR_VAL(pcb->tkc)),
+                                     &pcb->tkc->cur->nsid);
+        }
+        if (res == NO_ERR) {
+            nsid = pcb->tkc->cur->nsid;
+        }
+        break;
+    case TK_TT_MSTRING:
+        /* match all nodes in the namespace w/ specified prefix */
+        if (!pcb->tkc->cur->nsid) {
+            res = check_qname_prefix(pcb, 
+                                     TK_CUR_MOD(pcb->tkc),
+                                     TK_CUR_MODLEN(pcb->tkc),
+                                     &pcb->tkc->cur->nsid);
+        }
+        if (res == NO_ERR) {
+            nsid = pcb->tkc->cur->nsid;
+            name = TK_CUR_VAL(pcb->tkc);
+        }
+        break;
+    case TK_TT_TSTRING:
+        /* check the ID token for a NodeType name */
+        nodetyp = get_nodetype_id(TK_CUR_VAL(pcb->tkc));
+        if (nodetyp == XP_EXNT_NONE ||
+            (tk_next_typ(pcb->tkc) != TK_TT_LPAREN)) {
+            name = TK_CUR_VAL(pcb->tkc);
+            break;
+        }
+
+        /* get the node test left paren */
+        res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        /* check if a literal param can be present */
+        if (nodetyp == XP_EXNT_PROC_INST) {
+            /* check if a literal param is present */
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (nexttyp==TK_TT_QSTRING ||
+                nexttyp==TK_TT_SQSTRING) {
+                /* temp save the literal string */
+                res = xpath_parse_token(pcb, nexttyp);
+                if (res != NO_ERR) {
+                    return res;
+                }
+            }
+        }
+
+        /* get the node test right paren */
+        res = xpath_parse_token(pcb, TK_TT_RPAREN);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+
+        /* process the result based on the node type test */
+        switch (nodetyp) {
+        case XP_EXNT_COMMENT:
+            /* no comments to match */
+            emptyresult = TRUE;
+            if (pcb->obj && 
+                pcb->logerrors && 
+                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+                log_warn("\nWarning: no comment nodes available in "
+                         "XPath expr '%s'", 
+                         pcb->exprstr);
+                ncx_print_errormsg(pcb->tkc, 
+                                   pcb->tkerr.mod,
+                                   ERR_NCX_EMPTY_XPATH_RESULT);
+            } else if (pcb->objmod != NULL) {
+                ncx_inc_warnings(pcb->objmod);
+            }
+
+            break;
+        case XP_EXNT_TEXT:
+            /* match all leaf of leaf-list content */
+            emptyresult = FALSE;
+            textmode = TRUE;
+            break;
+        case XP_EXNT_PROC_INST:
+            /* no processing instructions to match */
+            emptyresult = TRUE;
+            if (pcb->obj && 
+                pcb->logerrors &&
+                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+                log_warn("\nWarning: no processing instruction "
+                         "nodes available in "
+                         "XPath expr '%s'", 
+                         pcb->exprstr);
+                ncx_print_errormsg(pcb->tkc, 
+                                   pcb->tkerr.mod,
+                                   ERR_NCX_EMPTY_XPATH_RESULT);
+            } else if (pcb->objmod != NULL) {
+                ncx_inc_warnings(pcb->objmod);
+            }
+            break;
+        case XP_EXNT_NODE:
+            /* match any node */
+            emptyresult = FALSE;
+            break;
+        default:
+            emptyresult = TRUE;
+            res = SET_ERROR(ERR_INTERNAL_VAL);
+        }
+
+        if (emptyresult) {
+            if (*result) {
+                free_result(pcb, *result);
+            }
+            *result = new_result(pcb, XP_RT_NODESET);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+            return res;
+        }  /* else go on to the text() or node() test */
+        break;
+    default:
+        /* wrong token type found */
+        res = ERR_NCX_WRONG_TKTYPE;
+        unexpected_error(pcb);
+    }
+
+    /* do not care about result if fatal error occurred */
+    if (res != NO_ERR) {
+        return res;
+    } else if (!pcb->val && !pcb->obj) {
+        /* nothing to do in first pass except create
+         * dummy result to flag that a location step
+         * has already started
+         */
+        if (!*result) {
+            *result = new_result(pcb, XP_RT_NODESET);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+        return res;
+    }
+
+
+    /* if we get here, then the axis and name fields are set
+     * or a texttest is needed
+     */
+    switch (axis) {
+    case XP_AX_ANCESTOR:
+    case XP_AX_ANCESTOR_OR_SELF:
+        if (!*result) {
+            *result = new_nodeset(pcb,
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+        if (res == NO_ERR) {
+            res = set_nodeset_ancestor(pcb, 
+                                       *result,
+                                       nsid, 
+                                       name,
+                                       textmode,
+                                       axis);
+        } 
+        break;
+    case XP_AX_ATTRIBUTE:
+        /* Attribute support in XPath is TBD
+         * YANG does not define them and the ncx:metadata
+         * extension is not fully supported within the 
+         * the edit-config code yet anyway
+         *
+         * just set the result to the empty nodeset
+         */
+        if (pcb->obj && 
+            pcb->logerrors &&
+            ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+            log_warn("\nWarning: attribute axis is empty in "
+                     "XPath expr '%s'", pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, 
+                               pcb->tkerr.mod,
+                               ERR_NCX_EMPTY_XPATH_RESULT);
+        } else if (pcb->objmod != NULL) {
+            ncx_inc_warnings(pcb->objmod);
+        }
+
+        if (*result) {
+            free_result(pcb, *result);
+        }
+        *result = new_result(pcb, XP_RT_NODESET);
+        if (!*result) {
+            res = ERR_INTERNAL_MEM;
+        }
+        break;
+    case XP_AX_DESCENDANT:
+    case XP_AX_DESCENDANT_OR_SELF:
+    case XP_AX_CHILD:
+        /* select all the child nodes of each node in 
+         * the result node set.
+         * ALSO select all the descendant nodes of each node in 
+         * the result node set. (they are the same in NETCONF)
+         */
+        if (!*result) {
+            /* first step is child::* or descendant::*    */
+            *result = new_nodeset(pcb, 
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+        if (res == NO_ERR) {
+            res = set_nodeset_child(pcb, 
+                                    *result, 
+                                    nsid, 
+                                    name, 
+                                    textmode,
+                                    axis);
+        }
+        break;
+    case XP_AX_FOLLOWING:
+    case XP_AX_PRECEDING:
+    case XP_AX_FOLLOWING_SIBLING:
+    case XP_AX_PRECEDING_SIBLING:
+        /* need to set the result to all the objects
+         * or all instances of all value nodes
+         * preceding or following the context node
+         */
+        if (!*result) {
+            /* first step is following::* or preceding::* */
+            *result = new_nodeset(pcb, 
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+
+        if (res == NO_ERR) {
+            res = set_nodeset_pfaxis(pcb,
+                                     *result,
+                                     nsid, 
+                                     name,
+                                     textmode,
+                                     axis);
+        }        
+        break;
+    case XP_AX_NAMESPACE:
+        /* for NETCONF purposes, there is no need to
+         * provide access to namespace xmlns declarations
+         * within the object or value tree
+         * This can be added later!
+         *
+         *
+         * For now, just turn the result into the empty set
+         */
+        if (pcb->obj && 
+            pcb->logerrors &&
+            ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+            log_warn("Warning: namespace axis is empty in "
+                     "XPath expr '%s'", 
+                     pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, 
+                               pcb->tkerr.mod,
+                               ERR_NCX_EMPTY_XPATH_RESULT);
+        } else if (pcb->objmod != NULL) {
+            ncx_inc_warnings(pcb->objmod);
+        }
+
+        if (*result) {
+            free_result(pcb, *result);
+        }
+        *result = new_result(pcb, XP_RT_NODESET);
+        if (!*result) {
+            res = ERR_INTERNAL_MEM;
+        }
+        break;
+    case XP_AX_PARENT:
+        /* step is parent::*  -- same as .. for nodes  */
+        if (textmode) {
+            if (pcb->obj && 
+                pcb->logerrors &&
+                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+                log_warn("Warning: parent axis contains no text nodes in "
+                     "XPath expr '%s'", 
+                         pcb->exprstr);
+                ncx_print_errormsg(pcb->tkc, 
+                                   pcb->tkerr.mod,
+                                   ERR_NCX_EMPTY_XPATH_RESULT);
+            } else if (pcb->objmod != NULL) {
+                ncx_inc_warnings(pcb->objmod);
+            }
+
+            if (*result) {
+                free_result(pcb, *result);
+            }
+            *result = new_result(pcb, XP_RT_NODESET);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+            break;
+        }
+            
+        if (!*result) {
+            *result = new_nodeset(pcb, 
+                                  pcb->context.node.objptr, 
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+
+        if (res == NO_ERR) {
+            res = set_nodeset_parent(pcb, 
+                                     *result, 
+                                     nsid,
+                                     name);
+        }
+        break;
+    case XP_AX_SELF:
+        /* keep the same context node */
+        if (!*result) {
+            /* first step is self::*   */
+            *result = new_nodeset(pcb, 
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+        if (res == NO_ERR) {
+            res = set_nodeset_self(pcb,
+                                   *result,
+                                   nsid,
+                                   name,
+                                   textmode);
+        }                                  
+        break;
+    case XP_AX_NONE:
+    default:
+        res = SET_ERROR(ERR_INTERNAL_VAL);
+    }
+
+    return res;
+
+}  /* parse_node_test */
+
+
+/********************************************************************
+* FUNCTION parse_predicate
+* 
+* Parse an XPath Predicate sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [8] Predicate ::= '[' PredicateExpr ']'
+* [9] PredicateExpr ::= Expr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == address of result in progress to filter
+*
+* OUTPUTS:
+*   *result may be pruned based on filter matches
+*            nodes may be updated if descendants are
+*            checked and matches are found
+*
+* RETURNS:
+*   malloced result of predicate expression
+*********************************************************************/
+static status_t
+    parse_predicate (xpath_pcb_t *pcb,
+                     xpath_result_t **result)
+{
+    xpath_result_t  *val1, *contextset;
+    xpath_resnode_t  lastcontext, *resnode, *nextnode;
+    tk_token_t      *leftbrack;
+    boolean          boo;
+    status_t         res;
+    int64            position;
+
+    res = xpath_parse_token(pcb, TK_TT_LBRACK);
+    if (res != NO_ERR) {
+        return res;
+    }
+
+    boo = FALSE;
+    if (pcb->val || pcb->obj) {
+        leftbrack = TK_CUR(pcb->tkc);
+        contextset = *result;
+        if (!contextset) {
+            return SET_ERROR(ERR_INTERNAL_VAL);
+        } else if (contextset->restype == XP_RT_NODESET) {
+            if (dlq_empty(&contextset->r.nodeQ)) {
+                /* always one pass; do not care about result */
+                val1 = parse_expr(pcb, &res);
+                if (res == NO_ERR) {
+                    res = xpath_parse_token(pcb, TK_TT_RBRACK);
+                }
+                if (val1) {
+                    free_result(pcb, val1);
+                }
+                return res;
+            }
+
+            lastcontext.node.valptr = 
+                pcb->context.node.valptr;
+            lastcontext.position = pcb->context.position;
+            lastcontext.last = pcb->context.last;
+            lastcontext.dblslash = pcb->context.dblslash;
+
+            for (resnode = (xpath_resnode_t *)
+                     dlq_firstEntry(&contextset->r.nodeQ);
+                 resnode != NULL;
+                 resnode = nextnode) {
+
+                /* go over and over the predicate expression
+                 * with the resnode as the current context node
+                 */
+                TK_CUR(pcb->tkc) = leftbrack;
+                boo = FALSE;
+
+                nextnode = (xpath_resnode_t *)
+                    dlq_nextEntry(resnode);
+
+                pcb->context.node.valptr = resnode->node.valptr;
+                pcb->context.position = resnode->position;
+                pcb->context.last = contextset->last;
+                pcb->context.dblslash = resnode->dblslash;
+
+#ifdef EXTRA_DEBUG
+                if (LOGDEBUG3 && pcb->val) {
+                    log_debug3("\nXPath setting context node: %s",
+                               pcb->context.node.valptr->name);
+                }
+#endif
+
+                val1 = parse_expr(pcb, &res);
+                if (res != NO_ERR) {
+                    if (val1) {
+                        free_result(pcb, val1);
+                    }
+                    return res;
+                }
+            
+                res = xpath_parse_token(pcb, TK_TT_RBRACK);
+                if (res != NO_ERR) {
+                    if (val1) {
+                        free_result(pcb, val1);
+                    }
+                    return res;
+                }
+
+                if (val1->restype == XP_RT_NUMBER) {
+                    /* the predicate specifies a context
+                     * position and this resnode is
+                     * only selected if it is the Nth
+                     * instance within the current context
+                     */
+                    if (ncx_num_is_integral(&val1->r.num,
+                                            NCX_BT_FLOAT64)) {
+                        position = 
+                            ncx_cvt_to_int64(&val1->r.num,
+                                             NCX_BT_FLOAT64);
+                        /* check if the proximity position
+                         * of this node matches the position
+                         * value from this expression
+                         */
+                        boo = (position == resnode->position) ?
+                            TRUE : FALSE;
+                    } else {
+                        boo = FALSE;
+                    }
+                } else {
+                    boo = xpath_cvt_boolean(val1);
+                }
+                free_result(pcb, val1);
+
+                if (!boo) {
+                    /* predicate expression evaluated to false
+                     * so delete this resnode from the result
+                     */
+                    dlq_remove(resnode);
+                    free_resnode(pcb, resnode);
+                }
+            }
+
+            pcb->context.node.valptr = 
+                lastcontext.node.valptr;
+            pcb->context.position = lastcontext.position;
+            pcb->context.last = lastcontext.last;
+            pcb->context.dblslash = lastcontext.dblslash;
+
+#ifdef EXTRA_DEBUG
+            if (LOGDEBUG3 && pcb->val) {
+                log_debug3("\nXPath set context node to last: %s",
+                           pcb->context.node.valptr->name);
+            }
+#endif
+
+        } else {
+            /* result is from a primary expression and
+             * is not a nodeset.  It will get cleared
+             * if the predicate evaluates to false
+             */
+            val1 = parse_expr(pcb, &res);
+            if (res != NO_ERR) {
+                if (val1) {
+                    free_result(pcb, val1);
+                }
+                return res;
+            }
+            
+            res = xpath_parse_token(pcb, TK_TT_RBRACK);
+            if (res != NO_ERR) {
+                if (val1) {
+                    free_result(pcb, val1);
+                }
+                return res;
+            }
+
+            if (val1 && pcb->val) {
+                boo = xpath_cvt_boolean(val1);
+            }
+            if (val1) {
+                free_result(pcb, val1);
+            }
+            if (pcb->val && !boo && *result) {
+                xpath_clean_result(*result);
+                xpath_init_result(*result, XP_RT_NONE);
+            }
+        }
+    } else {
+        /* always one pass; do not care about result */
+        val1 = parse_expr(pcb, &res);
+        if (res == NO_ERR) {
+            res = xpath_parse_token(pcb, TK_TT_RBRACK);
+        }
+        if (val1) {
+            free_result(pcb, val1);
+        }
+    }
+
+    return res;
+
+} /* parse_predicate */
+
+
+/********************************************************************
+* FUNCTION parse_step
+* 
+* Parse the XPath Step sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [4] Step  ::=  AxisSpecifier NodeTest Predicate*        
+*                | AbbreviatedStep        
+*
+* [12] AbbreviatedStep ::= '.'        | '..'
+*
+* [5] AxisSpecifier ::= AxisName '::'
+*                | AbbreviatedAxisSpecifier
+*
+* [13] AbbreviatedAxisSpecifier ::= '@'?
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == address of erturn XPath result nodeset
+*
+
+* OUTPUTS:
+*   *result pointer is set to malloced result struct
+*    if it is NULL, or used if it is non-NULL;
+*    MUST be a XP_RT_NODESET result
+
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    parse_step (xpath_pcb_t *pcb,
+                xpath_result_t **result)
+{
+    const xmlChar    *nextval;
+    tk_type_t         nexttyp, nexttyp2;
+    ncx_xpath_axis_t  axis;
+    status_t          res;
+
+    nexttyp = tk_next_typ(pcb->tkc);
+    axis = XP_AX_CHILD;
+
+    /* check start token '/' or '//' */
+    if (nexttyp == TK_TT_DBLFSLASH) {
+        res = xpath_parse_token(pcb, TK_TT_DBLFSLASH);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+
+        if (!*result) {
+            *result = new_nodeset(pcb,
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  TRUE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
+            }
+            pcb->depnonlocal = TRUE;
+        }
+        set_nodeset_dblslash(pcb, *result);
+    } else if (nexttyp == TK_TT_FSLASH) {
+        res = xpath_parse_token(pcb, TK_TT_FSLASH);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        if (!*result) {
+            /* this is the first call */
+            *result = new_nodeset(pcb, 
+                                  pcb->docroot, 
+                                  pcb->val_docroot,
+                                  1,
+                                  FALSE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
+            }
+            pcb->depnonlocal = TRUE;
+
+            /* check corner-case path '/' */
+            if (location_path_end(pcb)) {
+                /* exprstr is simply docroot '/' */
+                return NO_ERR;
+            }
+        }
+    } else if (*result) {
+        /* should not happen */
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return ERR_NCX_INVALID_XPATH_EXPR;
+    }
+
+    /* handle an abbreviated step (. or ..) or
+     * handle the axis-specifier for the full form step
+     */
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_PERIOD:
+        /* abbreviated step '.': 
+         * current target node stays the same unless
+         * this is the first token in the location path,
+         * then the context result needs to be initialized
+         *
+         * first consume the period token
+         */
+        res = xpath_parse_token(pcb, TK_TT_PERIOD);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        /* first step is simply . */
+        if (!*result) {
+            *result = new_nodeset(pcb,
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
+            }
+        } /* else leave current result alone */
+        return NO_ERR;
+    case TK_TT_RANGESEP:
+        /* abbrev step '..': 
+         * matches parent of current context */
+        res = xpath_parse_token(pcb, TK_TT_RANGESEP);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+
+        /* step is .. or  //.. */
+        if (!*result) {
+            /* first step is .. or //..     */
+            *result = new_nodeset(pcb, 
+                                  pcb->context.node.objptr, 
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+        if (res == NO_ERR) {
+            pcb->depnonlocal = TRUE;
+            res = set_nodeset_parent(pcb, 
+                                     *result,
+                                     0,
+                                     NULL);
+        }
+        return res;
+    case TK_TT_ATSIGN:
+        axis = XP_AX_ATTRIBUTE;
+        res = xpath_parse_token(pcb, TK_TT_ATSIGN);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+        break;
+    case TK_TT_STAR:
+    case TK_TT_NCNAME_STAR:
+    case TK_TT_MSTRING:
+        /* set the axis to default child, hit node test */
+        axis = XP_AX_CHILD;
+        break;
+    case TK_TT_TSTRING:
+        /* check the ID token for an axis name */
+        nexttyp2 = tk_next_typ2(pcb->tkc);
+        nextval = tk_next_val(pcb->tkc);
+        axis = get_axis_id(nextval);
+        if (axis != XP_AX_NONE && nexttyp2==TK_TT_DBLCOLON) {
+            /* correct axis-name :: sequence */
+            res = xpath_parse_token(pcb, TK_TT_TSTRING);
+            if (res != NO_ERR) {
+                return res;
+            }
+            res = xpath_parse_token(pcb, TK_TT_DBLCOLON);
+            if (res != NO_ERR) {
+                return res;
+            }
+
+            if (pcb->flags & XP_FL_INSTANCEID) {
+                invalid_instanceid_error(pcb);
+                return ERR_NCX_INVALID_INSTANCEID;
+            }
+        } else if (axis == XP_AX_NONE && nexttyp2==TK_TT_DBLCOLON) {
+            /* incorrect axis-name :: sequence */
+            (void)TK_ADV(pcb->tkc);
+            res = ERR_NCX_INVALID_XPATH_EXPR;
+            if (pcb->logerrors) {
+                log_error("\nError: invalid axis name '%s' in "
+                          "XPath expression '%s'",
+                          (TK_CUR_VAL(pcb->tkc) != NULL) ?
+                          TK_CUR_VAL(pcb->tkc) : EMPTY_STRING,
+                          pcb->exprstr);
+                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, res);
+            } else {
+                /*** log agent error ***/
+            }
+            (void)TK_ADV(pcb->tkc);
+            return res;
+        } else {
+            axis = XP_AX_CHILD;
+        }
+        break;
+    default:
+        /* wrong token type found */
+        (void)TK_ADV(pcb->tkc);
+        res = ERR_NCX_WRONG_TKTYPE;
+        unexpected_error(pcb);
+        return res;
+    }
+
+    switch (axis) {
+    case XP_AX_ATTRIBUTE:
+    case XP_AX_CHILD:
+    case XP_AX_DESCENDANT:
+    case XP_AX_DESCENDANT_OR_SELF:
+    case XP_AX_SELF:
+        break;
+    default:
+        pcb->depnonlocal = TRUE;
+    }
+
+    /* axis or default child parsed OK, get node test */
+    res = parse_node_test(pcb, axis, result);
+    if (res == NO_ERR) {
+        nexttyp = tk_next_typ(pcb->tkc);
+        while (nexttyp == TK_TT_LBRACK && res==NO_ERR) {
+            res = parse_predicate(pcb, result);
+            nexttyp = tk_next_typ(pcb->tkc);
+        }
+    }
+
+    return res;
+
+}  /* parse_step */
+
+
+/********************************************************************
+* FUNCTION record_obj_deps
+* 
+* Add the objects in a location step result to pcb->depQ
+* Only done while xpath1_get_obj_deps is running
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == step result nodeset to record
+*    pathonly == TRUE if more steps follow in the location path,
+*                so only the existence of these nodes is used
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    record_obj_deps (xpath_pcb_t *pcb,
+                     xpath_result_t *result,
+                     boolean pathonly)
+{
+    xpath_resnode_t  *resnode;
+    xpath_objdep_t   *dep;
+    obj_template_t   *obj;
+
+    if (!pcb->depQ || pcb->val || !result ||
+        result->restype != XP_RT_NODESET) {
+        return NO_ERR;
+    }
+
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+
+        /* the document root is the start of every absolute
+         * path; it does not mean the whole tree is read
+         */
+        obj = resnode->node.objptr;
+        if (!obj || obj_is_root(obj) || obj == pcb->docroot) {
+            continue;
+        }
+
+        for (dep = (xpath_objdep_t *)dlq_firstEntry(pcb->depQ);
+             dep != NULL && dep->obj != obj;
+             dep = (xpath_objdep_t *)dlq_nextEntry(dep)) {
+            ;
+        }
+        if (dep) {
+            if (!pathonly) {
+                dep->pathonly = FALSE;
+            }
+            continue;
+        }
+
+        dep = m__getObj(xpath_objdep_t);
+        if (!dep) {
+            malloc_failed_error(pcb);
+            return ERR_INTERNAL_MEM;
+        }
+        memset(dep, 0x0, sizeof(xpath_objdep_t));
+        dep->obj = obj;
+        dep->pathonly = pathonly;
+        dlq_enque(dep, pcb->depQ);
+    }
+
+    return NO_ERR;
+
+}  /* record_obj_deps */
+
+
+/********************************************************************
+* FUNCTION parse_location_path
+* 
+* Parse the Location-Path sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [1] LocationPath  ::=  RelativeLocationPath        
+*                       | AbsoluteLocationPath        
+*
+* [2] AbsoluteLocationPath ::= '/' RelativeLocationPath?
+*                     | AbbreviatedAbsoluteLocationPath        
+*
+* [10] AbbreviatedAbsoluteLocationPath ::= '//' RelativeLocationPath
+*
+* [3] RelativeLocationPath ::= Step
+*                       | RelativeLocationPath '/' Step
+*                       | AbbreviatedRelativeLocationPath
+*
+* [11] AbbreviatedRelativeLocationPath ::= 
+*               RelativeLocationPath '//' Step
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == result struct in progress or NULL if none
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_location_path (xpath_pcb_t *pcb,
+                         xpath_result_t *result,
+                         status_t *res)
+{
+    xpath_result_t     *val1;
+    tk_type_t           nexttyp;
+    boolean             done;
+
+    val1 = result;
+
+    done = FALSE;
+    while (!done && *res == NO_ERR) {
+        *res = parse_step(pcb, &val1);
+        if (*res == NO_ERR) {
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (!(nexttyp == TK_TT_FSLASH ||
+                  nexttyp == TK_TT_DBLFSLASH)) {
+                done = TRUE;
+            }
+            *res = record_obj_deps(pcb, val1, !done);
+        }
+    }
+
+    return val1;
+
+}  /* parse_location_path */
+
+
+/********************************************************************
+* FUNCTION apply_number_op
+* 
+* Apply an AdditiveExpr or MultiplicativeExpr operator
+*
+* INPUTS:
+*    exop == operator to apply
+*    num2 == 1st operand
+*    num1 == 2nd operand
+*    result == address of return number
+*
+* OUTPUTS:
+*   *result is set to the operator result
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    apply_number_op (xpath_exop_t exop,
+                     const ncx_num_t *num2,
+                     const ncx_num_t *num1,
+                     ncx_num_t *result)
+{
+    switch (exop) {
+    case XP_EXOP_ADD:
+        result->d = num2->d + num1->d;
+        break;
+    case XP_EXOP_SUBTRACT:
+        result->d = num2->d - num1->d;
+        break;
+    case XP_EXOP_MULTIPLY:
+        result->d = num2->d * num1->d;
+        break;
+    case XP_EXOP_DIV:
+        if (ncx_num_zero(num2, NCX_BT_FLOAT64)) {
+            ncx_set_num_max(result, NCX_BT_FLOAT64);
+        } else {
+            result->d = num2->d / num1->d;
+        }
+        break;
+    case XP_EXOP_MOD:
+        result->d = num2->d / num1->d;
+#ifdef HAS_FLOAT
+        result->d = trunc(result->d);
+#endif
+        break;
+    default:
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+    return NO_ERR;
+
+}  /* apply_number_op */
+
+
+/********************************************************************
+* FUNCTION combine_results
+* 
+* Apply the operator of an OrExpr, AndExpr, EqualityExpr,
+* RelationalExpr, AdditiveExpr or MultiplicativeExpr
+* to its 2 operands
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    exop == operator to apply
+*    val2 == 1st operand
+*    val1 == 2nd operand
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if some error;
+*   the operands are not freed
+*********************************************************************/
+static xpath_result_t *
+    combine_results (xpath_pcb_t *pcb,
+                     xpath_exop_t exop,
+                     xpath_result_t *val2,
+                     xpath_result_t *val1,
+                     status_t *res)
+{
+    xpath_result_t  *result;
+    ncx_num_t        num1, num2;
+    boolean          boo, bool1, bool2;
+
+    switch (exop) {
+    case XP_EXOP_AND:
+    case XP_EXOP_OR:
+        bool1 = xpath_cvt_boolean(val1);
+        bool2 = xpath_cvt_boolean(val2);
+        if (exop == XP_EXOP_AND) {
+            boo = (bool1 && bool2) ? TRUE : FALSE;
+        } else {
+            boo = (bool1 || bool2) ? TRUE : FALSE;
+        }
+        break;
+    case XP_EXOP_EQUAL:
+    case XP_EXOP_NOTEQUAL:
+    case XP_EXOP_LT:
+    case XP_EXOP_GT:
+    case XP_EXOP_LEQUAL:
+    case XP_EXOP_GEQUAL:
+        boo = compare_results(pcb, val2, val1, exop, res);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+        break;
+    case XP_EXOP_ADD:
+    case XP_EXOP_SUBTRACT:
+    case XP_EXOP_MULTIPLY:
+    case XP_EXOP_DIV:
+    case XP_EXOP_MOD:
+        ncx_init_num(&num1);
+        ncx_init_num(&num2);
+
+        if (val1->restype != XP_RT_NUMBER) {
+            xpath_cvt_number(val1, &num1);
+        } else {
+            *res = ncx_copy_num(&val1->r.num, &num1, NCX_BT_FLOAT64);
+        }
+
+        if (val2->restype != XP_RT_NUMBER) {
+            xpath_cvt_number(val2, &num2);
+        } else {
+            *res = ncx_copy_num(&val2->r.num, &num2, NCX_BT_FLOAT64);
+        }
+
+        result = NULL;
+        if (*res == NO_ERR) {
+            result = new_result(pcb, XP_RT_NUMBER);
+            if (!result) {
+                *res = ERR_INTERNAL_MEM;
+            } else {
+                *res = apply_number_op(exop, &num2, &num1, 
+                                       &result->r.num);
+                if (*res != NO_ERR) {
+                    free_result(pcb, result);
+                    result = NULL;
+                }
+            }
+        }
+
+        ncx_clean_num(NCX_BT_FLOAT64, &num1);
+        ncx_clean_num(NCX_BT_FLOAT64, &num2);
+        return result;
+    default:
+        *res = SET_ERROR(ERR_INTERNAL_VAL);
+        return NULL;
+    }
+
+    result = new_result(pcb, XP_RT_BOOLEAN);
+    if (!result) {
+        *res = ERR_INTERNAL_MEM;
+    } else {
+        result->r.boo = boo;
+    }
+    return result;
+
+}  /* combine_results */
+
+
+/********************************************************************
+* FUNCTION get_varbind_result
+* 
+* Get the value of a variable reference as an XPath result
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    tk == TK_TT_VARBIND or TK_TT_QVARBIND token
+*          must be the current token in pcb->tkc
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if some error
+*********************************************************************/
+static xpath_result_t *
+    get_varbind_result (xpath_pcb_t *pcb,
+                        const tk_token_t *tk,
+                        status_t *res)
+{
+    xpath_result_t  *val1;
+    ncx_var_t       *varbind;
+    const xmlChar   *errstr;
+
+    val1 = NULL;
+    if (tk->typ == TK_TT_VARBIND) {
+        varbind = get_varbind(pcb, NULL, 0, tk->val, res);
+        errstr = tk->val;
+    } else {
+        varbind = get_varbind(pcb, tk->mod, tk->modlen, tk->val, res);
+        errstr = tk->mod;
+    }
+    if (!varbind || *res != NO_ERR) {
+        if (pcb->logerrors) {
+            if (*res == ERR_NCX_DEF_NOT_FOUND) {
+                log_error("\nError: unknown variable binding '%s'",
+                          errstr);
+                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+            } else {
+                log_error("\nError: error in variable binding '%s'",
+                          errstr);
+                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+            }
+        }
+    } else {
+        /* OK: found the variable binding */
+        val1 = cvt_from_value(pcb, varbind->val);
+        if (!val1) {
+            *res = ERR_INTERNAL_MEM;
+        }
+    }
+    return val1;
+
+}  /* get_varbind_result */
+
+
+/********************************************************************
+* FUNCTION call_function
+* 
+* Check the parameter count and make an XPath function call
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    fncb == function to call
+*    parmQ == Q of xpath_result_t parameters
+*    parmcnt == number of parameters parsed, including
+*               the ones that did not produce a result
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if none
+*********************************************************************/
+static xpath_result_t *
+    call_function (xpath_pcb_t *pcb,
+                   const xpath_fncb_t *fncb,
+                   dlq_hdr_t *parmQ,
+                   int32 parmcnt,
+                   status_t *res)
+{
+    xpath_result_t  *val1;
+
+    val1 = NULL;
+
+    /* check parameter count */
+    if (fncb->parmcnt >= 0 && fncb->parmcnt != parmcnt) {
+        *res = (parmcnt > fncb->parmcnt) ?
+            ERR_NCX_EXTRA_PARM : ERR_NCX_MISSING_PARM;
+
+        if (pcb->logerrors) {       
+            log_error("\nError: wrong number of "
+                      "parameters got %d, need %d"
+                      " for function '%s'",
+                      parmcnt, fncb->parmcnt,
+                      fncb->name);
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+        } else {
+            /*** log agent error ***/
+        }
+    } else {
+        /* make the function call */
+        val1 = (*fncb->fn)(pcb, parmQ, res);
+
+        if (LOGDEBUG3) {
+            if (val1) {
+                log_debug3("\nXPath fn %s result:",
+                           fncb->name);
+                dump_result(pcb, val1, NULL);
+                if (pcb->val && pcb->context.node.valptr->name) {
+                    log_debug3("\nXPath context val name: %s",
+                               pcb->context.node.valptr->name);
+                }
+            }
+        }
+    }
+    return val1;
+
+}  /* call_function */
+
+
+/********************************************************************
+* FUNCTION parse_function_call
+* 
+* Parse an XPath FunctionCall sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [16] FunctionCall ::= FunctionName 
+*                        '(' ( Argument ( ',' Argument )* )? ')'
+* [17] Argument ::= Expr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_function_call (xpath_pcb_t *pcb,
+                         status_t *res)
+{
+    xpath_result_t         *val1, *val2;
+    const xpath_fncb_t     *fncb;
+    dlq_hdr_t               parmQ;
+    tk_type_t               nexttyp;
+    int32                   parmcnt;
+    boolean                 done;
+
+    val1 = NULL;
+    parmcnt = 0;
+    dlq_createSQue(&parmQ);
+
+    /* get the function name */
+    *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+    if (*res != NO_ERR) {
+        return NULL;
+    }
+
+    if (pcb->flags & XP_FL_INSTANCEID) {
+        invalid_instanceid_error(pcb);
+        *res = ERR_NCX_INVALID_INSTANCEID;
+        return NULL;
+    }
+
+    /* find the function in the library */
+    fncb = NULL;
+    if (TK_CUR_VAL(pcb->tkc) != NULL) {
+        fncb = find_fncb(pcb, TK_CUR_VAL(pcb->tkc));
+    }
+    if (fncb) {
+        /* get the mandatory left paren */
+        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+
+        /* get parms until a matching right paren is reached */
+        nexttyp = tk_next_typ(pcb->tkc);
+        done = (nexttyp == TK_TT_RPAREN) ? TRUE : FALSE;
+        while (!done && *res == NO_ERR) {
+            val1 = parse_expr(pcb, res);
+            if (*res == NO_ERR) {
+                parmcnt++;
+                if (val1) {
+                    dlq_enque(val1, &parmQ);
+                    val1 = NULL;
+                }
+
+                /* check for right paren or else should be comma */
+                nexttyp = tk_next_typ(pcb->tkc);
+                if (nexttyp == TK_TT_RPAREN) {
+                    done = TRUE;
+                } else {
+                    *res = xpath_parse_token(pcb, TK_TT_COMMA);
+                }
+            }
+        }
+
+        /* get closing right paren */
+        if (*res == NO_ERR) {
+            *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+        }
+
+        val1 = call_function(pcb, fncb, &parmQ, parmcnt, res);
+    } else {
+        *res = ERR_NCX_UNKNOWN_PARM;
+
+        if (pcb->logerrors) {   
+            log_error("\nError: Invalid XPath function name '%s'",
+                      (TK_CUR_VAL(pcb->tkc) != NULL) ?
+                      TK_CUR_VAL(pcb->tkc) : EMPTY_STRING);
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+        } else {
+            /*** log agent error ***/
+        }
+    }
+
+    /* clean up any function parameters */
+    while (!dlq_empty(&parmQ)) {
+        val2 = (xpath_result_t *)dlq_deque(&parmQ);
+        free_result(pcb, val2);
+    }
+
+    return val1;
+
+} /* parse_function_call */
+
+
+/********************************************************************
+* FUNCTION parse_primary_expr
+* 
+* Parse an XPath PrimaryExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [15] PrimaryExpr ::= VariableReference
+*                       | '(' Expr ')'
+*                       | Literal
+*                       | Number
+*                       | FunctionCall
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_primary_expr (xpath_pcb_t *pcb,
+                        status_t *res)
+{
+    xpath_result_t         *val1;
+    tk_type_t               nexttyp;
+    ncx_numfmt_t            numfmt;
+
+    val1 = NULL;
+    nexttyp = tk_next_typ(pcb->tkc);
+
+    switch (nexttyp) {
+    case TK_TT_VARBIND:
+    case TK_TT_QVARBIND:
+        *res = xpath_parse_token(pcb, nexttyp);
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            *res = ERR_NCX_INVALID_INSTANCEID;
+            return NULL;
+        }
+
+        /* get QName or NCName variable reference
+         * but only if this get is a real one
+         */
+        if (*res == NO_ERR && pcb->val) {
+            val1 = get_varbind_result(pcb, TK_CUR(pcb->tkc), res);
+        }
+        break;
+    case TK_TT_LPAREN:
+        /* get ( expr ) */
+        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (*res == NO_ERR) {
+
+            if (pcb->flags & XP_FL_INSTANCEID) {
+                invalid_instanceid_error(pcb);
+                *res = ERR_NCX_INVALID_INSTANCEID;
+                return NULL;
+            }
+
+            val1 = parse_expr(pcb, res);
+            if (*res == NO_ERR) {
+                *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+            }
+        }
+        break;
+    case TK_TT_DNUM:
+    case TK_TT_RNUM:
+        *res = xpath_parse_token(pcb, nexttyp);
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            *res = ERR_NCX_INVALID_INSTANCEID;
+            return NULL;
+        }
+
+        /* get the Number token */
+        if (*res == NO_ERR) {
+            val1 = new_result(pcb, XP_RT_NUMBER);
+            if (!val1) {
+                *res = ERR_INTERNAL_MEM;
+                return NULL;
+            }
+
+            numfmt = ncx_get_numfmt(TK_CUR_VAL(pcb->tkc));
+            if (numfmt == NCX_NF_OCTAL) {
+                numfmt = NCX_NF_DEC;
+            }
+            if (numfmt == NCX_NF_DEC || numfmt == NCX_NF_REAL) {
+                *res = ncx_convert_num(TK_CUR_VAL(pcb->tkc),
+                                       numfmt,
+                                       NCX_BT_FLOAT64,
+                                       &val1->r.num);
+            } else if (numfmt == NCX_NF_NONE) {
+                *res = ERR_NCX_INVALID_VALUE;
+            } else {
+                *res = ERR_NCX_WRONG_NUMTYP;
+            }
+        }
+        break;
+    case TK_TT_QSTRING:             /* double quoted string */
+    case TK_TT_SQSTRING:            /* single quoted string */
+        /* get the literal token */
+        *res = xpath_parse_token(pcb, nexttyp);
+
+        if (*res == NO_ERR) {
+            val1 = new_result(pcb, XP_RT_STRING);
+            if (!val1) {
+                *res = ERR_INTERNAL_MEM;
+                return NULL;
+            }
+
+            if (TK_CUR_VAL(pcb->tkc) != NULL) {
+                val1->r.str = xml_strdup(TK_CUR_VAL(pcb->tkc));
+            } else {
+                val1->r.str = xml_strdup(EMPTY_STRING);
+            }
+            if (!val1->r.str) {
+                *res = ERR_INTERNAL_MEM;
+                malloc_failed_error(pcb);
+                xpath_free_result(val1);
+                val1 = NULL;
+            }
+        }
+        break;
+    case TK_TT_TSTRING:                    /* NCName string */
+        /* get the string ID token */
+        nexttyp = tk_next_typ2(pcb->tkc);
+        if (nexttyp == TK_TT_LPAREN) {
+            val1 = parse_function_call(pcb, res);
+        } else {
+            *res = SET_ERROR(ERR_INTERNAL_VAL);
+        }
+        break;
+    case TK_TT_NONE:
+        /* unexpected end of token chain */
+        (void)TK_ADV(pcb->tkc);
+        *res = ERR_NCX_INVALID_XPATH_EXPR;
+        if (pcb->logerrors) {
+            log_error("\nError: token expected in XPath expression '%s'",
+                      pcb->exprstr);
+            /* hack to get correct error token to print */
+            pcb->tkc->curerr = &pcb->tkerr;
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+        } else {
+            ;  /**** log agent error ****/
+        }
+        break;
+    default:
+        /* unexpected token error */
+        (void)TK_ADV(pcb->tkc);
+        *res = ERR_NCX_WRONG_TKTYPE;
+        unexpected_error(pcb);
+    }
+
+    return val1;
+
+} /* parse_primary_expr */
+
+
+/********************************************************************
+* FUNCTION parse_filter_expr
+* 
+* Parse an XPath FilterExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [20] FilterExpr ::= PrimaryExpr       
+*                     | FilterExpr Predicate    
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_filter_expr (xpath_pcb_t *pcb,
+                       status_t *res)
+{
+    xpath_result_t  *val1, *dummy;
+    tk_type_t        nexttyp;
+
+    val1 = parse_primary_expr(pcb, res);
+    if (*res != NO_ERR) {
+        return val1;
+    }
+
+    /* peek ahead to check the possible next chars */
+    nexttyp = tk_next_typ(pcb->tkc);
+
+    if (val1) {
+        while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
+            *res = parse_predicate(pcb, &val1);
+            nexttyp = tk_next_typ(pcb->tkc);
+        }
+    } else if (nexttyp==TK_TT_LBRACK) {
+        dummy = new_result(pcb, XP_RT_NODESET);
+        if (dummy) {
+            while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
+                *res = parse_predicate(pcb, &dummy);
+                nexttyp = tk_next_typ(pcb->tkc);
+            }
+            free_result(pcb, dummy);
+        } else {
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+    }
+
+    return val1;
+
+} /* parse_filter_expr */
+
+
+/********************************************************************
+* FUNCTION parse_path_expr
+* 
+* Parse an XPath PathExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [19] PathExpr ::= LocationPath
+*                   | FilterExpr
+*                   | FilterExpr '/' RelativeLocationPath
+*                   | FilterExpr '//' RelativeLocationPath
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_path_expr (xpath_pcb_t *pcb,
+                     status_t *res)
+{
+    xpath_result_t  *val1, *val2;
+    const xmlChar   *nextval;
+    tk_type_t        nexttyp, nexttyp2;
+    xpath_exop_t     curop;
+
+    val1 = NULL;
+    val2 = NULL;
+
+    /* peek ahead to check the possible next sequence */
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_FSLASH:                /* abs location path */
+    case TK_TT_DBLFSLASH:     /* abbrev. abs location path */
+    case TK_TT_PERIOD:                      /* abbrev step */
+    case TK_TT_RANGESEP:                    /* abbrev step */
+    case TK_TT_ATSIGN:                 /* abbrev axis name */
+    case TK_TT_STAR:              /* rel, step, node, name */
+    case TK_TT_NCNAME_STAR:       /* rel, step, node, name */
+    case TK_TT_MSTRING:          /* rel, step, node, QName */
+        return parse_location_path(pcb, NULL, res);
+    case TK_TT_TSTRING:
+        /* some sort of identifier string to check
+         * get the value of the string and the following token type
+         */
+        nexttyp2 = tk_next_typ2(pcb->tkc);
+        nextval = tk_next_val(pcb->tkc);
+
+        /* check 'axis-name ::' sequence */
+        if (nexttyp2==TK_TT_DBLCOLON && get_axis_id(nextval)) {
+            /* this is an axis name */
+            return parse_location_path(pcb, NULL, res);
+        }               
+
+        /* check 'NodeType (' sequence */
+        if (nexttyp2==TK_TT_LPAREN && get_nodetype_id(nextval)) {
+            /* this is an nodetype name */
+            return parse_location_path(pcb, NULL, res);
+        }
+
+        /* check not a function call, so must be a QName */
+        if (nexttyp2 != TK_TT_LPAREN) {
+            /* this is an NameTest QName w/o a prefix */
+            return parse_location_path(pcb, NULL, res);
+        }
+        break;
+    default:
+        ;
+    }
+
+    /* if we get here, then a filter expression is expected */
+    val1 = parse_filter_expr(pcb, res);
+
+    if (*res == NO_ERR) {
+        nexttyp = tk_next_typ(pcb->tkc);
+        switch (nexttyp) {
+        case TK_TT_FSLASH:
+            curop = XP_EXOP_FILTER1;
+            break;
+        case TK_TT_DBLFSLASH:
+            curop = XP_EXOP_FILTER2;
+            break;
+        default:
+            curop = XP_EXOP_NONE;
+        }
+
+        if (curop != XP_EXOP_NONE) {
+            val2 = parse_location_path(pcb, val1, res);
+        } else {
+            val2 = val1;
+        }
+        val1 = NULL;
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_path_expr */
+
+
+/********************************************************************
+* FUNCTION parse_union_expr
+* 
+* Parse an XPath UnionExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [18] UnionExpr ::= PathExpr
+*                    | UnionExpr '|' PathExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_union_expr (xpath_pcb_t *pcb,
+                      status_t *res)
+{
+    xpath_result_t  *val1, *val2;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_path_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* add all the nodes from val1 into val2
+                     * that are not already present
+                     */
+                    merge_nodeset(pcb, val1, val2);
+                    
+                    if (val1) {
+                        free_result(pcb, val1);
+                        val1 = NULL;
+                    }
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (nexttyp != TK_TT_BAR) {
+                done = TRUE;
+            } else {
+                *res = xpath_parse_token(pcb, TK_TT_BAR);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+            }
         }
-        *result = new_result(pcb, XP_RT_NODESET);
-        if (!*result) {
-            res = ERR_INTERNAL_MEM;
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_union_expr */
+
+
+/********************************************************************
+* FUNCTION parse_unary_expr
+* 
+* Parse an XPath UnaryExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [27] UnaryExpr ::= UnionExpr  
+*                    | '-' UnaryExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_unary_expr (xpath_pcb_t *pcb,
+                      status_t *res)
+{
+    xpath_result_t  *val1, *result;
+    tk_type_t        nexttyp;
+    uint32           minuscnt;
+
+    val1 = NULL;
+    minuscnt = 0;
+
+    nexttyp = tk_next_typ(pcb->tkc);
+    while (nexttyp == TK_TT_MINUS) {
+        *res = xpath_parse_token(pcb, TK_TT_MINUS);
+        if (*res != NO_ERR) {
+            return NULL;
+        } else {
+            nexttyp = tk_next_typ(pcb->tkc);
+            minuscnt++;
         }
-        break;
-    case XP_AX_DESCENDANT:
-    case XP_AX_DESCENDANT_OR_SELF:
-    case XP_AX_CHILD:
-        /* select all the child nodes of each node in 
-         * the result node set.
-         * ALSO select all the descendant nodes of each node in 
-         * the result node set. (they are the same in NETCONF)
-         */
-        if (!*result) {
-            /* first step is child::* or descendant::*    */
-            *result = new_nodeset(pcb, 
-                                  pcb->context.node.objptr,
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+    }
+
+    val1 = parse_union_expr(pcb, res);
+
+    if (*res == NO_ERR && (minuscnt & 1)) {
+        if (pcb->val || pcb->obj) {
+            /* odd number of negate ops requested */
+
+            if (val1->restype == XP_RT_NUMBER) {
+                val1->r.num.d *= -1;
+                return val1;
+            } else {
+                result = new_result(pcb, XP_RT_NUMBER);
+                if (!result) {
+                    *res = ERR_INTERNAL_MEM;
+                    return NULL;
+                }
+                xpath_cvt_number(val1, &result->r.num);
+                result->r.num.d *= -1;
+                free_result(pcb, val1);
+                return result;
+            }
+        }
+    }
+
+    return val1;
+
+} /* parse_unary_expr */
+
+
+/********************************************************************
+* FUNCTION parse_multiplicative_expr
+* 
+* Parse an XPath MultiplicativeExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [26] MultiplicativeExpr ::= UnaryExpr 
+*              | MultiplicativeExpr MultiplyOperator UnaryExpr
+*              | MultiplicativeExpr 'div' UnaryExpr
+*              | MultiplicativeExpr 'mod' UnaryExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_multiplicative_expr (xpath_pcb_t *pcb,
+                               status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_unary_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = combine_results(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            switch (nexttyp) {
+            case TK_TT_STAR:
+                curop = XP_EXOP_MULTIPLY;
+                break;
+            case TK_TT_TSTRING:
+                if (match_next_token(pcb, TK_TT_TSTRING,
+                                     XP_OP_DIV)) {
+                    curop = XP_EXOP_DIV;
+                } else if (match_next_token(pcb, 
+                                            TK_TT_TSTRING,
+                                            XP_OP_MOD)) {
+                    curop = XP_EXOP_MOD;
+                } else {
+                    done = TRUE;
+                }
+                break;
+            default:
+                done = TRUE;
+            }
+            if (!done) {
+                *res = xpath_parse_token(pcb, nexttyp);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+            }
+        }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_multiplicative_expr */
+
+
+/********************************************************************
+* FUNCTION parse_additive_expr
+* 
+* Parse an XPath AdditiveExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [25] AdditiveExpr ::= MultiplicativeExpr
+*                | AdditiveExpr '+' MultiplicativeExpr
+*                | AdditiveExpr '-' MultiplicativeExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_additive_expr (xpath_pcb_t *pcb,
+                           status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_multiplicative_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                /* val2 holds the 1st operand
+                 * val1 holds the 2nd operand
+                 */
+
+                if (pcb->val || pcb->val) {
+                    result = combine_results(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            switch (nexttyp) {
+            case TK_TT_PLUS:
+                curop = XP_EXOP_ADD;
+                break;
+            case TK_TT_MINUS:
+                curop = XP_EXOP_SUBTRACT;
+                break;
+            default:
+                done = TRUE;
+            }
+            if (!done) {
+                *res = xpath_parse_token(pcb, nexttyp);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
             }
         }
-        if (res == NO_ERR) {
-            res = set_nodeset_child(pcb, 
-                                    *result, 
-                                    nsid, 
-                                    name, 
-                                    textmode,
-                                    axis);
-        }
-        break;
-    case XP_AX_FOLLOWING:
-    case XP_AX_PRECEDING:
-    case XP_AX_FOLLOWING_SIBLING:
-    case XP_AX_PRECEDING_SIBLING:
-        /* need to set the result to all the objects
-         * or all instances of all value nodes
-         * preceding or following the context node
-         */
-        if (!*result) {
-            /* first step is following::* or preceding::* */
-            *result = new_nodeset(pcb, 
-                                  pcb->context.node.objptr,
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_additive_expr */
+
+
+/********************************************************************
+* FUNCTION parse_relational_expr
+* 
+* Parse an XPath RelationalExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [24]  RelationalExpr ::= AdditiveExpr
+*             | RelationalExpr '<' AdditiveExpr
+*             | RelationalExpr '>' AdditiveExpr
+*             | RelationalExpr '<=' AdditiveExpr
+*             | RelationalExpr '>=' AdditiveExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_relational_expr (xpath_pcb_t *pcb,
+                           status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_additive_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = combine_results(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            switch (nexttyp) {
+            case TK_TT_LT:
+                curop = XP_EXOP_LT;
+                break;
+            case TK_TT_GT:
+                curop = XP_EXOP_GT;
+                break;
+            case TK_TT_LEQUAL:
+                curop = XP_EXOP_LEQUAL;
+                break;
+            case TK_TT_GEQUAL:
+                curop = XP_EXOP_GEQUAL;
+                break;
+            default:
+                done = TRUE;
+            }
+            if (!done) {
+                *res = xpath_parse_token(pcb, nexttyp);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
             }
         }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+}  /* parse_relational_expr */
+
+
+/********************************************************************
+* FUNCTION parse_equality_expr
+* 
+* Parse an XPath EqualityExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [23] EqualityExpr  ::=   RelationalExpr        
+*                | EqualityExpr '=' RelationalExpr        
+*                | EqualityExpr '!=' RelationalExpr        
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_equality_expr (xpath_pcb_t *pcb,
+                         status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done, equalsdone;
 
-        if (res == NO_ERR) {
-            res = set_nodeset_pfaxis(pcb,
-                                     *result,
-                                     nsid, 
-                                     name,
-                                     textmode,
-                                     axis);
-        }        
-        break;
-    case XP_AX_NAMESPACE:
-        /* for NETCONF purposes, there is no need to
-         * provide access to namespace xmlns declarations
-         * within the object or value tree
-         * This can be added later!
-         *
-         *
-         * For now, just turn the result into the empty set
-         */
-        if (pcb->obj && 
-            pcb->logerrors &&
-            ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-            log_warn("Warning: namespace axis is empty in "
-                     "XPath expr '%s'", 
-                     pcb->exprstr);
-            ncx_print_errormsg(pcb->tkc, 
-                               pcb->tkerr.mod,
-                               ERR_NCX_EMPTY_XPATH_RESULT);
-        } else if (pcb->objmod != NULL) {
-            ncx_inc_warnings(pcb->objmod);
-        }
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    equalsdone = FALSE;
+    done = FALSE;
 
-        if (*result) {
-            free_result(pcb, *result);
-        }
-        *result = new_result(pcb, XP_RT_NODESET);
-        if (!*result) {
-            res = ERR_INTERNAL_MEM;
-        }
-        break;
-    case XP_AX_PARENT:
-        /* step is parent::*  -- same as .. for nodes  */
-        if (textmode) {
-            if (pcb->obj && 
-                pcb->logerrors &&
-                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-                log_warn("Warning: parent axis contains no text nodes in "
-                     "XPath expr '%s'", 
-                         pcb->exprstr);
-                ncx_print_errormsg(pcb->tkc, 
-                                   pcb->tkerr.mod,
-                                   ERR_NCX_EMPTY_XPATH_RESULT);
-            } else if (pcb->objmod != NULL) {
-                ncx_inc_warnings(pcb->objmod);
+    while (!done && *res == NO_ERR) {
+        val1 = parse_relational_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        *res = check_instanceid_expr(pcb, 
+                                                     val2, 
+                                                     val1);
+                    }
+
+                    if (*res == NO_ERR) {
+                        result = combine_results(pcb, curop, val2, 
+                                                 val1, res);
+                    }
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
             }
 
-            if (*result) {
-                free_result(pcb, *result);
+            if (*res != NO_ERR) {
+                continue;
             }
-            *result = new_result(pcb, XP_RT_NODESET);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+
+            if (match_next_token(pcb, TK_TT_EQUAL, NULL)) {
+                *res = xpath_parse_token(pcb, TK_TT_EQUAL);
+                if (*res == NO_ERR) {
+                    if (equalsdone) {
+                        if (pcb->flags & XP_FL_INSTANCEID) {
+                            invalid_instanceid_error(pcb);
+                            *res = ERR_NCX_INVALID_INSTANCEID;
+                        }
+                    } else {
+                        equalsdone = TRUE;
+                    }
+                }
+                curop = XP_EXOP_EQUAL;
+            } else if (match_next_token(pcb, TK_TT_NOTEQUAL, NULL)) {
+                *res = xpath_parse_token(pcb, TK_TT_NOTEQUAL);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+                curop = XP_EXOP_NOTEQUAL;
+            } else {
+                done = TRUE;
             }
-            break;
         }
-            
-        if (!*result) {
-            *result = new_nodeset(pcb, 
-                                  pcb->context.node.objptr, 
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+}  /* parse_equality_expr */
+
+
+/********************************************************************
+* FUNCTION parse_and_expr
+* 
+* Parse an XPath AndExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [22] AndExpr  ::= EqualityExpr
+*                   | AndExpr 'and' EqualityExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_and_expr (xpath_pcb_t *pcb,
+                    status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    boolean          done;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_equality_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = combine_results(pcb, XP_EXOP_AND, val2,
+                                             val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
             }
-        }
 
-        if (res == NO_ERR) {
-            res = set_nodeset_parent(pcb, 
-                                     *result, 
-                                     nsid,
-                                     name);
-        }
-        break;
-    case XP_AX_SELF:
-        /* keep the same context node */
-        if (!*result) {
-            /* first step is self::*   */
-            *result = new_nodeset(pcb, 
-                                  pcb->context.node.objptr,
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+            if (*res != NO_ERR) {
+                continue;
             }
-        }
-        if (res == NO_ERR) {
-            res = set_nodeset_self(pcb,
-                                   *result,
-                                   nsid,
-                                   name,
-                                   textmode);
-        }                                  
-        break;
-    case XP_AX_NONE:
-    default:
-        res = SET_ERROR(ERR_INTERNAL_VAL);
+
+            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_AND)) {
+                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+            } else {
+                done = TRUE;
+            }
+        }
     }
 
-    return res;
+    if (val1) {
+        free_result(pcb, val1);
+    }
 
-}  /* parse_node_test */
+    return val2;
+
+}  /* parse_and_expr */
 
 
 /********************************************************************
-* FUNCTION parse_predicate
+* FUNCTION parse_or_expr
 * 
-* Parse an XPath Predicate sequence
+* Parse an XPath OrExpr sequence
 * It has already been tokenized
 *
 * Error messages are printed by this function!!
 * Do not duplicate error messages upon error return
 *
-* [8] Predicate ::= '[' PredicateExpr ']'
-* [9] PredicateExpr ::= Expr
+* [21] OrExpr ::= AndExpr        
+*                 | OrExpr 'or' AndExpr
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    result == address of result in progress to filter
+*    res == address of result status
 *
 * OUTPUTS:
-*   *result may be pruned based on filter matches
-*            nodes may be updated if descendants are
-*            checked and matches are found
+*   *res == function result status
 *
 * RETURNS:
-*   malloced result of predicate expression
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
 *********************************************************************/
-static status_t
-    parse_predicate (xpath_pcb_t *pcb,
-                     xpath_result_t **result)
+static xpath_result_t *
+    parse_or_expr (xpath_pcb_t *pcb,
+                   status_t *res)
 {
-    xpath_result_t  *val1, *contextset;
-    xpath_resnode_t  lastcontext, *resnode, *nextnode;
-    tk_token_t      *leftbrack;
-    boolean          boo;
-    status_t         res;
-    int64            position;
+    xpath_result_t  *val1, *val2, *result;
+    boolean          done;
 
-    res = xpath_parse_token(pcb, TK_TT_LBRACK);
-    if (res != NO_ERR) {
-        return res;
-    }
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    done = FALSE;
 
-    boo = FALSE;
-    if (pcb->val || pcb->obj) {
-        leftbrack = TK_CUR(pcb->tkc);
-        contextset = *result;
-        if (!contextset) {
-            return SET_ERROR(ERR_INTERNAL_VAL);
-        } else if (contextset->restype == XP_RT_NODESET) {
-            if (dlq_empty(&contextset->r.nodeQ)) {
-                /* always one pass; do not care about result */
-                val1 = parse_expr(pcb, &res);
-                if (res == NO_ERR) {
-                    res = xpath_parse_token(pcb, TK_TT_RBRACK);
+    while (!done && *res == NO_ERR) {
+        val1 = parse_and_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = combine_results(pcb, XP_EXOP_OR, val2,
+                                             val1, res);
                 }
+
                 if (val1) {
                     free_result(pcb, val1);
+                    val1 = NULL;
                 }
-                return res;
-            }
 
-            lastcontext.node.valptr = 
-                pcb->context.node.valptr;
-            lastcontext.position = pcb->context.position;
-            lastcontext.last = pcb->context.last;
-            lastcontext.dblslash = pcb->context.dblslash;
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
 
-            for (resnode = (xpath_resnode_t *)
-                     dlq_firstEntry(&contextset->r.nodeQ);
-                 resnode != NULL;
-                 resnode = nextnode) {
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
 
-                /* go over and over the predicate expression
-                 * with the resnode as the current context node
-                 */
-                TK_CUR(pcb->tkc) = leftbrack;
-                boo = FALSE;
+            if (*res != NO_ERR) {
+                continue;
+            }
 
-                nextnode = (xpath_resnode_t *)
-                    dlq_nextEntry(resnode);
+            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_OR)) {
+                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+            } else {
+                done = TRUE;
+            }
+        }
+    }
 
-                pcb->context.node.valptr = resnode->node.valptr;
-                pcb->context.position = resnode->position;
-                pcb->context.last = contextset->last;
-                pcb->context.dblslash = resnode->dblslash;
+    if (val1) {
+        free_result(pcb, val1);
+    }
 
-#ifdef EXTRA_DEBUG
-                if (LOGDEBUG3 && pcb->val) {
-                    log_debug3("\nXPath setting context node: %s",
-                               pcb->context.node.valptr->name);
-                }
-#endif
+    return val2;
 
-                val1 = parse_expr(pcb, &res);
-                if (res != NO_ERR) {
-                    if (val1) {
-                        free_result(pcb, val1);
-                    }
-                    return res;
-                }
-            
-                res = xpath_parse_token(pcb, TK_TT_RBRACK);
-                if (res != NO_ERR) {
-                    if (val1) {
-                        free_result(pcb, val1);
-                    }
-                    return res;
-                }
+}  /* parse_or_expr */
 
-                if (val1->restype == XP_RT_NUMBER) {
-                    /* the predicate specifies a context
-                     * position and this resnode is
-                     * only selected if it is the Nth
-                     * instance within the current context
-                     */
-                    if (ncx_num_is_integral(&val1->r.num,
-                                            NCX_BT_FLOAT64)) {
-                        position = 
-                            ncx_cvt_to_int64(&val1->r.num,
-                                             NCX_BT_FLOAT64);
-                        /* check if the proximity position
-                         * of this node matches the position
-                         * value from this expression
-                         */
-                        boo = (position == resnode->position) ?
-                            TRUE : FALSE;
-                    } else {
-                        boo = FALSE;
-                    }
-                } else {
-                    boo = xpath_cvt_boolean(val1);
-                }
-                free_result(pcb, val1);
 
-                if (!boo) {
-                    /* predicate expression evaluated to false
-                     * so delete this resnode from the result
-                     */
-                    dlq_remove(resnode);
-                    free_resnode(pcb, resnode);
-                }
-            }
+/********************************************************************
+* FUNCTION parse_expr
+* 
+* Parse an XPath Expr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [14] Expr ::= OrExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_expr (xpath_pcb_t *pcb,
+                status_t  *res)
+{
 
-            pcb->context.node.valptr = 
-                lastcontext.node.valptr;
-            pcb->context.position = lastcontext.position;
-            pcb->context.last = lastcontext.last;
-            pcb->context.dblslash = lastcontext.dblslash;
+    return parse_or_expr(pcb, res);
 
-#ifdef EXTRA_DEBUG
-            if (LOGDEBUG3 && pcb->val) {
-                log_debug3("\nXPath set context node to last: %s",
-                           pcb->context.node.valptr->name);
-            }
-#endif
+}  /* parse_expr */
 
-        } else {
-            /* result is from a primary expression and
-             * is not a nodeset.  It will get cleared
-             * if the predicate evaluates to false
-             */
-            val1 = parse_expr(pcb, &res);
-            if (res != NO_ERR) {
-                if (val1) {
-                    free_result(pcb, val1);
-                }
-                return res;
-            }
-            
-            res = xpath_parse_token(pcb, TK_TT_RBRACK);
-            if (res != NO_ERR) {
-                if (val1) {
-                    free_result(pcb, val1);
-                }
-                return res;
-            }
 
-            if (val1 && pcb->val) {
-                boo = xpath_cvt_boolean(val1);
-            }
-            if (val1) {
-                free_result(pcb, val1);
-            }
-            if (pcb->val && !boo && *result) {
-                xpath_clean_result(*result);
-                xpath_init_result(*result, XP_RT_NONE);
-            }
-        }
-    } else {
-        /* always one pass; do not care about result */
-        val1 = parse_expr(pcb, &res);
-        if (res == NO_ERR) {
-            res = xpath_parse_token(pcb, TK_TT_RBRACK);
+/********************************************************************
+* FUNCTION new_comp_node
+* 
+* Add a node to a compiled XPath expression
+*
+* INPUTS:
+*    comp == compiled expression in progress
+*    kind == kind of node to add
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == ERR_INTERNAL_MEM if a malloc failed
+*
+* RETURNS:
+*   index of the new node, 0 if some error
+*********************************************************************/
+static uint32
+    new_comp_node (xpath_comp_t *comp,
+                   xpath_exkind_t kind,
+                   status_t *res)
+{
+    xpath_exnode_t  *nodes;
+    uint32           maxnodes;
+
+    if (comp->nodecnt == comp->maxnodes) {
+        maxnodes = (comp->maxnodes) ? comp->maxnodes * 2 : 8;
+        nodes = m__getMem(maxnodes * sizeof(xpath_exnode_t));
+        if (!nodes) {
+            *res = ERR_INTERNAL_MEM;
+            return 0;
         }
-        if (val1) {
-            free_result(pcb, val1);
+        if (comp->nodes) {
+            memcpy(nodes, comp->nodes, 
+                   comp->nodecnt * sizeof(xpath_exnode_t));
+            m__free(comp->nodes);
         }
+        comp->nodes = nodes;
+        comp->maxnodes = maxnodes;
     }
 
-    return res;
+    memset(&comp->nodes[comp->nodecnt], 0x0, sizeof(xpath_exnode_t));
+    comp->nodes[comp->nodecnt].kind = kind;
+    return comp->nodecnt++;
 
-} /* parse_predicate */
+}  /* new_comp_node */
 
 
 /********************************************************************
-* FUNCTION parse_step
+* FUNCTION compile_token
 * 
-* Parse the XPath Step sequence
-* It has already been tokenized
+* Consume the next token while compiling an expression
 *
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* INPUTS:
+*    pcb == parser control block in progress
+*    tktyp == expected token type
 *
-* [4] Step  ::=  AxisSpecifier NodeTest Predicate*        
-*                | AbbreviatedStep        
+* RETURNS:
+*   status; ERR_NCX_OPERATION_NOT_SUPPORTED if the next
+*   token is not the expected one
+*********************************************************************/
+static status_t
+    compile_token (xpath_pcb_t *pcb,
+                   tk_type_t tktyp)
+{
+    if (TK_ADV(pcb->tkc) != NO_ERR || TK_CUR_TYP(pcb->tkc) != tktyp) {
+        return ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+    return NO_ERR;
+
+}  /* compile_token */
+
+
+/* forward decl needed for recursion */
+static uint32
+    compile_expr (xpath_pcb_t *pcb,
+                  xpath_comp_t *comp,
+                  status_t *res);
+
+
+/********************************************************************
+* FUNCTION compile_predicates
+* 
+* Compile the Predicate* sequence after a step or PrimaryExpr
+* Mirrors the tokens consumed by parse_predicate
 *
-* [12] AbbreviatedStep ::= '.'        | '..'
+* INPUTS:
+*    pcb == parser control block in progress
+*    comp == compiled expression in progress
+*    res == address of result status
 *
-* [5] AxisSpecifier ::= AxisName '::'
-*                | AbbreviatedAxisSpecifier
+* RETURNS:
+*   index of the 1st predicate expr, linked by 'next';
+*   0 if none or some error
+*********************************************************************/
+static uint32
+    compile_predicates (xpath_pcb_t *pcb,
+                        xpath_comp_t *comp,
+                        status_t *res)
+{
+    uint32   first, last, pred;
+
+    first = 0;
+    last = 0;
+    while (*res == NO_ERR && tk_next_typ(pcb->tkc) == TK_TT_LBRACK) {
+        (void)TK_ADV(pcb->tkc);
+        pred = compile_expr(pcb, comp, res);
+        if (*res == NO_ERR) {
+            *res = compile_token(pcb, TK_TT_RBRACK);
+        }
+        if (*res == NO_ERR) {
+            if (last) {
+                comp->nodes[last].next = pred;
+            } else {
+                first = pred;
+            }
+            last = pred;
+        }
+    }
+    return (*res == NO_ERR) ? first : 0;
+
+}  /* compile_predicates */
+
+
+/********************************************************************
+* FUNCTION is_keyname_test
+* 
+* Check if a compiled expr is a relative location path
+* of 1 named child step without predicates, as used for
+* the key leaf in a 'key = value' predicate
 *
-* [13] AbbreviatedAxisSpecifier ::= '@'?
+* INPUTS:
+*    nodes == compiled expression nodes
+*    idx == index of the expr to check
+*
+* RETURNS:
+*   index of the STEP node if the expr is a child name test,
+*   0 otherwise
+*********************************************************************/
+static uint32
+    is_keyname_test (const xpath_exnode_t *nodes,
+                     uint32 idx)
+{
+    const xpath_exnode_t  *step;
+
+    if (nodes[idx].kind != XP_EXK_PATH || nodes[idx].left) {
+        return 0;
+    }
+
+    step = &nodes[nodes[idx].right];
+    if (step->next || step->preds || step->exop != XP_EXOP_NONE ||
+        step->steptyp != TK_TT_NONE || step->axis != XP_AX_CHILD ||
+        step->textmode || !step->name) {
+        return 0;
+    }
+    return nodes[idx].right;
+
+}  /* is_keyname_test */
+
+
+/********************************************************************
+* FUNCTION is_context_free
+* 
+* Check if a compiled expr has the same value for every
+* context node: a literal, a variable, or current() or
+* an absolute location path, maybe followed by more steps
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    result == address of erturn XPath result nodeset
+*    nodes == compiled expression nodes
+*    idx == index of the expr to check
 *
+* RETURNS:
+*   TRUE if the expr does not depend on the context node
+*********************************************************************/
+static boolean
+    is_context_free (const xpath_exnode_t *nodes,
+                     uint32 idx)
+{
+    const xpath_exnode_t  *node;
 
-* OUTPUTS:
-*   *result pointer is set to malloced result struct
-*    if it is NULL, or used if it is non-NULL;
-*    MUST be a XP_RT_NODESET result
+    node = &nodes[idx];
+    switch (node->kind) {
+    case XP_EXK_LITERAL:
+    case XP_EXK_VARBIND:
+        return TRUE;
+    case XP_EXK_FNCALL:
+        return (node->fncb->fn == current_fn) ? TRUE : FALSE;
+    case XP_EXK_PATH:
+        if (node->left) {
+            return (nodes[node->left].kind == XP_EXK_FNCALL &&
+                    nodes[node->left].fncb->fn == current_fn) ?
+                TRUE : FALSE;
+        }
+        return (nodes[node->right].exop == XP_EXOP_FILTER1) ?
+            TRUE : FALSE;
+    default:
+        return FALSE;
+    }
+
+}  /* is_context_free */
 
+
+/********************************************************************
+* FUNCTION get_keytests
+* 
+* Get the 'key = value' tests in 1 compiled predicate;
+* the predicate can be 1 test or tests joined by 'and'
+*
+* INPUTS:
+*    nodes == compiled expression nodes
+*    idx == index of the predicate expr
+*    tests == array of KEYTEST_MAX tests to fill in
+*          == NULL to just check the predicate
+*    testcnt == address of number of tests found so far
+*
+* OUTPUTS:
+*    *testcnt == incremented for each test found
+*    tests[] == filled in from the old *testcnt, if non-NULL
 *
 * RETURNS:
-*   status
+*   TRUE if the predicate has only key tests,
+*   FALSE if it has to be evaluated for every node
 *********************************************************************/
-static status_t
-    parse_step (xpath_pcb_t *pcb,
-                xpath_result_t **result)
+static boolean
+    get_keytests (const xpath_exnode_t *nodes,
+                  uint32 idx,
+                  keytest_t *tests,
+                  uint32 *testcnt)
 {
-    const xmlChar    *nextval;
-    tk_type_t         nexttyp, nexttyp2;
-    ncx_xpath_axis_t  axis;
-    status_t          res;
+    const xpath_exnode_t  *node;
+    uint32                 lhs, rhs;
 
-    nexttyp = tk_next_typ(pcb->tkc);
-    axis = XP_AX_CHILD;
+    node = &nodes[idx];
+    if (node->kind != XP_EXK_BINARY) {
+        return FALSE;
+    }
 
-    /* check start token '/' or '//' */
-    if (nexttyp == TK_TT_DBLFSLASH) {
-        res = xpath_parse_token(pcb, TK_TT_DBLFSLASH);
-        if (res != NO_ERR) {
-            return res;
-        }
+    if (node->exop == XP_EXOP_AND) {
+        return (get_keytests(nodes, node->left, tests, testcnt) &&
+                get_keytests(nodes, node->right, tests, testcnt)) ?
+            TRUE : FALSE;
+    }
+    if (node->exop != XP_EXOP_EQUAL) {
+        return FALSE;
+    }
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
+    lhs = is_keyname_test(nodes, node->left);
+    rhs = node->right;
+    if (!lhs || !is_context_free(nodes, rhs)) {
+        lhs = is_keyname_test(nodes, node->right);
+        rhs = node->left;
+        if (!lhs || !is_context_free(nodes, rhs)) {
+            return FALSE;
         }
+    }
 
-        if (!*result) {
-            *result = new_nodeset(pcb,
-                                  pcb->context.node.objptr,
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  TRUE);
-            if (!*result) {
-                return ERR_INTERNAL_MEM;
-            }
-        }
-        set_nodeset_dblslash(pcb, *result);
-    } else if (nexttyp == TK_TT_FSLASH) {
-        res = xpath_parse_token(pcb, TK_TT_FSLASH);
-        if (res != NO_ERR) {
-            return res;
-        }
+    if (*testcnt == KEYTEST_MAX) {
+        return FALSE;
+    }
+    if (tests) {
+        tests[*testcnt].lhs = lhs;
+        tests[*testcnt].rhs = rhs;
+        tests[*testcnt].valstr = NULL;
+    }
+    (*testcnt)++;
+    return TRUE;
 
-        if (!*result) {
-            /* this is the first call */
-            *result = new_nodeset(pcb, 
-                                  pcb->docroot, 
-                                  pcb->val_docroot,
-                                  1,
-                                  FALSE);
-            if (!*result) {
-                return ERR_INTERNAL_MEM;
-            }
+}  /* get_keytests */
 
-            /* check corner-case path '/' */
-            if (location_path_end(pcb)) {
-                /* exprstr is simply docroot '/' */
-                return NO_ERR;
-            }
+
+/********************************************************************
+* FUNCTION check_keypreds
+* 
+* Check if all the predicates of a compiled step are
+* 'key = value' tests, and get the tests
+*
+* INPUTS:
+*    nodes == compiled expression nodes
+*    preds == index of the 1st predicate expr
+*    tests == array of KEYTEST_MAX tests to fill in
+*          == NULL to just check the predicates
+*    testcnt == address of return number of tests
+*
+* OUTPUTS:
+*    *testcnt == number of tests found
+*
+* RETURNS:
+*   TRUE if the predicates only test keys
+*********************************************************************/
+static boolean
+    check_keypreds (const xpath_exnode_t *nodes,
+                    uint32 preds,
+                    keytest_t *tests,
+                    uint32 *testcnt)
+{
+    uint32  idx;
+
+    *testcnt = 0;
+    for (idx = preds; idx; idx = nodes[idx].next) {
+        if (!get_keytests(nodes, idx, tests, testcnt)) {
+            return FALSE;
         }
-    } else if (*result) {
-        /* should not happen */
-        SET_ERROR(ERR_INTERNAL_VAL);
-        return ERR_NCX_INVALID_XPATH_EXPR;
     }
+    return (*testcnt) ? TRUE : FALSE;
 
-    /* handle an abbreviated step (. or ..) or
-     * handle the axis-specifier for the full form step
-     */
-    nexttyp = tk_next_typ(pcb->tkc);
-    switch (nexttyp) {
-    case TK_TT_PERIOD:
-        /* abbreviated step '.': 
-         * current target node stays the same unless
-         * this is the first token in the location path,
-         * then the context result needs to be initialized
-         *
-         * first consume the period token
-         */
-        res = xpath_parse_token(pcb, TK_TT_PERIOD);
-        if (res != NO_ERR) {
-            return res;
-        }
+}  /* check_keypreds */
 
-        /* first step is simply . */
-        if (!*result) {
-            *result = new_nodeset(pcb,
-                                  pcb->context.node.objptr,
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                return ERR_INTERNAL_MEM;
-            }
-        } /* else leave current result alone */
-        return NO_ERR;
-    case TK_TT_RANGESEP:
-        /* abbrev step '..': 
-         * matches parent of current context */
-        res = xpath_parse_token(pcb, TK_TT_RANGESEP);
-        if (res != NO_ERR) {
-            return res;
-        }
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
+/********************************************************************
+* FUNCTION clear_keypreds
+* 
+* Turn off the key lookup for the last steps of an expr
+* whose result nodes keep their context positions,
+* such as the operand of a FilterExpr with predicates
+*
+* INPUTS:
+*    nodes == compiled expression nodes
+*    idx == index of the expr
+*
+*********************************************************************/
+static void
+    clear_keypreds (xpath_exnode_t *nodes,
+                    uint32 idx)
+{
+    uint32  step;
+
+    switch (nodes[idx].kind) {
+    case XP_EXK_PATH:
+        for (step = nodes[idx].right; nodes[step].next; 
+             step = nodes[step].next) {
+            ;
         }
+        nodes[step].keypreds = FALSE;
+        break;
+    case XP_EXK_UNION:
+        clear_keypreds(nodes, nodes[idx].left);
+        clear_keypreds(nodes, nodes[idx].right);
+        break;
+    case XP_EXK_FILTER:
+        clear_keypreds(nodes, nodes[idx].left);
+        break;
+    default:
+        ;
+    }
 
-        /* step is .. or  //.. */
-        if (!*result) {
-            /* first step is .. or //..     */
-            *result = new_nodeset(pcb, 
-                                  pcb->context.node.objptr, 
-                                  pcb->context.node.valptr,
-                                  1, 
-                                  FALSE);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
+}  /* clear_keypreds */
+
+
+/********************************************************************
+* FUNCTION compile_step
+* 
+* Compile one Step, with its leading '/' or '//'
+* Mirrors the tokens consumed by parse_step
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    comp == compiled expression in progress
+*    first == TRUE if this is the 1st step of the location path
+*    afterfilter == TRUE if the location path follows a FilterExpr
+*    res == address of result status
+*
+* RETURNS:
+*   index of the new STEP node, 0 if some error
+*********************************************************************/
+static uint32
+    compile_step (xpath_pcb_t *pcb,
+                  xpath_comp_t *comp,
+                  boolean first,
+                  boolean afterfilter,
+                  status_t *res)
+{
+    xpath_exnode_t    *node;
+    const xmlChar     *name;
+    tk_type_t          nexttyp;
+    xpath_exop_t       lead;
+    ncx_xpath_axis_t   axis;
+    xpath_nodetype_t   nodetyp;
+    xmlns_id_t         nsid;
+    boolean            textmode;
+    uint32             step, preds, keycnt;
+
+    lead = XP_EXOP_NONE;
+    nexttyp = tk_next_typ(pcb->tkc);
+    if (nexttyp == TK_TT_DBLFSLASH) {
+        (void)TK_ADV(pcb->tkc);
+        lead = XP_EXOP_FILTER2;
+    } else if (nexttyp == TK_TT_FSLASH) {
+        (void)TK_ADV(pcb->tkc);
+        lead = XP_EXOP_FILTER1;
+        if (location_path_end(pcb)) {
+            /* the path is simply docroot '/'; after a filter
+             * the interpreter only ends the path here if the
+             * filter had no result
+             */
+            if (!first || afterfilter) {
+                *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+                return 0;
             }
+            step = new_comp_node(comp, XP_EXK_STEP, res);
+            if (step) {
+                comp->nodes[step].exop = lead;
+                comp->nodes[step].steptyp = TK_TT_FSLASH;
+                comp->nodes[step].tk = TK_CUR(pcb->tkc);
+            }
+            return step;
         }
-        if (res == NO_ERR) {
-            res = set_nodeset_parent(pcb, 
-                                     *result,
-                                     0,
-                                     NULL);
-        }
-        return res;
-    case TK_TT_ATSIGN:
-        axis = XP_AX_ATTRIBUTE;
-        res = xpath_parse_token(pcb, TK_TT_ATSIGN);
-        if (res != NO_ERR) {
-            return res;
-        }
+    } else if (!first) {
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return 0;
+    }
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
+    /* abbreviated step or axis specifier */
+    axis = XP_AX_CHILD;
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_PERIOD:
+    case TK_TT_RANGESEP:
+        (void)TK_ADV(pcb->tkc);
+        step = new_comp_node(comp, XP_EXK_STEP, res);
+        if (step) {
+            comp->nodes[step].exop = lead;
+            comp->nodes[step].steptyp = nexttyp;
+            comp->nodes[step].tk = TK_CUR(pcb->tkc);
         }
-        break;
+        return step;
     case TK_TT_STAR:
     case TK_TT_NCNAME_STAR:
     case TK_TT_MSTRING:
-        /* set the axis to default child, hit node test */
-        axis = XP_AX_CHILD;
         break;
     case TK_TT_TSTRING:
-        /* check the ID token for an axis name */
-        nexttyp2 = tk_next_typ2(pcb->tkc);
-        nextval = tk_next_val(pcb->tkc);
-        axis = get_axis_id(nextval);
-        if (axis != XP_AX_NONE && nexttyp2==TK_TT_DBLCOLON) {
-            /* correct axis-name :: sequence */
-            res = xpath_parse_token(pcb, TK_TT_TSTRING);
-            if (res != NO_ERR) {
-                return res;
-            }
-            res = xpath_parse_token(pcb, TK_TT_DBLCOLON);
-            if (res != NO_ERR) {
-                return res;
+        if (tk_next_typ2(pcb->tkc) == TK_TT_DBLCOLON) {
+            axis = get_axis_id(tk_next_val(pcb->tkc));
+            if (axis == XP_AX_NONE) {
+                *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+                return 0;
             }
+            (void)TK_ADV(pcb->tkc);
+            (void)TK_ADV(pcb->tkc);
+        }
+        break;
+    default:
+        /* includes the '@' attribute axis */
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return 0;
+    }
 
-            if (pcb->flags & XP_FL_INSTANCEID) {
-                invalid_instanceid_error(pcb);
-                return ERR_NCX_INVALID_INSTANCEID;
+    if (axis == XP_AX_ATTRIBUTE || axis == XP_AX_NAMESPACE) {
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return 0;
+    }
+
+    /* node test */
+    if (TK_ADV(pcb->tkc) != NO_ERR) {
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return 0;
+    }
+
+    nsid = 0;
+    name = NULL;
+    textmode = FALSE;
+    switch (TK_CUR_TYP(pcb->tkc)) {
+    case TK_TT_STAR:
+        break;
+    case TK_TT_NCNAME_STAR:
+    case TK_TT_MSTRING:
+        /* the prefix is resolved by the 1st interpreted eval */
+        nsid = pcb->tkc->cur->nsid;
+        if (!nsid) {
+            *res = ERR_NCX_SKIPPED;
+            return 0;
+        }
+        if (TK_CUR_TYP(pcb->tkc) == TK_TT_MSTRING) {
+            name = TK_CUR_VAL(pcb->tkc);
+        }
+        break;
+    case TK_TT_TSTRING:
+        nodetyp = get_nodetype_id(TK_CUR_VAL(pcb->tkc));
+        if (nodetyp == XP_EXNT_NONE ||
+            tk_next_typ(pcb->tkc) != TK_TT_LPAREN) {
+            name = TK_CUR_VAL(pcb->tkc);
+        } else if (nodetyp == XP_EXNT_TEXT || nodetyp == XP_EXNT_NODE) {
+            *res = compile_token(pcb, TK_TT_LPAREN);
+            if (*res == NO_ERR) {
+                *res = compile_token(pcb, TK_TT_RPAREN);
             }
-        } else if (axis == XP_AX_NONE && nexttyp2==TK_TT_DBLCOLON) {
-            /* incorrect axis-name :: sequence */
-            (void)TK_ADV(pcb->tkc);
-            res = ERR_NCX_INVALID_XPATH_EXPR;
-            if (pcb->logerrors) {
-                log_error("\nError: invalid axis name '%s' in "
-                          "XPath expression '%s'",
-                          (TK_CUR_VAL(pcb->tkc) != NULL) ?
-                          TK_CUR_VAL(pcb->tkc) : EMPTY_STRING,
-                          pcb->exprstr);
-                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, res);
-            } else {
-                /*** log agent error ***/
+            if (*res != NO_ERR) {
+                return 0;
             }
-            (void)TK_ADV(pcb->tkc);
-            return res;
+            textmode = (nodetyp == XP_EXNT_TEXT) ? TRUE : FALSE;
         } else {
-            axis = XP_AX_CHILD;
+            /* comment() and processing-instruction() */
+            *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+            return 0;
         }
         break;
     default:
-        /* wrong token type found */
-        (void)TK_ADV(pcb->tkc);
-        res = ERR_NCX_WRONG_TKTYPE;
-        unexpected_error(pcb);
-        return res;
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return 0;
     }
 
-    /* axis or default child parsed OK, get node test */
-    res = parse_node_test(pcb, axis, result);
-    if (res == NO_ERR) {
-        nexttyp = tk_next_typ(pcb->tkc);
-        while (nexttyp == TK_TT_LBRACK && res==NO_ERR) {
-            res = parse_predicate(pcb, result);
-            nexttyp = tk_next_typ(pcb->tkc);
-        }
+    if (axis == XP_AX_PARENT && textmode) {
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        return 0;
     }
 
-    return res;
+    step = new_comp_node(comp, XP_EXK_STEP, res);
+    if (!step) {
+        return 0;
+    }
+    node = &comp->nodes[step];
+    node->exop = lead;
+    node->steptyp = TK_TT_NONE;
+    node->axis = axis;
+    node->textmode = textmode;
+    node->nsid = nsid;
+    node->name = name;
+    node->tk = TK_CUR(pcb->tkc);
 
-}  /* parse_step */
+    preds = compile_predicates(pcb, comp, res);
+    if (*res != NO_ERR) {
+        return 0;
+    }
+    comp->nodes[step].preds = preds;
+
+    /* list entries selected only by their keys can be
+     * looked up instead of testing every entry
+     */
+    if (preds && axis == XP_AX_CHILD && name && 
+        lead != XP_EXOP_FILTER2) {
+        comp->nodes[step].keypreds = 
+            check_keypreds(comp->nodes, preds, NULL, &keycnt);
+    }
+    return step;
+
+}  /* compile_step */
 
 
 /********************************************************************
-* FUNCTION parse_location_path
+* FUNCTION compile_location_path
 * 
-* Parse the Location-Path sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [1] LocationPath  ::=  RelativeLocationPath        
-*                       | AbsoluteLocationPath        
-*
-* [2] AbsoluteLocationPath ::= '/' RelativeLocationPath?
-*                     | AbbreviatedAbsoluteLocationPath        
-*
-* [10] AbbreviatedAbsoluteLocationPath ::= '//' RelativeLocationPath
-*
-* [3] RelativeLocationPath ::= Step
-*                       | RelativeLocationPath '/' Step
-*                       | AbbreviatedRelativeLocationPath
-*
-* [11] AbbreviatedRelativeLocationPath ::= 
-*               RelativeLocationPath '//' Step
+* Compile the steps of a LocationPath
+* Mirrors the tokens consumed by parse_location_path
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    result == result struct in progress or NULL if none
+*    comp == compiled expression in progress
+*    afterfilter == TRUE if the location path follows a FilterExpr
 *    res == address of result status
 *
-* OUTPUTS:
-*   *res == function result status
-*
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   index of the 1st STEP node, linked by 'next'; 0 if some error
 *********************************************************************/
-static xpath_result_t *
-    parse_location_path (xpath_pcb_t *pcb,
-                         xpath_result_t *result,
-                         status_t *res)
+static uint32
+    compile_location_path (xpath_pcb_t *pcb,
+                           xpath_comp_t *comp,
+                           boolean afterfilter,
+                           status_t *res)
 {
-    xpath_result_t     *val1;
-    tk_type_t           nexttyp;
-    boolean             done;
-
-    val1 = result;
+    tk_type_t   nexttyp;
+    uint32      first, last, step;
+    boolean     done;
 
+    first = 0;
+    last = 0;
     done = FALSE;
     while (!done && *res == NO_ERR) {
-        *res = parse_step(pcb, &val1);
-        if (*res == NO_ERR) {
+        step = compile_step(pcb, comp, (first == 0), afterfilter, res);
+        if (*res != NO_ERR) {
+            return 0;
+        }
+        if (last) {
+            comp->nodes[last].next = step;
+
+            /* the self axis keeps the context positions */
+            if (comp->nodes[step].axis == XP_AX_SELF &&
+                comp->nodes[step].steptyp == TK_TT_NONE) {
+                comp->nodes[last].keypreds = FALSE;
+            }
+        } else {
+            first = step;
+        }
+        last = step;
+
+        if (comp->nodes[step].steptyp == TK_TT_FSLASH) {
+            done = TRUE;
+        } else {
             nexttyp = tk_next_typ(pcb->tkc);
-            if (!(nexttyp == TK_TT_FSLASH ||
-                  nexttyp == TK_TT_DBLFSLASH)) {
+            if (!(nexttyp == TK_TT_FSLASH || nexttyp == TK_TT_DBLFSLASH)) {
                 done = TRUE;
             }
         }
     }
+    return first;
 
-    return val1;
-
-}  /* parse_location_path */
+}  /* compile_location_path */
 
 
 /********************************************************************
-* FUNCTION parse_function_call
+* FUNCTION compile_primary_expr
 * 
-* Parse an XPath FunctionCall sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [16] FunctionCall ::= FunctionName 
-*                        '(' ( Argument ( ',' Argument )* )? ')'
-* [17] Argument ::= Expr
+* Compile a PrimaryExpr
+* Mirrors the tokens consumed by parse_primary_expr
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    comp == compiled expression in progress
 *    res == address of result status
 *
-* OUTPUTS:
-*   *res == function result status
-*
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   index of the new node, 0 if some error
 *********************************************************************/
-static xpath_result_t *
-    parse_function_call (xpath_pcb_t *pcb,
-                         status_t *res)
+static uint32
+    compile_primary_expr (xpath_pcb_t *pcb,
+                          xpath_comp_t *comp,
+                          status_t *res)
 {
-    xpath_result_t         *val1, *val2;
-    const xpath_fncb_t     *fncb;
-    dlq_hdr_t               parmQ;
-    tk_type_t               nexttyp;
-    int32                   parmcnt;
-    boolean                 done;
-
-    val1 = NULL;
-    parmcnt = 0;
-    dlq_createSQue(&parmQ);
-
-    /* get the function name */
-    *res = xpath_parse_token(pcb, TK_TT_TSTRING);
-    if (*res != NO_ERR) {
-        return NULL;
-    }
+    const xpath_fncb_t  *fncb;
+    tk_type_t            nexttyp;
+    ncx_numfmt_t         numfmt;
+    ncx_num_t            num;
+    uint32               idx, arg, lastarg;
+    int32                parmcnt;
 
-    if (pcb->flags & XP_FL_INSTANCEID) {
-        invalid_instanceid_error(pcb);
-        *res = ERR_NCX_INVALID_INSTANCEID;
-        return NULL;
-    }
+    idx = 0;
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_VARBIND:
+    case TK_TT_QVARBIND:
+        (void)TK_ADV(pcb->tkc);
+        idx = new_comp_node(comp, XP_EXK_VARBIND, res);
+        if (idx) {
+            comp->nodes[idx].tk = TK_CUR(pcb->tkc);
+        }
+        break;
+    case TK_TT_LPAREN:
+        (void)TK_ADV(pcb->tkc);
+        idx = compile_expr(pcb, comp, res);
+        if (*res == NO_ERR) {
+            *res = compile_token(pcb, TK_TT_RPAREN);
+        }
+        break;
+    case TK_TT_DNUM:
+    case TK_TT_RNUM:
+        (void)TK_ADV(pcb->tkc);
+        numfmt = ncx_get_numfmt(TK_CUR_VAL(pcb->tkc));
+        if (numfmt == NCX_NF_OCTAL) {
+            numfmt = NCX_NF_DEC;
+        }
+        if (numfmt != NCX_NF_DEC && numfmt != NCX_NF_REAL) {
+            *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+            break;
+        }
+        ncx_init_num(&num);
+        *res = ncx_convert_num(TK_CUR_VAL(pcb->tkc), numfmt,
+                               NCX_BT_FLOAT64, &num);
+        if (*res == NO_ERR) {
+            idx = new_comp_node(comp, XP_EXK_NUMBER, res);
+            if (idx) {
+                comp->nodes[idx].num.d = num.d;
+                comp->nodes[idx].tk = TK_CUR(pcb->tkc);
+            }
+        }
+        ncx_clean_num(NCX_BT_FLOAT64, &num);
+        break;
+    case TK_TT_QSTRING:
+    case TK_TT_SQSTRING:
+        (void)TK_ADV(pcb->tkc);
+        idx = new_comp_node(comp, XP_EXK_LITERAL, res);
+        if (idx) {
+            comp->nodes[idx].name = TK_CUR_VAL(pcb->tkc);
+            comp->nodes[idx].tk = TK_CUR(pcb->tkc);
+        }
+        break;
+    case TK_TT_TSTRING:
+        if (tk_next_typ2(pcb->tkc) != TK_TT_LPAREN) {
+            *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+            break;
+        }
 
-    /* find the function in the library */
-    fncb = NULL;
-    if (TK_CUR_VAL(pcb->tkc) != NULL) {
-        fncb = find_fncb(pcb, TK_CUR_VAL(pcb->tkc));
-    }
-    if (fncb) {
-        /* get the mandatory left paren */
-        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
-        if (*res != NO_ERR) {
-            return NULL;
+        /* bind the function now instead of on every call */
+        (void)TK_ADV(pcb->tkc);
+        fncb = NULL;
+        if (TK_CUR_VAL(pcb->tkc) != NULL) {
+            fncb = find_fncb(pcb, TK_CUR_VAL(pcb->tkc));
+        }
+        if (!fncb) {
+            *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+            break;
+        }
+        idx = new_comp_node(comp, XP_EXK_FNCALL, res);
+        if (!idx) {
+            break;
         }
+        comp->nodes[idx].fncb = fncb;
+        (void)TK_ADV(pcb->tkc);
 
-        /* get parms until a matching right paren is reached */
-        nexttyp = tk_next_typ(pcb->tkc);
-        done = (nexttyp == TK_TT_RPAREN) ? TRUE : FALSE;
-        while (!done && *res == NO_ERR) {
-            val1 = parse_expr(pcb, res);
-            if (*res == NO_ERR) {
+        parmcnt = 0;
+        lastarg = 0;
+        if (tk_next_typ(pcb->tkc) != TK_TT_RPAREN) {
+            while (*res == NO_ERR) {
+                arg = compile_expr(pcb, comp, res);
+                if (*res != NO_ERR) {
+                    break;
+                }
                 parmcnt++;
-                if (val1) {
-                    dlq_enque(val1, &parmQ);
-                    val1 = NULL;
+                if (lastarg) {
+                    comp->nodes[lastarg].next = arg;
+                } else {
+                    comp->nodes[idx].left = arg;
                 }
+                lastarg = arg;
 
-                /* check for right paren or else should be comma */
-                nexttyp = tk_next_typ(pcb->tkc);
-                if (nexttyp == TK_TT_RPAREN) {
-                    done = TRUE;
-                } else {
-                    *res = xpath_parse_token(pcb, TK_TT_COMMA);
+                if (tk_next_typ(pcb->tkc) == TK_TT_RPAREN) {
+                    break;
                 }
+                *res = compile_token(pcb, TK_TT_COMMA);
             }
         }
-
-        /* get closing right paren */
         if (*res == NO_ERR) {
-            *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+            *res = compile_token(pcb, TK_TT_RPAREN);
         }
+        if (*res == NO_ERR && fncb->parmcnt >= 0 && 
+            fncb->parmcnt != parmcnt) {
+            *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+        }
+        if (*res == NO_ERR) {
+            comp->nodes[idx].tk = TK_CUR(pcb->tkc);
+        }
+        break;
+    default:
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
 
-        /* check parameter count */
-        if (fncb->parmcnt >= 0 && fncb->parmcnt != parmcnt) {
-            *res = (parmcnt > fncb->parmcnt) ?
-                ERR_NCX_EXTRA_PARM : ERR_NCX_MISSING_PARM;
+    return (*res == NO_ERR) ? idx : 0;
 
-            if (pcb->logerrors) {       
-                log_error("\nError: wrong number of "
-                          "parameters got %d, need %d"
-                          " for function '%s'",
-                          parmcnt, fncb->parmcnt,
-                          fncb->name);
-                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-            } else {
-                /*** log agent error ***/
-            }
-        } else {
-            /* make the function call */
-            val1 = (*fncb->fn)(pcb, &parmQ, res);
+}  /* compile_primary_expr */
 
-            if (LOGDEBUG3) {
-                if (val1) {
-                    log_debug3("\nXPath fn %s result:",
-                               fncb->name);
-                    dump_result(pcb, val1, NULL);
-                    if (pcb->val && pcb->context.node.valptr->name) {
-                        log_debug3("\nXPath context val name: %s",
-                                   pcb->context.node.valptr->name);
-                    }
-                }
+
+/********************************************************************
+* FUNCTION compile_path_expr
+* 
+* Compile a PathExpr
+* Mirrors the tokens consumed by parse_path_expr
+* and parse_filter_expr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    comp == compiled expression in progress
+*    res == address of result status
+*
+* RETURNS:
+*   index of the new node, 0 if some error
+*********************************************************************/
+static uint32
+    compile_path_expr (xpath_pcb_t *pcb,
+                       xpath_comp_t *comp,
+                       status_t *res)
+{
+    const xmlChar  *nextval;
+    tk_type_t       nexttyp, nexttyp2;
+    uint32          idx, filter, steps, preds;
+    boolean         locpath;
+
+    locpath = FALSE;
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_FSLASH:
+    case TK_TT_DBLFSLASH:
+    case TK_TT_PERIOD:
+    case TK_TT_RANGESEP:
+    case TK_TT_ATSIGN:
+    case TK_TT_STAR:
+    case TK_TT_NCNAME_STAR:
+    case TK_TT_MSTRING:
+        locpath = TRUE;
+        break;
+    case TK_TT_TSTRING:
+        nexttyp2 = tk_next_typ2(pcb->tkc);
+        nextval = tk_next_val(pcb->tkc);
+        if ((nexttyp2 == TK_TT_DBLCOLON && get_axis_id(nextval)) ||
+            (nexttyp2 == TK_TT_LPAREN && get_nodetype_id(nextval)) ||
+            nexttyp2 != TK_TT_LPAREN) {
+            locpath = TRUE;
+        }
+        break;
+    default:
+        ;
+    }
+
+    filter = 0;
+    if (!locpath) {
+        filter = compile_primary_expr(pcb, comp, res);
+        if (*res != NO_ERR) {
+            return 0;
+        }
+        preds = compile_predicates(pcb, comp, res);
+        if (*res != NO_ERR) {
+            return 0;
+        }
+        if (preds) {
+            idx = new_comp_node(comp, XP_EXK_FILTER, res);
+            if (!idx) {
+                return 0;
             }
+            comp->nodes[idx].left = filter;
+            comp->nodes[idx].preds = preds;
+            clear_keypreds(comp->nodes, filter);
+            filter = idx;
         }
-    } else {
-        *res = ERR_NCX_UNKNOWN_PARM;
 
-        if (pcb->logerrors) {   
-            log_error("\nError: Invalid XPath function name '%s'",
-                      (TK_CUR_VAL(pcb->tkc) != NULL) ?
-                      TK_CUR_VAL(pcb->tkc) : EMPTY_STRING);
-            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-        } else {
-            /*** log agent error ***/
+        nexttyp = tk_next_typ(pcb->tkc);
+        if (nexttyp != TK_TT_FSLASH && nexttyp != TK_TT_DBLFSLASH) {
+            return filter;
         }
     }
 
-    /* clean up any function parameters */
-    while (!dlq_empty(&parmQ)) {
-        val2 = (xpath_result_t *)dlq_deque(&parmQ);
-        free_result(pcb, val2);
+    steps = compile_location_path(pcb, comp, !locpath, res);
+    if (*res != NO_ERR) {
+        return 0;
     }
+    idx = new_comp_node(comp, XP_EXK_PATH, res);
+    if (idx) {
+        comp->nodes[idx].left = filter;
+        comp->nodes[idx].right = steps;
+    }
+    return idx;
 
-    return val1;
-
-} /* parse_function_call */
+}  /* compile_path_expr */
 
 
 /********************************************************************
-* FUNCTION parse_primary_expr
+* FUNCTION compile_binary
 * 
-* Parse an XPath PrimaryExpr sequence
-* It has already been tokenized
+* Add a BINARY node for an operator and its 2 operands
+* A number operator on 2 numbers is folded into 1 NUMBER node
 *
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* INPUTS:
+*    pcb == parser control block in progress
+*    comp == compiled expression in progress
+*    exop == operator
+*    left == index of the 1st operand
+*    right == index of the 2nd operand
+*    res == address of result status
 *
-* [15] PrimaryExpr ::= VariableReference
-*                       | '(' Expr ')'
-*                       | Literal
-*                       | Number
-*                       | FunctionCall
+* RETURNS:
+*   index of the new node, 0 if some error
+*********************************************************************/
+static uint32
+    compile_binary (xpath_pcb_t *pcb,
+                    xpath_comp_t *comp,
+                    xpath_exop_t exop,
+                    uint32 left,
+                    uint32 right,
+                    status_t *res)
+{
+    uint32  idx;
+
+    switch (exop) {
+    case XP_EXOP_ADD:
+    case XP_EXOP_SUBTRACT:
+    case XP_EXOP_MULTIPLY:
+    case XP_EXOP_DIV:
+    case XP_EXOP_MOD:
+        if (comp->nodes[left].kind == XP_EXK_NUMBER &&
+            comp->nodes[right].kind == XP_EXK_NUMBER) {
+            *res = apply_number_op(exop, 
+                                   &comp->nodes[left].num,
+                                   &comp->nodes[right].num,
+                                   &comp->nodes[left].num);
+            return (*res == NO_ERR) ? left : 0;
+        }
+        break;
+    default:
+        ;
+    }
+
+    idx = new_comp_node(comp, XP_EXK_BINARY, res);
+    if (idx) {
+        comp->nodes[idx].exop = exop;
+        comp->nodes[idx].left = left;
+        comp->nodes[idx].right = right;
+        comp->nodes[idx].tk = TK_CUR(pcb->tkc);
+    }
+
+    /* a compared location path that does not depend on the
+     * context node is only evaluated once per evaluation;
+     * see eval_comp_operand
+     */
+    switch (exop) {
+    case XP_EXOP_EQUAL:
+    case XP_EXOP_NOTEQUAL:
+    case XP_EXOP_LT:
+    case XP_EXOP_GT:
+    case XP_EXOP_LEQUAL:
+    case XP_EXOP_GEQUAL:
+        if (idx && comp->nodes[left].kind == XP_EXK_PATH &&
+            is_context_free(comp->nodes, left)) {
+            comp->nodes[left].cache = ++comp->cachecnt;
+        }
+        if (idx && comp->nodes[right].kind == XP_EXK_PATH &&
+            is_context_free(comp->nodes, right)) {
+            comp->nodes[right].cache = ++comp->cachecnt;
+        }
+        break;
+    default:
+        ;
+    }
+    return idx;
+
+}  /* compile_binary */
+
+
+/********************************************************************
+* FUNCTION compile_unary_expr
+* 
+* Compile a UnaryExpr and the UnionExpr inside it
+* Mirrors the tokens consumed by parse_unary_expr
+* and parse_union_expr
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    comp == compiled expression in progress
 *    res == address of result status
 *
-* OUTPUTS:
-*   *res == function result status
-*
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   index of the new node, 0 if some error
 *********************************************************************/
-static xpath_result_t *
-    parse_primary_expr (xpath_pcb_t *pcb,
+static uint32
+    compile_unary_expr (xpath_pcb_t *pcb,
+                        xpath_comp_t *comp,
                         status_t *res)
 {
-    xpath_result_t         *val1;
-    ncx_var_t              *varbind;
-    const xmlChar          *errstr;
-    tk_type_t               nexttyp;
-    ncx_numfmt_t            numfmt;
-
-    val1 = NULL;
-    nexttyp = tk_next_typ(pcb->tkc);
+    uint32  minuscnt, left, right, idx;
 
-    switch (nexttyp) {
-    case TK_TT_VARBIND:
-    case TK_TT_QVARBIND:
-        *res = xpath_parse_token(pcb, nexttyp);
+    minuscnt = 0;
+    while (tk_next_typ(pcb->tkc) == TK_TT_MINUS) {
+        (void)TK_ADV(pcb->tkc);
+        minuscnt++;
+    }
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            *res = ERR_NCX_INVALID_INSTANCEID;
-            return NULL;
+    left = compile_path_expr(pcb, comp, res);
+    while (*res == NO_ERR && tk_next_typ(pcb->tkc) == TK_TT_BAR) {
+        (void)TK_ADV(pcb->tkc);
+        right = compile_path_expr(pcb, comp, res);
+        if (*res != NO_ERR) {
+            break;
         }
+        idx = new_comp_node(comp, XP_EXK_UNION, res);
+        if (idx) {
+            comp->nodes[idx].left = left;
+            comp->nodes[idx].right = right;
+        }
+        left = idx;
+    }
+    if (*res != NO_ERR) {
+        return 0;
+    }
 
-        /* get QName or NCName variable reference
-         * but only if this get is a real one
-         */
-        if (*res == NO_ERR && pcb->val) {
-            if (TK_CUR_TYP(pcb->tkc) == TK_TT_VARBIND) {
-                varbind = get_varbind(pcb, 
-                                      NULL, 
-                                      0, 
-                                      TK_CUR_VAL(pcb->tkc), res);
-                errstr = TK_CUR_VAL(pcb->tkc);
-            } else {
-                varbind = get_varbind(pcb, 
-                                      TK_CUR_MOD(pcb->tkc),
-                                      TK_CUR_MODLEN(pcb->tkc), 
-                                      TK_CUR_VAL(pcb->tkc), res);
-                errstr = TK_CUR_MOD(pcb->tkc);
-            }
-            if (!varbind || *res != NO_ERR) {
-                if (pcb->logerrors) {
-                    if (*res == ERR_NCX_DEF_NOT_FOUND) {
-                        log_error("\nError: unknown variable binding '%s'",
-                                  errstr);
-                        ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-                    } else {
-                        log_error("\nError: error in variable binding '%s'",
-                                  errstr);
-                        ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-                    }
-                }
-            } else {
-                /* OK: found the variable binding */
-                val1 = cvt_from_value(pcb, varbind->val);
-                if (!val1) {
-                    *res = ERR_INTERNAL_MEM;
-                }
+    if (minuscnt & 1) {
+        if (comp->nodes[left].kind == XP_EXK_NUMBER) {
+            comp->nodes[left].num.d *= -1;
+        } else {
+            idx = new_comp_node(comp, XP_EXK_NEGATE, res);
+            if (idx) {
+                comp->nodes[idx].left = left;
             }
+            left = idx;
         }
-        break;
-    case TK_TT_LPAREN:
-        /* get ( expr ) */
-        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
-        if (*res == NO_ERR) {
+    }
+    return left;
 
-            if (pcb->flags & XP_FL_INSTANCEID) {
-                invalid_instanceid_error(pcb);
-                *res = ERR_NCX_INVALID_INSTANCEID;
-                return NULL;
-            }
+}  /* compile_unary_expr */
 
-            val1 = parse_expr(pcb, res);
-            if (*res == NO_ERR) {
-                *res = xpath_parse_token(pcb, TK_TT_RPAREN);
-            }
-        }
-        break;
-    case TK_TT_DNUM:
-    case TK_TT_RNUM:
-        *res = xpath_parse_token(pcb, nexttyp);
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            *res = ERR_NCX_INVALID_INSTANCEID;
-            return NULL;
-        }
+/********************************************************************
+* FUNCTION compile_expr
+* 
+* Compile an Expr from the current token onward
+* Mirrors the tokens consumed by parse_or_expr,
+* down through parse_multiplicative_expr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    comp == compiled expression in progress
+*    res == address of result status
+*
+* RETURNS:
+*   index of the new node, 0 if some error
+*********************************************************************/
+static uint32
+    compile_expr (xpath_pcb_t *pcb,
+                  xpath_comp_t *comp,
+                  status_t *res)
+{
+    /* operator precedence levels, lowest first */
+    enum {
+        LVL_OR, LVL_AND, LVL_EQUALITY, LVL_RELATIONAL, 
+        LVL_ADDITIVE, LVL_MULTIPLICATIVE, LVL_UNARY
+    };
+    uint32          left[LVL_UNARY];
+    xpath_exop_t    exop[LVL_UNARY];
+    xpath_exop_t    nextop;
+    tk_type_t       nexttyp;
+    uint32          operand;
+    int             lvl, oplvl;
 
-        /* get the Number token */
-        if (*res == NO_ERR) {
-            val1 = new_result(pcb, XP_RT_NUMBER);
-            if (!val1) {
-                *res = ERR_INTERNAL_MEM;
-                return NULL;
-            }
+    /* operands waiting for their operator, one per level */
+    for (lvl = 0; lvl < LVL_UNARY; lvl++) {
+        left[lvl] = 0;
+        exop[lvl] = XP_EXOP_NONE;
+    }
 
-            numfmt = ncx_get_numfmt(TK_CUR_VAL(pcb->tkc));
-            if (numfmt == NCX_NF_OCTAL) {
-                numfmt = NCX_NF_DEC;
-            }
-            if (numfmt == NCX_NF_DEC || numfmt == NCX_NF_REAL) {
-                *res = ncx_convert_num(TK_CUR_VAL(pcb->tkc),
-                                       numfmt,
-                                       NCX_BT_FLOAT64,
-                                       &val1->r.num);
-            } else if (numfmt == NCX_NF_NONE) {
-                *res = ERR_NCX_INVALID_VALUE;
-            } else {
-                *res = ERR_NCX_WRONG_NUMTYP;
-            }
+    for (;;) {
+        operand = compile_unary_expr(pcb, comp, res);
+        if (*res != NO_ERR) {
+            return 0;
         }
-        break;
-    case TK_TT_QSTRING:             /* double quoted string */
-    case TK_TT_SQSTRING:            /* single quoted string */
-        /* get the literal token */
-        *res = xpath_parse_token(pcb, nexttyp);
 
-        if (*res == NO_ERR) {
-            val1 = new_result(pcb, XP_RT_STRING);
-            if (!val1) {
-                *res = ERR_INTERNAL_MEM;
-                return NULL;
+        /* get the next operator and its level */
+        nextop = XP_EXOP_NONE;
+        oplvl = -1;
+        nexttyp = tk_next_typ(pcb->tkc);
+        switch (nexttyp) {
+        case TK_TT_STAR:
+            nextop = XP_EXOP_MULTIPLY;
+            oplvl = LVL_MULTIPLICATIVE;
+            break;
+        case TK_TT_PLUS:
+            nextop = XP_EXOP_ADD;
+            oplvl = LVL_ADDITIVE;
+            break;
+        case TK_TT_MINUS:
+            nextop = XP_EXOP_SUBTRACT;
+            oplvl = LVL_ADDITIVE;
+            break;
+        case TK_TT_LT:
+            nextop = XP_EXOP_LT;
+            oplvl = LVL_RELATIONAL;
+            break;
+        case TK_TT_GT:
+            nextop = XP_EXOP_GT;
+            oplvl = LVL_RELATIONAL;
+            break;
+        case TK_TT_LEQUAL:
+            nextop = XP_EXOP_LEQUAL;
+            oplvl = LVL_RELATIONAL;
+            break;
+        case TK_TT_GEQUAL:
+            nextop = XP_EXOP_GEQUAL;
+            oplvl = LVL_RELATIONAL;
+            break;
+        case TK_TT_EQUAL:
+            nextop = XP_EXOP_EQUAL;
+            oplvl = LVL_EQUALITY;
+            break;
+        case TK_TT_NOTEQUAL:
+            nextop = XP_EXOP_NOTEQUAL;
+            oplvl = LVL_EQUALITY;
+            break;
+        case TK_TT_TSTRING:
+            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_DIV)) {
+                nextop = XP_EXOP_DIV;
+                oplvl = LVL_MULTIPLICATIVE;
+            } else if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_MOD)) {
+                nextop = XP_EXOP_MOD;
+                oplvl = LVL_MULTIPLICATIVE;
+            } else if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_AND)) {
+                nextop = XP_EXOP_AND;
+                oplvl = LVL_AND;
+            } else if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_OR)) {
+                nextop = XP_EXOP_OR;
+                oplvl = LVL_OR;
             }
+            break;
+        default:
+            ;
+        }
 
-            if (TK_CUR_VAL(pcb->tkc) != NULL) {
-                val1->r.str = xml_strdup(TK_CUR_VAL(pcb->tkc));
-            } else {
-                val1->r.str = xml_strdup(EMPTY_STRING);
-            }
-            if (!val1->r.str) {
-                *res = ERR_INTERNAL_MEM;
-                malloc_failed_error(pcb);
-                xpath_free_result(val1);
-                val1 = NULL;
+        /* left-associative: reduce every pending operator
+         * at the same or a higher level first
+         */
+        for (lvl = LVL_UNARY - 1; lvl > oplvl; lvl--) {
+            if (left[lvl]) {
+                operand = compile_binary(pcb, comp, exop[lvl],
+                                         left[lvl], operand, res);
+                if (*res != NO_ERR) {
+                    return 0;
+                }
+                left[lvl] = 0;
             }
         }
-        break;
-    case TK_TT_TSTRING:                    /* NCName string */
-        /* get the string ID token */
-        nexttyp = tk_next_typ2(pcb->tkc);
-        if (nexttyp == TK_TT_LPAREN) {
-            val1 = parse_function_call(pcb, res);
-        } else {
-            *res = SET_ERROR(ERR_INTERNAL_VAL);
+        if (oplvl < 0) {
+            return operand;
         }
-        break;
-    case TK_TT_NONE:
-        /* unexpected end of token chain */
-        (void)TK_ADV(pcb->tkc);
-        *res = ERR_NCX_INVALID_XPATH_EXPR;
-        if (pcb->logerrors) {
-            log_error("\nError: token expected in XPath expression '%s'",
-                      pcb->exprstr);
-            /* hack to get correct error token to print */
-            pcb->tkc->curerr = &pcb->tkerr;
-            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-        } else {
-            ;  /**** log agent error ****/
+        if (left[oplvl]) {
+            operand = compile_binary(pcb, comp, exop[oplvl],
+                                     left[oplvl], operand, res);
+            if (*res != NO_ERR) {
+                return 0;
+            }
         }
-        break;
-    default:
-        /* unexpected token error */
+        left[oplvl] = operand;
+        exop[oplvl] = nextop;
         (void)TK_ADV(pcb->tkc);
-        *res = ERR_NCX_WRONG_TKTYPE;
-        unexpected_error(pcb);
     }
+    /*NOTREACHED*/
 
-    return val1;
+}  /* compile_expr */
 
-} /* parse_primary_expr */
+
+/* forward decl needed for recursion */
+static xpath_result_t *
+    eval_comp_node (xpath_pcb_t *pcb,
+                    const xpath_exnode_t *node,
+                    status_t *res);
 
 
 /********************************************************************
-* FUNCTION parse_filter_expr
+* FUNCTION eval_comp_predicate
 * 
-* Parse an XPath FilterExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [20] FilterExpr ::= PrimaryExpr       
-*                     | FilterExpr Predicate    
+* Evaluate one compiled predicate against a result
+* Same result as parse_predicate
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    pred == compiled predicate expr
+*    result == address of result in progress to filter
 *
 * OUTPUTS:
-*   *res == function result status
+*   *result may be pruned based on filter matches
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_filter_expr (xpath_pcb_t *pcb,
-                       status_t *res)
+static status_t
+    eval_comp_predicate (xpath_pcb_t *pcb,
+                         const xpath_exnode_t *pred,
+                         xpath_result_t **result)
 {
-    xpath_result_t  *val1, *dummy;
-    tk_type_t        nexttyp;
+    xpath_result_t  *val1, *contextset;
+    xpath_resnode_t  lastcontext, *resnode, *nextnode;
+    boolean          boo;
+    status_t         res;
+    int64            position;
 
-    val1 = parse_primary_expr(pcb, res);
-    if (*res != NO_ERR) {
-        return val1;
+    res = NO_ERR;
+    boo = FALSE;
+    contextset = *result;
+    if (!contextset) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
     }
 
-    /* peek ahead to check the possible next chars */
-    nexttyp = tk_next_typ(pcb->tkc);
+    if (contextset->restype != XP_RT_NODESET) {
+        /* cleared if the predicate evaluates to false */
+        val1 = eval_comp_node(pcb, pred, &res);
+        if (val1) {
+            if (res == NO_ERR) {
+                boo = xpath_cvt_boolean(val1);
+            }
+            free_result(pcb, val1);
+        }
+        if (res == NO_ERR && !boo) {
+            xpath_clean_result(contextset);
+            xpath_init_result(contextset, XP_RT_NONE);
+        }
+        return res;
+    }
 
-    if (val1) {
-        while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
-            *res = parse_predicate(pcb, &val1);
-            nexttyp = tk_next_typ(pcb->tkc);
+    if (dlq_empty(&contextset->r.nodeQ)) {
+        /* always one pass; do not care about result */
+        val1 = eval_comp_node(pcb, pred, &res);
+        if (val1) {
+            free_result(pcb, val1);
         }
-    } else if (nexttyp==TK_TT_LBRACK) {
-        dummy = new_result(pcb, XP_RT_NODESET);
-        if (dummy) {
-            while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
-                *res = parse_predicate(pcb, &dummy);
-                nexttyp = tk_next_typ(pcb->tkc);
+        return res;
+    }
+
+    lastcontext.node.valptr = pcb->context.node.valptr;
+    lastcontext.position = pcb->context.position;
+    lastcontext.last = pcb->context.last;
+    lastcontext.dblslash = pcb->context.dblslash;
+
+    for (resnode = (xpath_resnode_t *)
+             dlq_firstEntry(&contextset->r.nodeQ);
+         resnode != NULL;
+         resnode = nextnode) {
+
+        nextnode = (xpath_resnode_t *)dlq_nextEntry(resnode);
+
+        pcb->context.node.valptr = resnode->node.valptr;
+        pcb->context.position = resnode->position;
+        pcb->context.last = contextset->last;
+        pcb->context.dblslash = resnode->dblslash;
+
+        val1 = eval_comp_node(pcb, pred, &res);
+        if (res != NO_ERR) {
+            if (val1) {
+                free_result(pcb, val1);
+            }
+            return res;
+        }
+
+        boo = FALSE;
+        if (!val1) {
+            ;
+        } else if (val1->restype == XP_RT_NUMBER) {
+            /* only the Nth node in the context is selected */
+            if (ncx_num_is_integral(&val1->r.num, NCX_BT_FLOAT64)) {
+                position = ncx_cvt_to_int64(&val1->r.num,
+                                            NCX_BT_FLOAT64);
+                boo = (position == resnode->position) ? TRUE : FALSE;
             }
-            free_result(pcb, dummy);
         } else {
-            *res = ERR_INTERNAL_MEM;
-            return NULL;
+            boo = xpath_cvt_boolean(val1);
+        }
+        if (val1) {
+            free_result(pcb, val1);
+        }
+
+        if (!boo) {
+            dlq_remove(resnode);
+            free_resnode(pcb, resnode);
         }
     }
 
-    return val1;
+    pcb->context.node.valptr = lastcontext.node.valptr;
+    pcb->context.position = lastcontext.position;
+    pcb->context.last = lastcontext.last;
+    pcb->context.dblslash = lastcontext.dblslash;
 
-} /* parse_filter_expr */
+    return NO_ERR;
+
+}  /* eval_comp_predicate */
 
 
 /********************************************************************
-* FUNCTION parse_path_expr
+* FUNCTION eval_comp_preds
 * 
-* Parse an XPath PathExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [19] PathExpr ::= LocationPath
-*                   | FilterExpr
-*                   | FilterExpr '/' RelativeLocationPath
-*                   | FilterExpr '//' RelativeLocationPath
+* Evaluate a list of compiled predicates against a result
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    idx == index of the 1st predicate expr
+*    result == address of result in progress to filter
 *
 * OUTPUTS:
-*   *res == function result status
+*   *result may be pruned based on filter matches
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_path_expr (xpath_pcb_t *pcb,
-                     status_t *res)
+static status_t
+    eval_comp_preds (xpath_pcb_t *pcb,
+                     uint32 idx,
+                     xpath_result_t **result)
 {
-    xpath_result_t  *val1, *val2;
-    const xmlChar   *nextval;
-    tk_type_t        nexttyp, nexttyp2;
-    xpath_exop_t     curop;
+    const xpath_exnode_t  *nodes;
+    status_t               res;
 
-    val1 = NULL;
-    val2 = NULL;
+    nodes = pcb->comp->nodes;
+    res = NO_ERR;
+    for (; idx && res == NO_ERR; idx = nodes[idx].next) {
+        res = eval_comp_predicate(pcb, &nodes[idx], result);
+    }
+    return res;
 
-    /* peek ahead to check the possible next sequence */
-    nexttyp = tk_next_typ(pcb->tkc);
-    switch (nexttyp) {
-    case TK_TT_FSLASH:                /* abs location path */
-    case TK_TT_DBLFSLASH:     /* abbrev. abs location path */
-    case TK_TT_PERIOD:                      /* abbrev step */
-    case TK_TT_RANGESEP:                    /* abbrev step */
-    case TK_TT_ATSIGN:                 /* abbrev axis name */
-    case TK_TT_STAR:              /* rel, step, node, name */
-    case TK_TT_NCNAME_STAR:       /* rel, step, node, name */
-    case TK_TT_MSTRING:          /* rel, step, node, QName */
-        return parse_location_path(pcb, NULL, res);
-    case TK_TT_TSTRING:
-        /* some sort of identifier string to check
-         * get the value of the string and the following token type
-         */
-        nexttyp2 = tk_next_typ2(pcb->tkc);
-        nextval = tk_next_val(pcb->tkc);
+}  /* eval_comp_preds */
 
-        /* check 'axis-name ::' sequence */
-        if (nexttyp2==TK_TT_DBLCOLON && get_axis_id(nextval)) {
-            /* this is an axis name */
-            return parse_location_path(pcb, NULL, res);
-        }               
 
-        /* check 'NodeType (' sequence */
-        if (nexttyp2==TK_TT_LPAREN && get_nodetype_id(nextval)) {
-            /* this is an nodetype name */
-            return parse_location_path(pcb, NULL, res);
+/********************************************************************
+* FUNCTION get_keytest_string
+* 
+* Get the string that a key test compares the key leaf to,
+* the same way compare_nodeset_to_other and compare_nodesets
+* convert the value of the other operand
+*
+* INPUTS:
+*    val1 == result of the value expr of the key test
+*    isempty == address of return empty node-set flag
+*    res == address of return status
+*
+* OUTPUTS:
+*    *isempty == TRUE if val1 is an empty node-set,
+*                so no list entry can match
+*    *res == ERR_NCX_SKIPPED if val1 cannot be used for a
+*            key lookup; the step has to be evaluated as usual
+*
+* RETURNS:
+*   malloced string value, NULL if none
+*********************************************************************/
+static xmlChar *
+    get_keytest_string (xpath_result_t *val1,
+                        boolean *isempty,
+                        status_t *res)
+{
+    xpath_resnode_t  *resnode;
+    val_value_t      *val;
+    xmlChar          *str;
+    uint32            len;
+
+    str = NULL;
+    switch (val1->restype) {
+    case XP_RT_STRING:
+        str = xml_strdup((val1->r.str) ? val1->r.str : EMPTY_STRING);
+        if (!str) {
+            *res = ERR_INTERNAL_MEM;
+        }
+        return str;
+    case XP_RT_NODESET:
+        if (!val1->isval) {
+            *res = ERR_NCX_SKIPPED;
+            return NULL;
+        }
+        resnode = (xpath_resnode_t *)dlq_firstEntry(&val1->r.nodeQ);
+        if (!resnode) {
+            *isempty = TRUE;
+            return NULL;
+        }
+        val = resnode->node.valptr;
+        if (dlq_nextEntry(resnode) || !typ_is_simple(val->btyp) ||
+            val_is_virtual(val) || obj_is_password(val->obj)) {
+            *res = ERR_NCX_SKIPPED;
+            return NULL;
+        }
+        if (typ_is_string(val->btyp)) {
+            str = xml_strdup((VAL_STR(val)) ? VAL_STR(val) : EMPTY_STRING);
+            if (!str) {
+                *res = ERR_INTERNAL_MEM;
+            }
+            return str;
+        }
+        *res = val_sprintf_simval_nc(NULL, val, &len);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+        str = m__getMem(len+1);
+        if (!str) {
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+        *res = val_sprintf_simval_nc(str, val, &len);
+        if (*res != NO_ERR) {
+            m__free(str);
+            return NULL;
         }
+        return str;
+    default:
+        *res = ERR_NCX_SKIPPED;
+        return NULL;
+    }
+
+}  /* get_keytest_string */
+
+
+/********************************************************************
+* FUNCTION new_key_searchval
+* 
+* Make a list entry with the key values from the key tests,
+* to look up the entries of a list by key.
+* Only key types whose XPath string value is the same
+* for all equal values are used, so an entry with a
+* matching string is never missed; the predicates
+* are still evaluated on the entry found
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    listobj == list object for the entries
+*    tests == key tests with the string values set
+*    testcnt == number of tests
+*    res == address of return status
+*
+* OUTPUTS:
+*    *res == ERR_NCX_SKIPPED if the tests do not match the
+*            keys of the list, or a value does not fit the key type
+*
+* RETURNS:
+*   malloced search entry, NULL if some error
+*********************************************************************/
+static val_value_t *
+    new_key_searchval (xpath_pcb_t *pcb,
+                       obj_template_t *listobj,
+                       const keytest_t *tests,
+                       uint32 testcnt,
+                       status_t *res)
+{
+    const xpath_exnode_t  *lhs;
+    const keytest_t       *match;
+    obj_key_t             *key;
+    val_value_t           *searchval, *keyval;
+    uint32                 i, keycnt;
+
+    if (listobj->objtype != OBJ_TYP_LIST) {
+        *res = ERR_NCX_SKIPPED;
+        return NULL;
+    }
 
-        /* check not a function call, so must be a QName */
-        if (nexttyp2 != TK_TT_LPAREN) {
-            /* this is an NameTest QName w/o a prefix */
-            return parse_location_path(pcb, NULL, res);
-        }
-        break;
-    default:
-        ;
+    searchval = val_new_value();
+    if (!searchval) {
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
     }
+    val_init_from_template(searchval, listobj);
 
-    /* if we get here, then a filter expression is expected */
-    val1 = parse_filter_expr(pcb, res);
+    keycnt = 0;
+    for (key = obj_first_key(listobj);
+         key != NULL && *res == NO_ERR;
+         key = obj_next_key(key)) {
 
-    if (*res == NO_ERR) {
-        nexttyp = tk_next_typ(pcb->tkc);
-        switch (nexttyp) {
-        case TK_TT_FSLASH:
-            curop = XP_EXOP_FILTER1;
+        keycnt++;
+        match = NULL;
+        for (i = 0; i < testcnt; i++) {
+            lhs = &pcb->comp->nodes[tests[i].lhs];
+            if (xml_strcmp(lhs->name, obj_get_name(key->keyobj)) ||
+                (lhs->nsid && lhs->nsid != obj_get_nsid(key->keyobj))) {
+                continue;
+            }
+            if (match) {
+                /* same key tested twice */
+                match = NULL;
+                break;
+            }
+            match = &tests[i];
+        }
+        if (!match) {
+            *res = ERR_NCX_SKIPPED;
             break;
-        case TK_TT_DBLFSLASH:
-            curop = XP_EXOP_FILTER2;
+        }
+
+        switch (obj_get_basetype(key->keyobj)) {
+        case NCX_BT_STRING:
+        case NCX_BT_ENUM:
+        case NCX_BT_INT8:
+        case NCX_BT_INT16:
+        case NCX_BT_INT32:
+        case NCX_BT_INT64:
+        case NCX_BT_UINT8:
+        case NCX_BT_UINT16:
+        case NCX_BT_UINT32:
+        case NCX_BT_UINT64:
             break;
         default:
-            curop = XP_EXOP_NONE;
+            *res = ERR_NCX_SKIPPED;
+            continue;
         }
 
-        if (curop != XP_EXOP_NONE) {
-            val2 = parse_location_path(pcb, val1, res);
-        } else {
-            val2 = val1;
+        keyval = val_make_simval_obj(key->keyobj, match->valstr, res);
+        if (!keyval) {
+            if (*res != ERR_INTERNAL_MEM) {
+                *res = ERR_NCX_SKIPPED;
+            }
+            break;
         }
-        val1 = NULL;
+        val_add_child(keyval, searchval);
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+    if (*res == NO_ERR && keycnt != testcnt) {
+        *res = ERR_NCX_SKIPPED;
     }
+    if (*res == NO_ERR) {
+        *res = val_gen_index_chain(listobj, searchval);
+        if (*res != NO_ERR && *res != ERR_INTERNAL_MEM) {
+            *res = ERR_NCX_SKIPPED;
+        }
+    }
+    if (*res != NO_ERR) {
+        val_free_value(searchval);
+        return NULL;
+    }
+    return searchval;
 
-    return val2;
-
-} /* parse_path_expr */
+}  /* new_key_searchval */
 
 
 /********************************************************************
-* FUNCTION parse_union_expr
+* FUNCTION eval_comp_keystep
 * 
-* Parse an XPath UnionExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [18] UnionExpr ::= PathExpr
-*                    | UnionExpr '|' PathExpr
+* Evaluate a compiled child step whose predicates only
+* compare all the list keys to values that are the same
+* for every context node, by looking up the list entries
+* by key instead of testing every entry
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    step == compiled STEP node with keypreds set
+*    result == nodeset in progress with the parent nodes
+*    done == address of return done flag
 *
 * OUTPUTS:
-*   *res == function result status
+*    *done == TRUE if the parent nodes in result were
+*             replaced by the list entries found
+*             FALSE if the step has to be evaluated as usual;
+*             result is not changed in this case
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_union_expr (xpath_pcb_t *pcb,
-                      status_t *res)
+static status_t
+    eval_comp_keystep (xpath_pcb_t *pcb,
+                       const xpath_exnode_t *step,
+                       xpath_result_t *result,
+                       boolean *done)
 {
-    xpath_result_t  *val1, *val2;
-    boolean          done;
-    tk_type_t        nexttyp;
+    keytest_t          tests[KEYTEST_MAX];
+    xpath_result_t    *val1;
+    xpath_resnode_t   *resnode, *newnode;
+    val_value_t       *first, *found, *searchval;
+    obj_template_t    *listobj;
+    const xmlChar     *modname;
+    dlq_hdr_t          foundQ;
+    uint32             i, testcnt, foundcnt;
+    boolean            cfgonly, isempty;
+    status_t           res;
 
-    val1 = NULL;
-    val2 = NULL;
-    done = FALSE;
+    *done = FALSE;
+    if (result->restype != XP_RT_NODESET || 
+        dlq_empty(&result->r.nodeQ)) {
+        return NO_ERR;
+    }
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_path_expr(pcb, res);
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+        if (resnode->dblslash || val_is_virtual(resnode->node.valptr)) {
+            return NO_ERR;
+        }
+    }
 
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* add all the nodes from val1 into val2
-                     * that are not already present
-                     */
-                    merge_nodeset(pcb, val1, val2);
-                    
-                    if (val1) {
-                        free_result(pcb, val1);
-                        val1 = NULL;
-                    }
-                }
+    if (!check_keypreds(pcb->comp->nodes, step->preds, tests, &testcnt)) {
+        return NO_ERR;
+    }
+
+    /* get each value once; every test is evaluated, as the
+     * predicates would be, even if a value is an empty node-set
+     */
+    res = NO_ERR;
+    isempty = FALSE;
+    for (i = 0; i < testcnt && res == NO_ERR; i++) {
+        val1 = eval_comp_node(pcb, &pcb->comp->nodes[tests[i].rhs], &res);
+        if (res == NO_ERR) {
+            if (val1) {
+                tests[i].valstr = get_keytest_string(val1, &isempty, &res);
             } else {
-                val2 = val1;
-                val1 = NULL;
+                res = ERR_NCX_SKIPPED;
             }
+        }
+        if (val1) {
+            free_result(pcb, val1);
+        }
+    }
 
-            if (*res != NO_ERR) {
-                continue;
+    dlq_createSQue(&foundQ);
+    foundcnt = 0;
+    searchval = NULL;
+    listobj = NULL;
+    cfgonly = (pcb->flags & XP_FL_CONFIGONLY) ? TRUE : FALSE;
+    modname = (step->nsid) ? xmlns_get_module(step->nsid) : NULL;
+
+    for (resnode = (xpath_resnode_t *)dlq_firstEntry(&result->r.nodeQ);
+         resnode != NULL && res == NO_ERR && !isempty;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+
+        first = val_find_child(resnode->node.valptr, modname, step->name);
+        if (!first || (cfgonly && !obj_is_config(first->obj))) {
+            continue;
+        }
+
+        if (first->obj != listobj) {
+            if (searchval) {
+                val_free_value(searchval);
+            }
+            listobj = first->obj;
+            searchval = new_key_searchval(pcb, listobj, tests, testcnt, &res);
+            if (!searchval) {
+                break;
             }
+        }
 
-            nexttyp = tk_next_typ(pcb->tkc);
-            if (nexttyp != TK_TT_BAR) {
-                done = TRUE;
+        if (!val_find_list_entry(resnode->node.valptr, modname, 
+                                 searchval, &found)) {
+            res = ERR_NCX_SKIPPED;
+        } else if (found) {
+            /* the key tests do not use the context position */
+            newnode = new_val_resnode(pcb, 1, FALSE, found);
+            if (newnode) {
+                dlq_enque(newnode, &foundQ);
+                foundcnt++;
             } else {
-                *res = xpath_parse_token(pcb, TK_TT_BAR);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
+                res = ERR_INTERNAL_MEM;
             }
         }
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+    if (searchval) {
+        val_free_value(searchval);
+    }
+    for (i = 0; i < testcnt; i++) {
+        if (tests[i].valstr) {
+            m__free(tests[i].valstr);
+        }
     }
 
-    return val2;
+    if (res != NO_ERR) {
+        while (!dlq_empty(&foundQ)) {
+            free_resnode(pcb, (xpath_resnode_t *)dlq_deque(&foundQ));
+        }
+        return (res == ERR_NCX_SKIPPED) ? NO_ERR : res;
+    }
 
-} /* parse_union_expr */
+    while (!dlq_empty(&result->r.nodeQ)) {
+        free_resnode(pcb, (xpath_resnode_t *)dlq_deque(&result->r.nodeQ));
+    }
+    dlq_block_enque(&foundQ, &result->r.nodeQ);
+    result->last = foundcnt;
+    *done = TRUE;
+    return NO_ERR;
+
+}  /* eval_comp_keystep */
 
 
 /********************************************************************
-* FUNCTION parse_unary_expr
+* FUNCTION eval_comp_step
 * 
-* Parse an XPath UnaryExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [27] UnaryExpr ::= UnionExpr  
-*                    | '-' UnaryExpr
+* Evaluate one compiled location step
+* Same result as parse_step in value mode
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    step == compiled STEP node
+*    result == address of result nodeset in progress
 *
 * OUTPUTS:
-*   *res == function result status
+*   *result pointer is set to malloced result struct
+*    if it is NULL, or used if it is non-NULL
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_unary_expr (xpath_pcb_t *pcb,
-                      status_t *res)
+static status_t
+    eval_comp_step (xpath_pcb_t *pcb,
+                    const xpath_exnode_t *step,
+                    xpath_result_t **result)
 {
-    xpath_result_t  *val1, *result;
-    tk_type_t        nexttyp;
-    uint32           minuscnt;
+    status_t   res;
+    boolean    keydone;
 
-    val1 = NULL;
-    minuscnt = 0;
+    TK_CUR(pcb->tkc) = step->tk;
 
-    nexttyp = tk_next_typ(pcb->tkc);
-    while (nexttyp == TK_TT_MINUS) {
-        *res = xpath_parse_token(pcb, TK_TT_MINUS);
-        if (*res != NO_ERR) {
-            return NULL;
-        } else {
-            nexttyp = tk_next_typ(pcb->tkc);
-            minuscnt++;
+    if (step->exop == XP_EXOP_FILTER2) {
+        if (!*result) {
+            *result = new_nodeset(pcb,
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  TRUE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
+            }
+        }
+        set_nodeset_dblslash(pcb, *result);
+    } else if (step->exop == XP_EXOP_FILTER1) {
+        if (!*result) {
+            *result = new_nodeset(pcb, 
+                                  pcb->docroot, 
+                                  pcb->val_docroot,
+                                  1,
+                                  FALSE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
+            }
+            if (step->steptyp == TK_TT_FSLASH) {
+                return NO_ERR;
+            }
         }
+    } else if (*result) {
+        /* should not happen */
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return ERR_NCX_INVALID_XPATH_EXPR;
     }
 
-    val1 = parse_union_expr(pcb, res);
+    if (step->steptyp == TK_TT_FSLASH) {
+        /* should not happen */
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return ERR_NCX_INVALID_XPATH_EXPR;
+    }
 
-    if (*res == NO_ERR && (minuscnt & 1)) {
-        if (pcb->val || pcb->obj) {
-            /* odd number of negate ops requested */
+    /* every step type starts at the context node */
+    if (!*result) {
+        *result = new_nodeset(pcb,
+                              pcb->context.node.objptr,
+                              pcb->context.node.valptr,
+                              1, 
+                              FALSE);
+        if (!*result) {
+            return ERR_INTERNAL_MEM;
+        }
+    }
 
-            if (val1->restype == XP_RT_NUMBER) {
-                val1->r.num.d *= -1;
-                return val1;
-            } else {
-                result = new_result(pcb, XP_RT_NUMBER);
-                if (!result) {
-                    *res = ERR_INTERNAL_MEM;
-                    return NULL;
-                }
-                xpath_cvt_number(val1, &result->r.num);
-                result->r.num.d *= -1;
-                free_result(pcb, val1);
-                return result;
-            }
+    switch (step->steptyp) {
+    case TK_TT_PERIOD:
+        return NO_ERR;
+    case TK_TT_RANGESEP:
+        return set_nodeset_parent(pcb, *result, 0, NULL);
+    default:
+        ;
+    }
+
+    if (step->keypreds && pcb->val) {
+        res = eval_comp_keystep(pcb, step, *result, &keydone);
+        if (res == NO_ERR && keydone) {
+            /* the predicates still check the entries found */
+            res = eval_comp_preds(pcb, step->preds, result);
+        }
+        if (res != NO_ERR || keydone) {
+            return res;
         }
     }
 
-    return val1;
+    switch (step->axis) {
+    case XP_AX_ANCESTOR:
+    case XP_AX_ANCESTOR_OR_SELF:
+        res = set_nodeset_ancestor(pcb, *result, step->nsid, step->name,
+                                   step->textmode, step->axis);
+        break;
+    case XP_AX_DESCENDANT:
+    case XP_AX_DESCENDANT_OR_SELF:
+    case XP_AX_CHILD:
+        res = set_nodeset_child(pcb, *result, step->nsid, step->name,
+                                step->textmode, step->axis);
+        break;
+    case XP_AX_FOLLOWING:
+    case XP_AX_PRECEDING:
+    case XP_AX_FOLLOWING_SIBLING:
+    case XP_AX_PRECEDING_SIBLING:
+        res = set_nodeset_pfaxis(pcb, *result, step->nsid, step->name,
+                                 step->textmode, step->axis);
+        break;
+    case XP_AX_PARENT:
+        res = set_nodeset_parent(pcb, *result, step->nsid, step->name);
+        break;
+    case XP_AX_SELF:
+        res = set_nodeset_self(pcb, *result, step->nsid, step->name,
+                               step->textmode);
+        break;
+    default:
+        res = SET_ERROR(ERR_INTERNAL_VAL);
+    }
+
+    if (res == NO_ERR && step->preds) {
+        res = eval_comp_preds(pcb, step->preds, result);
+    }
+    return res;
 
-} /* parse_unary_expr */
+}  /* eval_comp_step */
 
 
 /********************************************************************
-* FUNCTION parse_multiplicative_expr
+* FUNCTION eval_comp_fncall
 * 
-* Parse an XPath MultiplicativeExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [26] MultiplicativeExpr ::= UnaryExpr 
-*              | MultiplicativeExpr MultiplyOperator UnaryExpr
-*              | MultiplicativeExpr 'div' UnaryExpr
-*              | MultiplicativeExpr 'mod' UnaryExpr
+* Evaluate a compiled function call
+* Same result as parse_function_call
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    node == compiled FNCALL node
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   pointer to malloced result struct or NULL if none
 *********************************************************************/
 static xpath_result_t *
-    parse_multiplicative_expr (xpath_pcb_t *pcb,
-                               status_t *res)
+    eval_comp_fncall (xpath_pcb_t *pcb,
+                      const xpath_exnode_t *node,
+                      status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    ncx_num_t        num1, num2;
-    xpath_exop_t     curop;
-    boolean          done;
-    tk_type_t        nexttyp;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    done = FALSE;
+    const xpath_exnode_t  *nodes;
+    xpath_result_t        *val1;
+    dlq_hdr_t              parmQ;
+    uint32                 arg;
+    int32                  parmcnt;
 
-    ncx_init_num(&num1);
-    ncx_init_num(&num2);
-
-    while (!done && *res == NO_ERR) {
-        val1 = parse_unary_expr(pcb, res);
+    nodes = pcb->comp->nodes;
+    parmcnt = 0;
+    dlq_createSQue(&parmQ);
 
+    for (arg = node->left; arg && *res == NO_ERR; arg = nodes[arg].next) {
+        val1 = eval_comp_node(pcb, &nodes[arg], res);
         if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    if (val1->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val1, &num1);
-                    } else {
-                        *res = ncx_copy_num(&val1->r.num,
-                                            &num1, 
-                                            NCX_BT_FLOAT64);
-                    }
-
-                    if (val2->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val2, &num2);
-                    } else {
-                        *res = ncx_copy_num(&val2->r.num,
-                                            &num2, 
-                                            NCX_BT_FLOAT64);
-                    }
-
-                    if (*res == NO_ERR) {
-                        result = new_result(pcb, XP_RT_NUMBER);
-                        if (!result) {
-                            *res = ERR_INTERNAL_MEM;
-                        } else {
-                            switch (curop) {
-                            case XP_EXOP_MULTIPLY:
-                                result->r.num.d = num2.d * num1.d;
-                                break;
-                            case XP_EXOP_DIV:
-                                if (ncx_num_zero(&num2, 
-                                                 NCX_BT_FLOAT64)) {
-                                    ncx_set_num_max(&result->r.num,
-                                                    NCX_BT_FLOAT64);
-                                } else {
-                                    result->r.num.d = num2.d / num1.d;
-                                }
-                                break;
-                            case XP_EXOP_MOD:
-                                result->r.num.d = num2.d / num1.d;
-#ifdef HAS_FLOAT
-                                result->r.num.d = trunc(result->r.num.d);
-#endif
-                                break;
-                            default:
-                                *res = SET_ERROR(ERR_INTERNAL_VAL);
-                            }
-                        }
-                    }
-                }
-
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
-
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
-
-            if (*res != NO_ERR) {
-                continue;
-            }
-
-            nexttyp = tk_next_typ(pcb->tkc);
-            switch (nexttyp) {
-            case TK_TT_STAR:
-                curop = XP_EXOP_MULTIPLY;
-                break;
-            case TK_TT_TSTRING:
-                if (match_next_token(pcb, TK_TT_TSTRING,
-                                     XP_OP_DIV)) {
-                    curop = XP_EXOP_DIV;
-                } else if (match_next_token(pcb, 
-                                            TK_TT_TSTRING,
-                                            XP_OP_MOD)) {
-                    curop = XP_EXOP_MOD;
-                } else {
-                    done = TRUE;
-                }
-                break;
-            default:
-                done = TRUE;
-            }
-            if (!done) {
-                *res = xpath_parse_token(pcb, nexttyp);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
+            parmcnt++;
+            if (val1) {
+                dlq_enque(val1, &parmQ);
             }
+        } else if (val1) {
+            free_result(pcb, val1);
         }
     }
 
-    if (val1) {
-        free_result(pcb, val1);
-    }
-
-    ncx_clean_num(NCX_BT_FLOAT64, &num1);
-    ncx_clean_num(NCX_BT_FLOAT64, &num2);
+    TK_CUR(pcb->tkc) = node->tk;
+    val1 = call_function(pcb, node->fncb, &parmQ, parmcnt, res);
 
-    return val2;
+    while (!dlq_empty(&parmQ)) {
+        free_result(pcb, (xpath_result_t *)dlq_deque(&parmQ));
+    }
+    return val1;
 
-} /* parse_multiplicative_expr */
+}  /* eval_comp_fncall */
 
 
 /********************************************************************
-* FUNCTION parse_additive_expr
+* FUNCTION eval_comp_operand
 * 
-* Parse an XPath AdditiveExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [25] AdditiveExpr ::= MultiplicativeExpr
-*                | AdditiveExpr '+' MultiplicativeExpr
-*                | AdditiveExpr '-' MultiplicativeExpr
+* Evaluate an operand of a compiled BINARY node
+* A cached operand is only evaluated the 1st time;
+* the same result is returned until clear_comp_cache
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    idx == index of the operand node
+*    res == address of result status, NO_ERR on entry
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   pointer to result struct or NULL if none;
+*   release it with free_comp_operand
 *********************************************************************/
 static xpath_result_t *
-    parse_additive_expr (xpath_pcb_t *pcb,
-                           status_t *res)
+    eval_comp_operand (xpath_pcb_t *pcb,
+                       uint32 idx,
+                       status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    ncx_num_t        num1, num2;
-    xpath_exop_t     curop;
-    boolean          done;
-    tk_type_t        nexttyp;
+    const xpath_exnode_t  *node;
+    xpath_compcache_t     *cache;
+    xpath_result_t        *result;
 
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    done = FALSE;
+    node = &pcb->comp->nodes[idx];
+    if (!node->cache) {
+        return eval_comp_node(pcb, node, res);
+    }
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_multiplicative_expr(pcb, res);
+    cache = &pcb->compcache[node->cache - 1];
+    if (cache->result) {
+        return cache->result;
+    }
 
-        if (*res == NO_ERR) {
-            if (val2) {
-                /* val2 holds the 1st operand
-                 * val1 holds the 2nd operand
-                 */
+    result = eval_comp_node(pcb, node, res);
+    if (*res == NO_ERR) {
+        cache->result = result;
+    }
+    return result;
 
-                if (pcb->val || pcb->val) {
-                    if (val1->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val1, &num1);
-                    } else {
-                        *res = ncx_copy_num(&val1->r.num,
-                                            &num1, 
-                                            NCX_BT_FLOAT64);
-                    }
+}  /* eval_comp_operand */
 
-                    if (val2->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val2, &num2);
-                    } else {
-                        *res = ncx_copy_num(&val2->r.num,
-                                            &num2, 
-                                            NCX_BT_FLOAT64);
-                    }
 
-                    if (*res == NO_ERR) {
-                        result = new_result(pcb, XP_RT_NUMBER);
-                        if (!result) {
-                            *res = ERR_INTERNAL_MEM;
-                        } else {
-                            switch (curop) {
-                            case XP_EXOP_ADD:
-                                result->r.num.d = num2.d + num1.d;
-                                break;
-                            case XP_EXOP_SUBTRACT:
-                                result->r.num.d = num2.d - num1.d;
-                                break;
-                            default:
-                                *res = SET_ERROR(ERR_INTERNAL_VAL);
-                            }
-                        }
-                    }
-                }
+/********************************************************************
+* FUNCTION free_comp_operand
+* 
+* Release a result from eval_comp_operand
+* A cached result is kept until clear_comp_cache
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    idx == index of the operand node
+*    result == result to release
+*********************************************************************/
+static void
+    free_comp_operand (xpath_pcb_t *pcb,
+                       uint32 idx,
+                       xpath_result_t *result)
+{
+    const xpath_exnode_t  *node;
 
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
+    node = &pcb->comp->nodes[idx];
+    if (node->cache &&
+        pcb->compcache[node->cache - 1].result == result) {
+        return;
+    }
+    free_result(pcb, result);
 
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
+}  /* free_comp_operand */
 
-            if (*res != NO_ERR) {
-                continue;
-            }
 
-            nexttyp = tk_next_typ(pcb->tkc);
-            switch (nexttyp) {
-            case TK_TT_PLUS:
-                curop = XP_EXOP_ADD;
-                break;
-            case TK_TT_MINUS:
-                curop = XP_EXOP_SUBTRACT;
-                break;
-            default:
-                done = TRUE;
-            }
-            if (!done) {
-                *res = xpath_parse_token(pcb, nexttyp);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
+/********************************************************************
+* FUNCTION take_comp_operand
+* 
+* Take a result from eval_comp_operand out of the cache,
+* so the caller owns it
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    idx == index of the operand node
+*    result == result to take
+*
+* RETURNS:
+*   result
+*********************************************************************/
+static xpath_result_t *
+    take_comp_operand (xpath_pcb_t *pcb,
+                       uint32 idx,
+                       xpath_result_t *result)
+{
+    const xpath_exnode_t  *node;
+    xpath_compcache_t     *cache;
+
+    node = &pcb->comp->nodes[idx];
+    if (node->cache) {
+        cache = &pcb->compcache[node->cache - 1];
+        if (cache->result == result) {
+            cache->result = NULL;
+            if (cache->strset) {
+                free_strset(cache->strset);
+                cache->strset = NULL;
             }
         }
     }
+    return result;
 
-    if (val1) {
-        free_result(pcb, val1);
-    }
+}  /* take_comp_operand */
 
-    ncx_clean_num(NCX_BT_FLOAT64, &num1);
-    ncx_clean_num(NCX_BT_FLOAT64, &num2);
 
-    return val2;
+/********************************************************************
+* FUNCTION clear_comp_cache
+* 
+* Free the cached operand results of the last evaluation
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*********************************************************************/
+static void
+    clear_comp_cache (xpath_pcb_t *pcb)
+{
+    xpath_compcache_t  *cache;
+    uint32              i;
+
+    for (i = 0; i < pcb->comp->cachecnt; i++) {
+        cache = &pcb->compcache[i];
+        if (cache->result) {
+            free_result(pcb, cache->result);
+            cache->result = NULL;
+        }
+        if (cache->strset) {
+            free_strset(cache->strset);
+            cache->strset = NULL;
+        }
+        cache->nostrset = FALSE;
+    }
 
-} /* parse_additive_expr */
+}  /* clear_comp_cache */
 
 
 /********************************************************************
-* FUNCTION parse_relational_expr
+* FUNCTION compare_comp_operands
 * 
-* Parse an XPath RelationalExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [24]  RelationalExpr ::= AdditiveExpr
-*             | RelationalExpr '<' AdditiveExpr
-*             | RelationalExpr '>' AdditiveExpr
-*             | RelationalExpr '<=' AdditiveExpr
-*             | RelationalExpr '>=' AdditiveExpr
+* Apply the operator of a compiled BINARY node
+* Same result as combine_results; a '=' between 2 nodesets
+* where 1 of them is a cached operand hashes the strings
+* of that operand once, and looks up the other nodeset
+* in it each time
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    node == compiled BINARY node
+*    val2 == result of node->left
+*    val1 == result of node->right
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   pointer to malloced result struct or NULL if some error;
+*   the operands are not freed
 *********************************************************************/
 static xpath_result_t *
-    parse_relational_expr (xpath_pcb_t *pcb,
+    compare_comp_operands (xpath_pcb_t *pcb,
+                           const xpath_exnode_t *node,
+                           xpath_result_t *val2,
+                           xpath_result_t *val1,
                            status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    xpath_exop_t     curop;
-    boolean          done, cmpresult;
-    tk_type_t        nexttyp;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    done = FALSE;
-
-    while (!done && *res == NO_ERR) {
-        val1 = parse_additive_expr(pcb, res);
-
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    cmpresult = compare_results(pcb, 
-                                                val2, 
-                                                val1, 
-                                                curop,
-                                                res);
-
-                    if (*res == NO_ERR) {
-                        result = new_result(pcb, XP_RT_BOOLEAN);
-                        if (!result) {
-                            *res = ERR_INTERNAL_MEM;
-                        } else {
-                            result->r.boo = cmpresult;
-                        }
-                    }
-                }
-
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
-
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
-
-            if (*res != NO_ERR) {
-                continue;
-            }
-
-            nexttyp = tk_next_typ(pcb->tkc);
-            switch (nexttyp) {
-            case TK_TT_LT:
-                curop = XP_EXOP_LT;
-                break;
-            case TK_TT_GT:
-                curop = XP_EXOP_GT;
-                break;
-            case TK_TT_LEQUAL:
-                curop = XP_EXOP_LEQUAL;
-                break;
-            case TK_TT_GEQUAL:
-                curop = XP_EXOP_GEQUAL;
-                break;
-            default:
-                done = TRUE;
-            }
-            if (!done) {
-                *res = xpath_parse_token(pcb, nexttyp);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
+    const xpath_exnode_t  *nodes;
+    xpath_compcache_t     *cache;
+    xpath_result_t        *result;
+    boolean                hashval2, boo;
+
+    nodes = pcb->comp->nodes;
+    if (node->exop != XP_EXOP_EQUAL ||
+        val1->restype != XP_RT_NODESET ||
+        val2->restype != XP_RT_NODESET ||
+        (!nodes[node->left].cache && !nodes[node->right].cache)) {
+        return combine_results(pcb, node->exop, val2, val1, res);
+    }
+
+    /* the right operand is the 2nd nodeset in compare_nodesets */
+    hashval2 = (nodes[node->right].cache) ? TRUE : FALSE;
+    cache = &pcb->compcache[(hashval2) ? 
+                            nodes[node->right].cache - 1 : 
+                            nodes[node->left].cache - 1];
+    if (cache->nostrset) {
+        return combine_results(pcb, node->exop, val2, val1, res);
+    }
+
+    if (!cache->strset) {
+        cache->strset = new_strset();
+        if (cache->strset) {
+            (void)walk_strset(pcb, 
+                              (hashval2) ? val1 : val2,
+                              cache->strset,
+                              hashval2,
+                              FALSE,
+                              res);
+        } else {
+            *res = ERR_INTERNAL_MEM;
+        }
+        if (*res != NO_ERR) {
+            /* the pairwise compare reports the error */
+            if (cache->strset) {
+                free_strset(cache->strset);
+                cache->strset = NULL;
             }
+            cache->nostrset = TRUE;
+            *res = NO_ERR;
+            return combine_results(pcb, node->exop, val2, val1, res);
         }
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+    boo = hash_compare_nodesets(pcb, val2, val1, cache->strset, 
+                                hashval2, res);
+    if (*res != NO_ERR) {
+        *res = NO_ERR;
+        return combine_results(pcb, node->exop, val2, val1, res);
     }
 
-    return val2;
+    result = new_result(pcb, XP_RT_BOOLEAN);
+    if (!result) {
+        *res = ERR_INTERNAL_MEM;
+    } else {
+        result->r.boo = boo;
+    }
+    return result;
 
-}  /* parse_relational_expr */
+}  /* compare_comp_operands */
 
 
 /********************************************************************
-* FUNCTION parse_equality_expr
+* FUNCTION eval_comp_node
 * 
-* Parse an XPath EqualityExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [23] EqualityExpr  ::=   RelationalExpr        
-*                | EqualityExpr '=' RelationalExpr        
-*                | EqualityExpr '!=' RelationalExpr        
+* Evaluate one node of a compiled expression
+* Same result as the parse_* function for the same tokens
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*           with pcb->comp and pcb->val set
+*    node == compiled node to evaluate
+*    res == address of result status, NO_ERR on entry
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   pointer to malloced result struct or NULL if none
 *********************************************************************/
 static xpath_result_t *
-    parse_equality_expr (xpath_pcb_t *pcb,
-                         status_t *res)
+    eval_comp_node (xpath_pcb_t *pcb,
+                    const xpath_exnode_t *node,
+                    status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    xpath_exop_t     curop;
-    boolean          done, cmpresult, equalsdone;
+    const xpath_exnode_t  *nodes;
+    xpath_result_t        *val1, *val2, *result;
+    uint32                 idx;
 
+    nodes = pcb->comp->nodes;
     val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    equalsdone = FALSE;
-    done = FALSE;
-
-    while (!done && *res == NO_ERR) {
-        val1 = parse_relational_expr(pcb, res);
 
-        if (*res == NO_ERR) {
+    switch (node->kind) {
+    case XP_EXK_BINARY:
+        /* on error the 1st operand is returned, like the
+         * parse_*_expr loops do; only comparisons have
+         * cached operands and their results are booleans
+         */
+        val2 = eval_comp_operand(pcb, node->left, res);
+        if (*res != NO_ERR) {
             if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        *res = check_instanceid_expr(pcb, 
-                                                     val2, 
-                                                     val1);
-                    }
-
-                    if (*res == NO_ERR) {
-                        cmpresult = compare_results(pcb, 
-                                                    val2, 
-                                                    val1, 
-                                                    curop,
-                                                    res);
-
-                        if (*res == NO_ERR) {
-                            result = new_result(pcb, XP_RT_BOOLEAN);
-                            if (!result) {
-                                *res = ERR_INTERNAL_MEM;
-                            } else {
-                                result->r.boo = cmpresult;
-                            }
-                        }
-                    }
-                }
-
+                free_comp_operand(pcb, node->left, val2);
+            }
+            return NULL;
+        }
+        val1 = eval_comp_operand(pcb, node->right, res);
+        if (*res != NO_ERR) {
+            if (val1) {
+                free_comp_operand(pcb, node->right, val1);
+            }
+            return (val2) ? take_comp_operand(pcb, node->left, val2) : NULL;
+        }
+        if (!val2) {
+            return (val1) ? take_comp_operand(pcb, node->right, val1) : NULL;
+        }
+        if (!val1) {
+            /* the interpreter cannot get here */
+            free_comp_operand(pcb, node->left, val2);
+            *res = SET_ERROR(ERR_INTERNAL_VAL);
+            return NULL;
+        }
+        TK_CUR(pcb->tkc) = node->tk;
+        result = compare_comp_operands(pcb, node, val2, val1, res);
+        free_comp_operand(pcb, node->right, val1);
+        free_comp_operand(pcb, node->left, val2);
+        return result;
+    case XP_EXK_NEGATE:
+        val1 = eval_comp_node(pcb, &nodes[node->left], res);
+        if (*res != NO_ERR || !val1) {
+            return val1;
+        }
+        if (val1->restype == XP_RT_NUMBER) {
+            val1->r.num.d *= -1;
+            return val1;
+        }
+        result = new_result(pcb, XP_RT_NUMBER);
+        if (result) {
+            xpath_cvt_number(val1, &result->r.num);
+            result->r.num.d *= -1;
+        } else {
+            *res = ERR_INTERNAL_MEM;
+        }
+        free_result(pcb, val1);
+        return result;
+    case XP_EXK_UNION:
+        val2 = eval_comp_node(pcb, &nodes[node->left], res);
+        if (*res != NO_ERR) {
+            if (val2) {
+                free_result(pcb, val2);
+            }
+            return NULL;
+        }
+        val1 = eval_comp_node(pcb, &nodes[node->right], res);
+        if (*res != NO_ERR) {
+            if (val1) {
+                free_result(pcb, val1);
+            }
+            return val2;
+        }
+        if (!val2) {
+            return val1;
+        }
+        if (val1) {
+            merge_nodeset(pcb, val1, val2);
+            free_result(pcb, val1);
+        }
+        return val2;
+    case XP_EXK_PATH:
+        if (node->left) {
+            val1 = eval_comp_node(pcb, &nodes[node->left], res);
+            if (*res != NO_ERR) {
                 if (val1) {
                     free_result(pcb, val1);
-                    val1 = NULL;
                 }
-
+                return NULL;
+            }
+        }
+        for (idx = node->right; idx && *res == NO_ERR; idx = nodes[idx].next) {
+            *res = eval_comp_step(pcb, &nodes[idx], &val1);
+        }
+        return val1;
+    case XP_EXK_FILTER:
+        val1 = eval_comp_node(pcb, &nodes[node->left], res);
+        if (*res == NO_ERR) {
+            if (val1) {
+                *res = eval_comp_preds(pcb, node->preds, &val1);
+            } else {
+                val2 = new_result(pcb, XP_RT_NODESET);
                 if (val2) {
+                    *res = eval_comp_preds(pcb, node->preds, &val2);
                     free_result(pcb, val2);
-                    val2 = NULL;
-                }
-
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
-
-            if (*res != NO_ERR) {
-                continue;
-            }
-
-            if (match_next_token(pcb, TK_TT_EQUAL, NULL)) {
-                *res = xpath_parse_token(pcb, TK_TT_EQUAL);
-                if (*res == NO_ERR) {
-                    if (equalsdone) {
-                        if (pcb->flags & XP_FL_INSTANCEID) {
-                            invalid_instanceid_error(pcb);
-                            *res = ERR_NCX_INVALID_INSTANCEID;
-                        }
-                    } else {
-                        equalsdone = TRUE;
-                    }
-                }
-                curop = XP_EXOP_EQUAL;
-            } else if (match_next_token(pcb, TK_TT_NOTEQUAL, NULL)) {
-                *res = xpath_parse_token(pcb, TK_TT_NOTEQUAL);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
+                } else {
+                    *res = ERR_INTERNAL_MEM;
                 }
-                curop = XP_EXOP_NOTEQUAL;
-            } else {
-                done = TRUE;
             }
         }
+        break;
+    case XP_EXK_NUMBER:
+        val1 = new_result(pcb, XP_RT_NUMBER);
+        if (!val1) {
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+        val1->r.num.d = node->num.d;
+        return val1;
+    case XP_EXK_LITERAL:
+        val1 = new_result(pcb, XP_RT_STRING);
+        if (!val1) {
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+        val1->r.str = xml_strdup((node->name) ? node->name : EMPTY_STRING);
+        if (!val1->r.str) {
+            *res = ERR_INTERNAL_MEM;
+            malloc_failed_error(pcb);
+            xpath_free_result(val1);
+            return NULL;
+        }
+        return val1;
+    case XP_EXK_VARBIND:
+        TK_CUR(pcb->tkc) = node->tk;
+        val1 = get_varbind_result(pcb, node->tk, res);
+        break;
+    case XP_EXK_FNCALL:
+        val1 = eval_comp_fncall(pcb, node, res);
+        break;
+    case XP_EXK_STEP:
+    case XP_EXK_NONE:
+    default:
+        *res = SET_ERROR(ERR_INTERNAL_VAL);
+        return NULL;
     }
 
-    if (val1) {
+    /* a failed FilterExpr has no result, see parse_path_expr */
+    if (*res != NO_ERR && val1) {
         free_result(pcb, val1);
+        val1 = NULL;
     }
+    return val1;
 
-    return val2;
-
-}  /* parse_equality_expr */
+}  /* eval_comp_node */
 
 
 /********************************************************************
-* FUNCTION parse_and_expr
+* FUNCTION build_comp
 * 
-* Parse an XPath AndExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* Compile the token chain of a pcb
 *
-* [22] AndExpr  ::= EqualityExpr
-*                   | AndExpr 'and' EqualityExpr
+* The prefixes of QName node tests must have been resolved
+* by an interpreted evaluation first; they are cached in
+* the tokens
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    res == address of result status
+*    pcb == parser control block to compile
+*    res == address of return status
 *
 * OUTPUTS:
-*   *res == function result status
+*   *res == ERR_NCX_OPERATION_NOT_SUPPORTED if the expression
+*           uses constructs the compiled form does not support
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced compiled expression or NULL if not built
 *********************************************************************/
-static xpath_result_t *
-    parse_and_expr (xpath_pcb_t *pcb,
-                    status_t *res)
+static xpath_comp_t *
+    build_comp (xpath_pcb_t *pcb,
+                status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    boolean          done, bool1, bool2;
+    xpath_comp_t  *comp;
 
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    done = FALSE;
+    comp = m__getObj(xpath_comp_t);
+    if (!comp) {
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+    memset(comp, 0x0, sizeof(xpath_comp_t));
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_equality_expr(pcb, res);
+    /* node 0 means 'none' */
+    *res = NO_ERR;
+    (void)new_comp_node(comp, XP_EXK_NONE, res);
 
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    bool1 = xpath_cvt_boolean(val1);
-                    bool2 = xpath_cvt_boolean(val2);
+    tk_reset_chain(pcb->tkc);
+    if (*res == NO_ERR) {
+        comp->top = compile_expr(pcb, comp, res);
+    }
+    if (*res == NO_ERR && tk_next_typ(pcb->tkc) != TK_TT_NONE) {
+        /* extra tokens are reported by the interpreter */
+        *res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+    tk_reset_chain(pcb->tkc);
 
-                    result = new_result(pcb, XP_RT_BOOLEAN);
-                    if (!result) {
-                        *res = ERR_INTERNAL_MEM;
-                    } else {
-                        result->r.boo = (bool1 && bool2) 
-                            ? TRUE : FALSE;
-                    }
-                }
+    if (*res != NO_ERR) {
+        xpath_free_comp(comp);
+        return NULL;
+    }
+    return comp;
 
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
+}  /* build_comp */
 
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
 
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
+/********************************************************************
+* FUNCTION share_comp_prefixes
+* 
+* Copy the prefixes resolved by an interpreted evaluation
+* of a leafref clone to the tokens of the typdef pcb,
+* so the tree shared by all the clones can be built from them
+*
+* INPUTS:
+*    pcb == leafref clone after an interpreted evaluation
+*********************************************************************/
+static void
+    share_comp_prefixes (xpath_pcb_t *pcb)
+{
+    tk_token_t  *tk, *owntk;
 
-            if (*res != NO_ERR) {
-                continue;
-            }
+    if (!pcb->comppcb || pcb->comppcb->comp ||
+        !pcb->tkc || !pcb->comppcb->tkc) {
+        return;
+    }
 
-            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_AND)) {
-                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
-            } else {
-                done = TRUE;
-            }
+    /* the chains are clones of the same expression */
+    tk = (tk_token_t *)dlq_firstEntry(&pcb->tkc->tkQ);
+    owntk = (tk_token_t *)dlq_firstEntry(&pcb->comppcb->tkc->tkQ);
+    while (tk && owntk) {
+        if (!owntk->nsid) {
+            owntk->nsid = tk->nsid;
         }
+        tk = (tk_token_t *)dlq_nextEntry(tk);
+        owntk = (tk_token_t *)dlq_nextEntry(owntk);
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+}  /* share_comp_prefixes */
+
+
+/********************************************************************
+* FUNCTION compile_pcb_expr
+* 
+* Set pcb->comp, if the expression has been evaluated
+* often enough and only uses constructs the compiled form
+* supports
+*
+* A leafref clone uses the tree built once on the typdef
+* pcb it was cloned from; the tree is not changed by an
+* evaluation, so all the clones share it
+*
+* INPUTS:
+*    pcb == parser control block to compile,
+*           with pcb->val set for a value tree evaluation
+*
+* RETURNS:
+*   TRUE if pcb->comp can be used
+*   FALSE if the token chain has to be interpreted
+*********************************************************************/
+static boolean
+    compile_pcb_expr (xpath_pcb_t *pcb)
+{
+    xpath_pcb_t   *ownpcb;
+    status_t       res;
+
+    if (pcb->comp) {
+        return TRUE;
+    }
+    if (pcb->source == XP_SRC_INSTANCEID ||
+        (pcb->flags & (XP_FL_INSTANCEID | XP_FL_SCHEMA_INSTANCEID |
+                       XP_FL_NOCOMPILE))) {
+        return FALSE;
     }
 
-    return val2;
+    /* the evaluations of all the clones are counted
+     * in the typdef pcb
+     */
+    ownpcb = (pcb->comppcb) ? pcb->comppcb : pcb;
+    if (!ownpcb->comp) {
+        if (!ownpcb->tkc || (ownpcb->flags & XP_FL_NOCOMPILE)) {
+            pcb->flags |= XP_FL_NOCOMPILE;
+            return FALSE;
+        }
+        if (++ownpcb->evalcount < XPATH_COMPILE_MIN_EVALS) {
+            return FALSE;
+        }
 
-}  /* parse_and_expr */
+        ownpcb->comp = build_comp(ownpcb, &res);
+        if (!ownpcb->comp) {
+            if (res == ERR_NCX_OPERATION_NOT_SUPPORTED) {
+                ownpcb->flags |= XP_FL_NOCOMPILE;
+                pcb->flags |= XP_FL_NOCOMPILE;
+            }
+            return FALSE;
+        }
+    }
+
+    pcb->comp = ownpcb->comp;
+    return TRUE;
+
+}  /* compile_pcb_expr */
 
 
 /********************************************************************
-* FUNCTION parse_or_expr
+* FUNCTION eval_comp_expr
 * 
-* Parse an XPath OrExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [21] OrExpr ::= AndExpr        
-*                 | OrExpr 'or' AndExpr
+* Evaluate the compiled form of the expression
+* Same result as parse_expr in value mode
 *
 * INPUTS:
-*    pcb == parser control block in progress
+*    pcb == parser control block in progress,
+*           with pcb->comp and pcb->val set
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   pointer to malloced result struct or NULL if none
 *********************************************************************/
 static xpath_result_t *
-    parse_or_expr (xpath_pcb_t *pcb,
-                   status_t *res)
+    eval_comp_expr (xpath_pcb_t *pcb,
+                    status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    boolean          done, bool1, bool2;
+    xpath_compcache_t   cachebuf[XPATH_COMPCACHE_LOCAL];
+    xpath_compcache_t  *savecache;
+    xpath_result_t     *result;
+    uint32              cachecnt;
 
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    done = FALSE;
+    /* the cached operands belong to this evaluation,
+     * not to the tree, which may be shared
+     */
+    cachecnt = pcb->comp->cachecnt;
+    savecache = pcb->compcache;
+    if (cachecnt > XPATH_COMPCACHE_LOCAL) {
+        pcb->compcache = (xpath_compcache_t *)
+            m__getMem(cachecnt * sizeof(xpath_compcache_t));
+        if (!pcb->compcache) {
+            pcb->compcache = savecache;
+            *res = ERR_INTERNAL_MEM;
+            malloc_failed_error(pcb);
+            return NULL;
+        }
+    } else {
+        pcb->compcache = cachebuf;
+    }
+    memset(pcb->compcache, 0x0, cachecnt * sizeof(xpath_compcache_t));
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_and_expr(pcb, res);
+    result = eval_comp_node(pcb, &pcb->comp->nodes[pcb->comp->top], res);
+    clear_comp_cache(pcb);
 
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    bool1 = xpath_cvt_boolean(val1);
-                    bool2 = xpath_cvt_boolean(val2);
+    if (pcb->compcache != cachebuf) {
+        m__free(pcb->compcache);
+    }
+    pcb->compcache = savecache;
 
-                    result = new_result(pcb, XP_RT_BOOLEAN);
-                    if (!result) {
-                        *res = ERR_INTERNAL_MEM;
-                    } else {
-                        result->r.boo = (bool1 || bool2) 
-                            ? TRUE : FALSE;
-                    }
-                }
-                    
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
+    /* leave the chain where the interpreter would:
+     * the compiled form has no extra tokens
+     */
+    TK_CUR(pcb->tkc) = (tk_token_t *)dlq_lastEntry(&pcb->tkc->tkQ);
+    return result;
 
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
+}  /* eval_comp_expr */
 
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
 
-            if (*res != NO_ERR) {
-                continue;
-            }
+/********************************************************************
+* FUNCTION get_context_objnode
+* 
+* Get the correct context node according to YANG rules
+*
+* INPUTS:
+*   obj == object to check
+*
+* RETURNS:
+*   pointer to context object to use (probably obj)
+*********************************************************************/
+static obj_template_t *
+    get_context_objnode (obj_template_t *obj)
+{
+    boolean done;
 
-            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_OR)) {
-                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+    /* get the correct context node to use */
+    done = FALSE;
+    while (!done) {
+        if (obj->objtype == OBJ_TYP_CHOICE ||
+            obj->objtype == OBJ_TYP_CASE ||
+            obj->objtype == OBJ_TYP_USES) {
+            if (obj->parent) {
+                obj = obj->parent;
             } else {
-                done = TRUE;
+                SET_ERROR(ERR_INTERNAL_VAL);
+                return obj;
             }
+        } else {
+            done = TRUE;
         }
     }
+    return obj;
 
-    if (val1) {
-        free_result(pcb, val1);
-    }
-
-    return val2;
-
-}  /* parse_or_expr */
+}  /* get_context_objnode */
 
 
 /********************************************************************
-* FUNCTION parse_expr
+* FUNCTION validate_expr
 * 
-* Parse an XPath Expr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [14] Expr ::= OrExpr
+* Validate the previously parsed expression string
+* against the cooked object tree
+* See xpath1_validate_expr_ex for details
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    res == address of result status
-*
+*    mod == module containing the 'obj' (in progress)
+*    obj == object containing the XPath clause
+*    pcb == the XPath parser control block to process
+*    missing_is_error == TRUE if a missing node is an error
+*                     == FALSE if a warning
+*    logerrors == TRUE to log errors and warnings
+*              == FALSE to only return the status
 * OUTPUTS:
-*   *res == function result status
+*   pcb->obj and pcb->objmod are set
+*   pcb->validateres is set
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_expr (xpath_pcb_t *pcb,
-                status_t  *res)
+static status_t
+    validate_expr (ncx_module_t *mod,
+                   obj_template_t *obj,
+                   xpath_pcb_t *pcb,
+                   boolean missing_is_error,
+                   boolean logerrors)
 {
+    xpath_result_t       *result;
+    obj_template_t       *rootobj;
+    boolean               rootdone;
+ 
+    pcb->objmod = mod;
+    pcb->obj = obj;
+    pcb->logerrors = logerrors;
+    pcb->val = NULL;
+    pcb->val_docroot = NULL;
+
+    /* this is not used yet; a missing child node is always
+     * a warning at this time
+     */
+    pcb->missing_errors = missing_is_error;
+
+    if (pcb->source == XP_SRC_YANG && obj_is_config(obj)) {
+        pcb->flags |= XP_FL_CONFIGONLY;
+    }
 
-    return parse_or_expr(pcb, res);
+    if (pcb->parseres != NO_ERR) {
+        /* errors already reported, skip this one */
+        return NO_ERR;
+    }
 
-}  /* parse_expr */
+    if (pcb->tkc) {
+        tk_reset_chain(pcb->tkc);
+    } else {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
 
+    pcb->context.node.objptr = get_context_objnode(obj);
+    pcb->orig_context.node.objptr = pcb->context.node.objptr;
 
-/********************************************************************
-* FUNCTION get_context_objnode
-* 
-* Get the correct context node according to YANG rules
-*
-* INPUTS:
-*   obj == object to check
-*
-* RETURNS:
-*   pointer to context object to use (probably obj)
-*********************************************************************/
-static obj_template_t *
-    get_context_objnode (obj_template_t *obj)
-{
-    boolean done;
+    rootdone = FALSE;
+    if (obj_is_root(obj) || 
+        obj_is_data_db(obj) ||
+        obj_is_cli(obj)) {
+        rootdone = TRUE;
+        pcb->doctype = XP_DOC_DATABASE;
+        pcb->docroot = ncx_get_gen_root();
+        if (!pcb->docroot) {
+            return SET_ERROR(ERR_INTERNAL_VAL);
+        }
+    } else if (obj_in_notif(obj)) {
+        pcb->doctype = XP_DOC_NOTIFICATION;
+    } else if (obj_in_rpc(obj)) {
+        pcb->doctype = XP_DOC_RPC;
+    } else if (obj_in_rpc_reply(obj)) {
+        pcb->doctype = XP_DOC_RPC_REPLY;
+    } else {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
 
-    /* get the correct context node to use */
-    done = FALSE;
-    while (!done) {
-        if (obj->objtype == OBJ_TYP_CHOICE ||
-            obj->objtype == OBJ_TYP_CASE ||
-            obj->objtype == OBJ_TYP_USES) {
-            if (obj->parent) {
-                obj = obj->parent;
-            } else {
-                SET_ERROR(ERR_INTERNAL_VAL);
-                return obj;
-            }
-        } else {
-            done = TRUE;
+    if (!rootdone) {
+        /* get the rpc/input, rpc/output, or /notif node */
+        rootobj = obj;
+        while (rootobj->parent && !obj_is_root(rootobj->parent) &&
+               rootobj->objtype != OBJ_TYP_RPCIO) {
+            rootobj = rootobj->parent;
         }
+        pcb->docroot = rootobj;
     }
-    return obj;
 
-}  /* get_context_objnode */
+    /* validate the XPath expression against the 
+     * full cooked object tree
+     */
+    if (pcb->source == XP_SRC_INSTANCEID) {
+        result = parse_location_path(pcb, NULL, &pcb->validateres);
+    } else {
+        result = parse_expr(pcb, &pcb->validateres);
+    }
+
+    if (result) {
+        if (LOGDEBUG3) {
+            dump_result(pcb, result, "validate_expr");
+        }
+
+        free_result(pcb, result);
+    }
+
+    return pcb->validateres;
+
+}  /* validate_expr */
 
 
 /************    E X T E R N A L   F U N C T I O N S    ************/
@@ -8696,6 +12604,15 @@ status_t
         linepos = 1;
     }
 
+    if (pcb->comp) {
+        if (!pcb->comppcb) {
+            xpath_free_comp(pcb->comp);
+        }
+        pcb->comp = NULL;
+    }
+    pcb->comppcb = NULL;
+    pcb->evalcount = 0;
+
     if (pcb->tkc) {
         tk_reset_chain(pcb->tkc);
     } else {
@@ -8830,10 +12747,6 @@ status_t
                              xpath_pcb_t *pcb,
                              boolean missing_is_error)
 {
-    xpath_result_t       *result;
-    obj_template_t       *rootobj;
-    boolean               rootdone;
- 
 #ifdef DEBUG
     if (!mod || !obj || !pcb) {
         return SET_ERROR(ERR_INTERNAL_PTR);
@@ -8843,83 +12756,7 @@ status_t
     }
 #endif
 
-    pcb->objmod = mod;
-    pcb->obj = obj;
-    pcb->logerrors = TRUE;
-    pcb->val = NULL;
-    pcb->val_docroot = NULL;
-
-    /* this is not used yet; a missing child node is always
-     * a warning at this time
-     */
-    pcb->missing_errors = missing_is_error;
-
-    if (pcb->source == XP_SRC_YANG && obj_is_config(obj)) {
-        pcb->flags |= XP_FL_CONFIGONLY;
-    }
-
-    if (pcb->parseres != NO_ERR) {
-        /* errors already reported, skip this one */
-        return NO_ERR;
-    }
-
-    if (pcb->tkc) {
-        tk_reset_chain(pcb->tkc);
-    } else {
-        return SET_ERROR(ERR_INTERNAL_VAL);
-    }
-
-    pcb->context.node.objptr = get_context_objnode(obj);
-    pcb->orig_context.node.objptr = pcb->context.node.objptr;
-
-    rootdone = FALSE;
-    if (obj_is_root(obj) || 
-        obj_is_data_db(obj) ||
-        obj_is_cli(obj)) {
-        rootdone = TRUE;
-        pcb->doctype = XP_DOC_DATABASE;
-        pcb->docroot = ncx_get_gen_root();
-        if (!pcb->docroot) {
-            return SET_ERROR(ERR_INTERNAL_VAL);
-        }
-    } else if (obj_in_notif(obj)) {
-        pcb->doctype = XP_DOC_NOTIFICATION;
-    } else if (obj_in_rpc(obj)) {
-        pcb->doctype = XP_DOC_RPC;
-    } else if (obj_in_rpc_reply(obj)) {
-        pcb->doctype = XP_DOC_RPC_REPLY;
-    } else {
-        return SET_ERROR(ERR_INTERNAL_VAL);
-    }
-
-    if (!rootdone) {
-        /* get the rpc/input, rpc/output, or /notif node */
-        rootobj = obj;
-        while (rootobj->parent && !obj_is_root(rootobj->parent) &&
-               rootobj->objtype != OBJ_TYP_RPCIO) {
-            rootobj = rootobj->parent;
-        }
-        pcb->docroot = rootobj;
-    }
-
-    /* validate the XPath expression against the 
-     * full cooked object tree
-     */
-    if (pcb->source == XP_SRC_INSTANCEID) {
-        result = parse_location_path(pcb, NULL, &pcb->validateres);
-    } else {
-        result = parse_expr(pcb, &pcb->validateres);
-    }
-
-    if (result) {
-        if (LOGDEBUG3) {
-            dump_result(pcb, result, "validate_expr");
-        }
-
-        free_result(pcb, result);
-    }
-
-    return pcb->validateres;
+    return validate_expr(mod, obj, pcb, missing_is_error, TRUE);
 
 }  /* xpath1_validate_expr_ex */
 
@@ -8964,6 +12801,91 @@ status_t
 }
 
 
+/********************************************************************
+* FUNCTION xpath1_get_obj_deps
+* 
+* Get the schema nodes that a must or when expression can read
+*
+* The expression is walked again against the cooked object
+* tree, the same way xpath1_validate_expr did, and every object
+* selected by a location step (including the steps inside
+* predicates and function arguments) is added to depQ once.
+* The document root is not added.
+*
+* A data node can only change the result of the expression if
+* the node, one of its ancestors, or one of its descendants
+* is in the depQ, or if the context node itself changed.
+* An object that is only used as an inner step of a location
+* path is marked 'pathonly'; only creating or deleting one of
+* its instances can change the result.
+*
+* INPUTS:
+*    pcb == YANG XPath parser control block that has
+*           already been validated by xpath1_validate_expr
+*    depQ == Q of xpath_objdep_t to add the objects to
+*    islocal == address of return local flag
+*
+* OUTPUTS:
+*   xpath_objdep_t structs added to depQ; the caller must
+*   free them with xpath_clean_objdepQ
+*   *islocal == TRUE if every location path in the expression
+*      starts at the context node and only uses the self, child,
+*      descendant and attribute axes, so the result only depends
+*      on the context node subtree
+*
+* RETURNS:
+*   status; ERR_NCX_SKIPPED if the nodes read by the 
+*   expression cannot be found from the object tree
+*********************************************************************/
+status_t
+    xpath1_get_obj_deps (xpath_pcb_t *pcb,
+                         dlq_hdr_t *depQ,
+                         boolean *islocal)
+{
+    status_t    res, validateres;
+    uint32      flags;
+    boolean     logerrors;
+
+#ifdef DEBUG
+    if (!pcb || !depQ || !islocal) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    *islocal = FALSE;
+    if (pcb->source != XP_SRC_YANG || !pcb->tkc || 
+        !pcb->obj || !pcb->objmod ||
+        pcb->parseres != NO_ERR || pcb->validateres != NO_ERR ||
+        !dlq_empty(&pcb->varbindQ) || pcb->getvar_fn) {
+        return ERR_NCX_SKIPPED;
+    }
+
+    /* the expression may have been evaluated against a
+     * data tree already; put back the fields it uses
+     */
+    validateres = pcb->validateres;
+    logerrors = pcb->logerrors;
+    flags = pcb->flags;
+    pcb->flags &= ~XP_FL_USEROOT;
+
+    pcb->depQ = depQ;
+    pcb->depnonlocal = FALSE;
+    res = validate_expr(pcb->objmod, pcb->obj, pcb, FALSE, FALSE);
+    pcb->depQ = NULL;
+    *islocal = !pcb->depnonlocal;
+
+    pcb->validateres = validateres;
+    pcb->logerrors = logerrors;
+    pcb->flags = flags;
+
+    if (res != NO_ERR && res != ERR_INTERNAL_MEM) {
+        res = ERR_NCX_SKIPPED;
+    }
+    return res;
+
+}  /* xpath1_get_obj_deps */
+
+
 /********************************************************************
 * FUNCTION xpath1_eval_expr
 * 
@@ -9055,8 +12977,15 @@ xpath_result_t *
 
     if (pcb->source == XP_SRC_INSTANCEID) {
         result = parse_location_path(pcb, NULL, &pcb->valueres);
+    } else if (compile_pcb_expr(pcb)) {
+        /* same as parse_expr: nothing is done after an error */
+        result = NULL;
+        if (pcb->valueres == NO_ERR) {
+            result = eval_comp_expr(pcb, &pcb->valueres);
+        }
     } else {
         result = parse_expr(pcb, &pcb->valueres);
+        share_comp_prefixes(pcb);
     }
 
     if (pcb->valueres != NO_ERR) {
@@ -9122,6 +13051,7 @@ xpath_result_t *
 {
     xpath_result_t *result;
     status_t        myres;
+    boolean         compiled;
 
 #ifdef DEBUG
     if (!pcb || !res) {
@@ -9186,9 +13116,16 @@ xpath_result_t *
 
     pcb->flags |= XP_FL_USEROOT;
 
-    result = parse_expr(pcb, &pcb->valueres);
+    /* the compiled form has no extra tokens */
+    compiled = (val && compile_pcb_expr(pcb)) ? TRUE : FALSE;
+    if (compiled) {
+        result = eval_comp_expr(pcb, &pcb->valueres);
+    } else {
+        result = parse_expr(pcb, &pcb->valueres);
+        share_comp_prefixes(pcb);
+    }
 
-    if (pcb->valueres == NO_ERR && pcb->tkc->cur) {
+    if (pcb->valueres == NO_ERR && !compiled && pcb->tkc->cur) {
         myres = TK_ADV(pcb->tkc);
         if (myres == NO_ERR) {
             pcb->valueres = ERR_NCX_INVALID_XPATH_EXPR;     
@@ -9254,6 +13191,7 @@ void
                           xpath_result_t *result)
 {
     xpath_resnode_t        *resnode, *nextnode;
+    xpath_nodeidx_t         nodeidx;
 
 #ifdef DEBUG
     if (!result) {
@@ -9274,6 +13212,10 @@ void
         return;
     }
 
+    init_nodeidx(&nodeidx, 
+                 &result->r.nodeQ, 
+                 (uint32)dlq_count(&result->r.nodeQ));
+
     /* the resnodes need to be deleted or moved to a tempQ
      * to correctly track duplicates and remove them
      */
@@ -9285,10 +13227,11 @@ void
         nextnode = (xpath_resnode_t *)dlq_nextEntry(resnode);
 
         dlq_remove(resnode);
+        if (nodeidx.buckets) {
+            remove_nodeidx(pcb, &nodeidx, resnode);
+        }
 
-        if (xpath1_check_node_exists(pcb, 
-                                     &result->r.nodeQ,
-                                     resnode->node.valptr)) {
+        if (check_node_exists(pcb, &nodeidx, resnode->node.valptr)) {
             log_debug2("\nxpath1: prune node '%s:%s'",
                        val_get_mod_name(resnode->node.valptr),
                        resnode->node.valptr->name);
@@ -9299,12 +13242,49 @@ void
             } else {
                 dlq_enque(resnode, &result->r.nodeQ);
             }
+            if (nodeidx.buckets) {
+                insert_nodeidx(pcb, &nodeidx, resnode);
+            }
         }
     }
 
+    clean_nodeidx(&nodeidx);
+
 }  /* xpath1_prune_nodeset */
 
 
+/********************************************************************
+* FUNCTION xpath1_sort_nodeset
+* 
+* Sort a value node result nodeset into document order
+*
+* INPUTS:
+*    result == XPath result nodeset to sort
+*
+* OUTPUTS:
+*    result->nodeQ contents reordered
+*
+* RETURNS:
+*    status; the nodes are not moved if an error is returned
+*********************************************************************/
+status_t
+    xpath1_sort_nodeset (xpath_result_t *result)
+{
+#ifdef DEBUG
+    if (!result) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    if (result->restype != XP_RT_NODESET || !result->isval) {
+        return ERR_NCX_WRONG_TYPE;
+    }
+
+    return sort_nodeset_docorder(result);
+
+}  /* xpath1_sort_nodeset */
+
+
 /********************************************************************
 * FUNCTION xpath1_check_node_exists
 * 
@@ -9330,6 +13310,8 @@ boolean
                               dlq_hdr_t *resultQ,
                               const val_value_t *val)
 {
+    xpath_nodeidx_t   nodeidx;
+
 #ifdef DEBUG
     if (!pcb || !resultQ || !val) {
         SET_ERROR(ERR_INTERNAL_PTR);
@@ -9337,32 +13319,9 @@ boolean
     }
 #endif
 
-    /* quick test -- see if docroot is already in the Q
-     * which means nothing else is needed
-     */
-    if (find_resnode(pcb, 
-                     resultQ,
-                     pcb->val_docroot)) {
-        return TRUE;
-    }
-
-    /* no docroot in the Q so check the node itself */
-    if (val == pcb->val_docroot) {
-        return FALSE;
-    }
-        
-    while (val) {
-        if (find_resnode(pcb, resultQ, val)) {
-            return TRUE;
-        }
-
-        if (val->parent && !obj_is_root(val->parent->obj)) {
-            val = val->parent;
-        } else {
-            return FALSE;
-        }
-    }
-    return FALSE;
+    /* a one-time check is just a Q scan */
+    init_nodeidx(&nodeidx, resultQ, 0);
+    return check_node_exists(pcb, &nodeidx, val);
 
 }  /* xpath1_check_node_exists */
 
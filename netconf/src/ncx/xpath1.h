@@ -169,6 +169,48 @@ extern status_t
 			  xpath_pcb_t *pcb);
 
 
+/********************************************************************
+* FUNCTION xpath1_get_obj_deps
+* 
+* Get the schema nodes that a must or when expression can read
+*
+* The expression is walked again against the cooked object
+* tree, the same way xpath1_validate_expr did, and every object
+* selected by a location step (including the steps inside
+* predicates and function arguments) is added to depQ once.
+* The document root is not added.
+*
+* A data node can only change the result of the expression if
+* the node, one of its ancestors, or one of its descendants
+* is in the depQ, or if the context node itself changed.
+* An object that is only used as an inner step of a location
+* path is marked 'pathonly'; only creating or deleting one of
+* its instances can change the result.
+*
+* INPUTS:
+*    pcb == YANG XPath parser control block that has
+*           already been validated by xpath1_validate_expr
+*    depQ == Q of xpath_objdep_t to add the objects to
+*    islocal == address of return local flag
+*
+* OUTPUTS:
+*   xpath_objdep_t structs added to depQ; the caller must
+*   free them with xpath_clean_objdepQ
+*   *islocal == TRUE if every location path in the expression
+*      starts at the context node and only uses the self, child,
+*      descendant and attribute axes, so the result only depends
+*      on the context node subtree
+*
+* RETURNS:
+*   status; ERR_NCX_SKIPPED if the nodes read by the 
+*   expression cannot be found from the object tree
+*********************************************************************/
+extern status_t
+    xpath1_get_obj_deps (xpath_pcb_t *pcb,
+			 dlq_hdr_t *depQ,
+			 boolean *islocal);
+
+
 /********************************************************************
 * FUNCTION xpath1_validate_expr_ex
 * 
@@ -332,6 +374,24 @@ extern void
 			  xpath_result_t *result);
 
 
+/********************************************************************
+* FUNCTION xpath1_sort_nodeset
+* 
+* Sort a value node result nodeset into document order
+*
+* INPUTS:
+*    result == XPath result nodeset to sort
+*
+* OUTPUTS:
+*    result->nodeQ contents reordered
+*
+* RETURNS:
+*    status; the nodes are not moved if an error is returned
+*********************************************************************/
+extern status_t
+    xpath1_sort_nodeset (xpath_result_t *result);
+
+
 /********************************************************************
 * FUNCTION xpath1_check_node_exists
 * 
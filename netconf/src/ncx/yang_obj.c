@@ -7252,6 +7252,7 @@ static status_t
                     }
 
                     dlq_insertAhead(newobj, obj);
+                    obj_reset_descendant_names();
 
                     YANG_OBJ_DEBUG_USES4( "\nexpand_uses: "
                             "add new obj '%s' to parent '%s', uses.%u",
@@ -7675,6 +7676,7 @@ static status_t
                     }
 
                     dlq_enque(newobj, targQ);
+                    obj_reset_descendant_names();
 
                     /* may need to set the config flag now, under the context
                      * of the actual target, not within the grouping
@@ -22,12 +22,22 @@ date         init     comment
 14-jan-07    abb      begun;
 03-mar-11    abb      get rid of usleeps and replace with
                       design that checks for EAGAIN
+16-oct-26    agt      relay with splice() through a pipe when
+                      available; batch reads in the copy fallback
 
 *********************************************************************
 *                                                                   *
 *                     I N C L U D E    F I L E S                    *
 *                                                                   *
 *********************************************************************/
+/* splice() and F_SETPIPE_SZ are Linux-only */
+#if !defined(CYGWIN) && !defined(MACOSX) && !defined(FREEBSD)
+#define SUBSYS_SPLICE 1
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+#endif
+
 #include <sys/types.h>
 #include <sys/param.h>
 #include <sys/stat.h>
@@ -47,6 +57,7 @@ date         init     comment
 #include <string.h>
 #include <pwd.h>
 #include <stdarg.h>
+#include <poll.h>
 
 #define _C_main 1
 
@@ -84,8 +95,34 @@ date         init     comment
 *********************************************************************/
 #define BUFFLEN  2000
 
+/* default and minimum relay buffer size; --buffer-size=N */
+#define SUBSYS_DEF_BUFFLEN  65536
+#define SUBSYS_MIN_BUFFLEN  BUFFLEN
+#define SUBSYS_MAX_BUFFLEN  0x1000000
+
+#define SUBSYS_BUFFSIZE_ARG "--buffer-size="
+#define SUBSYS_NOSPLICE_ARG "--no-splice"
+
 #define MAX_READ_TRIES 1000
 
+
+/********************************************************************
+*                                                                   *
+*                             T Y P E S                             *
+*                                                                   *
+*********************************************************************/
+
+/* one direction of the client <-> ncxserver relay
+ * pipefd holds the splice() pipe; -1 when copying through msgbuff
+ */
+typedef struct relay_t_ {
+    int          infd;
+    int          outfd;
+    int          pipefd[2];
+    const char  *name;
+} relay_t;
+
+
 /********************************************************************
 *                                                                   *
 *                       V A R I A B L E S                           *
@@ -123,7 +160,10 @@ static FILE *errfile;
                                 }
 
 static boolean ncxconnect;
-static char msgbuff[BUFFLEN];
+static char   *msgbuff;
+static size_t  msgbufflen;
+static boolean usesplice;
+static relay_t relays[2];
 
 /********************************************************************
 * FUNCTION errno_to_status
@@ -234,15 +274,46 @@ static status_t
     port = NULL;
     user = NULL;
     ncxsock = -1;
+    for (i = 0; i < 2; i++) {
+        relays[i].pipefd[0] = -1;
+        relays[i].pipefd[1] = -1;
+    }
     ncxconnect = FALSE;
     ncxport_inet = -1;
+    msgbufflen = SUBSYS_DEF_BUFFLEN;
+#ifdef SUBSYS_SPLICE
+    usesplice = TRUE;
+#else
+    usesplice = FALSE;
+#endif
 
     for(i=1;i<argc;i++) {
     	if(strlen(argv[i])>strlen("--tcp-direct-port=") && 0==memcmp(argv[i],"--tcp-direct-port=",strlen("--tcp-direct-port="))) {
             ncxport_inet = atoi(argv[i]+strlen("--tcp-direct-port=")); 
+        } else if (strlen(argv[i]) > strlen(SUBSYS_BUFFSIZE_ARG) &&
+                   !memcmp(argv[i], SUBSYS_BUFFSIZE_ARG,
+                           strlen(SUBSYS_BUFFSIZE_ARG))) {
+            msgbufflen = 
+                (size_t)strtoul(argv[i]+strlen(SUBSYS_BUFFSIZE_ARG), NULL, 10);
+            if (msgbufflen < SUBSYS_MIN_BUFFLEN) {
+                msgbufflen = SUBSYS_MIN_BUFFLEN;
+            } else if (msgbufflen > SUBSYS_MAX_BUFFLEN) {
+                msgbufflen = SUBSYS_MAX_BUFFLEN;
+            }
+        } else if (!strcmp(argv[i], SUBSYS_NOSPLICE_ARG)) {
+            usesplice = FALSE;
         }
     }    
 
+    msgbuff = malloc(msgbufflen);
+    if (!msgbuff) {
+        SUBSYS_TRACE1( "ERROR: init_subsys(): malloc(msgbuff) failed\n" );
+        return ERR_INTERNAL_MEM;
+    }
+    SUBSYS_TRACE2( "INFO:  init_subsys(): relay buffer %u bytes, "
+                   "splice %s\n", (unsigned int)msgbufflen,
+                   usesplice ? "on" : "off" );
+
     /* get the client address */
     con = getenv("SSH_CONNECTION");
     if (!con) {
@@ -356,6 +427,29 @@ static status_t
 } /* init_subsys */
 
 
+/********************************************************************
+* FUNCTION close_relay_pipe
+*
+* Close the splice pipe for one relay direction, if any
+* The relay uses the msgbuff copy path after this call
+* 
+* INPUTS:
+*   relay == relay direction to change
+*********************************************************************/
+static void
+    close_relay_pipe (relay_t *relay)
+{
+    if (relay->pipefd[0] >= 0) {
+        close(relay->pipefd[0]);
+        relay->pipefd[0] = -1;
+    }
+    if (relay->pipefd[1] >= 0) {
+        close(relay->pipefd[1]);
+        relay->pipefd[1] = -1;
+    }
+} /* close_relay_pipe */
+
+
 /********************************************************************
 * FUNCTION cleanup_subsys
 *
@@ -365,6 +459,14 @@ static status_t
 static void
     cleanup_subsys (void)
 {
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        close_relay_pipe(&relays[i]);
+    }
+    if (msgbuff) {
+        free(msgbuff);
+    }
     if (client_addr) {
         free(client_addr);
     }
@@ -456,6 +558,268 @@ static ssize_t
 }  /* do_read */
 
 
+/********************************************************************
+* FUNCTION fd_readable
+*
+* Check without blocking if more input is waiting on a FD
+* 
+* INPUTS:
+*   fd == file descriptor to check
+*
+* RETURNS:
+*   TRUE if a read will not block
+*********************************************************************/
+static boolean
+    fd_readable (int fd)
+{
+    struct pollfd  pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN|POLLHUP)))
+        ? TRUE : FALSE;
+
+}  /* fd_readable */
+
+
+/********************************************************************
+* FUNCTION init_relay
+*
+* Setup one direction of the relay
+* A splice pipe is created if splice is enabled; if that fails
+* the relay quietly uses the copy path instead
+* 
+* INPUTS:
+*   relay == relay direction to setup
+*   infd == FD to read from
+*   outfd == FD to write to
+*   name == direction name for tracing
+*********************************************************************/
+static void
+    init_relay (relay_t *relay,
+                int infd,
+                int outfd,
+                const char *name)
+{
+    relay->infd = infd;
+    relay->outfd = outfd;
+    relay->pipefd[0] = -1;
+    relay->pipefd[1] = -1;
+    relay->name = name;
+
+#ifdef SUBSYS_SPLICE
+    if (usesplice) {
+        if (pipe(relay->pipefd) != 0) {
+            SUBSYS_TRACE1( "ERROR: init_relay(): pipe() for %s "
+                           "failed with error: %s\n", 
+                           name, strerror( errno ) );
+            relay->pipefd[0] = -1;
+            relay->pipefd[1] = -1;
+            return;
+        }
+#ifdef F_SETPIPE_SZ
+        /* a larger pipe lets one splice move a whole buffer;
+         * the default size is fine if the kernel refuses
+         */
+        if (fcntl(relay->pipefd[1], F_SETPIPE_SZ, (int)msgbufflen) < 0) {
+            SUBSYS_TRACE2( "INFO:  init_relay(): F_SETPIPE_SZ for %s "
+                           "failed with error: %s\n", 
+                           name, strerror( errno ) );
+        }
+#endif
+    }
+#endif
+
+}  /* init_relay */
+
+
+/********************************************************************
+* FUNCTION relay_copy
+*
+* Move data for one relay direction through msgbuff
+* After the first read, keep reading while more input is
+* already waiting and the buffer has room, then send it all
+* with one send_buff call
+* 
+* INPUTS:
+*   relay == relay direction with input ready
+*
+* RETURNS:
+*   status; ERR_NCX_EOF if the input side closed
+*********************************************************************/
+static status_t
+    relay_copy (relay_t *relay)
+{
+    status_t  res, res2;
+    ssize_t   retcnt;
+    size_t    total;
+
+    res = NO_ERR;
+    retcnt = do_read(relay->infd, msgbuff, msgbufflen, &res);
+    if (res != NO_ERR || retcnt <= 0) {
+        return res;
+    }
+    total = (size_t)retcnt;
+
+    /* any EOF or error hit while batching shows up again
+     * on the next select, after this data has been sent
+     */
+    while (total < msgbufflen && fd_readable(relay->infd)) {
+        res2 = NO_ERR;
+        retcnt = do_read(relay->infd, &msgbuff[total], 
+                         msgbufflen - total, &res2);
+        if (res2 != NO_ERR || retcnt <= 0) {
+            break;
+        }
+        total += (size_t)retcnt;
+    }
+
+    res = send_buff(relay->outfd, msgbuff, total);
+    if (res != NO_ERR) {
+        SUBSYS_TRACE1( "ERROR: relay_copy(): send_buff() to %s "
+                       "failed with %s\n", relay->name, strerror( errno ) );
+    }
+    return res;
+
+}  /* relay_copy */
+
+
+#ifdef SUBSYS_SPLICE
+/********************************************************************
+* FUNCTION relay_drain_pipe
+*
+* Copy any data left in the splice pipe with read and send_buff
+* Used when splice stops working on the output side after
+* the input has already been moved into the pipe
+* 
+* INPUTS:
+*   relay == relay direction to drain
+*   pending == number of bytes in the pipe
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    relay_drain_pipe (relay_t *relay,
+                      size_t pending)
+{
+    status_t  res;
+    ssize_t   retcnt;
+
+    res = NO_ERR;
+    while (pending > 0 && res == NO_ERR) {
+        retcnt = do_read(relay->pipefd[0], msgbuff, 
+                         (pending < msgbufflen) ? pending : msgbufflen,
+                         &res);
+        if (res == NO_ERR && retcnt > 0) {
+            res = send_buff(relay->outfd, msgbuff, (size_t)retcnt);
+            pending -= (size_t)retcnt;
+        }
+    }
+    return res;
+
+}  /* relay_drain_pipe */
+
+
+/********************************************************************
+* FUNCTION relay_splice
+*
+* Move data for one relay direction with splice(), using the
+* relay pipe so the bytes never enter user space
+* If the FDs do not support splice, the relay is switched
+* to the copy path for the rest of the session
+* 
+* INPUTS:
+*   relay == relay direction with input ready
+*
+* RETURNS:
+*   status; ERR_NCX_EOF if the input side closed
+*********************************************************************/
+static status_t
+    relay_splice (relay_t *relay)
+{
+    ssize_t   incnt, outcnt;
+    size_t    pending;
+
+    do {
+        incnt = splice(relay->infd, NULL, relay->pipefd[1], NULL,
+                       msgbufflen, SPLICE_F_MOVE | SPLICE_F_MORE);
+    } while (incnt < 0 && errno == EINTR);
+
+    if (incnt < 0) {
+        if (errno == EAGAIN) {
+            return NO_ERR;
+        } else if (errno == EINVAL || errno == ENOSYS) {
+            SUBSYS_TRACE2( "INFO:  relay_splice(): splice() not "
+                           "supported for %s, copying instead\n",
+                           relay->name );
+            close_relay_pipe(relay);
+            return relay_copy(relay);
+        }
+        SUBSYS_TRACE1( "ERROR: relay_splice(): splice() from %s "
+                       "failed with error: %s\n", 
+                       relay->name, strerror( errno ) );
+        return ERR_NCX_READ_FAILED;
+    } else if (incnt == 0) {
+        SUBSYS_TRACE1( "INFO: relay_splice(): closed connection\n");
+        return ERR_NCX_EOF;
+    }
+
+    pending = (size_t)incnt;
+    while (pending > 0) {
+        outcnt = splice(relay->pipefd[0], NULL, relay->outfd, NULL,
+                        pending, SPLICE_F_MOVE);
+        if (outcnt < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            } else if (errno == EINVAL || errno == ENOSYS) {
+                SUBSYS_TRACE2( "INFO:  relay_splice(): splice() not "
+                               "supported for %s, copying instead\n",
+                               relay->name );
+                if (relay_drain_pipe(relay, pending) != NO_ERR) {
+                    return ERR_NCX_OPERATION_FAILED;
+                }
+                close_relay_pipe(relay);
+                return NO_ERR;
+            }
+            SUBSYS_TRACE1( "ERROR: relay_splice(): splice() to %s "
+                           "failed with error: %s\n", 
+                           relay->name, strerror( errno ) );
+            return ERR_NCX_OPERATION_FAILED;
+        }
+        pending -= (size_t)outcnt;
+    }
+    return NO_ERR;
+
+}  /* relay_splice */
+#endif  /* SUBSYS_SPLICE */
+
+
+/********************************************************************
+* FUNCTION relay_data
+*
+* Move the available input for one relay direction to its output
+* 
+* INPUTS:
+*   relay == relay direction with input ready
+*
+* RETURNS:
+*   status; ERR_NCX_EOF if the input side closed
+*********************************************************************/
+static status_t
+    relay_data (relay_t *relay)
+{
+#ifdef SUBSYS_SPLICE
+    if (relay->pipefd[0] >= 0) {
+        return relay_splice(relay);
+    }
+#endif
+    return relay_copy(relay);
+
+}  /* relay_data */
+
+
 /********************************************************************
 * FUNCTION io_loop
 *
@@ -472,13 +836,15 @@ static status_t
     status_t  res;
     boolean   done;
     fd_set    fds;
-    int       ret;
-    ssize_t   retcnt;
+    int       ret, i;
 
     res = NO_ERR;
     done = FALSE;
     FD_ZERO(&fds);
 
+    init_relay(&relays[0], STDIN_FILENO, ncxsock, "ncxserver");
+    init_relay(&relays[1], ncxsock, STDOUT_FILENO, "client");
+
     while (!done) {
         FD_SET(STDIN_FILENO, &fds);
         FD_SET(ncxsock, &fds);
@@ -505,55 +871,21 @@ static status_t
             continue;
         } /* else some IO to process */
 
-        /* check any input from client */
-        if (FD_ISSET(STDIN_FILENO, &fds)) {
-            /* get buff from openssh */
-            retcnt = do_read(STDIN_FILENO, 
-                             msgbuff, 
-                             (size_t)BUFFLEN,
-                             &res);
-
-            if (res == ERR_NCX_EOF) {
-                res = NO_ERR;
-                done = TRUE;
+        /* check any input from client, then from the ncxserver */
+        for (i = 0; i < 2 && !done; i++) {
+            if (!FD_ISSET(relays[i].infd, &fds)) {
                 continue;
-            } else if (res == ERR_NCX_SKIPPED) {
-                res = NO_ERR;
-            } else if (res == NO_ERR && retcnt > 0) {
-                /* send this buffer to the ncxserver */
-                res = send_buff(ncxsock, msgbuff, (size_t)retcnt);
-                if (res != NO_ERR) {
-                    SUBSYS_TRACE1( "ERROR: io_loop(): send_buff() to ncxserver "
-                                   "failed with %s\n", strerror( errno ) );
-                    done = TRUE;
-                    continue;
-                }
             }
-        }  /* if STDIN set */
-
-        /* check any input from the ncxserver */
-        if (FD_ISSET(ncxsock, &fds)) {
-            res = NO_ERR;
-            retcnt = do_read(ncxsock, 
-                             msgbuff, 
-                             (size_t)BUFFLEN,
-                             &res);
-
+            res = relay_data(&relays[i]);
             if (res == ERR_NCX_EOF) {
                 res = NO_ERR;
                 done = TRUE;
-                continue;
             } else if (res == ERR_NCX_SKIPPED) {
                 res = NO_ERR;
-            } else if (res == NO_ERR && retcnt > 0) {
-                /* send this buffer to STDOUT */
-                res = send_buff(STDOUT_FILENO, msgbuff, (size_t)retcnt);
-                if (res != NO_ERR) {
-                    SUBSYS_TRACE1( "ERROR: io_loop(): send_buff() to client "
-                                   "failed with %s\n", strerror( errno ) );
-                    done = TRUE;
-                    continue;
-                }
+            } else if (res != NO_ERR) {
+                SUBSYS_TRACE1( "ERROR: io_loop(): relay to %s "
+                               "failed\n", relays[i].name );
+                done = TRUE;
             }
         }
     }
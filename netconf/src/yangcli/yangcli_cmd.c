@@ -1384,7 +1384,7 @@ static status_t
         /* found something set from this choice, finish the case */
         log_stdout("\nEnter more parameters to complete the choice:");
 
-        cas = pval->casobj;
+        cas = val_get_casobj(pval);
         if (cas == NULL) {
             server_cb->get_optional = saveopt;
             return SET_ERROR(ERR_INTERNAL_VAL);
@@ -1823,10 +1823,11 @@ static status_t
         case OBJ_TYP_CHOICE:
             firstchoice = val_get_choice_first_set(valset, parm);
             if (firstchoice) {
-                assert( firstchoice->casobj && "case backptr is NULL!" );
+                assert( val_get_casobj(firstchoice) && 
+                        "case backptr is NULL!" );
 
                 /* a case is already selected so try finishing that */
-                res = get_case(server_cb, firstchoice->casobj, valset,
+                res = get_case(server_cb, val_get_casobj(firstchoice), valset,
                                oldvalset, iswrite, isdelete);
             } else {
                 res = get_choice(server_cb, rpc, parm, valset, oldvalset,
@@ -4081,11 +4082,11 @@ static status_t
     if (!metaval) {
         return ERR_INTERNAL_MEM;
     }
-    dlq_enque(metaval, &val->metaQ);
+    val_add_meta(metaval, val);
 
     if (selectval) {
         val_set_qname(selectval, 0, NCX_EL_SELECT, xml_strlen(NCX_EL_SELECT));
-        dlq_enque(selectval, &val->metaQ);
+        val_add_meta(selectval, val);
     }
 
     return NO_ERR;
@@ -4962,7 +4963,7 @@ static status_t
         return res;
     }
 
-    dlq_enque(metaval, &val->metaQ);
+    val_add_meta(metaval, val);
     return NO_ERR;
 
 } /* add_one_operation_attr */
@@ -5073,7 +5074,7 @@ static status_t
         val_free_value(metaval);
         return res;
     } else {
-        dlq_enque(metaval, &val->metaQ);
+        val_add_meta(metaval, val);
     }
 
     if (insop == OP_INSOP_BEFORE || insop == OP_INSOP_AFTER) {
@@ -5102,7 +5103,7 @@ static status_t
             val_free_value(metaval);
             return res;
         } else {
-            dlq_enque(metaval, &val->metaQ);
+            val_add_meta(metaval, val);
         }
     }          
 
@@ -0,0 +1,13 @@
+# ----------------------------------------------------------------------------|
+# Message arena edit tests
+ARENA_EDIT_RUNNING_SOURCES := $(YUMA_TEST_SUITE_INTEG)/arena-edit-tests.cpp \
+                arena-edit-running.cpp \
+
+ALL_SOURCES += $(ARENA_EDIT_RUNNING_SOURCES) 
+
+ALL_ARENA_EDIT_RUNNING_SOURCES := $(BASE_SOURCES) $(ARENA_EDIT_RUNNING_SOURCES)
+
+test-arena-edit-running: $(call ALL_OBJECTS,$(ALL_ARENA_EDIT_RUNNING_SOURCES)) | yuma-op
+	$(MAKE_TEST)
+
+TARGETS += test-arena-edit-running
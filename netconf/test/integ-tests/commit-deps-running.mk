@@ -0,0 +1,13 @@
+# ----------------------------------------------------------------------------|
+# Commit dependency tests
+COMMIT_DEPS_RUNNING_SOURCES := $(YUMA_TEST_SUITE_COMMON)/commit-deps-tests.cpp \
+                commit-deps-running.cpp \
+
+ALL_SOURCES += $(COMMIT_DEPS_RUNNING_SOURCES) 
+
+ALL_COMMIT_DEPS_RUNNING_SOURCES := $(BASE_SOURCES) $(COMMIT_DEPS_RUNNING_SOURCES)
+
+test-commit-deps-running: $(call ALL_OBJECTS,$(ALL_COMMIT_DEPS_RUNNING_SOURCES)) | yuma-op
+	$(MAKE_TEST)
+
+TARGETS += test-commit-deps-running
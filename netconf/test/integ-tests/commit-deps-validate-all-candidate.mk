@@ -0,0 +1,13 @@
+# ----------------------------------------------------------------------------|
+# Commit dependency tests
+COMMIT_DEPS_VALIDATE_ALL_CANDIDATE_SOURCES := $(YUMA_TEST_SUITE_COMMON)/commit-deps-tests.cpp \
+                commit-deps-validate-all-candidate.cpp \
+
+ALL_SOURCES += $(COMMIT_DEPS_VALIDATE_ALL_CANDIDATE_SOURCES) 
+
+ALL_COMMIT_DEPS_VALIDATE_ALL_CANDIDATE_SOURCES := $(BASE_SOURCES) $(COMMIT_DEPS_VALIDATE_ALL_CANDIDATE_SOURCES)
+
+test-commit-deps-validate-all-candidate: $(call ALL_OBJECTS,$(ALL_COMMIT_DEPS_VALIDATE_ALL_CANDIDATE_SOURCES)) | yuma-op
+	$(MAKE_TEST)
+
+TARGETS += test-commit-deps-validate-all-candidate
@@ -0,0 +1,29 @@
+#define BOOST_TEST_MODULE IntegTestCommitDepsValidateAllRunning
+
+#include "configure-yuma-integtest.h"
+
+namespace YumaTest {
+
+// ---------------------------------------------------------------------------|
+// Initialise the spoofed command line arguments 
+// ---------------------------------------------------------------------------|
+const char* SpoofedArgs::argv[] = {
+    ( "yuma-test" ),
+    ( "--modpath=../../modules/netconfcentral"
+               ":../../modules/ietf"
+               ":../../modules/yang"
+               ":../modules/yang"
+               ":../../modules/test/pass" ),
+    ( "--runpath=../modules/sil" ),
+    ( "--access-control=off" ),
+    ( "--log=./yuma-op/yuma-out.txt" ),
+    ( "--target=running" ),
+    ( "--module=commit_deps_test" ),
+    ( "--validate-all=true" ),  // run every commit test on every edit
+    ( "--no-startup" ),         // ensure that no configuration from previous 
+                                // tests is present
+};
+
+#include "define-yuma-integtest-global-fixture.h"
+
+} // namespace YumaTest
@@ -7,6 +7,8 @@ EDIT_TEST_SUITE_SOURCES := $(YUMA_TEST_SUITE_COMMON)/device-tests-misc.cpp \
                            $(YUMA_TEST_SUITE_COMMON)/device-tests-get.cpp \
                            $(YUMA_TEST_SUITE_COMMON)/device-tests-delete.cpp \
                            $(YUMA_TEST_SUITE_INTEG)/base-64-tests.cpp \
+                           $(YUMA_TEST_SUITE_INTEG)/val-memory-tests.cpp \
+                           $(YUMA_TEST_SUITE_INTEG)/val-diff-tests.cpp \
                            device-edit-running.cpp \
 
 ALL_SOURCES += $(EDIT_TEST_SUITE_SOURCES) 
@@ -0,0 +1,13 @@
+# ----------------------------------------------------------------------------|
+# Compiled XPath tests
+XPATH_COMPILE_RUNNING_SOURCES := $(YUMA_TEST_SUITE_INTEG)/xpath-compile-tests.cpp \
+                xpath-compile-running.cpp \
+
+ALL_SOURCES += $(XPATH_COMPILE_RUNNING_SOURCES) 
+
+ALL_XPATH_COMPILE_RUNNING_SOURCES := $(BASE_SOURCES) $(XPATH_COMPILE_RUNNING_SOURCES)
+
+test-xpath-compile-running: $(call ALL_OBJECTS,$(ALL_XPATH_COMPILE_RUNNING_SOURCES)) | yuma-op
+	$(MAKE_TEST)
+
+TARGETS += test-xpath-compile-running
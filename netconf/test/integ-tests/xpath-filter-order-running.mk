@@ -0,0 +1,13 @@
+# ----------------------------------------------------------------------------|
+# XPath union filter order tests
+XPATH_FILTER_ORDER_RUNNING_SOURCES := $(YUMA_TEST_SUITE_INTEG)/xpath-filter-order-tests.cpp \
+                xpath-filter-order-running.cpp \
+
+ALL_SOURCES += $(XPATH_FILTER_ORDER_RUNNING_SOURCES) 
+
+ALL_XPATH_FILTER_ORDER_RUNNING_SOURCES := $(BASE_SOURCES) $(XPATH_FILTER_ORDER_RUNNING_SOURCES)
+
+test-xpath-filter-order-running: $(call ALL_OBJECTS,$(ALL_XPATH_FILTER_ORDER_RUNNING_SOURCES)) | yuma-op
+	$(MAKE_TEST)
+
+TARGETS += test-xpath-filter-order-running
@@ -0,0 +1,13 @@
+# ----------------------------------------------------------------------------|
+# XPath key lookup tests
+XPATH_KEYSTEP_RUNNING_SOURCES := $(YUMA_TEST_SUITE_INTEG)/xpath-keystep-tests.cpp \
+                xpath-keystep-running.cpp \
+
+ALL_SOURCES += $(XPATH_KEYSTEP_RUNNING_SOURCES) 
+
+ALL_XPATH_KEYSTEP_RUNNING_SOURCES := $(BASE_SOURCES) $(XPATH_KEYSTEP_RUNNING_SOURCES)
+
+test-xpath-keystep-running: $(call ALL_OBJECTS,$(ALL_XPATH_KEYSTEP_RUNNING_SOURCES)) | yuma-op
+	$(MAKE_TEST)
+
+TARGETS += test-xpath-keystep-running
@@ -5,6 +5,13 @@ COMMON_FLAGS = -fPIC -Wall $(DEBUG) $(addprefix -I,$(INCLUDES))
 
 override LDFLAGS += -Wall $(DEBUG) $(addprefix -l,$(LIBS)) -Wl,--export-dynamic
 
+# make SANITIZE=1 runs the tests under AddressSanitizer, with every
+# value arena chunk in its own block so stale arena nodes are caught
+ifdef SANITIZE
+COMMON_FLAGS += -fsanitize=address -fno-omit-frame-pointer -DNCX_ARENA_DEBUG
+override LDFLAGS += -fsanitize=address
+endif
+
 override CFLAGS += $(COMMON_FLAGS)
 override CXXFLAGS += $(COMMON_FLAGS) -std=c++0x
 
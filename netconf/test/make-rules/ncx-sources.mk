@@ -14,6 +14,7 @@ NCX_SOURCES = $(YUMA_SRC_ROOT)/ncx/b64.c \
               $(YUMA_SRC_ROOT)/ncx/json_wr.c \
               $(YUMA_SRC_ROOT)/ncx/log.c \
               $(YUMA_SRC_ROOT)/ncx/ncx_appinfo.c \
+              $(YUMA_SRC_ROOT)/ncx/ncx_arena.c \
               $(YUMA_SRC_ROOT)/ncx/ncx.c \
               $(YUMA_SRC_ROOT)/ncx/ncx_feature.c \
               $(YUMA_SRC_ROOT)/ncx/ncx_list.c \
@@ -36,6 +37,7 @@ NCX_SOURCES = $(YUMA_SRC_ROOT)/ncx/b64.c \
               $(YUMA_SRC_ROOT)/ncx/tstamp.c \
               $(YUMA_SRC_ROOT)/ncx/typ.c \
               $(YUMA_SRC_ROOT)/ncx/val.c \
+              $(YUMA_SRC_ROOT)/ncx/val_diff.c \
               $(YUMA_SRC_ROOT)/ncx/val_util.c \
               $(YUMA_SRC_ROOT)/ncx/var.c \
               $(YUMA_SRC_ROOT)/ncx/xml_msg.c \
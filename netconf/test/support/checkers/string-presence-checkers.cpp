@@ -89,4 +89,31 @@ void StringsPresentNotPresentChecker::operator()( const string& queryResult ) co
     expNotPresentChecker_( queryResult );
 }
 
+// ---------------------------------------------------------------------------|
+StringOrderChecker::StringOrderChecker( 
+        const vector<string>& expOrderedReplyText )
+    : checkStrings_( expOrderedReplyText )
+{
+}
+
+// ---------------------------------------------------------------------------|
+StringOrderChecker::~StringOrderChecker()
+{
+}
+
+// ---------------------------------------------------------------------------|
+void StringOrderChecker::operator()( const string& checkStr ) const
+{
+    size_t lastPos = 0;
+    BOOST_FOREACH ( const string& val, checkStrings_ )
+    {
+        BOOST_TEST_MESSAGE( "\tChecking " << val << " is present once, in order" );
+        size_t pos = checkStr.find( val );
+        BOOST_REQUIRE_NE( string::npos, pos );
+        BOOST_CHECK_EQUAL( string::npos, checkStr.find( val, pos + 1 ) );
+        BOOST_CHECK_GE( pos, lastPos );
+        lastPos = pos;
+    }
+}
+
 } // namespace YumaTest
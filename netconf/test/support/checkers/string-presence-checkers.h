@@ -112,6 +112,39 @@ private:
     StringNonPresenceChecker expNotPresentChecker_;
 };
 
+/**
+ * Check the results of a netconf query and ensure that each of the
+ * supplied strings is present exactly once, in the supplied order.
+ */
+class StringOrderChecker
+{
+public:
+     /**
+      * Constructor.
+      *
+      * \param expOrderedText a list of strings that must each be
+      *                       present once in the reply, in this order,
+      *                       for the test to pass
+     */
+    explicit StringOrderChecker( const std::vector< std::string >& expOrderedText );
+
+    /** 
+     * Destructor
+     */
+    ~StringOrderChecker();
+
+    /**
+     * Check the query results
+     *
+     * \param queryResult the query to check,
+     */
+    void operator()( const std::string& queryResult ) const;
+
+private:
+    /** list of strings that must be present in order in the output */
+    const std::vector< std::string >& checkStrings_;  
+};
+
 } // namespace YumaTest
 
 #endif // __YUMA_STRING_PRESENCE_CHECKER_H
@@ -0,0 +1,86 @@
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/arena-edit-fixture.h"
+
+// ---------------------------------------------------------------------------|
+// Standard includes
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/nc-query-util/nc-query-test-engine.h"
+#include "test/support/msg-util/NCMessageBuilder.h"
+
+// ---------------------------------------------------------------------------|
+// Yuma includes
+// ---------------------------------------------------------------------------|
+#include "cfg.h"
+#include "val.h"
+
+// ---------------------------------------------------------------------------|
+// File wide namespace use
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace
+{
+
+/**
+ * Count the nodes in a subtree that were allocated from an arena.
+ *
+ * \param val the top of the subtree
+ * \return the number of arena nodes
+ */
+size_t countArenaNodes( const val_value_t* val )
+{
+    size_t count = VAL_IS_ARENA( val ) ? 1 : 0;
+
+    for ( const val_value_t* ch = val_get_first_child( val );
+          ch != NULL; ch = val_get_next_child( ch ) )
+    {
+        count += countArenaNodes( ch );
+    }
+    return count;
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest
+{
+
+// ---------------------------------------------------------------------------|
+ArenaEditFixture::ArenaEditFixture()
+    : QuerySuiteFixture()
+    , moduleNs_( "http://netconfcentral.org/ns/arena_edit_test" )
+{
+    // ensure the module is loaded
+    queryEngine_->loadModule( primarySession_, "arena_edit_test" );
+}
+
+// ---------------------------------------------------------------------------|
+ArenaEditFixture::~ArenaEditFixture()
+{
+}
+
+// ---------------------------------------------------------------------------|
+void ArenaEditFixture::editTop( const string& content )
+{
+    runEditQuery( primarySession_, messageBuilder_->genModuleOperationText(
+                      "top", moduleNs_, content ) );
+    commitChanges( primarySession_ );
+}
+
+// ---------------------------------------------------------------------------|
+void ArenaEditFixture::checkRunningHasNoArenaNodes() const
+{
+    cfg_template_t* cfg = cfg_get_config_id( NCX_CFGID_RUNNING );
+    BOOST_REQUIRE( cfg != NULL && cfg->root != NULL );
+    BOOST_CHECK_EQUAL( countArenaNodes( cfg->root ), 0u );
+}
+
+} // namespace YumaTest
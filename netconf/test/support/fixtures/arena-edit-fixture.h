@@ -0,0 +1,55 @@
+#ifndef __YUMA_ARENA_EDIT_TEST_FIXTURE__H
+#define __YUMA_ARENA_EDIT_TEST_FIXTURE__H
+
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/query-suite-fixture.h"
+
+// ---------------------------------------------------------------------------|
+// Standard includes
+// ---------------------------------------------------------------------------|
+#include <string>
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest
+{
+
+// ---------------------------------------------------------------------------|
+/**
+ * This class is used to edit the arena_edit_test module and check
+ * that no node of the running config was allocated from the arena
+ * of the <edit-config> request that added it.
+ */
+struct ArenaEditFixture : public QuerySuiteFixture
+{
+public:
+    /**
+     * Constructor. Load the module.
+     */
+    ArenaEditFixture();
+
+    /**
+     * Destructor. Shutdown the test.
+     */
+    ~ArenaEditFixture();
+
+    /**
+     * Edit the content of the top container and commit it.
+     *
+     * \param content the content of the top container
+     */
+    void editTop( const std::string& content );
+
+    /**
+     * Check that no node of the running config came from an arena.
+     */
+    void checkRunningHasNoArenaNodes() const;
+
+protected:
+    const std::string moduleNs_;        ///< the module namespace
+};
+
+} // namespace YumaTest
+
+#endif // __YUMA_ARENA_EDIT_TEST_FIXTURE__H
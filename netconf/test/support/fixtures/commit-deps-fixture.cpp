@@ -0,0 +1,111 @@
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/commit-deps-fixture.h"
+
+// ---------------------------------------------------------------------------|
+// Standard includes
+// ---------------------------------------------------------------------------|
+#include <iostream>
+#include <memory>
+#include <cassert>
+#include <boost/foreach.hpp>
+
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/nc-query-util/nc-query-test-engine.h"
+#include "test/support/nc-session/abstract-nc-session-factory.h"
+#include "test/support/misc-util/log-utils.h"
+#include "test/support/checkers/string-presence-checkers.h"
+
+// ---------------------------------------------------------------------------|
+// File wide namespace use
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest 
+{
+
+// ---------------------------------------------------------------------------|
+CommitDepsFixture::CommitDepsFixture() 
+    : QuerySuiteFixture()
+    , moduleNs_( "http://netconfcentral.org/ns/commit_deps_test" )
+{
+    // ensure the module is loaded
+    queryEngine_->loadModule( primarySession_, "commit_deps_test" );
+}
+
+// ---------------------------------------------------------------------------|
+CommitDepsFixture::~CommitDepsFixture() 
+{
+}
+
+// ---------------------------------------------------------------------------|
+string CommitDepsFixture::genContainerText(
+    const string& container,
+    const string& content ) const
+{
+    return messageBuilder_->genModuleOperationText( container, moduleNs_,
+                                                    content );
+}
+
+// ---------------------------------------------------------------------------|
+void CommitDepsFixture::applyValidConfig(
+    std::shared_ptr<AbstractNCSession> session,
+    const string& query )
+{
+    assert( session );
+    runEditQuery( session, query );
+    commitChanges( session );
+}
+
+// ---------------------------------------------------------------------------|
+void CommitDepsFixture::checkRejectedEdit(
+    std::shared_ptr<AbstractNCSession> session,
+    const string& query,
+    const string& failReason )
+{
+    assert( session );
+
+    if ( !useCandidate() )
+    {
+        runFailedEditQuery( session, query, failReason );
+        return;
+    }
+
+    // defer the commit tests to validate and commit
+    messageBuilder_->setTestOption( "set" );
+    runEditQuery( session, query );
+    messageBuilder_->setTestOption( "" );
+
+    vector<string> expPresent{ "error", "rpc-error", failReason };
+    vector<string> expNotPresent{ "ok" };
+    StringsPresentNotPresentChecker checker( expPresent, expNotPresent );
+    queryEngine_->tryValidateDatabase( session, writeableDbName_, checker );
+    queryEngine_->tryCustomRPC( session, "<commit/>", checker );
+
+    vector<string> expOkPresent{ "ok" };
+    vector<string> expOkNotPresent{ "error", "rpc-error" };
+    StringsPresentNotPresentChecker okChecker( expOkPresent, 
+                                               expOkNotPresent );
+    queryEngine_->tryDiscardChanges( session, okChecker );
+}
+
+// ---------------------------------------------------------------------------|
+void CommitDepsFixture::removeContainers(
+    std::shared_ptr<AbstractNCSession> session,
+    const vector<string>& containers )
+{
+    assert( session );
+
+    BOOST_FOREACH( const string& container, containers )
+    {
+        runEditQuery( session, messageBuilder_->genTopLevelContainerText(
+                          container, moduleNs_, "delete" ) );
+    }
+    commitChanges( session );
+}
+
+} // namespace YumaTest
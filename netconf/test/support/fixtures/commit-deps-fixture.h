@@ -0,0 +1,89 @@
+#ifndef __YUMA_COMMIT_DEPS_TEST_FIXTURE__H
+#define __YUMA_COMMIT_DEPS_TEST_FIXTURE__H
+
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/query-suite-fixture.h"
+#include "test/support/msg-util/NCMessageBuilder.h"
+
+// ---------------------------------------------------------------------------|
+// Standard includes
+// ---------------------------------------------------------------------------|
+#include <vector>
+#include <string>
+#include <memory>
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest 
+{
+class AbstractNCSession;
+
+// ---------------------------------------------------------------------------|
+/**
+ * This class is used to check that the commit tests of the
+ * commit_deps_test module are run when only a node they read
+ * somewhere else in the config is edited.
+ */
+struct CommitDepsFixture : public QuerySuiteFixture
+{
+public:
+    /** 
+     * Constructor. 
+     */
+    CommitDepsFixture();
+
+    /**
+     * Destructor. Shutdown the test.
+     */
+    ~CommitDepsFixture();
+
+    /** 
+     * Generate the text for a top level container of the module.
+     *
+     * \param container the name of the container
+     * \param content the content of the container
+     * \return the container text
+     */
+    std::string genContainerText( const std::string& container,
+                                  const std::string& content ) const;
+
+    /** 
+     * Edit in a valid configuration and commit it.
+     *
+     * \param session the session running the query
+     * \param query the edit to apply
+     */
+    void applyValidConfig( std::shared_ptr<AbstractNCSession> session,
+                           const std::string& query );
+
+    /** 
+     * Apply an edit that breaks a commit test of another node and
+     * check that it is rejected.  With the candidate target the edit
+     * is applied with test-option 'set', so the error must be
+     * reported by validate and commit; the changes are then
+     * discarded.  With the running target the edit-config must fail.
+     *
+     * \param session the session running the query
+     * \param query the edit to apply
+     * \param failReason the expected error message
+     */
+    void checkRejectedEdit( std::shared_ptr<AbstractNCSession> session,
+                            const std::string& query,
+                            const std::string& failReason );
+
+    /** 
+     * Remove the top level containers and commit.
+     *
+     * \param session the session running the query
+     * \param containers the containers to remove
+     */
+    void removeContainers( std::shared_ptr<AbstractNCSession> session,
+                           const std::vector<std::string>& containers );
+
+    const std::string moduleNs_;        ///< the module namespace
+};
+
+} // namespace YumaTest
+
+#endif // __YUMA_COMMIT_DEPS_TEST_FIXTURE__H
@@ -0,0 +1,266 @@
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/xpath-compile-fixture.h"
+
+// ---------------------------------------------------------------------------|
+// Standard includes
+// ---------------------------------------------------------------------------|
+#include <cassert>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/nc-query-util/nc-query-test-engine.h"
+#include "test/support/msg-util/NCMessageBuilder.h"
+
+// ---------------------------------------------------------------------------|
+// Yuma includes
+// ---------------------------------------------------------------------------|
+#include "cfg.h"
+#include "ncx.h"
+#include "ncx_num.h"
+#include "status.h"
+#include "var.h"
+#include "xml_val.h"
+#include "xpath1.h"
+
+// ---------------------------------------------------------------------------|
+// File wide namespace use
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace
+{
+
+// number of entries in each list; enough for the parent to be indexed
+const int ENTRY_COUNT = 40;
+
+const xmlChar* xstr( const char* str )
+{
+    return reinterpret_cast< const xmlChar* >( str );
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest
+{
+
+// ---------------------------------------------------------------------------|
+XPathCompileFixture::XPathCompileFixture()
+    : QuerySuiteFixture()
+    , moduleNs_( "http://netconfcentral.org/ns/xpath_compile_test" )
+    , mod_( NULL )
+    , root_( NULL )
+    , variables_()
+{
+    // ensure the module is loaded
+    queryEngine_->loadModule( primarySession_, "xpath_compile_test" );
+    mod_ = ncx_find_module( xstr( "xpath_compile_test" ), NULL );
+    BOOST_REQUIRE( mod_ != NULL );
+
+    ostringstream data;
+    for ( int i = 0; i < ENTRY_COUNT; ++i )
+    {
+        data << "<item><name>item" << i << "</name>"
+             << "<a>" << i << "</a><b>b" << i << "</b></item>"
+             << "<num><id>" << i + 1 << "</id>"
+             << "<val>n" << i + 1 << "</val></num>"
+             << "<pair><a>p" << i % 10 << "</a><b>" << i / 10 << "</b>"
+             << "<val>v" << i << "</val></pair>";
+    }
+    data << "<refs><ifname>item7</ifname><small>2</small>"
+         << "<id-str>01</id-str>"
+         << "<names>item1</names><names>item2</names><names>item3</names>"
+         << "</refs>";
+
+    runEditQuery( primarySession_, messageBuilder_->genModuleOperationText(
+                      "top", moduleNs_, data.str() ) );
+    commitChanges( primarySession_ );
+
+    cfg_template_t* cfg = cfg_get_config_id( NCX_CFGID_RUNNING );
+    BOOST_REQUIRE( cfg != NULL && cfg->root != NULL );
+    root_ = cfg->root;
+}
+
+// ---------------------------------------------------------------------------|
+XPathCompileFixture::~XPathCompileFixture()
+{
+}
+
+// ---------------------------------------------------------------------------|
+void XPathCompileFixture::setVariable( const string& name,
+                                       const string& value )
+{
+    variables_.push_back( make_pair( name, value ) );
+}
+
+// ---------------------------------------------------------------------------|
+xpath_pcb_t* XPathCompileFixture::newPcb( const string& expr,
+                                          val_value_t* context )
+{
+    xpath_pcb_t* pcb = xpath_new_pcb( xstr( expr.c_str() ), NULL );
+    BOOST_REQUIRE( pcb != NULL );
+
+    typedef pair< string, string > Variable;
+    BOOST_FOREACH( const Variable& var, variables_ )
+    {
+        val_value_t* val = xml_val_new_cstring( xstr( var.first.c_str() ), 0,
+                                                xstr( var.second.c_str() ) );
+        BOOST_REQUIRE( val != NULL );
+        BOOST_REQUIRE_EQUAL( var_set_que( &pcb->varbindQ,
+                                          xstr( var.first.c_str() ), val ),
+                             NO_ERR );
+        val_free_value( val );
+    }
+
+    BOOST_REQUIRE_MESSAGE(
+            xpath1_parse_expr( NULL, mod_, pcb, XP_SRC_YANG ) == NO_ERR,
+            "parse " << expr );
+    BOOST_REQUIRE_MESSAGE(
+            xpath1_validate_expr( mod_, context->obj, pcb ) == NO_ERR,
+            "validate " << expr );
+    return pcb;
+}
+
+// ---------------------------------------------------------------------------|
+val_value_t* XPathCompileFixture::getNode( const string& expr )
+{
+    xpath_pcb_t* pcb = newPcb( expr, root_ );
+    status_t res = NO_ERR;
+    xpath_result_t* result = xpath1_eval_expr( pcb, root_, root_, FALSE,
+                                               TRUE, &res );
+    BOOST_REQUIRE_EQUAL( res, NO_ERR );
+    BOOST_REQUIRE( result != NULL && result->restype == XP_RT_NODESET );
+
+    xpath_resnode_t* resnode = xpath_get_first_resnode( result );
+    BOOST_REQUIRE_MESSAGE( resnode != NULL, "no node for " << expr );
+    val_value_t* val = resnode->node.valptr;
+
+    xpath_free_result( result );
+    xpath_free_pcb( pcb );
+    return val;
+}
+
+// ---------------------------------------------------------------------------|
+void XPathCompileFixture::checkResults( xpath_result_t* compiled,
+                                        xpath_result_t* interpreted )
+{
+    BOOST_REQUIRE_EQUAL( compiled->restype, interpreted->restype );
+
+    switch ( compiled->restype )
+    {
+    case XP_RT_NODESET:
+    {
+        xpath_resnode_t* cnode = xpath_get_first_resnode( compiled );
+        xpath_resnode_t* inode = xpath_get_first_resnode( interpreted );
+        for ( ; cnode && inode;
+              cnode = xpath_get_next_resnode( cnode ),
+              inode = xpath_get_next_resnode( inode ) )
+        {
+            BOOST_CHECK( cnode->node.valptr == inode->node.valptr );
+        }
+        BOOST_CHECK( cnode == NULL && inode == NULL );
+        break;
+    }
+    case XP_RT_NUMBER:
+    {
+        ncx_num_t cnum = compiled->r.num;
+        ncx_num_t inum = interpreted->r.num;
+        BOOST_CHECK_EQUAL( ncx_num_is_nan( &cnum, NCX_BT_FLOAT64 ),
+                           ncx_num_is_nan( &inum, NCX_BT_FLOAT64 ) );
+        if ( !ncx_num_is_nan( &cnum, NCX_BT_FLOAT64 ) )
+        {
+            BOOST_CHECK_EQUAL( ncx_compare_nums( &cnum, &inum,
+                                                 NCX_BT_FLOAT64 ), 0 );
+        }
+        break;
+    }
+    case XP_RT_STRING:
+        BOOST_CHECK_EQUAL(
+            string( compiled->r.str ?
+                    reinterpret_cast< const char* >( compiled->r.str ) : "" ),
+            string( interpreted->r.str ?
+                    reinterpret_cast< const char* >( interpreted->r.str ) : "" ) );
+        break;
+    case XP_RT_BOOLEAN:
+        BOOST_CHECK_EQUAL( compiled->r.boo, interpreted->r.boo );
+        break;
+    default:
+        BOOST_FAIL( "unexpected result type" );
+    }
+}
+
+// ---------------------------------------------------------------------------|
+size_t XPathCompileFixture::checkSameResult( const string& expr,
+                                             const string& contextExpr )
+{
+    BOOST_TEST_MESSAGE( "\tChecking " << expr );
+
+    val_value_t* context = getNode( contextExpr.empty() ? "/xct:top" :
+                                    contextExpr );
+
+    xpath_pcb_t* pcb = newPcb( expr, context );
+    xpath_pcb_t* nocomppcb = newPcb( expr, context );
+    nocomppcb->flags |= XP_FL_NOCOMPILE;
+
+    // the expression is compiled by its second evaluation
+    xpath_result_t* compiled = NULL;
+    status_t res = NO_ERR;
+    for ( uint32 i = 0; i < XPATH_COMPILE_MIN_EVALS; ++i )
+    {
+        if ( compiled )
+        {
+            xpath_free_result( compiled );
+        }
+        res = NO_ERR;
+        compiled = xpath1_eval_expr( pcb, context, root_, FALSE, TRUE, &res );
+    }
+    BOOST_CHECK_MESSAGE( pcb->comp != NULL, "not compiled: " << expr );
+
+    status_t nocompres = NO_ERR;
+    xpath_result_t* interpreted = xpath1_eval_expr( nocomppcb, context,
+                                                    root_, FALSE, TRUE,
+                                                    &nocompres );
+    BOOST_CHECK( nocomppcb->comp == NULL );
+    BOOST_CHECK_EQUAL( res, nocompres );
+
+    size_t count = 0;
+    if ( compiled && interpreted )
+    {
+        checkResults( compiled, interpreted );
+        if ( compiled->restype == XP_RT_NODESET )
+        {
+            for ( xpath_resnode_t* resnode = xpath_get_first_resnode( compiled );
+                  resnode != NULL;
+                  resnode = xpath_get_next_resnode( resnode ) )
+            {
+                ++count;
+            }
+        }
+    }
+    else
+    {
+        BOOST_CHECK_MESSAGE( compiled == NULL && interpreted == NULL,
+                             "only one result for " << expr );
+    }
+
+    if ( compiled )
+    {
+        xpath_free_result( compiled );
+    }
+    if ( interpreted )
+    {
+        xpath_free_result( interpreted );
+    }
+    xpath_free_pcb( pcb );
+    xpath_free_pcb( nocomppcb );
+    return count;
+}
+
+} // namespace YumaTest
@@ -0,0 +1,107 @@
+#ifndef __YUMA_XPATH_COMPILE_TEST_FIXTURE__H
+#define __YUMA_XPATH_COMPILE_TEST_FIXTURE__H
+
+// ---------------------------------------------------------------------------|
+// Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/query-suite-fixture.h"
+
+// ---------------------------------------------------------------------------|
+// Standard includes
+// ---------------------------------------------------------------------------|
+#include <vector>
+#include <string>
+#include <utility>
+
+// ---------------------------------------------------------------------------|
+// Yuma includes
+// ---------------------------------------------------------------------------|
+#include "ncxtypes.h"
+#include "val.h"
+#include "xpath.h"
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest
+{
+
+// ---------------------------------------------------------------------------|
+/**
+ * This class is used to check that XPath expressions evaluated
+ * against the running config of the xpath_compile_test module give
+ * the same result through the compiled evaluator, including its key
+ * lookups, as through the interpreter (XP_FL_NOCOMPILE).
+ */
+struct XPathCompileFixture : public QuerySuiteFixture
+{
+public:
+    /**
+     * Constructor. Load the module and its test data.
+     */
+    XPathCompileFixture();
+
+    /**
+     * Destructor. Shutdown the test.
+     */
+    ~XPathCompileFixture();
+
+    /**
+     * Bind a string variable for the expressions checked after
+     * this call.
+     *
+     * \param name the variable name, without the '$'
+     * \param value the string value of the variable
+     */
+    void setVariable( const std::string& name, const std::string& value );
+
+    /**
+     * Evaluate an expression twice so the second evaluation is
+     * compiled, and once with XP_FL_NOCOMPILE, and check that both
+     * results are the same.  Node-sets must hold the same nodes in
+     * the same order.
+     *
+     * \param expr the expression, with xct prefixes
+     * \param contextExpr an expression selecting the context node;
+     *                    the top container if empty
+     * \return the number of nodes in a node-set result, 0 otherwise
+     */
+    size_t checkSameResult( const std::string& expr,
+                            const std::string& contextExpr = "" );
+
+private:
+    /**
+     * Parse and validate an expression for a context node.
+     *
+     * \param expr the expression
+     * \param context the context node
+     * \return the new pcb, to free with xpath_free_pcb
+     */
+    xpath_pcb_t* newPcb( const std::string& expr, val_value_t* context );
+
+    /**
+     * Evaluate an expression that selects one node.
+     *
+     * \param expr the expression
+     * \return the node found
+     */
+    val_value_t* getNode( const std::string& expr );
+
+    /**
+     * Check that two results are the same.
+     *
+     * \param compiled the result of the compiled evaluation
+     * \param interpreted the result of the interpreted evaluation
+     */
+    void checkResults( xpath_result_t* compiled,
+                       xpath_result_t* interpreted );
+
+    const std::string moduleNs_;        ///< the module namespace
+    ncx_module_t* mod_;                 ///< the module for the prefixes
+    val_value_t* root_;                 ///< the running config root
+
+    /** the string variables bound to each expression */
+    std::vector< std::pair< std::string, std::string > > variables_;
+};
+
+} // namespace YumaTest
+
+#endif // __YUMA_XPATH_COMPILE_TEST_FIXTURE__H
@@ -8,4 +8,6 @@ YUMA_TEST_SUPPORT_SOURCES := \
        $(YUMA_TEST_ROOT)/support/callbacks/integ-cb-checker-factory.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/integ-fixture-helper.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/integ-fixture-helper-factory.cpp \
+       $(YUMA_TEST_ROOT)/support/fixtures/arena-edit-fixture.cpp \
+       $(YUMA_TEST_ROOT)/support/fixtures/xpath-compile-fixture.cpp \
 
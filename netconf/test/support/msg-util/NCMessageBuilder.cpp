@@ -26,7 +26,9 @@ namespace YumaTest
 {
 
 // ---------------------------------------------------------------------------!
-NCMessageBuilder::NCMessageBuilder() : defaultOperation_( "merge" )
+NCMessageBuilder::NCMessageBuilder() 
+    : defaultOperation_( "merge" )
+    , testOption_( "" )
 {
 }
 
@@ -47,6 +49,18 @@ const std::string NCMessageBuilder::getDefaultOperation() const
     return defaultOperation_;
 }
 
+// ---------------------------------------------------------------------------!
+void NCMessageBuilder::setTestOption( const string& testOption )
+{
+    testOption_ = testOption;
+}
+
+// ---------------------------------------------------------------------------!
+const std::string NCMessageBuilder::getTestOption() const
+{
+    return testOption_;
+}
+
 // ---------------------------------------------------------------------------!
 string NCMessageBuilder::genXmlNsText( const string& xmlnsArg, 
                                        const string& ns ) const
@@ -255,8 +269,12 @@ string NCMessageBuilder::buildEditConfigMessage( const string& configChange,
     query << "  <edit-config " << genXmlNsText( IETF_NS ) << ">\n"
           << "    <target> " << "<" << target << "/> " << "</target>\n"
           << "    <default-operation>" << defaultOperation_ 
-              << "</default-operation>\n"
-          << "    <config>\n"
+              << "</default-operation>\n";
+    if ( !testOption_.empty() )
+    {
+        query << "    <test-option>" << testOption_ << "</test-option>\n";
+    }
+    query << "    <config>\n"
           << "      " << configChange << "\n"
           << "    </config>\n"
           << "  </edit-config>";
@@ -325,6 +325,21 @@ public:
      */
     const std::string getDefaultOperation() const;
 
+    /**
+     * Set the edit test option. An empty string leaves the
+     * test-option out of the 'edit-config' message.
+     *
+     * \param testOption the new test option
+     */
+    void setTestOption( const std::string& testOption );
+
+    /**
+     * Get the edit test option.
+     *
+     * \return the current test option
+     */
+    const std::string getTestOption() const;
+
     /**
      * Utility function for generating text for 'edit-config' operations.
      *
@@ -493,6 +508,7 @@ protected:
 
 protected:
     std::string defaultOperation_; ///< The default edit operation
+    std::string testOption_; ///< The edit test option
 };
 
 } // namespace YumaTest
@@ -23,6 +23,7 @@ YUMA_COMMON_TEST_SUPPORT_SOURCES := \
        $(YUMA_TEST_ROOT)/support/fixtures/query-suite-fixture.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/simple-container-module-fixture.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/simple-yang-fixture.cpp \
+       $(YUMA_TEST_ROOT)/support/fixtures/commit-deps-fixture.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/device-module-fixture.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/device-get-module-fixture.cpp \
        $(YUMA_TEST_ROOT)/support/fixtures/device-module-common-fixture.cpp \
@@ -0,0 +1,143 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/commit-deps-fixture.h"
+#include "test/support/misc-util/log-utils.h"
+#include "test/support/nc-query-util/nc-query-test-engine.h"
+
+// ---------------------------------------------------------------------------|
+// Yuma includes for files under test
+// ---------------------------------------------------------------------------|
+
+// ---------------------------------------------------------------------------|
+// File wide namespace use
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( commit_deps, CommitDepsFixture )
+
+BOOST_AUTO_TEST_CASE( edit_sibling_leaf )
+{
+    DisplayTestDescrption( 
+            "Demonstrate that editing a leaf read by the must statement "
+            "of a sibling leaf is rejected.",
+            "Procedure: \n"
+            "\t1 - Create limits with max 10 and cur 5\n"
+            "\t2 - Check that setting max to 4 is rejected\n"
+            "\t3 - Remove the limits container\n"
+            );
+
+    // RAII Vector of database locks 
+    vector< unique_ptr< NCDbScopedLock > > locks = getFullLock( primarySession_ );
+
+    applyValidConfig( primarySession_, genContainerText( "limits",
+            messageBuilder_->genOperationText( "max", "10", "" ) +
+            messageBuilder_->genOperationText( "cur", "5", "" ) ) );
+
+    checkRejectedEdit( primarySession_, genContainerText( "limits",
+            messageBuilder_->genOperationText( "max", "4", "" ) ),
+            "cur must not exceed max" );
+
+    removeContainers( primarySession_, { "limits" } );
+}
+
+BOOST_AUTO_TEST_CASE( delete_list_entry_on_path_step )
+{
+    DisplayTestDescrption( 
+            "Demonstrate that deleting a list entry that is only a path "
+            "step of a must statement elsewhere is rejected.",
+            "Procedure: \n"
+            "\t1 - Create a sized slot and a user that needs one\n"
+            "\t2 - Check that deleting the slot entry is rejected\n"
+            "\t3 - Remove the user and pool containers\n"
+            );
+
+    // RAII Vector of database locks 
+    vector< unique_ptr< NCDbScopedLock > > locks = getFullLock( primarySession_ );
+
+    applyValidConfig( primarySession_, 
+            genContainerText( "pool", "<slot><id>1</id><size>3</size></slot>" ) +
+            genContainerText( "user", 
+                messageBuilder_->genOperationText( "needs-size", "", "" ) ) );
+
+    checkRejectedEdit( primarySession_, genContainerText( "pool",
+            messageBuilder_->genKeyOperationText( "slot", "id", "1", 
+                                                  "delete" ) ),
+            "a sized slot is required" );
+
+    removeContainers( primarySession_, { "user", "pool" } );
+}
+
+BOOST_AUTO_TEST_CASE( delete_top_level_container )
+{
+    DisplayTestDescrption( 
+            "Demonstrate that deleting a top level container read by a "
+            "must statement in another container is rejected.",
+            "Procedure: \n"
+            "\t1 - Create the feature and a client that uses it\n"
+            "\t2 - Check that deleting the feature is rejected\n"
+            "\t3 - Remove the client and feature containers\n"
+            );
+
+    // RAII Vector of database locks 
+    vector< unique_ptr< NCDbScopedLock > > locks = getFullLock( primarySession_ );
+
+    applyValidConfig( primarySession_, 
+            genContainerText( "feature", "" ) +
+            genContainerText( "client", 
+                messageBuilder_->genOperationText( "uses-feature", "", "" ) ) );
+
+    checkRejectedEdit( primarySession_, 
+            messageBuilder_->genTopLevelContainerText( "feature", moduleNs_,
+                                                       "delete" ),
+            "the feature is not enabled" );
+
+    removeContainers( primarySession_, { "client", "feature" } );
+}
+
+BOOST_AUTO_TEST_CASE( false_when_cascade )
+{
+    DisplayTestDescrption( 
+            "Demonstrate that a node removed by a false when statement "
+            "is seen by a must statement that reads it.",
+            "Procedure: \n"
+            "\t1 - Turn the mode on with tuning and require tuning\n"
+            "\t2 - Check that turning the mode off is rejected\n"
+            "\t3 - Remove the tuned and mode containers\n"
+            );
+
+    // RAII Vector of database locks 
+    vector< unique_ptr< NCDbScopedLock > > locks = getFullLock( primarySession_ );
+
+    applyValidConfig( primarySession_, 
+            genContainerText( "mode",
+                messageBuilder_->genOperationText( "on", "true", "" ) +
+                messageBuilder_->genOperationText( "tuning", "7", "" ) ) +
+            genContainerText( "tuned", 
+                messageBuilder_->genOperationText( "needs-tuning", "", "" ) ) );
+
+    checkRejectedEdit( primarySession_, genContainerText( "mode",
+            messageBuilder_->genOperationText( "on", "false", "" ) ),
+            "tuning is not set" );
+
+    removeContainers( primarySession_, { "tuned", "mode" } );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest
@@ -0,0 +1,137 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Standard Includes
+// ---------------------------------------------------------------------------|
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/arena-edit-fixture.h"
+#include "test/support/checkers/string-presence-checkers.h"
+#include "test/support/misc-util/log-utils.h"
+#include "test/support/msg-util/NCMessageBuilder.h"
+#include "test/support/nc-query-util/nc-query-test-engine.h"
+
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+// The <edit-config> input is parsed into the message arena, which is
+// released when the reply has been sent.  These tests edit the running
+// config and then read and edit the new nodes again in later requests.
+// Build the harness with SANITIZE=1 to run them under AddressSanitizer
+// with every arena chunk in its own block, so any node left pointing
+// into a released arena is reported.
+// ---------------------------------------------------------------------------|
+namespace
+{
+
+const string NC_NS( "urn:ietf:params:xml:ns:netconf:base:1.0" );
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( ArenaEditTests, ArenaEditFixture )
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( edited_nodes_outlive_request )
+{
+    DisplayTestDescrption(
+            "Check nodes added by <edit-config> stay valid after the "
+            "request that parsed them is freed",
+            "Procedure: \n"
+            "\t 1 - Create list entries, a leaf-list entry and a\n"
+            "\t     list entry with operation create\n"
+            "\t 2 - Check no node of the running config came from the\n"
+            "\t     message arena and get the new entries\n"
+            "\t 3 - Merge a leaf into one new entry and replace another\n"
+            "\t 4 - Check again and get the edited entries\n"
+            "\t 5 - Delete the new entries and check they are gone\n"
+            );
+
+    // 1 - create
+    ostringstream create;
+    for ( int i = 0; i < 4; ++i )
+    {
+        create << "<item><name>arena" << i << "</name>"
+               << "<a>" << 100 + i << "</a><b>x" << i << "</b></item>";
+    }
+    create << "<num xmlns:nc=\"" << NC_NS << "\" nc:operation=\"create\">"
+           << "<id>500</id><val>n500</val></num>"
+           << "<refs><names>arena-name</names></refs>";
+    editTop( create.str() );
+
+    // 2 - the nodes are in running, and are not arena nodes
+    checkRunningHasNoArenaNodes();
+
+    vector< string > created{ "<name>arena0</name>", "<b>x0</b>",
+                              "<name>arena3</name>", "<a>103</a>",
+                              "<val>n500</val>", "arena-name" };
+    StringPresenceChecker createdChecker( created );
+    queryEngine_->tryGetConfigXpath( primarySession_,
+                                     "//item[starts-with(name,'arena')] | "
+                                     "//num[id=500] | //refs/names",
+                                     writeableDbName_, createdChecker );
+
+    // 3 - edit the nodes added by the first request
+    ostringstream edit;
+    edit << "<item><name>arena0</name><b>y0</b></item>"
+         << "<item xmlns:nc=\"" << NC_NS << "\" nc:operation=\"replace\">"
+         << "<name>arena1</name><a>201</a></item>"
+         << "<num><id>500</id><val>m500</val></num>";
+    editTop( edit.str() );
+
+    // 4 - check the edits
+    checkRunningHasNoArenaNodes();
+
+    vector< string > edited{ "<b>y0</b>", "<a>201</a>", "<val>m500</val>",
+                             "<b>x2</b>" };
+    vector< string > replaced{ "<b>x0</b>", "<b>x1</b>", "<a>101</a>",
+                               "<val>n500</val>" };
+    StringsPresentNotPresentChecker editedChecker( edited, replaced );
+    queryEngine_->tryGetConfigXpath( primarySession_,
+                                     "//item[starts-with(name,'arena')] | "
+                                     "//num[id=500]",
+                                     writeableDbName_, editedChecker );
+
+    // 5 - delete the new nodes again
+    ostringstream remove;
+    for ( int i = 0; i < 4; ++i )
+    {
+        ostringstream name;
+        name << "arena" << i;
+        remove << messageBuilder_->genKeyOperationText( "item", "name",
+                                                        name.str(),
+                                                        "delete" );
+    }
+    remove << messageBuilder_->genKeyOperationText( "num", "id", "500",
+                                                    "delete" )
+           << "<refs>"
+           << messageBuilder_->genOperationText( "names", "arena-name",
+                                                 "delete" )
+           << "</refs>";
+    editTop( remove.str() );
+
+    checkRunningHasNoArenaNodes();
+
+    vector< string > none;
+    vector< string > removed{ "<name>arena", "arena-name", "n500",
+                              "m500" };
+    StringsPresentNotPresentChecker removedChecker( none, removed );
+    queryEngine_->tryGetConfigXpath( primarySession_, "/top",
+                                     writeableDbName_, removedChecker );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest
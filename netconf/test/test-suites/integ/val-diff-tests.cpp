@@ -0,0 +1,178 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Standard Includes
+// ---------------------------------------------------------------------------|
+#include <sstream>
+#include <string>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/base-suite-fixture.h"
+#include "test/support/misc-util/log-utils.h"
+#include "dlq.h"
+#include "status.h"
+#include "val.h"
+#include "val_diff.h"
+#include "xml_val.h"
+
+// ---------------------------------------------------------------------------|
+using namespace std;
+using namespace YumaTest;
+
+// ---------------------------------------------------------------------------|
+namespace
+{
+
+const xmlChar* xstr( const char* str )
+{
+    return reinterpret_cast< const xmlChar* >( str );
+}
+
+// build <top><c0><leaf>v0</leaf></c0>...</top> with distinct child names
+val_value_t* makeTree( int count )
+{
+    val_value_t* top = xml_val_new_struct( xstr( "top" ), 0 );
+    for ( int i = 0; i < count; ++i )
+    {
+        ostringstream name, value;
+        name << "c" << i;
+        value << "v" << i;
+        // val_set_name keeps a malloced copy of the name
+        val_value_t* child = xml_val_new_struct( xstr( "c" ), 0 );
+        val_set_name( child, xstr( name.str().c_str() ),
+                      name.str().size() );
+        val_add_child( xml_val_new_cstring( xstr( "leaf" ), 0,
+                                            xstr( value.str().c_str() ) ),
+                       child );
+        val_add_child( child, top );
+    }
+    return top;
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( ValDiffTests, BaseSuiteFixture )
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( digest_matches_clone )
+{
+    DisplayTestDescrption(
+            "Check equal subtrees have equal digests",
+            "Procedure: \n"
+            "\t 1 - Build a tree and clone it\n"
+            "\t 2 - Check the digests match and are cached\n"
+            );
+
+    val_value_t* tree = makeTree( 5 );
+    val_value_t* copy = val_clone( tree );
+    BOOST_REQUIRE( copy != NULL );
+
+    BOOST_CHECK_EQUAL( VAL_DIGEST( copy ), 0u );
+    BOOST_CHECK( val_get_digest( tree ) != 0 );
+    BOOST_CHECK_EQUAL( val_get_digest( tree ), val_get_digest( copy ) );
+    BOOST_CHECK_EQUAL( VAL_DIGEST( copy ), val_get_digest( copy ) );
+    BOOST_CHECK_EQUAL( val_compare( tree, copy ), 0 );
+
+    val_free_value( tree );
+    val_free_value( copy );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( digest_cleared_on_edit )
+{
+    DisplayTestDescrption(
+            "Check an edit discards the cached digests above it",
+            "Procedure: \n"
+            "\t 1 - Cache the digest of a cloned tree\n"
+            "\t 2 - Change a leaf and check the ancestors are uncached\n"
+            "\t 3 - Check the new digest and val_compare both differ\n"
+            );
+
+    val_value_t* tree = makeTree( 5 );
+    val_value_t* copy = val_clone( tree );
+    uint64 digest = val_get_digest( copy );
+    val_get_digest( tree );
+
+    val_value_t* child = val_get_first_child( copy );
+    val_value_t* leaf = val_get_first_child( child );
+    BOOST_REQUIRE( leaf != NULL );
+    BOOST_CHECK( VAL_DIGEST( child ) != 0 );
+
+    BOOST_CHECK_EQUAL( val_set_simval( leaf, leaf->typdef, 0, NULL,
+                                       xstr( "changed" ) ), NO_ERR );
+    BOOST_CHECK_EQUAL( VAL_DIGEST( child ), 0u );
+    BOOST_CHECK_EQUAL( VAL_DIGEST( copy ), 0u );
+    BOOST_CHECK( val_get_digest( copy ) != digest );
+    BOOST_CHECK( val_compare( tree, copy ) != 0 );
+
+    val_free_value( tree );
+    val_free_value( copy );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( diff_reports_changes_only )
+{
+    DisplayTestDescrption(
+            "Check val_diff_trees reports just the changed nodes",
+            "Procedure: \n"
+            "\t 1 - Clone a tree, change one leaf, add and remove a child\n"
+            "\t 2 - Check one modify, one create and one delete are found\n"
+            );
+
+    val_value_t* tree = makeTree( 50 );
+    val_value_t* copy = val_clone( tree );
+
+    val_value_t* child = val_get_first_child( copy );
+    val_value_t* leaf = val_get_first_child( child );
+    val_set_simval( leaf, leaf->typdef, 0, NULL, xstr( "changed" ) );
+
+    val_value_t* last = val_get_next_child( child );
+    val_remove_child( last );
+    val_free_value( last );
+
+    val_add_child( xml_val_new_struct( xstr( "extra" ), 0 ), copy );
+
+    dlq_hdr_t diffQ;
+    dlq_createSQue( &diffQ );
+    BOOST_REQUIRE_EQUAL( val_diff_trees( NULL, tree, copy, FALSE, &diffQ ),
+                         NO_ERR );
+    BOOST_CHECK_EQUAL( dlq_count( &diffQ ), 3 );
+
+    int creates = 0, deletes = 0, modifies = 0;
+    for ( val_diff_t* diff = (val_diff_t*)dlq_firstEntry( &diffQ );
+          diff != NULL;
+          diff = (val_diff_t*)dlq_nextEntry( diff ) )
+    {
+        BOOST_CHECK( diff->path != NULL );
+        creates += ( diff->op == VAL_DIFF_CREATE );
+        deletes += ( diff->op == VAL_DIFF_DELETE );
+        modifies += ( diff->op == VAL_DIFF_MODIFY );
+    }
+    BOOST_CHECK_EQUAL( creates, 1 );
+    BOOST_CHECK_EQUAL( deletes, 1 );
+    BOOST_CHECK_EQUAL( modifies, 1 );
+    val_clean_diffQ( &diffQ );
+
+    // no changes the other way round once the trees match again
+    val_free_value( copy );
+    copy = val_clone( tree );
+    BOOST_REQUIRE_EQUAL( val_diff_trees( NULL, copy, tree, FALSE, &diffQ ),
+                         NO_ERR );
+    BOOST_CHECK( dlq_empty( &diffQ ) );
+
+    val_free_value( tree );
+    val_free_value( copy );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest
@@ -0,0 +1,139 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Standard Includes
+// ---------------------------------------------------------------------------|
+#include <malloc.h>
+#include <vector>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/base-suite-fixture.h"
+#include "test/support/misc-util/log-utils.h"
+#include "ncx.h"
+#include "status.h"
+#include "val.h"
+#include "xml_util.h"
+
+// ---------------------------------------------------------------------------|
+using namespace std;
+using namespace YumaTest;
+
+// ---------------------------------------------------------------------------|
+namespace
+{
+
+// number of leaf nodes used for the heap measurement
+const size_t LEAF_COUNT = 100000;
+
+// allow for the malloc chunk header and alignment
+const size_t MALLOC_OVERHEAD = 16;
+
+// val_value_t was 264 bytes before the rarely-used fields
+// were moved into val_extra_t
+const size_t OLD_VAL_SIZE = 264;
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( ValMemoryTests, BaseSuiteFixture )
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( leaf_node_size )
+{
+    DisplayTestDescrption(
+            "Report the size of the val_value_t node struct",
+            "Procedure: \n"
+            "\t 1 - Check the core node is smaller than the old layout\n"
+            );
+
+    BOOST_TEST_MESSAGE( "sizeof(val_value_t) before: " << OLD_VAL_SIZE );
+    BOOST_TEST_MESSAGE( "sizeof(val_value_t) after:  "
+                        << sizeof( val_value_t ) );
+    BOOST_TEST_MESSAGE( "sizeof(val_extra_t):        "
+                        << sizeof( val_extra_t ) );
+
+    BOOST_CHECK( sizeof( val_value_t ) <= 160 );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( leaf_heap_usage )
+{
+    DisplayTestDescrption(
+            "Report the heap bytes used per plain leaf node",
+            "Procedure: \n"
+            "\t 1 - Create many string leafs from the generic template\n"
+            "\t 2 - Check no extension block was allocated\n"
+            "\t 3 - Check the heap bytes used per leaf\n"
+            );
+
+    obj_template_t *obj = ncx_get_gen_string();
+    BOOST_REQUIRE( obj != NULL );
+
+    vector< val_value_t* > leafs;
+    leafs.reserve( LEAF_COUNT );
+
+    struct mallinfo2 before = mallinfo2();
+    for ( size_t i = 0; i < LEAF_COUNT; ++i )
+    {
+        val_value_t *val = val_new_value();
+        BOOST_REQUIRE( val != NULL );
+        val_init_from_template( val, obj );
+        leafs.push_back( val );
+    }
+    struct mallinfo2 after = mallinfo2();
+
+    size_t perLeaf = ( after.uordblks - before.uordblks ) / LEAF_COUNT;
+    BOOST_TEST_MESSAGE( "heap bytes per leaf before: "
+                        << OLD_VAL_SIZE + MALLOC_OVERHEAD );
+    BOOST_TEST_MESSAGE( "heap bytes per leaf after:  " << perLeaf );
+
+    BOOST_CHECK( perLeaf <= sizeof( val_value_t ) + MALLOC_OVERHEAD );
+
+    for ( size_t i = 0; i < LEAF_COUNT; ++i )
+    {
+        BOOST_CHECK( leafs[i]->extra == NULL );
+        val_free_value( leafs[i] );
+    }
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( extra_block_on_demand )
+{
+    DisplayTestDescrption(
+            "Check the extension block is only allocated when needed",
+            "Procedure: \n"
+            "\t 1 - Create a leaf and check it has no extension block\n"
+            "\t 2 - Give it a malloced name and check the block exists\n"
+            );
+
+    val_value_t *val = val_new_value();
+    BOOST_REQUIRE( val != NULL );
+    val_init_from_template( val, ncx_get_gen_string() );
+
+    BOOST_CHECK( val->extra == NULL );
+    BOOST_CHECK( VAL_DNAME( val ) == NULL );
+    BOOST_CHECK( val_get_metaQ( val ) == NULL );
+    BOOST_CHECK( val_meta_empty( val ) );
+
+    const xmlChar *name = reinterpret_cast< const xmlChar* >( "leaf-x" );
+    val_set_name( val, name, xml_strlen( name ) );
+
+    BOOST_REQUIRE( val->extra != NULL );
+    BOOST_CHECK( VAL_DNAME( val ) == val->name );
+    BOOST_CHECK( val_get_metaQ( val ) != NULL );
+    BOOST_CHECK( val_meta_empty( val ) );
+
+    val_free_value( val );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest
@@ -0,0 +1,234 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Standard Includes
+// ---------------------------------------------------------------------------|
+#include <string>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/xpath-compile-fixture.h"
+#include "test/support/misc-util/log-utils.h"
+
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( XPathCompileTests, XPathCompileFixture )
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( positional_predicates )
+{
+    DisplayTestDescrption(
+            "Check predicates using position() and last() give the same "
+            "nodes compiled and interpreted",
+            "Procedure: \n"
+            "\t 1 - Select list entries by position and by last()\n"
+            "\t 2 - Check positions after a filtering predicate\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[3]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[position() = 3]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[position() < 4]" ), 3u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[last()]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[position() = last() - 1]/xct:name" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[99]" ), 0u );
+
+    // positions after a filtering predicate, and position() used in
+    // arithmetic, are whatever the interpreter gives; only the two
+    // paths are compared
+    checkSameResult( "xct:item[xct:a > 30][1]" );
+    checkSameResult( "xct:item[xct:a > 30][last()]" );
+    checkSameResult( "xct:item[last()][1]" );
+    checkSameResult( "xct:item[position() mod 10 = 0]" );
+    checkSameResult( "xct:pair[xct:a = 'p3'][position() = 2]" );
+    checkSameResult( "count(xct:item[position() > last() - 5])" );
+
+    // the interpreter selects nothing by position in a list with a
+    // numeric key; again only the two paths are compared
+    checkSameResult( "xct:num[2]" );
+    checkSameResult( "xct:pair[last()][1]" );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( unions )
+{
+    DisplayTestDescrption(
+            "Check unions give the same nodes in the same order",
+            "Procedure: \n"
+            "\t 1 - Join node-sets of different lists and leaves\n"
+            "\t 2 - Join node-sets that overlap\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:a < 3] | xct:num[xct:id < 3]" ), 5u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item/xct:a | xct:item/xct:b" ), 80u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num | xct:num" ), 40u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:a < 5] | xct:item[xct:a > 2 and xct:a < 8]" ), 8u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:refs/xct:names | xct:refs/xct:ifname | xct:refs" ), 5u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "//xct:val | //xct:small" ), 81u );
+    checkSameResult( "count(xct:pair[xct:b = '1'] | xct:pair[xct:a = 'p1'])" );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( parent_after_filter )
+{
+    DisplayTestDescrption(
+            "Check a '..' step after a filter expression",
+            "Procedure: \n"
+            "\t 1 - Select the parent of a filtered node-set\n"
+            "\t 2 - Continue the path from the parent\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult( "(xct:item[xct:a > 30])/.." ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "(xct:item[xct:a > 30])/../xct:refs/xct:small" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "(xct:item)[3]/../xct:refs" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "(xct:item/xct:a)[. = 7]/../xct:b" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "(xct:item[xct:a > 99])/.." ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "(xct:refs/xct:names)/../../xct:item[1]" ), 1u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( variables )
+{
+    DisplayTestDescrption(
+            "Check variable references give the same results",
+            "Procedure: \n"
+            "\t 1 - Bind string variables\n"
+            "\t 2 - Use them as values and in predicates\n"
+            );
+
+    setVariable( "name", "item5" );
+    setVariable( "id", "12" );
+
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[xct:name = $name]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = $id]/xct:val" ),
+                       1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:name = $name or xct:a = $id]" ), 2u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:a = $id + 1]" ), 1u );
+    checkSameResult( "$name" );
+    checkSameResult( "$name != 'item5'" );
+    checkSameResult( "$id * 2 = 24" );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( current_node )
+{
+    DisplayTestDescrption(
+            "Check current() with a context node below the top",
+            "Procedure: \n"
+            "\t 1 - Evaluate with a leaf and a container as context\n"
+            "\t 2 - Use current() in paths and in predicates\n"
+            );
+
+    const string refs( "/xct:top/xct:refs" );
+    const string leaf( "/xct:top/xct:item[xct:name = 'item4']/xct:a" );
+
+    BOOST_CHECK_EQUAL( checkSameResult( "current()", refs ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "current()/xct:names", refs ), 3u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "../xct:item[xct:name = current()/xct:names]/xct:a", refs ), 3u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "../xct:pair[xct:b = current()/xct:small]", refs ), 10u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "../../xct:num[xct:id = current()]", leaf ), 1u );
+    checkSameResult( "../../xct:item[xct:a > current()]", leaf );
+    checkSameResult( "current() + 1", leaf );
+    checkSameResult( "count(current()/../../xct:item)", leaf );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( function_table )
+{
+    DisplayTestDescrption(
+            "Check every function in the function table gives the same "
+            "result compiled and interpreted",
+            "Procedure: \n"
+            "\t 1 - Call each function with node-set and literal arguments\n"
+            "\t 2 - Check the results match\n"
+            );
+
+    // node-set functions
+    checkSameResult( "count(xct:item)" );
+    checkSameResult( "last()" );
+    checkSameResult( "position()" );
+    checkSameResult( "id('item3')" );
+    checkSameResult( "local-name(xct:refs)" );
+    checkSameResult( "local-name()" );
+    checkSameResult( "name(xct:item)" );
+    checkSameResult( "name()" );
+    checkSameResult( "namespace-uri(xct:num)" );
+    checkSameResult( "namespace-uri()" );
+    BOOST_CHECK_EQUAL( checkSameResult( "current()" ), 1u );
+
+    // string functions
+    checkSameResult( "string(xct:item[3]/xct:b)" );
+    checkSameResult( "string()" );
+    checkSameResult( "concat(xct:refs/xct:ifname, '-', xct:num[2]/xct:id)" );
+    checkSameResult( "starts-with(xct:refs/xct:ifname, 'item')" );
+    checkSameResult( "contains(xct:refs/xct:ifname, 'em7')" );
+    checkSameResult( "substring-before(xct:refs/xct:ifname, 'm')" );
+    checkSameResult( "substring-after(xct:refs/xct:ifname, 'e')" );
+    checkSameResult( "substring(xct:refs/xct:ifname, 2, 3)" );
+    checkSameResult( "substring(xct:refs/xct:ifname, 3)" );
+    checkSameResult( "string-length(xct:refs/xct:ifname)" );
+    checkSameResult( "string-length()" );
+    checkSameResult( "normalize-space('  a   b  ')" );
+    checkSameResult( "normalize-space()" );
+    checkSameResult( "translate(xct:refs/xct:ifname, 'itm', 'ITM')" );
+
+    // boolean functions
+    checkSameResult( "boolean(xct:item[xct:a = 3])" );
+    checkSameResult( "boolean(xct:refs/xct:unset)" );
+    checkSameResult( "not(xct:refs/xct:unset)" );
+    checkSameResult( "true()" );
+    checkSameResult( "false()" );
+    checkSameResult( "lang('en')" );
+
+    // number functions
+    checkSameResult( "number(xct:refs/xct:small)" );
+    checkSameResult( "number(xct:refs/xct:ifname)" );
+    checkSameResult( "number()" );
+    checkSameResult( "sum(xct:item/xct:a)" );
+    checkSameResult( "sum(xct:item/xct:b)" );
+    checkSameResult( "floor(xct:refs/xct:small div 3)" );
+    checkSameResult( "ceiling(xct:refs/xct:small div 3)" );
+    checkSameResult( "round(xct:refs/xct:small div 4)" );
+    checkSameResult( "round(-1 div 2)" );
+    checkSameResult( "round(5 div 2)" );
+
+    // YANG and yuma extensions
+    checkSameResult( "module-loaded('xpath_compile_test')" );
+    checkSameResult( "module-loaded('no-such-module')" );
+    checkSameResult( "feature-enabled('xpath_compile_test', 'nosuch')" );
+
+    // functions as predicates and path starts
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[contains(xct:b, '3')]" ), 13u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[string-length(xct:name) = 5]" ), 10u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "current()/xct:item[not(xct:a > 2)]" ), 3u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest
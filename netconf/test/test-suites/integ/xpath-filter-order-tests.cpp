@@ -0,0 +1,97 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Standard Includes
+// ---------------------------------------------------------------------------|
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/xpath-compile-fixture.h"
+#include "test/support/checkers/string-presence-checkers.h"
+#include "test/support/misc-util/log-utils.h"
+#include "test/support/nc-query-util/nc-query-test-engine.h"
+
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace
+{
+
+/**
+ * Get the leaves of every item entry in the order the entries are
+ * kept in the running config: the list is ordered by the system,
+ * so by the string value of its key.
+ *
+ * \return the name, a and b leaves of each entry in document order
+ */
+vector< string > itemLeavesInDocOrder()
+{
+    vector< string > names;
+    for ( int i = 0; i < 40; ++i )
+    {
+        ostringstream name;
+        name << "item" << i;
+        names.push_back( name.str() );
+    }
+    sort( names.begin(), names.end() );
+
+    vector< string > leaves;
+    for ( vector< string >::const_iterator it = names.begin();
+          it != names.end(); ++it )
+    {
+        const string num = it->substr( 4 );
+        leaves.push_back( "<name>" + *it + "</name>" );
+        leaves.push_back( "<a>" + num + "</a>" );
+        leaves.push_back( "<b>b" + num + "</b>" );
+    }
+    return leaves;
+}
+
+} // anonymous namespace
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( XPathFilterOrderTests, XPathCompileFixture )
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( union_of_interleaved_siblings )
+{
+    DisplayTestDescrption(
+            "Check a <get> with an XPath filter joining two sibling "
+            "leaves returns them in document order, once each",
+            "Procedure: \n"
+            "\t 1 - Get '//a | //b' over list entries holding a and b\n"
+            "\t 2 - Check each entry's a follows its key and precedes its b,\n"
+            "\t     and no entry or leaf is repeated\n"
+            "\t 3 - Repeat with the union operands swapped and with an\n"
+            "\t     operand repeated\n"
+            );
+
+    const vector< string > expOrder = itemLeavesInDocOrder();
+    StringOrderChecker checker( expOrder );
+
+    queryEngine_->tryGetXpath( primarySession_, "//a | //b",
+                               writeableDbName_, checker );
+    queryEngine_->tryGetXpath( primarySession_, "//b | //a",
+                               writeableDbName_, checker );
+    queryEngine_->tryGetXpath( primarySession_, "//a | //b | //a",
+                               writeableDbName_, checker );
+    queryEngine_->tryGetXpath( primarySession_,
+                               "/top/item/b | //a | /top/item[a > 9]/b",
+                               writeableDbName_, checker );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest
@@ -0,0 +1,135 @@
+// ---------------------------------------------------------------------------|
+// Boost Test Framework
+// ---------------------------------------------------------------------------|
+#include <boost/test/unit_test.hpp>
+
+// ---------------------------------------------------------------------------|
+// Standard Includes
+// ---------------------------------------------------------------------------|
+#include <string>
+
+// ---------------------------------------------------------------------------|
+// Yuma Test Harness includes
+// ---------------------------------------------------------------------------|
+#include "test/support/fixtures/xpath-compile-fixture.h"
+#include "test/support/misc-util/log-utils.h"
+
+// ---------------------------------------------------------------------------|
+using namespace std;
+
+// ---------------------------------------------------------------------------|
+namespace YumaTest {
+
+BOOST_FIXTURE_TEST_SUITE( XPathKeyStepTests, XPathCompileFixture )
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( string_key_lookup )
+{
+    DisplayTestDescrption(
+            "Check key lookups on a string key match the list scan",
+            "Procedure: \n"
+            "\t 1 - Look up entries by literal and current() values\n"
+            "\t 2 - Check each result against the interpreted scan\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[xct:name = 'item7']" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:item[xct:name = 'nosuch']" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:name = current()/xct:refs/xct:ifname]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "../xct:item[xct:name = current()/xct:ifname]/xct:a",
+            "/xct:top/xct:refs" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:name = 'item7'][xct:b = 'b7']" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:name = 'item7'][xct:b = 'b8']" ), 0u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( integer_key_string_value )
+{
+    DisplayTestDescrption(
+            "Check an integer key compared with a string gets the "
+            "string comparison of the scan",
+            "Procedure: \n"
+            "\t 1 - Look up an integer key with '1', '01', '+1' and ' 1'\n"
+            "\t 2 - Check only the canonical string matches\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = '1']" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = '01']" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = '+1']" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = ' 1']" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:num[xct:id = current()/xct:refs/xct:id-str]" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = 1]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = number('1')]" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:num[xct:id = 'x']" ), 0u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( multi_key_lookup )
+{
+    DisplayTestDescrption(
+            "Check key lookups on a list with two keys match the scan",
+            "Procedure: \n"
+            "\t 1 - Look up entries with both keys, in any order\n"
+            "\t 2 - Check a test of one key falls back to the scan\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:a = 'p3'][xct:b = '2']" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:b = '2' and xct:a = 'p3']" ), 1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:a = 'p3' and xct:b = current()/xct:refs/xct:small]" ),
+            1u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:a = 'p3'][xct:b = '02']" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:a = 'p3'][xct:b = '9']" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult( "xct:pair[xct:a = 'p3']" ), 4u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:a = 'p3'][xct:a = 'p3'][xct:b = '2']" ), 1u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( empty_value_nodeset )
+{
+    DisplayTestDescrption(
+            "Check a key compared with an empty node-set selects nothing",
+            "Procedure: \n"
+            "\t 1 - Look up entries by a leaf that is not set\n"
+            "\t 2 - Check no entry is found by either path\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:name = current()/xct:refs/xct:unset]" ), 0u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:pair[xct:a = 'p3'][xct:b = current()/xct:refs/xct:unset]" ),
+            0u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "count(xct:item[xct:name = current()/xct:refs/xct:unset])" ), 0u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_CASE( multi_node_value_nodeset )
+{
+    DisplayTestDescrption(
+            "Check a key compared with several nodes selects every match",
+            "Procedure: \n"
+            "\t 1 - Look up entries by a leaf-list with 3 values\n"
+            "\t 2 - Look up entries by a leaf of several list entries\n"
+            "\t 3 - Check the nodes and their order match the scan\n"
+            );
+
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:item[xct:name = current()/xct:refs/xct:names]" ), 3u );
+    BOOST_CHECK_EQUAL( checkSameResult(
+            "xct:num[xct:id = /xct:top/xct:pair[xct:a = 'p1']/xct:b]" ), 3u );
+}
+
+// ---------------------------------------------------------------------------|
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace YumaTest